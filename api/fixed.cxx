@@ -0,0 +1,35 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JavaClass.h"
+#include "fixed.h"
+
+#define CHECK_FUNC(funct,sig) \
+  if (strcmp(#funct#sig, method_name) == 0) \
+  { \
+    return generator->fixed_##funct##sig(); \
+  }
+
+int fixed(JavaClass *java_class, Generator *generator, char *method_name)
+{
+  CHECK_FUNC(mul8,_II)
+  CHECK_FUNC(div8,_II)
+  CHECK_FUNC(mul16,_II)
+  CHECK_FUNC(div16,_II)
+
+  return -1;
+}
+
@@ -0,0 +1,21 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _FIXED_H
+#define _FIXED_H
+
+#include "Generator.h"
+#include "JavaClass.h"
+
+int fixed(JavaClass *java_class, Generator *generator, char *method_name);
+
+#endif
+
@@ -102,6 +102,12 @@ void get_signature(char *signature, int *params, int *is_void)
       (*params)++;
     }
       else
+    if ((*signature == 'J' || *signature == 'D') && signature[-1] != '[')
+    {
+      // Longs and doubles take 2 slots on the stack.
+      *params += 2;
+    }
+      else
     {
       (*params)++;
     }
@@ -110,6 +116,35 @@ void get_signature(char *signature, int *params, int *is_void)
   }
 }
 
+int get_float_params(const char *signature)
+{
+  int count = 0;
+
+  while(*signature != ')' && *signature != 0)
+  {
+    if (*signature == '[')
+    {
+      // An array of floats is still just a reference.
+      while(*signature == '[') { signature++; }
+    }
+      else
+    if (*signature == 'F')
+    {
+      count++;
+    }
+
+    if (*signature == 'L')
+    {
+      while(*signature != ';' && *signature != 0) { signature++; }
+      if (*signature == 0) { break; }
+    }
+
+    signature++;
+  }
+
+  return count;
+}
+
 void get_static_function(char *function, char *method_name, char *method_sig)
 {
 char *s;
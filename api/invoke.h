@@ -16,6 +16,7 @@
 #include "JavaClass.h"
 
 void get_signature(char *signature, int *params, int *is_void);
+int get_float_params(const char *signature);
 void get_static_function(char *function, char *method_name, char *method_sig);
 
 #endif
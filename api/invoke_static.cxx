@@ -26,6 +26,7 @@
 #include "cpc_.h"
 #include "cpu.h"
 #include "dsp.h"
+#include "fixed.h"
 #include "ioport.h"
 #include "memory.h"
 #include "msx_.h"
@@ -137,6 +138,7 @@ int invoke_static(JavaClass *java_class, int method_id, Generator *generator)
     CHECK_WITH_PORT(IOPort, ioport, 7)
     CHECK(Memory, memory)
     CHECK(DSP, dsp)
+    CHECK(Fixed, fixed)
     CHECK(AppleIIgs, appleiigs)
     CHECK(Atari2600, atari_2600)
     CHECK(ADC, adc)
@@ -168,7 +170,23 @@ int invoke_static(JavaClass *java_class, int method_id, Generator *generator)
       int params,is_void;
       get_signature(method_sig, &params, &is_void);
       remove_illegal_chars(function);
-      ret = generator->invoke_static_method(function, params, is_void);
+
+      // A float can take more than one stack entry.
+      params += get_float_params(method_sig) * (generator->get_float_size() - 1);
+
+      if (strstr(method_sig, ")J") != NULL)
+      {
+        ret = generator->invoke_static_method_long(function, params);
+      }
+        else
+      if (strstr(method_sig, ")F") != NULL)
+      {
+        ret = generator->invoke_static_method_float(function, params);
+      }
+        else
+      {
+        ret = generator->invoke_static_method(function, params, is_void);
+      }
     }
   }
 
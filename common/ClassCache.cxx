@@ -0,0 +1,92 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "ClassCache.h"
+
+ClassCache::ClassCache()
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+ClassCache::~ClassCache()
+{
+  std::map<std::string,JavaClass *>::iterator iter;
+
+  for (iter = classes.begin(); iter != classes.end(); iter++)
+  {
+    delete iter->second;
+  }
+
+  pthread_mutex_destroy(&mutex);
+}
+
+JavaClass *ClassCache::load(const char *filename, bool is_main_class)
+{
+  std::string key = std::string(is_main_class ? "M:" : "E:") + filename;
+  std::map<std::string,JavaClass *>::iterator iter;
+  JavaClass *java_class = NULL;
+
+  pthread_mutex_lock(&mutex);
+
+  iter = classes.find(key);
+
+  if (iter != classes.end())
+  {
+    java_class = iter->second;
+  }
+    else
+  {
+    FILE *in = fopen(filename, "rb");
+
+    if (in != NULL)
+    {
+      java_class = new JavaClass(in, is_main_class);
+      classes[key] = java_class;
+      fclose(in);
+    }
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return java_class;
+}
+
+JavaClass *ClassCache::load(ClassPath *class_path, const char *class_name)
+{
+  std::string key = std::string("P:") + class_name;
+  std::map<std::string,JavaClass *>::iterator iter;
+  JavaClass *java_class = NULL;
+
+  pthread_mutex_lock(&mutex);
+
+  iter = classes.find(key);
+
+  if (iter != classes.end())
+  {
+    java_class = iter->second;
+  }
+    else
+  {
+    java_class = class_path->load(class_name, false);
+
+    if (java_class != NULL) { classes[key] = java_class; }
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return java_class;
+}
+
@@ -0,0 +1,42 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CLASS_CACHE_H
+#define _CLASS_CACHE_H
+
+#include <pthread.h>
+
+#include <map>
+#include <string>
+
+#include "ClassPath.h"
+#include "JavaClass.h"
+
+// Class files loaded by a batch of compiles.  Each file is parsed once
+// and the JavaClass is shared (read only) by every compiler using it.
+class ClassCache
+{
+public:
+  ClassCache();
+  ~ClassCache();
+
+  JavaClass *load(const char *filename, bool is_main_class);
+  JavaClass *load(ClassPath *class_path, const char *class_name);
+
+private:
+  pthread_mutex_t mutex;
+  // A class is keyed on its filename and whether it's the main class
+  // since that changes the names its refs resolve to.
+  std::map<std::string,JavaClass *> classes;
+};
+
+#endif
+
@@ -0,0 +1,199 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "ClassPath.h"
+
+ClassPath::ClassPath() :
+  roots(NULL),
+  count(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+ClassPath::~ClassPath()
+{
+  int n;
+
+  for (n = 0; n < count; n++)
+  {
+    delete roots[n].jar;
+  }
+
+  free(roots);
+  pthread_mutex_destroy(&mutex);
+}
+
+int ClassPath::add(const char *paths)
+{
+  struct stat statbuf;
+  const char *end;
+  int len;
+
+  // Same as java, entries are separated with a ':'.
+  while(*paths != 0)
+  {
+    end = paths;
+    while(*end != ':' && *end != 0) { end++; }
+
+    len = end - paths;
+
+    if (len >= (int)sizeof(roots[0].path))
+    {
+      printf("Error: Classpath entry is too long.\n");
+      return -1;
+    }
+
+    if (len != 0)
+    {
+      roots = (class_root_t *)realloc(roots, (count + 1) * sizeof(class_root_t));
+
+      class_root_t *root = &roots[count];
+
+      memcpy(root->path, paths, len);
+      root->path[len] = 0;
+      root->jar = NULL;
+      root->opened = false;
+
+      if (stat(root->path, &statbuf) != 0)
+      {
+        printf("Cannot open '%s'\n", root->path);
+        return -1;
+      }
+
+      root->is_jar = !S_ISDIR(statbuf.st_mode);
+
+      count++;
+    }
+
+    paths = *end == 0 ? end : end + 1;
+  }
+
+  return 0;
+}
+
+int ClassPath::find(const char *class_name, char *source, int len)
+{
+  int index = find_root(class_name);
+
+  if (index == -1) { return -1; }
+
+  // For a jar the whole jar is what the class came from.
+  if (roots[index].is_jar)
+  {
+    snprintf(source, len, "%s", roots[index].path);
+  }
+    else
+  {
+    snprintf(source, len, "%s/%s.class", roots[index].path, class_name);
+  }
+
+  return 0;
+}
+
+JavaClass *ClassPath::load(const char *class_name, bool is_main_class)
+{
+  JavaClass *java_class;
+  char filename[1200];
+  uint8_t *data;
+  int length;
+  int index;
+
+  index = find_root(class_name);
+
+  if (index == -1) { return NULL; }
+
+  if (!roots[index].is_jar)
+  {
+    snprintf(filename, sizeof(filename), "%s/%s.class", roots[index].path, class_name);
+
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL) { return NULL; }
+
+    java_class = new JavaClass(in, is_main_class);
+    fclose(in);
+
+    return java_class;
+  }
+
+  snprintf(filename, sizeof(filename), "%s.class", class_name);
+
+  data = get_jar(&roots[index])->read_entry(filename, &length);
+
+  if (data == NULL) { return NULL; }
+
+  java_class = new JavaClass(data, length, is_main_class);
+  free(data);
+
+  return java_class;
+}
+
+int ClassPath::find_root(const char *class_name)
+{
+  struct stat statbuf;
+  char filename[1200];
+  int n;
+
+  for (n = 0; n < count; n++)
+  {
+    if (roots[n].is_jar)
+    {
+      JarFile *jar = get_jar(&roots[n]);
+
+      snprintf(filename, sizeof(filename), "%s.class", class_name);
+
+      if (jar != NULL && jar->has_entry(filename)) { return n; }
+    }
+      else
+    {
+      snprintf(filename, sizeof(filename), "%s/%s.class", roots[n].path, class_name);
+
+      if (stat(filename, &statbuf) == 0) { return n; }
+    }
+  }
+
+  return -1;
+}
+
+JarFile *ClassPath::get_jar(class_root_t *root)
+{
+  JarFile *jar;
+
+  // Compiles in a batch share the class path so only one of them opens
+  // a jar.  After that the jar is only read.
+  pthread_mutex_lock(&mutex);
+
+  if (!root->opened)
+  {
+    root->jar = new JarFile();
+
+    if (root->jar->open(root->path) != 0)
+    {
+      delete root->jar;
+      root->jar = NULL;
+    }
+
+    root->opened = true;
+  }
+
+  jar = root->jar;
+
+  pthread_mutex_unlock(&mutex);
+
+  return jar;
+}
+
@@ -0,0 +1,52 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CLASS_PATH_H
+#define _CLASS_PATH_H
+
+#include <pthread.h>
+
+#include "JarFile.h"
+#include "JavaClass.h"
+
+struct class_root_t
+{
+  char path[1024];
+  JarFile *jar;
+  bool is_jar;
+  bool opened;
+};
+
+// Directories and .jar files given with -cp that external classes are
+// looked up in (in order) when they aren't next to the main class.
+// Jars are only opened once a class is looked for in them.
+class ClassPath
+{
+public:
+  ClassPath();
+  ~ClassPath();
+
+  int add(const char *paths);
+  int find(const char *class_name, char *source, int len);
+  JavaClass *load(const char *class_name, bool is_main_class);
+  int get_count() { return count; }
+
+private:
+  int find_root(const char *class_name);
+  JarFile *get_jar(class_root_t *root);
+
+  pthread_mutex_t mutex;
+  class_root_t *roots;
+  int count;
+};
+
+#endif
+
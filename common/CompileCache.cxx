@@ -0,0 +1,232 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "CompileCache.h"
+#include "fileio.h"
+#include "version.h"
+
+static int temp_count = 0;
+
+CompileCache::CompileCache(const char *directory, const char *program)
+{
+  struct stat statbuf;
+
+  snprintf(this->directory, sizeof(this->directory), "%s", directory);
+  mkdir(directory, 0777);
+
+  // Anything changed in java_grinder itself changes the output, so the
+  // binary's size and time stamp are part of every key.
+  memset(&statbuf, 0, sizeof(statbuf));
+
+  if (stat("/proc/self/exe", &statbuf) != 0)
+  {
+    stat(program, &statbuf);
+  }
+
+  snprintf(compiler_id, sizeof(compiler_id), "%s %lld %lld",
+    VERSION, (long long)statbuf.st_size, (long long)statbuf.st_mtime);
+}
+
+CompileCache::~CompileCache()
+{
+}
+
+int CompileCache::lookup(const char *java_file, const char *settings, char **text, int *length)
+{
+  char filename[1200];
+  char line[1200];
+  char name[1024];
+  uint8_t *data;
+  int data_length;
+  int text_length;
+  int ptr = 0;
+  int len;
+  FILE *in;
+
+  get_entry_name(filename, sizeof(filename), java_file, settings);
+
+  in = fopen(filename, "rb");
+  if (in == NULL) { return -1; }
+
+  data = read_file(in, &data_length);
+  fclose(in);
+
+  if (data == NULL) { return -1; }
+
+  while(1)
+  {
+    // Entries are a few lines of text naming what went into the
+    // output, followed by the output itself.
+    for (len = 0; ptr + len < data_length; len++)
+    {
+      if (data[ptr + len] == '\n') { break; }
+    }
+
+    if (ptr + len >= data_length || len >= (int)sizeof(line)) { break; }
+
+    memcpy(line, data + ptr, len);
+    line[len] = 0;
+    ptr += len + 1;
+
+    if (strncmp(line, "id ", 3) == 0)
+    {
+      if (strcmp(line + 3, compiler_id) != 0) { break; }
+    }
+      else
+    if (strncmp(line, "settings ", 9) == 0)
+    {
+      if (strcmp(line + 9, settings) != 0) { break; }
+    }
+      else
+    if (strncmp(line, "main ", 5) == 0)
+    {
+      if (strcmp(line + 5, java_file) != 0) { break; }
+    }
+      else
+    if (strncmp(line, "file ", 5) == 0)
+    {
+      unsigned long long saved_hash;
+      uint64_t current_hash;
+
+      if (sscanf(line + 5, "%16llx %1023[^\n]", &saved_hash, name) != 2) { break; }
+      if (hash_file(name, &current_hash) != 0) { break; }
+      if (current_hash != saved_hash) { break; }
+    }
+      else
+    if (strncmp(line, "text ", 5) == 0)
+    {
+      text_length = atoi(line + 5);
+
+      if (text_length < 0 || text_length > data_length - ptr) { break; }
+
+      *text = (char *)malloc(text_length + 1);
+      memcpy(*text, data + ptr, text_length);
+      (*text)[text_length] = 0;
+      *length = text_length;
+
+      free(data);
+      return 0;
+    }
+  }
+
+  free(data);
+
+  return -1;
+}
+
+int CompileCache::store(const char *java_file, const char *settings, const std::map<std::string,int> &class_files, const char *text, int length)
+{
+  std::map<std::string,int>::const_iterator iter;
+  char filename[1200];
+  char temp_name[1300];
+  uint64_t file_hash;
+  FILE *out;
+
+  get_entry_name(filename, sizeof(filename), java_file, settings);
+
+  // Entries are written under a name nothing else is using and then
+  // renamed so a concurrent lookup never sees half of one.
+  snprintf(temp_name, sizeof(temp_name), "%s.%d.%d",
+    filename, (int)getpid(), __sync_fetch_and_add(&temp_count, 1));
+
+  out = fopen(temp_name, "wb");
+
+  if (out == NULL)
+  {
+    printf("Couldn't write cache entry %s\n", temp_name);
+    return -1;
+  }
+
+  fprintf(out, "java_grinder cache\n");
+  fprintf(out, "id %s\n", compiler_id);
+  fprintf(out, "settings %s\n", settings);
+  fprintf(out, "main %s\n", java_file);
+
+  for (iter = class_files.begin(); iter != class_files.end(); iter++)
+  {
+    if (hash_file(iter->first.c_str(), &file_hash) != 0)
+    {
+      fclose(out);
+      remove(temp_name);
+      return -1;
+    }
+
+    fprintf(out, "file %016llx %s\n",
+      (unsigned long long)file_hash, iter->first.c_str());
+  }
+
+  fprintf(out, "text %d\n", length);
+  fwrite(text, 1, length, out);
+  fclose(out);
+
+  if (rename(temp_name, filename) != 0)
+  {
+    remove(temp_name);
+    return -1;
+  }
+
+  return 0;
+}
+
+void CompileCache::get_entry_name(char *filename, int len, const char *java_file, const char *settings)
+{
+  uint64_t key = 0xcbf29ce484222325ULL;
+
+  key = hash(key, compiler_id, strlen(compiler_id) + 1);
+  key = hash(key, settings, strlen(settings) + 1);
+  key = hash(key, java_file, strlen(java_file) + 1);
+
+  snprintf(filename, len, "%s/%016llx.jgc", directory, (unsigned long long)key);
+}
+
+int CompileCache::hash_file(const char *filename, uint64_t *file_hash)
+{
+  uint8_t *data;
+  int length;
+  FILE *in;
+
+  in = fopen(filename, "rb");
+  if (in == NULL) { return -1; }
+
+  data = read_file(in, &length);
+  fclose(in);
+
+  if (data == NULL) { return -1; }
+
+  *file_hash = hash(0xcbf29ce484222325ULL, data, length);
+
+  free(data);
+
+  return 0;
+}
+
+uint64_t CompileCache::hash(uint64_t hash, const void *data, int len)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  int n;
+
+  // FNV-1a
+  for (n = 0; n < len; n++)
+  {
+    hash = (hash ^ bytes[n]) * 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
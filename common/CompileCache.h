@@ -0,0 +1,44 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _COMPILE_CACHE_H
+#define _COMPILE_CACHE_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+// On disk cache of generated assembly.  An entry is found by the main
+// class file, platform and settings, and is only used if every class
+// file that went into it (the main class and all external classes it
+// loaded) still has the same contents and the same java_grinder binary
+// made it.
+class CompileCache
+{
+public:
+  CompileCache(const char *directory, const char *program);
+  ~CompileCache();
+
+  int lookup(const char *java_file, const char *settings, char **text, int *length);
+  int store(const char *java_file, const char *settings, const std::map<std::string,int> &class_files, const char *text, int length);
+
+private:
+  void get_entry_name(char *filename, int len, const char *java_file, const char *settings);
+  static int hash_file(const char *filename, uint64_t *hash);
+  static uint64_t hash(uint64_t hash, const void *data, int len);
+
+  char directory[1024];
+  char compiler_id[128];
+};
+
+#endif
+
@@ -0,0 +1,463 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "CompileStats.h"
+
+// Mnemonics the generators use to call a subroutine.
+static const char *call_instructions[] =
+{
+  "call", "calla", "rcall", "lcall", "acall",
+  "jsr", "jsr.l", "jsr.w", "jsl",
+  "bsr", "bsr.l", "bsr.w",
+  "jal", "bl", "brl",
+  NULL
+};
+
+// Lines that take no space in the program or aren't instructions.
+static const char *data_directives[] =
+{
+  "db", "dw", "dc", "dc8", "dc16", "dc32", "dc64", "dd", "dl", "ds",
+  "equ", "org", "align", "include",
+  NULL
+};
+
+static bool in_list(const char **list, const char *name)
+{
+  int n;
+
+  for (n = 0; list[n] != NULL; n++)
+  {
+    if (strcmp(list[n], name) == 0) { return true; }
+  }
+
+  return false;
+}
+
+static int get_word(const char *s, const char *end, char *word, int len)
+{
+  int n = 0;
+
+  while (s + n < end && s[n] != ' ' && s[n] != '\t' && s[n] != '\n')
+  {
+    if (n < len - 1) { word[n] = tolower(s[n]); }
+    n++;
+  }
+
+  word[n < len - 1 ? n : len - 1] = 0;
+
+  return n;
+}
+
+static int get_bytes_before(std::map<int,int> &line_bytes, long offset, int total)
+{
+  std::map<int,int>::iterator iter = line_bytes.lower_bound(offset);
+
+  if (iter == line_bytes.end()) { return total; }
+
+  return iter->second;
+}
+
+CompileStats::CompileStats() :
+  count(0),
+  instruction_size(0),
+  have_cycles(false)
+{
+}
+
+CompileStats::~CompileStats()
+{
+}
+
+method_stats_t *CompileStats::add_method(const char *name, int bytecode_length, long text_start)
+{
+  method_stats_t *method = &methods[count++];
+
+  memset(method, 0, sizeof(method_stats_t));
+  snprintf(method->name, sizeof(method->name), "%s", name);
+  method->bytecode_length = bytecode_length;
+  method->text_start = text_start;
+  method->text_end = text_start;
+  method->bytes = -1;
+
+  method_names[name] = 1;
+
+  return method;
+}
+
+bool CompileStats::is_method(const char *name)
+{
+  return method_names.find(name) != method_names.end();
+}
+
+void CompileStats::count_instructions(method_stats_t *method, const char *text, int length)
+{
+  const char *s = text + method->text_start;
+  const char *end = text + method->text_end;
+  char word[64];
+  char operand[256];
+  int len;
+
+  if (end > text + length) { end = text + length; }
+
+  while (s < end)
+  {
+    const char *next = s;
+
+    while (next < end && *next != '\n') { next++; }
+
+    while (s < next && (*s == ' ' || *s == '\t')) { s++; }
+
+    len = get_word(s, next, word, sizeof(word));
+
+    if (len == 0 || word[0] == ';' || word[0] == '.' ||
+        word[len - 1] == ':' || in_list(data_directives, word))
+    {
+      s = next + 1;
+      continue;
+    }
+
+    s += len;
+    while (s < next && (*s == ' ' || *s == '\t')) { s++; }
+
+    // Skip "name equ value" too.
+    if (*s != '#' && *s != '@')
+    {
+      char second[16];
+
+      get_word(s, next, second, sizeof(second));
+
+      if (strcmp(second, "equ") == 0 || strcmp(second, "=") == 0)
+      {
+        s = next + 1;
+        continue;
+      }
+    }
+
+    method->instructions++;
+
+    if (in_list(call_instructions, word))
+    {
+      int n = 0;
+
+      while (s < next && (*s == '#' || *s == '@')) { s++; }
+
+      while (s + n < next && n < (int)sizeof(operand) - 1 &&
+             (isalnum(s[n]) || s[n] == '_' || s[n] == '.'))
+      {
+        operand[n] = s[n];
+        n++;
+      }
+
+      operand[n] = 0;
+
+      // Registers (jal $t9) and calls to Java methods don't count.
+      if (n != 0 && !is_method(operand)) { method->helper_calls++; }
+    }
+
+    s = next + 1;
+  }
+}
+
+int CompileStats::write_json(const char *filename, const char *java_file, const char *chip_type, const char *text, int length, Encoder *encoder)
+{
+  std::map<int,method_stats_t>::iterator iter;
+  std::map<int,int> line_bytes;
+  method_stats_t total;
+  bool have_bytes = false;
+  bool bytes_estimated = false;
+  FILE *out;
+
+  for (iter = methods.begin(); iter != methods.end(); iter++)
+  {
+    count_instructions(&iter->second, text, length);
+  }
+
+  if (encoder != NULL)
+  {
+    encoder->set_line_bytes(&line_bytes);
+
+    if (encoder->assemble(text, length) == 0)
+    {
+      int bytes = get_bytes_before(line_bytes, length, 0);
+
+      for (iter = methods.begin(); iter != methods.end(); iter++)
+      {
+        method_stats_t *method = &iter->second;
+
+        method->bytes =
+          get_bytes_before(line_bytes, method->text_end, bytes) -
+          get_bytes_before(line_bytes, method->text_start, bytes);
+      }
+
+      have_bytes = true;
+    }
+
+    encoder->set_line_bytes(NULL);
+  }
+
+  // Without an assembler the size is a guess from the instruction count.
+  if (!have_bytes && instruction_size != 0)
+  {
+    for (iter = methods.begin(); iter != methods.end(); iter++)
+    {
+      method_stats_t *method = &iter->second;
+
+      method->bytes = method->instructions * instruction_size;
+    }
+
+    have_bytes = true;
+    bytes_estimated = true;
+  }
+
+  out = fopen(filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Couldn't open file %s for writing.\n", filename);
+    return -1;
+  }
+
+  memset(&total, 0, sizeof(total));
+  total.cycles_complete = true;
+
+  fprintf(out, "{\n  \"class\": ");
+  write_string(out, java_file);
+  fprintf(out, ",\n  \"platform\": ");
+  write_string(out, chip_type);
+  fprintf(out, ",\n  \"methods\": [\n");
+
+  for (iter = methods.begin(); iter != methods.end(); iter++)
+  {
+    method_stats_t *method = &iter->second;
+
+    fprintf(out, "    { \"name\": ");
+    write_string(out, method->name);
+    fprintf(out, ", \"bytecode_length\": %d, \"instructions\": %d, ",
+      method->bytecode_length, method->instructions);
+
+    if (have_bytes)
+    {
+      fprintf(out, "\"bytes\": %d, \"bytes_estimated\": %s, ",
+        method->bytes, bytes_estimated ? "true" : "false");
+    }
+      else
+    {
+      fprintf(out, "\"bytes\": null, ");
+    }
+
+    fprintf(out, "\"spills\": %d, \"helper_calls\": %d, \"peephole\": %d, ",
+      method->spills, method->helper_calls, method->peephole);
+
+    if (have_cycles)
+    {
+      fprintf(out, "\"cycles\": %d, \"loops\": %s, \"cycles_complete\": %s }",
+        method->cycles, method->loops ? "true" : "false",
+        method->cycles_complete ? "true" : "false");
+    }
+      else
+    {
+      fprintf(out, "\"cycles\": null }");
+    }
+
+    fprintf(out, "%s\n", iter->first == count - 1 ? "" : ",");
+
+    total.bytecode_length += method->bytecode_length;
+    total.instructions += method->instructions;
+    total.bytes += method->bytes;
+    total.spills += method->spills;
+    total.helper_calls += method->helper_calls;
+    total.peephole += method->peephole;
+    total.cycles += method->cycles;
+    total.loops = total.loops || method->loops;
+    total.cycles_complete = total.cycles_complete && method->cycles_complete;
+  }
+
+  fprintf(out, "  ],\n");
+  fprintf(out, "  \"total\": { \"methods\": %d, \"bytecode_length\": %d, \"instructions\": %d, ",
+    count, total.bytecode_length, total.instructions);
+
+  if (have_bytes)
+  {
+    fprintf(out, "\"bytes\": %d, \"bytes_estimated\": %s, ",
+      total.bytes, bytes_estimated ? "true" : "false");
+  }
+    else
+  {
+    fprintf(out, "\"bytes\": null, ");
+  }
+
+  fprintf(out, "\"spills\": %d, \"helper_calls\": %d, \"peephole\": %d, ",
+    total.spills, total.helper_calls, total.peephole);
+
+  // The sum of each method's worst case, for comparing two builds.
+  if (have_cycles)
+  {
+    fprintf(out, "\"cycles\": %d, \"loops\": %s, \"cycles_complete\": %s }\n}\n",
+      total.cycles, total.loops ? "true" : "false",
+      total.cycles_complete ? "true" : "false");
+  }
+    else
+  {
+    fprintf(out, "\"cycles\": null }\n}\n");
+  }
+
+  fclose(out);
+
+  return 0;
+}
+
+void CompileStats::count_cycles(const char *text, int length, Cycles *cycles)
+{
+  std::map<int,method_stats_t>::iterator iter;
+
+  cycles->read_symbols(text, length);
+
+  for (iter = methods.begin(); iter != methods.end(); iter++)
+  {
+    method_stats_t *method = &iter->second;
+    long end = method->text_end < length ? method->text_end : length;
+
+    cycles->analyze(text, method->text_start, end);
+
+    method->cycles = cycles->get_cycles();
+    method->loops = cycles->has_loops();
+    method->cycles_complete = cycles->is_complete();
+  }
+
+  have_cycles = true;
+}
+
+int CompileStats::annotate_cycles(char **text, size_t *length, Cycles *cycles)
+{
+  std::map<int,method_stats_t>::iterator iter;
+  const char *s = *text;
+  long text_length = *length;
+  char *buffer;
+  int buffer_length = 0;
+  int buffer_size;
+  long copied = 0;
+  char comment[512];
+  int n;
+
+  // Comments are added to a copy since every one of them moves the
+  // rest of the text.
+  buffer_size = text_length + text_length / 2 + 1024;
+  buffer = (char *)malloc(buffer_size);
+
+  for (iter = methods.begin(); iter != methods.end(); iter++)
+  {
+    method_stats_t *method = &iter->second;
+    long end = method->text_end < text_length ? method->text_end : text_length;
+
+    if (method->text_start < copied) { continue; }
+
+    cycles->analyze(s, method->text_start, end);
+
+    for (n = -1; n < cycles->get_block_count(); n++)
+    {
+      long offset;
+      int len;
+
+      if (n == -1)
+      {
+        offset = method->text_start;
+
+        len = snprintf(comment, sizeof(comment), "; %s: %d%s cycles worst case%s",
+          method->name, cycles->get_cycles(),
+          cycles->is_complete() ? "" : "+",
+          cycles->has_loops() ? " (loops counted once)" : "");
+
+        if (cycles->get_cycles_per_line() != 0)
+        {
+          len += snprintf(comment + len, sizeof(comment) - len,
+            ", %d scanlines", (cycles->get_cycles() + cycles->get_cycles_per_line() - 1) /
+            cycles->get_cycles_per_line());
+        }
+
+        len += snprintf(comment + len, sizeof(comment) - len, "\n");
+      }
+        else
+      {
+        const cycles_block_t *block = cycles->get_block(n);
+
+        // Entries of a jump table.
+        if (block->cycles == 0 && !block->unknown) { continue; }
+
+        offset = block->start;
+
+        len = snprintf(comment, sizeof(comment), "  ; %d%s cycles",
+          block->cycles, block->unknown ? "+" : "");
+
+        if (cycles->get_cycles_per_line() != 0)
+        {
+          len += snprintf(comment + len, sizeof(comment) - len,
+            " (%d%% of a scanline)",
+            (block->cycles * 100) / cycles->get_cycles_per_line());
+        }
+
+        len += snprintf(comment + len, sizeof(comment) - len, "\n");
+      }
+
+      if (offset < copied) { continue; }
+
+      while (buffer_length + (offset - copied) + len + 1 > buffer_size)
+      {
+        buffer_size *= 2;
+        buffer = (char *)realloc(buffer, buffer_size);
+      }
+
+      memcpy(buffer + buffer_length, s + copied, offset - copied);
+      buffer_length += offset - copied;
+      memcpy(buffer + buffer_length, comment, len);
+      buffer_length += len;
+      copied = offset;
+    }
+  }
+
+  if (buffer_length + (text_length - copied) + 1 > buffer_size)
+  {
+    buffer_size = buffer_length + (text_length - copied) + 1;
+    buffer = (char *)realloc(buffer, buffer_size);
+  }
+
+  memcpy(buffer + buffer_length, s + copied, text_length - copied);
+  buffer_length += text_length - copied;
+  buffer[buffer_length] = 0;
+
+  free(*text);
+  *text = buffer;
+  *length = buffer_length;
+
+  return 0;
+}
+
+void CompileStats::write_string(FILE *out, const char *s)
+{
+  putc('"', out);
+
+  while (*s != 0)
+  {
+    if (*s == '"' || *s == '\\') { fprintf(out, "\\%c", *s); }
+    else if ((uint8_t)*s < 0x20) { fprintf(out, "\\u%04x", (uint8_t)*s); }
+    else { putc(*s, out); }
+
+    s++;
+  }
+
+  putc('"', out);
+}
+
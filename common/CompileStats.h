@@ -0,0 +1,67 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _COMPILE_STATS_H
+#define _COMPILE_STATS_H
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+#include "Cycles.h"
+#include "Encoder.h"
+
+struct method_stats_t
+{
+  char name[256+8];
+  int bytecode_length;   // after inlining and loop optimization
+  long text_start;       // where the method is in the generated text
+  long text_end;
+  int spills;            // stack values that went to the CPU stack
+  int peephole;          // bytecodes folded, combined or removed
+  int instructions;
+  int bytes;             // -1 without an assembler or an estimate
+  int helper_calls;      // calls to anything that isn't a Java method
+  int cycles;            // worst case path, each loop body counted once
+  bool loops;
+  bool cycles_complete;  // false if some instructions had no timings
+};
+
+// Per method numbers for -stats.  The compiler fills in what it knows
+// while generating each method, the rest comes from reading the method's
+// part of the finished assembly.
+class CompileStats
+{
+public:
+  CompileStats();
+  ~CompileStats();
+
+  method_stats_t *add_method(const char *name, int bytecode_length, long text_start);
+  void set_instruction_size(int size) { instruction_size = size; }
+  int write_json(const char *filename, const char *java_file, const char *chip_type, const char *text, int length, Encoder *encoder);
+  void count_cycles(const char *text, int length, Cycles *cycles);
+  int annotate_cycles(char **text, size_t *length, Cycles *cycles);
+
+private:
+  void count_instructions(method_stats_t *method, const char *text, int length);
+  bool is_method(const char *name);
+  static void write_string(FILE *out, const char *s);
+
+  std::map<int,method_stats_t> methods;
+  std::map<std::string,int> method_names;
+  int count;
+  int instruction_size;
+  bool have_cycles;
+};
+
+#endif
+
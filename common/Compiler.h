@@ -12,6 +12,9 @@
 #ifndef _COMPILER_H
 #define _COMPILER_H
 
+#include <map>
+#include <string>
+
 #include "Generator.h"
 
 #define DEBUG_PRINT(a, ...) if (verbose == 1) { printf(a, ##__VA_ARGS__); }
@@ -19,12 +22,22 @@
 class Compiler
 {
 public:
-  Compiler() : generator(NULL), optimize(true), verbose(false) { }
+  Compiler() :
+    generator(NULL),
+    optimize(true),
+    verbose(false),
+    inline_size(8),
+    threads_max(0)
+  {
+  }
   virtual ~Compiler() { }
 
   void disable_optimizer() { optimize = false; }
   void set_verbose() { verbose = true; }
+  void set_inline_size(int size) { inline_size = size; }
+  void set_threads(int count) { threads_max = count; }
   void set_generator(Generator *generator) { this->generator = generator; }
+  const std::map<std::string,int> &get_class_files() { return class_files; }
 
   virtual int load_class(const char *filename) = 0;
   virtual void insert_static_field_defines() = 0;
@@ -46,6 +59,9 @@ protected:
   Generator *generator;
   bool optimize;
   bool verbose;
+  int inline_size;
+  int threads_max;  // 0 is one per CPU
+  std::map<std::string,int> class_files;  // every class file read
 };
 
 #endif
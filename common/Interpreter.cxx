@@ -0,0 +1,1453 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "Interpreter.h"
+#include "inline_methods.h"
+#include "optimize_loops.h"
+#include "table_java_instr.h"
+
+#define DEBUG_PRINT(a, ...) if (verbose) { printf(a, ##__VA_ARGS__); }
+
+#define GET_INT16(a) ((int16_t)((code[a] << 8) | code[(a) + 1]))
+#define GET_UINT16(a) ((code[a] << 8) | code[(a) + 1])
+#define GET_INT32(a) ((int32_t)(((uint32_t)code[a] << 24) | \
+                                ((uint32_t)code[(a) + 1] << 16) | \
+                                ((uint32_t)code[(a) + 2] << 8) | \
+                                 (uint32_t)code[(a) + 3]))
+
+#define POP(a) \
+  if (sp == 0) \
+  { \
+    printf("Error: %s pc=%d: operand stack underflow\n", method_name, pc); \
+    return -1; \
+  } \
+  a = stack[--sp];
+
+#define PUSH(a) \
+  if (sp == max_stack) \
+  { \
+    printf("Error: %s pc=%d: operand stack overflow\n", method_name, pc); \
+    return -1; \
+  } \
+  stack[sp++] = a;
+
+// Longs are 2 words on the stack and in the locals, the low word first.
+#define POP_LONG(a) \
+  POP(d); \
+  POP(c); \
+  a = (int64_t)(((uint64_t)(uint32_t)d << 32) | (uint32_t)c);
+
+#define PUSH_LONG(a) \
+  c = (int32_t)(uint32_t)(a); \
+  d = (int32_t)(uint32_t)((uint64_t)(a) >> 32); \
+  PUSH(c); \
+  PUSH(d);
+
+#define CHECK_LOCAL(a) \
+  if ((a) >= max_locals) \
+  { \
+    printf("Error: %s pc=%d: local %d out of range\n", method_name, pc, a); \
+    return -1; \
+  }
+
+#define GET_ARRAY(a, ref) \
+  a = get_array(ref); \
+  if (a == NULL) \
+  { \
+    printf("Error: %s pc=%d: %s on a null array\n", method_name, pc, table_java_instr[opcode].name); \
+    return -1; \
+  }
+
+#define GET_OBJECT(a, ref) \
+  a = get_array(ref); \
+  if (a == NULL || a->type != INTERPRETER_OBJECT) \
+  { \
+    printf("Error: %s pc=%d: %s on a null object\n", method_name, pc, table_java_instr[opcode].name); \
+    return -1; \
+  }
+
+#define CHECK_BOUNDS(a, index) \
+  if (index < 0 || index >= a->length) \
+  { \
+    printf("Error: %s pc=%d: array index %d out of bounds (length %d)\n", method_name, pc, index, a->length); \
+    return -1; \
+  }
+
+// Floats are kept on the stack and in locals as their bits.
+static float get_float(int32_t a)
+{
+  float f;
+  memcpy(&f, &a, sizeof(f));
+  return f;
+}
+
+static int32_t put_float(float f)
+{
+  int32_t a;
+  memcpy(&a, &f, sizeof(a));
+  return a;
+}
+
+static int32_t float_to_int(float f)
+{
+  // NaN is 0 and anything out of range is clamped.
+  if (f != f) { return 0; }
+  if (f >= 2147483648.0f) { return 0x7fffffff; }
+  if (f <= -2147483648.0f) { return (int32_t)0x80000000; }
+
+  return (int32_t)f;
+}
+
+static bool compare(int cond, int32_t a, int32_t b)
+{
+  switch(cond)
+  {
+    case 0: return a == b;
+    case 1: return a != b;
+    case 2: return a < b;
+    case 3: return a >= b;
+    case 4: return a > b;
+    default: return a <= b;
+  }
+}
+
+Interpreter::Interpreter(JavaClass *java_class) :
+  java_class(java_class),
+  array_count(0),
+  result(0),
+  steps(0),
+  inline_size(8),
+  optimize(true),
+  verbose(false)
+{
+}
+
+Interpreter::~Interpreter()
+{
+  std::map<int32_t,interpreter_array_t>::iterator array_iter;
+  std::map<int,interpreter_method_t>::iterator method_iter;
+
+  for (array_iter = arrays.begin(); array_iter != arrays.end(); array_iter++)
+  {
+    free(array_iter->second.data);
+  }
+
+  for (method_iter = methods.begin(); method_iter != methods.end(); method_iter++)
+  {
+    free(method_iter->second.code);
+    delete method_iter->second.ir;
+  }
+}
+
+int Interpreter::run_static_initializers()
+{
+  int index = java_class->get_clinit_method();
+  int32_t return_value[2];
+
+  if (index != -1)
+  {
+    // Static initializers are run by execute_static() when compiling
+    // so they aren't optimized.
+    methods[index].code = NULL;
+    methods[index].ir = NULL;
+
+    if (execute(index, NULL, 0, return_value, 0) != 0) { return -1; }
+  }
+
+  find_static_constants();
+
+  return 0;
+}
+
+int Interpreter::run_main()
+{
+  int index = java_class->get_method_index("main", "([Ljava/lang/String;)V");
+  int32_t args[1] = { 0 };
+  int32_t return_value[2];
+
+  if (index == -1)
+  {
+    printf("Error: No main() in %s\n", java_class->class_name);
+    return -1;
+  }
+
+  return execute(index, args, 1, return_value, 0);
+}
+
+int Interpreter::prepare_method(int method_id, interpreter_method_t *info)
+{
+  char method_name[128];
+  uint8_t *loop_code;
+
+  info->code = NULL;
+  info->ir = NULL;
+
+  if (!optimize) { return 0; }
+
+  // The same passes JavaCompiler::prepare_method() runs.
+  if (inline_size > 0)
+  {
+    inline_methods(java_class, method_id, inline_size, &info->code, verbose);
+  }
+
+  if (optimize_loops(java_class, method_id, info->code, &loop_code, verbose) > 0)
+  {
+    free(info->code);
+    info->code = loop_code;
+  }
+
+  info->ir = new MethodIR();
+
+  if (info->ir->build(java_class, method_id, info->code) != 0)
+  {
+    java_class->get_method_name(method_name, sizeof(method_name), method_id);
+    printf("Error: Couldn't decode %s\n", method_name);
+    return -1;
+  }
+
+  info->ir->propagate_constants(&static_constants);
+  info->ir->remove_dead_code();
+
+  return 0;
+}
+
+void Interpreter::find_static_constants()
+{
+  char name[128];
+  char type[128];
+  int n;
+
+  // static final fields keep the value <clinit> gave them.  The compiler
+  // gets the same values (when they are plain constants) from
+  // execute_static().
+  for (n = 0; n < java_class->get_field_count(); n++)
+  {
+    const fields_t *field = java_class->get_field(n);
+
+    if ((field->access_flags & (ACC_STATIC|ACC_FINAL)) != (ACC_STATIC|ACC_FINAL))
+    {
+      continue;
+    }
+
+    java_class->get_field_name(name, sizeof(name), n);
+    java_class->get_field_type(type, sizeof(type), n);
+
+    if (type[0] == 0 || strchr("ZBCSI", type[0]) == NULL || type[1] != 0)
+    {
+      continue;
+    }
+
+    if (statics.find(name) == statics.end()) { continue; }
+
+    static_constants[name] = statics[name];
+  }
+}
+
+int32_t Interpreter::new_array(int type, int length)
+{
+  interpreter_array_t *array;
+
+  array_count++;
+  array = &arrays[array_count];
+  array->data = (int32_t *)calloc(length + 1, sizeof(int32_t));
+  array->length = length;
+  array->type = type;
+
+  return array_count;
+}
+
+int32_t Interpreter::new_object()
+{
+  // Slots are indexed like the fields of the class (the ones for statics
+  // are never used) so no layout is needed here.
+  return new_array(INTERPRETER_OBJECT, java_class->get_field_count());
+}
+
+interpreter_array_t *Interpreter::get_array(int32_t ref)
+{
+  std::map<int32_t,interpreter_array_t>::iterator iter = arrays.find(ref);
+
+  if (iter == arrays.end()) { return NULL; }
+
+  return &iter->second;
+}
+
+int32_t Interpreter::get_string(int index)
+{
+  std::map<int,int32_t>::iterator iter = strings.find(index);
+  constant_string_t *constant_string;
+  constant_utf8_t *constant_utf8;
+  interpreter_array_t *array;
+  int32_t ref;
+  int n;
+
+  // Strings are char arrays, the same ldc always gives the same one.
+  if (iter != strings.end()) { return iter->second; }
+
+  constant_string = (constant_string_t *)java_class->get_constant(index);
+  constant_utf8 = (constant_utf8_t *)java_class->get_constant(constant_string->string_index);
+
+  if (constant_utf8 == NULL) { return 0; }
+
+  ref = new_array(ARRAY_TYPE_CHAR, constant_utf8->length);
+  array = get_array(ref);
+
+  for (n = 0; n < constant_utf8->length; n++)
+  {
+    array->data[n] = constant_utf8->bytes[n];
+  }
+
+  strings[index] = ref;
+
+  return ref;
+}
+
+int Interpreter::invoke_fixed(const char *name, int32_t *stack, int *sp)
+{
+  int64_t a, b;
+
+  if (*sp < 2)
+  {
+    printf("Error: Not enough arguments on the stack for Fixed.%s\n", name);
+    return -1;
+  }
+
+  b = stack[--(*sp)];
+  a = stack[--(*sp)];
+
+  if ((strcmp(name, "div8") == 0 || strcmp(name, "div16") == 0) && b == 0)
+  {
+    printf("Error: Fixed.%s: divide by zero\n", name);
+    return -1;
+  }
+
+  if (strcmp(name, "mul8") == 0) { a = (a * b) >> 8; }
+    else
+  if (strcmp(name, "div8") == 0) { a = (a * 256) / b; }
+    else
+  if (strcmp(name, "mul16") == 0) { a = (a * b) >> 16; }
+    else
+  if (strcmp(name, "div16") == 0) { a = (a * 65536) / b; }
+    else
+  {
+    printf("Error: Can't interpret call to Fixed.%s\n", name);
+    return -1;
+  }
+
+  stack[(*sp)++] = (int32_t)a;
+
+  return 0;
+}
+
+int Interpreter::invoke_static(int index, int32_t *stack, int *sp, int max_stack, int depth, bool has_this)
+{
+  const char *class_name = java_class->get_class_name(index);
+  const char *name = java_class->get_ref_name(index);
+  const char *descriptor = java_class->get_ref_type(index);
+  uint8_t types[256];
+  int32_t return_value[2];
+  int method_id;
+  int count;
+  int words;
+  int n;
+
+  if (class_name == NULL || name == NULL || descriptor == NULL)
+  {
+    printf("Error: Couldn't get name and type for method_id %d\n", index);
+    return -1;
+  }
+
+  // Fixed is only math so it can be run here.
+  if (strcmp(class_name, "net/mikekohn/java_grinder/Fixed") == 0)
+  {
+    return invoke_fixed(name, stack, sp);
+  }
+
+  // API classes become code for a particular chip so there is nothing
+  // to run on the host.
+  if (strcmp(class_name, java_class->class_name) != 0)
+  {
+    printf("Error: Can't interpret call to %s.%s%s\n", class_name, name, descriptor);
+    return -1;
+  }
+
+  method_id = java_class->get_method_index(name, descriptor);
+
+  if (method_id == -1)
+  {
+    printf("Error: Couldn't find method %s%s\n", name, descriptor);
+    return -1;
+  }
+
+  count = MethodIR::get_params(descriptor, types, sizeof(types));
+  words = has_this ? 1 : 0;
+
+  for (n = 0; n < count; n++)
+  {
+    if (types[n] != JAVA_TYPE_INTEGER && types[n] != JAVA_TYPE_REF &&
+        types[n] != JAVA_TYPE_LONG && types[n] != JAVA_TYPE_FLOAT)
+    {
+      printf("Error: Can't interpret call to %s%s (only int, long, float and reference parameters)\n", name, descriptor);
+      return -1;
+    }
+
+    words += types[n] == JAVA_TYPE_LONG ? 2 : 1;
+  }
+
+  if (*sp < words)
+  {
+    printf("Error: Not enough arguments on the stack for %s%s\n", name, descriptor);
+    return -1;
+  }
+
+  *sp -= words;
+
+  if (execute(method_id, stack + *sp, words, return_value, depth + 1) != 0)
+  {
+    return -1;
+  }
+
+  const char *return_type = strchr(descriptor, ')');
+
+  if (return_type != NULL && return_type[1] != 'V')
+  {
+    words = return_type[1] == 'J' ? 2 : 1;
+
+    if (*sp + words > max_stack)
+    {
+      printf("Error: No room on the stack for what %s returns\n", name);
+      return -1;
+    }
+
+    for (n = 0; n < words; n++) { stack[(*sp)++] = return_value[n]; }
+  }
+
+  return 0;
+}
+
+int Interpreter::invoke_special(int index, int32_t *stack, int *sp, int max_stack, int depth)
+{
+  const char *class_name = java_class->get_class_name(index);
+  const char *name = java_class->get_ref_name(index);
+
+  if (class_name == NULL || name == NULL)
+  {
+    printf("Error: Couldn't get name and type for method_id %d\n", index);
+    return -1;
+  }
+
+  if (strcmp(name, "<init>") != 0)
+  {
+    printf("Error: Can't interpret call to %s.%s (only constructors)\n", class_name, name);
+    return -1;
+  }
+
+  // Object() has nothing to do, new already cleared the fields.
+  if (strcmp(class_name, "java/lang/Object") == 0)
+  {
+    if (*sp < 1)
+    {
+      printf("Error: Not enough arguments on the stack for %s.%s\n", class_name, name);
+      return -1;
+    }
+
+    (*sp)--;
+    return 0;
+  }
+
+  return invoke_static(index, stack, sp, max_stack, depth, true);
+}
+
+int Interpreter::invoke_virtual(int index, int32_t *stack, int *sp, int max_stack)
+{
+  const char *class_name = java_class->get_class_name(index);
+  const char *name = java_class->get_ref_name(index);
+  const char *descriptor = java_class->get_ref_type(index);
+  interpreter_array_t *array;
+
+  if (class_name == NULL || name == NULL || descriptor == NULL)
+  {
+    printf("Error: Couldn't get name and type for method_id %d\n", index);
+    return -1;
+  }
+
+  // The only objects are Strings (which are char arrays).
+  if (strcmp(class_name, "java/lang/String") == 0)
+  {
+    if (strcmp(name, "length") == 0 && strcmp(descriptor, "()I") == 0)
+    {
+      if (*sp < 1) { return -1; }
+
+      array = get_array(stack[*sp - 1]);
+
+      if (array == NULL)
+      {
+        printf("Error: String.length() on a null String\n");
+        return -1;
+      }
+
+      stack[*sp - 1] = array->length;
+
+      return 0;
+    }
+      else
+    if (strcmp(name, "charAt") == 0 && strcmp(descriptor, "(I)C") == 0)
+    {
+      if (*sp < 2) { return -1; }
+
+      int32_t at = stack[--(*sp)];
+
+      array = get_array(stack[*sp - 1]);
+
+      if (array == NULL)
+      {
+        printf("Error: String.charAt() on a null String\n");
+        return -1;
+      }
+
+      if (at < 0 || at >= array->length)
+      {
+        printf("Error: String.charAt(%d) out of bounds (length %d)\n", at, array->length);
+        return -1;
+      }
+
+      stack[*sp - 1] = array->data[at];
+
+      return 0;
+    }
+  }
+
+  printf("Error: Can't interpret call to %s.%s%s\n", class_name, name, descriptor);
+
+  return -1;
+}
+
+int Interpreter::execute(int method_id, int32_t *args, int arg_count, int32_t *return_value, int depth)
+{
+  std::map<int,interpreter_method_t>::iterator iter;
+  struct methods_t *method = java_class->get_method(method_id);
+  interpreter_method_t *info;
+  interpreter_array_t *array;
+  MethodIR *ir;
+  ir_instr_t *instr;
+  char method_name[128];
+  uint8_t *bytes;
+  uint8_t *code;
+  int32_t *stack;
+  int32_t *locals;
+  int32_t a, b, c, d;
+  int64_t la, lb;
+  int32_t value;
+  int max_stack;
+  int max_locals;
+  int code_len;
+  int pc = 0;
+  int next;
+  int sp = 0;
+  int opcode;
+  int index;
+  int taken;
+  int n;
+
+  java_class->get_method_name(method_name, sizeof(method_name), method_id);
+
+  if (depth > INTERPRETER_MAX_DEPTH)
+  {
+    printf("Error: %s: calls nested more than %d deep\n", method_name, INTERPRETER_MAX_DEPTH);
+    return -1;
+  }
+
+  if (method->attribute_count == 0)
+  {
+    printf("Error: %s has no code\n", method_name);
+    return -1;
+  }
+
+  iter = methods.find(method_id);
+
+  if (iter == methods.end())
+  {
+    if (prepare_method(method_id, &methods[method_id]) != 0) { return -1; }
+    iter = methods.find(method_id);
+  }
+
+  info = &iter->second;
+  ir = info->ir;
+
+  if (ir != NULL && !ir->has_stack_info()) { ir = NULL; }
+
+  // Same layout as the Code attribute: max_stack, max_locals, code_len.
+  bytes = info->code != NULL ? info->code : method->attributes[0].info;
+  max_stack = ((int)bytes[0] << 8) | ((int)bytes[1]);
+  max_locals = ((int)bytes[2] << 8) | ((int)bytes[3]);
+  code_len = ((int)bytes[4] << 24) | ((int)bytes[5] << 16) |
+             ((int)bytes[6] << 8) | ((int)bytes[7]);
+  code = bytes + ((((int)bytes[code_len + 8] << 8) | ((int)bytes[code_len + 9])) + 8);
+
+  if (arg_count > max_locals)
+  {
+    printf("Error: %s: %d arguments but only %d locals\n", method_name, arg_count, max_locals);
+    return -1;
+  }
+
+  stack = (int32_t *)alloca((max_stack + 1) * sizeof(int32_t));
+  locals = (int32_t *)alloca((max_locals + 1) * sizeof(int32_t));
+
+  memset(locals, 0, (max_locals + 1) * sizeof(int32_t));
+  for (n = 0; n < arg_count; n++) { locals[n] = args[n]; }
+
+  DEBUG_PRINT("--- Interpreting %s\n", method_name);
+
+  while(1)
+  {
+    if (pc < 0 || pc >= code_len)
+    {
+      printf("Error: %s pc=%d: outside of the method\n", method_name, pc);
+      return -1;
+    }
+
+    if (++steps > INTERPRETER_MAX_STEPS)
+    {
+      printf("Error: %s: stopped after %d bytecodes\n", method_name, INTERPRETER_MAX_STEPS);
+      return -1;
+    }
+
+    instr = NULL;
+
+    if (ir != NULL)
+    {
+      index = ir->find_instr(pc);
+
+      if (index == -1)
+      {
+        printf("Error: %s pc=%d: not the start of an instruction\n", method_name, pc);
+        return -1;
+      }
+
+      instr = ir->get_instr(index);
+
+      // A goto to the next instruction is dead too, but it's in a block
+      // that runs.
+      if ((instr->flags & IR_FLAG_DEAD) != 0 &&
+          (ir->get_block(instr->block)->flags & IR_BLOCK_EXECUTABLE) == 0)
+      {
+        printf("Error: %s pc=%d: reached code the optimizer removed\n", method_name, pc);
+        return -1;
+      }
+    }
+
+    opcode = code[pc];
+    next = pc + table_java_instr[opcode].normal;
+    taken = -1;
+
+    DEBUG_PRINT("  pc=%d %s sp=%d\n", pc, table_java_instr[opcode].name, sp);
+
+    switch(opcode)
+    {
+      case 0x00: // nop
+        break;
+      case 0x01: // aconst_null
+        PUSH(0);
+        break;
+      case 0x02: // iconst_m1
+      case 0x03: // iconst_0
+      case 0x04: // iconst_1
+      case 0x05: // iconst_2
+      case 0x06: // iconst_3
+      case 0x07: // iconst_4
+      case 0x08: // iconst_5
+        PUSH(opcode - 0x03);
+        break;
+      case 0x09: // lconst_0
+      case 0x0a: // lconst_1
+        PUSH_LONG(opcode - 0x09);
+        break;
+      case 0x0b: // fconst_0
+      case 0x0c: // fconst_1
+      case 0x0d: // fconst_2
+        PUSH(put_float((float)(opcode - 0x0b)));
+        break;
+      case 0x10: // bipush
+        PUSH((int8_t)code[pc + 1]);
+        break;
+      case 0x11: // sipush
+        PUSH(GET_INT16(pc + 1));
+        break;
+      case 0x12: // ldc
+      case 0x13: // ldc_w
+      {
+        index = opcode == 0x12 ? code[pc + 1] : GET_UINT16(pc + 1);
+        generic_32bit_t *gen32 = (generic_32bit_t *)java_class->get_constant(index);
+
+        if (gen32 != NULL &&
+           (gen32->tag == CONSTANT_INTEGER || gen32->tag == CONSTANT_FLOAT))
+        {
+          PUSH(gen32->value);
+        }
+          else
+        if (gen32 != NULL && gen32->tag == CONSTANT_STRING)
+        {
+          PUSH(get_string(index));
+        }
+          else
+        {
+          printf("Error: %s pc=%d: can't ldc a %s\n", method_name, pc,
+            gen32 == NULL ? "(null)" : JavaClass::tag_as_string(gen32->tag));
+          return -1;
+        }
+
+        break;
+      }
+      case 0x14: // ldc2_w
+      {
+        index = GET_UINT16(pc + 1);
+        generic_64bit_t *gen64 = (generic_64bit_t *)java_class->get_constant(index);
+
+        if (gen64 == NULL || gen64->tag != CONSTANT_LONG)
+        {
+          printf("Error: %s pc=%d: can't ldc2_w a %s\n", method_name, pc,
+            gen64 == NULL ? "(null)" : JavaClass::tag_as_string(gen64->tag));
+          return -1;
+        }
+
+        PUSH_LONG(gen64->value);
+        break;
+      }
+      case 0x15: // iload
+      case 0x17: // fload
+      case 0x19: // aload
+        index = code[pc + 1];
+        CHECK_LOCAL(index);
+        PUSH(locals[index]);
+        break;
+      case 0x16: // lload
+        index = code[pc + 1];
+        CHECK_LOCAL(index + 1);
+        PUSH(locals[index]);
+        PUSH(locals[index + 1]);
+        break;
+      case 0x1a: // iload_0
+      case 0x1b: // iload_1
+      case 0x1c: // iload_2
+      case 0x1d: // iload_3
+        index = opcode - 0x1a;
+        CHECK_LOCAL(index);
+        PUSH(locals[index]);
+        break;
+      case 0x1e: // lload_0
+      case 0x1f: // lload_1
+      case 0x20: // lload_2
+      case 0x21: // lload_3
+        index = opcode - 0x1e;
+        CHECK_LOCAL(index + 1);
+        PUSH(locals[index]);
+        PUSH(locals[index + 1]);
+        break;
+      case 0x22: // fload_0
+      case 0x23: // fload_1
+      case 0x24: // fload_2
+      case 0x25: // fload_3
+        index = opcode - 0x22;
+        CHECK_LOCAL(index);
+        PUSH(locals[index]);
+        break;
+      case 0x2a: // aload_0
+      case 0x2b: // aload_1
+      case 0x2c: // aload_2
+      case 0x2d: // aload_3
+        index = opcode - 0x2a;
+        CHECK_LOCAL(index);
+        PUSH(locals[index]);
+        break;
+      case 0x2e: // iaload
+      case 0x30: // faload
+      case 0x32: // aaload
+      case 0x33: // baload
+      case 0x34: // caload
+      case 0x35: // saload
+        POP(index);
+        POP(a);
+        GET_ARRAY(array, a);
+        CHECK_BOUNDS(array, index);
+        PUSH(array->data[index]);
+        break;
+      case 0x36: // istore
+      case 0x38: // fstore
+      case 0x3a: // astore
+        index = code[pc + 1];
+        CHECK_LOCAL(index);
+        POP(locals[index]);
+        break;
+      case 0x37: // lstore
+        index = code[pc + 1];
+        CHECK_LOCAL(index + 1);
+        POP(locals[index + 1]);
+        POP(locals[index]);
+        break;
+      case 0x3b: // istore_0
+      case 0x3c: // istore_1
+      case 0x3d: // istore_2
+      case 0x3e: // istore_3
+        index = opcode - 0x3b;
+        CHECK_LOCAL(index);
+        POP(locals[index]);
+        break;
+      case 0x3f: // lstore_0
+      case 0x40: // lstore_1
+      case 0x41: // lstore_2
+      case 0x42: // lstore_3
+        index = opcode - 0x3f;
+        CHECK_LOCAL(index + 1);
+        POP(locals[index + 1]);
+        POP(locals[index]);
+        break;
+      case 0x43: // fstore_0
+      case 0x44: // fstore_1
+      case 0x45: // fstore_2
+      case 0x46: // fstore_3
+        index = opcode - 0x43;
+        CHECK_LOCAL(index);
+        POP(locals[index]);
+        break;
+      case 0x4b: // astore_0
+      case 0x4c: // astore_1
+      case 0x4d: // astore_2
+      case 0x4e: // astore_3
+        index = opcode - 0x4b;
+        CHECK_LOCAL(index);
+        POP(locals[index]);
+        break;
+      case 0x4f: // iastore
+      case 0x51: // fastore
+      case 0x53: // aastore
+      case 0x54: // bastore
+      case 0x55: // castore
+      case 0x56: // sastore
+        POP(value);
+        POP(index);
+        POP(a);
+        GET_ARRAY(array, a);
+        CHECK_BOUNDS(array, index);
+
+        if (opcode == 0x54)
+        {
+          if (array->type == ARRAY_TYPE_BOOLEAN) { value &= 1; }
+          else { value = (int8_t)value; }
+        }
+          else
+        if (opcode == 0x55) { value = (uint16_t)value; }
+          else
+        if (opcode == 0x56) { value = (int16_t)value; }
+
+        array->data[index] = value;
+        break;
+      case 0x57: // pop
+        POP(a);
+        break;
+      case 0x58: // pop2
+        POP(a);
+        POP(b);
+        break;
+      case 0x59: // dup
+        POP(a);
+        PUSH(a);
+        PUSH(a);
+        break;
+      case 0x5a: // dup_x1
+        POP(a);
+        POP(b);
+        PUSH(a);
+        PUSH(b);
+        PUSH(a);
+        break;
+      case 0x5b: // dup_x2
+        POP(a);
+        POP(b);
+        POP(c);
+        PUSH(a);
+        PUSH(c);
+        PUSH(b);
+        PUSH(a);
+        break;
+      case 0x5c: // dup2
+        POP(a);
+        POP(b);
+        PUSH(b);
+        PUSH(a);
+        PUSH(b);
+        PUSH(a);
+        break;
+      case 0x5d: // dup2_x1
+        POP(a);
+        POP(b);
+        POP(c);
+        PUSH(b);
+        PUSH(a);
+        PUSH(c);
+        PUSH(b);
+        PUSH(a);
+        break;
+      case 0x5e: // dup2_x2
+        POP(a);
+        POP(b);
+        POP(c);
+        POP(d);
+        PUSH(b);
+        PUSH(a);
+        PUSH(d);
+        PUSH(c);
+        PUSH(b);
+        PUSH(a);
+        break;
+      case 0x5f: // swap
+        POP(a);
+        POP(b);
+        PUSH(a);
+        PUSH(b);
+        break;
+      case 0x60: // iadd
+        POP(b);
+        POP(a);
+        PUSH((int32_t)((uint32_t)a + (uint32_t)b));
+        break;
+      case 0x61: // ladd
+        POP_LONG(lb);
+        POP_LONG(la);
+        la = (int64_t)((uint64_t)la + (uint64_t)lb);
+        PUSH_LONG(la);
+        break;
+      case 0x62: // fadd
+        POP(b);
+        POP(a);
+        PUSH(put_float(get_float(a) + get_float(b)));
+        break;
+      case 0x64: // isub
+        POP(b);
+        POP(a);
+        PUSH((int32_t)((uint32_t)a - (uint32_t)b));
+        break;
+      case 0x65: // lsub
+        POP_LONG(lb);
+        POP_LONG(la);
+        la = (int64_t)((uint64_t)la - (uint64_t)lb);
+        PUSH_LONG(la);
+        break;
+      case 0x66: // fsub
+        POP(b);
+        POP(a);
+        PUSH(put_float(get_float(a) - get_float(b)));
+        break;
+      case 0x68: // imul
+        POP(b);
+        POP(a);
+        PUSH((int32_t)((uint32_t)a * (uint32_t)b));
+        break;
+      case 0x69: // lmul
+        POP_LONG(lb);
+        POP_LONG(la);
+        la = (int64_t)((uint64_t)la * (uint64_t)lb);
+        PUSH_LONG(la);
+        break;
+      case 0x6a: // fmul
+        POP(b);
+        POP(a);
+        PUSH(put_float(get_float(a) * get_float(b)));
+        break;
+      case 0x6c: // idiv
+      case 0x70: // irem
+        POP(b);
+        POP(a);
+
+        if (b == 0)
+        {
+          printf("Error: %s pc=%d: divide by zero\n", method_name, pc);
+          return -1;
+        }
+
+        // -2147483648 / -1 overflows back to -2147483648 in Java.
+        if (b == -1)
+        {
+          PUSH(opcode == 0x6c ? (int32_t)(0 - (uint32_t)a) : 0);
+        }
+          else
+        {
+          PUSH(opcode == 0x6c ? a / b : a % b);
+        }
+
+        break;
+      case 0x6d: // ldiv
+      case 0x71: // lrem
+        POP_LONG(lb);
+        POP_LONG(la);
+
+        if (lb == 0)
+        {
+          printf("Error: %s pc=%d: divide by zero\n", method_name, pc);
+          return -1;
+        }
+
+        if (lb == -1)
+        {
+          la = opcode == 0x6d ? (int64_t)(0 - (uint64_t)la) : 0;
+        }
+          else
+        {
+          la = opcode == 0x6d ? la / lb : la % lb;
+        }
+
+        PUSH_LONG(la);
+        break;
+      case 0x6e: // fdiv
+        POP(b);
+        POP(a);
+        PUSH(put_float(get_float(a) / get_float(b)));
+        break;
+      case 0x74: // ineg
+        POP(a);
+        PUSH((int32_t)(0 - (uint32_t)a));
+        break;
+      case 0x75: // lneg
+        POP_LONG(la);
+        la = (int64_t)(0 - (uint64_t)la);
+        PUSH_LONG(la);
+        break;
+      case 0x76: // fneg
+        POP(a);
+        PUSH((int32_t)((uint32_t)a ^ 0x80000000));
+        break;
+      case 0x78: // ishl
+        POP(b);
+        POP(a);
+        PUSH((int32_t)((uint32_t)a << (b & 31)));
+        break;
+      case 0x79: // lshl
+        POP(b);
+        POP_LONG(la);
+        la = (int64_t)((uint64_t)la << (b & 63));
+        PUSH_LONG(la);
+        break;
+      case 0x7a: // ishr
+        POP(b);
+        POP(a);
+        PUSH(a >> (b & 31));
+        break;
+      case 0x7b: // lshr
+        POP(b);
+        POP_LONG(la);
+        la = la >> (b & 63);
+        PUSH_LONG(la);
+        break;
+      case 0x7c: // iushr
+        POP(b);
+        POP(a);
+        PUSH((int32_t)((uint32_t)a >> (b & 31)));
+        break;
+      case 0x7d: // lushr
+        POP(b);
+        POP_LONG(la);
+        la = (int64_t)((uint64_t)la >> (b & 63));
+        PUSH_LONG(la);
+        break;
+      case 0x7e: // iand
+        POP(b);
+        POP(a);
+        PUSH(a & b);
+        break;
+      case 0x7f: // land
+        POP_LONG(lb);
+        POP_LONG(la);
+        PUSH_LONG(la & lb);
+        break;
+      case 0x80: // ior
+        POP(b);
+        POP(a);
+        PUSH(a | b);
+        break;
+      case 0x81: // lor
+        POP_LONG(lb);
+        POP_LONG(la);
+        PUSH_LONG(la | lb);
+        break;
+      case 0x82: // ixor
+        POP(b);
+        POP(a);
+        PUSH(a ^ b);
+        break;
+      case 0x83: // lxor
+        POP_LONG(lb);
+        POP_LONG(la);
+        PUSH_LONG(la ^ lb);
+        break;
+      case 0x84: // iinc
+        index = code[pc + 1];
+        CHECK_LOCAL(index);
+        locals[index] = (int32_t)((uint32_t)locals[index] + (int8_t)code[pc + 2]);
+        break;
+      case 0x85: // i2l
+        POP(a);
+        PUSH_LONG((int64_t)a);
+        break;
+      case 0x86: // i2f
+        POP(a);
+        PUSH(put_float((float)a));
+        break;
+      case 0x88: // l2i
+        POP_LONG(la);
+        PUSH((int32_t)(uint32_t)la);
+        break;
+      case 0x8b: // f2i
+        POP(a);
+        PUSH(float_to_int(get_float(a)));
+        break;
+      case 0x91: // i2b
+        POP(a);
+        PUSH((int8_t)a);
+        break;
+      case 0x92: // i2c
+        POP(a);
+        PUSH((uint16_t)a);
+        break;
+      case 0x93: // i2s
+        POP(a);
+        PUSH((int16_t)a);
+        break;
+      case 0x94: // lcmp
+        POP_LONG(lb);
+        POP_LONG(la);
+        PUSH(la < lb ? -1 : (la > lb ? 1 : 0));
+        break;
+      case 0x95: // fcmpl
+      case 0x96: // fcmpg
+      {
+        POP(b);
+        POP(a);
+        float fa = get_float(a);
+        float fb = get_float(b);
+
+        if (fa != fa || fb != fb) { PUSH(opcode == 0x95 ? -1 : 1); }
+        else { PUSH(fa < fb ? -1 : (fa > fb ? 1 : 0)); }
+
+        break;
+      }
+      case 0x99: // ifeq
+      case 0x9a: // ifne
+      case 0x9b: // iflt
+      case 0x9c: // ifge
+      case 0x9d: // ifgt
+      case 0x9e: // ifle
+        POP(a);
+        taken = compare(opcode - 0x99, a, 0);
+        break;
+      case 0x9f: // if_icmpeq
+      case 0xa0: // if_icmpne
+      case 0xa1: // if_icmplt
+      case 0xa2: // if_icmpge
+      case 0xa3: // if_icmpgt
+      case 0xa4: // if_icmple
+        POP(b);
+        POP(a);
+        taken = compare(opcode - 0x9f, a, b);
+        break;
+      case 0xa5: // if_acmpeq
+      case 0xa6: // if_acmpne
+        POP(b);
+        POP(a);
+        taken = compare(opcode - 0xa5, a, b);
+        break;
+      case 0xa7: // goto
+        next = pc + GET_INT16(pc + 1);
+        break;
+      case 0xaa: // tableswitch
+      {
+        int p = (pc + 4) & ~3;
+        int32_t low = GET_INT32(p + 4);
+        int32_t high = GET_INT32(p + 8);
+
+        POP(a);
+
+        if (a < low || a > high) { next = pc + GET_INT32(p); }
+        else { next = pc + GET_INT32(p + 12 + (a - low) * 4); }
+
+        break;
+      }
+      case 0xab: // lookupswitch
+      {
+        int p = (pc + 4) & ~3;
+        int32_t count = GET_INT32(p + 4);
+
+        POP(a);
+
+        next = pc + GET_INT32(p);
+
+        for (n = 0; n < count; n++)
+        {
+          if (GET_INT32(p + 8 + n * 8) == a)
+          {
+            next = pc + GET_INT32(p + 8 + n * 8 + 4);
+            break;
+          }
+        }
+
+        break;
+      }
+      case 0xac: // ireturn
+        POP(*return_value);
+        result = *return_value;
+        return 0;
+      case 0xad: // lreturn
+        POP(return_value[1]);
+        POP(return_value[0]);
+        result = return_value[0];
+        return 0;
+      case 0xae: // freturn
+      case 0xb0: // areturn
+        POP(*return_value);
+        return 0;
+      case 0xb1: // return
+        return 0;
+      case 0xb2: // getstatic
+      case 0xb3: // putstatic
+      {
+        index = GET_UINT16(pc + 1);
+        const char *class_name = java_class->get_class_name(index);
+        const char *name = java_class->get_ref_name(index);
+        const char *type = java_class->get_ref_type(index);
+
+        if (class_name == NULL || name == NULL || type == NULL)
+        {
+          printf("Error: %s pc=%d: couldn't get field %d\n", method_name, pc, index);
+          return -1;
+        }
+
+        if (strcmp(class_name, java_class->class_name) != 0 ||
+            strchr("ZBCSIF[L", type[0]) == NULL)
+        {
+          printf("Error: %s pc=%d: can't interpret %s.%s (%s)\n", method_name, pc, class_name, name, type);
+          return -1;
+        }
+
+        if (opcode == 0xb2)
+        {
+          std::map<std::string,int32_t>::iterator field = statics.find(name);
+
+          PUSH(field == statics.end() ? 0 : field->second);
+          break;
+        }
+
+        POP(value);
+
+        if (type[0] == 'Z') { value &= 1; }
+        else if (type[0] == 'B') { value = (int8_t)value; }
+        else if (type[0] == 'C') { value = (uint16_t)value; }
+        else if (type[0] == 'S') { value = (int16_t)value; }
+
+        statics[name] = value;
+        break;
+      }
+      case 0xb4: // getfield
+      case 0xb5: // putfield
+      {
+        index = GET_UINT16(pc + 1);
+        const char *class_name = java_class->get_class_name(index);
+        const char *name = java_class->get_ref_name(index);
+        const char *type = java_class->get_ref_type(index);
+
+        if (class_name == NULL || name == NULL || type == NULL)
+        {
+          printf("Error: %s pc=%d: couldn't get field %d\n", method_name, pc, index);
+          return -1;
+        }
+
+        if (strcmp(class_name, java_class->class_name) != 0 ||
+            strchr("ZBCSIF[L", type[0]) == NULL)
+        {
+          printf("Error: %s pc=%d: can't interpret %s.%s (%s)\n", method_name, pc, class_name, name, type);
+          return -1;
+        }
+
+        n = java_class->get_field_index(name);
+
+        if (n < 0)
+        {
+          printf("Error: %s pc=%d: couldn't find field %s\n", method_name, pc, name);
+          return -1;
+        }
+
+        if (opcode == 0xb4)
+        {
+          POP(a);
+          GET_OBJECT(array, a);
+          PUSH(array->data[n]);
+          break;
+        }
+
+        POP(value);
+        POP(a);
+        GET_OBJECT(array, a);
+
+        if (type[0] == 'Z') { value &= 1; }
+        else if (type[0] == 'B') { value = (int8_t)value; }
+        else if (type[0] == 'C') { value = (uint16_t)value; }
+        else if (type[0] == 'S') { value = (int16_t)value; }
+
+        array->data[n] = value;
+        break;
+      }
+      case 0xb6: // invokevirtual
+        if (invoke_virtual(GET_UINT16(pc + 1), stack, &sp, max_stack) != 0)
+        {
+          printf("Error: %s pc=%d: call failed\n", method_name, pc);
+          return -1;
+        }
+        break;
+      case 0xb8: // invokestatic
+        if (invoke_static(GET_UINT16(pc + 1), stack, &sp, max_stack, depth) != 0)
+        {
+          printf("Error: %s pc=%d: call failed\n", method_name, pc);
+          return -1;
+        }
+        break;
+      case 0xb7: // invokespecial
+        if (invoke_special(GET_UINT16(pc + 1), stack, &sp, max_stack, depth) != 0)
+        {
+          printf("Error: %s pc=%d: call failed\n", method_name, pc);
+          return -1;
+        }
+        break;
+      case 0xbb: // new
+      {
+        index = GET_UINT16(pc + 1);
+        const char *class_name = java_class->get_class_name(index);
+
+        if (class_name == NULL || strcmp(class_name, java_class->class_name) != 0)
+        {
+          printf("Error: %s pc=%d: can only interpret new of %s\n", method_name, pc, java_class->class_name);
+          return -1;
+        }
+
+        PUSH(new_object());
+        break;
+      }
+      case 0xbc: // newarray
+      case 0xbd: // anewarray
+        POP(a);
+
+        if (a < 0)
+        {
+          printf("Error: %s pc=%d: negative array size %d\n", method_name, pc, a);
+          return -1;
+        }
+
+        if (opcode == 0xbd) { PUSH(new_array(0, a)); break; }
+
+        if (code[pc + 1] == ARRAY_TYPE_DOUBLE || code[pc + 1] == ARRAY_TYPE_LONG)
+        {
+          printf("Error: %s pc=%d: only int, float, short, char, byte and boolean arrays can be interpreted\n", method_name, pc);
+          return -1;
+        }
+
+        PUSH(new_array(code[pc + 1], a));
+        break;
+      case 0xbe: // arraylength
+        POP(a);
+        GET_ARRAY(array, a);
+        PUSH(array->length);
+        break;
+      case 0xc4: // wide
+        opcode = code[pc + 1];
+        index = GET_UINT16(pc + 2);
+        CHECK_LOCAL(index);
+        next = pc + 1 + table_java_instr[opcode].wide;
+
+        if (opcode == 0x15 || opcode == 0x17 || opcode == 0x19)
+        {
+          PUSH(locals[index]);
+        }
+          else
+        if (opcode == 0x36 || opcode == 0x38 || opcode == 0x3a)
+        {
+          POP(locals[index]);
+        }
+          else
+        if (opcode == 0x16)
+        {
+          CHECK_LOCAL(index + 1);
+          PUSH(locals[index]);
+          PUSH(locals[index + 1]);
+        }
+          else
+        if (opcode == 0x37)
+        {
+          CHECK_LOCAL(index + 1);
+          POP(locals[index + 1]);
+          POP(locals[index]);
+        }
+          else
+        if (opcode == 0x84)
+        {
+          locals[index] = (int32_t)((uint32_t)locals[index] + GET_INT16(pc + 4));
+        }
+          else
+        {
+          printf("Error: %s pc=%d: wide %s isn't supported by the interpreter\n", method_name, pc, table_java_instr[opcode].name);
+          return -1;
+        }
+
+        break;
+      case 0xc6: // ifnull
+      case 0xc7: // ifnonnull
+        POP(a);
+        taken = compare(opcode - 0xc6, a, 0);
+        break;
+      case 0xc8: // goto_w
+        next = pc + GET_INT32(pc + 1);
+        break;
+      default:
+        printf("Error: %s pc=%d: %s isn't supported by the interpreter\n", method_name, pc, table_java_instr[opcode].name);
+        return -1;
+    }
+
+    if (taken == 1) { next = pc + GET_INT16(pc + 1); }
+
+    // Check what the optimizer worked out about this instruction.
+    if (instr != NULL && (instr->flags & IR_FLAG_FOLDED) != 0)
+    {
+      if (taken != -1)
+      {
+        if (taken != (instr->const_value != 0))
+        {
+          printf("Error: %s pc=%d: optimizer folded this branch to %s but it was %s\n",
+            method_name, pc,
+            instr->const_value != 0 ? "taken" : "not taken",
+            taken ? "taken" : "not taken");
+          return -1;
+        }
+      }
+        else
+      if (sp > 0 && stack[sp - 1] != instr->const_value)
+      {
+        printf("Error: %s pc=%d: optimizer folded this to %d but it computes %d\n",
+          method_name, pc, instr->const_value, stack[sp - 1]);
+        return -1;
+      }
+    }
+
+    pc = next;
+  }
+
+  return 0;
+}
+
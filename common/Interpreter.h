@@ -0,0 +1,92 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _INTERPRETER_H
+#define _INTERPRETER_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "JavaClass.h"
+#include "MethodIR.h"
+
+// Runs the int / long / float / array / object subset of bytecode the
+// compiler supports on the host so a program's answer can be checked
+// without a simulator.  With the optimizer on, each method runs as the
+// compiler would see it (after inlining and loop optimization) and every
+// constant the optimizer folded or block it removed is checked against
+// what really happens.
+
+#define INTERPRETER_MAX_STEPS 100000000
+#define INTERPRETER_MAX_DEPTH 1000
+#define INTERPRETER_OBJECT -1
+
+struct interpreter_array_t
+{
+  int32_t *data;
+  int length;
+  int type;          // ARRAY_TYPE_* or 0 for an array of references,
+                     // INTERPRETER_OBJECT for an object (a slot per field)
+};
+
+struct interpreter_method_t
+{
+  uint8_t *code;     // after inlining / loop optimization, or NULL
+  MethodIR *ir;      // what the optimizer decided, or NULL
+};
+
+class Interpreter
+{
+public:
+  Interpreter(JavaClass *java_class);
+  ~Interpreter();
+
+  void disable_optimizer() { optimize = false; }
+  void set_inline_size(int value) { inline_size = value; }
+  void set_verbose() { verbose = true; }
+  int run_static_initializers();
+  int run_main();
+  // Last int a method returned (what ends up in r15 / $v0 on the chips).
+  // For a long it's the low 32 bits.
+  int32_t get_result() { return result; }
+  long get_steps() { return steps; }
+
+private:
+  int prepare_method(int method_id, interpreter_method_t *info);
+  int execute(int method_id, int32_t *args, int arg_count, int32_t *return_value, int depth);
+  int invoke_static(int index, int32_t *stack, int *sp, int max_stack, int depth, bool has_this = false);
+  int invoke_special(int index, int32_t *stack, int *sp, int max_stack, int depth);
+  int invoke_fixed(const char *name, int32_t *stack, int *sp);
+  int invoke_virtual(int index, int32_t *stack, int *sp, int max_stack);
+  int32_t new_array(int type, int length);
+  int32_t new_object();
+  interpreter_array_t *get_array(int32_t ref);
+  int32_t get_string(int index);
+  void find_static_constants();
+
+  JavaClass *java_class;
+  std::map<std::string,int32_t> statics;
+  std::map<int32_t,interpreter_array_t> arrays;
+  std::map<int,int32_t> strings;
+  std::map<int,interpreter_method_t> methods;
+  std::map<std::string,int> static_constants;
+  int32_t array_count;
+  int32_t result;
+  long steps;
+  int inline_size;
+  bool optimize;
+  bool verbose;
+};
+
+#endif
+
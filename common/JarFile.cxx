@@ -0,0 +1,217 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JarFile.h"
+#include "fileio.h"
+#include "inflate.h"
+
+#define END_OF_DIRECTORY 0x06054b50
+#define DIRECTORY_HEADER 0x02014b50
+#define LOCAL_HEADER 0x04034b50
+
+#define METHOD_STORED 0
+#define METHOD_DEFLATE 8
+
+// Zip headers are little endian.
+static inline int get_uint16_le(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static inline uint32_t get_uint32_le(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+         ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+JarFile::JarFile() :
+  data(NULL),
+  length(0)
+{
+  filename[0] = 0;
+}
+
+JarFile::~JarFile()
+{
+  free(data);
+}
+
+int JarFile::open(const char *filename)
+{
+  FILE *in;
+
+  snprintf(this->filename, sizeof(this->filename), "%s", filename);
+
+  in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Cannot open '%s'\n", filename);
+    return -1;
+  }
+
+  data = read_file(in, &length);
+  fclose(in);
+
+  if (data == NULL)
+  {
+    printf("Error: Couldn't read '%s'\n", filename);
+    return -1;
+  }
+
+  return read_central_directory();
+}
+
+int JarFile::read_central_directory()
+{
+  int ptr, end;
+  int count;
+  int n;
+
+  // The end of central directory record is at the end of the file,
+  // followed only by a comment of up to 64k.
+  end = -1;
+
+  for (ptr = length - 22; ptr >= 0 && ptr >= length - 22 - 0xffff; ptr--)
+  {
+    if (get_uint32_le(data + ptr) == END_OF_DIRECTORY)
+    {
+      end = ptr;
+      break;
+    }
+  }
+
+  if (end == -1)
+  {
+    printf("Error: '%s' isn't a jar / zip file.\n", filename);
+    return -1;
+  }
+
+  count = get_uint16_le(data + end + 10);
+  ptr = get_uint32_le(data + end + 16);
+
+  for (n = 0; n < count; n++)
+  {
+    jar_entry_t entry;
+    char name[1024];
+    int name_length;
+
+    if (ptr < 0 || ptr + 46 > length ||
+        get_uint32_le(data + ptr) != DIRECTORY_HEADER)
+    {
+      printf("Error: '%s' has a bad central directory (zip64 isn't supported).\n", filename);
+      return -1;
+    }
+
+    entry.method = get_uint16_le(data + ptr + 10);
+    entry.crc = get_uint32_le(data + ptr + 16);
+    entry.compressed_size = get_uint32_le(data + ptr + 20);
+    entry.uncompressed_size = get_uint32_le(data + ptr + 24);
+    entry.local_header = get_uint32_le(data + ptr + 42);
+    name_length = get_uint16_le(data + ptr + 28);
+
+    if (ptr + 46 + name_length > length) { return -1; }
+
+    if (name_length < (int)sizeof(name))
+    {
+      memcpy(name, data + ptr + 46, name_length);
+      name[name_length] = 0;
+
+      entries[name] = entry;
+    }
+
+    ptr += 46 + name_length +
+      get_uint16_le(data + ptr + 30) +
+      get_uint16_le(data + ptr + 32);
+  }
+
+  return 0;
+}
+
+bool JarFile::has_entry(const char *name)
+{
+  return entries.find(name) != entries.end();
+}
+
+uint8_t *JarFile::read_entry(const char *name, int *length)
+{
+  std::map<std::string,jar_entry_t>::iterator iter;
+  uint8_t *buffer;
+  int ptr;
+  int len;
+
+  iter = entries.find(name);
+
+  if (iter == entries.end()) { return NULL; }
+
+  jar_entry_t &entry = iter->second;
+
+  ptr = entry.local_header;
+
+  if (ptr < 0 || ptr + 30 > this->length ||
+      get_uint32_le(data + ptr) != LOCAL_HEADER)
+  {
+    printf("Error: '%s' has a bad header for %s\n", filename, name);
+    return NULL;
+  }
+
+  // The local header's name and extra field can differ from the ones
+  // in the central directory, but the sizes come from the directory.
+  ptr += 30 + get_uint16_le(data + ptr + 26) + get_uint16_le(data + ptr + 28);
+
+  if (entry.compressed_size < 0 || entry.uncompressed_size < 0 ||
+      ptr + entry.compressed_size > this->length)
+  {
+    printf("Error: '%s' is truncated at %s\n", filename, name);
+    return NULL;
+  }
+
+  // Padded like read_file() so the class parser can look a bit past
+  // the end without checking.
+  buffer = (uint8_t *)malloc(entry.uncompressed_size + 16);
+  memset(buffer + entry.uncompressed_size, 0, 16);
+
+  if (entry.method == METHOD_STORED &&
+      entry.compressed_size == entry.uncompressed_size)
+  {
+    memcpy(buffer, data + ptr, entry.uncompressed_size);
+    len = entry.uncompressed_size;
+  }
+    else
+  if (entry.method == METHOD_DEFLATE)
+  {
+    len = inflate(buffer, entry.uncompressed_size, data + ptr, entry.compressed_size);
+  }
+    else
+  {
+    printf("Error: %s in '%s' uses unsupported compression %d\n",
+      name, filename, entry.method);
+    free(buffer);
+    return NULL;
+  }
+
+  if (len != entry.uncompressed_size || crc32(buffer, len) != entry.crc)
+  {
+    printf("Error: %s in '%s' is corrupt\n", name, filename);
+    free(buffer);
+    return NULL;
+  }
+
+  *length = len;
+
+  return buffer;
+}
+
@@ -0,0 +1,51 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _JAR_FILE_H
+#define _JAR_FILE_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+struct jar_entry_t
+{
+  int method;
+  uint32_t crc;
+  int compressed_size;
+  int uncompressed_size;
+  int local_header;
+};
+
+// A .jar (zip) file.  Opening it only indexes the central directory,
+// an entry is decompressed when something asks for it.
+class JarFile
+{
+public:
+  JarFile();
+  ~JarFile();
+
+  int open(const char *filename);
+  bool has_entry(const char *name);
+  uint8_t *read_entry(const char *name, int *length);
+
+private:
+  int read_central_directory();
+
+  char filename[1024];
+  uint8_t *data;
+  int length;
+  std::map<std::string,jar_entry_t> entries;
+};
+
+#endif
+
@@ -20,6 +20,17 @@
 #include "fileio.h"
 #include "JavaClass.h"
 
+// The sizing passes below have to stop before running off the end of
+// the file since every offset after that comes from the file itself.
+static void check_length(int ptr, int length)
+{
+  if (ptr > length)
+  {
+    printf("Error: Class file is truncated.\n");
+    exit(1);
+  }
+}
+
 JavaClass::JavaClass(FILE *in, bool is_main_class) :
   constant_pool(NULL),
   interfaces(NULL),
@@ -30,63 +41,123 @@ JavaClass::JavaClass(FILE *in, bool is_main_class) :
   fields_heap(NULL),
   methods_heap(NULL),
   attributes_heap(NULL),
+  refs(NULL),
+  refs_heap(NULL),
   is_main_class(is_main_class)
 {
+  uint8_t *data;
+  int length;
+
+  // The whole class file is read in one go and parsed from memory.
+  data = read_file(in, &length);
+
+  if (data == NULL)
+  {
+    printf("Error: Couldn't read class file.\n");
+    exit(1);
+  }
+
+  parse(data, length);
+
+  free(data);
+}
+
+// The data is expected to be padded like read_file() does it.
+JavaClass::JavaClass(const uint8_t *data, int length, bool is_main_class) :
+  constant_pool(NULL),
+  interfaces(NULL),
+  fields(NULL),
+  methods(NULL),
+  attributes(NULL),
+  constants_heap(NULL),
+  fields_heap(NULL),
+  methods_heap(NULL),
+  attributes_heap(NULL),
+  refs(NULL),
+  refs_heap(NULL),
+  is_main_class(is_main_class)
+{
+  parse(data, length);
+}
+
+void JavaClass::parse(const uint8_t *data, int length)
+{
+  int ptr;
   int t;
 
-  //memset(java_class, 0, sizeof(struct java_class_t));
+  check_length(10, length);
+
+  magic = get_int32(data);
+  minor_version = get_int16(data + 4);
+  major_version = get_int16(data + 6);
 
-  magic = read_int32(in);
-  minor_version = read_int16(in);
-  major_version = read_int16(in);
+  constant_pool_count = get_int16(data + 8);
+  ptr = 10;
 
-  constant_pool_count = read_int16(in);
   if (constant_pool_count != 0)
   {
     constant_pool = (int *)malloc((constant_pool_count + 1) * sizeof(int));
     memset(constant_pool, 0, (constant_pool_count + 1) * sizeof(int));
-    read_constant_pool(in);
+    ptr = read_constant_pool(data, length, ptr);
   }
 
-  access_flags = read_int16(in);
-  this_class = read_int16(in);
-  super_class = read_int16(in);
-  interfaces_count = read_int16(in);
+  check_length(ptr + 8, length);
+
+  access_flags = get_int16(data + ptr);
+  this_class = get_int16(data + ptr + 2);
+  super_class = get_int16(data + ptr + 4);
+  interfaces_count = get_int16(data + ptr + 6);
+  ptr += 8;
+
+  check_length(ptr + (interfaces_count * 2) + 2, length);
 
   if (interfaces_count != 0)
   {
     interfaces = (uint16_t *)malloc(interfaces_count * sizeof(uint16_t));
     for (t = 0; t < interfaces_count; t++)
     {
-      interfaces[t] = read_int16(in);
+      interfaces[t] = get_int16(data + ptr);
+      ptr += 2;
     }
   }
 
-  fields_count = read_int16(in);
+  fields_count = get_int16(data + ptr);
+  ptr += 2;
+
   if (fields_count != 0)
   {
     fields = (int *)malloc(fields_count * sizeof(int));
     memset(fields, 0, fields_count * sizeof(int));
-    read_fields(in);
+    ptr = read_fields(data, length, ptr);
   }
 
-  methods_count = read_int16(in);
+  check_length(ptr + 2, length);
+
+  methods_count = get_int16(data + ptr);
+  ptr += 2;
+
   if (methods_count != 0)
   {
     methods = (int *)malloc(methods_count * sizeof(int));
     memset(methods, 0, methods_count * sizeof(int));
-    read_methods(in);
+    ptr = read_methods(data, length, ptr);
   }
 
-  attributes_count = read_int16(in);
+  check_length(ptr + 2, length);
+
+  attributes_count = get_int16(data + ptr);
+  ptr += 2;
+
   if (attributes_count != 0)
   {
     attributes = (int *)malloc(attributes_count * sizeof(int));
     memset(attributes, 0, attributes_count * sizeof(int));
-    read_attributes(in);
+    ptr = read_attributes(data, length, ptr);
   }
 
   get_class_name(class_name, sizeof(class_name), this_class);
+
+  build_indexes();
 }
 
 JavaClass::~JavaClass()
@@ -101,160 +172,247 @@ JavaClass::~JavaClass()
   if (fields_heap != NULL) { free(fields_heap); }
   if (methods_heap != NULL) { free(methods_heap); }
   if (attributes_heap != NULL) { free(attributes_heap); }
+
+  if (refs != NULL) { free(refs); }
+  if (refs_heap != NULL) { free(refs_heap); }
+}
+
+void JavaClass::build_indexes()
+{
+  char name[256];
+  char type[256];
+  int heap_size = 4096;
+  int heap_len = 0;
+  int index, tag, n;
+
+  // Everything compile_method() looks up by name is resolved once here.
+  // Field refs and method refs get their full label (with the class name
+  // for external classes) and descriptor stored in refs_heap.
+  refs = (ref_name_t *)malloc((constant_pool_count + 1) * sizeof(ref_name_t));
+  refs_heap = (char *)malloc(heap_size);
+
+  for (index = 0; index <= constant_pool_count; index++)
+  {
+    refs[index].name = -1;
+    refs[index].type = -1;
+  }
+
+  for (index = 1; index < constant_pool_count; index++)
+  {
+    tag = constants_heap[constant_pool[index]];
+
+    if (tag == CONSTANT_LONG || tag == CONSTANT_DOUBLE) { index++; continue; }
+
+    if (tag != CONSTANT_FIELDREF &&
+        tag != CONSTANT_METHODREF &&
+        tag != CONSTANT_NAMEANDTYPE)
+    {
+      continue;
+    }
+
+    if (resolve_ref_name_type(name, type, sizeof(name), index) != 0)
+    {
+      continue;
+    }
+
+    n = strlen(name) + strlen(type) + 2;
+
+    while (heap_len + n > heap_size)
+    {
+      heap_size *= 2;
+      refs_heap = (char *)realloc(refs_heap, heap_size);
+    }
+
+    refs[index].name = heap_len;
+    strcpy(refs_heap + heap_len, name);
+    heap_len += strlen(name) + 1;
+
+    refs[index].type = heap_len;
+    strcpy(refs_heap + heap_len, type);
+    heap_len += strlen(type) + 1;
+  }
+
+  for (index = 0; index < fields_count; index++)
+  {
+    struct fields_t *field = (struct fields_t *)(fields_heap + fields[index]);
+    const char *field_name = get_constant_name(field->name_index);
+
+    if (field_name == NULL) { continue; }
+
+    // emplace() keeps the first of any duplicates.
+    field_indexes.emplace(name_key_t { field_name, "" }, index);
+  }
+
+  for (index = 0; index < methods_count; index++)
+  {
+    struct methods_t *method = (struct methods_t *)(methods_heap + methods[index]);
+    const char *method_name = get_constant_name(method->name_index);
+    const char *descriptor = get_constant_name(method->descriptor_index);
+
+    if (method_name == NULL || descriptor == NULL) { continue; }
+
+    method_indexes.emplace(name_key_t { method_name, descriptor }, index);
+  }
 }
 
-void JavaClass::read_attributes(FILE *in)
+int JavaClass::read_attributes(const uint8_t *data, int length, int ptr)
 {
-  long marker;
+  int marker;
   int count;
   int len = 0;
   int l;
 
-  marker = ftell(in);
+  marker = ptr;
 
   for (count = 0; count < attributes_count; count++)
   {
-    //attributes[count] = ftell(in) - marker;
     attributes[count] = len;
-    fseek(in, 2, SEEK_CUR);
-    l=read_int32(in);
-    fseek(in, l, SEEK_CUR);
+    l = get_int32(data + ptr + 2);
+    if (l < 0) { l = length; }
+    ptr += 6 + l;
+    check_length(ptr, length);
     len += sizeof(struct attributes_t) + l;
   }
 
-  //len = ftell(in) - marker;
   attributes_heap = (uint8_t *)malloc(len);
-  fseek(in, marker, SEEK_SET);
+  ptr = marker;
 
   struct attributes_t *attribute;
   for (count = 0; count < attributes_count; count++)
   {
     attribute = (struct attributes_t *)(attributes_heap + attributes[count]);
-    attribute->name_index = read_int16(in);
-    attribute->length = read_int32(in);
-    if (fread(attribute->info, 1, attribute->length, in)) {}
+    attribute->name_index = get_int16(data + ptr);
+    attribute->length = get_int32(data + ptr + 2);
+    memcpy(attribute->info, data + ptr + 6, attribute->length);
+    ptr += 6 + attribute->length;
   }
+
+  return ptr;
 }
 
-void JavaClass::read_fields(FILE *in)
+int JavaClass::read_fields(const uint8_t *data, int length, int ptr)
 {
-  long marker;
+  int marker;
   int count;
   int len = 0;
   int n,l,r;
 
-  marker = ftell(in);
+  marker = ptr;
 
   for (count = 0; count < fields_count; count++)
   {
-    //fields[count] = ftell(in) - marker;
     fields[count] = len;
-    fseek(in, 6, SEEK_CUR);
-    n = read_int16(in);
+    n = get_int16(data + ptr + 6);
+    ptr += 8;
+    check_length(ptr, length);
     len += sizeof(struct fields_t);
     for (r = 0; r < n; r++)
     {
-      fseek(in, 2, SEEK_CUR);
-      l = read_int32(in);
+      l = get_int32(data + ptr + 2);
+      if (l < 0) { l = length; }
       len += sizeof(struct attributes_t) + l;
-      fseek(in, l, SEEK_CUR);
+      ptr += 6 + l;
+      check_length(ptr, length);
     }
   }
 
-  //len = ftell(in) - marker;
   fields_heap = (uint8_t *)malloc(len);
-  fseek(in, marker, SEEK_SET);
+  ptr = marker;
 
   struct attributes_t *attribute;
   struct fields_t *field;
   for (count = 0; count < fields_count; count++)
   {
     field = (struct fields_t *)(fields_heap + fields[count]);
-    field->access_flags = read_int16(in);
-    field->name_index = read_int16(in);
-    field->descriptor_index = read_int16(in);
-    field->attribute_count = read_int16(in);
+    field->access_flags = get_int16(data + ptr);
+    field->name_index = get_int16(data + ptr + 2);
+    field->descriptor_index = get_int16(data + ptr + 4);
+    field->attribute_count = get_int16(data + ptr + 6);
+    ptr += 8;
     n = sizeof(struct fields_t);
     for (r = 0; r < field->attribute_count; r++)
     {
       attribute = (struct attributes_t *)(fields_heap + fields[count]+n);
-      attribute->name_index = read_int16(in);
-      attribute->length = read_int32(in);
-      if (fread(attribute->info, 1, attribute->length, in)) {}
+      attribute->name_index = get_int16(data + ptr);
+      attribute->length = get_int32(data + ptr + 2);
+      memcpy(attribute->info, data + ptr + 6, attribute->length);
+      ptr += 6 + attribute->length;
       n = n + 6 + attribute->length;
     }
   }
+
+  return ptr;
 }
 
-void JavaClass::read_methods(FILE *in)
+int JavaClass::read_methods(const uint8_t *data, int length, int ptr)
 {
-  long marker;
+  int marker;
   int count;
   int len = 0;
   int n,l,r;
 
-  marker = ftell(in);
-  //int attribute_count = 0;
+  marker = ptr;
 
   // Compute how much memory to malloc()
   for (count = 0; count < methods_count; count++)
   {
-    //methods[count] = ftell(in) - marker;
     methods[count] = len;
-    fseek(in, 6, SEEK_CUR);   // sizeof struct methods_t
-    n = read_int16(in);       // attribute count
+    n = get_int16(data + ptr + 6);  // attribute count
+    ptr += 8;                       // sizeof struct methods_t
+    check_length(ptr, length);
     len += sizeof(struct methods_t);
     for (r = 0; r < n; r++)
     {
-      fseek(in, 2, SEEK_CUR); // attribute name
-      l = read_int32(in);     // attribute len
+      l = get_int32(data + ptr + 2); // attribute len
+      if (l < 0) { l = length; }
       len += sizeof(struct attributes_t) + l;
-      fseek(in, l, SEEK_CUR); // attribute data
-      //attribute_count++;
+      ptr += 6 + l;                  // attribute name, len and data
+      check_length(ptr, length);
     }
   }
 
-  //len = ftell(in) - marker;
-  //len += attribute_count * 2;
   methods_heap = (uint8_t *)malloc(len);
-  fseek(in, marker, SEEK_SET);
+  ptr = marker;
 
   struct attributes_t *attribute;
   struct methods_t *method;
   for (count = 0; count < methods_count; count++)
   {
     method = (struct methods_t *)(methods_heap + methods[count]);
-    method->access_flags = read_int16(in);
-    method->name_index = read_int16(in);
-    method->descriptor_index = read_int16(in);
-    method->attribute_count = read_int16(in);
+    method->access_flags = get_int16(data + ptr);
+    method->name_index = get_int16(data + ptr + 2);
+    method->descriptor_index = get_int16(data + ptr + 4);
+    method->attribute_count = get_int16(data + ptr + 6);
+    ptr += 8;
     n = sizeof(struct methods_t);
     for (r = 0; r < method->attribute_count; r++)
     {
       attribute = (struct attributes_t *)(methods_heap + methods[count] + n);
-      attribute->name_index = read_int16(in);
-      attribute->length = read_int32(in);
-      if (fread(attribute->info, 1, attribute->length, in)) {}
+      attribute->name_index = get_int16(data + ptr);
+      attribute->length = get_int32(data + ptr + 2);
+      memcpy(attribute->info, data + ptr + 6, attribute->length);
+      ptr += 6 + attribute->length;
       n = n + 6 + attribute->length;
     }
   }
+
+  return ptr;
 }
 
-void JavaClass::read_constant_pool(FILE *in)
+int JavaClass::read_constant_pool(const uint8_t *data, int length, int ptr)
 {
-  long marker;
+  int marker;
   int len,count;
   int ch;
 
-  // FIXME - Need to revisit this code.  There is a simpler way to do this.
-  marker = ftell(in);
+  marker = ptr;
   len = 0;
 
   for (count = 0; count < constant_pool_count - 1; count++)
   {
     constant_pool[count + 1] = len;
 
-    ch = getc(in);
+    ch = data[ptr++];
 
     switch(ch)
     {
@@ -262,33 +420,33 @@ void JavaClass::read_constant_pool(FILE *in)
       case CONSTANT_METHODREF:
       case CONSTANT_INTERFACEMETHODREF:
       case CONSTANT_NAMEANDTYPE:
-        fseek(in, 4, SEEK_CUR);
+        ptr += 4;
         len += sizeof(struct generic_twoint16_t);
         break;
 
       case CONSTANT_INTEGER:
       case CONSTANT_FLOAT:
-        fseek(in, 4, SEEK_CUR);
+        ptr += 4;
         len += sizeof(struct generic_32bit_t);
         break;
 
       case CONSTANT_CLASS:
       case CONSTANT_STRING:
-        fseek(in, 2, SEEK_CUR);
+        ptr += 2;
         len += sizeof(struct constant_class_t);
         break;
 
       case CONSTANT_LONG:
       case CONSTANT_DOUBLE:
-        fseek(in, 8, SEEK_CUR);
+        ptr += 8;
         len += sizeof(struct constant_double_t);
         count++;
         break;
 
       case CONSTANT_UTF8:
-        ch = read_int16(in);
-        fseek(in, ch, SEEK_CUR);
-        len += sizeof(struct constant_utf8_t) + ch;
+        ch = (uint16_t)get_int16(data + ptr);
+        ptr += 2 + ch;
+        len += sizeof(struct constant_utf8_t) + ch + 1;
         break;
 
       default:
@@ -296,10 +454,12 @@ void JavaClass::read_constant_pool(FILE *in)
         exit(1);
         break;
     }
+
+    check_length(ptr, length);
   }
 
   constants_heap = (uint8_t *)malloc(len);
-  fseek(in, marker, SEEK_SET);
+  ptr = marker;
 
   void *constant;
   struct generic_twoint16_t *gen2int;
@@ -312,7 +472,7 @@ void JavaClass::read_constant_pool(FILE *in)
   {
     constant = constants_heap + constant_pool[count + 1];
 
-    ch = getc(in);
+    ch = data[ptr++];
 
     switch(ch)
     {
@@ -322,37 +482,44 @@ void JavaClass::read_constant_pool(FILE *in)
       case CONSTANT_NAMEANDTYPE:
         gen2int = (struct generic_twoint16_t *)constant;
         gen2int->tag = ch;
-        gen2int->int1 = read_int16(in);
-        gen2int->int2 = read_int16(in);
+        gen2int->int1 = get_int16(data + ptr);
+        gen2int->int2 = get_int16(data + ptr + 2);
+        ptr += 4;
         break;
 
       case CONSTANT_INTEGER:
       case CONSTANT_FLOAT:
         gen32bit = (struct generic_32bit_t *)constant;
         gen32bit->tag = ch;
-        gen32bit->value = read_int32(in);
+        gen32bit->value = get_int32(data + ptr);
+        ptr += 4;
         break;
 
       case CONSTANT_CLASS:
       case CONSTANT_STRING:
         cls = (struct constant_class_t *)constant;
         cls->tag = ch;
-        cls->name_index = read_int16(in);
+        cls->name_index = get_int16(data + ptr);
+        ptr += 2;
         break;
 
       case CONSTANT_LONG:
       case CONSTANT_DOUBLE:
         gen64bit = (struct generic_64bit_t *)constant;
         gen64bit->tag = ch;
-        gen64bit->value = read_int64(in);
+        gen64bit->value = get_int64(data + ptr);
+        ptr += 8;
         count++;
         break;
 
       case CONSTANT_UTF8:
         utf8 = (struct constant_utf8_t *)constant;
         utf8->tag = ch;
-        utf8->length = read_int16(in);
-        if (fread(utf8->bytes, 1, utf8->length, in)) { }
+        utf8->length = get_int16(data + ptr);
+        memcpy(utf8->bytes, data + ptr + 2, (uint16_t)utf8->length);
+        // Keep a 0 after the bytes so names can be used in place.
+        utf8->bytes[(uint16_t)utf8->length] = 0;
+        ptr += 2 + (uint16_t)utf8->length;
         break;
 
       default:
@@ -360,6 +527,8 @@ void JavaClass::read_constant_pool(FILE *in)
         break;
     }
   }
+
+  return ptr;
 }
 
 /* In the movie the 6th Sense, the character Bruce Willis plays is
@@ -367,25 +536,33 @@ void JavaClass::read_constant_pool(FILE *in)
  * can see dead people.  That's what you get for reading my source
  * code!  :)  */
 
-int JavaClass::get_name_constant(char *name, int len, int index)
+const char *JavaClass::get_constant_name(int index)
 {
   struct constant_utf8_t *constant_utf8;
-  int tag,offset;
-  void *heap;
+  int offset;
 
-  name[0] = 0;
-  if (index > constant_pool_count) { return -1; }
+  if (index <= 0 || index >= constant_pool_count) { return NULL; }
 
   offset = constant_pool[index];
-  heap = (void *)(((uint8_t *)constants_heap) + offset);
-  tag = constants_heap[offset];
 
-  if (tag != CONSTANT_UTF8) { return -1; }
+  if (constants_heap[offset] != CONSTANT_UTF8) { return NULL; }
+
+  constant_utf8 = (constant_utf8_t *)(constants_heap + offset);
+
+  return (const char *)constant_utf8->bytes;
+}
+
+int JavaClass::get_name_constant(char *name, int len, int index)
+{
+  const char *s = get_constant_name(index);
+  int length;
+
+  name[0] = 0;
+  if (s == NULL) { return -1; }
 
-  constant_utf8 = (constant_utf8_t *)heap;
-  if (len < constant_utf8->length - 1) { return -1; }
-  memcpy(name, constant_utf8->bytes, constant_utf8->length);
-  name[constant_utf8->length] = 0;
+  length = strlen(s);
+  if (length >= len) { return -1; }
+  memcpy(name, s, length + 1);
 
   return 0;
 }
@@ -440,7 +617,127 @@ const fields_t *JavaClass::get_field(int index)
   return field;
 }
 
+int JavaClass::get_field_offset(const char *field_name, int alignment)
+{
+  return layout_fields(field_name, alignment);
+}
+
+int JavaClass::get_object_size(int alignment)
+{
+  return layout_fields(NULL, alignment);
+}
+
+static int get_field_size(char type)
+{
+  switch(type)
+  {
+    case 'B':
+    case 'Z':
+      return 1;
+    case 'C':
+    case 'S':
+      return 2;
+    case 'J':
+    case 'D':
+      return 8;
+    default:
+      return 4;
+  }
+}
+
+int JavaClass::layout_fields(const char *field_name, int alignment)
+{
+  struct fields_t *field;
+  char name[128];
+  char type[128];
+  int offset = 0;
+  int size;
+  int n;
+
+  if (super_class != 0 && strcmp(get_class_name(super_class), "java/lang/Object") != 0)
+  {
+    printf("Error: %s extends %s and fields from a super class aren't supported.\n", class_name, get_class_name(super_class));
+    return -1;
+  }
+
+  // The biggest fields go first so every field lands on a multiple of its
+  // own size without padding in between.
+  for (size = 8; size >= 1; size = size / 2)
+  {
+    for (n = 0; n < fields_count; n++)
+    {
+      field = (struct fields_t *)(fields_heap + fields[n]);
+
+      if ((field->access_flags & ACC_STATIC) != 0) { continue; }
+
+      get_field_type(type, sizeof(type), n);
+
+      if (get_field_size(type[0]) != size) { continue; }
+
+      get_field_name(name, sizeof(name), n);
+
+      if (size == 8)
+      {
+        printf("Error: Field %s.%s is a long or double which isn't supported.\n", class_name, name);
+        return -1;
+      }
+
+      if (field_name != NULL && strcmp(name, field_name) == 0)
+      {
+        return offset;
+      }
+
+      offset += size;
+    }
+  }
+
+  if (field_name != NULL)
+  {
+    printf("Error: Class %s has no field %s.\n", class_name, field_name);
+    return -1;
+  }
+
+  // Every object takes at least one word so two of them are never at the
+  // same address.
+  if (offset == 0) { offset = alignment; }
+
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+const char *JavaClass::get_ref_name(int index)
+{
+  if (index <= 0 || index >= constant_pool_count) { return NULL; }
+  if (refs[index].name < 0) { return NULL; }
+
+  return refs_heap + refs[index].name;
+}
+
+const char *JavaClass::get_ref_type(int index)
+{
+  if (index <= 0 || index >= constant_pool_count) { return NULL; }
+  if (refs[index].type < 0) { return NULL; }
+
+  return refs_heap + refs[index].type;
+}
+
 int JavaClass::get_ref_name_type(char *name, char *type, int len, int index)
+{
+  const char *ref_name = get_ref_name(index);
+  const char *ref_type = get_ref_type(index);
+
+  name[0] = 0;
+  type[0] = 0;
+
+  if (ref_name == NULL || ref_type == NULL) { return -1; }
+  if ((int)strlen(ref_name) >= len || (int)strlen(ref_type) >= len) { return -1; }
+
+  strcpy(name, ref_name);
+  strcpy(type, ref_type);
+
+  return 0;
+}
+
+int JavaClass::resolve_ref_name_type(char *name, char *type, int len, int index)
 {
   struct constant_fieldref_t *constant_fieldref;
   struct constant_methodref_t *constant_methodref;
@@ -518,9 +815,9 @@ int JavaClass::get_ref_name_type(char *name, char *type, int len, int index)
 
 bool JavaClass::is_ref_in_api(int index)
 {
-  char name[128];
+  const char *name = get_class_name(index);
 
-  if (get_class_name(name, sizeof(name), index) == -1) { return true; }
+  if (name == NULL) { return true; }
 
   if (strncmp(name, "java/", 5) == 0) { return true; }
   if (strncmp(name, "net/mikekohn/java_grinder/",
@@ -533,6 +830,19 @@ bool JavaClass::is_ref_in_api(int index)
 }
 
 int JavaClass::get_class_name(char *name, int len, int index)
+{
+  const char *s = get_class_name(index);
+
+  name[0] = 0;
+  if (s == NULL) { return -1; }
+  if ((int)strlen(s) >= len) { return -1; }
+
+  strcpy(name, s);
+
+  return 0;
+}
+
+const char *JavaClass::get_class_name(int index)
 {
   struct constant_fieldref_t *constant_fieldref;
   struct constant_methodref_t *constant_methodref;
@@ -540,11 +850,9 @@ int JavaClass::get_class_name(char *name, int len, int index)
   int tag,offset;
   void *heap;
 
-  name[0] = 0;
-
   while(1)
   {
-    if (index > constant_pool_count) { return -1; }
+    if (index <= 0 || index >= constant_pool_count) { return NULL; }
  
     offset = constant_pool[index];
     heap = (void *)(((uint8_t *)constants_heap) + offset);
@@ -565,8 +873,7 @@ int JavaClass::get_class_name(char *name, int len, int index)
     if (tag == CONSTANT_CLASS)
     {
       constant_class = (constant_class_t *)heap;
-      get_name_constant(name, len, constant_class->name_index);
-      return 0;
+      return get_constant_name(constant_class->name_index);
     }
       else
     {
@@ -574,72 +881,51 @@ int JavaClass::get_class_name(char *name, int len, int index)
     }
   }
 
-  return -1;
+  return NULL;
 }
 
-int JavaClass::get_field_index(const char *field_name)
+size_t name_key_hash_t::operator()(const name_key_t &key) const
 {
-  struct attributes_t *attribute;
-  struct fields_t *field;
-  int count,r,n;
-  char name[256];
+  // FNV-1a over the name and then the descriptor.
+  size_t hash = 2166136261u;
+  const char *s;
 
-  //printf("----- FieldCount: %d\n", fields_count);
+  for (s = key.name; *s != 0; s++) { hash = (hash ^ (uint8_t)*s) * 16777619u; }
+  for (s = key.descriptor; *s != 0; s++) { hash = (hash ^ (uint8_t)*s) * 16777619u; }
 
-  for (count = 0; count < fields_count; count++)
-  {
-    field = (struct fields_t *)(fields_heap + fields[count]);
-    get_name_constant(name, sizeof(name), field->name_index);
-    if (strcmp(field_name, name) == 0) { return count; }
-    //get_name_constant(desc, sizeof(desc), field->descriptor_index);
-    //printf("                ----- %d -----\n", count);
-    //printf("         access_flags: %d", field->access_flags);
-    //print_access(field->access_flags);
-    //printf("\n");
-    //printf("           name_index: %d (%s)\n", field->name_index, name);
-    //printf("     descriptor_index: %d (%s)\n", field->descriptor_index, desc);
-    //printf("      attribute_count: %d\n", field->attribute_count);
+  return hash;
+}
 
-    n = 8;
-    for (r = 0; r < field->attribute_count; r++)
-    {
-      attribute=(struct attributes_t *)(fields_heap + fields[count]+n);
-      //printf("                ----- attr %d -----\n", r);
-      get_name_constant(name, sizeof(name), attribute->name_index);
-      //printf("         name_index: %d (%s)\n", attribute->name_index, name);
-      //printf("             length: %d\n", attribute->length);
-      //printf("               info: { ");
-      //for (r=0; r<attribute->length; r++)
-      //{
-      //  printf("%02x ",attribute->info[r]);
-      //}
-      //printf("}\n");
+bool name_key_equal_t::operator()(const name_key_t &a, const name_key_t &b) const
+{
+  return strcmp(a.name, b.name) == 0 && strcmp(a.descriptor, b.descriptor) == 0;
+}
 
-      n=n+6+attribute->length;
-    }
-  }
+int JavaClass::get_field_index(const char *field_name)
+{
+  std::unordered_map<name_key_t,int,name_key_hash_t,name_key_equal_t>::iterator iter;
 
-  return -1;
+  iter = field_indexes.find(name_key_t { field_name, "" });
+
+  if (iter == field_indexes.end()) { return -1; }
+
+  return iter->second;
 }
 
-int JavaClass::get_clinit_method()
+int JavaClass::get_method_index(const char *method_name, const char *descriptor)
 {
-  int method_count = get_method_count();
-  char method_name[128];
-  int index;
+  std::unordered_map<name_key_t,int,name_key_hash_t,name_key_equal_t>::iterator iter;
 
-  for (index = 0; index < method_count; index++)
-  {
-    if (get_method_name(method_name, sizeof(method_name), index) == 0)
-    {
-      if (strcmp("<clinit>", method_name) == 0)
-      {
-        return index;
-      }
-    }
-  }
+  iter = method_indexes.find(name_key_t { method_name, descriptor });
 
-  return -1;
+  if (iter == method_indexes.end()) { return -1; }
+
+  return iter->second;
+}
+
+int JavaClass::get_clinit_method()
+{
+  return get_method_index("<clinit>", "()V");
 }
 
 const char *JavaClass::tag_as_string(int tag)
@@ -14,6 +14,8 @@
 
 #include <stdint.h>
 #include <map>
+#include <string>
+#include <unordered_map>
 
 // http://java.sun.com/docs/books/jvms/second_edition/html/ClassFile.doc.html
 // http://www.brics.dk/~mis/dOvs/jvmspec/ref-Java.html
@@ -164,6 +166,12 @@ struct fields_t
   struct attributes_t attributes[];
 };
 
+struct ref_name_t
+{
+  int name;
+  int type;
+};
+
 struct methods_t
 {
   int16_t access_flags;
@@ -173,26 +181,56 @@ struct methods_t
   struct attributes_t attributes[];
 };
 
+// Key of the field / method lookups.  The strings are the 0 terminated
+// names in the constant heap (or the caller's own for a lookup), so
+// neither building the index nor looking something up makes a copy.
+// Fields have an empty descriptor.
+struct name_key_t
+{
+  const char *name;
+  const char *descriptor;
+};
+
+struct name_key_hash_t
+{
+  size_t operator()(const name_key_t &key) const;
+};
+
+struct name_key_equal_t
+{
+  bool operator()(const name_key_t &a, const name_key_t &b) const;
+};
+
 class JavaClass
 {
 public:
   JavaClass(FILE *in, bool is_main_class=true);
+  JavaClass(const uint8_t *data, int length, bool is_main_class=true);
   ~JavaClass();
   void print();
   int get_name_constant(char *name, int len, int index);
+  const char *get_constant_name(int index);
   int get_method_name(char *name, int len, int index);
   int get_field_name(char *name, int len, int index);
   int get_field_type(char *name, int len, int index);
   const fields_t *get_field(int index);
+  // Byte offsets of the instance fields in an object and the object's
+  // size rounded up to alignment.  Static fields aren't part of it.
+  int get_field_offset(const char *field_name, int alignment);
+  int get_object_size(int alignment);
   int get_ref_name_type(char *name, char *type, int len, int index);
+  const char *get_ref_name(int index);
+  const char *get_ref_type(int index);
   bool is_ref_in_api(int index);
   int get_class_name(char *name, int len, int index);
+  const char *get_class_name(int index);
   void *get_constant(int index);
   struct methods_t *get_method(int index);
   int get_method_count() { return methods_count; }
   int get_field_count() { return fields_count; }
   int get_constant_count() { return constant_pool_count; }
   int get_field_index(const char *field_name);
+  int get_method_index(const char *method_name, const char *descriptor);
   int get_clinit_method();
   static const char *tag_as_string(int tag);
   bool use_full_method_name() { return is_main_class == false; }
@@ -206,14 +244,15 @@ public:
 
   char class_name[128];
 
-  // Keep track of constants that need to be defined.
-  std::map<int,int> needed_constants;
-
 private:
-  void read_attributes(FILE *in);
-  void read_fields(FILE *in);
-  void read_methods(FILE *in);
-  void read_constant_pool(FILE *in);
+  void parse(const uint8_t *data, int length);
+  int read_attributes(const uint8_t *data, int length, int ptr);
+  int read_fields(const uint8_t *data, int length, int ptr);
+  int read_methods(const uint8_t *data, int length, int ptr);
+  int read_constant_pool(const uint8_t *data, int length, int ptr);
+  void build_indexes();
+  int resolve_ref_name_type(char *name, char *type, int len, int index);
+  int layout_fields(const char *field_name, int alignment);
 #ifdef DEBUG
   void print_access(int a);
   void print_constant_pool();
@@ -242,6 +281,13 @@ private:
   uint8_t *methods_heap;
   uint8_t *attributes_heap;
 
+  // Resolved names of field / method refs (offsets into refs_heap) and
+  // name lookups, all built once when the class is loaded.
+  ref_name_t *refs;
+  char *refs_heap;
+  std::unordered_map<name_key_t,int,name_key_hash_t,name_key_equal_t> field_indexes;
+  std::unordered_map<name_key_t,int,name_key_hash_t,name_key_equal_t> method_indexes;
+
   bool is_main_class : 1;
 };
 
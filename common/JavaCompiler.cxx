@@ -12,14 +12,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <stdint.h>
 #include <assert.h>
+#include <sys/stat.h>
 
 #include "JavaClass.h"
 #include "JavaCompiler.h"
 #include "execute_static.h"
+#include "fileio.h"
+#include "inline_methods.h"
+#include "optimize_loops.h"
 #include "invoke_static.h"
 #include "invoke_virtual.h"
+#include "register_alloc.h"
 #include "table_java_instr.h"
 
 // http://docs.oracle.com/javase/specs/jvms/se7/html/jvms-6.html
@@ -28,18 +35,7 @@
 
 //#define CONST_STACK_SIZE 4
 
-static inline bool needs_label(uint8_t *label_map, int pc, int pc_start)
-{
-  int address = pc - pc_start;
-  if ((label_map[address / 8] & (1 << (address % 8))) != 0)
-  {
-    return true;
-  }
-
-  return false;
-}
-
-static int calc_distance(uint8_t *bytes, int pc, int pc_jump_to)
+static int calc_distance(uint8_t *bytes, int pc_start, int pc, int pc_jump_to)
 {
   int count = 0;
 
@@ -58,6 +54,25 @@ static int calc_distance(uint8_t *bytes, int pc, int pc_jump_to)
       pc += table_java_instr[bytes[pc]].wide;
     }
       else
+    if (bytes[pc] == 0xaa || bytes[pc] == 0xab)
+    {
+      // Switches are padded so the table is 4 byte aligned from the
+      // start of the method's code.
+      uint8_t *b = bytes + pc + 1 + (3 - ((pc - pc_start) & 3));
+      int32_t n;
+
+      if (bytes[pc] == 0xaa)
+      {
+        n = get_int32(b + 8) - get_int32(b + 4) + 1;
+        pc = (b - bytes) + 12 + (n * 4);
+      }
+        else
+      {
+        n = get_int32(b + 4);
+        pc = (b - bytes) + 8 + (n * 8);
+      }
+    }
+      else
     {
       pc += table_java_instr[bytes[pc]].normal;
     }
@@ -99,13 +114,21 @@ const char *JavaCompiler::type_table[] =
 };
 
 JavaCompiler::JavaCompiler() :
-  java_class(NULL)
+  java_class(NULL),
+  class_cache(NULL),
+  class_path(NULL),
+  stats(NULL),
+  did_call_graph(false),
+  in(NULL)
 {
   classpath[0] = 0;
 }
 
 JavaCompiler::~JavaCompiler()
 {
+  // Classes from a ClassCache belong to the cache.
+  if (class_cache != NULL) { return; }
+
   // Delete external classes
   std::map<std::string,JavaClass *>::iterator iter;
   for (iter = external_classes.begin(); iter != external_classes.end(); iter++)
@@ -115,7 +138,7 @@ JavaCompiler::~JavaCompiler()
   }
 
   delete java_class;
-  fclose(in);
+  if (in != NULL) { fclose(in); }
 }
 
 int JavaCompiler::find_external_fields(JavaClass *java_class, bool is_parent)
@@ -180,21 +203,69 @@ int JavaCompiler::find_external_fields(JavaClass *java_class, bool is_parent)
           strcat(filename, class_name);
           strcat(filename, ".class");
 
-          DEBUG_PRINT("find_external_fields: fopen('%s')\n", filename);
+          JavaClass *java_class_external;
+          struct stat statbuf;
+          char source[1200];
+
+          // A class next to the main class is used before anything
+          // from -cp.
+          if (class_path != NULL && stat(filename, &statbuf) != 0 &&
+              class_path->find(class_name, source, sizeof(source)) == 0)
+          {
+            DEBUG_PRINT("find_external_fields: '%s' from '%s'\n", class_name, source);
+
+            class_files[source] = 1;
+
+            if (class_cache != NULL)
+            {
+              java_class_external = class_cache->load(class_path, class_name);
+            }
+              else
+            {
+              java_class_external = class_path->load(class_name, false);
+            }
+
+            if (java_class_external == NULL)
+            {
+              printf("Cannot load %s from '%s'\n", class_name, source);
+              return -1;
+            }
+          }
+            else
+          if (class_cache != NULL)
+          {
+            DEBUG_PRINT("find_external_fields: fopen('%s')\n", filename);
 
-          FILE *in = fopen(filename, "rb");
+            class_files[filename] = 1;
+            java_class_external = class_cache->load(filename, false);
 
-          if (in == NULL)
+            if (java_class_external == NULL)
+            {
+              printf("Cannot open '%s'\n", filename);
+              return -1;
+            }
+          }
+            else
           {
-            printf("Cannot open '%s'\n", filename);
-            return -1;
+            DEBUG_PRINT("find_external_fields: fopen('%s')\n", filename);
+
+            class_files[filename] = 1;
+
+            FILE *in = fopen(filename, "rb");
+
+            if (in == NULL)
+            {
+              printf("Cannot open '%s'\n", filename);
+              return -1;
+            }
+
+            java_class_external = new JavaClass(in, false);
+
+            fclose(in);
           }
 
-          JavaClass *java_class_external = new JavaClass(in, false);
           external_classes[class_name] = java_class_external;
 
-          fclose(in);
-
           external_field_count += find_external_fields(java_class_external, false);
         }
       }
@@ -222,79 +293,17 @@ int JavaCompiler::find_external_fields(JavaClass *java_class, bool is_parent)
   return external_field_count;
 }
 
-void JavaCompiler::fill_label_map(uint8_t *label_map, int label_map_len, uint8_t *bytes, int code_len, int pc_start)
-{
-  int pc = pc_start;
-  int wide = 0;
-  int address;
-
-  memset(label_map, 0, label_map_len);
-
-  while(pc - pc_start < code_len)
-  {
-    int opcode = bytes[pc];
-
-    if (opcode == 0xc4) { wide = 1; pc++; continue; }
-
-    switch(opcode)
-    {
-        case 0x99:  // ifeq
-        case 0x9a:  // ifne
-        case 0x9b:  // iflt
-        case 0x9c:  // ifge
-        case 0x9d:  // ifgt
-        case 0x9e:  // ifle
-        case 0x9f:  // if_icmpeq
-        case 0xa0:  // if_icmpne
-        case 0xa1:  // if_icmplt
-        case 0xa2:  // if_icmpge
-        case 0xa3:  // if_icmpgt
-        case 0xa4:  // if_icmple
-        case 0xa5:  // if_acmpeq
-        case 0xa6:  // if_acmpne
-        case 0xa7:  // goto
-        case 0xa8:  // jsr
-        case 0xc6:  // ifnull
-        case 0xc7:  // ifnonnull
-        {
-          int16_t offset = GET_PC_INT16(1);
-          address = (pc + offset) - pc_start;
-          if (address < 0) { printf("Internal error: %s:%d\n", __FILE__, __LINE__); return; }
-          label_map[address / 8] |= 1 << (address % 8);
-          break;
-        }
-        case 0xc8:  // goto_w
-        case 0xc9:  // jsr_w
-        {
-          int32_t offset = GET_PC_INT32(1);
-          address = (pc + offset) - pc_start;
-          if (address < 0) { printf("Internal error: %s:%d\n", __FILE__, __LINE__); return; }
-          label_map[address / 8] |= 1 << (address % 8);
-          break;
-        }
-      default:
-        break;
-    }
-
-    if (wide == 1)
-    {
-      pc += table_java_instr[opcode].wide;
-      wide = 0;
-    }
-      else
-    {
-      pc += table_java_instr[opcode].normal;
-    }
-  }
-}
-
 // FIXME - Too many parameters :(.
-int JavaCompiler::optimize_const(JavaClass *java_class, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int const_val)
+int JavaCompiler::optimize_const(JavaClass *java_class, MethodIR *ir, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int const_val)
 {
+  int pc_start = pc - address;
   int const_vals[2];
 
   if (!optimize) { return 0; }
 
+  // The next instruction was already folded by constant propagation.
+  if (!ir->is_plain(address)) { return 0; }
+
   if (pc + table_java_instr[bytes[pc]].normal > pc_end)
   {
     return 0;
@@ -319,6 +328,18 @@ int JavaCompiler::optimize_const(JavaClass *java_class, char *method_name, uint8
     case 100: // isub (0x64)
       if (generator->sub_integer(const_val) != 0) { return 0; }
       return 1;
+    case 104: // imul (0x68)
+    {
+      // Multiplying by a power of 2 is a shift.
+      int shift;
+
+      if (const_val <= 0 || (const_val & (const_val - 1)) != 0) { break; }
+
+      for (shift = 0; (1 << shift) != const_val; shift++);
+
+      if (generator->shift_left_integer(shift) != 0) { return 0; }
+      return 1;
+    }
     case 120: // ishl (0x78)
       if (generator->shift_left_integer(const_val) != 0) { return 0; }
       return 1;
@@ -328,6 +349,15 @@ int JavaCompiler::optimize_const(JavaClass *java_class, char *method_name, uint8
     case 124: // iushr (0x7c)
       if (generator->shift_right_uinteger(const_val) != 0) { return 0; }
       return 1;
+    case 121: // lshl (0x79)
+      if (generator->shift_left_long(const_val) != 0) { return 0; }
+      return 1;
+    case 123: // lshr (0x7b)
+      if (generator->shift_right_long(const_val) != 0) { return 0; }
+      return 1;
+    case 125: // lushr (0x7d)
+      if (generator->shift_right_ulong(const_val) != 0) { return 0; }
+      return 1;
     case 126: // iand (0x7e)
       if (generator->and_integer(const_val) != 0) { return 0; }
       return 1;
@@ -356,7 +386,7 @@ int JavaCompiler::optimize_const(JavaClass *java_class, char *method_name, uint8
       int byte_count = GET_PC_INT16(1);
       int jump_to = address + byte_count;
       sprintf(label, "%s_%d", method_name, jump_to);
-      if (generator->jump_cond_integer(label, cond_table[bytes[pc]-159], const_val, calc_distance(bytes, pc, pc + byte_count)) == -1)
+      if (generator->jump_cond_integer(label, cond_table[bytes[pc]-159], const_val, calc_distance(bytes, pc_start, pc, pc + byte_count)) == -1)
       { return 0; }
       return 3;
     }
@@ -420,8 +450,9 @@ int JavaCompiler::optimize_const(JavaClass *java_class, char *method_name, uint8
   return 0;
 }
 
-int JavaCompiler::optimize_compare(JavaClass *java_class, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int index)
+int JavaCompiler::optimize_compare(JavaClass *java_class, MethodIR *ir, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int index)
 {
+  int pc_start = pc - address;
   int local_index = -1;
   bool check_for_compare = false;
   int skip_bytes = 0;
@@ -432,6 +463,7 @@ int JavaCompiler::optimize_compare(JavaClass *java_class, char *method_name, uin
   // and then doing a compare and then doing a jmp.  Might as well just jmp.
 
   if (!optimize) { return 0; }
+  if (!ir->is_plain(address)) { return 0; }
 
   if (pc + table_java_instr[bytes[pc]].normal > pc_end)
   {
@@ -485,7 +517,7 @@ int JavaCompiler::optimize_compare(JavaClass *java_class, char *method_name, uin
       int jump_to = address + byte_count;
       sprintf(label, "%s_%d", method_name, jump_to);
 
-      if (generator->jump_cond_zero(label, cond, calc_distance(bytes, pc, pc + byte_count)) != -1)
+      if (generator->jump_cond_zero(label, cond, calc_distance(bytes, pc_start, pc, pc + byte_count)) != -1)
       {
         return skip_bytes + 3;
       }
@@ -623,10 +655,535 @@ int JavaCompiler::push_ref(int index, _stack *stack)
   return ret;
 }
 
-int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const char *alt_name)
+const char *JavaCompiler::get_member_name(JavaClass *java_class, const char *class_name, const char *name)
+{
+  // Refs to other classes (or from classes that aren't the main class)
+  // have the class name in front.
+  if (java_class->use_full_method_name() ||
+      strcmp(class_name, java_class->class_name) != 0)
+  {
+    return name + strlen(class_name) + 1;
+  }
+
+  return name;
+}
+
+JavaClass *JavaCompiler::find_class(const char *class_name)
+{
+  std::map<std::string,JavaClass *>::iterator iter;
+
+  if (strcmp(class_name, java_class->class_name) == 0) { return java_class; }
+
+  iter = external_classes.find(class_name);
+
+  if (iter == external_classes.end())
+  {
+    printf("Error: Class %s isn't loaded.\n", class_name);
+    return NULL;
+  }
+
+  return iter->second;
+}
+
+int JavaCompiler::get_field_offset(JavaClass *java_class, int constant_id, char *type, int len)
+{
+  char class_name[128];
+  char field_name[128];
+
+  if (java_class->get_class_name(class_name, sizeof(class_name), constant_id) != 0 ||
+      java_class->get_ref_name_type(field_name, type, len, constant_id) != 0)
+  {
+    printf("Error retrieving field name const_index=%d\n", constant_id);
+    return -1;
+  }
+
+  JavaClass *object_class = find_class(class_name);
+
+  if (object_class == NULL) { return -1; }
+
+  return object_class->get_field_offset(get_member_name(java_class, class_name, field_name), generator->get_cpu_byte_alignment());
+}
+
+int JavaCompiler::get_field(JavaClass *java_class, int constant_id)
+{
+  char type[128];
+  int offset;
+
+  offset = get_field_offset(java_class, constant_id, type, sizeof(type));
+
+  if (offset < 0) { return -1; }
+
+  if (type[0] == 'F' && generator->get_float_size() != 1)
+  {
+    printf("Error: Float fields are not supported on this platform.\n");
+    return -1;
+  }
+
+  switch(type[0])
+  {
+    case 'B':
+    case 'Z':
+      return generator->get_field_byte(offset);
+    case 'S':
+      return generator->get_field_short(offset);
+    case 'C':
+      return generator->get_field_char(offset);
+    default:
+      return generator->get_field_int(offset);
+  }
+}
+
+int JavaCompiler::put_field(JavaClass *java_class, int constant_id)
+{
+  char type[128];
+  int offset;
+
+  offset = get_field_offset(java_class, constant_id, type, sizeof(type));
+
+  if (offset < 0) { return -1; }
+
+  if (type[0] == 'F' && generator->get_float_size() != 1)
+  {
+    printf("Error: Float fields are not supported on this platform.\n");
+    return -1;
+  }
+
+  switch(type[0])
+  {
+    case 'B':
+    case 'Z':
+      return generator->put_field_byte(offset);
+    case 'S':
+    case 'C':
+      return generator->put_field_short(offset);
+    default:
+      return generator->put_field_int(offset);
+  }
+}
+
+int JavaCompiler::new_object(JavaClass *java_class, int constant_id)
+{
+  char class_name[128];
+  int object_size;
+
+  java_class->get_class_name(class_name, sizeof(class_name), constant_id);
+
+  // API classes are made by the generator.
+  if (java_class->is_ref_in_api(constant_id))
+  {
+    return generator->new_object(class_name, 0);
+  }
+
+  JavaClass *object_class = find_class(class_name);
+
+  if (object_class == NULL) { return -1; }
+
+  object_size = object_class->get_object_size(generator->get_cpu_byte_alignment());
+
+  if (object_size < 0) { return -1; }
+
+  return generator->new_object(class_name, object_size);
+}
+
+int JavaCompiler::invoke_constructor(JavaClass *java_class, int constant_id)
+{
+  char class_name[128];
+  char method_name[128];
+  char method_sig[128];
+
+  if (java_class->get_class_name(class_name, sizeof(class_name), constant_id) != 0 ||
+      java_class->get_ref_name_type(method_name, method_sig, sizeof(method_name), constant_id) != 0)
+  {
+    printf("Error: Couldn't get name and type for method_id %d\n", constant_id);
+    return -1;
+  }
+
+  if (java_class->is_ref_in_api(constant_id))
+  {
+    // Memory from new_object() is already cleared.
+    if (strcmp(class_name, "java/lang/Object") == 0)
+    {
+      return generator->pop();
+    }
+
+    return invoke_virtual(java_class, constant_id, generator);
+  }
+
+  const char *name = get_member_name(java_class, class_name, method_name);
+
+  if (strcmp(name, "<init>") != 0)
+  {
+    printf("Error: Can't call %s.%s, only constructors of user classes.\n", class_name, name);
+    return -1;
+  }
+
+  JavaClass *object_class = find_class(class_name);
+
+  if (object_class == NULL) { return -1; }
+
+  // Constructors aren't compiled so the only one that can be called is
+  // the default one: aload_0, invokespecial Object.<init>(), return.
+  int method_id = object_class->get_method_index(name, method_sig);
+  struct methods_t *method = method_id < 0 ? NULL : object_class->get_method(method_id);
+  uint8_t *code = NULL;
+
+  if (method != NULL && method->attribute_count != 0)
+  {
+    code = method->attributes[0].info;
+
+    int code_len = ((int)code[4] << 24) | ((int)code[5] << 16) |
+                   ((int)code[6] << 8) | ((int)code[7]);
+
+    code = code + 8;
+
+    if (code_len != 5 || code[0] != 0x2a || code[1] != 0xb7 || code[4] != 0xb1 ||
+        strcmp(object_class->get_class_name((code[2] << 8) | code[3]), "java/lang/Object") != 0)
+    {
+      code = NULL;
+    }
+  }
+
+  if (code == NULL)
+  {
+    printf("Error: Constructor %s%s does more than call Object(), set the fields after new instead.\n", class_name, method_sig);
+    return -1;
+  }
+
+  return generator->pop();
+}
+
+int JavaCompiler::get_stack_entries(MethodIR *ir, int instr_index, int count)
+{
+  ir_instr_t *instr;
+  int entries = 0;
+  int n;
+
+  // How many entries the values a pop / dup takes up on the generator's
+  // stack.  Without the IR's types it's the same as the JVM (count).
+  if (instr_index == -1 || !ir->has_stack_info()) { return count; }
+
+  instr = ir->get_instr(instr_index);
+
+  for (n = 0; n < instr->arg_count; n++)
+  {
+    int type = ir->get_value(ir->get_arg(instr, n))->type;
+
+    if (type == JAVA_TYPE_LONG || type == JAVA_TYPE_DOUBLE)
+    {
+      entries += 2;
+    }
+      else
+    if (type == JAVA_TYPE_FLOAT)
+    {
+      entries += generator->get_float_size();
+    }
+      else
+    {
+      entries += 1;
+    }
+  }
+
+  return entries;
+}
+
+bool JavaCompiler::is_jump_table(MethodIR *ir, ir_instr_t *instr)
+{
+  int count = instr->switch_count;
+
+  if (count == 0) { return false; }
+
+  int64_t low = ir->get_switch_key(instr, 0);
+  int64_t span = (int64_t)ir->get_switch_key(instr, count - 1) - low + 1;
+
+  // A lookupswitch with most of the keys between its first and last
+  // can use a jump table too, the missing keys going to default.
+  if (instr->opcode != 0xaa && (count < 4 || span > count * 2)) { return false; }
+
+  return generator->has_jump_table(low, span);
+}
+
+int JavaCompiler::compile_switch(MethodIR *ir, ir_instr_t *instr, const char *method_name, int switch_local, int distance)
+{
+  switch_tree_t tree;
+  switch_run_t *runs;
+  int count = instr->switch_count;
+  int run_count = 0;
+  int n, ret;
+
+  tree.method_name = method_name;
+  tree.address = instr->address;
+  tree.local = switch_local;
+  tree.distance = distance;
+  tree.label_count = 0;
+  sprintf(tree.default_label, "%s_%d", method_name, instr->target);
+
+  if (is_jump_table(ir, instr))
+  {
+    int64_t low = ir->get_switch_key(instr, 0);
+    int64_t span = (int64_t)ir->get_switch_key(instr, count - 1) - low + 1;
+    int len = strlen(method_name) + 16;
+    char **labels = (char **)malloc(span * sizeof(char *));
+    char *names = (char *)malloc(span * len);
+
+    for (n = 0; n < span; n++)
+    {
+      labels[n] = names + (n * len);
+      strcpy(labels[n], tree.default_label);
+    }
+
+    for (n = 0; n < count; n++)
+    {
+      sprintf(labels[ir->get_switch_key(instr, n) - low], "%s_%d",
+              method_name, ir->get_switch_target(instr, n));
+    }
+
+    ret = generator->jump_table(tree.default_label, low, labels, span);
+
+    free(labels);
+    free(names);
+
+    return ret;
+  }
+
+  // No jump table so binary search the keys.  The key is kept in a local
+  // so every branch leaves the stack the way the case expects it.
+  if (generator->pop_local_var_int(switch_local) != 0) { return -1; }
+
+  runs = (switch_run_t *)malloc(count * sizeof(switch_run_t) + sizeof(switch_run_t));
+
+  for (n = 0; n < count; n++)
+  {
+    int32_t key = ir->get_switch_key(instr, n);
+    int target = ir->get_switch_target(instr, n);
+
+    // Keys that go to default don't need a compare.
+    if (target == instr->target) { continue; }
+
+    if (run_count > 0 && runs[run_count - 1].target == target &&
+        (int64_t)runs[run_count - 1].last + 1 == key)
+    {
+      runs[run_count - 1].last = key;
+      continue;
+    }
+
+    runs[run_count].first = key;
+    runs[run_count].last = key;
+    runs[run_count].target = target;
+    run_count++;
+  }
+
+  if (run_count == 0)
+  {
+    ret = generator->jump(tree.default_label, distance);
+  }
+    else
+  {
+    ret = switch_tree(&tree, runs, run_count, INT32_MIN, INT32_MAX);
+  }
+
+  free(runs);
+
+  return ret;
+}
+
+// Goes to the case for the key in runs[0] .. runs[count - 1] or to default.
+// Compares further up the tree already showed the key is min .. max.
+int JavaCompiler::switch_tree(switch_tree_t *tree, switch_run_t *runs, int count, int64_t min, int64_t max)
+{
+  char label[128];
+  int n;
+
+  if (count > 3)
+  {
+    int mid = (count - 1) / 2;
+
+    sprintf(label, "%s_%d_switch_%d", tree->method_name, tree->address, tree->label_count++);
+
+    if (switch_compare(tree, COND_GREATER, runs[mid].last, label) != 0) { return -1; }
+    if (switch_tree(tree, runs, mid + 1, min, runs[mid].last) != 0) { return -1; }
+
+    generator->label(label);
+
+    return switch_tree(tree, runs + mid + 1, count - mid - 1, (int64_t)runs[mid].last + 1, max);
+  }
+
+  // Few enough left to check one at a time, smallest key first.
+  for (n = 0; n < count; n++)
+  {
+    sprintf(label, "%s_%d", tree->method_name, runs[n].target);
+
+    if (runs[n].first <= min && runs[n].last >= max)
+    {
+      return generator->jump(label, tree->distance);
+    }
+
+    if (runs[n].first == runs[n].last)
+    {
+      if (switch_compare(tree, COND_EQUAL, runs[n].first, label) != 0) { return -1; }
+      if (runs[n].first == min) { min++; }
+      continue;
+    }
+
+    // Anything below this run isn't in the ones after it either.
+    if (runs[n].first > min)
+    {
+      if (switch_compare(tree, COND_LESS, runs[n].first, tree->default_label) != 0)
+      {
+        return -1;
+      }
+    }
+
+    if (runs[n].last >= max)
+    {
+      return generator->jump(label, tree->distance);
+    }
+
+    if (switch_compare(tree, COND_LESS_EQUAL, runs[n].last, label) != 0) { return -1; }
+
+    min = (int64_t)runs[n].last + 1;
+  }
+
+  return generator->jump(tree->default_label, tree->distance);
+}
+
+int JavaCompiler::switch_compare(switch_tree_t *tree, int cond, int32_t value, const char *label)
+{
+  if (generator->push_local_var_int(tree->local) != 0) { return -1; }
+
+  if (optimize &&
+      generator->jump_cond_integer(label, cond, value, tree->distance) != -1)
+  {
+    return 0;
+  }
+
+  if (generator->push_int(value) != 0) { return -1; }
+
+  return generator->jump_cond_integer(label, cond, tree->distance);
+}
+
+int JavaCompiler::prepare_method(method_plan_t *plan, int local_register_count)
+{
+  JavaClass *java_class = plan->java_class;
+  MethodIR &ir = plan->ir;
+  int method_id = plan->method_id;
+  int max_locals;
+  int index;
+
+  if (optimize && inline_size > 0)
+  {
+    inline_methods(java_class, method_id, inline_size, &plan->method_code, verbose);
+  }
+
+  if (optimize)
+  {
+    uint8_t *loop_code;
+
+    if (optimize_loops(java_class, method_id, plan->method_code, &loop_code, verbose) > 0)
+    {
+      free(plan->method_code);
+      plan->method_code = loop_code;
+    }
+  }
+
+  // Decode the bytecode into basic blocks with a typed operand stack.
+  // Labels and instruction lengths in compile_method() come from this.
+  if (ir.build(java_class, method_id, plan->method_code) != 0)
+  {
+    return -1;
+  }
+
+  if (optimize)
+  {
+    ir.propagate_constants(&static_constants);
+    ir.remove_dead_code();
+  }
+
+  // Backends with registers to spare keep the busiest locals in them.
+  max_locals = ir.get_max_locals();
+  plan->local_regs = (int *)malloc(max_locals * sizeof(int) + sizeof(int));
+
+  if (optimize)
+  {
+    allocate_local_registers(&ir, local_register_count, plan->local_regs);
+  }
+    else
+  {
+    for (index = 0; index < max_locals; index++) { plan->local_regs[index] = -1; }
+  }
+
+  return 0;
+}
+
+void *JavaCompiler::prepare_worker(void *context)
+{
+  prepare_job_t *job = (prepare_job_t *)context;
+  int n;
+
+  // Workers pull the next method to analyze until all are done.  Nothing
+  // here touches the generator so the order doesn't matter.
+  while(1)
+  {
+    n = __sync_fetch_and_add(&job->next, 1);
+
+    if (n >= job->count) { break; }
+
+    method_plan_t *plan = job->plans[n];
+
+    plan->ret = job->compiler->prepare_method(plan, job->local_register_count);
+  }
+
+  return NULL;
+}
+
+void JavaCompiler::prepare_methods(method_plan_t **plans, int count)
+{
+  prepare_job_t job;
+  pthread_t *threads;
+  int thread_count = threads_max;
+  int n;
+
+  if (thread_count <= 0) { thread_count = sysconf(_SC_NPROCESSORS_ONLN); }
+
+  job.compiler = this;
+  job.plans = plans;
+  job.count = count;
+  job.next = 0;
+  job.local_register_count = generator->get_local_register_count();
+
+  // Verbose output from the optimizer passes has to stay in order.
+  if (verbose) { thread_count = 1; }
+  if (thread_count > count) { thread_count = count; }
+
+  if (thread_count <= 1)
+  {
+    prepare_worker(&job);
+    return;
+  }
+
+  threads = (pthread_t *)alloca(thread_count * sizeof(pthread_t));
+
+  // This thread is one of the workers too, and also picks up the slack
+  // if a thread can't be created.
+  for (n = 0; n < thread_count - 1; n++)
+  {
+    if (pthread_create(&threads[n], NULL, prepare_worker, &job) != 0)
+    {
+      break;
+    }
+  }
+
+  prepare_worker(&job);
+
+  while(n-- > 0)
+  {
+    pthread_join(threads[n], NULL);
+  }
+}
+
+int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const char *alt_name, method_plan_t *plan)
 {
   struct methods_t *method = java_class->get_method(method_id);
-  uint8_t *bytes = method->attributes[0].info;
+  uint8_t *bytes;
   int pc;
   const float fzero = 0.0;
   const float fone = 1.0;
@@ -640,11 +1197,16 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
   uint32_t ref;
   struct generic_32bit_t *gen32;
   struct constant_float_t *constant_float;
-  uint8_t *label_map;
+  method_plan_t serial_plan(java_class, method_id);
+  method_stats_t *method_stats = NULL;
+  int spilled = 0;
+  int *local_regs;
+  uint8_t *local_types;
+  int switch_local = -1;
+  int entries;
   int ret = 0;
   char label[128];
   char method_name[64];
-  char class_name[256];
   _stack *stack;
   int const_val;
   int skip_bytes;
@@ -721,6 +1283,12 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         *s = 'a';
         s++;
       }
+        else
+      if (*s == 'J' || *s == 'D')
+      {
+        // Takes 2 locals.
+        param_count++;
+      }
 
       param_count++;
       s++;
@@ -738,25 +1306,76 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
     param_count = 1;
   }
 
+  // Methods compiled by compile_methods() were already analyzed in
+  // parallel, anything else is done here.
+  if (plan == NULL)
+  {
+    plan = &serial_plan;
+    plan->ret = prepare_method(plan, generator->get_local_register_count());
+  }
+
+  MethodIR &ir = plan->ir;
+
+  if (plan->ret != 0)
+  {
+    printf("** Error decoding method %s\n", method_name);
+    return -1;
+  }
+
+  if (verbose) { ir.print(method_name); }
+
   // bytes points to the method attributes info for the method.
-  max_stack = ((int)bytes[0]<<8) | ((int)bytes[1]);
-  max_locals = ((int)bytes[2]<<8) | ((int)bytes[3]);
-  code_len = ((int)bytes[4]<<24) |
-             ((int)bytes[5]<<16) |
-             ((int)bytes[6]<<8) |
-             ((int)bytes[7]);
-  pc_start = (((int)bytes[code_len+8]<<8) |
-             ((int)bytes[code_len+9])) + 8;
+  bytes = ir.get_bytes();
+  max_stack = ir.get_max_stack();
+  max_locals = ir.get_max_locals();
+  code_len = ir.get_code_len();
+  pc_start = ir.get_pc_start();
   pc = pc_start;
 
+  local_regs = plan->local_regs;
+
+  for (index = 0; index < max_locals; index++)
+  {
+    if (local_regs[index] == -1) { continue; }
+    DEBUG_PRINT("local_%d in register %d\n", index, local_regs[index]);
+  }
+
+  // A switch that can't use a jump table keeps the key in an extra local.
+  for (index = 0; index < ir.get_instr_count(); index++)
+  {
+    ir_instr_t *instr = ir.get_instr(index);
+
+    if ((instr->flags & IR_FLAG_SWITCH) != 0 && !ir.is_dead(index) &&
+        !is_jump_table(&ir, instr))
+    {
+      switch_local = max_locals;
+    }
+  }
+
+  if (switch_local != -1)
+  {
+    local_regs[switch_local] = -1;
+    max_locals++;
+  }
+
+  if (stats != NULL)
+  {
+    method_stats = stats->add_method(method_name, code_len, generator->get_output_offset());
+  }
+
+  local_types = (uint8_t *)alloca(max_locals);
+
+  for (index = 0; index < max_locals; index++)
+  {
+    local_types[index] = index == switch_local ? JAVA_TYPE_INTEGER : ir.get_local_type(index);
+  }
+
+  generator->set_local_registers(local_regs, max_locals);
+  generator->set_local_types(local_types, max_locals);
   generator->method_start(max_locals, max_stack, param_count, method_name);
   stack = (_stack *)alloca(max_stack * sizeof(uint32_t) + sizeof(uint32_t));
   stack->reset();
 
-  int label_map_len = (code_len / 8) + 1;
-  label_map = (uint8_t *)alloca(label_map_len);
-  fill_label_map(label_map, label_map_len, bytes, code_len, pc_start);
-
 #ifdef DEBUG
   DEBUG_PRINT("pc=%d\n", pc);
   DEBUG_PRINT("max_stack=%d\n", max_stack);
@@ -765,16 +1384,38 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 #endif
 
   generator->instruction_count_clear();
+  skip_bytes = 0;
 
   while(pc - pc_start < code_len)
   {
     int address = pc - pc_start;
+    int instr_index = ir.find_instr(address);
+
+    if (method_stats != NULL)
+    {
+      // The last instruction was combined with the ones after it.
+      if (skip_bytes > 0) { method_stats->peephole++; }
+
+      if (generator->get_spilled() > spilled)
+      {
+        method_stats->spills += generator->get_spilled() - spilled;
+      }
+
+      spilled = generator->get_spilled();
+    }
+
     skip_bytes = 0;
 #ifdef DEBUG
     DEBUG_PRINT("pc=%d %s opcode=%d (0x%02x)\n", address, table_java_instr[bytes[pc]].name, bytes[pc], bytes[pc]);
 #endif
-    //if ((label_map[address / 8] & (1 << (address % 8))) != 0)
-    if (needs_label(label_map, pc, pc_start))
+    // Unreachable code and jumps to the next instruction are not emitted.
+    if (instr_index != -1 && ir.is_dead(instr_index))
+    {
+      pc += ir.get_instr(instr_index)->length;
+      continue;
+    }
+
+    if (ir.needs_label(address))
     {
       sprintf(label, "%s_%d", method_name, address);
       generator->label(label);
@@ -785,6 +1426,56 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
     // possible to unpop the array pointer from the stack.
     generator->instruction_count_inc();
 
+    if (instr_index != -1)
+    {
+      ir_instr_t *instr = ir.get_instr(instr_index);
+
+      // Value was folded into the instruction that uses it.
+      if ((instr->flags & IR_FLAG_SUPPRESSED) != 0)
+      {
+        pc += instr->length;
+        continue;
+      }
+
+      if ((instr->flags & IR_FLAG_FOLDED) != 0)
+      {
+        int count = ir.get_unsuppressed_arg_count(instr);
+
+        while(count-- > 0 && ret == 0) { ret = generator->pop(); }
+
+        if ((instr->flags & IR_FLAG_BRANCH) != 0)
+        {
+          // Condition is known at compile time: either a goto or nothing.
+          if (ret == 0 && instr->const_value != 0)
+          {
+            sprintf(label, "%s_%d", method_name, instr->target);
+            ret = generator->jump(label, calc_distance(bytes, pc_start, pc, pc_start + instr->target));
+          }
+        }
+          else
+        if (ret == 0)
+        {
+          ret = optimize_const(java_class, &ir, method_name, bytes,
+                               pc + instr->length, pc_start + code_len,
+                               address + instr->length, instr->const_value);
+          if (ret == 0)
+          {
+            ret = generator->push_int(instr->const_value);
+          }
+            else
+          {
+            skip_bytes = ret;
+            ret = 0;
+          }
+        }
+
+        if (ret != 0) { break; }
+
+        pc += instr->length + skip_bytes;
+        continue;
+      }
+    }
+
     switch(bytes[pc])
     {
       case 0: // nop (0x00)
@@ -802,7 +1493,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 7: // iconst_4 (0x07)
       case 8: // iconst_5 (0x08)
         const_val = uint8_t(bytes[pc])-3;
-        ret = optimize_const(java_class, method_name, bytes, pc + 1,
+        ret = optimize_const(java_class, &ir, method_name, bytes, pc + 1,
                              pc_start + code_len, address + 1, const_val);
         if (ret == 0)
         {
@@ -842,7 +1533,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 16: // bipush (0x10)
         const_val = (int8_t)bytes[pc+1];
-        ret = optimize_const(java_class, method_name, bytes, pc + 2,
+        ret = optimize_const(java_class, &ir, method_name, bytes, pc + 2,
                              pc_start + code_len, address + 2, const_val);
         if (ret == 0)
         {
@@ -857,7 +1548,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 17: // sipush (0x11)
         const_val = (int16_t)((bytes[pc+1]<<8)|(bytes[pc+2]));
-        ret = optimize_const(java_class, method_name, bytes, pc + 3,
+        ret = optimize_const(java_class, &ir, method_name, bytes, pc + 3,
                              pc_start + code_len, address + 3, const_val);
         if (ret == 0)
         {
@@ -887,7 +1578,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         if (gen32->tag == CONSTANT_INTEGER)
         {
           const_val = gen32->value;
-          ret = optimize_const(java_class, method_name, bytes,
+          ret = optimize_const(java_class, &ir, method_name, bytes,
                                pc + instruction_length, pc_start + code_len,
                                address + instruction_length, const_val);
           if (ret == 0)
@@ -912,7 +1603,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
           constant_string_t *constant_string = (constant_string_t *)gen32;
 
           const_val = constant_string->string_index;
-          ret = optimize_const(java_class, method_name, bytes,
+          ret = optimize_const(java_class, &ir, method_name, bytes,
                                pc + instruction_length, pc_start + code_len,
                                address + instruction_length, const_val);
           if (ret == 0)
@@ -921,7 +1612,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
             char name[128];
             sprintf(name, "string_%d", const_val);
             ret = generator->push_ref_static(name, const_val);
-            java_class->needed_constants[const_val] = 1;
+            needed_constants[java_class][const_val] = 1;
           }
             else
           {
@@ -938,8 +1629,29 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 20: // ldc2_w (0x14)
-        UNIMPL()
+      {
+        generic_64bit_t *gen64;
+
+        index = GET_PC_UINT16(1);
+        gen64 = (generic_64bit_t *)java_class->get_constant(index);
+
+        if (gen64->tag == CONSTANT_LONG)
+        {
+          ret = generator->push_long(((constant_long_t *)gen64)->value);
+        }
+          else
+        if (gen64->tag == CONSTANT_DOUBLE)
+        {
+          ret = generator->push_double(((constant_double_t *)gen64)->value);
+        }
+          else
+        {
+          printf("Cannot ldc2_w this type %d=>'%s' pc=%d\n",
+             gen64->tag, JavaClass::tag_as_string(gen64->tag), pc);
+          ret = -1;
+        }
         break;
+      }
 
       case 21: // iload (0x15)
         if (wide == 1)
@@ -955,7 +1667,16 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 22: // lload (0x16)
-        UNIMPL()
+        if (wide == 1)
+        {
+          index = GET_PC_UINT16(1);
+        }
+          else
+        {
+          index = bytes[pc+1];
+        }
+
+        ret = generator->push_local_var_long(index);
         break;
 
       case 23: // fload (0x17)
@@ -1001,8 +1722,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 32: // lload_2 (0x20)
       case 33: // lload_3 (0x21)
         // push a local long variable on the stack
-        //ret = generator->push_long_local(bytes[pc]-30);
-        UNIMPL()
+        ret = generator->push_local_var_long(bytes[pc]-30);
         break;
 
       case 34: // fload_0 (0x22)
@@ -1089,7 +1809,16 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 55: // lstore (0x37)
-        UNIMPL()
+        if (wide == 1)
+        {
+          index = GET_PC_UINT16(1);
+        }
+          else
+        {
+          index = bytes[pc+1];
+        }
+
+        ret = generator->pop_local_var_long(index);
         break;
 
       case 56: // fstore (0x38)
@@ -1131,7 +1860,8 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         // Pop integer off stack and store in local variable
         ret = generator->pop_local_var_int(bytes[pc]-59);
 
-        if (optimize == 1 && !needs_label(label_map, pc+1, pc_start) &&
+        if (optimize == 1 && !ir.needs_label(address + 1) &&
+            ir.is_plain(address + 1) &&
             bytes[pc+1] == 26 + (bytes[pc]-59))
         {
           if (generator->push_fake() == 0)
@@ -1147,8 +1877,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 65: // lstore_2 (0x41)
       case 66: // lstore_3 (0x42)
         // Pop long off stack and store in local variable
-        //ret = generator->pop_long_local(bytes[pc]-63);
-        UNIMPL()
+        ret = generator->pop_local_var_long(bytes[pc]-63);
         break;
 
       case 67: // fstore_0 (0x43)
@@ -1239,18 +1968,23 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 87: // pop (0x57)
         // Pop off stack and discard
-        ret = generator->pop();
+        entries = get_stack_entries(&ir, instr_index, 1);
+        while(entries-- > 0 && ret == 0) { ret = generator->pop(); }
         break;
 
       case 88: // pop2 (0x58)
         // Pop 2 things off stack and discard
-        ret = generator->pop();
-        ret = generator->pop();
+        entries = get_stack_entries(&ir, instr_index, 2);
+        while(entries-- > 0 && ret == 0) { ret = generator->pop(); }
         break;
 
       case 89: // dup (0x59)
-        // Take top value on stack, and push it again
-        ret = generator->dup();
+        // Take top value on stack, and push it again.  A float that takes
+        // 2 entries is copied with dup2().
+        entries = get_stack_entries(&ir, instr_index, 1);
+        if (entries == 1) { ret = generator->dup(); }
+        else if (entries == 2) { ret = generator->dup2(); }
+        else { UNIMPL() }
         break;
 
       case 90: // dup_x1 (0x5a)
@@ -1264,7 +1998,8 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 92: // dup2 (0x5c)
         // Take the top 2 values on the stack and push them again
         // value1,value2 becomes: value1,value2,value1,value2
-        ret = generator->dup2();
+        if (get_stack_entries(&ir, instr_index, 2) == 2) { ret = generator->dup2(); }
+        else { UNIMPL() }
         break;
 
       case 93: // dup2_x1 (0x5d)
@@ -1287,8 +2022,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 97: // ladd (0x61)
         // Pop top two longs from stack, add them, push result
-        // ret = generator->add_longs();
-        UNIMPL()
+        ret = generator->add_long();
         break;
 
       case 98: // fadd (0x62)
@@ -1311,8 +2045,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 101: // lsub (0x65)
         // Pop top two longs from stack, subtract them, push result
         // *(stack-1) - *(stack-0)
-        // ret = generator->sub_longs();
-        UNIMPL()
+        ret = generator->sub_long();
         break;
 
       case 102: // fsub (0x66)
@@ -1334,8 +2067,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 105: // lmul (0x69)
         // Pop top two longs from stack, multiply them, push result
-        // ret = generator->mul_longs();
-        UNIMPL()
+        ret = generator->mul_long();
         break;
 
       case 106: // fmul (0x6a)
@@ -1355,7 +2087,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 109: // ldiv (0x6d)
-        UNIMPL()
+        ret = generator->div_long();
         break;
 
       case 110: // fdiv (0x6e)
@@ -1372,7 +2104,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 113: // lrem (0x71)
-        UNIMPL()
+        ret = generator->mod_long();
         break;
 
       case 114: // frem (0x72)
@@ -1390,7 +2122,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 117: // lneg (0x75)
         // negate the top long on the stack
-        UNIMPL()
+        ret = generator->neg_long();
         break;
 
       case 118: // fneg (0x76)
@@ -1410,7 +2142,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 121: // lshl (0x79)
         // Pop two long values from stack shift left and push result
         // *(stack-1) << *(stack-0)
-        UNIMPL()
+        ret = generator->shift_left_long();
         break;
 
       case 122: // ishr (0x7a)
@@ -1422,7 +2154,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 123: // lshr (0x7b)
         // Pop two long values from stack shift right and push result
         // *(stack-1) >> *(stack-0)
-        UNIMPL()
+        ret = generator->shift_right_long();
         break;
 
       case 124: // iushr (0x7c)
@@ -1434,7 +2166,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
       case 125: // lushr (0x7d)
         // Pop two unsigned long values from stack shift left and push result
         // *(stack-1) <<< *(stack-0)
-        UNIMPL()
+        ret = generator->shift_right_ulong();
         break;
 
       case 126: // iand (0x7e)
@@ -1444,7 +2176,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 127: // land (0x7f)
         // Pop top two longs from stack, and them, push result
-        UNIMPL()
+        ret = generator->and_long();
         break;
 
       case 128: // ior (0x80)
@@ -1454,7 +2186,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 129: // lor (0x81)
         // Pop top two longs from stack, or them, push result
-        UNIMPL()
+        ret = generator->or_long();
         break;
 
       case 130: // ixor (0x82)
@@ -1464,7 +2196,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 131: // lxor (0x83)
         // Pop top two longs from stack, xor them, push result
-        UNIMPL()
+        ret = generator->xor_long();
         break;
 
       case 132: // iinc (0x84)
@@ -1481,7 +2213,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
           instruction_length = table_java_instr[bytes[pc]].normal;
         }
 
-        skip_bytes = optimize_compare(java_class, method_name, bytes,
+        skip_bytes = optimize_compare(java_class, &ir, method_name, bytes,
                                       pc + instruction_length,
                                       pc_start + code_len,
                                       address + instruction_length, index);
@@ -1489,7 +2221,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 133: // i2l (0x85)
         // Pop top integer from stack and push as a long
-        UNIMPL()
+        ret = generator->integer_to_long();
         break;
 
       case 134: // i2f (0x86)
@@ -1504,7 +2236,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 136: // l2i (0x88)
         // Pop top long from stack and push as a integer
-        UNIMPL()
+        ret = generator->long_to_integer();
         break;
 
       case 137: // l2f (0x89)
@@ -1563,7 +2295,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 148: // lcmp (0x94)
-        UNIMPL()
+        ret = generator->compare_longs();
         break;
 
       case 149: // fcmpl (0x95)
@@ -1598,7 +2330,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         int byte_count = GET_PC_INT16(1);
         int jump_to = address + byte_count;
         sprintf(label, "%s_%d", method_name, jump_to);
-        ret = generator->jump_cond(label, cond_table[bytes[pc]-153], calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump_cond(label, cond_table[bytes[pc]-153], calc_distance(bytes, pc_start, pc, pc + byte_count));
         break;
       }
       case 159: // if_icmpeq (0x9f)
@@ -1620,7 +2352,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         int byte_count = GET_PC_INT16(1);
         int jump_to = address + byte_count;
         sprintf(label, "%s_%d", method_name, jump_to);
-        ret = generator->jump_cond_integer(label, cond_table[bytes[pc]-159], calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump_cond_integer(label, cond_table[bytes[pc]-159], calc_distance(bytes, pc_start, pc, pc + byte_count));
 
         break;
       }
@@ -1637,7 +2369,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         int byte_count = GET_PC_INT16(1);
         int jump_to = address + byte_count;
         sprintf(label, "%s_%d", method_name, jump_to);
-        ret = generator->jump(label, calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump(label, calc_distance(bytes, pc_start, pc, pc + byte_count));
         break;
       }
       case 168: // jsr (0xa8)
@@ -1668,12 +2400,30 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 170: // tableswitch (0xaa)
-        UNIMPL()
-        break;
-
       case 171: // lookupswitch (0xab)
-        UNIMPL()
+      {
+        ir_instr_t *instr = ir.get_instr(instr_index);
+        int first = instr->target;
+        int last = instr->target;
+
+        for (index = 0; index < instr->switch_count; index++)
+        {
+          int target = ir.get_switch_target(instr, index);
+
+          if (target < first) { first = target; }
+          if (target > last) { last = target; }
+        }
+
+        // The compares or table for each case go between here and there.
+        int distance = calc_distance(bytes, pc_start, pc, pc_start + first);
+        int distance_last = calc_distance(bytes, pc_start, pc, pc_start + last);
+
+        if (distance_last > distance) { distance = distance_last; }
+
+        ret = compile_switch(&ir, instr, method_name, switch_local,
+                             distance + (instr->switch_count * 2));
         break;
+      }
 
       case 172: // ireturn (0xac)
         //value1 = POP_INTEGER()
@@ -1684,19 +2434,11 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 173: // lreturn (0xad)
-        UNIMPL()
-        //lvalue1 = POP_LONG()
-        //stack_values = java_stack->values;
-        //stack_types = java_stack->types;
-        //PUSH_LONG(lvalue1);
+        ret = generator->return_long(max_locals);
         break;
 
       case 174: // freturn (0xae)
-        UNIMPL()
-        //value1 = POP_INTEGER()
-        //stack_values = java_stack->values;
-        //stack_types = java_stack->types;
-        //PUSH_INTEGER(value1);
+        ret = generator->return_float(max_locals);
         break;
 
       case 175: // dreturn (0xaf)
@@ -1729,6 +2471,21 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
           break;
         }
 
+        // Statics are one int wide.
+        if (type[0] == 'J' || type[0] == 'D')
+        {
+          printf("Error: Static field %s is a long or double which isn't supported.\n", field_name);
+          ret = -1;
+          break;
+        }
+
+        if (type[0] == 'F' && generator->get_float_size() != 1)
+        {
+          printf("Error: Static field %s is a float which isn't supported on this platform.\n", field_name);
+          ret = -1;
+          break;
+        }
+
         //if (gen32->tag == CONSTANT_METHODREF || type[0] == '[')
         if (gen32->tag == CONSTANT_METHODREF)
         {
@@ -1783,6 +2540,21 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
           break;
         }
 
+        // Statics are one int wide.
+        if (type[0] == 'J' || type[0] == 'D')
+        {
+          printf("Error: Static field %s is a long or double which isn't supported.\n", field_name);
+          ret = -1;
+          break;
+        }
+
+        if (type[0] == 'F' && generator->get_float_size() != 1)
+        {
+          printf("Error: Static field %s is a float which isn't supported on this platform.\n", field_name);
+          ret = -1;
+          break;
+        }
+
         if (stack->length() != 0)
         {
           char field_name[64];
@@ -1804,11 +2576,11 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
       }
       case 180: // getfield (0xb4)
-        UNIMPL()
+        ret = get_field(java_class, GET_PC_UINT16(1));
         break;
 
       case 181: // putfield (0xb5)
-        UNIMPL()
+        ret = put_field(java_class, GET_PC_UINT16(1));
         break;
 
       case 182: // invokevirtual (0xb6)
@@ -1827,7 +2599,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
       case 183: // invokespecial (0xb7)
         ref = GET_PC_UINT16(1);
-        ret = invoke_virtual(java_class, ref, generator);
+        ret = invoke_constructor(java_class, ref);
         break;
 
       case 184: // invokestatic (0xb8)
@@ -1844,12 +2616,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         break;
 
       case 187: // new (0xbb)
-        index = GET_PC_UINT16(1);
-        java_class->get_class_name(class_name, sizeof(class_name), index);
-        // FIXME - Field count is 0 here.  This needs to be filled in and
-        // class needs to be loaded and compiled in order to support user
-        // defined classes.  Only API classes can be new'd right now.
-        ret = generator->new_object(class_name, 0);
+        ret = new_object(java_class, GET_PC_UINT16(1));
         break;
 
       case 188: // newarray (0xbc)
@@ -1946,7 +2713,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
         sprintf(label, "%s_%d", method_name, jump_to);
 
-        ret = generator->jump_cond_zero(label, COND_EQUAL, calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump_cond_zero(label, COND_EQUAL, calc_distance(bytes, pc_start, pc, pc + byte_count));
         break;
       }
       case 199: // ifnonnull (0xc7)
@@ -1965,7 +2732,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
         sprintf(label, "%s_%d", method_name, jump_to);
 
-        ret = generator->jump_cond_zero(label, COND_NOT_EQUAL, calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump_cond_zero(label, COND_NOT_EQUAL, calc_distance(bytes, pc_start, pc, pc + byte_count));
         break;
       }
       case 200: // goto_w (0xc8)
@@ -1973,7 +2740,7 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
         int byte_count = GET_PC_INT32(1);
         int jump_to = address + byte_count;
         sprintf(label, "%s_%d", method_name, jump_to);
-        ret = generator->jump(label, calc_distance(bytes, pc, pc + byte_count));
+        ret = generator->jump(label, calc_distance(bytes, pc_start, pc, pc + byte_count));
         break;
       }
       case 201: // jsr_w (0xc9)
@@ -2063,7 +2830,8 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
     }
     else
     {
-      pc += table_java_instr[bytes[pc]].normal;
+      // Switch instructions are variable length so use the decoded size.
+      pc += ir.get_instr(instr_index)->length;
     }
 
     pc += skip_bytes;
@@ -2080,6 +2848,29 @@ int JavaCompiler::compile_method(JavaClass *java_class, int method_id, const cha
 
   generator->method_end(max_locals);
 
+  if (method_stats != NULL)
+  {
+    if (skip_bytes > 0) { method_stats->peephole++; }
+
+    if (generator->get_spilled() > spilled)
+    {
+      method_stats->spills += generator->get_spilled() - spilled;
+    }
+
+    // Constants folded, values folded into the instruction using them
+    // and dead code removed by the IR passes.
+    for (index = 0; index < ir.get_instr_count(); index++)
+    {
+      if ((ir.get_instr(index)->flags &
+          (IR_FLAG_FOLDED | IR_FLAG_SUPPRESSED | IR_FLAG_DEAD)) != 0)
+      {
+        method_stats->peephole++;
+      }
+    }
+
+    method_stats->text_end = generator->get_output_offset();
+  }
+
   return ret;
 }
 
@@ -2107,10 +2898,20 @@ int JavaCompiler::load_class(const char *filename)
 
   DEBUG_PRINT("CLASSPATH: '%s'\n\n", classpath);
 
-  in = fopen(filename, "rb");
-  if (in == NULL) { return -1; }
+  class_files[filename] = 1;
 
-  java_class = new JavaClass(in);
+  if (class_cache != NULL)
+  {
+    java_class = class_cache->load(filename, true);
+    if (java_class == NULL) { return -1; }
+  }
+    else
+  {
+    in = fopen(filename, "rb");
+    if (in == NULL) { return -1; }
+
+    java_class = new JavaClass(in);
+  }
 
   if (verbose)
   {
@@ -2187,7 +2988,7 @@ int JavaCompiler::add_static_initializers()
   index = java_class->get_clinit_method();
   if (index != -1)
   {
-    if (execute_static(java_class, index, generator, false, verbose) != 0)
+    if (execute_static(java_class, index, generator, false, verbose, NULL, &static_constants) != 0)
     {
       printf("** Error setting statics %s:%d.\n", __FILE__, __LINE__);
       return -1;
@@ -2208,7 +3009,7 @@ int JavaCompiler::add_static_initializers()
 
     DEBUG_PRINT("CLASS %s.%s  index=%d\n", iter->first.c_str(), name, index);
 
-    if (execute_static(java_class_external, index, generator, false, verbose, java_class) != 0)
+    if (execute_static(java_class_external, index, generator, false, verbose, java_class, &static_constants) != 0)
     {
       printf("** Error setting statics %s:%d.\n", __FILE__, __LINE__);
       return -1;
@@ -2251,20 +3052,234 @@ int JavaCompiler::execute_statics(int index)
   return 0;
 }
 
+int JavaCompiler::find_reachable_methods()
+{
+  // Methods that are entered from somewhere other than an invoke:
+  // main(), the static initializer and the interrupt listeners that
+  // the generators wire up to a vector by name.
+  static const char *roots[] =
+  {
+    "main",
+    "<clinit>",
+    "timerInterrupt",
+    "onVsync",
+    "onHsync",
+    "userInterrupt",
+    NULL
+  };
+  char method_name[128];
+  char alt_name[256+8];
+  char key[512];
+  int index, n;
+
+  did_call_graph = true;
+
+  // Every method gets looked up by the label it's compiled under, which
+  // is the same name invoke_static() / invoke_virtual() will call, plus
+  // its descriptor so overloads are kept apart.
+  for (index = 0; index < java_class->get_method_count(); index++)
+  {
+    if (java_class->get_method_name(method_name, sizeof(method_name), index) != 0)
+    {
+      continue;
+    }
+
+    if (get_method_key(key, sizeof(key), java_class, index, method_name) != 0)
+    {
+      return -1;
+    }
+
+    method_classes[key] = java_class;
+    method_ids[key] = index;
+  }
+
+  std::map<std::string,JavaClass *>::iterator iter;
+  for (iter = external_classes.begin(); iter != external_classes.end(); iter++)
+  {
+    JavaClass *java_class_external = iter->second;
+
+    for (index = 0; index < java_class_external->get_method_count(); index++)
+    {
+      if (java_class_external->get_method_name(method_name, sizeof(method_name), index) != 0)
+      {
+        continue;
+      }
+
+      sprintf(alt_name, "%s_%s", iter->first.c_str(), method_name);
+      if (get_method_key(key, sizeof(key), java_class_external, index, alt_name) != 0)
+      {
+        return -1;
+      }
+
+      method_classes[key] = java_class_external;
+      method_ids[key] = index;
+    }
+  }
+
+  // Roots are found by name alone, every overload of one is kept.
+  for (index = 0; index < java_class->get_method_count(); index++)
+  {
+    if (java_class->get_method_name(method_name, sizeof(method_name), index) != 0)
+    {
+      continue;
+    }
+
+    for (n = 0; roots[n] != NULL; n++)
+    {
+      if (strcmp(method_name, roots[n]) != 0) { continue; }
+
+      if (get_method_key(key, sizeof(key), java_class, index, method_name) != 0)
+      {
+        return -1;
+      }
+
+      if (mark_reachable(key) != 0) { return -1; }
+    }
+  }
+
+  if (verbose)
+  {
+    std::map<std::string,int>::iterator iter;
+
+    for (iter = method_ids.begin(); iter != method_ids.end(); iter++)
+    {
+      if (reachable_methods.find(iter->first) == reachable_methods.end())
+      {
+        printf("Removing unused method %s\n", iter->first.c_str());
+      }
+    }
+  }
+
+  return 0;
+}
+
+int JavaCompiler::get_method_key(char *key, int len, JavaClass *java_class, int method_id, const char *label)
+{
+  struct methods_t *method = java_class->get_method(method_id);
+  char descriptor[256];
+
+  java_class->get_name_constant(descriptor, sizeof(descriptor), method->descriptor_index);
+
+  if (snprintf(key, len, "%s%s", label, descriptor) >= len)
+  {
+    printf("Error: Method name %s%s is too long.\n", label, descriptor);
+    return -1;
+  }
+
+  return 0;
+}
+
+int JavaCompiler::mark_reachable(const char *name)
+{
+  char method_name[128];
+  char method_type[128];
+  char key[512];
+  uint8_t *inline_code = NULL;
+  MethodIR ir;
+  int n;
+
+  if (reachable_methods.find(name) != reachable_methods.end()) { return 0; }
+
+  reachable_methods[name] = 1;
+
+  // Not a method of a loaded class (an API call).
+  if (method_ids.find(name) == method_ids.end()) { return 0; }
+
+  JavaClass *java_class = method_classes[name];
+  int method_id = method_ids[name];
+  struct methods_t *method = java_class->get_method(method_id);
+
+  // Abstract / interface methods have no code.
+  if (method->attribute_count == 0) { return 0; }
+
+  // Calls that get inlined don't keep the callee alive.
+  if (inline_size > 0)
+  {
+    inline_methods(java_class, method_id, inline_size, &inline_code, false);
+  }
+
+  if (ir.build(java_class, method_id, inline_code) != 0)
+  {
+    printf("** Error decoding method %s\n", name);
+    free(inline_code);
+    return -1;
+  }
+
+  // Calls in code that will never be emitted don't count.
+  ir.propagate_constants(&static_constants);
+  ir.remove_dead_code();
+
+  for (n = 0; n < ir.get_instr_count(); n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+
+    if (ir.is_dead(n)) { continue; }
+
+    // invokevirtual, invokespecial, invokestatic, invokeinterface
+    if (instr->opcode < 0xb6 || instr->opcode > 0xb9) { continue; }
+
+    java_class->get_ref_name_type(method_name, method_type, sizeof(method_name), instr->operand);
+    snprintf(key, sizeof(key), "%s%s", method_name, method_type);
+
+    if (mark_reachable(key) != 0)
+    {
+      free(inline_code);
+      return -1;
+    }
+  }
+
+  free(inline_code);
+
+  return 0;
+}
+
+bool JavaCompiler::is_reachable(JavaClass *java_class, int method_id, const char *label)
+{
+  char key[512];
+
+  // Without the optimizer everything gets compiled like before.
+  if (!did_call_graph) { return true; }
+
+  // A name that couldn't be looked up can't be matched against the call
+  // graph, so keep the method rather than drop something that's called.
+  if (label[0] == 0) { return true; }
+
+  if (get_method_key(key, sizeof(key), java_class, method_id, label) != 0)
+  {
+    return true;
+  }
+
+  return reachable_methods.find(key) != reachable_methods.end();
+}
+
 int JavaCompiler::compile_methods(bool do_main)
 {
   int method_count = java_class->get_method_count();
-  char method_name[32];
-  int index;
+  char method_name[128];
+  method_plan_t **plans;
+  method_plan_t **compile_plans;
+  int plan_count = 0;
+  int compile_count = 0;
+  int index, n;
+  int ret = 0;
   bool did_execute_statics = false;
 
-  for (index = 0; index < method_count; index++)
+  if (optimize && !did_call_graph)
   {
-    if (java_class->get_method_name(method_name, sizeof(method_name), index) == 0)
+    if (find_reachable_methods() != 0) { return -1; }
+  }
+
+  if (do_main)
+  {
+    for (index = 0; index < method_count; index++)
     {
+      if (java_class->get_method_name(method_name, sizeof(method_name), index) != 0)
+      {
+        continue;
+      }
+
       if (strcmp(method_name, "main") == 0)
       {
-        if (!do_main) { continue ;}
         if (compile_method(java_class, index) != 0)
         {
           printf("** Error compiling class.\n");
@@ -2273,91 +3288,152 @@ int JavaCompiler::compile_methods(bool do_main)
 
         break;
       }
+    }
+
+    return 0;
+  }
 
-      if (do_main) { continue; }
+  // Everything to be output is listed first (in the order it's written)
+  // so the methods can be analyzed on all cores before the generator
+  // writes them out one at a time.
+  n = method_count;
+
+  std::map<std::string,JavaClass *>::iterator iter;
+  for (iter = external_classes.begin(); iter != external_classes.end(); iter++)
+  {
+    n += iter->second->get_method_count();
+  }
+
+  plans = (method_plan_t **)malloc((n + 1) * sizeof(method_plan_t *));
+  compile_plans = (method_plan_t **)malloc((n + 1) * sizeof(method_plan_t *));
+
+  for (index = 0; index < method_count; index++)
+  {
+    if (java_class->get_method_name(method_name, sizeof(method_name), index) == 0)
+    {
+      if (strcmp(method_name, "main") == 0) { continue; }
+      if (strcmp(method_name, "<init>") == 0) { continue; }
 
       if (strcmp("<clinit>", method_name) == 0)
       {
-        if (execute_statics(index) != 0) { return -1; }
+        plans[plan_count] = new method_plan_t(java_class, index);
+        plans[plan_count++]->execute_statics = true;
         did_execute_statics = true;
         continue;
       }
 
-      if (compile_method(java_class, index) != 0)
-      {
-        printf("** Error compiling class.\n");
-        return -1;
-      }
+      if (!is_reachable(java_class, index, method_name)) { continue; }
+
+      plans[plan_count] = new method_plan_t(java_class, index);
+      compile_plans[compile_count++] = plans[plan_count++];
     }
   }
 
   DEBUG_PRINT("external_classes.size()=%zu did_execute_statics=%d do_main=%d\n",
               external_classes.size(), did_execute_statics, do_main);
 
-  //if (!did_execute_statics && !do_main && external_classes.size() != 0)
-  if (!do_main && external_classes.size() != 0)
+  // Compile all needed methods from other classes.
+  for (iter = external_classes.begin(); iter != external_classes.end(); iter++)
   {
-    // Compile all needed methods from other classes.
-    std::map<std::string,JavaClass *>::iterator iter;
-    for (iter = external_classes.begin();
-         iter != external_classes.end();
-         iter++)
-    {
-      const char *class_name = iter->first.c_str();
-      JavaClass *java_class = iter->second;
+    const char *class_name = iter->first.c_str();
+    JavaClass *java_class = iter->second;
+
+    //int constant_count = java_class->get_constant_count();
+    int method_count = java_class->get_method_count();
 
-      //int constant_count = java_class->get_constant_count();
-      int method_count = java_class->get_method_count();
+    DEBUG_PRINT("Compile Class: %s (%p)\n", class_name, this);
+    DEBUG_PRINT("  method_count=%d\n", method_count);
 
-      DEBUG_PRINT("Compile Class: %s (%p)\n", class_name, this);
-      DEBUG_PRINT("  method_count=%d\n", method_count);
+    // For all methods in class
+    for (index = 0; index < method_count && ret == 0; index++)
+    {
+      struct methods_t *method = java_class->get_method(index);
 
-      // For all methods in class
-      for (index = 0; index < method_count; index++)
+      if (method == NULL)
       {
-        struct methods_t *method = java_class->get_method(index);
+        printf("Error: get_method(%d) failed.\n", index);
+        ret = -1;
+        break;
+      }
 
-        if (method == NULL)
-        {
-          printf("Error: get_method(%d) failed.\n", index);
-          return -1;
-        }
+      char method_name[128];
+      char alt_name[256+8]; // FIXME
 
-        char method_name[128];
-        char alt_name[256+8]; // FIXME
+      if (java_class->get_method_name(method_name, sizeof(method_name), index) != 0)
+      {
+        printf("Error: get_method_name(%d) failed.\n", index);
+        ret = -1;
+        break;
+      }
 
-        if (java_class->get_method_name(method_name, sizeof(method_name), index) != 0)
-        {
-          printf("Error: get_method_name(%d) failed.\n", index);
-          return -1;
-        }
+      printf("  METHOD INDEX=%d (%s)\n", index, method_name);
 
-        printf("  METHOD INDEX=%d (%s)\n", index, method_name);
+      if (strcmp(method_name, "<clinit>") == 0) { continue; }
+      if (strcmp(method_name, "<init>") == 0) { continue; }
 
-        if (strcmp(method_name, "<clinit>") == 0) { continue; }
-        if (strcmp(method_name, "<init>") == 0) { continue; }
+      sprintf(alt_name, "%s_%s", class_name, method_name);
 
-        sprintf(alt_name, "%s_%s", class_name, method_name);
+      if (!is_reachable(java_class, index, alt_name)) { continue; }
 
 #if 0
-        if (external_fields.find(alt_name) == external_fields.end())
-        {
-          continue;
-        }
+      if (external_fields.find(alt_name) == external_fields.end())
+      {
+        continue;
+      }
 #endif
 
-        DEBUG_PRINT("  compiling: %s.%s\n", class_name, method_name);
+      DEBUG_PRINT("  compiling: %s.%s\n", class_name, method_name);
 
-        if (compile_method(java_class, index, alt_name) != 0) { return -1; }
-      }
+      plans[plan_count] = new method_plan_t(java_class, index);
+      strcpy(plans[plan_count]->alt_name, alt_name);
+      compile_plans[compile_count++] = plans[plan_count++];
     }
+  }
+
+  if (ret == 0)
+  {
+    prepare_methods(compile_plans, compile_count);
+  }
+
+  for (n = 0; n < plan_count && ret == 0; n++)
+  {
+    method_plan_t *plan = plans[n];
 
-    // Had to add this "if" to deal with static arrays in the main class...
-    // it stopped compiling external methods otherwise.
-    if (!did_execute_statics)
+    if (plan->execute_statics)
+    {
+      ret = execute_statics(plan->method_id);
+    }
+      else
+    if (plan->alt_name[0] == 0)
+    {
+      if (compile_method(plan->java_class, plan->method_id, NULL, plan) != 0)
+      {
+        printf("** Error compiling class.\n");
+        ret = -1;
+      }
+    }
+      else
     {
-      if (execute_statics(-1) != 0) { return -1; }
+      ret = compile_method(plan->java_class, plan->method_id, plan->alt_name, plan);
     }
+
+    // Free the analysis as soon as the method is written out.
+    delete plan;
+    plans[n] = NULL;
+  }
+
+  for (n = 0; n < plan_count; n++) { delete plans[n]; }
+
+  free(plans);
+  free(compile_plans);
+
+  if (ret != 0) { return -1; }
+
+  // Had to add this "if" to deal with static arrays in the main class...
+  // it stopped compiling external methods otherwise.
+  if (external_classes.size() != 0 && !did_execute_statics)
+  {
+    if (execute_statics(-1) != 0) { return -1; }
   }
 
   return 0;
@@ -2365,11 +3441,10 @@ int JavaCompiler::compile_methods(bool do_main)
 
 int JavaCompiler::add_constants(JavaClass *java_class)
 {
+  std::map<int,int> &constants = needed_constants[java_class];
   std::map<int,int>::iterator iter;
 
-  for (iter = java_class->needed_constants.begin();
-       iter != java_class->needed_constants.end();
-       iter++)
+  for (iter = constants.begin(); iter != constants.end(); iter++)
   {
     constant_utf8_t *constant_utf8 =
       (constant_utf8_t *)java_class->get_constant(iter->first);
@@ -12,12 +12,18 @@
 #ifndef _JAVA_COMPILER_H
 #define _JAVA_COMPILER_H
 
+#include <stdlib.h>
+
 #include <map>
 #include <string>
 
 #include "Compiler.h"
 #include "Generator.h"
+#include "ClassCache.h"
+#include "ClassPath.h"
+#include "CompileStats.h"
 #include "JavaClass.h"
+#include "MethodIR.h"
 #include "stack.h"
 
 #define GET_PC_INT16(a) ((int16_t)(((uint16_t)bytes[pc+a+0])<<8|bytes[pc+a+1]))
@@ -31,12 +37,76 @@
                          ((uint32_t)bytes[pc+a+2])<<8|\
                           bytes[pc+a+3])
 
+// Everything compile_method() needs that doesn't touch the generator.
+// This is filled in by prepare_method() which can run on any thread.
+struct method_plan_t
+{
+  method_plan_t(JavaClass *java_class, int method_id) :
+    java_class(java_class),
+    method_id(method_id),
+    method_code(NULL),
+    local_regs(NULL),
+    ret(0),
+    execute_statics(false)
+  {
+    alt_name[0] = 0;
+  }
+
+  ~method_plan_t()
+  {
+    free(method_code);
+    free(local_regs);
+  }
+
+  JavaClass *java_class;
+  int method_id;
+  char alt_name[256+8];
+  MethodIR ir;
+  uint8_t *method_code;
+  int *local_regs;
+  int ret;
+  bool execute_statics;
+};
+
+// Keys next to each other that go to the same case.
+struct switch_run_t
+{
+  int32_t first;
+  int32_t last;
+  int target;
+};
+
+// What the compare tree for a switch without a jump table needs.
+struct switch_tree_t
+{
+  const char *method_name;
+  int address;
+  char default_label[128];
+  int local;          // the key is saved here
+  int distance;
+  int label_count;
+};
+
+class JavaCompiler;
+
+struct prepare_job_t
+{
+  JavaCompiler *compiler;
+  method_plan_t **plans;
+  int count;
+  int next;
+  int local_register_count;
+};
+
 class JavaCompiler : public Compiler
 {
 public:
   JavaCompiler();
   virtual ~JavaCompiler();
 
+  void set_class_cache(ClassCache *class_cache) { this->class_cache = class_cache; }
+  void set_class_path(ClassPath *class_path) { this->class_path = class_path; }
+  void set_stats(CompileStats *stats) { this->stats = stats; }
   virtual int load_class(const char *filename);
   virtual void insert_static_field_defines();
   virtual void init_heap();
@@ -47,24 +117,52 @@ public:
 
 private:
   int find_external_fields(JavaClass *java_class, bool is_parent);
-  void fill_label_map(uint8_t *label_map, int label_map_len, uint8_t *bytes, int code_len, int pc_start);
-  int optimize_const(JavaClass *java_class, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int const_val);
-  int optimize_compare(JavaClass *java_class, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int index);
+  int optimize_const(JavaClass *java_class, MethodIR *ir, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int const_val);
+  int optimize_compare(JavaClass *java_class, MethodIR *ir, char *method_name, uint8_t *bytes, int pc, int pc_end, int address, int index);
   int array_load(JavaClass *java_class, int constant_id, uint8_t array_type);
   int array_store(JavaClass *java_class, int constant_id, uint8_t array_type);
   int push_ref(int index, _stack *stack);
-  int compile_method(JavaClass *java_class, int method_id, const char *alt_name = NULL);
+  const char *get_member_name(JavaClass *java_class, const char *class_name, const char *name);
+  JavaClass *find_class(const char *class_name);
+  int get_field_offset(JavaClass *java_class, int constant_id, char *type, int len);
+  int get_field(JavaClass *java_class, int constant_id);
+  int put_field(JavaClass *java_class, int constant_id);
+  int new_object(JavaClass *java_class, int constant_id);
+  int invoke_constructor(JavaClass *java_class, int constant_id);
+  int get_stack_entries(MethodIR *ir, int instr_index, int count);
+  int prepare_method(method_plan_t *plan, int local_register_count);
+  static void *prepare_worker(void *context);
+  void prepare_methods(method_plan_t **plans, int count);
+  int compile_method(JavaClass *java_class, int method_id, const char *alt_name = NULL, method_plan_t *plan = NULL);
   int field_type_to_int(char *field_type);
   const char *field_type_from_int(int type);
   int execute_statics(int index);
+  int find_reachable_methods();
+  int get_method_key(char *key, int len, JavaClass *java_class, int method_id, const char *label);
+  int mark_reachable(const char *name);
+  bool is_reachable(JavaClass *java_class, int method_id, const char *label);
   int get_const(uint8_t *bytes, int len, int pc, int *value);
   int get_cond(uint8_t *bytes, int len, int pc, int *cond, int *label);
   int try_ternary(uint8_t *bytes, int len, int pc, bool compare_with_value, int compare);
+  bool is_jump_table(MethodIR *ir, ir_instr_t *instr);
+  int compile_switch(MethodIR *ir, ir_instr_t *instr, const char *method_name, int switch_local, int distance);
+  int switch_tree(switch_tree_t *tree, switch_run_t *runs, int count, int64_t min, int64_t max);
+  int switch_compare(switch_tree_t *tree, int cond, int32_t value, const char *label);
 
   JavaClass *java_class;  // FIXME - Why is this here?
+  ClassCache *class_cache;
+  ClassPath *class_path;
+  CompileStats *stats;
   char classpath[128];
   std::map<std::string,int> external_fields;
   std::map<std::string,JavaClass *> external_classes;
+  std::map<std::string,int> static_constants;
+  std::map<std::string,JavaClass *> method_classes;
+  std::map<std::string,int> method_ids;
+  std::map<std::string,int> reachable_methods;
+  // Keep track of constants that need to be defined for each class.
+  std::map<JavaClass *,std::map<int,int> > needed_constants;
+  bool did_call_graph;
   FILE *in;
   static uint8_t cond_table[];
   static const char *type_table[];
@@ -0,0 +1,2172 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JavaClass.h"
+#include "MethodIR.h"
+#include "table_java_instr.h"
+
+static inline int get_int16(uint8_t *b)
+{
+  return (int16_t)(((uint16_t)b[0] << 8) | b[1]);
+}
+
+static inline int get_uint16(uint8_t *b)
+{
+  return ((uint16_t)b[0] << 8) | b[1];
+}
+
+static inline int get_int32(uint8_t *b)
+{
+  return (int32_t)(((uint32_t)b[0] << 24) |
+                   ((uint32_t)b[1] << 16) |
+                   ((uint32_t)b[2] << 8) |
+                    (uint32_t)b[3]);
+}
+
+static inline bool is_category2(int type)
+{
+  return type == JAVA_TYPE_LONG || type == JAVA_TYPE_DOUBLE;
+}
+
+MethodIR::MethodIR() :
+  java_class(NULL),
+  bytes(NULL),
+  pc_start(0),
+  code_len(0),
+  max_stack(0),
+  max_locals(0),
+  param_count(0),
+  param_slots(0),
+  is_static(true),
+  stack_valid(false),
+  reachability_valid(false),
+  instrs(NULL),
+  instr_count(0),
+  instr_at(NULL),
+  blocks(NULL),
+  block_count(0),
+  succs(NULL),
+  preds(NULL),
+  values(NULL),
+  value_count(0),
+  value_alloc(0),
+  args(NULL),
+  arg_count(0),
+  arg_alloc(0),
+  switch_keys(NULL),
+  switch_targets(NULL),
+  switch_count(0),
+  exit_stack(NULL),
+  exit_count(0),
+  exit_alloc(0),
+  idom(NULL),
+  loops(NULL),
+  loop_count(0),
+  loop_members(NULL),
+  value_consts(NULL),
+  local_types(NULL)
+{
+}
+
+MethodIR::~MethodIR()
+{
+  reset();
+}
+
+void MethodIR::reset()
+{
+  if (instrs != NULL) { free(instrs); }
+  if (instr_at != NULL) { free(instr_at); }
+  if (blocks != NULL) { free(blocks); }
+  if (succs != NULL) { free(succs); }
+  if (preds != NULL) { free(preds); }
+  if (values != NULL) { free(values); }
+  if (args != NULL) { free(args); }
+  if (switch_keys != NULL) { free(switch_keys); }
+  if (switch_targets != NULL) { free(switch_targets); }
+  if (exit_stack != NULL) { free(exit_stack); }
+  if (idom != NULL) { free(idom); }
+  if (loops != NULL) { free(loops); }
+  if (loop_members != NULL) { free(loop_members); }
+  if (value_consts != NULL) { free(value_consts); }
+  if (local_types != NULL) { free(local_types); }
+
+  instrs = NULL;
+  instr_at = NULL;
+  blocks = NULL;
+  succs = NULL;
+  preds = NULL;
+  values = NULL;
+  args = NULL;
+  switch_keys = NULL;
+  switch_targets = NULL;
+  exit_stack = NULL;
+  idom = NULL;
+  loops = NULL;
+  loop_members = NULL;
+  value_consts = NULL;
+  local_types = NULL;
+
+  instr_count = 0;
+  block_count = 0;
+  value_count = 0;
+  value_alloc = 0;
+  arg_count = 0;
+  arg_alloc = 0;
+  switch_count = 0;
+  exit_count = 0;
+  exit_alloc = 0;
+  loop_count = 0;
+  stack_valid = false;
+  reachability_valid = false;
+}
+
+int MethodIR::build(JavaClass *java_class, int method_id, uint8_t *code)
+{
+  struct methods_t *method = java_class->get_method(method_id);
+  char descriptor[256];
+  uint8_t param_types[256];
+  int n;
+
+  reset();
+
+  this->java_class = java_class;
+  // code replaces the method's Code attribute (after inlining for example).
+  bytes = code != NULL ? code : method->attributes[0].info;
+
+  // Same layout compile_method() expects: max_stack, max_locals, code_len.
+  max_stack = ((int)bytes[0] << 8) | ((int)bytes[1]);
+  max_locals = ((int)bytes[2] << 8) | ((int)bytes[3]);
+  code_len = get_int32(bytes + 4);
+  pc_start = get_uint16(bytes + code_len + 8) + 8;
+  is_static = (method->access_flags & ACC_STATIC) != 0;
+
+  local_types = (uint8_t *)malloc(max_locals + 1);
+  memset(local_types, IR_TYPE_UNKNOWN, max_locals + 1);
+
+  // Parameters are the first locals (after "this" on virtual methods).
+  java_class->get_name_constant(descriptor, sizeof(descriptor), method->descriptor_index);
+  param_count = get_params(descriptor, param_types, sizeof(param_types));
+
+  int local = 0;
+  if (!is_static && local < max_locals) { local_types[local++] = JAVA_TYPE_REF; }
+
+  for (n = 0; n < param_count && local < max_locals; n++)
+  {
+    local_types[local] = param_types[n];
+    local += is_category2(param_types[n]) ? 2 : 1;
+  }
+
+  param_slots = local;
+
+  if (decode() != 0) { return -1; }
+  if (find_blocks() != 0) { return -1; }
+  if (find_edges() != 0) { return -1; }
+
+  // If the operand stack can't be modeled (jsr/ret, invokedynamic, etc)
+  // the instruction list and CFG are still good, but passes that need
+  // value numbers should check has_stack_info().
+  stack_valid = interpret() == 0;
+
+  return 0;
+}
+
+int MethodIR::find_instr(int address)
+{
+  if (address < 0 || address >= code_len) { return -1; }
+
+  return instr_at[address];
+}
+
+bool MethodIR::needs_label(int address)
+{
+  int index = find_instr(address);
+
+  if (index == -1) { return false; }
+
+  return (instrs[index].flags & IR_FLAG_LABEL) != 0;
+}
+
+int MethodIR::decode()
+{
+  int pc = pc_start;
+  int n;
+
+  // There can't be more instructions than bytes of code.
+  instrs = (ir_instr_t *)malloc((code_len + 1) * sizeof(ir_instr_t));
+  instr_at = (int *)malloc((code_len + 1) * sizeof(int));
+
+  for (n = 0; n <= code_len; n++) { instr_at[n] = -1; }
+
+  while(pc - pc_start < code_len)
+  {
+    ir_instr_t *instr = &instrs[instr_count];
+    int address = pc - pc_start;
+    int opcode = bytes[pc];
+    int op_pc = pc;
+
+    memset(instr, 0, sizeof(ir_instr_t));
+    instr->address = address;
+    instr->target = -1;
+    instr->result = -1;
+    instr->type = IR_TYPE_VOID;
+
+    if (opcode == 0xc4)
+    {
+      op_pc++;
+      opcode = bytes[op_pc];
+      instr->wide = 1;
+      instr->length = table_java_instr[opcode].wide == 0 ? 0 : 1 + table_java_instr[opcode].wide;
+    }
+      else
+    if (opcode == 0xaa || opcode == 0xab)
+    {
+      instr->length = decode_switch(instr, pc);
+    }
+      else
+    {
+      instr->length = table_java_instr[opcode].normal;
+    }
+
+    instr->opcode = opcode;
+
+    if (instr->length == 0 || address + instr->length > code_len)
+    {
+      printf("Error: Bad instruction %d at address %d\n", opcode, address);
+      return -1;
+    }
+
+    uint8_t *b = bytes + op_pc + 1;
+
+    switch(opcode)
+    {
+      case 0x02: // iconst_m1
+      case 0x03: // iconst_0
+      case 0x04: // iconst_1
+      case 0x05: // iconst_2
+      case 0x06: // iconst_3
+      case 0x07: // iconst_4
+      case 0x08: // iconst_5
+        instr->const_value = opcode - 3;
+        instr->flags |= IR_FLAG_CONST;
+        break;
+      case 0x10: // bipush
+        instr->const_value = (int8_t)b[0];
+        instr->flags |= IR_FLAG_CONST;
+        break;
+      case 0x11: // sipush
+        instr->const_value = get_int16(b);
+        instr->flags |= IR_FLAG_CONST;
+        break;
+      case 0x12: // ldc
+      case 0x13: // ldc_w
+      case 0x14: // ldc2_w
+      {
+        instr->operand = opcode == 0x12 ? b[0] : get_uint16(b);
+        generic_32bit_t *gen32 = (generic_32bit_t *)java_class->get_constant(instr->operand);
+        if (gen32->tag == CONSTANT_INTEGER)
+        {
+          instr->const_value = gen32->value;
+          instr->flags |= IR_FLAG_CONST;
+        }
+        break;
+      }
+      case 0x15: // iload
+      case 0x16: // lload
+      case 0x17: // fload
+      case 0x18: // dload
+      case 0x19: // aload
+      case 0x36: // istore
+      case 0x37: // lstore
+      case 0x38: // fstore
+      case 0x39: // dstore
+      case 0x3a: // astore
+      case 0xa9: // ret
+        instr->operand = instr->wide ? get_uint16(b) : b[0];
+        if (opcode == 0xa9) { instr->flags |= IR_FLAG_TERMINATOR; }
+        break;
+      case 0x84: // iinc
+        if (instr->wide)
+        {
+          instr->operand = get_uint16(b);
+          instr->operand2 = get_int16(b + 2);
+        }
+          else
+        {
+          instr->operand = b[0];
+          instr->operand2 = (int8_t)b[1];
+        }
+        break;
+      case 0x99: // ifeq
+      case 0x9a: // ifne
+      case 0x9b: // iflt
+      case 0x9c: // ifge
+      case 0x9d: // ifgt
+      case 0x9e: // ifle
+      case 0x9f: // if_icmpeq
+      case 0xa0: // if_icmpne
+      case 0xa1: // if_icmplt
+      case 0xa2: // if_icmpge
+      case 0xa3: // if_icmpgt
+      case 0xa4: // if_icmple
+      case 0xa5: // if_acmpeq
+      case 0xa6: // if_acmpne
+      case 0xa8: // jsr
+      case 0xc6: // ifnull
+      case 0xc7: // ifnonnull
+        instr->target = address + get_int16(b);
+        instr->flags |= IR_FLAG_BRANCH;
+        break;
+      case 0xa7: // goto
+        instr->target = address + get_int16(b);
+        instr->flags |= IR_FLAG_BRANCH | IR_FLAG_TERMINATOR;
+        break;
+      case 0xc8: // goto_w
+        instr->target = address + get_int32(b);
+        instr->flags |= IR_FLAG_BRANCH | IR_FLAG_TERMINATOR;
+        break;
+      case 0xc9: // jsr_w
+        instr->target = address + get_int32(b);
+        instr->flags |= IR_FLAG_BRANCH;
+        break;
+      case 0xaa: // tableswitch
+      case 0xab: // lookupswitch
+        instr->flags |= IR_FLAG_SWITCH | IR_FLAG_TERMINATOR;
+        break;
+      case 0xac: // ireturn
+      case 0xad: // lreturn
+      case 0xae: // freturn
+      case 0xaf: // dreturn
+      case 0xb0: // areturn
+      case 0xb1: // return
+      case 0xbf: // athrow
+        instr->flags |= IR_FLAG_TERMINATOR;
+        break;
+      case 0xb2: // getstatic
+      case 0xb3: // putstatic
+      case 0xb4: // getfield
+      case 0xb5: // putfield
+      case 0xb6: // invokevirtual
+      case 0xb7: // invokespecial
+      case 0xb8: // invokestatic
+      case 0xb9: // invokeinterface
+      case 0xba: // invokedynamic
+      case 0xbb: // new
+      case 0xbd: // anewarray
+      case 0xc0: // checkcast
+      case 0xc1: // instanceof
+        instr->operand = get_uint16(b);
+        break;
+      case 0xbc: // newarray
+        instr->operand = b[0];
+        break;
+      case 0xc5: // multianewarray
+        instr->operand = get_uint16(b);
+        instr->operand2 = b[2];
+        break;
+      default:
+        if (opcode >= 0x1a && opcode <= 0x2d)
+        {
+          // xload_n
+          instr->operand = (opcode - 0x1a) % 4;
+        }
+          else
+        if (opcode >= 0x3b && opcode <= 0x4e)
+        {
+          // xstore_n
+          instr->operand = (opcode - 0x3b) % 4;
+        }
+        break;
+    }
+
+    instr_at[address] = instr_count++;
+    pc += instr->length;
+  }
+
+  // Mark every instruction that is jumped to.
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+    int count = (instr->flags & IR_FLAG_SWITCH) ? instr->switch_count : 0;
+    int i;
+
+    for (i = -1; i < count; i++)
+    {
+      int target = i == -1 ? instr->target : switch_targets[instr->switch_start + i];
+
+      if (target == -1 && i == -1) { continue; }
+
+      int index = find_instr(target);
+
+      if (index == -1)
+      {
+        printf("Error: Branch to invalid address %d at address %d\n", target, instr->address);
+        return -1;
+      }
+
+      instrs[index].flags |= IR_FLAG_LABEL;
+    }
+  }
+
+  return 0;
+}
+
+int MethodIR::decode_switch(ir_instr_t *instr, int pc)
+{
+  int address = pc - pc_start;
+  // Operands are aligned to 4 bytes from the start of the code.
+  int pad = 3 - (address % 4);
+  uint8_t *b = bytes + pc + 1 + pad;
+  int length, count, n;
+
+  if (address + 1 + pad + 12 > code_len) { return 0; }
+
+  instr->target = address + get_int32(b);
+
+  if (bytes[pc] == 0xaa)
+  {
+    int low = get_int32(b + 4);
+    int high = get_int32(b + 8);
+
+    if (high < low) { return 0; }
+
+    count = high - low + 1;
+    length = 1 + pad + 12 + (count * 4);
+  }
+    else
+  {
+    count = get_int32(b + 4);
+
+    if (count < 0) { return 0; }
+
+    length = 1 + pad + 8 + (count * 8);
+  }
+
+  if (address + length > code_len) { return 0; }
+
+  switch_keys = (int *)realloc(switch_keys, (switch_count + count) * sizeof(int));
+  switch_targets = (int *)realloc(switch_targets, (switch_count + count) * sizeof(int));
+
+  instr->switch_start = switch_count;
+  instr->switch_count = count;
+
+  for (n = 0; n < count; n++)
+  {
+    if (bytes[pc] == 0xaa)
+    {
+      switch_keys[switch_count] = get_int32(b + 4) + n;
+      switch_targets[switch_count] = address + get_int32(b + 12 + (n * 4));
+    }
+      else
+    {
+      switch_keys[switch_count] = get_int32(b + 8 + (n * 8));
+      switch_targets[switch_count] = address + get_int32(b + 12 + (n * 8));
+    }
+
+    switch_count++;
+  }
+
+  return length;
+}
+
+int MethodIR::find_blocks()
+{
+  int n;
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    if (n == 0 || (instr->flags & IR_FLAG_LABEL) != 0)
+    {
+      instr->flags |= IR_FLAG_LEADER;
+    }
+
+    if ((instr->flags & (IR_FLAG_BRANCH|IR_FLAG_TERMINATOR)) != 0 &&
+        n + 1 < instr_count)
+    {
+      instrs[n + 1].flags |= IR_FLAG_LEADER;
+    }
+
+    if ((instr->flags & IR_FLAG_LEADER) != 0) { block_count++; }
+  }
+
+  blocks = (ir_block_t *)malloc((block_count + 1) * sizeof(ir_block_t));
+  block_count = 0;
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    if ((instr->flags & IR_FLAG_LEADER) != 0)
+    {
+      ir_block_t *block = &blocks[block_count++];
+
+      memset(block, 0, sizeof(ir_block_t));
+      block->start = instr->address;
+      block->first_instr = n;
+      block->stack_depth = -1;
+    }
+
+    ir_block_t *block = &blocks[block_count - 1];
+    block->instr_count++;
+    block->end = instr->address + instr->length;
+    instr->block = block_count - 1;
+  }
+
+  return 0;
+}
+
+int MethodIR::find_edges()
+{
+  int n, i, count;
+
+  // Two passes: first count edges, then fill them in.
+  for (int pass = 0; pass < 2; pass++)
+  {
+    count = 0;
+
+    for (n = 0; n < block_count; n++)
+    {
+      ir_block_t *block = &blocks[n];
+      ir_instr_t *last = &instrs[block->first_instr + block->instr_count - 1];
+      int targets = 0;
+
+      block->succ_start = count;
+      block->succ_count = 0;
+
+      for (i = -1; i <= last->switch_count; i++)
+      {
+        int target;
+
+        if (i == -1)
+        {
+          if ((last->flags & (IR_FLAG_BRANCH|IR_FLAG_SWITCH)) == 0) { continue; }
+          target = instrs[find_instr(last->target)].block;
+        }
+          else
+        if (i < last->switch_count)
+        {
+          target = instrs[find_instr(switch_targets[last->switch_start + i])].block;
+        }
+          else
+        {
+          if ((last->flags & IR_FLAG_TERMINATOR) != 0) { continue; }
+          if (n + 1 >= block_count) { continue; }
+          target = n + 1;
+        }
+
+        if (pass == 1)
+        {
+          int k;
+          for (k = 0; k < targets; k++)
+          {
+            if (succs[block->succ_start + k] == target) { break; }
+          }
+          if (k != targets) { continue; }
+
+          succs[count] = target;
+          block->succ_count++;
+          blocks[target].pred_count++;
+        }
+
+        targets++;
+        count++;
+      }
+
+      if (pass == 1) { count = block->succ_start + block->succ_count; }
+    }
+
+    if (pass == 0)
+    {
+      succs = (int *)malloc((count + 1) * sizeof(int));
+      preds = (int *)malloc((count + 1) * sizeof(int));
+    }
+  }
+
+  // Predecessor lists.
+  count = 0;
+  for (n = 0; n < block_count; n++)
+  {
+    blocks[n].pred_start = count;
+    count += blocks[n].pred_count;
+    blocks[n].pred_count = 0;
+  }
+
+  for (n = 0; n < block_count; n++)
+  {
+    ir_block_t *block = &blocks[n];
+
+    for (i = 0; i < block->succ_count; i++)
+    {
+      ir_block_t *succ = &blocks[succs[block->succ_start + i]];
+      preds[succ->pred_start + succ->pred_count++] = n;
+    }
+  }
+
+  return 0;
+}
+
+int MethodIR::get_ref_descriptor(int index, char *descriptor, int len)
+{
+  constant_methodref_t *ref =
+    (constant_methodref_t *)java_class->get_constant(index);
+
+  descriptor[0] = 0;
+
+  if (ref->tag != CONSTANT_FIELDREF &&
+      ref->tag != CONSTANT_METHODREF &&
+      ref->tag != CONSTANT_INTERFACEMETHODREF)
+  {
+    return -1;
+  }
+
+  constant_nameandtype_t *name_and_type =
+    (constant_nameandtype_t *)java_class->get_constant(ref->name_and_type_index);
+
+  if (name_and_type->tag != CONSTANT_NAMEANDTYPE) { return -1; }
+
+  return java_class->get_name_constant(descriptor, len, name_and_type->descriptor_index);
+}
+
+int MethodIR::type_from_descriptor(const char *descriptor)
+{
+  switch(descriptor[0])
+  {
+    case 'B':
+    case 'C':
+    case 'I':
+    case 'S':
+    case 'Z':
+      return JAVA_TYPE_INTEGER;
+    case 'J':
+      return JAVA_TYPE_LONG;
+    case 'F':
+      return JAVA_TYPE_FLOAT;
+    case 'D':
+      return JAVA_TYPE_DOUBLE;
+    case 'L':
+    case '[':
+      return JAVA_TYPE_REF;
+    case 'V':
+      return IR_TYPE_VOID;
+    default:
+      return IR_TYPE_UNKNOWN;
+  }
+}
+
+// Local variable an instruction reads or writes, or -1.  opcode is set to
+// the long form (iload .. aload, istore .. astore, iinc or ret).
+int MethodIR::get_local_access(ir_instr_t *instr, int *opcode)
+{
+  int op = instr->opcode;
+
+  if ((op >= 0x15 && op <= 0x19) || (op >= 0x36 && op <= 0x3a) ||
+       op == 0x84 || op == 0xa9)
+  {
+    *opcode = op;
+    return instr->operand;
+  }
+
+  if (op >= 0x1a && op <= 0x2d)
+  {
+    *opcode = 0x15 + ((op - 0x1a) >> 2);
+    return (op - 0x1a) & 3;
+  }
+
+  if (op >= 0x3b && op <= 0x4e)
+  {
+    *opcode = 0x36 + ((op - 0x3b) >> 2);
+    return (op - 0x3b) & 3;
+  }
+
+  *opcode = -1;
+
+  return -1;
+}
+
+// Writes a load or store (long form opcode) of a local below 256 using
+// the 1 byte form when there is one.  Returns the length.
+int MethodIR::encode_local(uint8_t *b, int opcode, int local)
+{
+  if (local <= 3)
+  {
+    if (opcode < 0x36)
+    {
+      b[0] = 0x1a + ((opcode - 0x15) << 2) + local;
+    }
+      else
+    {
+      b[0] = 0x3b + ((opcode - 0x36) << 2) + local;
+    }
+
+    return 1;
+  }
+
+  b[0] = opcode;
+  b[1] = local;
+
+  return 2;
+}
+
+int MethodIR::get_params(const char *descriptor, uint8_t *types, int max)
+{
+  const char *s = descriptor;
+  int count = 0;
+
+  if (*s != '(') { return 0; }
+  s++;
+
+  while(*s != ')' && *s != 0)
+  {
+    if (count < max) { types[count] = type_from_descriptor(s); }
+    count++;
+
+    while(*s == '[') { s++; }
+
+    if (*s == 'L')
+    {
+      while(*s != ';' && *s != 0) { s++; }
+    }
+
+    if (*s != 0) { s++; }
+  }
+
+  return count;
+}
+
+int MethodIR::stack_effect(ir_instr_t *instr, int *pops, int *pushes)
+{
+  static const uint8_t types[] =
+  {
+    JAVA_TYPE_INTEGER, JAVA_TYPE_LONG, JAVA_TYPE_FLOAT, JAVA_TYPE_DOUBLE,
+    JAVA_TYPE_REF, JAVA_TYPE_INTEGER, JAVA_TYPE_INTEGER, JAVA_TYPE_INTEGER
+  };
+
+  // l2i, l2f, l2d, f2i ... starting at i2l (0x85)
+  static const uint8_t conversions[] =
+  {
+    JAVA_TYPE_LONG, JAVA_TYPE_FLOAT, JAVA_TYPE_DOUBLE,
+    JAVA_TYPE_INTEGER, JAVA_TYPE_FLOAT, JAVA_TYPE_DOUBLE,
+    JAVA_TYPE_INTEGER, JAVA_TYPE_LONG, JAVA_TYPE_DOUBLE,
+    JAVA_TYPE_INTEGER, JAVA_TYPE_LONG, JAVA_TYPE_FLOAT,
+    JAVA_TYPE_INTEGER, JAVA_TYPE_INTEGER, JAVA_TYPE_INTEGER
+  };
+
+  char descriptor[256];
+  int opcode = instr->opcode;
+
+  *pops = 0;
+  *pushes = 0;
+
+  if (opcode == 0x00 || opcode == 0x84 || opcode == 0xa7 ||
+      opcode == 0xc8 || opcode == 0xb1 || opcode == 0xca)
+  {
+    // nop, iinc, goto, goto_w, return, breakpoint
+    return 0;
+  }
+    else
+  if (opcode == 0x01)
+  {
+    *pushes = 1;
+    instr->type = JAVA_TYPE_REF;
+  }
+    else
+  if (opcode >= 0x02 && opcode <= 0x11)
+  {
+    // iconst_m1 .. sipush
+    *pushes = 1;
+    if (opcode <= 0x08 || opcode >= 0x10) { instr->type = JAVA_TYPE_INTEGER; }
+    else if (opcode <= 0x0a) { instr->type = JAVA_TYPE_LONG; }
+    else if (opcode <= 0x0d) { instr->type = JAVA_TYPE_FLOAT; }
+    else { instr->type = JAVA_TYPE_DOUBLE; }
+  }
+    else
+  if (opcode >= 0x12 && opcode <= 0x14)
+  {
+    // ldc, ldc_w, ldc2_w
+    int tag = *(uint8_t *)java_class->get_constant(instr->operand);
+
+    *pushes = 1;
+
+    switch(tag)
+    {
+      case CONSTANT_INTEGER: instr->type = JAVA_TYPE_INTEGER; break;
+      case CONSTANT_FLOAT: instr->type = JAVA_TYPE_FLOAT; break;
+      case CONSTANT_LONG: instr->type = JAVA_TYPE_LONG; break;
+      case CONSTANT_DOUBLE: instr->type = JAVA_TYPE_DOUBLE; break;
+      default: instr->type = JAVA_TYPE_REF; break;
+    }
+  }
+    else
+  if (opcode >= 0x15 && opcode <= 0x19)
+  {
+    *pushes = 1;
+    instr->type = types[opcode - 0x15];
+  }
+    else
+  if (opcode >= 0x1a && opcode <= 0x2d)
+  {
+    *pushes = 1;
+    instr->type = types[(opcode - 0x1a) / 4];
+  }
+    else
+  if (opcode >= 0x2e && opcode <= 0x35)
+  {
+    // xaload
+    *pops = 2;
+    *pushes = 1;
+    instr->type = types[opcode - 0x2e];
+  }
+    else
+  if (opcode >= 0x36 && opcode <= 0x4e)
+  {
+    // xstore, xstore_n
+    *pops = 1;
+  }
+    else
+  if (opcode >= 0x4f && opcode <= 0x56)
+  {
+    // xastore
+    *pops = 3;
+  }
+    else
+  if (opcode >= 0x60 && opcode <= 0x73)
+  {
+    // add, sub, mul, div, rem
+    *pops = 2;
+    *pushes = 1;
+    instr->type = types[(opcode - 0x60) % 4];
+  }
+    else
+  if (opcode >= 0x74 && opcode <= 0x77)
+  {
+    // neg
+    *pops = 1;
+    *pushes = 1;
+    instr->type = types[opcode - 0x74];
+  }
+    else
+  if (opcode >= 0x78 && opcode <= 0x83)
+  {
+    // shifts, and, or, xor
+    *pops = 2;
+    *pushes = 1;
+    instr->type = (opcode & 1) == 0 ? JAVA_TYPE_INTEGER : JAVA_TYPE_LONG;
+  }
+    else
+  if (opcode >= 0x85 && opcode <= 0x93)
+  {
+    *pops = 1;
+    *pushes = 1;
+    instr->type = conversions[opcode - 0x85];
+  }
+    else
+  if (opcode >= 0x94 && opcode <= 0x98)
+  {
+    // lcmp, fcmpl, fcmpg, dcmpl, dcmpg
+    *pops = 2;
+    *pushes = 1;
+    instr->type = JAVA_TYPE_INTEGER;
+  }
+    else
+  if ((opcode >= 0x99 && opcode <= 0x9e) || opcode == 0xc6 || opcode == 0xc7)
+  {
+    *pops = 1;
+  }
+    else
+  if (opcode >= 0x9f && opcode <= 0xa6)
+  {
+    *pops = 2;
+  }
+    else
+  if (opcode == 0xaa || opcode == 0xab)
+  {
+    *pops = 1;
+  }
+    else
+  if (opcode >= 0xac && opcode <= 0xb0)
+  {
+    *pops = 1;
+  }
+    else
+  if (opcode == 0xb2 || opcode == 0xb4)
+  {
+    // getstatic, getfield
+    if (get_ref_descriptor(instr->operand, descriptor, sizeof(descriptor)) != 0)
+    {
+      return -1;
+    }
+
+    *pops = opcode == 0xb4 ? 1 : 0;
+    *pushes = 1;
+    instr->type = type_from_descriptor(descriptor);
+  }
+    else
+  if (opcode == 0xb3 || opcode == 0xb5)
+  {
+    // putstatic, putfield
+    *pops = opcode == 0xb5 ? 2 : 1;
+  }
+    else
+  if (opcode >= 0xb6 && opcode <= 0xb9)
+  {
+    // invokevirtual, invokespecial, invokestatic, invokeinterface
+    uint8_t params[256];
+
+    if (get_ref_descriptor(instr->operand, descriptor, sizeof(descriptor)) != 0)
+    {
+      return -1;
+    }
+
+    *pops = get_params(descriptor, params, sizeof(params));
+    if (opcode != 0xb8) { *pops += 1; }
+
+    const char *ret = strchr(descriptor, ')');
+    if (ret == NULL) { return -1; }
+
+    instr->type = type_from_descriptor(ret + 1);
+    if (instr->type != IR_TYPE_VOID) { *pushes = 1; }
+  }
+    else
+  if (opcode == 0xbb)
+  {
+    *pushes = 1;
+    instr->type = JAVA_TYPE_REF;
+  }
+    else
+  if (opcode == 0xbc || opcode == 0xbd || opcode == 0xc0)
+  {
+    // newarray, anewarray, checkcast
+    *pops = 1;
+    *pushes = 1;
+    instr->type = JAVA_TYPE_REF;
+  }
+    else
+  if (opcode == 0xbe || opcode == 0xc1)
+  {
+    // arraylength, instanceof
+    *pops = 1;
+    *pushes = 1;
+    instr->type = JAVA_TYPE_INTEGER;
+  }
+    else
+  if (opcode == 0xbf || opcode == 0xc2 || opcode == 0xc3)
+  {
+    // athrow, monitorenter, monitorexit
+    *pops = 1;
+  }
+    else
+  if (opcode == 0xc5)
+  {
+    *pops = instr->operand2;
+    *pushes = 1;
+    instr->type = JAVA_TYPE_REF;
+  }
+    else
+  {
+    // jsr, ret, invokedynamic and anything invalid.
+    return -1;
+  }
+
+  return 0;
+}
+
+int MethodIR::new_value(int def, int block, int type)
+{
+  if (value_count >= value_alloc)
+  {
+    value_alloc = value_alloc == 0 ? 64 : value_alloc * 2;
+    values = (ir_value_t *)realloc(values, value_alloc * sizeof(ir_value_t));
+  }
+
+  ir_value_t *value = &values[value_count];
+  value->def = def;
+  value->block = block;
+  value->use_count = 0;
+  value->type = type;
+
+  return value_count++;
+}
+
+void MethodIR::add_arg(ir_instr_t *instr, int value, bool is_use)
+{
+  if (arg_count >= arg_alloc)
+  {
+    arg_alloc = arg_alloc == 0 ? 64 : arg_alloc * 2;
+    args = (int *)realloc(args, arg_alloc * sizeof(int));
+  }
+
+  if (instr->arg_count == 0) { instr->arg_start = arg_count; }
+
+  args[arg_count++] = value;
+  instr->arg_count++;
+
+  if (is_use) { values[value].use_count++; }
+}
+
+void MethodIR::set_local_type(int index, int type)
+{
+  if (index >= max_locals) { return; }
+
+  if (local_types[index] == IR_TYPE_UNKNOWN)
+  {
+    local_types[index] = type;
+  }
+    else
+  if (local_types[index] != type)
+  {
+    local_types[index] = IR_TYPE_MIXED;
+  }
+}
+
+int MethodIR::stack_op(ir_instr_t *instr, int *stack, int *ptr)
+{
+  int copy[4];
+  int count, skip, n;
+
+  if (instr->opcode == 0x57 || instr->opcode == 0x58)
+  {
+    // pop, pop2
+    count = 1;
+    if (instr->opcode == 0x58 && *ptr > 0 &&
+        !is_category2(values[stack[*ptr - 1]].type))
+    {
+      count = 2;
+    }
+
+    if (*ptr < count) { return -1; }
+
+    for (n = *ptr - count; n < *ptr; n++) { add_arg(instr, stack[n], true); }
+    *ptr -= count;
+
+    return 0;
+  }
+
+  if (instr->opcode == 0x5f)
+  {
+    // swap
+    if (*ptr < 2) { return -1; }
+    add_arg(instr, stack[*ptr - 2], false);
+    add_arg(instr, stack[*ptr - 1], false);
+    n = stack[*ptr - 1];
+    stack[*ptr - 1] = stack[*ptr - 2];
+    stack[*ptr - 2] = n;
+
+    return 0;
+  }
+
+  // The dup family copies the top "count" values and inserts them below
+  // the next "skip" values.  Longs and doubles are a single value here
+  // so the forms of dup2 are worked out from the types on the stack.
+  if (*ptr < 1) { return -1; }
+
+  bool top_wide = is_category2(values[stack[*ptr - 1]].type);
+
+  switch(instr->opcode)
+  {
+    case 0x59: count = 1; skip = 0; break; // dup
+    case 0x5a: count = 1; skip = 1; break; // dup_x1
+    case 0x5b: // dup_x2
+      count = 1;
+      skip = (*ptr >= 2 && is_category2(values[stack[*ptr - 2]].type)) ? 1 : 2;
+      break;
+    case 0x5c: count = top_wide ? 1 : 2; skip = 0; break; // dup2
+    case 0x5d: count = top_wide ? 1 : 2; skip = 1; break; // dup2_x1
+    case 0x5e: // dup2_x2
+      count = top_wide ? 1 : 2;
+      skip = (*ptr >= count + 1 &&
+              is_category2(values[stack[*ptr - count - 1]].type)) ? 1 : 2;
+      break;
+    default:
+      return -1;
+  }
+
+  if (*ptr < count + skip || *ptr + count > max_stack) { return -1; }
+
+  for (n = 0; n < count; n++)
+  {
+    copy[n] = stack[*ptr - count + n];
+    add_arg(instr, copy[n], false);
+  }
+
+  for (n = *ptr - 1; n >= *ptr - count - skip; n--)
+  {
+    stack[n + count] = stack[n];
+  }
+
+  for (n = 0; n < count; n++)
+  {
+    stack[*ptr - count - skip + n] = copy[n];
+  }
+
+  *ptr += count;
+
+  return 0;
+}
+
+int MethodIR::interpret_block(int index, int *stack)
+{
+  ir_block_t *block = &blocks[index];
+  int ptr = block->stack_depth;
+  int pops, pushes;
+  int n, i;
+
+  for (n = 0; n < ptr; n++) { stack[n] = block->entry_values + n; }
+
+  for (n = block->first_instr; n < block->first_instr + block->instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    instr->arg_count = 0;
+
+    if (instr->opcode >= 0x57 && instr->opcode <= 0x5f)
+    {
+      if (stack_op(instr, stack, &ptr) != 0) { return -1; }
+      continue;
+    }
+
+    if (stack_effect(instr, &pops, &pushes) != 0) { return -1; }
+    if (pops > ptr) { return -1; }
+
+    for (i = ptr - pops; i < ptr; i++) { add_arg(instr, stack[i], true); }
+    ptr -= pops;
+
+    if (pushes != 0)
+    {
+      if (ptr >= max_stack) { return -1; }
+      instr->result = new_value(n, index, instr->type);
+      stack[ptr++] = instr->result;
+    }
+
+    // Keep track of what type each local holds.
+    if (instr->opcode == 0x84)
+    {
+      set_local_type(instr->operand, JAVA_TYPE_INTEGER);
+    }
+      else
+    if (instr->opcode >= 0x15 && instr->opcode <= 0x19)
+    {
+      set_local_type(instr->operand, instr->type);
+    }
+      else
+    if (instr->opcode >= 0x1a && instr->opcode <= 0x2d)
+    {
+      set_local_type(instr->operand, instr->type);
+    }
+      else
+    if (instr->opcode >= 0x36 && instr->opcode <= 0x4e)
+    {
+      set_local_type(instr->operand, values[get_arg(instr, 0)].type);
+    }
+  }
+
+  // Remember what is left on the stack so later passes can match it up
+  // with the entry values of the successors.
+  if (exit_count + ptr > exit_alloc)
+  {
+    exit_alloc = (exit_count + ptr) * 2 + 16;
+    exit_stack = (int *)realloc(exit_stack, exit_alloc * sizeof(int));
+  }
+
+  block->exit_values = exit_count;
+  block->exit_depth = ptr;
+
+  for (n = 0; n < ptr; n++) { exit_stack[exit_count++] = stack[n]; }
+
+  // Hand the stack over to the successors.
+  for (n = 0; n < block->succ_count; n++)
+  {
+    int next = get_succ(block, n);
+    ir_block_t *succ = &blocks[next];
+
+    if (succ->stack_depth == -1)
+    {
+      succ->stack_depth = ptr;
+      succ->entry_values = value_count;
+
+      for (i = 0; i < ptr; i++)
+      {
+        new_value(-1, next, values[stack[i]].type);
+      }
+    }
+      else
+    if (succ->stack_depth != ptr)
+    {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int MethodIR::interpret()
+{
+  int *stack = (int *)alloca((max_stack + 1) * sizeof(int));
+  int *worklist = (int *)alloca((block_count + 1) * sizeof(int));
+  int head = 0, tail = 0;
+  int n;
+
+  if (block_count == 0) { return 0; }
+
+  blocks[0].stack_depth = 0;
+  blocks[0].entry_values = 0;
+  worklist[tail++] = 0;
+
+  // A block is queued the first time its entry stack is known, so each
+  // block is interpreted exactly once.
+  while(head < tail)
+  {
+    int index = worklist[head++];
+
+    if (interpret_block(index, stack) != 0) { return -1; }
+
+    ir_block_t *block = &blocks[index];
+
+    for (n = 0; n < block->succ_count; n++)
+    {
+      int next = get_succ(block, n);
+      int i;
+
+      for (i = 0; i < tail; i++)
+      {
+        if (worklist[i] == next) { break; }
+      }
+
+      if (i == tail) { worklist[tail++] = next; }
+    }
+  }
+
+  return 0;
+}
+
+// Anything folded has to give the same answer on a 16 bit CPU as it would
+// in 32 bit Java, so only values that fit in a signed 16 bit int are
+// treated as constants.
+static inline bool fits_int16(int64_t value)
+{
+  return value >= -32768 && value <= 32767;
+}
+
+static bool fold_binary(int opcode, int a, int b, int *result)
+{
+  int64_t value;
+
+  switch(opcode)
+  {
+    case 0x60: value = (int64_t)a + b; break; // iadd
+    case 0x64: value = (int64_t)a - b; break; // isub
+    case 0x68: value = (int64_t)a * b; break; // imul
+    case 0x6c: // idiv
+      if (b == 0) { return false; }
+      value = a / b;
+      break;
+    case 0x70: // irem
+      if (b == 0) { return false; }
+      value = a % b;
+      break;
+    case 0x78: // ishl
+      if (b < 0 || b > 15) { return false; }
+      value = (int64_t)a << b;
+      break;
+    case 0x7a: // ishr
+      if (b < 0 || b > 15) { return false; }
+      value = a >> b;
+      break;
+    case 0x7c: // iushr
+      if (b < 0 || b > 15 || a < 0) { return false; }
+      value = a >> b;
+      break;
+    case 0x7e: value = a & b; break; // iand
+    case 0x80: value = a | b; break; // ior
+    case 0x82: value = a ^ b; break; // ixor
+    default:
+      return false;
+  }
+
+  if (!fits_int16(value)) { return false; }
+
+  *result = (int)value;
+
+  return true;
+}
+
+static bool fold_unary(int opcode, int a, int *result)
+{
+  int value;
+
+  switch(opcode)
+  {
+    case 0x74: value = -a; break;          // ineg
+    case 0x91: value = (int8_t)a; break;   // i2b
+    case 0x92: value = (uint16_t)a; break; // i2c
+    case 0x93: value = (int16_t)a; break;  // i2s
+    default:
+      return false;
+  }
+
+  if (!fits_int16(value)) { return false; }
+
+  *result = value;
+
+  return true;
+}
+
+static bool fold_cond(int opcode, int a, int b)
+{
+  // ifeq .. ifle compare against 0, if_icmpeq .. if_icmple against b.
+  int cond = opcode >= 0x9f ? opcode - 0x9f : opcode - 0x99;
+
+  switch(cond)
+  {
+    case 0: return a == b;
+    case 1: return a != b;
+    case 2: return a < b;
+    case 3: return a >= b;
+    case 4: return a > b;
+    default: return a <= b;
+  }
+}
+
+static inline bool is_int_compare(int opcode)
+{
+  return opcode >= 0x99 && opcode <= 0xa4;
+}
+
+static inline bool is_foldable(ir_instr_t *instr)
+{
+  switch(instr->opcode)
+  {
+    case 0x15: // iload
+    case 0x1a: // iload_0
+    case 0x1b: // iload_1
+    case 0x1c: // iload_2
+    case 0x1d: // iload_3
+    case 0x60: // iadd
+    case 0x64: // isub
+    case 0x68: // imul
+    case 0x6c: // idiv
+    case 0x70: // irem
+    case 0x74: // ineg
+    case 0x78: // ishl
+    case 0x7a: // ishr
+    case 0x7c: // iushr
+    case 0x7e: // iand
+    case 0x80: // ior
+    case 0x82: // ixor
+    case 0x91: // i2b
+    case 0x92: // i2c
+    case 0x93: // i2s
+      return true;
+    case 0xb2: // getstatic
+      return instr->type == JAVA_TYPE_INTEGER;
+    default:
+      return false;
+  }
+}
+
+bool MethodIR::constant_meet(ir_const_t *cell, ir_const_t *in)
+{
+  if (in->state == IR_CONST_UNDEF || cell->state == IR_CONST_UNKNOWN)
+  {
+    return false;
+  }
+
+  if (cell->state == IR_CONST_UNDEF)
+  {
+    *cell = *in;
+    return true;
+  }
+
+  if (in->state == IR_CONST_VALUE && in->value == cell->value)
+  {
+    return false;
+  }
+
+  cell->state = IR_CONST_UNKNOWN;
+
+  return true;
+}
+
+void MethodIR::constant_eval(ir_instr_t *instr, ir_const_t *locals, std::map<std::string,int> *static_constants)
+{
+  ir_const_t *result = &value_consts[instr->result];
+  ir_const_t *a = NULL, *b = NULL;
+  int value;
+
+  if (instr->arg_count >= 1) { a = &value_consts[get_arg(instr, 0)]; }
+  if (instr->arg_count >= 2) { b = &value_consts[get_arg(instr, 1)]; }
+
+  result->state = IR_CONST_UNKNOWN;
+
+  if (instr->type != JAVA_TYPE_INTEGER) { return; }
+
+  if ((instr->flags & IR_FLAG_CONST) != 0)
+  {
+    if (fits_int16(instr->const_value))
+    {
+      result->state = IR_CONST_VALUE;
+      result->value = instr->const_value;
+    }
+
+    return;
+  }
+
+  if (!is_foldable(instr)) { return; }
+
+  if (instr->opcode == 0xb2)
+  {
+    char field_name[64];
+    char type[64];
+
+    if (static_constants == NULL) { return; }
+
+    if (java_class->get_ref_name_type(field_name, type, sizeof(field_name), instr->operand) != 0)
+    {
+      return;
+    }
+
+    std::map<std::string,int>::iterator iter = static_constants->find(field_name);
+
+    if (iter != static_constants->end() && fits_int16(iter->second))
+    {
+      result->state = IR_CONST_VALUE;
+      result->value = iter->second;
+    }
+
+    return;
+  }
+
+  if (instr->arg_count == 0)
+  {
+    // iload
+    *result = locals[instr->operand];
+    return;
+  }
+
+  // Wait until every input is known before deciding.
+  if (a->state == IR_CONST_UNDEF || (b != NULL && b->state == IR_CONST_UNDEF))
+  {
+    result->state = IR_CONST_UNDEF;
+    return;
+  }
+
+  if (a->state != IR_CONST_VALUE || (b != NULL && b->state != IR_CONST_VALUE))
+  {
+    return;
+  }
+
+  if (b != NULL)
+  {
+    if (!fold_binary(instr->opcode, a->value, b->value, &value)) { return; }
+  }
+    else
+  {
+    if (!fold_unary(instr->opcode, a->value, &value)) { return; }
+  }
+
+  result->state = IR_CONST_VALUE;
+  result->value = value;
+}
+
+void MethodIR::constant_transfer(int index, ir_const_t *locals, std::map<std::string,int> *static_constants)
+{
+  ir_block_t *block = &blocks[index];
+  int n;
+
+  for (n = block->first_instr; n < block->first_instr + block->instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    if (instr->result != -1)
+    {
+      constant_eval(instr, locals, static_constants);
+    }
+
+    if (instr->opcode == 0x84)
+    {
+      // iinc
+      ir_const_t *local = &locals[instr->operand];
+
+      if (local->state == IR_CONST_VALUE)
+      {
+        int64_t value = (int64_t)local->value + instr->operand2;
+
+        if (fits_int16(value)) { local->value = (int)value; }
+        else { local->state = IR_CONST_UNKNOWN; }
+      }
+    }
+      else
+    if (instr->opcode >= 0x36 && instr->opcode <= 0x4e)
+    {
+      // xstore: only ints are tracked, longs and doubles take two slots.
+      ir_const_t *local = &locals[instr->operand];
+      int type = values[get_arg(instr, 0)].type;
+
+      if (type == JAVA_TYPE_INTEGER)
+      {
+        *local = value_consts[get_arg(instr, 0)];
+      }
+        else
+      {
+        local->state = IR_CONST_UNKNOWN;
+
+        if (is_category2(type) && instr->operand + 1 < max_locals)
+        {
+          locals[instr->operand + 1].state = IR_CONST_UNKNOWN;
+        }
+      }
+    }
+  }
+}
+
+bool MethodIR::constant_edge(ir_block_t *block, int succ)
+{
+  ir_instr_t *last = &instrs[block->first_instr + block->instr_count - 1];
+  ir_const_t *a, *b;
+  bool taken;
+
+  if (!is_int_compare(last->opcode)) { return true; }
+
+  a = &value_consts[get_arg(last, 0)];
+  b = last->arg_count == 2 ? &value_consts[get_arg(last, 1)] : NULL;
+
+  // Nothing is known about the condition yet so neither side runs.
+  if (a->state == IR_CONST_UNDEF || (b != NULL && b->state == IR_CONST_UNDEF))
+  {
+    return false;
+  }
+
+  if (a->state != IR_CONST_VALUE || (b != NULL && b->state != IR_CONST_VALUE))
+  {
+    return true;
+  }
+
+  taken = fold_cond(last->opcode, a->value, b == NULL ? 0 : b->value);
+
+  if (taken) { return instrs[find_instr(last->target)].block == succ; }
+
+  return succ == (int)(block - blocks) + 1;
+}
+
+// Conditional constant propagation over the CFG.  Locals and operand stack
+// values are tracked as undefined / constant / unknown, and a branch whose
+// condition is constant only lets control (and constants) flow down the
+// side that is taken.  Afterwards fold_constants() marks what can be done
+// at compile time.
+int MethodIR::propagate_constants(std::map<std::string,int> *static_constants)
+{
+  int *worklist;
+  uint8_t *queued;
+  ir_const_t *block_locals;
+  ir_const_t *locals;
+  int head = 0, count = 0;
+  int n, i;
+
+  if (!stack_valid || block_count == 0) { return 0; }
+
+  int locals_len = max_locals + 1;
+
+  value_consts = (ir_const_t *)malloc((value_count + 1) * sizeof(ir_const_t));
+  block_locals = (ir_const_t *)malloc(block_count * locals_len * sizeof(ir_const_t));
+  locals = (ir_const_t *)alloca(locals_len * sizeof(ir_const_t));
+  worklist = (int *)alloca(block_count * sizeof(int));
+  queued = (uint8_t *)alloca(block_count);
+
+  memset(value_consts, 0, (value_count + 1) * sizeof(ir_const_t));
+  memset(block_locals, 0, block_count * locals_len * sizeof(ir_const_t));
+  memset(queued, 0, block_count);
+
+  for (n = 0; n < block_count; n++) { blocks[n].flags &= ~IR_BLOCK_EXECUTABLE; }
+
+  // Parameters (and anything else) coming into the method are unknown.
+  for (n = 0; n < locals_len; n++) { block_locals[n].state = IR_CONST_UNKNOWN; }
+
+  blocks[0].flags |= IR_BLOCK_EXECUTABLE;
+  worklist[0] = 0;
+  queued[0] = 1;
+  count = 1;
+
+  while(count != 0)
+  {
+    int index = worklist[head];
+    ir_block_t *block = &blocks[index];
+
+    head = (head + 1) % block_count;
+    count--;
+    queued[index] = 0;
+
+    memcpy(locals, block_locals + (index * locals_len), locals_len * sizeof(ir_const_t));
+    constant_transfer(index, locals, static_constants);
+
+    for (n = 0; n < block->succ_count; n++)
+    {
+      int next = get_succ(block, n);
+      ir_block_t *succ = &blocks[next];
+      ir_const_t *succ_locals = block_locals + (next * locals_len);
+      bool changed = false;
+
+      if (!constant_edge(block, next)) { continue; }
+
+      if ((succ->flags & IR_BLOCK_EXECUTABLE) == 0)
+      {
+        succ->flags |= IR_BLOCK_EXECUTABLE;
+        changed = true;
+      }
+
+      for (i = 0; i < max_locals; i++)
+      {
+        changed |= constant_meet(&succ_locals[i], &locals[i]);
+      }
+
+      for (i = 0; i < block->exit_depth && i < succ->stack_depth; i++)
+      {
+        changed |= constant_meet(&value_consts[succ->entry_values + i],
+                                 &value_consts[exit_stack[block->exit_values + i]]);
+      }
+
+      if (changed && !queued[next])
+      {
+        worklist[(head + count) % block_count] = next;
+        count++;
+        queued[next] = 1;
+      }
+    }
+  }
+
+  free(block_locals);
+
+  reachability_valid = true;
+
+  fold_constants();
+
+  return 0;
+}
+
+bool MethodIR::is_suppressable(int value)
+{
+  ir_value_t *ir_value = &values[value];
+
+  if (ir_value->def == -1 || ir_value->use_count != 1) { return false; }
+
+  ir_instr_t *producer = &instrs[ir_value->def];
+
+  if ((producer->flags & (IR_FLAG_CONST|IR_FLAG_FOLDED)) == 0) { return false; }
+
+  return value_consts[value].state == IR_CONST_VALUE;
+}
+
+void MethodIR::fold_constants()
+{
+  uint8_t *pinned = (uint8_t *)alloca(value_count + 1);
+  int n, i;
+
+  // Values shuffled around by dup / swap have to stay on the real stack.
+  memset(pinned, 0, value_count + 1);
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    if (instr->opcode >= 0x59 && instr->opcode <= 0x5f)
+    {
+      for (i = 0; i < instr->arg_count; i++) { pinned[get_arg(instr, i)] = 1; }
+    }
+  }
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+    bool suppress_args;
+
+    if ((blocks[instr->block].flags & IR_BLOCK_EXECUTABLE) == 0) { continue; }
+
+    if (is_int_compare(instr->opcode))
+    {
+      ir_const_t *a = &value_consts[get_arg(instr, 0)];
+      ir_const_t *b = instr->arg_count == 2 ? &value_consts[get_arg(instr, 1)] : NULL;
+
+      if (a->state != IR_CONST_VALUE) { continue; }
+      if (b != NULL && b->state != IR_CONST_VALUE) { continue; }
+
+      instr->flags |= IR_FLAG_FOLDED;
+      instr->const_value = fold_cond(instr->opcode, a->value, b == NULL ? 0 : b->value);
+
+      // Anything that can't be suppressed gets popped instead.
+      suppress_args = true;
+    }
+      else
+    if (instr->result != -1 && is_foldable(instr) &&
+        value_consts[instr->result].state == IR_CONST_VALUE)
+    {
+      suppress_args = true;
+
+      for (i = 0; i < instr->arg_count; i++)
+      {
+        int value = get_arg(instr, i);
+        if (pinned[value] || !is_suppressable(value)) { suppress_args = false; }
+      }
+
+      if (!suppress_args) { continue; }
+
+      instr->flags |= IR_FLAG_FOLDED;
+      instr->const_value = value_consts[instr->result].value;
+    }
+      else
+    {
+      continue;
+    }
+
+    for (i = 0; i < instr->arg_count; i++)
+    {
+      int value = get_arg(instr, i);
+
+      if (pinned[value] || !is_suppressable(value)) { continue; }
+
+      instrs[values[value].def].flags |= IR_FLAG_SUPPRESSED;
+    }
+  }
+}
+
+bool MethodIR::get_value_const(int value, int *const_value)
+{
+  if (value_consts == NULL || value_consts[value].state != IR_CONST_VALUE)
+  {
+    return false;
+  }
+
+  *const_value = value_consts[value].value;
+
+  return true;
+}
+
+int MethodIR::get_unsuppressed_arg_count(ir_instr_t *instr)
+{
+  int count = 0;
+  int n;
+
+  for (n = 0; n < instr->arg_count; n++)
+  {
+    int def = values[get_arg(instr, n)].def;
+
+    if (def == -1 || (instrs[def].flags & IR_FLAG_SUPPRESSED) == 0) { count++; }
+  }
+
+  return count;
+}
+
+bool MethodIR::is_plain(int address)
+{
+  int index = find_instr(address);
+
+  if (index == -1) { return true; }
+
+  return (instrs[index].flags & (IR_FLAG_FOLDED|IR_FLAG_SUPPRESSED)) == 0;
+}
+
+void MethodIR::find_reachable(int index)
+{
+  ir_block_t *block = &blocks[index];
+  int n;
+
+  if ((block->flags & IR_BLOCK_EXECUTABLE) != 0) { return; }
+
+  block->flags |= IR_BLOCK_EXECUTABLE;
+
+  for (n = 0; n < block->succ_count; n++)
+  {
+    find_reachable(get_succ(block, n));
+  }
+}
+
+bool MethodIR::jumps_to_next(int index)
+{
+  ir_instr_t *instr = &instrs[index];
+  int n;
+
+  for (n = index + 1; n < instr_count; n++)
+  {
+    if ((instrs[n].flags & IR_FLAG_DEAD) == 0) { break; }
+  }
+
+  if (n == instr_count) { return false; }
+
+  return instrs[n].address == instr->target;
+}
+
+// Drop blocks that can never run (nothing branches to them, or constant
+// propagation showed the branch is never taken), gotos that land on the
+// next instruction that is emitted anyway, and labels nothing jumps to.
+int MethodIR::remove_dead_code()
+{
+  int n, i;
+
+  // Without constant propagation fall back to plain reachability.
+  if (!reachability_valid)
+  {
+    for (n = 0; n < block_count; n++) { blocks[n].flags &= ~IR_BLOCK_EXECUTABLE; }
+    if (block_count != 0) { find_reachable(0); }
+    reachability_valid = true;
+  }
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    instr->flags &= ~IR_FLAG_LABEL;
+
+    if ((blocks[instr->block].flags & IR_BLOCK_EXECUTABLE) == 0)
+    {
+      instr->flags |= IR_FLAG_DEAD;
+    }
+  }
+
+  for (n = 0; n < instr_count; n++)
+  {
+    ir_instr_t *instr = &instrs[n];
+
+    if ((instr->flags & IR_FLAG_DEAD) != 0) { continue; }
+
+    if ((instr->flags & IR_FLAG_FOLDED) != 0 &&
+        (instr->flags & IR_FLAG_BRANCH) != 0)
+    {
+      // Folded branch that is never taken.
+      if (instr->const_value == 0) { continue; }
+    }
+      else
+    if (instr->opcode != 0xa7 && instr->opcode != 0xc8)
+    {
+      // Conditional branches, jsr and switches keep their targets.
+      if ((instr->flags & (IR_FLAG_BRANCH|IR_FLAG_SWITCH)) == 0) { continue; }
+
+      instrs[find_instr(instr->target)].flags |= IR_FLAG_LABEL;
+
+      for (i = 0; i < instr->switch_count; i++)
+      {
+        instrs[find_instr(switch_targets[instr->switch_start + i])].flags |= IR_FLAG_LABEL;
+      }
+
+      continue;
+    }
+
+    // goto (or a branch that is always taken) to the next live instruction.
+    if (jumps_to_next(n))
+    {
+      if (get_unsuppressed_arg_count(instr) == 0)
+      {
+        instr->flags |= IR_FLAG_DEAD;
+      }
+
+      continue;
+    }
+
+    instrs[find_instr(instr->target)].flags |= IR_FLAG_LABEL;
+  }
+
+  return 0;
+}
+
+const char *MethodIR::type_as_string(int type)
+{
+  switch(type)
+  {
+    case JAVA_TYPE_INTEGER: return "int";
+    case JAVA_TYPE_LONG: return "long";
+    case JAVA_TYPE_FLOAT: return "float";
+    case JAVA_TYPE_DOUBLE: return "double";
+    case JAVA_TYPE_REF: return "ref";
+    case IR_TYPE_VOID: return "void";
+    case IR_TYPE_MIXED: return "mixed";
+    default: return "?";
+  }
+}
+
+// Immediate dominators (Cooper, Harvey, Kennedy) over the blocks in
+// reverse postorder, then one natural loop per header from the back edges
+// (an edge to a block that dominates the source).
+int MethodIR::find_loops()
+{
+  int *order = (int *)alloca((block_count + 1) * sizeof(int));
+  int *rpo = (int *)alloca((block_count + 1) * sizeof(int));
+  int *work = (int *)alloca((block_count + 1) * sizeof(int));
+  int *next = (int *)alloca((block_count + 1) * sizeof(int));
+  int order_count = 0;
+  int ptr = 0;
+  int n, i, k;
+
+  if (idom != NULL) { free(idom); }
+  if (loops != NULL) { free(loops); }
+  if (loop_members != NULL) { free(loop_members); }
+
+  idom = (int *)malloc((block_count + 1) * sizeof(int));
+  loops = NULL;
+  loop_members = NULL;
+  loop_count = 0;
+
+  if (block_count == 0) { return 0; }
+
+  for (n = 0; n < block_count; n++)
+  {
+    idom[n] = -1;
+    rpo[n] = -1;
+    next[n] = 0;
+  }
+
+  // Postorder with an explicit stack.
+  work[ptr++] = 0;
+  rpo[0] = 0;
+
+  while(ptr > 0)
+  {
+    int b = work[ptr - 1];
+
+    if (next[b] < blocks[b].succ_count)
+    {
+      int succ = get_succ(&blocks[b], next[b]++);
+
+      if (rpo[succ] == -1)
+      {
+        rpo[succ] = 0;
+        work[ptr++] = succ;
+      }
+
+      continue;
+    }
+
+    order[order_count++] = b;
+    ptr--;
+  }
+
+  for (n = 0; n < order_count; n++)
+  {
+    rpo[order[n]] = order_count - 1 - n;
+  }
+
+  idom[0] = 0;
+
+  bool changed = true;
+
+  while(changed)
+  {
+    changed = false;
+
+    for (n = order_count - 2; n >= 0; n--)
+    {
+      int b = order[n];
+      int new_idom = -1;
+
+      for (i = 0; i < blocks[b].pred_count; i++)
+      {
+        int pred = get_pred(&blocks[b], i);
+
+        if (idom[pred] == -1) { continue; }
+
+        if (new_idom == -1) { new_idom = pred; continue; }
+
+        int b1 = pred;
+        int b2 = new_idom;
+
+        while(b1 != b2)
+        {
+          while(rpo[b1] > rpo[b2]) { b1 = idom[b1]; }
+          while(rpo[b2] > rpo[b1]) { b2 = idom[b2]; }
+        }
+
+        new_idom = b1;
+      }
+
+      if (new_idom != idom[b])
+      {
+        idom[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  // Loops, one per header.
+  int *headers = (int *)alloca((block_count + 1) * sizeof(int));
+
+  for (n = 0; n < block_count; n++) { headers[n] = -1; }
+
+  for (n = 0; n < block_count; n++)
+  {
+    if (idom[n] == -1) { continue; }
+
+    for (i = 0; i < blocks[n].succ_count; i++)
+    {
+      int header = get_succ(&blocks[n], i);
+
+      if (dominates(header, n) && headers[header] == -1)
+      {
+        headers[header] = loop_count++;
+      }
+    }
+  }
+
+  if (loop_count == 0) { return 0; }
+
+  loops = (ir_loop_t *)malloc(loop_count * sizeof(ir_loop_t));
+  loop_members = (uint8_t *)malloc(loop_count * block_count);
+  memset(loop_members, 0, loop_count * block_count);
+
+  for (n = 0; n < block_count; n++)
+  {
+    if (headers[n] == -1) { continue; }
+
+    ir_loop_t *loop = &loops[headers[n]];
+    uint8_t *members = loop_members + (headers[n] * block_count);
+
+    loop->header = n;
+    loop->parent = -1;
+    loop->depth = 1;
+    loop->block_count = 1;
+
+    members[n] = 1;
+
+    // Everything that reaches a back edge without going through the
+    // header is in the loop.
+    ptr = 0;
+
+    for (i = 0; i < blocks[n].pred_count; i++)
+    {
+      int pred = get_pred(&blocks[n], i);
+
+      if (idom[pred] == -1 || !dominates(n, pred)) { continue; }
+      if (members[pred] == 0)
+      {
+        members[pred] = 1;
+        work[ptr++] = pred;
+        loop->block_count++;
+      }
+    }
+
+    while(ptr > 0)
+    {
+      int b = work[--ptr];
+
+      for (i = 0; i < blocks[b].pred_count; i++)
+      {
+        int pred = get_pred(&blocks[b], i);
+
+        if (idom[pred] == -1 || members[pred] != 0) { continue; }
+
+        members[pred] = 1;
+        work[ptr++] = pred;
+        loop->block_count++;
+      }
+    }
+  }
+
+  // The parent is the smallest other loop holding the header.
+  for (n = 0; n < loop_count; n++)
+  {
+    for (k = 0; k < loop_count; k++)
+    {
+      if (k == n || !in_loop(k, loops[n].header)) { continue; }
+
+      if (loops[n].parent == -1 ||
+          loops[k].block_count < loops[loops[n].parent].block_count)
+      {
+        loops[n].parent = k;
+      }
+    }
+  }
+
+  for (n = 0; n < loop_count; n++)
+  {
+    for (k = loops[n].parent; k != -1; k = loops[k].parent) { loops[n].depth++; }
+  }
+
+  return loop_count;
+}
+
+bool MethodIR::dominates(int block, int dominated)
+{
+  if (idom == NULL || idom[dominated] == -1) { return false; }
+
+  while(true)
+  {
+    if (dominated == block) { return true; }
+    if (dominated == 0) { return false; }
+
+    dominated = idom[dominated];
+  }
+}
+
+void MethodIR::print(const char *method_name)
+{
+  int n, i, k;
+
+  printf("----- IR: %s (blocks=%d instructions=%d values=%d stack=%s)\n",
+    method_name, block_count, instr_count, value_count,
+    stack_valid ? "ok" : "unknown");
+
+  printf("  locals:");
+  for (n = 0; n < max_locals; n++)
+  {
+    printf(" %d=%s", n, type_as_string(local_types[n]));
+  }
+  printf("\n");
+
+  for (n = 0; n < loop_count; n++)
+  {
+    printf("  loop %d: header=%d depth=%d parent=%d blocks:",
+      n, loops[n].header, loops[n].depth, loops[n].parent);
+    for (i = 0; i < block_count; i++)
+    {
+      if (in_loop(n, i)) { printf(" %d", i); }
+    }
+    printf("\n");
+  }
+
+  for (n = 0; n < block_count; n++)
+  {
+    ir_block_t *block = &blocks[n];
+
+    printf("  block %d: [%d, %d) depth=%d%s succ:", n, block->start, block->end,
+      block->stack_depth,
+      reachability_valid && (block->flags & IR_BLOCK_EXECUTABLE) == 0 ? " unreachable" : "");
+    for (i = 0; i < block->succ_count; i++) { printf(" %d", get_succ(block, i)); }
+    printf(" pred:");
+    for (i = 0; i < block->pred_count; i++) { printf(" %d", get_pred(block, i)); }
+    printf("\n");
+
+    for (i = block->first_instr; i < block->first_instr + block->instr_count; i++)
+    {
+      ir_instr_t *instr = &instrs[i];
+
+      printf("    %4d: %s%-14s", instr->address, instr->wide ? "wide " : "",
+        table_java_instr[instr->opcode].name);
+
+      if ((instr->flags & IR_FLAG_CONST) != 0) { printf(" #%d", instr->const_value); }
+      if (instr->target != -1) { printf(" -> %d", instr->target); }
+
+      for (k = 0; k < instr->arg_count; k++) { printf(" v%d", get_arg(instr, k)); }
+
+      if (instr->result != -1)
+      {
+        printf(" => v%d:%s", instr->result, type_as_string(instr->type));
+      }
+
+      if ((instr->flags & IR_FLAG_FOLDED) != 0) { printf(" [folded %d]", instr->const_value); }
+      if ((instr->flags & IR_FLAG_SUPPRESSED) != 0) { printf(" [suppressed]"); }
+      if ((instr->flags & IR_FLAG_DEAD) != 0) { printf(" [dead]"); }
+
+      printf("\n");
+    }
+  }
+}
+
@@ -0,0 +1,236 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _METHOD_IR_H
+#define _METHOD_IR_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+#include "JavaClass.h"
+
+// Typed intermediate representation of a single method.  The bytecode
+// is decoded once into a list of instructions, split into basic blocks
+// with predecessor / successor edges, and the operand stack is abstractly
+// interpreted so every value pushed gets a value number and a JAVA_TYPE_*.
+// Passes can then work on this instead of pattern matching raw bytes.
+
+#define IR_TYPE_VOID 0xfd
+#define IR_TYPE_MIXED 0xfe
+#define IR_TYPE_UNKNOWN 0xff
+
+#define IR_FLAG_LABEL 0x01      // Target of a branch (needs a label)
+#define IR_FLAG_LEADER 0x02     // First instruction of a basic block
+#define IR_FLAG_CONST 0x04      // Pushes a known integer (const_value)
+#define IR_FLAG_BRANCH 0x08     // Conditional or unconditional jump
+#define IR_FLAG_TERMINATOR 0x10 // Control never falls through
+#define IR_FLAG_SWITCH 0x20     // tableswitch / lookupswitch
+#define IR_FLAG_FOLDED 0x40     // Result (or branch taken) is const_value
+#define IR_FLAG_SUPPRESSED 0x80 // Value is folded into its consumer
+#define IR_FLAG_DEAD 0x100      // Unreachable or redundant, not emitted
+
+#define IR_BLOCK_EXECUTABLE 0x01
+
+#define IR_CONST_UNDEF 0
+#define IR_CONST_VALUE 1
+#define IR_CONST_UNKNOWN 2
+
+struct ir_instr_t
+{
+  int address;       // offset from start of the method code
+  int length;        // in bytes, including wide prefix and switch padding
+  int opcode;
+  int operand;       // local index, constant pool index or newarray type
+  int operand2;      // iinc increment, multianewarray dimensions
+  int const_value;   // value pushed when IR_FLAG_CONST is set
+  int target;        // branch target (switch default) or -1
+  int switch_start;  // index into switch keys / targets
+  int switch_count;
+  int block;
+  int arg_start;     // index into the args list of popped value numbers
+  int arg_count;
+  int result;        // value number pushed, or -1
+  uint8_t type;      // JAVA_TYPE_* of the result
+  uint16_t flags;
+  uint8_t wide;
+};
+
+struct ir_block_t
+{
+  int start;         // address of first instruction
+  int end;           // address just past the last instruction
+  int first_instr;
+  int instr_count;
+  int succ_start;
+  int succ_count;
+  int pred_start;
+  int pred_count;
+  int stack_depth;   // operand stack depth on entry, -1 if never reached
+  int entry_values;  // value number of the bottom of the entry stack
+  int exit_values;   // index into the exit stack list
+  int exit_depth;
+  int flags;
+};
+
+struct ir_loop_t
+{
+  int header;        // block every entry to the loop goes through
+  int parent;        // enclosing loop, or -1
+  int depth;         // 1 for an outermost loop
+  int block_count;
+};
+
+struct ir_const_t
+{
+  uint8_t state;     // IR_CONST_*
+  int value;
+};
+
+struct ir_value_t
+{
+  int def;           // defining instruction, or -1 for a block entry value
+  int block;
+  int use_count;     // instructions consuming this value (dup/swap excluded)
+  uint8_t type;
+};
+
+class MethodIR
+{
+public:
+  MethodIR();
+  ~MethodIR();
+
+  int build(JavaClass *java_class, int method_id, uint8_t *code = NULL);
+  void print(const char *method_name);
+
+  int get_instr_count() { return instr_count; }
+  ir_instr_t *get_instr(int index) { return &instrs[index]; }
+  int find_instr(int address);
+  bool needs_label(int address);
+
+  int get_block_count() { return block_count; }
+  ir_block_t *get_block(int index) { return &blocks[index]; }
+  int get_succ(ir_block_t *block, int n) { return succs[block->succ_start + n]; }
+  int get_pred(ir_block_t *block, int n) { return preds[block->pred_start + n]; }
+
+  int get_value_count() { return value_count; }
+  ir_value_t *get_value(int index) { return &values[index]; }
+  int get_arg(ir_instr_t *instr, int n) { return args[instr->arg_start + n]; }
+
+  int get_switch_key(ir_instr_t *instr, int n) { return switch_keys[instr->switch_start + n]; }
+  int get_switch_target(ir_instr_t *instr, int n) { return switch_targets[instr->switch_start + n]; }
+
+  int get_local_type(int index) { return local_types[index]; }
+
+  int find_loops();
+  int get_idom(int block) { return idom[block]; }
+  bool dominates(int block, int dominated);
+  int get_loop_count() { return loop_count; }
+  ir_loop_t *get_loop(int index) { return &loops[index]; }
+  bool in_loop(int loop, int block) { return loop_members[(loop * block_count) + block] != 0; }
+  bool has_stack_info() { return stack_valid; }
+
+  int propagate_constants(std::map<std::string,int> *static_constants);
+  bool get_value_const(int value, int *const_value);
+  int get_unsuppressed_arg_count(ir_instr_t *instr);
+  bool is_plain(int address);
+  int remove_dead_code();
+  bool is_dead(int index) { return (instrs[index].flags & IR_FLAG_DEAD) != 0; }
+
+  uint8_t *get_bytes() { return bytes; }
+  int get_pc_start() { return pc_start; }
+  int get_code_len() { return code_len; }
+  int get_max_stack() { return max_stack; }
+  int get_max_locals() { return max_locals; }
+  int get_param_count() { return param_count; }
+  // Locals the parameters take up (longs and doubles take 2).
+  int get_param_slots() { return param_slots; }
+  bool is_static_method() { return is_static; }
+
+  static int type_from_descriptor(const char *descriptor);
+  static int get_params(const char *descriptor, uint8_t *types, int max);
+  static const char *type_as_string(int type);
+  static int get_local_access(ir_instr_t *instr, int *opcode);
+  static int encode_local(uint8_t *b, int opcode, int local);
+
+private:
+  void reset();
+  int decode();
+  int decode_switch(ir_instr_t *instr, int pc);
+  int find_blocks();
+  int find_edges();
+  int stack_effect(ir_instr_t *instr, int *pops, int *pushes);
+  int interpret();
+  int interpret_block(int index, int *stack);
+  int stack_op(ir_instr_t *instr, int *stack, int *ptr);
+  void set_local_type(int index, int type);
+  int new_value(int def, int block, int type);
+  void add_arg(ir_instr_t *instr, int value, bool is_use);
+  void constant_transfer(int index, ir_const_t *locals, std::map<std::string,int> *static_constants);
+  void constant_eval(ir_instr_t *instr, ir_const_t *locals, std::map<std::string,int> *static_constants);
+  bool constant_edge(ir_block_t *block, int succ);
+  bool constant_meet(ir_const_t *cell, ir_const_t *in);
+  bool is_suppressable(int value);
+  void fold_constants();
+  void find_reachable(int index);
+  bool jumps_to_next(int index);
+  int get_ref_descriptor(int index, char *descriptor, int len);
+
+  JavaClass *java_class;
+  uint8_t *bytes;
+  int pc_start;
+  int code_len;
+  int max_stack;
+  int max_locals;
+  int param_count;
+  int param_slots;
+  bool is_static;
+  bool stack_valid;
+  bool reachability_valid;
+
+  ir_instr_t *instrs;
+  int instr_count;
+  int *instr_at;
+
+  ir_block_t *blocks;
+  int block_count;
+  int *succs;
+  int *preds;
+
+  ir_value_t *values;
+  int value_count;
+  int value_alloc;
+
+  int *args;
+  int arg_count;
+  int arg_alloc;
+
+  int *switch_keys;
+  int *switch_targets;
+  int switch_count;
+
+  int *exit_stack;
+  int exit_count;
+  int exit_alloc;
+
+  int *idom;
+  ir_loop_t *loops;
+  int loop_count;
+  uint8_t *loop_members;
+
+  ir_const_t *value_consts;
+
+  uint8_t *local_types;
+};
+
+#endif
+
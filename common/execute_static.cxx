@@ -16,6 +16,7 @@
 
 #include "Generator.h"
 #include "JavaClass.h"
+#include "execute_static.h"
 #include "stack.h"
 #include "table_java_instr.h"
 
@@ -43,7 +44,23 @@
           break; \
         }
 
-int execute_static(JavaClass *java_class, int method_id, Generator *generator, bool do_arrays, bool verbose, JavaClass *parent_class)
+// Refs to fields of an external class have the class name in front
+// (Class_field) but the class itself only knows the field as "field".
+static const char *get_own_field_name(JavaClass *java_class, const char *field_name)
+{
+  int len = strlen(java_class->class_name);
+
+  if (java_class->use_full_method_name() &&
+      strncmp(field_name, java_class->class_name, len) == 0 &&
+      field_name[len] == '_')
+  {
+    return field_name + len + 1;
+  }
+
+  return field_name;
+}
+
+int execute_static(JavaClass *java_class, int method_id, Generator *generator, bool do_arrays, bool verbose, JavaClass *parent_class, std::map<std::string,int> *static_constants)
 {
   struct methods_t *method = java_class->get_method(method_id);
   uint8_t *bytes = method->attributes[0].info;
@@ -509,7 +526,7 @@ int execute_static(JavaClass *java_class, int method_id, Generator *generator, b
           }
             else
           {
-            index = java_class->get_field_index(field_name);
+            index = java_class->get_field_index(get_own_field_name(java_class, field_name));
             generator->field_init_ref(full_field_name, index);
           }
         }
@@ -517,7 +534,7 @@ int execute_static(JavaClass *java_class, int method_id, Generator *generator, b
         if (!do_arrays)
         {
           int value = temp;
-          index = java_class->get_field_index(field_name);
+          index = java_class->get_field_index(get_own_field_name(java_class, field_name));
           if (index == -1)
           {
             printf("Couldn't find %s\n", field_name);
@@ -554,6 +571,14 @@ int execute_static(JavaClass *java_class, int method_id, Generator *generator, b
           {
             ret = -1;
           }
+
+          // Keep values of static final fields so the compiler can fold
+          // them as constants.
+          if (ret == 0 && static_constants != NULL &&
+              (java_class->get_field(index)->access_flags & ACC_FINAL) != 0)
+          {
+            (*static_constants)[field_name] = value;
+          }
         }
         break;
       case 180: // getfield (0xb4)
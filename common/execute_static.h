@@ -12,10 +12,13 @@
 #ifndef _EXECUTE_STATIC_H
 #define _EXECUTE_STATIC_H
 
+#include <map>
+#include <string>
+
 #include "Generator.h"
 #include "JavaClass.h"
 
-int execute_static(JavaClass *java_class, int method_id, Generator *generator, bool do_arrays, bool verbose, JavaClass *parent_class=NULL);
+int execute_static(JavaClass *java_class, int method_id, Generator *generator, bool do_arrays, bool verbose, JavaClass *parent_class=NULL, std::map<std::string,int> *static_constants=NULL);
 
 #endif
 
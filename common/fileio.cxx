@@ -11,8 +11,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 
+#include "fileio.h"
+
 int16_t read_int16(FILE *in)
 {
   uint32_t i;
@@ -51,5 +54,28 @@ int64_t read_int64(FILE *in)
   return (int64_t)i;
 }
 
+// Read the rest of the file into one buffer.  A few zero bytes are added
+// at the end so a header read just past a truncated file is harmless.
+uint8_t *read_file(FILE *in, int *length)
+{
+  uint8_t *data;
+  long start, end;
+  int size;
+
+  start = ftell(in);
+  fseek(in, 0, SEEK_END);
+  end = ftell(in);
+  fseek(in, start, SEEK_SET);
+
+  if (start < 0 || end < start) { return NULL; }
 
+  size = end - start;
+  data = (uint8_t *)malloc(size + 16);
+  if (data == NULL) { return NULL; }
+
+  *length = fread(data, 1, size, in);
+  memset(data + *length, 0, 16);
+
+  return data;
+}
 
@@ -15,6 +15,25 @@
 int16_t read_int16(FILE *in);
 int32_t read_int32(FILE *in);
 int64_t read_int64(FILE *in);
+uint8_t *read_file(FILE *in, int *length);
+
+// Big endian reads from a class file already in memory.
+static inline int16_t get_int16(const uint8_t *data)
+{
+  return (int16_t)((data[0] << 8) | data[1]);
+}
+
+static inline int32_t get_int32(const uint8_t *data)
+{
+  return (int32_t)(((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+                   ((uint32_t)data[2] << 8) | (uint32_t)data[3]);
+}
+
+static inline int64_t get_int64(const uint8_t *data)
+{
+  return (int64_t)(((uint64_t)(uint32_t)get_int32(data) << 32) |
+                   (uint32_t)get_int32(data + 4));
+}
 
 #endif
 
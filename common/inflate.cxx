@@ -0,0 +1,398 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "inflate.h"
+
+#define MAX_BITS 15
+#define MAX_LENGTH_CODES 286
+#define MAX_DIST_CODES 30
+#define FIXED_LENGTH_CODES 288
+
+struct inflate_state_t
+{
+  const uint8_t *in;
+  int in_length;
+  int in_ptr;
+  uint32_t bit_buffer;
+  int bit_count;
+  uint8_t *out;
+  int out_length;
+  int out_ptr;
+  bool error;
+};
+
+// Canonical Huffman code: how many codes there are of each length and
+// the symbols sorted by code.
+struct huffman_t
+{
+  int16_t count[MAX_BITS + 1];
+  int16_t symbol[FIXED_LENGTH_CODES];
+};
+
+static const int16_t length_base[] =
+{
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const int16_t length_extra[] =
+{
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const int16_t dist_base[] =
+{
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577
+};
+
+static const int16_t dist_extra[] =
+{
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static int get_bits(inflate_state_t *state, int count)
+{
+  int value;
+
+  while (state->bit_count < count)
+  {
+    if (state->in_ptr >= state->in_length)
+    {
+      state->error = true;
+      return 0;
+    }
+
+    state->bit_buffer |= (uint32_t)state->in[state->in_ptr++] << state->bit_count;
+    state->bit_count += 8;
+  }
+
+  value = state->bit_buffer & ((1 << count) - 1);
+  state->bit_buffer >>= count;
+  state->bit_count -= count;
+
+  return value;
+}
+
+static int build_huffman(huffman_t *huffman, const uint8_t *lengths, int count)
+{
+  int16_t offsets[MAX_BITS + 1];
+  int left;
+  int n;
+
+  memset(huffman->count, 0, sizeof(huffman->count));
+
+  for (n = 0; n < count; n++) { huffman->count[lengths[n]]++; }
+
+  if (huffman->count[0] == count) { return 0; }
+
+  // A code set can't use more codes of a length than are left over.
+  left = 1;
+
+  for (n = 1; n <= MAX_BITS; n++)
+  {
+    left <<= 1;
+    left -= huffman->count[n];
+    if (left < 0) { return -1; }
+  }
+
+  offsets[1] = 0;
+
+  for (n = 1; n < MAX_BITS; n++)
+  {
+    offsets[n + 1] = offsets[n] + huffman->count[n];
+  }
+
+  for (n = 0; n < count; n++)
+  {
+    if (lengths[n] != 0) { huffman->symbol[offsets[lengths[n]]++] = n; }
+  }
+
+  return left;
+}
+
+static int decode(inflate_state_t *state, const huffman_t *huffman)
+{
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  int len;
+
+  // Codes are packed starting with the most significant bit so they are
+  // read one bit at a time.
+  for (len = 1; len <= MAX_BITS; len++)
+  {
+    code |= get_bits(state, 1);
+
+    if (state->error) { return -1; }
+
+    int count = huffman->count[len];
+
+    if (code - count < first)
+    {
+      return huffman->symbol[index + (code - first)];
+    }
+
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+
+  state->error = true;
+
+  return -1;
+}
+
+static int inflate_stored(inflate_state_t *state)
+{
+  int len;
+
+  // Stored blocks start on a byte boundary.
+  state->bit_buffer = 0;
+  state->bit_count = 0;
+
+  if (state->in_ptr + 4 > state->in_length) { return -1; }
+
+  len = state->in[state->in_ptr] | (state->in[state->in_ptr + 1] << 8);
+
+  if ((state->in[state->in_ptr + 2] != (~len & 0xff)) ||
+      (state->in[state->in_ptr + 3] != ((~len >> 8) & 0xff)))
+  {
+    return -1;
+  }
+
+  state->in_ptr += 4;
+
+  if (state->in_ptr + len > state->in_length) { return -1; }
+  if (state->out_ptr + len > state->out_length) { return -1; }
+
+  memcpy(state->out + state->out_ptr, state->in + state->in_ptr, len);
+  state->in_ptr += len;
+  state->out_ptr += len;
+
+  return 0;
+}
+
+static int inflate_codes(inflate_state_t *state, const huffman_t *lengths, const huffman_t *distances)
+{
+  int symbol;
+  int len;
+  int dist;
+
+  while(1)
+  {
+    symbol = decode(state, lengths);
+
+    if (symbol < 0) { return -1; }
+
+    if (symbol < 256)
+    {
+      if (state->out_ptr >= state->out_length) { return -1; }
+
+      state->out[state->out_ptr++] = symbol;
+      continue;
+    }
+
+    if (symbol == 256) { return 0; }
+
+    symbol -= 257;
+
+    if (symbol >= 29) { return -1; }
+
+    len = length_base[symbol] + get_bits(state, length_extra[symbol]);
+
+    symbol = decode(state, distances);
+
+    if (symbol < 0 || symbol >= 30) { return -1; }
+
+    dist = dist_base[symbol] + get_bits(state, dist_extra[symbol]);
+
+    if (state->error) { return -1; }
+    if (dist > state->out_ptr) { return -1; }
+    if (state->out_ptr + len > state->out_length) { return -1; }
+
+    // Copies can overlap what they're writing so go a byte at a time.
+    while (len-- > 0)
+    {
+      state->out[state->out_ptr] = state->out[state->out_ptr - dist];
+      state->out_ptr++;
+    }
+  }
+}
+
+static int inflate_fixed(inflate_state_t *state)
+{
+  huffman_t lengths, distances;
+  uint8_t code_lengths[FIXED_LENGTH_CODES];
+  int n;
+
+  for (n = 0; n < 144; n++) { code_lengths[n] = 8; }
+  for (; n < 256; n++) { code_lengths[n] = 9; }
+  for (; n < 280; n++) { code_lengths[n] = 7; }
+  for (; n < FIXED_LENGTH_CODES; n++) { code_lengths[n] = 8; }
+
+  build_huffman(&lengths, code_lengths, FIXED_LENGTH_CODES);
+
+  for (n = 0; n < MAX_DIST_CODES; n++) { code_lengths[n] = 5; }
+
+  build_huffman(&distances, code_lengths, MAX_DIST_CODES);
+
+  return inflate_codes(state, &lengths, &distances);
+}
+
+static int inflate_dynamic(inflate_state_t *state)
+{
+  static const uint8_t order[19] =
+  {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+  };
+
+  huffman_t lengths, distances;
+  uint8_t code_lengths[MAX_LENGTH_CODES + MAX_DIST_CODES];
+  int length_count, dist_count, code_count;
+  int symbol;
+  int len;
+  int n;
+
+  length_count = get_bits(state, 5) + 257;
+  dist_count = get_bits(state, 5) + 1;
+  code_count = get_bits(state, 4) + 4;
+
+  if (state->error) { return -1; }
+  if (length_count > MAX_LENGTH_CODES || dist_count > MAX_DIST_CODES) { return -1; }
+
+  // First comes the code that the other two codes' lengths are sent in.
+  for (n = 0; n < code_count; n++) { code_lengths[order[n]] = get_bits(state, 3); }
+  for (; n < 19; n++) { code_lengths[order[n]] = 0; }
+
+  if (state->error) { return -1; }
+  if (build_huffman(&lengths, code_lengths, 19) != 0) { return -1; }
+
+  n = 0;
+
+  while (n < length_count + dist_count)
+  {
+    symbol = decode(state, &lengths);
+
+    if (symbol < 0) { return -1; }
+
+    if (symbol < 16)
+    {
+      code_lengths[n++] = symbol;
+      continue;
+    }
+
+    if (symbol == 16)
+    {
+      if (n == 0) { return -1; }
+      len = code_lengths[n - 1];
+      symbol = 3 + get_bits(state, 2);
+    }
+      else
+    if (symbol == 17)
+    {
+      len = 0;
+      symbol = 3 + get_bits(state, 3);
+    }
+      else
+    {
+      len = 0;
+      symbol = 11 + get_bits(state, 7);
+    }
+
+    if (state->error) { return -1; }
+    if (n + symbol > length_count + dist_count) { return -1; }
+
+    while (symbol-- > 0) { code_lengths[n++] = len; }
+  }
+
+  // Without an end of block code the data can't be decoded.
+  if (code_lengths[256] == 0) { return -1; }
+
+  // Incomplete codes are only allowed when there is a single code.
+  int left = build_huffman(&lengths, code_lengths, length_count);
+
+  if (left < 0 || (left > 0 && length_count - lengths.count[0] != 1))
+  {
+    return -1;
+  }
+
+  left = build_huffman(&distances, code_lengths + length_count, dist_count);
+
+  if (left < 0 || (left > 0 && dist_count - distances.count[0] != 1))
+  {
+    return -1;
+  }
+
+  return inflate_codes(state, &lengths, &distances);
+}
+
+int inflate(uint8_t *out, int out_length, const uint8_t *in, int in_length)
+{
+  inflate_state_t state;
+  int last;
+  int type;
+  int ret;
+
+  memset(&state, 0, sizeof(state));
+  state.in = in;
+  state.in_length = in_length;
+  state.out = out;
+  state.out_length = out_length;
+
+  do
+  {
+    last = get_bits(&state, 1);
+    type = get_bits(&state, 2);
+
+    if (state.error) { return -1; }
+
+    switch (type)
+    {
+      case 0: ret = inflate_stored(&state); break;
+      case 1: ret = inflate_fixed(&state); break;
+      case 2: ret = inflate_dynamic(&state); break;
+      default: ret = -1; break;
+    }
+
+    if (ret != 0 || state.error) { return -1; }
+  } while (last == 0);
+
+  return state.out_ptr;
+}
+
+uint32_t crc32(const uint8_t *data, int length)
+{
+  uint32_t crc = 0xffffffff;
+  int n, bit;
+
+  for (n = 0; n < length; n++)
+  {
+    crc ^= data[n];
+
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+  }
+
+  return crc ^ 0xffffffff;
+}
+
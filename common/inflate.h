@@ -0,0 +1,25 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _INFLATE_H
+#define _INFLATE_H
+
+#include <stdint.h>
+
+// Decompress a raw deflate stream (RFC 1951) as stored in zip / jar
+// files.  Returns the number of bytes written to out or -1 if the data
+// is corrupt or doesn't fit in out_length bytes.
+int inflate(uint8_t *out, int out_length, const uint8_t *in, int in_length);
+
+uint32_t crc32(const uint8_t *data, int length);
+
+#endif
+
@@ -0,0 +1,301 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JavaClass.h"
+#include "MethodIR.h"
+#include "inline_methods.h"
+
+// Small static methods of the same class get spliced into the caller in
+// place of the invokestatic.  The arguments are stored into locals past
+// the end of the caller's frame, the callee's locals are renumbered to
+// start there and the return at the end is dropped so the return value
+// is simply left on the stack.  The result is a copy of the method's
+// Code attribute that MethodIR::build() can use instead of the original.
+
+static void put_uint16(uint8_t *b, int value)
+{
+  b[0] = (value >> 8) & 0xff;
+  b[1] = value & 0xff;
+}
+
+static void put_int32(uint8_t *b, int value)
+{
+  b[0] = (value >> 24) & 0xff;
+  b[1] = (value >> 16) & 0xff;
+  b[2] = (value >> 8) & 0xff;
+  b[3] = value & 0xff;
+}
+
+static int find_method(JavaClass *java_class, int ref)
+{
+  constant_methodref_t *constant_methodref;
+  constant_nameandtype_t *constant_nameandtype;
+  const char *name;
+  const char *descriptor;
+
+  constant_methodref = (constant_methodref_t *)java_class->get_constant(ref);
+
+  if (constant_methodref->tag != CONSTANT_METHODREF) { return -1; }
+
+  // Only methods of this class share its constant pool.
+  if (constant_methodref->class_index != java_class->this_class) { return -1; }
+
+  constant_nameandtype = (constant_nameandtype_t *)
+    java_class->get_constant(constant_methodref->name_and_type_index);
+
+  name = java_class->get_constant_name(constant_nameandtype->name_index);
+  descriptor = java_class->get_constant_name(constant_nameandtype->descriptor_index);
+
+  if (name == NULL || descriptor == NULL) { return -1; }
+
+  return java_class->get_method_index(name, descriptor);
+}
+
+static bool can_inline(JavaClass *java_class, int method_id, int max_size, MethodIR *ir)
+{
+  struct methods_t *method = java_class->get_method(method_id);
+  char descriptor[256];
+  uint8_t types[256];
+  int count, n;
+
+  if ((method->access_flags & ACC_STATIC) == 0) { return false; }
+  if (method->attribute_count == 0) { return false; }
+
+  if (ir->build(java_class, method_id) != 0) { return false; }
+
+  // Exception handlers would need their ranges moved.
+  if (ir->get_pc_start() != 8) { return false; }
+  if (ir->get_code_len() > max_size) { return false; }
+
+  java_class->get_name_constant(descriptor, sizeof(descriptor), method->descriptor_index);
+  count = MethodIR::get_params(descriptor, types, sizeof(types));
+
+  for (n = 0; n < count; n++)
+  {
+    if (types[n] != JAVA_TYPE_INTEGER &&
+        types[n] != JAVA_TYPE_FLOAT &&
+        types[n] != JAVA_TYPE_REF)
+    {
+      return false;
+    }
+  }
+
+  // Straight line code ending in the only return.
+  count = ir->get_instr_count();
+
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir->get_instr(n);
+
+    if (instr->wide) { return false; }
+    if ((instr->flags & (IR_FLAG_BRANCH | IR_FLAG_SWITCH)) != 0) { return false; }
+    if ((instr->flags & IR_FLAG_TERMINATOR) != 0 && n != count - 1) { return false; }
+  }
+
+  if (count == 0) { return false; }
+
+  int opcode = ir->get_instr(count - 1)->opcode;
+
+  // ireturn, freturn, areturn, return
+  if (opcode != 0xac && opcode != 0xae && opcode != 0xb0 && opcode != 0xb1)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+static int splice_method(JavaClass *java_class, int method_id, MethodIR *ir, uint8_t *b, int base)
+{
+  struct methods_t *method = java_class->get_method(method_id);
+  uint8_t *code = ir->get_bytes() + ir->get_pc_start();
+  char descriptor[256];
+  uint8_t types[256];
+  int count, local, opcode, n;
+  int ptr = 0;
+
+  java_class->get_name_constant(descriptor, sizeof(descriptor), method->descriptor_index);
+  count = MethodIR::get_params(descriptor, types, sizeof(types));
+
+  // The last argument is on top of the stack.
+  for (n = count - 1; n >= 0; n--)
+  {
+    if (types[n] == JAVA_TYPE_FLOAT) { opcode = 0x38; }
+    else if (types[n] == JAVA_TYPE_REF) { opcode = 0x3a; }
+    else { opcode = 0x36; }
+
+    ptr += MethodIR::encode_local(b + ptr, opcode, base + n);
+  }
+
+  count = ir->get_instr_count();
+
+  for (n = 0; n < count - 1; n++)
+  {
+    ir_instr_t *instr = ir->get_instr(n);
+
+    local = MethodIR::get_local_access(instr, &opcode);
+
+    if (opcode != -1 && opcode != 0x84 && opcode != 0xa9)
+    {
+      ptr += MethodIR::encode_local(b + ptr, opcode, base + local);
+    }
+      else
+    if (instr->opcode == 0x84)
+    {
+      b[ptr++] = 0x84;
+      b[ptr++] = base + instr->operand;
+      b[ptr++] = instr->operand2;
+    }
+      else
+    {
+      memcpy(b + ptr, code + instr->address, instr->length);
+      ptr += instr->length;
+    }
+  }
+
+  return ptr;
+}
+
+int inline_methods(JavaClass *java_class, int method_id, int max_size, uint8_t **code, bool verbose)
+{
+  MethodIR ir;
+  MethodIR callee;
+  int extra_stack = 0;
+  int extra_locals = 0;
+  int sites = 0;
+  int size = 0;
+  int count, base, ptr, n;
+
+  *code = NULL;
+
+  // Anything odd is left for compile_method() to deal with (or complain
+  // about) on the original bytecode.
+  if (ir.build(java_class, method_id) != 0) { return 0; }
+  if (ir.get_pc_start() != 8) { return 0; }
+
+  count = ir.get_instr_count();
+  base = ir.get_max_locals();
+
+  int *callees = (int *)alloca(count * sizeof(int));
+
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+
+    callees[n] = -1;
+
+    // Switch padding depends on the address, so moving code around
+    // would change the length of the switch.
+    if ((instr->flags & IR_FLAG_SWITCH) != 0) { return 0; }
+
+    // invokestatic
+    if (instr->opcode != 0xb8) { continue; }
+
+    int id = find_method(java_class, instr->operand);
+
+    if (id == -1 || id == method_id) { continue; }
+
+    // A call whose result is popped still leaves it in the return
+    // register (and the interpreter's last return value), which is where
+    // the tests in tests/ read their answer from, so keep the call.
+    if (n + 1 < count && ir.get_instr(n + 1)->opcode == 0x57) { continue; }
+
+    if (!can_inline(java_class, id, max_size, &callee)) { continue; }
+    if (base + callee.get_max_locals() > 256) { continue; }
+
+    callees[n] = id;
+    sites++;
+
+    // Every load / store can grow to 2 bytes plus the argument stores.
+    size += callee.get_code_len() * 2 + callee.get_param_count() * 2;
+
+    if (callee.get_max_stack() > extra_stack) { extra_stack = callee.get_max_stack(); }
+    if (callee.get_max_locals() > extra_locals) { extra_locals = callee.get_max_locals(); }
+  }
+
+  if (sites == 0) { return 0; }
+
+  uint8_t *bytes = ir.get_bytes() + ir.get_pc_start();
+  uint8_t *b = (uint8_t *)malloc(8 + ir.get_code_len() + size + 4);
+  int *new_address = (int *)alloca((ir.get_code_len() + 1) * sizeof(int));
+
+  ptr = 8;
+
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+
+    new_address[instr->address] = ptr - 8;
+
+    if (callees[n] == -1)
+    {
+      memcpy(b + ptr, bytes + instr->address, instr->length);
+      ptr += instr->length;
+      continue;
+    }
+
+    callee.build(java_class, callees[n]);
+
+    ptr += splice_method(java_class, callees[n], &callee, b + ptr, base);
+  }
+
+  // Branches in the caller have to be pointed at the moved code.
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+
+    if ((instr->flags & IR_FLAG_BRANCH) == 0) { continue; }
+
+    int address = new_address[instr->address];
+    int offset = new_address[instr->target] - address;
+
+    if (instr->opcode == 0xc8 || instr->opcode == 0xc9)
+    {
+      put_int32(b + 8 + address + 1, offset);
+    }
+      else
+    {
+      if (offset < -32768 || offset > 32767)
+      {
+        free(b);
+        return 0;
+      }
+
+      put_uint16(b + 8 + address + 1, offset);
+    }
+  }
+
+  put_uint16(b + 0, ir.get_max_stack() + extra_stack);
+  put_uint16(b + 2, base + extra_locals);
+  put_int32(b + 4, ptr - 8);
+
+  // Empty exception table and no attributes.
+  memset(b + ptr, 0, 4);
+
+  if (verbose)
+  {
+    char method_name[128];
+
+    java_class->get_method_name(method_name, sizeof(method_name), method_id);
+    printf("Inlined %d call(s) into %s (%d -> %d bytes)\n",
+      sites, method_name, ir.get_code_len(), ptr - 8);
+  }
+
+  *code = b;
+
+  return sites;
+}
+
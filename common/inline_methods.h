@@ -0,0 +1,22 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _INLINE_METHODS_H
+#define _INLINE_METHODS_H
+
+#include <stdint.h>
+
+#include "JavaClass.h"
+
+int inline_methods(JavaClass *java_class, int method_id, int max_size, uint8_t **code, bool verbose);
+
+#endif
+
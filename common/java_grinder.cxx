@@ -12,9 +12,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
 
+#include "Encoder.h"
 #include "Generator.h"
+#include "ClassCache.h"
+#include "ClassPath.h"
+#include "CompileCache.h"
+#include "CompileStats.h"
 #include "Compiler.h"
+#include "Cycles.h"
+#include "Interpreter.h"
 #include "JavaCompiler.h"
 #include "execute_static.h"
 #include "AppleIIgs.h"
@@ -265,13 +275,456 @@ static Generator *new_generator(const char *chip_type)
   return generator;
 }
 
+static int write_text(const char *filename, const char *text, int length)
+{
+  FILE *out = fopen(filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Couldn't open file %s for writing.\n", filename);
+    return -1;
+  }
+
+  fwrite(text, 1, length, out);
+  fclose(out);
+
+  return 0;
+}
+
+static int write_object(Encoder *encoder, const char *text, int length, const char *asm_file, const char *hex_file, const char *bin_file)
+{
+  if (asm_file != NULL)
+  {
+    if (write_text(asm_file, text, length) != 0) { return -1; }
+  }
+
+  if (encoder->assemble(text, length) != 0) { return -1; }
+
+  if (hex_file != NULL)
+  {
+    if (encoder->write_hex(hex_file) != 0) { return -1; }
+  }
+
+  if (bin_file != NULL)
+  {
+    if (encoder->write_bin(bin_file) != 0) { return -1; }
+  }
+
+  return 0;
+}
+
+// Wall clock time spent in each step of compiling a class (-time).
+struct phase_times_t
+{
+  double load_class;
+  double static_field_defines;
+  double static_initializers;
+  double compile_methods;
+  double constants;
+  double output;
+};
+
+static double get_time()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// Add the time since *start to *phase and start the next phase.
+static void end_phase(double *phase, double *start)
+{
+  double now = get_time();
+
+  *phase += now - *start;
+  *start = now;
+}
+
+static void print_phase_times(phase_times_t *times)
+{
+  double total = times->load_class + times->static_field_defines +
+                 times->static_initializers + times->compile_methods +
+                 times->constants + times->output;
+
+  printf("Phase times:\n");
+  printf("  %-28s %10.3f ms\n", "load_class", times->load_class * 1000);
+  printf("  %-28s %10.3f ms\n", "insert_static_field_defines", times->static_field_defines * 1000);
+  printf("  %-28s %10.3f ms\n", "add_static_initializers", times->static_initializers * 1000);
+  printf("  %-28s %10.3f ms\n", "compile_methods", times->compile_methods * 1000);
+  printf("  %-28s %10.3f ms\n", "add_constants", times->constants * 1000);
+  printf("  %-28s %10.3f ms\n", "output", times->output * 1000);
+  printf("  %-28s %10.3f ms\n", "total", total * 1000);
+}
+
+struct options_t
+{
+  bool optimize;
+  bool verbose;
+  int inline_size;
+  int threads;
+  bool cycles;
+  char class_paths[1024];
+  ClassPath *class_path;
+};
+
+struct batch_job_t
+{
+  char java_file[1024];
+  char asm_file[1024];
+  char chip_type[64];
+  int ret;
+  bool cached;
+};
+
+struct batch_t
+{
+  batch_job_t *jobs;
+  int count;
+  int next;
+  int threads;
+  options_t *options;
+  ClassCache *class_cache;
+  CompileCache *compile_cache;
+};
+
+static void configure(JavaCompiler *compiler, options_t *options)
+{
+  if (!options->optimize) { compiler->disable_optimizer(); }
+  if (options->verbose) { compiler->set_verbose(); }
+  compiler->set_inline_size(options->inline_size);
+  compiler->set_threads(options->threads);
+  compiler->set_class_path(options->class_path);
+}
+
+// Everything besides the class files that changes what gets generated.
+static void get_settings(char *settings, int len, options_t *options, const char *chip_type)
+{
+  snprintf(settings, len, "%s O%d inline=%d cycles=%d cp=%s",
+    chip_type, options->optimize ? 1 : 0, options->inline_size,
+    options->cycles ? 1 : 0, options->class_paths);
+}
+
+static int compile_class(Compiler *compiler, Generator *generator, phase_times_t *times)
+{
+  double start = get_time();
+  int ret = 0;
+
+  compiler->insert_static_field_defines();
+  compiler->init_heap();
+  end_phase(&times->static_field_defines, &start);
+
+  do
+  {
+    if (compiler->add_static_initializers() == -1) { ret = -1; break; }
+    end_phase(&times->static_initializers, &start);
+    // Add the main function directly under init to save a jmp.
+    if (compiler->compile_methods(true) == -1) { ret = -1; break; }
+    // Compile all other methods.
+    if (compiler->compile_methods(false) == -1) { ret = -1; break; }
+    end_phase(&times->compile_methods, &start);
+    // Add constants at end if needed.
+    if (compiler->add_constants() == -1) { ret = -1; break; }
+  } while(0);
+
+  // Add any extra hardcoded functions needed at the end.
+  generator->add_functions();
+  end_phase(&times->constants, &start);
+
+  return ret;
+}
+
+static int compile_job(batch_t *batch, batch_job_t *job)
+{
+  CompileCache *compile_cache = batch->compile_cache;
+  phase_times_t times;
+  Generator *generator;
+  JavaCompiler *compiler;
+  char settings[1200];
+  char *text = NULL;
+  size_t text_length = 0;
+  int ret;
+
+  if (compile_cache != NULL)
+  {
+    int length;
+
+    get_settings(settings, sizeof(settings), batch->options, job->chip_type);
+
+    if (compile_cache->lookup(job->java_file, settings, &text, &length) == 0)
+    {
+      job->cached = true;
+      ret = write_text(job->asm_file, text, length);
+      free(text);
+
+      return ret;
+    }
+  }
+
+  generator = new_generator(job->chip_type);
+
+  if (generator == NULL)
+  {
+    printf("Unknown cpu type: %s\n", job->chip_type);
+    return -1;
+  }
+
+  if (compile_cache != NULL) { generator->set_buffer(&text, &text_length); }
+
+  if (generator->open(compile_cache != NULL ? NULL : job->asm_file) == -1)
+  {
+    delete generator;
+    return -1;
+  }
+
+  compiler = new JavaCompiler();
+  configure(compiler, batch->options);
+  compiler->set_class_cache(batch->class_cache);
+  compiler->set_generator(generator);
+
+  // The jobs already keep every core busy.
+  if (batch->threads > 1) { compiler->set_threads(1); }
+
+  if (compiler->load_class(job->java_file) == -1)
+  {
+    printf("Couldn't open class file '%s'\n", job->java_file);
+    ret = -1;
+  }
+    else
+  {
+    memset(&times, 0, sizeof(times));
+    ret = compile_class(compiler, generator, &times);
+  }
+
+  delete generator;
+
+  if (compile_cache != NULL)
+  {
+    if (ret == 0) { ret = write_text(job->asm_file, text, text_length); }
+
+    if (ret == 0)
+    {
+      compile_cache->store(job->java_file, settings,
+        compiler->get_class_files(), text, text_length);
+    }
+
+    free(text);
+  }
+
+  delete compiler;
+
+  return ret;
+}
+
+static void *batch_worker(void *context)
+{
+  batch_t *batch = (batch_t *)context;
+  int n;
+
+  while(1)
+  {
+    n = __sync_fetch_and_add(&batch->next, 1);
+
+    if (n >= batch->count) { break; }
+
+    batch->jobs[n].ret = compile_job(batch, &batch->jobs[n]);
+  }
+
+  return NULL;
+}
+
+static int read_manifest(const char *filename, batch_t *batch)
+{
+  FILE *in;
+  char line[4096];
+  char extra[2];
+  int line_number = 0;
+  int size = 16;
+
+  in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Couldn't open manifest '%s'\n", filename);
+    return -1;
+  }
+
+  batch->jobs = (batch_job_t *)malloc(size * sizeof(batch_job_t));
+  batch->count = 0;
+
+  while(fgets(line, sizeof(line), in) != NULL)
+  {
+    char *s = line;
+
+    line_number++;
+
+    while(*s == ' ' || *s == '\t') { s++; }
+    if (*s == '#' || *s == '\n' || *s == '\r' || *s == 0) { continue; }
+
+    if (batch->count == size)
+    {
+      size *= 2;
+      batch->jobs = (batch_job_t *)realloc(batch->jobs, size * sizeof(batch_job_t));
+    }
+
+    batch_job_t *job = &batch->jobs[batch->count];
+
+    if (sscanf(s, "%1023s %1023s %63s %1s",
+               job->java_file, job->asm_file, job->chip_type, extra) != 3)
+    {
+      printf("Error: %s:%d should be <class> <outfile> <platform>\n",
+        filename, line_number);
+      fclose(in);
+      return -1;
+    }
+
+    job->ret = 0;
+    job->cached = false;
+    batch->count++;
+  }
+
+  fclose(in);
+
+  return 0;
+}
+
+// Compile every <class> <outfile> <platform> line of a manifest in one
+// process.  Class files are parsed once and shared between the jobs,
+// and the jobs are run on a pool of threads.
+static int run_batch(const char *manifest, options_t *options, CompileCache *compile_cache)
+{
+  batch_t batch;
+  ClassCache class_cache;
+  pthread_t *threads;
+  int failed = 0;
+  int n;
+
+  if (read_manifest(manifest, &batch) != 0)
+  {
+    free(batch.jobs);
+    return -1;
+  }
+
+  batch.next = 0;
+  batch.options = options;
+  batch.class_cache = &class_cache;
+  batch.compile_cache = compile_cache;
+  batch.threads = options->threads;
+
+  if (batch.threads <= 0) { batch.threads = sysconf(_SC_NPROCESSORS_ONLN); }
+  if (options->verbose) { batch.threads = 1; }
+  if (batch.threads > batch.count) { batch.threads = batch.count; }
+
+  if (batch.threads <= 1)
+  {
+    batch_worker(&batch);
+  }
+    else
+  {
+    threads = (pthread_t *)alloca(batch.threads * sizeof(pthread_t));
+
+    for (n = 0; n < batch.threads - 1; n++)
+    {
+      if (pthread_create(&threads[n], NULL, batch_worker, &batch) != 0)
+      {
+        break;
+      }
+    }
+
+    batch_worker(&batch);
+
+    while(n-- > 0)
+    {
+      pthread_join(threads[n], NULL);
+    }
+  }
+
+  printf("\n");
+
+  for (n = 0; n < batch.count; n++)
+  {
+    batch_job_t *job = &batch.jobs[n];
+
+    printf("%s %s -> %s (%s)\n",
+      job->ret != 0 ? "FAILED" : (job->cached ? "cached" : "    ok"),
+      job->java_file, job->asm_file, job->chip_type);
+
+    if (job->ret != 0) { failed++; }
+  }
+
+  printf("%d of %d compiled\n", batch.count - failed, batch.count);
+
+  free(batch.jobs);
+
+  return failed == 0 ? 0 : -1;
+}
+
+// Run the class on the host instead of compiling it.  The result is
+// what tests/run_tests.sh reads out of r15 / $v0 on a simulator.
+static int run_interpreter(const char *java_file, options_t *options)
+{
+  JavaClass *java_class;
+  Interpreter *interpreter;
+  FILE *in;
+  int ret;
+
+  in = fopen(java_file, "rb");
+
+  if (in == NULL)
+  {
+    printf("Couldn't open class file '%s'\n", java_file);
+    return -1;
+  }
+
+  java_class = new JavaClass(in);
+  fclose(in);
+
+  interpreter = new Interpreter(java_class);
+  if (!options->optimize) { interpreter->disable_optimizer(); }
+  if (options->verbose) { interpreter->set_verbose(); }
+  interpreter->set_inline_size(options->inline_size);
+
+  ret = interpreter->run_static_initializers();
+  if (ret == 0) { ret = interpreter->run_main(); }
+
+  if (ret == 0)
+  {
+    printf("result=%d\n", interpreter->get_result());
+  }
+
+  printf("%ld bytecodes executed\n", interpreter->get_steps());
+
+  delete interpreter;
+  delete java_class;
+
+  return ret;
+}
+
 int main(int argc, char *argv[])
 {
   Generator *generator;
-  Compiler *compiler;
+  JavaCompiler *compiler;
+  options_t options;
+  const char *manifest = NULL;
+  bool interpret = false;
+  const char *cache_dir = NULL;
+  CompileCache *compile_cache = NULL;
+  const char *stats_file = NULL;
+  CompileStats *stats = NULL;
+  bool timing = false;
+  phase_times_t times;
+  Encoder *stats_encoder = NULL;
+  Cycles *cycles = NULL;
   const char *java_file = "";
   const char *asm_file = "";
   const char *chip_type = "";
+  const char *hex_file = NULL;
+  const char *bin_file = NULL;
+  const char *args[3];
+  Encoder *encoder = NULL;
+  char *text = NULL;
+  size_t text_length = 0;
   int option = 0;
   int n;
 
@@ -281,12 +734,43 @@ int main(int argc, char *argv[])
          "  Email: mike@mikekohn.net\n\n"
          "Version: " VERSION "\n\n");
 
-  if (argc < 4)
+  options.optimize = true;
+  options.verbose = false;
+  options.inline_size = 8;
+  options.threads = 0;
+  options.cycles = false;
+  options.class_paths[0] = 0;
+  options.class_path = NULL;
+
+  if (argc < 3 || (argc == 3 && strcmp(argv[1], "-batch") != 0 &&
+                   strcmp(argv[1], "-interpret") != 0))
   {
-    printf("Usage: %s [ -v -O0 ] <class> <outfile> <platform>\n"
+    printf("Usage: %s [ -v -O0 -inline <n> -j <n> -cp <path> -cache <dir> -stats <file> -cycles -time ] <class> <outfile> <platform>\n"
+           "       %s [ options ] -hex <file> | -bin <file> <class> [ <outfile> ] <platform>\n"
+           "       %s [ options ] -batch <manifest>\n"
+           "       %s [ -v -O0 -inline <n> ] -interpret <class>\n"
            "   options:\n"
            "     -v verbose output\n"
            "     -O0 turn off optimizer\n"
+           "     -inline <n> inline static methods up to n bytes (default 8, 0=off)\n"
+           "     -j <n> analyze methods on n threads (default: one per cpu)\n"
+           "     -hex <file> assemble to Intel hex (msp430g2xxx, m6502, c64, mips32, pic32)\n"
+           "     -bin <file> assemble to a raw binary\n"
+           "     -batch <manifest> compile each <class> <outfile> <platform> line\n"
+           "        of manifest in one process (-j sets how many at a time)\n"
+           "     -cp <path> also look for external classes in these directories\n"
+           "        and .jar files (separated with ':')\n"
+           "     -stats <file> write per method code size and optimizer numbers\n"
+           "        as JSON (code size is estimated without a built-in assembler)\n"
+           "     -cycles add worst case cycle counts to the assembly listing\n"
+           "        (msp430g2xxx, m6502, c64, m6502_8, atari2600, atmega / attiny,\n"
+           "        mips32, pic32, z80, cpc, msx, ti84plus)\n"
+           "     -time print how long each step of compiling took\n"
+           "     -cache <dir> reuse output from <dir> when the class files, platform\n"
+           "        and options haven't changed since it was generated\n"
+           "     -interpret run main() on this computer and print the last int\n"
+           "        a method returned (optimized methods are checked against\n"
+           "        what the optimizer worked out about them)\n"
            "   platforms:\n"
            "     8051\n"
            "     appleiigs\n"
@@ -301,43 +785,165 @@ int main(int argc, char *argv[])
            "     ti99\n"
            "     w65c134sxb, w65c265sxb\n"
            "     x86\n"
-           "     z80, cpc, msx, ti84plus\n", argv[0]);
+           "     z80, cpc, msx, ti84plus\n", argv[0], argv[0], argv[0], argv[0]);
     exit(0);
   }
 
-  // Can we do .NET too? :)
-  compiler = new JavaCompiler();
-
   for (n = 1; n < argc; n++)
   {
     if (strcmp(argv[n], "-O0") == 0)
     {
-      compiler->disable_optimizer();
+      options.optimize = false;
       continue;
     }
       else
     if (strcmp(argv[n], "-v") == 0)
     {
-      compiler->set_verbose();
+      options.verbose = true;
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-inline") == 0 && n + 1 < argc)
+    {
+      options.inline_size = atoi(argv[++n]);
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-j") == 0 && n + 1 < argc)
+    {
+      options.threads = atoi(argv[++n]);
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-batch") == 0 && n + 1 < argc)
+    {
+      manifest = argv[++n];
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-interpret") == 0)
+    {
+      interpret = true;
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-cp") == 0 && n + 1 < argc)
+    {
+      n++;
+
+      if (strlen(options.class_paths) + strlen(argv[n]) + 2 > sizeof(options.class_paths))
+      {
+        printf("Error: -cp is too long.\n");
+        exit(1);
+      }
+
+      if (options.class_paths[0] != 0) { strcat(options.class_paths, ":"); }
+      strcat(options.class_paths, argv[n]);
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-stats") == 0 && n + 1 < argc)
+    {
+      stats_file = argv[++n];
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-cycles") == 0)
+    {
+      options.cycles = true;
       continue;
     }
       else
-    if (option == 0)
+    if (strcmp(argv[n], "-time") == 0)
     {
-      java_file = argv[n];
+      timing = true;
+      continue;
+    }
+      else
+    if (strcmp(argv[n], "-cache") == 0 && n + 1 < argc)
+    {
+      cache_dir = argv[++n];
+      continue;
     }
       else
-    if (option == 1)
+    if (strcmp(argv[n], "-hex") == 0 && n + 1 < argc)
     {
-      asm_file = argv[n];
+      hex_file = argv[++n];
+      continue;
     }
       else
-    if (option == 2)
+    if (strcmp(argv[n], "-bin") == 0 && n + 1 < argc)
+    {
+      bin_file = argv[++n];
+      continue;
+    }
+      else
+    if (option < 3)
+    {
+      args[option++] = argv[n];
+    }
+  }
+
+  if (options.class_paths[0] != 0)
+  {
+    options.class_path = new ClassPath();
+
+    if (options.class_path->add(options.class_paths) != 0) { exit(1); }
+  }
+
+  if (cache_dir != NULL)
+  {
+    compile_cache = new CompileCache(cache_dir, argv[0]);
+  }
+
+  if (interpret)
+  {
+    if (option != 1 || manifest != NULL || hex_file != NULL || bin_file != NULL ||
+        stats_file != NULL || options.cycles || cache_dir != NULL || timing)
     {
-      chip_type = argv[n];
+      printf("Error: -interpret only takes a class file.\n");
+      exit(1);
     }
 
-    option++;
+    int ret = run_interpreter(args[0], &options);
+
+    delete options.class_path;
+
+    return ret == 0 ? 0 : 1;
+  }
+
+  if (manifest != NULL)
+  {
+    if (option != 0 || hex_file != NULL || bin_file != NULL ||
+        stats_file != NULL || options.cycles || timing)
+    {
+      printf("Error: -batch takes its classes and platforms from the manifest (and doesn't do -stats, -cycles or -time).\n");
+      exit(1);
+    }
+
+    int ret = run_batch(manifest, &options, compile_cache);
+
+    delete compile_cache;
+    delete options.class_path;
+
+    return ret == 0 ? 0 : 1;
+  }
+
+  bool assemble = hex_file != NULL || bin_file != NULL;
+
+  if (option == 3)
+  {
+    java_file = args[0];
+    asm_file = args[1];
+    chip_type = args[2];
+  }
+    else
+  if (option == 2 && assemble)
+  {
+    // Without an outfile the assembly only lives in memory.
+    java_file = args[0];
+    asm_file = NULL;
+    chip_type = args[1];
   }
 
   if (chip_type[0] == 0)
@@ -354,13 +960,103 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
-  if (generator->open(asm_file) == -1)
+  if (assemble)
+  {
+    encoder = generator->new_encoder();
+
+    if (encoder == NULL)
+    {
+      printf("Error: No built-in assembler for %s, use naken_asm.\n", chip_type);
+      exit(1);
+    }
+  }
+
+  if (stats_file != NULL || options.cycles)
+  {
+    cycles = generator->new_cycles();
+
+    if (cycles == NULL && options.cycles)
+    {
+      printf("Error: No instruction timings for %s.\n", chip_type);
+      exit(1);
+    }
+  }
+
+  // Cached output can't say anything about the methods in it so -stats
+  // always compiles.
+  if (compile_cache != NULL && stats_file == NULL)
+  {
+    char settings[1200];
+    int length;
+
+    get_settings(settings, sizeof(settings), &options, chip_type);
+
+    if (compile_cache->lookup(java_file, settings, &text, &length) == 0)
+    {
+      char *unused = NULL;
+      size_t unused_length = 0;
+      int ret;
+
+      printf("Using cached output for %s (%s)\n", java_file, chip_type);
+
+      // Some destructors write out the end of the program so the
+      // generator gets somewhere to write it before it's deleted.
+      generator->set_buffer(&unused, &unused_length);
+
+      if (generator->open(NULL) == 0) { delete generator; }
+      free(unused);
+
+      if (encoder != NULL)
+      {
+        ret = write_object(encoder, text, length, asm_file, hex_file, bin_file);
+        delete encoder;
+      }
+        else
+      {
+        ret = write_text(asm_file, text, length);
+      }
+
+      free(text);
+      delete cycles;
+      delete compile_cache;
+      delete options.class_path;
+
+      return ret;
+    }
+  }
+
+  bool in_memory = assemble || compile_cache != NULL || stats_file != NULL ||
+                   options.cycles;
+
+  if (in_memory) { generator->set_buffer(&text, &text_length); }
+
+  // -cycles uses the method boundaries -stats records.
+  if (stats_file != NULL || options.cycles)
+  {
+    stats = new CompileStats();
+    stats->set_instruction_size(generator->get_instruction_size());
+
+    // Method sizes in bytes need an assembler.
+    if (encoder == NULL && stats_file != NULL)
+    {
+      stats_encoder = generator->new_encoder();
+    }
+  }
+
+  if (generator->open(in_memory ? NULL : asm_file) == -1)
   {
     delete generator;
     exit(1);
   }
 
+  // Can we do .NET too? :)
+  compiler = new JavaCompiler();
+  configure(compiler, &options);
   compiler->set_generator(generator);
+  compiler->set_stats(stats);
+
+  memset(&times, 0, sizeof(times));
+  double start = get_time();
 
   if (compiler->load_class(java_file) == -1)
   {
@@ -369,29 +1065,74 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
-  int ret = 0;
+  end_phase(&times.load_class, &start);
 
-  compiler->insert_static_field_defines();
-  compiler->init_heap();
+  int ret = compile_class(compiler, generator, &times);
 
-  do
+  start = get_time();
+
+  // Some generators write their tail end (constants, vectors) from their
+  // destructor so the buffer is only complete after this.
+  delete generator;
+
+  // The JSON is written first since the method offsets are into the
+  // text as it was before -cycles adds its comments.
+  if (stats != NULL)
   {
-    if (compiler->add_static_initializers() == -1) { ret = -1; break; }
-    // Add the main function directly under init to save a jmp.
-    if (compiler->compile_methods(true) == -1) { ret = -1; break; }
-    // Compile all other methods.
-    if (compiler->compile_methods(false) == -1) { ret = -1; break; }
-    // Add constants at end if needed.
-    if (compiler->add_constants() == -1) { ret = -1; break; }
-  } while(0);
+    if (ret == 0 && cycles != NULL)
+    {
+      stats->count_cycles(text, text_length, cycles);
+    }
 
-  // Add any extra hardcoded functions needed at the end.
-  generator->add_functions();
+    if (ret == 0 && stats_file != NULL)
+    {
+      ret = stats->write_json(stats_file, java_file, chip_type, text, text_length,
+        encoder != NULL ? encoder : stats_encoder);
+    }
+
+    if (ret == 0 && options.cycles)
+    {
+      ret = stats->annotate_cycles(&text, &text_length, cycles);
+    }
+
+    delete stats;
+    delete stats_encoder;
+  }
+
+  delete cycles;
+
+  if (compile_cache != NULL && ret == 0)
+  {
+    char settings[1200];
+
+    get_settings(settings, sizeof(settings), &options, chip_type);
+    compile_cache->store(java_file, settings, compiler->get_class_files(), text, text_length);
+  }
 
-  delete generator;
   delete compiler;
 
-  return ret;
-}
+  if (encoder != NULL)
+  {
+    if (ret == 0)
+    {
+      ret = write_object(encoder, text, text_length, asm_file, hex_file, bin_file);
+    }
 
+    delete encoder;
+  }
+    else
+  if (in_memory)
+  {
+    if (ret == 0) { ret = write_text(asm_file, text, text_length); }
+  }
 
+  free(text);
+  delete compile_cache;
+  delete options.class_path;
+
+  end_phase(&times.output, &start);
+
+  if (timing) { print_phase_times(&times); }
+
+  return ret;
+}
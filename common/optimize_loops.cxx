@@ -0,0 +1,628 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JavaClass.h"
+#include "MethodIR.h"
+#include "optimize_loops.h"
+
+// Rewrites the bytecode of loops found on the CFG before the method is
+// compiled:
+//
+//   getstatic / aload; arraylength  of an array that can't change in the
+//     loop is computed once before the loop into a new local.
+//   iload i; <const>; imul  where i only changes by iinc in the loop is
+//     replaced by a new local that is set to i * const before the loop
+//     and bumped by step * const next to every iinc of i.
+//
+// The new code goes in a preheader in front of the loop header.  Edges
+// from outside the loop enter through it and the loop's own edges skip
+// it.  The result is a copy of the Code attribute like inline_methods().
+
+#define MAX_LOOP_TEMPS 16
+
+#define TEMP_STATIC_LENGTH 0
+#define TEMP_LOCAL_LENGTH 1
+#define TEMP_INDUCTION 2
+
+struct loop_temp_t
+{
+  int loop;
+  int kind;
+  int key;          // fieldref constant or local
+  int const_instr;  // instruction pushing the multiplier
+  int scale;
+  int local;        // local the value is kept in
+};
+
+struct loop_edit_t
+{
+  int length;       // -1 keeps the original instruction
+  uint8_t code[4];
+  int after_length;
+  uint8_t after[MAX_LOOP_TEMPS * 6];
+};
+
+static void put_uint16(uint8_t *b, int value)
+{
+  b[0] = (value >> 8) & 0xff;
+  b[1] = value & 0xff;
+}
+
+static void put_int32(uint8_t *b, int value)
+{
+  b[0] = (value >> 24) & 0xff;
+  b[1] = (value >> 16) & 0xff;
+  b[2] = (value >> 8) & 0xff;
+  b[3] = value & 0xff;
+}
+
+static int innermost_loop(MethodIR *ir, int block)
+{
+  int loop = -1;
+  int n;
+
+  for (n = 0; n < ir->get_loop_count(); n++)
+  {
+    if (!ir->in_loop(n, block)) { continue; }
+
+    if (loop == -1 || ir->get_loop(n)->depth > ir->get_loop(loop)->depth)
+    {
+      loop = n;
+    }
+  }
+
+  return loop;
+}
+
+// Statics only change in the loop by a putstatic or inside a call.
+static bool is_static_invariant(JavaClass *java_class, MethodIR *ir, int loop, int field)
+{
+  char field_name[128];
+  char name[128];
+  char type[128];
+  int b, n;
+
+  java_class->get_ref_name_type(field_name, type, sizeof(field_name), field);
+
+  for (b = 0; b < ir->get_block_count(); b++)
+  {
+    if (!ir->in_loop(loop, b)) { continue; }
+
+    ir_block_t *block = ir->get_block(b);
+
+    for (n = block->first_instr; n < block->first_instr + block->instr_count; n++)
+    {
+      ir_instr_t *instr = ir->get_instr(n);
+
+      // invokevirtual, invokespecial, invokestatic, invokeinterface
+      if (instr->opcode >= 0xb6 && instr->opcode <= 0xb9) { return false; }
+
+      // putstatic
+      if (instr->opcode != 0xb3) { continue; }
+
+      java_class->get_ref_name_type(name, type, sizeof(name), instr->operand);
+
+      if (strcmp(name, field_name) == 0) { return false; }
+    }
+  }
+
+  return true;
+}
+
+// Returns how many times local is changed in the loop, or -1 if it's
+// changed by anything other than iinc.
+static int count_increments(MethodIR *ir, int loop, int local)
+{
+  int count = 0;
+  int opcode;
+  int b, n;
+
+  for (b = 0; b < ir->get_block_count(); b++)
+  {
+    if (!ir->in_loop(loop, b)) { continue; }
+
+    ir_block_t *block = ir->get_block(b);
+
+    for (n = block->first_instr; n < block->first_instr + block->instr_count; n++)
+    {
+      ir_instr_t *instr = ir->get_instr(n);
+
+      if (MethodIR::get_local_access(instr, &opcode) != local) { continue; }
+
+      if (opcode == 0x84)
+      {
+        if (instr->wide) { return -1; }
+        count++;
+      }
+        else
+      if (opcode >= 0x36 && opcode <= 0x3a)
+      {
+        return -1;
+      }
+    }
+  }
+
+  return count;
+}
+
+// Every iinc of local times scale has to fit a wide iinc.
+static bool steps_fit(MethodIR *ir, int loop, int local, int scale)
+{
+  int n;
+
+  for (n = 0; n < ir->get_instr_count(); n++)
+  {
+    ir_instr_t *instr = ir->get_instr(n);
+
+    if (instr->opcode != 0x84 || instr->operand != local) { continue; }
+    if (!ir->in_loop(loop, instr->block)) { continue; }
+
+    long long step = (long long)instr->operand2 * scale;
+
+    if (step < -32768 || step > 32767) { return false; }
+  }
+
+  return true;
+}
+
+static bool is_load(ir_instr_t *instr, int opcode)
+{
+  int load;
+
+  MethodIR::get_local_access(instr, &load);
+
+  return load == opcode;
+}
+
+static int add_temp(loop_temp_t *temps, int *temp_count, int loop, int kind, int key, int scale, int const_instr, int base)
+{
+  int n;
+
+  for (n = 0; n < *temp_count; n++)
+  {
+    if (temps[n].loop == loop && temps[n].kind == kind &&
+        temps[n].key == key && temps[n].scale == scale)
+    {
+      return n;
+    }
+  }
+
+  if (*temp_count == MAX_LOOP_TEMPS) { return -1; }
+
+  n = (*temp_count)++;
+
+  temps[n].loop = loop;
+  temps[n].kind = kind;
+  temps[n].key = key;
+  temps[n].scale = scale;
+  temps[n].const_instr = const_instr;
+  temps[n].local = base + n;
+
+  return n;
+}
+
+// The preheader can go in front of the goto into the loop when that's
+// the only way in (which is how javac lays out for and while loops).
+// Otherwise it goes in front of the header.
+static int find_entry(MethodIR *ir, int loop)
+{
+  int header = ir->get_loop(loop)->header;
+  ir_block_t *block = ir->get_block(header);
+  int entry = -1;
+  int n;
+
+  // The method itself starts at the header.
+  if (block->start == 0) { return block->first_instr; }
+
+  for (n = 0; n < block->pred_count; n++)
+  {
+    int pred = ir->get_pred(block, n);
+
+    if (ir->in_loop(loop, pred)) { continue; }
+    if (entry != -1) { return block->first_instr; }
+
+    ir_block_t *pred_block = ir->get_block(pred);
+
+    entry = pred_block->first_instr + pred_block->instr_count - 1;
+  }
+
+  if (entry == -1) { return block->first_instr; }
+
+  ir_instr_t *instr = ir->get_instr(entry);
+
+  // goto, goto_w
+  if ((instr->opcode != 0xa7 && instr->opcode != 0xc8) ||
+      instr->target != block->start)
+  {
+    return block->first_instr;
+  }
+
+  return entry;
+}
+
+static int write_preheader(MethodIR *ir, loop_temp_t *temps, int temp_count, int loop, uint8_t *b)
+{
+  uint8_t *bytes = ir->get_bytes() + ir->get_pc_start();
+  int ptr = 0;
+  int n;
+
+  for (n = 0; n < temp_count; n++)
+  {
+    loop_temp_t *temp = &temps[n];
+
+    if (temp->loop != loop) { continue; }
+
+    if (temp->kind == TEMP_STATIC_LENGTH)
+    {
+      // getstatic; arraylength
+      b[ptr++] = 0xb2;
+      put_uint16(b + ptr, temp->key);
+      ptr += 2;
+      b[ptr++] = 0xbe;
+    }
+      else
+    if (temp->kind == TEMP_LOCAL_LENGTH)
+    {
+      // aload; arraylength
+      ptr += MethodIR::encode_local(b + ptr, 0x19, temp->key);
+      b[ptr++] = 0xbe;
+    }
+      else
+    {
+      // iload; <const>; imul
+      ir_instr_t *instr = ir->get_instr(temp->const_instr);
+
+      ptr += MethodIR::encode_local(b + ptr, 0x15, temp->key);
+      memcpy(b + ptr, bytes + instr->address, instr->length);
+      ptr += instr->length;
+      b[ptr++] = 0x68;
+    }
+
+    ptr += MethodIR::encode_local(b + ptr, 0x36, temp->local);
+  }
+
+  return ptr;
+}
+
+int optimize_loops(JavaClass *java_class, int method_id, uint8_t *code, uint8_t **new_code, bool verbose)
+{
+  MethodIR ir;
+  loop_temp_t temps[MAX_LOOP_TEMPS];
+  int temp_count = 0;
+  int count, base, ptr, n, i;
+
+  *new_code = NULL;
+
+  if (ir.build(java_class, method_id, code) != 0) { return 0; }
+  if (ir.get_pc_start() != 8 || !ir.has_stack_info()) { return 0; }
+  if (ir.find_loops() == 0) { return 0; }
+
+  count = ir.get_instr_count();
+  base = ir.get_max_locals();
+
+  if (base + MAX_LOOP_TEMPS > 256) { return 0; }
+
+  loop_edit_t *edits = (loop_edit_t *)malloc(count * sizeof(loop_edit_t));
+
+  for (n = 0; n < count; n++)
+  {
+    edits[n].length = -1;
+    edits[n].after_length = 0;
+
+    // Switch padding depends on the address.
+    if ((ir.get_instr(n)->flags & IR_FLAG_SWITCH) != 0)
+    {
+      free(edits);
+      return 0;
+    }
+  }
+
+  for (n = 0; n + 1 < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+    ir_instr_t *next = ir.get_instr(n + 1);
+    int loop = innermost_loop(&ir, instr->block);
+    int temp = -1;
+
+    if (loop == -1 || next->block != instr->block) { continue; }
+
+    // Preheader code runs with nothing on the stack.
+    if (ir.get_block(ir.get_loop(loop)->header)->stack_depth != 0) { continue; }
+
+    if (instr->opcode == 0xb2 && next->opcode == 0xbe)
+    {
+      // getstatic; arraylength: hoist as far out as the array is invariant.
+      if (!is_static_invariant(java_class, &ir, loop, instr->operand)) { continue; }
+
+      while(true)
+      {
+        int parent = ir.get_loop(loop)->parent;
+
+        if (parent == -1) { break; }
+        if (ir.get_block(ir.get_loop(parent)->header)->stack_depth != 0) { break; }
+        if (!is_static_invariant(java_class, &ir, parent, instr->operand)) { break; }
+
+        loop = parent;
+      }
+
+      temp = add_temp(temps, &temp_count, loop, TEMP_STATIC_LENGTH, instr->operand, 0, -1, base);
+    }
+      else
+    if (is_load(instr, 0x19) && next->opcode == 0xbe)
+    {
+      // aload; arraylength in the loop condition.  Only the header is
+      // known to run on every entry, so a null array isn't read early.
+      int local, opcode;
+
+      local = MethodIR::get_local_access(instr, &opcode);
+
+      if (instr->block != ir.get_loop(loop)->header) { continue; }
+      if (count_increments(&ir, loop, local) != 0) { continue; }
+
+      temp = add_temp(temps, &temp_count, loop, TEMP_LOCAL_LENGTH, local, 0, -1, base);
+    }
+      else
+    if (n + 2 < count && ir.get_instr(n + 2)->block == instr->block &&
+        ir.get_instr(n + 2)->opcode == 0x68)
+    {
+      // iload i; <const>; imul  or  <const>; iload i; imul
+      ir_instr_t *load = instr;
+      int const_instr = n + 1;
+      int local, opcode;
+
+      if ((load->flags & IR_FLAG_CONST) != 0)
+      {
+        load = next;
+        const_instr = n;
+      }
+
+      if (!is_load(load, 0x15)) { continue; }
+      if ((ir.get_instr(const_instr)->flags & IR_FLAG_CONST) == 0) { continue; }
+
+      local = MethodIR::get_local_access(load, &opcode);
+
+      if (count_increments(&ir, loop, local) <= 0) { continue; }
+
+      int scale = ir.get_instr(const_instr)->const_value;
+
+      if (!steps_fit(&ir, loop, local, scale)) { continue; }
+
+      temp = add_temp(temps, &temp_count, loop, TEMP_INDUCTION, local, scale, const_instr, base);
+
+      if (temp == -1) { continue; }
+
+      ptr = MethodIR::encode_local(edits[n].code, 0x15, temps[temp].local);
+      edits[n].length = ptr;
+      edits[n + 1].length = 0;
+      edits[n + 2].length = 0;
+      n += 2;
+      continue;
+    }
+
+    if (temp == -1) { continue; }
+
+    // The array length is now a load of the temp.
+    edits[n].length = MethodIR::encode_local(edits[n].code, 0x15, temps[temp].local);
+    edits[n + 1].length = 0;
+    n++;
+  }
+
+  if (temp_count == 0)
+  {
+    free(edits);
+    return 0;
+  }
+
+  // Keep derived induction variables in step with i.
+  for (i = 0; i < temp_count; i++)
+  {
+    loop_temp_t *temp = &temps[i];
+
+    if (temp->kind != TEMP_INDUCTION) { continue; }
+
+    for (n = 0; n < count; n++)
+    {
+      ir_instr_t *instr = ir.get_instr(n);
+      loop_edit_t *edit = &edits[n];
+
+      if (instr->opcode != 0x84 || instr->operand != temp->key) { continue; }
+      if (!ir.in_loop(temp->loop, instr->block)) { continue; }
+
+      int step = instr->operand2 * temp->scale;
+
+      if (step >= -128 && step <= 127)
+      {
+        edit->after[edit->after_length++] = 0x84;
+        edit->after[edit->after_length++] = temp->local;
+        edit->after[edit->after_length++] = step & 0xff;
+      }
+        else
+      {
+        // wide iinc (overflow past 16 bits wraps the same as i * scale)
+        edit->after[edit->after_length++] = 0xc4;
+        edit->after[edit->after_length++] = 0x84;
+        put_uint16(edit->after + edit->after_length, temp->local);
+        put_uint16(edit->after + edit->after_length + 2, step);
+        edit->after_length += 4;
+      }
+    }
+  }
+
+  // Worst case every instruction gets a goto and every loop a preheader.
+  uint8_t *bytes = ir.get_bytes() + ir.get_pc_start();
+  int size = 8 + 4 + ir.get_code_len() + (count * 3) + (temp_count * 16);
+
+  for (n = 0; n < count; n++) { size += edits[n].after_length; }
+
+  uint8_t *b = (uint8_t *)malloc(size);
+  int *new_address = (int *)alloca((ir.get_code_len() + 1) * sizeof(int));
+  int *entry_address = (int *)alloca((ir.get_code_len() + 1) * sizeof(int));
+  int *goto_address = (int *)alloca(count * sizeof(int));
+  int *preheader_at = (int *)alloca(count * sizeof(int));
+  int *header_loop = (int *)alloca(ir.get_block_count() * sizeof(int));
+
+  for (n = 0; n < count; n++) { preheader_at[n] = -1; }
+  for (n = 0; n < ir.get_block_count(); n++) { header_loop[n] = -1; }
+
+  for (i = 0; i < temp_count; i++)
+  {
+    int loop = temps[i].loop;
+    int header = ir.get_loop(loop)->header;
+
+    if (header_loop[header] != -1) { continue; }
+
+    header_loop[header] = loop;
+
+    int entry = find_entry(&ir, loop);
+
+    if (preheader_at[entry] != -1) { entry = ir.get_block(header)->first_instr; }
+
+    // Two loops can't put their preheaders at the same place.
+    if (preheader_at[entry] != -1)
+    {
+      free(edits);
+      free(b);
+      return 0;
+    }
+
+    preheader_at[entry] = loop;
+  }
+
+  ptr = 8;
+
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+    ir_block_t *block = ir.get_block(instr->block);
+    loop_edit_t *edit = &edits[n];
+
+    goto_address[n] = -1;
+    entry_address[instr->address] = ptr - 8;
+
+    if (preheader_at[n] != -1)
+    {
+      ptr += write_preheader(&ir, temps, temp_count, preheader_at[n], b + ptr);
+    }
+
+    new_address[instr->address] = ptr - 8;
+
+    if (edit->length == -1)
+    {
+      memcpy(b + ptr, bytes + instr->address, instr->length);
+      ptr += instr->length;
+    }
+      else
+    {
+      memcpy(b + ptr, edit->code, edit->length);
+      ptr += edit->length;
+    }
+
+    memcpy(b + ptr, edit->after, edit->after_length);
+    ptr += edit->after_length;
+
+    // A loop block falling into a header that has its preheader in
+    // front of it has to jump over it.
+    if (n + 1 < count && block->first_instr + block->instr_count == n + 1)
+    {
+      int next_loop = preheader_at[n + 1];
+
+      if (next_loop != -1 &&
+          ir.in_loop(next_loop, instr->block) &&
+          (instr->flags & IR_FLAG_TERMINATOR) == 0)
+      {
+        goto_address[n] = ptr - 8;
+        b[ptr] = 0xa7;
+        ptr += 3;
+      }
+    }
+  }
+
+  // Branches from outside a loop go through its preheader.
+  bool fits = true;
+
+  for (n = 0; n < count; n++)
+  {
+    ir_instr_t *instr = ir.get_instr(n);
+    int address, target, offset;
+
+    if (goto_address[n] != -1)
+    {
+      address = goto_address[n];
+      target = new_address[ir.get_instr(n + 1)->address];
+      offset = target - address;
+
+      if (offset < -32768 || offset > 32767) { fits = false; }
+      put_uint16(b + 8 + address + 1, offset);
+    }
+
+    if ((instr->flags & IR_FLAG_BRANCH) == 0) { continue; }
+
+    int target_instr = ir.find_instr(instr->target);
+    int loop = preheader_at[target_instr];
+
+    address = new_address[instr->address];
+
+    if (loop != -1 && ir.in_loop(loop, instr->block))
+    {
+      target = new_address[instr->target];
+    }
+      else
+    {
+      target = entry_address[instr->target];
+    }
+
+    offset = target - address;
+
+    if (instr->opcode == 0xc8 || instr->opcode == 0xc9)
+    {
+      put_int32(b + 8 + address + 1, offset);
+    }
+      else
+    {
+      if (offset < -32768 || offset > 32767) { fits = false; }
+      put_uint16(b + 8 + address + 1, offset);
+    }
+  }
+
+  free(edits);
+
+  if (!fits)
+  {
+    free(b);
+    return 0;
+  }
+
+  put_uint16(b + 0, ir.get_max_stack() < 2 ? 2 : ir.get_max_stack());
+  put_uint16(b + 2, base + temp_count);
+  put_int32(b + 4, ptr - 8);
+
+  // Empty exception table and no attributes.
+  memset(b + ptr, 0, 4);
+
+  if (verbose)
+  {
+    char method_name[128];
+
+    java_class->get_method_name(method_name, sizeof(method_name), method_id);
+    printf("Loop optimizer moved %d value(s) out of loops in %s\n",
+      temp_count, method_name);
+  }
+
+  *new_code = b;
+
+  return temp_count;
+}
+
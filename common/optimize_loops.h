@@ -0,0 +1,22 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _OPTIMIZE_LOOPS_H
+#define _OPTIMIZE_LOOPS_H
+
+#include <stdint.h>
+
+#include "JavaClass.h"
+
+int optimize_loops(JavaClass *java_class, int method_id, uint8_t *code, uint8_t **new_code, bool verbose);
+
+#endif
+
@@ -0,0 +1,307 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JavaClass.h"
+#include "MethodIR.h"
+#include "register_alloc.h"
+
+// Linear scan allocation of Java locals to registers the generator sets
+// aside for them.  Liveness of each local is computed over the basic
+// blocks, turned into one interval over the instruction order, and the
+// intervals are handed out registers in order of their start.  A local
+// keeps its register (or frame slot) for the whole method so the
+// generator only has to load parameters on entry.
+
+// Locals past this need the wide prefix and just stay in the frame.
+#define MAX_REG_LOCALS 256
+
+struct interval_t
+{
+  int local;
+  int start;
+  int end;
+  int weight;
+};
+
+static int get_local_access(ir_instr_t *instr, bool *is_use, bool *is_def)
+{
+  int opcode;
+  int local = MethodIR::get_local_access(instr, &opcode);
+
+  *is_use = (opcode >= 0x15 && opcode <= 0x19) || opcode == 0x84 || opcode == 0xa9;
+  *is_def = (opcode >= 0x36 && opcode <= 0x3a) || opcode == 0x84;
+
+  return local;
+}
+
+static int compare_intervals(const void *a, const void *b)
+{
+  const interval_t *i1 = (const interval_t *)a;
+  const interval_t *i2 = (const interval_t *)b;
+
+  if (i1->start != i2->start) { return i1->start - i2->start; }
+
+  return i1->local - i2->local;
+}
+
+static void find_liveness(MethodIR *ir, int local_count, uint8_t *live_in, uint8_t *live_out)
+{
+  int block_count = ir->get_block_count();
+  bool is_use, is_def;
+  bool changed = true;
+  int b, n, i;
+
+  uint8_t *live = (uint8_t *)alloca(local_count);
+
+  memset(live_in, 0, block_count * local_count);
+  memset(live_out, 0, block_count * local_count);
+
+  while(changed)
+  {
+    changed = false;
+
+    for (b = block_count - 1; b >= 0; b--)
+    {
+      ir_block_t *block = ir->get_block(b);
+      uint8_t *out = live_out + (b * local_count);
+
+      if ((block->flags & IR_BLOCK_EXECUTABLE) == 0) { continue; }
+
+      for (n = 0; n < block->succ_count; n++)
+      {
+        uint8_t *in = live_in + (ir->get_succ(block, n) * local_count);
+
+        for (i = 0; i < local_count; i++)
+        {
+          if (in[i] && !out[i]) { out[i] = 1; changed = true; }
+        }
+      }
+
+      memcpy(live, out, local_count);
+
+      for (n = block->instr_count - 1; n >= 0; n--)
+      {
+        if (ir->is_dead(block->first_instr + n)) { continue; }
+
+        int local = get_local_access(ir->get_instr(block->first_instr + n), &is_use, &is_def);
+
+        if (local < 0 || local >= local_count) { continue; }
+        if (is_def) { live[local] = 0; }
+        if (is_use) { live[local] = 1; }
+      }
+
+      if (memcmp(live, live_in + (b * local_count), local_count) != 0)
+      {
+        memcpy(live_in + (b * local_count), live, local_count);
+        changed = true;
+      }
+    }
+  }
+}
+
+int allocate_local_registers(MethodIR *ir, int reg_count, int *local_regs)
+{
+  int local_count = ir->get_max_locals();
+  int block_count = ir->get_block_count();
+  int instr_count = ir->get_instr_count();
+  bool is_use, is_def;
+  int count = 0;
+  int n, i, b;
+
+  for (n = 0; n < local_count; n++) { local_regs[n] = -1; }
+
+  if (reg_count <= 0 || local_count == 0) { return 0; }
+
+  // Types of every local have to be known and the generator only loads
+  // the parameters of static methods on entry.
+  if (!ir->has_stack_info() || !ir->is_static_method()) { return 0; }
+
+  if (local_count > MAX_REG_LOCALS) { local_count = MAX_REG_LOCALS; }
+
+  uint8_t *live_in = (uint8_t *)malloc(block_count * local_count);
+  uint8_t *live_out = (uint8_t *)malloc(block_count * local_count);
+  interval_t *intervals = (interval_t *)alloca(local_count * sizeof(interval_t));
+
+  find_liveness(ir, local_count, live_in, live_out);
+
+  for (n = 0; n < local_count; n++)
+  {
+    intervals[n].local = n;
+    intervals[n].start = instr_count;
+    intervals[n].end = -1;
+    intervals[n].weight = 0;
+  }
+
+  // Parameters are live from the start of the method since that's
+  // where the generator loads them.  A long or double takes 2 locals.
+  for (n = 0; n < ir->get_param_slots() && n < local_count; n++)
+  {
+    intervals[n].start = 0;
+    intervals[n].end = 0;
+  }
+
+  for (b = 0; b < block_count; b++)
+  {
+    ir_block_t *block = ir->get_block(b);
+    int first = block->first_instr;
+    int last = block->first_instr + block->instr_count - 1;
+
+    if ((block->flags & IR_BLOCK_EXECUTABLE) == 0) { continue; }
+
+    // A branch back to an earlier block is a loop, accesses inside it
+    // count for more.
+    int loop_start = instr_count;
+
+    for (n = 0; n < block->succ_count; n++)
+    {
+      ir_block_t *succ = ir->get_block(ir->get_succ(block, n));
+      if (succ->first_instr <= first && succ->first_instr < loop_start)
+      {
+        loop_start = succ->first_instr;
+      }
+    }
+
+    for (i = 0; i < local_count; i++)
+    {
+      interval_t *interval = &intervals[i];
+
+      if (live_in[(b * local_count) + i])
+      {
+        if (first < interval->start) { interval->start = first; }
+        if (first > interval->end) { interval->end = first; }
+      }
+
+      if (live_out[(b * local_count) + i])
+      {
+        if (last < interval->start) { interval->start = last; }
+        if (last > interval->end) { interval->end = last; }
+
+        // Live around a loop means live for the whole loop.
+        if (loop_start < interval->start) { interval->start = loop_start; }
+      }
+    }
+
+    for (n = first; n <= last; n++)
+    {
+      if (ir->is_dead(n)) { continue; }
+
+      int local = get_local_access(ir->get_instr(n), &is_use, &is_def);
+
+      if (local < 0 || local >= local_count) { continue; }
+
+      interval_t *interval = &intervals[local];
+
+      if (n < interval->start) { interval->start = n; }
+      if (n > interval->end) { interval->end = n; }
+
+      interval->weight++;
+    }
+
+    if (loop_start != instr_count)
+    {
+      for (n = loop_start; n <= last; n++)
+      {
+        if (ir->is_dead(n)) { continue; }
+
+        int local = get_local_access(ir->get_instr(n), &is_use, &is_def);
+
+        if (local < 0 || local >= local_count) { continue; }
+
+        intervals[local].weight += 8;
+      }
+    }
+  }
+
+  free(live_in);
+  free(live_out);
+
+  // Only int and reference locals fit in a register.  Every access to a
+  // long / double is 2 slots so the slot after it can't be used either.
+  for (n = 0; n < local_count; n++)
+  {
+    int type = ir->get_local_type(n);
+
+    if (type == JAVA_TYPE_LONG || type == JAVA_TYPE_DOUBLE)
+    {
+      if (n + 1 < local_count) { intervals[n + 1].end = -1; }
+    }
+
+    if (type != JAVA_TYPE_INTEGER && type != JAVA_TYPE_REF)
+    {
+      intervals[n].end = -1;
+    }
+
+    // Saving and restoring the register would cost more than it saves.
+    if (intervals[n].weight < 2) { intervals[n].end = -1; }
+  }
+
+  // Drop locals that aren't candidates and sort the rest by start.
+  int interval_count = 0;
+
+  for (n = 0; n < local_count; n++)
+  {
+    if (intervals[n].end < 0) { continue; }
+    intervals[interval_count++] = intervals[n];
+  }
+
+  qsort(intervals, interval_count, sizeof(interval_t), compare_intervals);
+
+  interval_t **active = (interval_t **)alloca(reg_count * sizeof(interval_t *));
+  memset(active, 0, reg_count * sizeof(interval_t *));
+
+  for (n = 0; n < interval_count; n++)
+  {
+    interval_t *interval = &intervals[n];
+    int reg = -1;
+    int weakest = -1;
+
+    for (i = 0; i < reg_count; i++)
+    {
+      // Register is free again once the interval using it has ended.
+      if (active[i] != NULL && active[i]->end < interval->start)
+      {
+        active[i] = NULL;
+      }
+
+      if (active[i] == NULL)
+      {
+        if (reg == -1) { reg = i; }
+      }
+        else
+      if (weakest == -1 || active[i]->weight < active[weakest]->weight)
+      {
+        weakest = i;
+      }
+    }
+
+    // Under pressure the local used least goes back to the frame.
+    if (reg == -1 && active[weakest]->weight < interval->weight)
+    {
+      local_regs[active[weakest]->local] = -1;
+      count--;
+      reg = weakest;
+    }
+
+    if (reg == -1) { continue; }
+
+    active[reg] = interval;
+    local_regs[interval->local] = reg;
+    count++;
+  }
+
+  return count;
+}
+
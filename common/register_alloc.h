@@ -0,0 +1,20 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _REGISTER_ALLOC_H
+#define _REGISTER_ALLOC_H
+
+#include "MethodIR.h"
+
+int allocate_local_registers(MethodIR *ir, int reg_count, int *local_regs);
+
+#endif
+
@@ -0,0 +1,27 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _API_FIXED_H
+#define _API_FIXED_H
+
+class API_Fixed
+{
+public:
+  // Q8.8 and Q16.16 multiply / divide.  The product (or shifted dividend)
+  // is kept at full width before scaling back down.
+  virtual int fixed_mul8_II() { return -1; }
+  virtual int fixed_div8_II() { return -1; }
+  virtual int fixed_mul16_II() { return -1; }
+  virtual int fixed_div16_II() { return -1; }
+};
+
+#endif
+
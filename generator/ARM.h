@@ -21,6 +21,7 @@ public:
   virtual ~ARM();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -35,6 +36,7 @@ public:
   virtual int push_local_var_ref(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
+  virtual int get_spilled() { return stack; }
   virtual int push_int(int32_t n);
   //virtual int push_long(int64_t n);
   //virtual int push_float(float f);
@@ -12,10 +12,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
 #include "AVR8.h"
+#include "CyclesAVR8.h"
+#include "MethodIR.h"
 
 // ABI is:
 // r0 result0
@@ -24,16 +27,16 @@
 // r3 remainder1
 // r4 length0 
 // r5 length1
-// r6
-// r7
-// r8
-// r9
+// r6 float_b0
+// r7 float_b1
+// r8 float_b2
+// r9 float_b3
 // r10 zero
 // r11 one
 // r12 two
 // r13 three
 // r14 ff
-// r15
+// r15 float_s
 // r16 value10
 // r17 value11
 // r18 value20
@@ -50,6 +53,10 @@
 // r29 YH
 // r30 ZL
 // r31 ZH
+//
+// A float is 2 stack entries (high word on top).  The soft float routines
+// use float_a (r16-r19), float_b (r6-r9) and float_m (r2-r5) with the
+// exponent in X.
 
 #define PUSH_LO(a) \
   fprintf(out, "; PUSH_LO\n"); \
@@ -89,17 +96,16 @@
   else \
     fprintf(out, "  rcall %s\n", a)
 
-#define LOCALS(a) (a)
+#define LOCALS(a) (local_offsets[a])
 
 //static const char *pin_string[4] = { "PINA", "PINB", "PINC", "PIND" };
 static const char *ddr_string[4] = { "DDRA", "DDRB", "DDRC", "DDRD" };
 static const char *port_string[4] = { "PORTA", "PORTB", "PORTC", "PORTD" };
 
-static char *adc_in_string;
-static char *adc_out_string;
-
 AVR8::AVR8(uint8_t chip_type) :
   stack(0),
+  local_offsets(NULL),
+  locals_size(0),
   is_main(0),
   need_farjump(0),
   need_memory_mapped_adc(0),
@@ -127,7 +133,15 @@ AVR8::AVR8(uint8_t chip_type) :
   need_push_array_length2(0),
   need_array_byte_support(0),
   need_array_int_support(0),
-  need_get_values_from_stack(0)
+  need_get_values_from_stack(0),
+  need_float_support(0),
+  need_add_float(0),
+  need_mul_float(0),
+  need_div_float(0),
+  need_float_to_integer(0),
+  need_integer_to_float(0),
+  need_compare_floats(0),
+  need_array_float_support(0)
 {
   switch(chip_type)
   {
@@ -161,13 +175,13 @@ AVR8::AVR8(uint8_t chip_type) :
 
   if(need_memory_mapped_adc)
   {
-    adc_in_string = (char *)"lds";
-    adc_out_string = (char *)"sts";
+    adc_in_string = "lds";
+    adc_out_string = "sts";
   }
   else
   {
-    adc_in_string = (char *)"in";
-    adc_out_string = (char *)"out";
+    adc_in_string = "in";
+    adc_out_string = "out";
   }
 }
 
@@ -198,6 +212,21 @@ AVR8::~AVR8()
   if(need_array_byte_support) { insert_array_byte_support(); }
   if(need_array_int_support) { insert_array_int_support(); }
   if(need_get_values_from_stack) { insert_get_values_from_stack(); }
+  if(need_float_support) { insert_float_support(); }
+  if(need_add_float) { insert_add_float(); }
+  if(need_mul_float) { insert_mul_float(); }
+  if(need_div_float) { insert_div_float(); }
+  if(need_float_to_integer) { insert_float_to_integer(); }
+  if(need_integer_to_float) { insert_integer_to_float(); }
+  if(need_compare_floats) { insert_compare_floats(); }
+  if(need_array_float_support) { insert_array_float_support(); }
+
+  free(local_offsets);
+}
+
+Cycles *AVR8::new_cycles()
+{
+  return new CyclesAVR8();
 }
 
 int AVR8::open(const char *filename)
@@ -248,7 +277,23 @@ int AVR8::start_init()
   fprintf(out, "temp equ r22\n");
   fprintf(out, "temp2 equ r23\n");
   fprintf(out, "locals equ r24\n");
-  fprintf(out, "SP equ r25\n\n");
+  fprintf(out, "SP equ r25\n");
+  fprintf(out, "float_m0 equ r2\n");
+  fprintf(out, "float_m1 equ r3\n");
+  fprintf(out, "float_m2 equ r4\n");
+  fprintf(out, "float_m3 equ r5\n");
+  fprintf(out, "float_b0 equ r6\n");
+  fprintf(out, "float_b1 equ r7\n");
+  fprintf(out, "float_b2 equ r8\n");
+  fprintf(out, "float_b3 equ r9\n");
+  fprintf(out, "float_s equ r15\n");
+  fprintf(out, "float_a0 equ r16\n");
+  fprintf(out, "float_a1 equ r17\n");
+  fprintf(out, "float_a2 equ r18\n");
+  fprintf(out, "float_a3 equ r19\n");
+  fprintf(out, "float_x equ r20\n");
+  fprintf(out, "float_e0 equ r26\n");
+  fprintf(out, "float_e1 equ r27\n\n");
 
   // startup
   fprintf(out, ".org 0x0000\n\n");
@@ -340,10 +385,34 @@ void AVR8::method_start(int local_count, int max_stack, int param_count, const c
   }
 
   fprintf(out, "  mov locals, SP\n");
-  fprintf(out, "  ldi temp, 0x%02x\n", local_count);
+  fprintf(out, "  ldi temp, 0x%02x\n", locals_size);
   fprintf(out, "  sub SP, temp\n");
 }
 
+void AVR8::set_local_types(const uint8_t *local_types, int local_count)
+{
+  int n;
+
+  // A local that is ever a float takes 2 stack entries so each one gets
+  // its own offset from locals.  The caller copies params the same way.
+  local_offsets = (int *)realloc(local_offsets, (local_count + 1) * sizeof(int));
+  locals_size = 0;
+
+  for (n = 0; n < local_count; n++)
+  {
+    local_offsets[n] = locals_size;
+
+    if (local_types[n] == JAVA_TYPE_FLOAT || local_types[n] == IR_TYPE_MIXED)
+    {
+      locals_size += 2;
+    }
+      else
+    {
+      locals_size++;
+    }
+  }
+}
+
 void AVR8::method_end(int local_count)
 {
   fprintf(out, "\n");
@@ -365,6 +434,20 @@ int AVR8::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int AVR8::push_local_var_float(int index)
+{
+  need_push_local_var_int = 1;
+
+  fprintf(out, "; push_local_var_float\n");
+  fprintf(out, "  ldi temp2, %d\n", LOCALS(index));
+  CALL("push_local_var_int");
+  fprintf(out, "  ldi temp2, %d\n", LOCALS(index) + 1);
+  CALL("push_local_var_int");
+  stack += 2;
+
+  return 0;
+}
+
 int AVR8::push_ref_static(const char *name, int index)
 {
   return -1;
@@ -401,12 +484,18 @@ int AVR8::push_long(int64_t n)
   return push_int((int32_t)n);
 }
 
-#if 0
 int AVR8::push_float(float f)
 {
-  return -1;
+  uint32_t *data = (uint32_t *)&f;
+
+  fprintf(out, "; push_float(%f)\n", f);
+  push_int(*data & 0xffff);
+  push_int(*data >> 16);
+
+  return 0;
 }
 
+#if 0
 int AVR8::push_double(double f)
 {
   return -1;
@@ -441,6 +530,20 @@ int AVR8::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int AVR8::pop_local_var_float(int index)
+{
+  need_pop_local_var_int = 1;
+
+  fprintf(out, "; pop_local_var_float\n");
+  fprintf(out, "  ldi temp2, %d\n", LOCALS(index) + 1);
+  CALL("pop_local_var_int");
+  fprintf(out, "  ldi temp2, %d\n", LOCALS(index));
+  CALL("pop_local_var_int");
+  stack -= 2;
+
+  return 0;
+}
+
 int AVR8::pop()
 {
   fprintf(out, "; pop\n");
@@ -463,9 +566,26 @@ int AVR8::dup()
 
 int AVR8::dup2()
 {
-  printf("Need to implement dup2()\n");
+  int n;
 
-  return -1;
+  // Each push moves the entry to copy down by one.
+  fprintf(out, "; dup2\n");
+
+  for (n = 0; n < 2; n++)
+  {
+    fprintf(out, "  ldi YL, stack_lo + 2\n");
+    fprintf(out, "  add YL, SP\n");
+    fprintf(out, "  ld temp, Y\n");
+    PUSH_LO("temp");
+    fprintf(out, "  ldi YL, stack_hi + 2\n");
+    fprintf(out, "  add YL, SP\n");
+    fprintf(out, "  ld temp, Y\n");
+    PUSH_HI("temp");
+  }
+
+  stack += 2;
+
+  return 0;
 }
 
 int AVR8::swap()
@@ -722,9 +842,12 @@ int AVR8::inc_integer(int index, int num)
 {
   uint16_t value = num & 0xffff;
 
+  // The array and float routines use X too so XH has to be set to the
+  // stack page.
   if(num > 0 && num < 64)
   {
     fprintf(out, "; inc_integer (optimized, add)\n");
+    fprintf(out, "  mov XH, YH\n");
     fprintf(out, "  ldi XL, stack_lo - %d\n", LOCALS(index));
     fprintf(out, "  add XL, locals\n");
     fprintf(out, "  ld ZL, X\n");
@@ -738,6 +861,7 @@ int AVR8::inc_integer(int index, int num)
     else if(num > -64 && num < 0)
   {
     fprintf(out, "; inc_integer (optimized, sub)\n");
+    fprintf(out, "  mov XH, YH\n");
     fprintf(out, "  ldi XL, stack_lo - %d\n", LOCALS(index));
     fprintf(out, "  add XL, locals\n");
     fprintf(out, "  ld ZL, X\n");
@@ -774,6 +898,89 @@ int AVR8::integer_to_short()
   return 0;
 }
 
+int AVR8::add_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  CALL("add_float");
+  stack -= 2;
+
+  return 0;
+}
+
+int AVR8::sub_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  CALL("sub_float");
+  stack -= 2;
+
+  return 0;
+}
+
+int AVR8::mul_float()
+{
+  need_float_support = 1;
+  need_mul_float = 1;
+  CALL("mul_float");
+  stack -= 2;
+
+  return 0;
+}
+
+int AVR8::div_float()
+{
+  need_float_support = 1;
+  need_div_float = 1;
+  CALL("div_float");
+  stack -= 2;
+
+  return 0;
+}
+
+int AVR8::neg_float()
+{
+  // sign is the top bit of the high word
+  fprintf(out, "; neg_float\n");
+  fprintf(out, "  ldi YL, stack_hi + 1\n");
+  fprintf(out, "  add YL, SP\n");
+  fprintf(out, "  ld temp, Y\n");
+  fprintf(out, "  ldi temp2, 0x80\n");
+  fprintf(out, "  eor temp, temp2\n");
+  fprintf(out, "  st Y, temp\n");
+
+  return 0;
+}
+
+int AVR8::float_to_integer()
+{
+  need_float_to_integer = 1;
+  CALL("float_to_integer");
+  stack--;
+
+  return 0;
+}
+
+int AVR8::integer_to_float()
+{
+  need_float_support = 1;
+  need_integer_to_float = 1;
+  CALL("integer_to_float");
+  stack++;
+
+  return 0;
+}
+
+int AVR8::compare_floats(int cond)
+{
+  need_float_support = 1;
+  need_compare_floats = 1;
+  CALL(cond == 0 ? "compare_floats_l" : "compare_floats_g");
+  stack -= 3;
+
+  return 0;
+}
+
 int AVR8::jump_cond(const char *label, int cond, int distance)
 {
   bool reverse = false;
@@ -1004,6 +1211,28 @@ int AVR8::return_integer(int local_count)
   return 0;
 }
 
+int AVR8::return_float(int local_count)
+{
+  // A float comes back in float_a since result is only 16 bits.
+  need_float_support = 1;
+
+  fprintf(out, "; return_float\n");
+  CALL("float_pop_a");
+  stack -= 2;
+
+  fprintf(out, "  mov SP, locals\n");
+
+  if (!is_main)
+  {
+    POP_HI("locals");
+    POP_LO("locals");
+  }
+
+  fprintf(out, "  ret\n\n");
+
+  return 0;
+}
+
 int AVR8::return_void(int local_count)
 {
   fprintf(out, "; return_void\n");
@@ -1091,6 +1320,18 @@ int stack_vars = stack;
   return 0;
 }
 
+int AVR8::invoke_static_method_float(const char *name, int params)
+{
+  need_float_support = 1;
+
+  invoke_static_method(name, params, 1);
+
+  CALL("float_push_a");
+  stack += 2;
+
+  return 0;
+}
+
 int AVR8::put_static(const char *name, int index)
 {
   if (stack > 0)
@@ -1133,6 +1374,13 @@ int AVR8::new_array(uint8_t type)
       CALL("new_array_int");
     }
       else
+    if (type == TYPE_FLOAT)
+    {
+      need_float_support = 1;
+      need_array_float_support = 1;
+      CALL("new_array_float");
+    }
+      else
     {
       need_array_byte_support = 1;
       CALL("new_array_byte");
@@ -1224,6 +1472,16 @@ int AVR8::array_read_int()
   return 0;
 }
 
+int AVR8::array_read_float()
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+
+  CALL("array_read_float");
+
+  return 0;
+}
+
 int AVR8::array_read_byte(const char *name, int field_id)
 {
   need_array_byte_support = 1;
@@ -1257,6 +1515,20 @@ int AVR8::array_read_int(const char *name, int field_id)
   return 0;
 }
 
+int AVR8::array_read_float(const char *name, int field_id)
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+
+  // Float arrays are only made by new_array so they are in RAM.
+  fprintf(out, "  lds XL, %s + 0\n", name);
+  fprintf(out, "  lds XH, %s + 1\n", name);
+  CALL("array_read_float2");
+  stack++;
+
+  return 0;
+}
+
 int AVR8::array_write_byte()
 {
   need_array_byte_support = 1;
@@ -1282,6 +1554,17 @@ int AVR8::array_write_int()
   return 0;
 }
 
+int AVR8::array_write_float()
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+
+  CALL("array_write_float");
+  stack -= 4;
+
+  return 0;
+}
+
 int AVR8::array_write_byte(const char *name, int field_id)
 {
 //  get_values_from_stack(2);
@@ -1305,6 +1588,19 @@ int AVR8::array_write_int(const char *name, int field_id)
   return -1;
 }
 
+int AVR8::array_write_float(const char *name, int field_id)
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+
+  fprintf(out, "  lds XL, %s + 0\n", name);
+  fprintf(out, "  lds XH, %s + 1\n", name);
+  CALL("array_write_float2");
+  stack -= 3;
+
+  return 0;
+}
+
 int AVR8::get_values_from_stack(int num)
 {
   need_get_values_from_stack = 1;
@@ -1334,6 +1630,7 @@ int AVR8::get_values_from_stack(int num)
 void AVR8::insert_swap()
 {
   fprintf(out, "swap:\n");
+  fprintf(out, "  mov XH, YH\n");
   fprintf(out, "  ldi XL, stack_lo\n");
   fprintf(out, "  add XL, SP\n");
   fprintf(out, "  ld value10, X-\n");
@@ -1556,6 +1853,7 @@ void AVR8::insert_xor_integer()
 void AVR8::insert_inc_integer()
 {
   fprintf(out, "inc_integer:\n");
+  fprintf(out, "  mov XH, YH\n");
   fprintf(out, "  ldi XL, stack_lo\n");
   fprintf(out, "  sub XL, temp\n");
   fprintf(out, "  add XL, locals\n");
@@ -1854,6 +2152,698 @@ void AVR8::insert_get_values_from_stack()
   fprintf(out, "  ret\n\n");
 }
 
+void AVR8::insert_float_support()
+{
+  // Helpers shared by the soft float routines.  A float is 2 stack entries
+  // with the high word on top.  Denormals are treated as 0.
+  fprintf(out, "float_pop_ab:\n");
+  POP_HI("float_b3");
+  POP_LO("float_b2");
+  POP_HI("float_b1");
+  POP_LO("float_b0");
+  fprintf(out, "float_pop_a:\n");
+  POP_HI("float_a3");
+  POP_LO("float_a2");
+  POP_HI("float_a1");
+  POP_LO("float_a0");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_push_a:\n");
+  PUSH_LO("float_a0");
+  PUSH_HI("float_a1");
+  PUSH_LO("float_a2");
+  PUSH_HI("float_a3");
+  fprintf(out, "  ret\n");
+  // Sets carry if a or b is NaN.
+  fprintf(out, "float_is_nan:\n");
+  fprintf(out, "  mov temp, float_a2\n");
+  fprintf(out, "  lsl temp\n");
+  fprintf(out, "  mov temp, float_a3\n");
+  fprintf(out, "  rol temp\n");
+  fprintf(out, "  cpi temp, 0xff\n");
+  fprintf(out, "  brne float_is_nan_b\n");
+  fprintf(out, "  mov temp, float_a2\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  or temp, float_a1\n");
+  fprintf(out, "  or temp, float_a0\n");
+  fprintf(out, "  brne float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_b:\n");
+  fprintf(out, "  mov temp, float_b2\n");
+  fprintf(out, "  lsl temp\n");
+  fprintf(out, "  mov temp, float_b3\n");
+  fprintf(out, "  rol temp\n");
+  fprintf(out, "  cpi temp, 0xff\n");
+  fprintf(out, "  brne float_is_nan_no\n");
+  fprintf(out, "  mov temp, float_b2\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  or temp, float_b1\n");
+  fprintf(out, "  or temp, float_b0\n");
+  fprintf(out, "  brne float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_no:\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_is_nan_yes:\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  ret\n");
+  // Exponents of a and b in float_e0 and float_e1.
+  fprintf(out, "float_exponents:\n");
+  fprintf(out, "  mov float_e0, float_a2\n");
+  fprintf(out, "  lsl float_e0\n");
+  fprintf(out, "  mov float_e0, float_a3\n");
+  fprintf(out, "  rol float_e0\n");
+  fprintf(out, "  mov float_e1, float_b2\n");
+  fprintf(out, "  lsl float_e1\n");
+  fprintf(out, "  mov float_e1, float_b3\n");
+  fprintf(out, "  rol float_e1\n");
+  fprintf(out, "  ret\n");
+  // float_m is the mantissa with the hidden bit at bit 31, float_e the
+  // exponent (16 bit signed) and float_s the sign.  Rounds to nearest even
+  // and pushes the float.  Anything too small for a normal float becomes 0.
+  fprintf(out, "float_pack:\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  brmi float_pack_zero\n");
+  fprintf(out, "  brne float_pack_round\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  breq float_pack_zero\n");
+  fprintf(out, "float_pack_round:\n");
+  fprintf(out, "  mov temp, float_m0\n");
+  fprintf(out, "  cpi temp, 0x80\n");
+  fprintf(out, "  brlo float_pack_exponent\n");
+  fprintf(out, "  brne float_pack_round_up\n");
+  fprintf(out, "  sbrs float_m1, 0\n");
+  fprintf(out, "  rjmp float_pack_exponent\n");
+  fprintf(out, "float_pack_round_up:\n");
+  fprintf(out, "  add float_m1, one\n");
+  fprintf(out, "  adc float_m2, zero\n");
+  fprintf(out, "  adc float_m3, zero\n");
+  fprintf(out, "  brcc float_pack_exponent\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  mov float_m3, temp\n");
+  fprintf(out, "  subi float_e0, 0xff\n");
+  fprintf(out, "  sbci float_e1, 0xff\n");
+  fprintf(out, "float_pack_exponent:\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  brne float_pack_inf\n");
+  fprintf(out, "  cpi float_e0, 0xff\n");
+  fprintf(out, "  breq float_pack_inf\n");
+  // The low bit of the exponent goes where the hidden bit was.
+  fprintf(out, "  mov float_a2, float_m3\n");
+  fprintf(out, "  lsl float_a2\n");
+  fprintf(out, "  mov temp, float_e0\n");
+  fprintf(out, "  lsr temp\n");
+  fprintf(out, "  ror float_a2\n");
+  fprintf(out, "  or temp, float_s\n");
+  fprintf(out, "  mov float_a3, temp\n");
+  fprintf(out, "  mov float_a1, float_m2\n");
+  fprintf(out, "  mov float_a0, float_m1\n");
+  fprintf(out, "  rjmp float_push_a\n");
+  fprintf(out, "float_pack_inf:\n");
+  fprintf(out, "  mov float_a3, float_s\n");
+  fprintf(out, "  ori float_a3, 0x7f\n");
+  fprintf(out, "  ldi float_a2, 0x80\n");
+  fprintf(out, "  clr float_a1\n");
+  fprintf(out, "  clr float_a0\n");
+  fprintf(out, "  rjmp float_push_a\n");
+  fprintf(out, "float_pack_zero:\n");
+  fprintf(out, "  mov float_a3, float_s\n");
+  fprintf(out, "  clr float_a2\n");
+  fprintf(out, "  clr float_a1\n");
+  fprintf(out, "  clr float_a0\n");
+  fprintf(out, "  rjmp float_push_a\n");
+  fprintf(out, "float_nan:\n");
+  fprintf(out, "  ldi float_a3, 0x7f\n");
+  fprintf(out, "  ldi float_a2, 0xc0\n");
+  fprintf(out, "  clr float_a1\n");
+  fprintf(out, "  clr float_a0\n");
+  fprintf(out, "  rjmp float_push_a\n\n");
+}
+
+void AVR8::insert_add_float()
+{
+  fprintf(out, "sub_float:\n");
+  fprintf(out, "  rcall float_pop_ab\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  eor float_b3, temp\n");
+  fprintf(out, "  rjmp add_float_start\n");
+  fprintf(out, "add_float:\n");
+  fprintf(out, "  rcall float_pop_ab\n");
+  fprintf(out, "add_float_start:\n");
+  // Make a the one with the bigger magnitude.
+  fprintf(out, "  mov temp, float_a3\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  mov temp2, float_b3\n");
+  fprintf(out, "  andi temp2, 0x7f\n");
+  fprintf(out, "  cp float_a0, float_b0\n");
+  fprintf(out, "  cpc float_a1, float_b1\n");
+  fprintf(out, "  cpc float_a2, float_b2\n");
+  fprintf(out, "  cpc temp, temp2\n");
+  fprintf(out, "  brsh add_float_ordered\n");
+  fprintf(out, "  movw float_m0, float_a0\n");
+  fprintf(out, "  movw float_m2, float_a2\n");
+  fprintf(out, "  movw float_a0, float_b0\n");
+  fprintf(out, "  movw float_a2, float_b2\n");
+  fprintf(out, "  movw float_b0, float_m0\n");
+  fprintf(out, "  movw float_b2, float_m2\n");
+  fprintf(out, "add_float_ordered:\n");
+  fprintf(out, "  mov float_s, float_a3\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  and float_s, temp\n");
+  fprintf(out, "  rcall float_exponents\n");
+  fprintf(out, "  cpi float_e0, 0xff\n");
+  fprintf(out, "  brne add_float_finite\n");
+  // a is inf or NaN.  inf - inf is NaN.
+  fprintf(out, "  mov temp, float_a2\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  or temp, float_a1\n");
+  fprintf(out, "  or temp, float_a0\n");
+  fprintf(out, "  brne add_float_return_a\n");
+  fprintf(out, "  cpi float_e1, 0xff\n");
+  fprintf(out, "  brne add_float_return_a\n");
+  fprintf(out, "  mov temp, float_a3\n");
+  fprintf(out, "  eor temp, float_b3\n");
+  fprintf(out, "  brpl add_float_return_a\n");
+  fprintf(out, "  rjmp float_nan\n");
+  fprintf(out, "add_float_finite:\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  brne add_float_a_normal\n");
+  // Both are 0 and the answer is only -0 if both are.
+  fprintf(out, "  mov float_s, float_a3\n");
+  fprintf(out, "  and float_s, float_b3\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  and float_s, temp\n");
+  fprintf(out, "  rjmp float_pack_zero\n");
+  fprintf(out, "add_float_a_normal:\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  brne add_float_b_normal\n");
+  fprintf(out, "add_float_return_a:\n");
+  fprintf(out, "  rjmp float_push_a\n");
+  fprintf(out, "add_float_b_normal:\n");
+  fprintf(out, "  mov temp2, float_e0\n");
+  fprintf(out, "  sub temp2, float_e1\n");
+  fprintf(out, "  mov float_x, float_a3\n");
+  fprintf(out, "  eor float_x, float_b3\n");
+  // Mantissas with the hidden bit at bit 31 and a byte for rounding.
+  fprintf(out, "  ori float_a2, 0x80\n");
+  fprintf(out, "  mov float_m3, float_a2\n");
+  fprintf(out, "  mov float_m2, float_a1\n");
+  fprintf(out, "  mov float_m1, float_a0\n");
+  fprintf(out, "  clr float_m0\n");
+  fprintf(out, "  mov float_b3, float_b2\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  or float_b3, temp\n");
+  fprintf(out, "  mov float_b2, float_b1\n");
+  fprintf(out, "  mov float_b1, float_b0\n");
+  fprintf(out, "  clr float_b0\n");
+  fprintf(out, "  clr temp\n");
+  // Line up b with a.  Bits shifted out of b are kept as a sticky bit.
+  fprintf(out, "  cpi temp2, 32\n");
+  fprintf(out, "  brlo add_float_shift\n");
+  fprintf(out, "  clr float_b3\n");
+  fprintf(out, "  clr float_b2\n");
+  fprintf(out, "  clr float_b1\n");
+  fprintf(out, "  mov float_b0, one\n");
+  fprintf(out, "  rjmp add_float_aligned\n");
+  fprintf(out, "add_float_shift:\n");
+  fprintf(out, "  tst temp2\n");
+  fprintf(out, "  breq add_float_aligned\n");
+  fprintf(out, "add_float_shift_loop:\n");
+  fprintf(out, "  lsr float_b3\n");
+  fprintf(out, "  ror float_b2\n");
+  fprintf(out, "  ror float_b1\n");
+  fprintf(out, "  ror float_b0\n");
+  fprintf(out, "  brcc add_float_shift_next\n");
+  fprintf(out, "  mov temp, one\n");
+  fprintf(out, "add_float_shift_next:\n");
+  fprintf(out, "  dec temp2\n");
+  fprintf(out, "  brne add_float_shift_loop\n");
+  fprintf(out, "  or float_b0, temp\n");
+  fprintf(out, "add_float_aligned:\n");
+  fprintf(out, "  clr float_e1\n");
+  fprintf(out, "  tst float_x\n");
+  fprintf(out, "  brmi add_float_subtract\n");
+  fprintf(out, "  add float_m0, float_b0\n");
+  fprintf(out, "  adc float_m1, float_b1\n");
+  fprintf(out, "  adc float_m2, float_b2\n");
+  fprintf(out, "  adc float_m3, float_b3\n");
+  fprintf(out, "  brcc add_float_pack\n");
+  // Carry out of bit 31 so shift right one keeping the sticky bit.
+  fprintf(out, "  ror float_m3\n");
+  fprintf(out, "  ror float_m2\n");
+  fprintf(out, "  ror float_m1\n");
+  fprintf(out, "  ror float_m0\n");
+  fprintf(out, "  brcc add_float_carry\n");
+  fprintf(out, "  or float_m0, one\n");
+  fprintf(out, "add_float_carry:\n");
+  fprintf(out, "  subi float_e0, 0xff\n");
+  fprintf(out, "  sbci float_e1, 0xff\n");
+  fprintf(out, "add_float_pack:\n");
+  fprintf(out, "  rjmp float_pack\n");
+  fprintf(out, "add_float_subtract:\n");
+  fprintf(out, "  sub float_m0, float_b0\n");
+  fprintf(out, "  sbc float_m1, float_b1\n");
+  fprintf(out, "  sbc float_m2, float_b2\n");
+  fprintf(out, "  sbc float_m3, float_b3\n");
+  fprintf(out, "  mov temp, float_m3\n");
+  fprintf(out, "  or temp, float_m2\n");
+  fprintf(out, "  or temp, float_m1\n");
+  fprintf(out, "  or temp, float_m0\n");
+  fprintf(out, "  brne add_float_normalize\n");
+  fprintf(out, "  clr float_s\n");
+  fprintf(out, "  rjmp float_pack_zero\n");
+  fprintf(out, "add_float_normalize:\n");
+  fprintf(out, "  tst float_m3\n");
+  fprintf(out, "  brmi add_float_pack\n");
+  fprintf(out, "  lsl float_m0\n");
+  fprintf(out, "  rol float_m1\n");
+  fprintf(out, "  rol float_m2\n");
+  fprintf(out, "  rol float_m3\n");
+  fprintf(out, "  subi float_e0, 1\n");
+  fprintf(out, "  sbci float_e1, 0\n");
+  fprintf(out, "  rjmp add_float_normalize\n\n");
+}
+
+void AVR8::insert_mul_float()
+{
+  fprintf(out, "mul_float:\n");
+  fprintf(out, "  rcall float_pop_ab\n");
+  fprintf(out, "  mov float_s, float_a3\n");
+  fprintf(out, "  eor float_s, float_b3\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  and float_s, temp\n");
+  fprintf(out, "  rcall float_exponents\n");
+  fprintf(out, "  cpi float_e0, 0xff\n");
+  fprintf(out, "  breq mul_float_special\n");
+  fprintf(out, "  cpi float_e1, 0xff\n");
+  fprintf(out, "  breq mul_float_special\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  breq mul_float_zero\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  brne mul_float_normal\n");
+  fprintf(out, "mul_float_zero:\n");
+  fprintf(out, "  rjmp float_pack_zero\n");
+  fprintf(out, "mul_float_special:\n");
+  // NaN if either is NaN or it's inf * 0 (a denormal counts as 0),
+  // otherwise inf.
+  fprintf(out, "  rcall float_is_nan\n");
+  fprintf(out, "  brcs mul_float_nan\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  breq mul_float_nan\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  breq mul_float_nan\n");
+  fprintf(out, "  rjmp float_pack_inf\n");
+  fprintf(out, "mul_float_nan:\n");
+  fprintf(out, "  rjmp float_nan\n");
+  fprintf(out, "mul_float_normal:\n");
+  // float_e = ea + eb - 127
+  fprintf(out, "  add float_e0, float_e1\n");
+  fprintf(out, "  clr float_e1\n");
+  fprintf(out, "  rol float_e1\n");
+  fprintf(out, "  subi float_e0, 127\n");
+  fprintf(out, "  sbci float_e1, 0\n");
+  fprintf(out, "  ori float_a2, 0x80\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  or float_b2, temp\n");
+  // Shift and add from the low bit of b.  The top 32 bits of the 48 bit
+  // product end up in float_m and anything below that is sticky.
+  fprintf(out, "  clr float_m0\n");
+  fprintf(out, "  clr float_m1\n");
+  fprintf(out, "  clr float_m2\n");
+  fprintf(out, "  clr float_m3\n");
+  fprintf(out, "  clr temp\n");
+  fprintf(out, "  ldi temp2, 24\n");
+  fprintf(out, "mul_float_loop:\n");
+  fprintf(out, "  lsr float_b2\n");
+  fprintf(out, "  ror float_b1\n");
+  fprintf(out, "  ror float_b0\n");
+  fprintf(out, "  brcc mul_float_shift\n");
+  fprintf(out, "  add float_m1, float_a0\n");
+  fprintf(out, "  adc float_m2, float_a1\n");
+  fprintf(out, "  adc float_m3, float_a2\n");
+  fprintf(out, "mul_float_shift:\n");
+  fprintf(out, "  ror float_m3\n");
+  fprintf(out, "  ror float_m2\n");
+  fprintf(out, "  ror float_m1\n");
+  fprintf(out, "  ror float_m0\n");
+  fprintf(out, "  brcc mul_float_next\n");
+  fprintf(out, "  mov temp, one\n");
+  fprintf(out, "mul_float_next:\n");
+  fprintf(out, "  dec temp2\n");
+  fprintf(out, "  brne mul_float_loop\n");
+  // The product's top bit is bit 31 or 30.
+  fprintf(out, "  tst float_m3\n");
+  fprintf(out, "  brmi mul_float_47\n");
+  fprintf(out, "  lsl float_m0\n");
+  fprintf(out, "  rol float_m1\n");
+  fprintf(out, "  rol float_m2\n");
+  fprintf(out, "  rol float_m3\n");
+  fprintf(out, "  rjmp mul_float_sticky\n");
+  fprintf(out, "mul_float_47:\n");
+  fprintf(out, "  subi float_e0, 0xff\n");
+  fprintf(out, "  sbci float_e1, 0xff\n");
+  fprintf(out, "mul_float_sticky:\n");
+  fprintf(out, "  or float_m0, temp\n");
+  fprintf(out, "  rjmp float_pack\n\n");
+}
+
+void AVR8::insert_div_float()
+{
+  fprintf(out, "div_float:\n");
+  fprintf(out, "  rcall float_pop_ab\n");
+  fprintf(out, "  mov float_s, float_a3\n");
+  fprintf(out, "  eor float_s, float_b3\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  and float_s, temp\n");
+  fprintf(out, "  rcall float_exponents\n");
+  fprintf(out, "  rcall float_is_nan\n");
+  fprintf(out, "  brcs div_float_nan\n");
+  fprintf(out, "  cpi float_e0, 0xff\n");
+  fprintf(out, "  brne div_float_a_finite\n");
+  fprintf(out, "  cpi float_e1, 0xff\n");
+  fprintf(out, "  breq div_float_nan\n");
+  fprintf(out, "  rjmp float_pack_inf\n");
+  fprintf(out, "div_float_a_finite:\n");
+  fprintf(out, "  cpi float_e1, 0xff\n");
+  fprintf(out, "  breq div_float_zero\n");
+  fprintf(out, "  tst float_e1\n");
+  fprintf(out, "  brne div_float_b_normal\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  breq div_float_nan\n");
+  fprintf(out, "  rjmp float_pack_inf\n");
+  fprintf(out, "div_float_nan:\n");
+  fprintf(out, "  rjmp float_nan\n");
+  fprintf(out, "div_float_zero:\n");
+  fprintf(out, "  rjmp float_pack_zero\n");
+  fprintf(out, "div_float_b_normal:\n");
+  fprintf(out, "  tst float_e0\n");
+  fprintf(out, "  breq div_float_zero\n");
+  // float_e = ea - eb + 127
+  fprintf(out, "  sub float_e0, float_e1\n");
+  fprintf(out, "  clr float_e1\n");
+  fprintf(out, "  sbc float_e1, float_e1\n");
+  fprintf(out, "  subi float_e0, 0x81\n");
+  fprintf(out, "  sbci float_e1, 0xff\n");
+  fprintf(out, "  ori float_a2, 0x80\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  or float_b2, temp\n");
+  fprintf(out, "  clr float_a3\n");
+  fprintf(out, "  clr float_b3\n");
+  // If a < b shift it so the first bit of the quotient is 1.
+  fprintf(out, "  cp float_a0, float_b0\n");
+  fprintf(out, "  cpc float_a1, float_b1\n");
+  fprintf(out, "  cpc float_a2, float_b2\n");
+  fprintf(out, "  brsh div_float_start\n");
+  fprintf(out, "  lsl float_a0\n");
+  fprintf(out, "  rol float_a1\n");
+  fprintf(out, "  rol float_a2\n");
+  fprintf(out, "  rol float_a3\n");
+  fprintf(out, "  subi float_e0, 1\n");
+  fprintf(out, "  sbci float_e1, 0\n");
+  fprintf(out, "div_float_start:\n");
+  fprintf(out, "  ldi temp2, 32\n");
+  // Carry is the inverse of each quotient bit so float_m is flipped at
+  // the end.
+  fprintf(out, "div_float_loop:\n");
+  fprintf(out, "  cp float_a0, float_b0\n");
+  fprintf(out, "  cpc float_a1, float_b1\n");
+  fprintf(out, "  cpc float_a2, float_b2\n");
+  fprintf(out, "  cpc float_a3, float_b3\n");
+  fprintf(out, "  brlo div_float_next\n");
+  fprintf(out, "  sub float_a0, float_b0\n");
+  fprintf(out, "  sbc float_a1, float_b1\n");
+  fprintf(out, "  sbc float_a2, float_b2\n");
+  fprintf(out, "  sbc float_a3, float_b3\n");
+  fprintf(out, "div_float_next:\n");
+  fprintf(out, "  rol float_m0\n");
+  fprintf(out, "  rol float_m1\n");
+  fprintf(out, "  rol float_m2\n");
+  fprintf(out, "  rol float_m3\n");
+  fprintf(out, "  lsl float_a0\n");
+  fprintf(out, "  rol float_a1\n");
+  fprintf(out, "  rol float_a2\n");
+  fprintf(out, "  rol float_a3\n");
+  fprintf(out, "  dec temp2\n");
+  fprintf(out, "  brne div_float_loop\n");
+  fprintf(out, "  com float_m0\n");
+  fprintf(out, "  com float_m1\n");
+  fprintf(out, "  com float_m2\n");
+  fprintf(out, "  com float_m3\n");
+  // Anything left over is the sticky bit.
+  fprintf(out, "  or float_a0, float_a1\n");
+  fprintf(out, "  or float_a0, float_a2\n");
+  fprintf(out, "  or float_a0, float_a3\n");
+  fprintf(out, "  breq div_float_pack\n");
+  fprintf(out, "  or float_m0, one\n");
+  fprintf(out, "div_float_pack:\n");
+  fprintf(out, "  rjmp float_pack\n\n");
+}
+
+void AVR8::insert_integer_to_float()
+{
+  fprintf(out, "integer_to_float:\n");
+  POP_HI("float_m3");
+  POP_LO("float_m2");
+  fprintf(out, "  clr float_m1\n");
+  fprintf(out, "  clr float_m0\n");
+  fprintf(out, "  clr float_s\n");
+  fprintf(out, "  clr float_e1\n");
+  fprintf(out, "  tst float_m3\n");
+  fprintf(out, "  brpl integer_to_float_positive\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  mov float_s, temp\n");
+  fprintf(out, "  com float_m2\n");
+  fprintf(out, "  com float_m3\n");
+  fprintf(out, "  add float_m2, one\n");
+  fprintf(out, "  adc float_m3, zero\n");
+  fprintf(out, "integer_to_float_positive:\n");
+  fprintf(out, "  mov temp, float_m3\n");
+  fprintf(out, "  or temp, float_m2\n");
+  fprintf(out, "  brne integer_to_float_start\n");
+  fprintf(out, "  rjmp float_pack_zero\n");
+  fprintf(out, "integer_to_float_start:\n");
+  fprintf(out, "  ldi float_e0, 142\n");
+  fprintf(out, "integer_to_float_normalize:\n");
+  fprintf(out, "  tst float_m3\n");
+  fprintf(out, "  brmi integer_to_float_pack\n");
+  fprintf(out, "  lsl float_m2\n");
+  fprintf(out, "  rol float_m3\n");
+  fprintf(out, "  dec float_e0\n");
+  fprintf(out, "  rjmp integer_to_float_normalize\n");
+  fprintf(out, "integer_to_float_pack:\n");
+  fprintf(out, "  rjmp float_pack\n\n");
+}
+
+void AVR8::insert_float_to_integer()
+{
+  // Rounds toward 0.  NaN is 0 and anything that doesn't fit in 16 bits
+  // is clamped.
+  fprintf(out, "float_to_integer:\n");
+  POP_HI("float_a3");
+  POP_LO("float_a2");
+  POP_HI("float_a1");
+  POP_LO("float_a0");
+  fprintf(out, "  mov temp, float_a2\n");
+  fprintf(out, "  lsl temp\n");
+  fprintf(out, "  mov temp, float_a3\n");
+  fprintf(out, "  rol temp\n");
+  fprintf(out, "  cpi temp, 127\n");
+  fprintf(out, "  brlo float_to_integer_zero\n");
+  fprintf(out, "  cpi temp, 142\n");
+  fprintf(out, "  brlo float_to_integer_shift\n");
+  fprintf(out, "  cpi temp, 0xff\n");
+  fprintf(out, "  brne float_to_integer_clamp\n");
+  fprintf(out, "  mov temp, float_a2\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  or temp, float_a1\n");
+  fprintf(out, "  or temp, float_a0\n");
+  fprintf(out, "  brne float_to_integer_zero\n");
+  fprintf(out, "float_to_integer_clamp:\n");
+  fprintf(out, "  tst float_a3\n");
+  fprintf(out, "  brmi float_to_integer_min\n");
+  fprintf(out, "  ldi temp, 0xff\n");
+  PUSH_LO("temp");
+  fprintf(out, "  ldi temp, 0x7f\n");
+  PUSH_HI("temp");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_to_integer_min:\n");
+  PUSH_LO("zero");
+  fprintf(out, "  ldi temp, 0x80\n");
+  PUSH_HI("temp");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_to_integer_zero:\n");
+  PUSH_LO("zero");
+  PUSH_HI("zero");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_to_integer_shift:\n");
+  // Top 16 bits of the mantissa shifted right 142 - exponent times.
+  fprintf(out, "  ldi temp2, 142\n");
+  fprintf(out, "  sub temp2, temp\n");
+  fprintf(out, "  ori float_a2, 0x80\n");
+  fprintf(out, "float_to_integer_loop:\n");
+  fprintf(out, "  lsr float_a2\n");
+  fprintf(out, "  ror float_a1\n");
+  fprintf(out, "  dec temp2\n");
+  fprintf(out, "  brne float_to_integer_loop\n");
+  fprintf(out, "  tst float_a3\n");
+  fprintf(out, "  brpl float_to_integer_push\n");
+  fprintf(out, "  com float_a2\n");
+  fprintf(out, "  neg float_a1\n");
+  fprintf(out, "  sbci float_a2, 0xff\n");
+  fprintf(out, "float_to_integer_push:\n");
+  PUSH_LO("float_a1");
+  PUSH_HI("float_a2");
+  fprintf(out, "  ret\n\n");
+}
+
+void AVR8::insert_compare_floats()
+{
+  // fcmpl / fcmpg: -1, 0 or 1 comparing a to b.  They only differ in what
+  // NaN gives.
+  fprintf(out, "compare_floats_g:\n");
+  fprintf(out, "  ldi float_x, 1\n");
+  fprintf(out, "  rjmp compare_floats_start\n");
+  fprintf(out, "compare_floats_l:\n");
+  fprintf(out, "  ldi float_x, 0xff\n");
+  fprintf(out, "compare_floats_start:\n");
+  fprintf(out, "  rcall float_pop_ab\n");
+  fprintf(out, "  rcall float_is_nan\n");
+  fprintf(out, "  brcc compare_floats_numbers\n");
+  fprintf(out, "  mov temp, float_x\n");
+  fprintf(out, "  rjmp compare_floats_push\n");
+  fprintf(out, "compare_floats_numbers:\n");
+  // -0 and 0 are equal.
+  fprintf(out, "  mov temp, float_a3\n");
+  fprintf(out, "  or temp, float_b3\n");
+  fprintf(out, "  andi temp, 0x7f\n");
+  fprintf(out, "  or temp, float_a2\n");
+  fprintf(out, "  or temp, float_b2\n");
+  fprintf(out, "  or temp, float_a1\n");
+  fprintf(out, "  or temp, float_b1\n");
+  fprintf(out, "  or temp, float_a0\n");
+  fprintf(out, "  or temp, float_b0\n");
+  fprintf(out, "  breq compare_floats_push\n");
+  // Flip the magnitude of negative numbers and then the sign bits so it's
+  // an unsigned compare.
+  fprintf(out, "  tst float_a3\n");
+  fprintf(out, "  brpl compare_floats_a_positive\n");
+  fprintf(out, "  ldi temp, 0x7f\n");
+  fprintf(out, "  eor float_a3, temp\n");
+  fprintf(out, "  com float_a2\n");
+  fprintf(out, "  com float_a1\n");
+  fprintf(out, "  com float_a0\n");
+  fprintf(out, "compare_floats_a_positive:\n");
+  fprintf(out, "  tst float_b3\n");
+  fprintf(out, "  brpl compare_floats_b_positive\n");
+  fprintf(out, "  ldi temp, 0x7f\n");
+  fprintf(out, "  eor float_b3, temp\n");
+  fprintf(out, "  com float_b2\n");
+  fprintf(out, "  com float_b1\n");
+  fprintf(out, "  com float_b0\n");
+  fprintf(out, "compare_floats_b_positive:\n");
+  fprintf(out, "  ldi temp, 0x80\n");
+  fprintf(out, "  eor float_a3, temp\n");
+  fprintf(out, "  eor float_b3, temp\n");
+  fprintf(out, "  clr temp\n");
+  fprintf(out, "  cp float_a0, float_b0\n");
+  fprintf(out, "  cpc float_a1, float_b1\n");
+  fprintf(out, "  cpc float_a2, float_b2\n");
+  fprintf(out, "  cpc float_a3, float_b3\n");
+  fprintf(out, "  breq compare_floats_push\n");
+  fprintf(out, "  ldi temp, 0xff\n");
+  fprintf(out, "  brlo compare_floats_push\n");
+  fprintf(out, "  ldi temp, 1\n");
+  fprintf(out, "compare_floats_push:\n");
+  PUSH_LO("temp");
+  fprintf(out, "  mov temp2, temp\n");
+  fprintf(out, "  lsl temp2\n");
+  fprintf(out, "  sbc temp2, temp2\n");
+  PUSH_HI("temp2");
+  fprintf(out, "  ret\n\n");
+}
+
+void AVR8::insert_array_float_support()
+{
+  // new_array float, 4 bytes for each element
+  fprintf(out, "new_array_float:\n");
+  POP_HI("length1");
+  POP_LO("length0");
+  fprintf(out, "  lds result0, heap_ptr + 0\n");
+  fprintf(out, "  lds result1, heap_ptr + 1\n");
+  fprintf(out, "  mov XL, result0\n");
+  fprintf(out, "  mov XH, result1\n");
+  fprintf(out, "  st X+, length0\n");
+  fprintf(out, "  st X, length1\n");
+  fprintf(out, "  lsl length0\n");
+  fprintf(out, "  rol length1\n");
+  fprintf(out, "  lsl length0\n");
+  fprintf(out, "  rol length1\n");
+  fprintf(out, "  add length0, two\n");
+  fprintf(out, "  adc length1, zero\n");
+  fprintf(out, "  lds temp, heap_ptr + 0\n");
+  fprintf(out, "  lds temp2, heap_ptr + 1\n");
+  fprintf(out, "  add temp, length0\n");
+  fprintf(out, "  adc temp2, length1\n");
+  fprintf(out, "  sts heap_ptr + 0, temp\n");
+  fprintf(out, "  sts heap_ptr + 1, temp2\n");
+  fprintf(out, "  add result0, three\n");
+  fprintf(out, "  adc result1, zero\n");
+  fprintf(out, "  ldi temp, 254\n");
+  fprintf(out, "  and result0, temp\n");
+  PUSH_LO("result0");
+  PUSH_HI("result1");
+  fprintf(out, "  ret\n");
+  // array_read_float
+  fprintf(out, "array_read_float:\n");
+  POP_HI("ZH");
+  POP_LO("ZL");
+  POP_HI("XH");
+  POP_LO("XL");
+  fprintf(out, "  rjmp array_read_float_index\n");
+  // array_read_float2 (X already has the array)
+  fprintf(out, "array_read_float2:\n");
+  POP_HI("ZH");
+  POP_LO("ZL");
+  fprintf(out, "array_read_float_index:\n");
+  fprintf(out, "  lsl ZL\n");
+  fprintf(out, "  rol ZH\n");
+  fprintf(out, "  lsl ZL\n");
+  fprintf(out, "  rol ZH\n");
+  fprintf(out, "  add XL, ZL\n");
+  fprintf(out, "  adc XH, ZH\n");
+  fprintf(out, "  ld temp, X+\n");
+  PUSH_LO("temp");
+  fprintf(out, "  ld temp, X+\n");
+  PUSH_HI("temp");
+  fprintf(out, "  ld temp, X+\n");
+  PUSH_LO("temp");
+  fprintf(out, "  ld temp, X\n");
+  PUSH_HI("temp");
+  fprintf(out, "  ret\n");
+  // array_write_float
+  fprintf(out, "array_write_float:\n");
+  fprintf(out, "  rcall float_pop_a\n");
+  POP_HI("ZH");
+  POP_LO("ZL");
+  POP_HI("XH");
+  POP_LO("XL");
+  fprintf(out, "  rjmp array_write_float_index\n");
+  // array_write_float2 (X already has the array)
+  fprintf(out, "array_write_float2:\n");
+  fprintf(out, "  rcall float_pop_a\n");
+  POP_HI("ZH");
+  POP_LO("ZL");
+  fprintf(out, "array_write_float_index:\n");
+  fprintf(out, "  lsl ZL\n");
+  fprintf(out, "  rol ZH\n");
+  fprintf(out, "  lsl ZL\n");
+  fprintf(out, "  rol ZH\n");
+  fprintf(out, "  add XL, ZL\n");
+  fprintf(out, "  adc XH, ZH\n");
+  fprintf(out, "  st X+, float_a0\n");
+  fprintf(out, "  st X+, float_a1\n");
+  fprintf(out, "  st X+, float_a2\n");
+  fprintf(out, "  st X, float_a3\n");
+  fprintf(out, "  ret\n\n");
+}
+
 // Memory API
 int AVR8::memory_read8_I()
 {
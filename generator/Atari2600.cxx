@@ -14,6 +14,7 @@
 #include <stdint.h>
 
 #include "Atari2600.h"
+#include "CyclesM6502.h"
 
 // http://www.alienbill.com/2600/101/docs/stella.html
 // http://problemkaputt.de/2k6specs.htm
@@ -59,6 +60,12 @@ Atari2600::~Atari2600()
   fprintf(out, "dw reset\n");
 }
 
+Cycles *Atari2600::new_cycles()
+{
+  // 76 CPU cycles to a scanline.
+  return new CyclesM6502(76, "WSYNC");
+}
+
 int Atari2600::open(const char *filename)
 {
   if (M6502_8::open(filename) != 0) { return -1; }
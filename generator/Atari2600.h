@@ -21,6 +21,7 @@ public:
   virtual ~Atari2600();
 
   virtual int open(const char *filename);
+  virtual Cycles *new_cycles();
   virtual int atari2600_waitHsync_I();
   virtual int atari2600_waitHsync_I(int lines);
   virtual int atari2600_waitHsync();
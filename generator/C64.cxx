@@ -86,6 +86,14 @@ int C64::open(const char *filename)
   fprintf(out, "value2 equ 0x2c\n");
   fprintf(out, "value3 equ 0x2e\n");
 
+  // soft float uses BASIC's float work area
+  fprintf(out, "float_a equ 0x50\n");
+  fprintf(out, "float_b equ 0x54\n");
+  fprintf(out, "float_m equ 0x58\n");
+  fprintf(out, "float_e equ 0x5c\n");
+  fprintf(out, "float_s equ 0x5e\n");
+  fprintf(out, "float_x equ 0x5f\n");
+
   // sprites
   fprintf(out, "sprite_msb_set equ 0x10\n");
   fprintf(out, "sprite_msb_clear equ 0x11\n");
@@ -0,0 +1,454 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "Cycles.h"
+
+// Lines that aren't instructions.
+static const char *directives[] =
+{
+  "db", "dw", "dc", "dc8", "dc16", "dc32", "dc64", "dd", "dl", "ds",
+  "equ", "org", "align", "include",
+  NULL
+};
+
+static bool is_directive(const char *name)
+{
+  int n;
+
+  if (name[0] == '.') { return true; }
+
+  for (n = 0; directives[n] != NULL; n++)
+  {
+    if (strcmp(directives[n], name) == 0) { return true; }
+  }
+
+  return false;
+}
+
+static bool is_symbol_char(char c)
+{
+  return isalnum(c) || c == '_' || c == '.';
+}
+
+Cycles::Cycles() :
+  cycles_per_line(0),
+  block_count(0),
+  order_count(0),
+  method_cycles(0),
+  unknown_count(0),
+  loops(false)
+{
+}
+
+Cycles::~Cycles()
+{
+}
+
+void Cycles::read_symbols(const char *text, int length)
+{
+  const char *end = text + length;
+  const char *s = text;
+
+  // Addressing modes (zero page on the 6502 for example) can depend on
+  // the value of a name, so keep every "name equ value" around.
+  while (s < end)
+  {
+    const char *next = s;
+    const char *name, *expr;
+    int name_len, expr_len;
+
+    while (next < end && *next != '\n') { next++; }
+
+    while (s < next && (*s == ' ' || *s == '\t')) { s++; }
+    name = s;
+    while (s < next && is_symbol_char(*s)) { s++; }
+    name_len = s - name;
+    while (s < next && (*s == ' ' || *s == '\t')) { s++; }
+
+    if (name_len != 0 && next - s > 4 && strncasecmp(s, "equ", 3) == 0 &&
+        (s[3] == ' ' || s[3] == '\t'))
+    {
+      expr = s + 4;
+      while (expr < next && (*expr == ' ' || *expr == '\t')) { expr++; }
+      expr_len = 0;
+      while (expr + expr_len < next && expr[expr_len] != ';') { expr_len++; }
+      while (expr_len > 0 && isspace(expr[expr_len - 1])) { expr_len--; }
+
+      symbols[std::string(name, name_len)] = std::string(expr, expr_len);
+    }
+
+    s = next + 1;
+  }
+}
+
+int Cycles::get_value(const char *expr, int *value)
+{
+  return get_number(expr, strlen(expr), value, 0);
+}
+
+int Cycles::get_number(const char *s, int len, int *value, int depth)
+{
+  const char *end = s + len;
+  int sign = 1;
+  int total = 0;
+  int n;
+
+  // Only sums of numbers and names are worked out.  Anything else is
+  // left for the caller to assume the worst about.
+  if (depth > 16) { return -1; }
+
+  while (s < end)
+  {
+    while (s < end && (*s == ' ' || *s == '\t')) { s++; }
+    if (s == end) { return -1; }
+
+    const char *term = s;
+
+    while (s < end && *s != '+' && *s != '-') { s++; }
+
+    n = s - term;
+    while (n > 0 && (term[n - 1] == ' ' || term[n - 1] == '\t')) { n--; }
+
+    if (n == 0)
+    {
+      // A leading minus sign.
+      if (s < end && *s == '-' && total == 0 && term == s) { sign = -sign; s++; continue; }
+      return -1;
+    }
+
+    std::string word(term, n);
+    const char *w = word.c_str();
+    char *w_end;
+    long v;
+
+    if (isdigit(w[0]))
+    {
+      v = strtol(w, &w_end, 0);
+      if (*w_end != 0) { return -1; }
+    }
+      else
+    if (w[0] == '$')
+    {
+      v = strtol(w + 1, &w_end, 16);
+      if (*w_end != 0 || w[1] == 0) { return -1; }
+    }
+      else
+    {
+      std::map<std::string,std::string>::iterator iter = symbols.find(word);
+      int symbol_value;
+
+      if (iter == symbols.end()) { return -1; }
+
+      if (get_number(iter->second.c_str(), iter->second.size(), &symbol_value, depth + 1) != 0)
+      {
+        return -1;
+      }
+
+      v = symbol_value;
+    }
+
+    total += sign * v;
+
+    if (s < end) { sign = *s == '-' ? -1 : 1; s++; }
+  }
+
+  *value = total;
+
+  return 0;
+}
+
+void Cycles::get_target(const char *operand, char *target, int len)
+{
+  int n = 0;
+
+  while (*operand == ' ' || *operand == '#' || *operand == '@') { operand++; }
+
+  while (is_symbol_char(operand[n]) && n < len - 1)
+  {
+    target[n] = operand[n];
+    n++;
+  }
+
+  target[n] = 0;
+}
+
+int Cycles::open_block(int start)
+{
+  cycles_block_t *block = &blocks[block_count];
+
+  block->start = start;
+  block->cycles = 0;
+  block->next = -1;
+  block->target = -1;
+  block->unknown = false;
+
+  return block_count++;
+}
+
+int Cycles::analyze(const char *text, int start, int end)
+{
+  std::map<int,std::string>::iterator iter;
+  const char *s = text + start;
+  const char *text_end = text + end;
+  char instr[32];
+  char operands[256];
+  int open = -1;
+  int last = -1;
+  bool falls = false;
+  bool table = false;
+  int table_block = -1;
+  int instr_count = 0;
+  int n;
+
+  blocks.clear();
+  labels.clear();
+  targets.clear();
+  state.clear();
+  longest.clear();
+  order.clear();
+  back_edges.clear();
+  order_count = 0;
+  block_count = 0;
+  method_cycles = 0;
+  unknown_count = 0;
+  loops = false;
+
+  while (s < text_end)
+  {
+    const char *line = s;
+    const char *next = s;
+
+    while (next < text_end && *next != '\n') { next++; }
+
+    s = next + 1;
+
+    const char *p = line;
+
+    while (p < next && (*p == ' ' || *p == '\t')) { p++; }
+
+    if (p == next || *p == ';') { continue; }
+
+    for (n = 0; p + n < next && is_symbol_char(p[n]); n++);
+
+    if (n != 0 && p + n < next && p[n] == ':')
+    {
+      // A label starts a new block unless the block so far is empty.
+      // The block's text starts on the line after it.
+      if (open != -1 && instr_count != 0)
+      {
+        last = open;
+        falls = true;
+        open = -1;
+      }
+
+      if (open == -1)
+      {
+        open = open_block(s < text_end ? s - text : end);
+        if (last != -1 && falls) { blocks[last].next = open; }
+        last = -1;
+        instr_count = 0;
+      }
+
+      labels[std::string(p, n)] = open;
+      continue;
+    }
+
+    // Anything else starting in column 0 is a directive or a
+    // "name equ value".
+    if (p == line) { continue; }
+
+    for (n = 0; p < next && *p != ' ' && *p != '\t' && *p != ';'; p++)
+    {
+      if (n < (int)sizeof(instr) - 1) { instr[n++] = tolower(*p); }
+    }
+
+    instr[n] = 0;
+
+    // "dw label" lines right after a jump that doesn't name its target
+    // are a jump table.  Each one is taken as a branch to its case.
+    bool entry = table && strcmp(instr, "dw") == 0;
+
+    if (!entry && is_directive(instr)) { continue; }
+
+    while (p < next && (*p == ' ' || *p == '\t')) { p++; }
+
+    for (n = 0; p < next && *p != ';' && n < (int)sizeof(operands) - 1; p++)
+    {
+      operands[n++] = *p;
+    }
+
+    while (n > 0 && (operands[n - 1] == ' ' || operands[n - 1] == '\t' || operands[n - 1] == '\r'))
+    {
+      n--;
+    }
+
+    operands[n] = 0;
+
+    // "name equ value" with the name indented.
+    if (strncasecmp(operands, "equ", 3) == 0 &&
+        (operands[3] == ' ' || operands[3] == '\t'))
+    {
+      continue;
+    }
+
+    if (open == -1)
+    {
+      open = open_block(line - text);
+      if (last != -1 && falls) { blocks[last].next = open; }
+      last = -1;
+      instr_count = 0;
+    }
+
+    // Control doesn't fall off the end of a jump table (or out of an
+    // indirect jump that didn't have one).
+    if (table && !entry)
+    {
+      blocks[table_block].next = -1;
+      table = false;
+    }
+
+    cycles_instr_t info;
+
+    info.cycles = 0;
+    info.type = CYCLES_PLAIN;
+    info.target[0] = 0;
+
+    if (entry)
+    {
+      info.type = CYCLES_BRANCH;
+      get_target(operands, info.target, sizeof(info.target));
+    }
+      else
+    if (get_instruction(instr, operands, &info) != 0)
+    {
+      blocks[open].unknown = true;
+      unknown_count++;
+    }
+
+    blocks[open].cycles += info.cycles;
+    instr_count++;
+
+    if (info.type == CYCLES_PLAIN) { continue; }
+
+    if (info.target[0] != 0) { targets[open] = info.target; }
+
+    last = open;
+    falls = info.type == CYCLES_BRANCH || info.type == CYCLES_SYNC;
+
+    if (entry || (info.type == CYCLES_JUMP && info.target[0] == 0))
+    {
+      table = true;
+      table_block = open;
+      falls = true;
+    }
+
+    open = -1;
+  }
+
+  for (iter = targets.begin(); iter != targets.end(); iter++)
+  {
+    std::map<std::string,int>::iterator label = labels.find(iter->second);
+
+    if (label != labels.end()) { blocks[iter->first].target = label->second; }
+  }
+
+  if (block_count == 0) { return 0; }
+
+  method_cycles = longest_path(0);
+
+  // A path can go around a loop once: into the loop head, along the
+  // body to the back edge and then out the longest way from the head.
+  std::map<int,int> path_to;
+
+  path_to[0] = blocks[0].cycles;
+
+  for (n = order_count - 1; n >= 0; n--)
+  {
+    int block = order[n];
+    int successors[2] = { blocks[block].next, blocks[block].target };
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+      int successor = successors[i];
+
+      if (successor == -1) { continue; }
+
+      if (back_edges.find(block * 2 + i) != back_edges.end())
+      {
+        int path = path_to[block] + longest[successor];
+
+        if (path > method_cycles) { method_cycles = path; }
+        continue;
+      }
+
+      int path = path_to[block] + blocks[successor].cycles;
+
+      if (path > path_to[successor]) { path_to[successor] = path; }
+    }
+  }
+
+  return 0;
+}
+
+int Cycles::longest_path(int block)
+{
+  int successors[2];
+  int best = 0;
+  int n;
+
+  successors[0] = blocks[block].next;
+  successors[1] = blocks[block].target;
+
+  // Blocks still on the path being followed are loop heads.  Those
+  // edges are left out here so this is the longest path that doesn't
+  // loop.
+  state[block] = 1;
+
+  for (n = 0; n < 2; n++)
+  {
+    int successor = successors[n];
+    int path;
+
+    if (successor == -1) { continue; }
+
+    if (state[successor] == 1)
+    {
+      back_edges[block * 2 + n] = successor;
+      loops = true;
+      continue;
+    }
+
+    if (state[successor] == 2)
+    {
+      path = longest[successor];
+    }
+      else
+    {
+      path = longest_path(successor);
+    }
+
+    if (path > best) { best = path; }
+  }
+
+  state[block] = 2;
+  longest[block] = blocks[block].cycles + best;
+  order[order_count++] = block;
+
+  return longest[block];
+}
+
@@ -0,0 +1,98 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_H
+#define _CYCLES_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+// Static worst case cycle counts for the assembly a Generator wrote.
+// Each CPU subclass has a table of cycles per instruction (and
+// addressing mode) and says which instructions change control flow.
+// From that the code is split into basic blocks and the longest path
+// through a method is found that goes around at most one loop once.
+
+enum
+{
+  CYCLES_PLAIN,
+  CYCLES_BRANCH,   // conditional, falls through or goes to target
+  CYCLES_JUMP,     // always goes to target (or somewhere unknown)
+  CYCLES_RETURN,
+  CYCLES_SYNC,     // waits for something like the end of a scanline
+};
+
+struct cycles_instr_t
+{
+  int cycles;
+  int type;
+  char target[128];
+};
+
+struct cycles_block_t
+{
+  int start;        // offset in the text of the block's first line
+  int cycles;
+  int next;         // block control falls through to or -1
+  int target;       // block a branch / jump goes to or -1
+  bool unknown;     // has instructions that aren't in the table
+};
+
+class Cycles
+{
+public:
+  Cycles();
+  virtual ~Cycles();
+
+  void read_symbols(const char *text, int length);
+  int analyze(const char *text, int start, int end);
+  int get_cycles() { return method_cycles; }
+  bool has_loops() { return loops; }
+  bool is_complete() { return unknown_count == 0; }
+  int get_block_count() { return block_count; }
+  const cycles_block_t *get_block(int n) { return &blocks[n]; }
+  // CPUs that race the beam (Atari 2600) have a budget per scanline.
+  int get_cycles_per_line() { return cycles_per_line; }
+
+protected:
+  // Returns -1 if the instruction isn't known.  The mnemonic is lower
+  // case and operands have had comments and trailing spaces removed.
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info) = 0;
+
+  int get_value(const char *expr, int *value);
+  static void get_target(const char *operand, char *target, int len);
+
+  int cycles_per_line;
+
+private:
+  int open_block(int start);
+  int longest_path(int block);
+  int get_number(const char *s, int len, int *value, int depth);
+
+  std::map<int,cycles_block_t> blocks;
+  std::map<std::string,int> labels;
+  std::map<int,std::string> targets;
+  std::map<int,int> state;
+  std::map<int,int> longest;
+  std::map<int,int> order;        // blocks in the order longest_path() ended
+  std::map<int,int> back_edges;   // block * 2 + successor -> loop head
+  std::map<std::string,std::string> symbols;
+  int block_count;
+  int order_count;
+  int method_cycles;
+  int unknown_count;
+  bool loops;
+};
+
+#endif
+
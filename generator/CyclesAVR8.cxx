@@ -0,0 +1,158 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "CyclesAVR8.h"
+
+struct avr8_cycles_t
+{
+  const char *name;
+  int cycles;
+  int type;
+};
+
+// Cycles for the ATmega / ATtiny (AVRe) core with a 16 bit PC.
+// Branches are counted as taken and skips as skipping a two word
+// instruction.
+static avr8_cycles_t avr8_cycles[] =
+{
+  { "adc", 1, CYCLES_PLAIN },
+  { "add", 1, CYCLES_PLAIN },
+  { "adiw", 2, CYCLES_PLAIN },
+  { "and", 1, CYCLES_PLAIN },
+  { "andi", 1, CYCLES_PLAIN },
+  { "asr", 1, CYCLES_PLAIN },
+  { "bclr", 1, CYCLES_PLAIN },
+  { "bld", 1, CYCLES_PLAIN },
+  { "break", 1, CYCLES_PLAIN },
+  { "bset", 1, CYCLES_PLAIN },
+  { "bst", 1, CYCLES_PLAIN },
+  { "call", 4, CYCLES_PLAIN },
+  { "cbi", 2, CYCLES_PLAIN },
+  { "cbr", 1, CYCLES_PLAIN },
+  { "clc", 1, CYCLES_PLAIN },
+  { "cli", 1, CYCLES_PLAIN },
+  { "clr", 1, CYCLES_PLAIN },
+  { "clt", 1, CYCLES_PLAIN },
+  { "com", 1, CYCLES_PLAIN },
+  { "cp", 1, CYCLES_PLAIN },
+  { "cpc", 1, CYCLES_PLAIN },
+  { "cpi", 1, CYCLES_PLAIN },
+  { "cpse", 3, CYCLES_PLAIN },
+  { "dec", 1, CYCLES_PLAIN },
+  { "eor", 1, CYCLES_PLAIN },
+  { "fmul", 2, CYCLES_PLAIN },
+  { "icall", 3, CYCLES_PLAIN },
+  { "ijmp", 2, CYCLES_JUMP },
+  { "in", 1, CYCLES_PLAIN },
+  { "inc", 1, CYCLES_PLAIN },
+  { "jmp", 3, CYCLES_JUMP },
+  { "ld", 2, CYCLES_PLAIN },
+  { "ldd", 2, CYCLES_PLAIN },
+  { "ldi", 1, CYCLES_PLAIN },
+  { "lds", 2, CYCLES_PLAIN },
+  { "lpm", 3, CYCLES_PLAIN },
+  { "lsl", 1, CYCLES_PLAIN },
+  { "lsr", 1, CYCLES_PLAIN },
+  { "mov", 1, CYCLES_PLAIN },
+  { "movw", 1, CYCLES_PLAIN },
+  { "mul", 2, CYCLES_PLAIN },
+  { "muls", 2, CYCLES_PLAIN },
+  { "mulsu", 2, CYCLES_PLAIN },
+  { "neg", 1, CYCLES_PLAIN },
+  { "nop", 1, CYCLES_PLAIN },
+  { "or", 1, CYCLES_PLAIN },
+  { "ori", 1, CYCLES_PLAIN },
+  { "out", 1, CYCLES_PLAIN },
+  { "pop", 2, CYCLES_PLAIN },
+  { "push", 2, CYCLES_PLAIN },
+  { "rcall", 3, CYCLES_PLAIN },
+  { "ret", 4, CYCLES_RETURN },
+  { "reti", 4, CYCLES_RETURN },
+  { "rjmp", 2, CYCLES_JUMP },
+  { "rol", 1, CYCLES_PLAIN },
+  { "ror", 1, CYCLES_PLAIN },
+  { "sbc", 1, CYCLES_PLAIN },
+  { "sbci", 1, CYCLES_PLAIN },
+  { "sbi", 2, CYCLES_PLAIN },
+  { "sbic", 3, CYCLES_PLAIN },
+  { "sbis", 3, CYCLES_PLAIN },
+  { "sbiw", 2, CYCLES_PLAIN },
+  { "sbr", 1, CYCLES_PLAIN },
+  { "sbrc", 3, CYCLES_PLAIN },
+  { "sbrs", 3, CYCLES_PLAIN },
+  { "sec", 1, CYCLES_PLAIN },
+  { "sei", 1, CYCLES_PLAIN },
+  { "ser", 1, CYCLES_PLAIN },
+  { "set", 1, CYCLES_PLAIN },
+  { "sleep", 1, CYCLES_PLAIN },
+  { "st", 2, CYCLES_PLAIN },
+  { "std", 2, CYCLES_PLAIN },
+  { "sts", 2, CYCLES_PLAIN },
+  { "sub", 1, CYCLES_PLAIN },
+  { "subi", 1, CYCLES_PLAIN },
+  { "swap", 1, CYCLES_PLAIN },
+  { "tst", 1, CYCLES_PLAIN },
+  { "wdr", 1, CYCLES_PLAIN },
+  { NULL, 0, 0 }
+};
+
+CyclesAVR8::CyclesAVR8()
+{
+}
+
+CyclesAVR8::~CyclesAVR8()
+{
+}
+
+int CyclesAVR8::get_instruction(const char *instr, const char *operands, cycles_instr_t *info)
+{
+  int n;
+
+  // brne, brge, brcc, ... all take 2 cycles when taken.
+  if (instr[0] == 'b' && instr[1] == 'r' && instr[2] != 0 &&
+      strcmp(instr, "break") != 0)
+  {
+    const char *label = strrchr(operands, ',');
+
+    // brbs / brbc have the bit number first.
+    label = label == NULL ? operands : label + 1;
+
+    info->cycles = 2;
+    info->type = CYCLES_BRANCH;
+    get_target(label, info->target, sizeof(info->target));
+
+    return 0;
+  }
+
+  for (n = 0; avr8_cycles[n].name != NULL; n++)
+  {
+    if (strcmp(instr, avr8_cycles[n].name) == 0)
+    {
+      info->cycles = avr8_cycles[n].cycles;
+      info->type = avr8_cycles[n].type;
+
+      if (info->type == CYCLES_JUMP && strcmp(instr, "ijmp") != 0)
+      {
+        get_target(operands, info->target, sizeof(info->target));
+      }
+
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
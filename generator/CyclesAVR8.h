@@ -0,0 +1,28 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_AVR8_H
+#define _CYCLES_AVR8_H
+
+#include "Cycles.h"
+
+class CyclesAVR8 : public Cycles
+{
+public:
+  CyclesAVR8();
+  virtual ~CyclesAVR8();
+
+protected:
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info);
+};
+
+#endif
+
@@ -0,0 +1,243 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "CyclesM6502.h"
+
+enum
+{
+  MODE_IMMEDIATE,
+  MODE_ZP,
+  MODE_ZP_X,
+  MODE_ZP_Y,
+  MODE_ABSOLUTE,
+  MODE_ABSOLUTE_X,
+  MODE_ABSOLUTE_Y,
+  MODE_INDIRECT,
+  MODE_INDIRECT_X,
+  MODE_INDIRECT_Y,
+  MODE_IMPLIED,
+  MODE_RELATIVE,
+  MODE_COUNT
+};
+
+#define NA -1
+
+struct m6502_cycles_t
+{
+  const char *name;
+  int8_t cycles[MODE_COUNT];
+};
+
+// Same layout as the encoder's table.  Reads that can cross a page
+// (abs,x  abs,y  (zp),y) have the extra cycle added in and branches
+// are counted as taken to another page.
+// imm, zp, zp_x, zp_y, abs, abs_x, abs_y, ind, ind_x, ind_y, implied, rel
+static m6502_cycles_t m6502_cycles[] =
+{
+  { "adc", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "and", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "asl", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, 2, NA } },
+  { "bcc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "bcs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "beq", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "bit", { NA, 3, NA, NA, 4, NA, NA, NA, NA, NA, NA, NA } },
+  { "bmi", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "bne", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "bpl", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "brk", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 7, NA } },
+  { "bvc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "bvs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4 } },
+  { "clc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "cld", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "cli", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "clv", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "cmp", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "cpx", { 2, 3, NA, NA, 4, NA, NA, NA, NA, NA, NA, NA } },
+  { "cpy", { 2, 3, NA, NA, 4, NA, NA, NA, NA, NA, NA, NA } },
+  { "dec", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, NA, NA } },
+  { "dex", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "dey", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "eor", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "inc", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, NA, NA } },
+  { "inx", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "iny", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "jmp", { NA, NA, NA, NA, 3, NA, NA, 5, NA, NA, NA, NA } },
+  { "jsr", { NA, NA, NA, NA, 6, NA, NA, NA, NA, NA, NA, NA } },
+  { "lda", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "ldx", { 2, 3, NA, 4, 4, NA, 5, NA, NA, NA, NA, NA } },
+  { "ldy", { 2, 3, 4, NA, 4, 5, NA, NA, NA, NA, NA, NA } },
+  { "lsr", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, 2, NA } },
+  { "nop", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "ora", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "pha", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 3, NA } },
+  { "php", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 3, NA } },
+  { "pla", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4, NA } },
+  { "plp", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 4, NA } },
+  { "rol", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, 2, NA } },
+  { "ror", { NA, 5, 6, NA, 6, 7, NA, NA, NA, NA, 2, NA } },
+  { "rti", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 6, NA } },
+  { "rts", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 6, NA } },
+  { "sbc", { 2, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "sec", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "sed", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "sei", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "sta", { NA, 3, 4, NA, 4, 5, 5, NA, 6, 6, NA, NA } },
+  { "stx", { NA, 3, NA, 4, 4, NA, NA, NA, NA, NA, NA, NA } },
+  { "sty", { NA, 3, 4, NA, 4, NA, NA, NA, NA, NA, NA, NA } },
+  { "tax", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "tay", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "tsx", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "txa", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "txs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { "tya", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 2, NA } },
+  { NULL, { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA } }
+};
+
+// Cuts ",x" / ",y" off the end of an operand and returns which it was.
+static char get_index(char *s)
+{
+  int len = strlen(s);
+
+  if (len < 2 || s[len - 2] != ',') { return 0; }
+
+  char index = s[len - 1] | 0x20;
+
+  if (index != 'x' && index != 'y') { return 0; }
+
+  s[len - 2] = 0;
+
+  for (len -= 3; len >= 0 && (s[len] == ' ' || s[len] == '\t'); len--)
+  {
+    s[len] = 0;
+  }
+
+  return index;
+}
+
+CyclesM6502::CyclesM6502(int cycles_per_line, const char *sync_register) :
+  sync_register(sync_register)
+{
+  this->cycles_per_line = cycles_per_line;
+}
+
+CyclesM6502::~CyclesM6502()
+{
+}
+
+int CyclesM6502::get_instruction(const char *instr, const char *operands, cycles_instr_t *info)
+{
+  m6502_cycles_t *table = NULL;
+  char s[256];
+  int value, mode, n;
+
+  for (n = 0; m6502_cycles[n].name != NULL; n++)
+  {
+    if (strcmp(instr, m6502_cycles[n].name) == 0)
+    {
+      table = &m6502_cycles[n];
+      break;
+    }
+  }
+
+  if (table == NULL) { return -1; }
+
+  snprintf(s, sizeof(s), "%s", operands);
+
+  if (strcmp(instr, "rts") == 0 || strcmp(instr, "rti") == 0 ||
+      strcmp(instr, "brk") == 0)
+  {
+    info->type = CYCLES_RETURN;
+  }
+    else
+  if (strcmp(instr, "jmp") == 0)
+  {
+    info->type = CYCLES_JUMP;
+    if (s[0] != '(') { get_target(s, info->target, sizeof(info->target)); }
+  }
+    else
+  if (table->cycles[MODE_RELATIVE] != NA)
+  {
+    // bne #-5 is an offset and doesn't name a block.
+    info->cycles = table->cycles[MODE_RELATIVE];
+    info->type = CYCLES_BRANCH;
+    if (s[0] != '#') { get_target(s, info->target, sizeof(info->target)); }
+    return 0;
+  }
+
+  if (s[0] == 0 || strcasecmp(s, "a") == 0)
+  {
+    mode = MODE_IMPLIED;
+  }
+    else
+  if (s[0] == '#')
+  {
+    mode = MODE_IMMEDIATE;
+  }
+    else
+  {
+    int len = strlen(s);
+
+    if (s[0] == '(' && len > 4 && strcasecmp(s + len - 3, "),y") == 0)
+    {
+      mode = MODE_INDIRECT_Y;
+    }
+      else
+    if (s[0] == '(' && len > 4 && strcasecmp(s + len - 3, ",x)") == 0)
+    {
+      mode = MODE_INDIRECT_X;
+    }
+      else
+    if (s[0] == '(' && table->cycles[MODE_INDIRECT] != NA && s[len - 1] == ')')
+    {
+      mode = MODE_INDIRECT;
+    }
+      else
+    {
+      char index = get_index(s);
+      int zp = MODE_ZP;
+      int absolute = MODE_ABSOLUTE;
+
+      if (index == 'x') { zp = MODE_ZP_X; absolute = MODE_ABSOLUTE_X; }
+      else if (index == 'y') { zp = MODE_ZP_Y; absolute = MODE_ABSOLUTE_Y; }
+
+      // An address that can't be worked out here is taken as absolute
+      // since that's never faster than zero page.
+      if (table->cycles[zp] != NA && get_value(s, &value) == 0 &&
+          value >= 0 && value <= 255)
+      {
+        mode = zp;
+      }
+        else
+      {
+        mode = absolute;
+      }
+
+      if (sync_register != NULL && strcmp(instr, "sta") == 0 &&
+          index == 0 && strcasecmp(s, sync_register) == 0)
+      {
+        info->type = CYCLES_SYNC;
+      }
+    }
+  }
+
+  if (table->cycles[mode] == NA) { return -1; }
+
+  info->cycles = table->cycles[mode];
+
+  return 0;
+}
+
@@ -0,0 +1,33 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_M6502_H
+#define _CYCLES_M6502_H
+
+#include "Cycles.h"
+
+class CyclesM6502 : public Cycles
+{
+public:
+  // A store to sync_register (WSYNC on the Atari 2600) halts the CPU
+  // until the end of the scanline.
+  CyclesM6502(int cycles_per_line = 0, const char *sync_register = NULL);
+  virtual ~CyclesM6502();
+
+protected:
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info);
+
+private:
+  const char *sync_register;
+};
+
+#endif
+
@@ -0,0 +1,178 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "CyclesMIPS32.h"
+
+struct mips32_cycles_t
+{
+  const char *name;
+  int cycles;
+  int type;
+};
+
+// Cycles for the M4K core in the PIC32MX.  Loads are counted as if the
+// result isn't used by the next instruction.  A divide is the worst
+// case of the early out divider.  Branches and jumps include the
+// instruction in their delay slot, so the fall through path counts a
+// delay slot nop twice.
+static mips32_cycles_t mips32_cycles[] =
+{
+  { "add", 1, CYCLES_PLAIN },
+  { "addi", 1, CYCLES_PLAIN },
+  { "addiu", 1, CYCLES_PLAIN },
+  { "addu", 1, CYCLES_PLAIN },
+  { "and", 1, CYCLES_PLAIN },
+  { "andi", 1, CYCLES_PLAIN },
+  { "b", 2, CYCLES_JUMP },
+  { "bal", 2, CYCLES_PLAIN },
+  { "beq", 2, CYCLES_BRANCH },
+  { "beqz", 2, CYCLES_BRANCH },
+  { "bgez", 2, CYCLES_BRANCH },
+  { "bgezal", 2, CYCLES_PLAIN },
+  { "bgtz", 2, CYCLES_BRANCH },
+  { "blez", 2, CYCLES_BRANCH },
+  { "bltz", 2, CYCLES_BRANCH },
+  { "bltzal", 2, CYCLES_PLAIN },
+  { "bne", 2, CYCLES_BRANCH },
+  { "bnez", 2, CYCLES_BRANCH },
+  { "clo", 1, CYCLES_PLAIN },
+  { "clz", 1, CYCLES_PLAIN },
+  { "di", 1, CYCLES_PLAIN },
+  { "div", 35, CYCLES_PLAIN },
+  { "divu", 35, CYCLES_PLAIN },
+  { "ehb", 1, CYCLES_PLAIN },
+  { "ei", 1, CYCLES_PLAIN },
+  { "eret", 1, CYCLES_RETURN },
+  { "ext", 1, CYCLES_PLAIN },
+  { "ins", 1, CYCLES_PLAIN },
+  { "j", 2, CYCLES_JUMP },
+  { "jal", 2, CYCLES_PLAIN },
+  { "jalr", 2, CYCLES_PLAIN },
+  { "la", 2, CYCLES_PLAIN },
+  { "lb", 1, CYCLES_PLAIN },
+  { "lbu", 1, CYCLES_PLAIN },
+  { "lh", 1, CYCLES_PLAIN },
+  { "lhu", 1, CYCLES_PLAIN },
+  { "lui", 1, CYCLES_PLAIN },
+  { "lw", 1, CYCLES_PLAIN },
+  { "madd", 1, CYCLES_PLAIN },
+  { "maddu", 1, CYCLES_PLAIN },
+  { "mfhi", 1, CYCLES_PLAIN },
+  { "mflo", 1, CYCLES_PLAIN },
+  { "move", 1, CYCLES_PLAIN },
+  { "movn", 1, CYCLES_PLAIN },
+  { "movz", 1, CYCLES_PLAIN },
+  { "msub", 1, CYCLES_PLAIN },
+  { "msubu", 1, CYCLES_PLAIN },
+  { "mthi", 1, CYCLES_PLAIN },
+  { "mtlo", 1, CYCLES_PLAIN },
+  { "mul", 2, CYCLES_PLAIN },
+  { "mult", 1, CYCLES_PLAIN },
+  { "multu", 1, CYCLES_PLAIN },
+  { "neg", 1, CYCLES_PLAIN },
+  { "negu", 1, CYCLES_PLAIN },
+  { "nop", 1, CYCLES_PLAIN },
+  { "nor", 1, CYCLES_PLAIN },
+  { "not", 1, CYCLES_PLAIN },
+  { "or", 1, CYCLES_PLAIN },
+  { "ori", 1, CYCLES_PLAIN },
+  { "rotr", 1, CYCLES_PLAIN },
+  { "rotrv", 1, CYCLES_PLAIN },
+  { "sb", 1, CYCLES_PLAIN },
+  { "seb", 1, CYCLES_PLAIN },
+  { "seh", 1, CYCLES_PLAIN },
+  { "sh", 1, CYCLES_PLAIN },
+  { "sll", 1, CYCLES_PLAIN },
+  { "sllv", 1, CYCLES_PLAIN },
+  { "slt", 1, CYCLES_PLAIN },
+  { "slti", 1, CYCLES_PLAIN },
+  { "sltiu", 1, CYCLES_PLAIN },
+  { "sltu", 1, CYCLES_PLAIN },
+  { "sra", 1, CYCLES_PLAIN },
+  { "srav", 1, CYCLES_PLAIN },
+  { "srl", 1, CYCLES_PLAIN },
+  { "srlv", 1, CYCLES_PLAIN },
+  { "sub", 1, CYCLES_PLAIN },
+  { "subu", 1, CYCLES_PLAIN },
+  { "sw", 1, CYCLES_PLAIN },
+  { "sync", 1, CYCLES_PLAIN },
+  { "wsbh", 1, CYCLES_PLAIN },
+  { "xor", 1, CYCLES_PLAIN },
+  { "xori", 1, CYCLES_PLAIN },
+  { NULL, 0, 0 }
+};
+
+CyclesMIPS32::CyclesMIPS32()
+{
+}
+
+CyclesMIPS32::~CyclesMIPS32()
+{
+}
+
+int CyclesMIPS32::get_instruction(const char *instr, const char *operands, cycles_instr_t *info)
+{
+  const char *last = strrchr(operands, ',');
+  int value;
+  int n;
+
+  // The branch target (or li value) is the last operand.
+  last = last == NULL ? operands : last + 1;
+  while (*last == ' ' || *last == '\t') { last++; }
+
+  // li is one instruction if the value fits in 16 bits, else lui + ori.
+  if (strcmp(instr, "li") == 0)
+  {
+    info->cycles = 2;
+
+    if (get_value(last, &value) == 0 && value >= -32768 && value <= 65535)
+    {
+      info->cycles = 1;
+    }
+
+    return 0;
+  }
+
+  // jr $ra returns, a jump through any other register goes somewhere
+  // that isn't known (a switch table).
+  if (strcmp(instr, "jr") == 0)
+  {
+    info->cycles = 2;
+    info->type = strcmp(last, "$ra") == 0 || strcmp(last, "$31") == 0 ?
+      CYCLES_RETURN : CYCLES_JUMP;
+
+    return 0;
+  }
+
+  for (n = 0; mips32_cycles[n].name != NULL; n++)
+  {
+    if (strcmp(instr, mips32_cycles[n].name) == 0)
+    {
+      info->cycles = mips32_cycles[n].cycles;
+      info->type = mips32_cycles[n].type;
+
+      if (info->type == CYCLES_BRANCH || info->type == CYCLES_JUMP)
+      {
+        get_target(last, info->target, sizeof(info->target));
+      }
+
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
@@ -0,0 +1,28 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_MIPS32_H
+#define _CYCLES_MIPS32_H
+
+#include "Cycles.h"
+
+class CyclesMIPS32 : public Cycles
+{
+public:
+  CyclesMIPS32();
+  virtual ~CyclesMIPS32();
+
+protected:
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info);
+};
+
+#endif
+
@@ -0,0 +1,334 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "CyclesMSP430.h"
+
+// Source addressing modes.  A constant generator value (#0, #1, #2,
+// #4, #8, #-1) takes the same time as a register.
+enum
+{
+  SRC_REGISTER,
+  SRC_INDIRECT,
+  SRC_AUTOINC,
+  SRC_IMMEDIATE,
+  SRC_INDEXED,
+  SRC_COUNT
+};
+
+// Format I cycles from the MSP430x2xx family user's guide for a
+// destination that's a register, the PC or memory.
+//                                      Rn  @Rn @Rn+ #N  x(Rn)
+static const int double_to_register[] = { 1,  2,  2,  2,  3 };
+static const int double_to_pc[]       = { 2,  2,  3,  3,  3 };
+static const int double_to_memory[]   = { 4,  5,  5,  5,  6 };
+
+static const char *double_ops[] =
+{
+  "mov", "add", "addc", "subc", "sub", "cmp", "dadd", "bit", "bic",
+  "bis", "xor", "and", NULL
+};
+
+// Format II, -1 is a mode the instruction can't use.
+struct msp430_cycles_t
+{
+  const char *name;
+  int cycles[SRC_COUNT];
+};
+
+static msp430_cycles_t single_ops[] =
+{
+  { "rrc",  { 1, 3, 3, -1, 4 } },
+  { "rra",  { 1, 3, 3, -1, 4 } },
+  { "swpb", { 1, 3, 3, -1, 4 } },
+  { "sxt",  { 1, 3, 3, -1, 4 } },
+  { "push", { 3, 4, 4,  4, 5 } },
+  { "call", { 4, 4, 5,  5, 5 } },
+  { NULL,   { 0, 0, 0,  0, 0 } }
+};
+
+// Emulated instructions with a constant generator source, so they
+// cost the same as a register source.
+static const char *emulated_constant[] =
+{
+  "clr", "inc", "incd", "dec", "decd", "tst", "inv", "adc", "sbc",
+  "dadc", NULL
+};
+
+static const char *implied_ops[] =
+{
+  "nop", "clrc", "setc", "clrz", "setz", "clrn", "setn", "dint", "eint",
+  NULL
+};
+
+static bool in_list(const char **list, const char *name)
+{
+  int n;
+
+  for (n = 0; list[n] != NULL; n++)
+  {
+    if (strcmp(list[n], name) == 0) { return true; }
+  }
+
+  return false;
+}
+
+static bool is_register(const char *s, bool *is_pc)
+{
+  char *end;
+
+  *is_pc = false;
+
+  if (strcasecmp(s, "pc") == 0 || strcasecmp(s, "r0") == 0)
+  {
+    *is_pc = true;
+    return true;
+  }
+
+  if (strcasecmp(s, "sp") == 0 || strcasecmp(s, "sr") == 0) { return true; }
+
+  if (s[0] != 'r' && s[0] != 'R') { return false; }
+
+  int reg = strtol(s + 1, &end, 10);
+
+  return s[1] != 0 && *end == 0 && reg >= 0 && reg <= 15;
+}
+
+CyclesMSP430::CyclesMSP430()
+{
+}
+
+CyclesMSP430::~CyclesMSP430()
+{
+}
+
+int CyclesMSP430::get_instruction(const char *instr, const char *operands, cycles_instr_t *info)
+{
+  char name[32];
+  char src[128], dst[128];
+  bool src_pc, dst_pc;
+  int src_mode, dst_mode;
+  int n;
+
+  // .b and .w take the same time.
+  snprintf(name, sizeof(name), "%s", instr);
+  n = strlen(name);
+  if (n > 2 && name[n - 2] == '.') { name[n - 2] = 0; }
+
+  // Split at the comma that isn't inside parenthesis.
+  int depth = 0;
+  const char *comma = NULL;
+
+  for (n = 0; operands[n] != 0; n++)
+  {
+    if (operands[n] == '(') { depth++; }
+    else if (operands[n] == ')') { depth--; }
+    else if (operands[n] == ',' && depth == 0) { comma = operands + n; break; }
+  }
+
+  if (comma == NULL)
+  {
+    snprintf(src, sizeof(src), "%s", operands);
+    dst[0] = 0;
+  }
+    else
+  {
+    snprintf(src, sizeof(src), "%.*s", (int)(comma - operands), operands);
+    comma++;
+    while (*comma == ' ' || *comma == '\t') { comma++; }
+    snprintf(dst, sizeof(dst), "%s", comma);
+  }
+
+  for (n = strlen(src) - 1; n >= 0 && (src[n] == ' ' || src[n] == '\t'); n--)
+  {
+    src[n] = 0;
+  }
+
+  if (name[0] == 'j')
+  {
+    static const char *jumps[] =
+    {
+      "jne", "jnz", "jeq", "jz", "jnc", "jlo", "jc", "jhs", "jn", "jge",
+      "jl", "jmp", NULL
+    };
+
+    if (!in_list(jumps, name)) { return -1; }
+
+    // Taken or not, every jump is 2 cycles.
+    info->cycles = 2;
+    info->type = strcmp(name, "jmp") == 0 ? CYCLES_JUMP : CYCLES_BRANCH;
+    get_target(src, info->target, sizeof(info->target));
+
+    return 0;
+  }
+
+  if (strcmp(name, "ret") == 0)
+  {
+    info->cycles = 3;
+    info->type = CYCLES_RETURN;
+    return 0;
+  }
+
+  if (strcmp(name, "reti") == 0)
+  {
+    info->cycles = 5;
+    info->type = CYCLES_RETURN;
+    return 0;
+  }
+
+  if (in_list(implied_ops, name))
+  {
+    info->cycles = 1;
+    return 0;
+  }
+
+  // The assembler makes neg into inv + inc.
+  if (strcmp(name, "neg") == 0)
+  {
+    if (get_instruction("inv", src, info) != 0) { return -1; }
+
+    info->cycles *= 2;
+
+    return 0;
+  }
+
+  // Emulated instructions are turned back into what they really are.
+  if (strcmp(name, "pop") == 0)
+  {
+    snprintf(dst, sizeof(dst), "%s", src);
+    snprintf(src, sizeof(src), "@SP+");
+    snprintf(name, sizeof(name), "mov");
+  }
+    else
+  if (strcmp(name, "br") == 0)
+  {
+    snprintf(dst, sizeof(dst), "pc");
+    snprintf(name, sizeof(name), "mov");
+  }
+    else
+  if (strcmp(name, "rla") == 0 || strcmp(name, "rlc") == 0)
+  {
+    snprintf(dst, sizeof(dst), "%s", src);
+    snprintf(name, sizeof(name), "add");
+  }
+    else
+  if (in_list(emulated_constant, name))
+  {
+    snprintf(dst, sizeof(dst), "%s", src);
+    snprintf(src, sizeof(src), "#0");
+    snprintf(name, sizeof(name), "mov");
+  }
+
+  src_mode = get_mode(src, &src_pc);
+
+  if (src_mode == -1) { return -1; }
+
+  for (n = 0; single_ops[n].name != NULL; n++)
+  {
+    if (strcmp(single_ops[n].name, name) != 0) { continue; }
+
+    if (dst[0] != 0 || single_ops[n].cycles[src_mode] == -1) { return -1; }
+
+    info->cycles = single_ops[n].cycles[src_mode];
+    return 0;
+  }
+
+  if (!in_list(double_ops, name) || dst[0] == 0) { return -1; }
+
+  dst_mode = get_mode(dst, &dst_pc);
+
+  if (dst_mode == SRC_REGISTER && dst_pc)
+  {
+    info->cycles = double_to_pc[src_mode];
+
+    // Writing the PC is a jump.  Only br #label says where to.
+    if (strcmp(name, "mov") == 0)
+    {
+      info->type = CYCLES_JUMP;
+
+      if (src[0] == '#')
+      {
+        get_target(src, info->target, sizeof(info->target));
+      }
+    }
+
+    return 0;
+  }
+
+  if (dst_mode == SRC_REGISTER)
+  {
+    info->cycles = double_to_register[src_mode];
+    return 0;
+  }
+
+  if (dst_mode != SRC_INDEXED) { return -1; }
+
+  info->cycles = double_to_memory[src_mode];
+
+  return 0;
+}
+
+int CyclesMSP430::get_mode(const char *operand, bool *is_pc)
+{
+  char name[16];
+  int value;
+  int len;
+
+  *is_pc = false;
+
+  if (operand[0] == 0) { return -1; }
+
+  if (operand[0] == '#')
+  {
+    if (get_value(operand + 1, &value) == 0)
+    {
+      switch (value & 0xffff)
+      {
+        case 0: case 1: case 2: case 4: case 8: case 0xffff:
+          return SRC_REGISTER;
+        default:
+          break;
+      }
+    }
+
+    return SRC_IMMEDIATE;
+  }
+
+  if (operand[0] == '@')
+  {
+    len = strlen(operand + 1);
+
+    bool autoinc = len > 0 && operand[len] == '+';
+
+    if (autoinc) { len--; }
+    if (len <= 0 || len >= (int)sizeof(name)) { return -1; }
+
+    memcpy(name, operand + 1, len);
+    name[len] = 0;
+
+    if (!is_register(name, is_pc)) { return -1; }
+
+    *is_pc = false;
+
+    return autoinc ? SRC_AUTOINC : SRC_INDIRECT;
+  }
+
+  if (is_register(operand, is_pc)) { return SRC_REGISTER; }
+
+  // x(Rn), &abs and symbolic all take an extension word.
+  return SRC_INDEXED;
+}
+
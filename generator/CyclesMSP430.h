@@ -0,0 +1,31 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_MSP430_H
+#define _CYCLES_MSP430_H
+
+#include "Cycles.h"
+
+class CyclesMSP430 : public Cycles
+{
+public:
+  CyclesMSP430();
+  virtual ~CyclesMSP430();
+
+protected:
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info);
+
+private:
+  int get_mode(const char *operand, bool *is_pc);
+};
+
+#endif
+
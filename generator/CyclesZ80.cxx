@@ -0,0 +1,451 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "CyclesZ80.h"
+
+// What an operand is as far as timing goes.
+enum
+{
+  OP_NONE,
+  OP_A,
+  OP_REG8,       // b, c, d, e, h, l
+  OP_REG16,      // bc, de, sp
+  OP_HL,
+  OP_INDEX,      // ix, iy
+  OP_AF,
+  OP_IR,         // i, r
+  OP_IND_HL,     // (hl)
+  OP_IND_BCDE,   // (bc), (de)
+  OP_IND_INDEX,  // (ix+d), (iy+d)
+  OP_IND_SP,     // (sp)
+  OP_IND_C,      // (c)
+  OP_MEMORY,     // (nn)
+  OP_NUMBER,     // n, nn or a label
+};
+
+static const char *conditions[] =
+{
+  "nz", "z", "nc", "c", "po", "pe", "p", "m", NULL
+};
+
+static bool is_condition(const char *s)
+{
+  int n;
+
+  for (n = 0; conditions[n] != NULL; n++)
+  {
+    if (strcmp(conditions[n], s) == 0) { return true; }
+  }
+
+  return false;
+}
+
+static int get_operand(const char *s)
+{
+  int len = strlen(s);
+
+  if (len == 0) { return OP_NONE; }
+
+  if (strcmp(s, "a") == 0) { return OP_A; }
+  if (len == 1 && strchr("bcdehl", s[0]) != NULL) { return OP_REG8; }
+  if (strcmp(s, "i") == 0 || strcmp(s, "r") == 0) { return OP_IR; }
+  if (strcmp(s, "hl") == 0) { return OP_HL; }
+  if (strcmp(s, "bc") == 0 || strcmp(s, "de") == 0 || strcmp(s, "sp") == 0)
+  {
+    return OP_REG16;
+  }
+  if (strcmp(s, "ix") == 0 || strcmp(s, "iy") == 0) { return OP_INDEX; }
+  if (strcmp(s, "af") == 0 || strcmp(s, "af'") == 0) { return OP_AF; }
+
+  if (s[0] == '(' && s[len - 1] == ')')
+  {
+    if (strcmp(s, "(hl)") == 0) { return OP_IND_HL; }
+    if (strcmp(s, "(bc)") == 0 || strcmp(s, "(de)") == 0) { return OP_IND_BCDE; }
+    if (strcmp(s, "(sp)") == 0) { return OP_IND_SP; }
+    if (strcmp(s, "(c)") == 0) { return OP_IND_C; }
+    if (strncmp(s, "(ix", 3) == 0 || strncmp(s, "(iy", 3) == 0)
+    {
+      return OP_IND_INDEX;
+    }
+
+    return OP_MEMORY;
+  }
+
+  return OP_NUMBER;
+}
+
+static bool is_reg8(int op)
+{
+  return op == OP_A || op == OP_REG8;
+}
+
+static bool is_reg16(int op)
+{
+  return op == OP_REG16 || op == OP_HL;
+}
+
+CyclesZ80::CyclesZ80()
+{
+}
+
+CyclesZ80::~CyclesZ80()
+{
+}
+
+int CyclesZ80::get_instruction(const char *instr, const char *operands, cycles_instr_t *info)
+{
+  char buffer[256];
+  char *args[3];
+  int op[3];
+  int alu = OP_NONE;
+  int count = 0;
+  int n;
+
+  // Registers are matched in lower case, label names keep their case
+  // in args[] for the jump target.
+  snprintf(buffer, sizeof(buffer), "%s", operands);
+
+  char *s = buffer;
+
+  while (*s != 0 && count < 3)
+  {
+    while (*s == ' ' || *s == '\t') { s++; }
+    args[count++] = s;
+    while (*s != ',' && *s != 0) { s++; }
+
+    char *end = s;
+    if (*s == ',') { *s++ = 0; }
+    while (end > args[count - 1] && (end[-1] == ' ' || end[-1] == '\t')) { *--end = 0; }
+  }
+
+  if (*s != 0) { return -1; }
+
+  char lower[3][128];
+
+  for (n = 0; n < 3; n++)
+  {
+    int i;
+
+    lower[n][0] = 0;
+
+    if (n >= count) { op[n] = OP_NONE; continue; }
+
+    for (i = 0; args[n][i] != 0 && i < (int)sizeof(lower[n]) - 1; i++)
+    {
+      lower[n][i] = tolower(args[n][i]);
+    }
+
+    lower[n][i] = 0;
+    op[n] = get_operand(lower[n]);
+  }
+
+  if (strcmp(instr, "jp") == 0 || strcmp(instr, "jr") == 0 ||
+      strcmp(instr, "djnz") == 0 || strcmp(instr, "ret") == 0 ||
+      strcmp(instr, "reti") == 0 || strcmp(instr, "retn") == 0)
+  {
+    if (count == 2 && !is_condition(lower[0])) { return -1; }
+
+    return get_jump(instr, count, args, info);
+  }
+
+  if (strcmp(instr, "ld") == 0)
+  {
+    if (count != 2) { return -1; }
+
+    info->cycles = get_load(op[0], op[1]);
+
+    return info->cycles == 0 ? -1 : 0;
+  }
+
+  if (strcmp(instr, "push") == 0 || strcmp(instr, "pop") == 0)
+  {
+    if (count != 1) { return -1; }
+
+    int push = strcmp(instr, "push") == 0 ? 1 : 0;
+
+    if (op[0] == OP_INDEX) { info->cycles = 14 + push; }
+    else if (is_reg16(op[0]) || op[0] == OP_AF) { info->cycles = 10 + push; }
+    else { return -1; }
+
+    return 0;
+  }
+
+  // add a,r  adc a,r  sbc a,r  and r  sub r  or r  xor r  cp r
+  if (strcmp(instr, "add") == 0 || strcmp(instr, "adc") == 0 ||
+      strcmp(instr, "sbc") == 0)
+  {
+    if (count != 2) { return -1; }
+
+    if (op[0] == OP_HL && is_reg16(op[1]))
+    {
+      info->cycles = strcmp(instr, "add") == 0 ? 11 : 15;
+      return 0;
+    }
+
+    if (op[0] == OP_INDEX && strcmp(instr, "add") == 0 &&
+       (op[1] == OP_REG16 || strcmp(lower[0], lower[1]) == 0))
+    {
+      info->cycles = 15;
+      return 0;
+    }
+
+    if (op[0] != OP_A) { return -1; }
+
+    alu = op[1];
+  }
+    else
+  if (strcmp(instr, "sub") == 0 || strcmp(instr, "and") == 0 ||
+      strcmp(instr, "or") == 0 || strcmp(instr, "xor") == 0 ||
+      strcmp(instr, "cp") == 0)
+  {
+    // sub a,b is the same as sub b.
+    if (count == 2 && op[0] == OP_A) { alu = op[1]; }
+    else if (count == 1) { alu = op[0]; }
+    else { return -1; }
+  }
+
+  if (alu != OP_NONE)
+  {
+    if (is_reg8(alu)) { info->cycles = 4; }
+    else if (alu == OP_NUMBER) { info->cycles = 7; }
+    else if (alu == OP_IND_HL) { info->cycles = 7; }
+    else if (alu == OP_IND_INDEX) { info->cycles = 19; }
+    else { return -1; }
+
+    return 0;
+  }
+
+  if (strcmp(instr, "inc") == 0 || strcmp(instr, "dec") == 0)
+  {
+    if (count != 1) { return -1; }
+
+    if (is_reg8(op[0])) { info->cycles = 4; }
+    else if (is_reg16(op[0])) { info->cycles = 6; }
+    else if (op[0] == OP_INDEX) { info->cycles = 10; }
+    else if (op[0] == OP_IND_HL) { info->cycles = 11; }
+    else if (op[0] == OP_IND_INDEX) { info->cycles = 23; }
+    else { return -1; }
+
+    return 0;
+  }
+
+  if (strcmp(instr, "rlc") == 0 || strcmp(instr, "rl") == 0 ||
+      strcmp(instr, "rrc") == 0 || strcmp(instr, "rr") == 0 ||
+      strcmp(instr, "sla") == 0 || strcmp(instr, "sra") == 0 ||
+      strcmp(instr, "srl") == 0)
+  {
+    if (count != 1) { return -1; }
+
+    if (is_reg8(op[0])) { info->cycles = 8; }
+    else if (op[0] == OP_IND_HL) { info->cycles = 15; }
+    else if (op[0] == OP_IND_INDEX) { info->cycles = 23; }
+    else { return -1; }
+
+    return 0;
+  }
+
+  if (strcmp(instr, "bit") == 0 || strcmp(instr, "set") == 0 ||
+      strcmp(instr, "res") == 0)
+  {
+    if (count != 2 || op[0] != OP_NUMBER) { return -1; }
+
+    bool is_bit = strcmp(instr, "bit") == 0;
+
+    if (is_reg8(op[1])) { info->cycles = 8; }
+    else if (op[1] == OP_IND_HL) { info->cycles = is_bit ? 12 : 15; }
+    else if (op[1] == OP_IND_INDEX) { info->cycles = is_bit ? 20 : 23; }
+    else { return -1; }
+
+    return 0;
+  }
+
+  if (strcmp(instr, "call") == 0)
+  {
+    // Only the call itself, the subroutine is counted on its own.
+    if (count == 2 && !is_condition(lower[0])) { return -1; }
+
+    info->cycles = 17;
+    return 0;
+  }
+
+  if (strcmp(instr, "ex") == 0)
+  {
+    if (count != 2) { return -1; }
+
+    if (op[0] == OP_IND_SP) { info->cycles = op[1] == OP_INDEX ? 23 : 19; }
+    else { info->cycles = 4; }
+
+    return 0;
+  }
+
+  if (strcmp(instr, "in") == 0 || strcmp(instr, "out") == 0)
+  {
+    if (count != 2) { return -1; }
+
+    info->cycles = op[0] == OP_IND_C || op[1] == OP_IND_C ? 12 : 11;
+    return 0;
+  }
+
+  static const char *implied_4[] =
+  {
+    "nop", "rla", "rra", "rlca", "rrca", "cpl", "ccf", "scf", "daa",
+    "exx", "di", "ei", "halt", NULL
+  };
+
+  for (n = 0; implied_4[n] != NULL; n++)
+  {
+    if (strcmp(implied_4[n], instr) == 0)
+    {
+      info->cycles = 4;
+      return count == 0 ? 0 : -1;
+    }
+  }
+
+  if (strcmp(instr, "neg") == 0 || strcmp(instr, "im") == 0)
+  {
+    info->cycles = 8;
+    return 0;
+  }
+
+  // One pass through a block instruction.
+  if (strcmp(instr, "ldi") == 0 || strcmp(instr, "ldd") == 0 ||
+      strcmp(instr, "cpi") == 0 || strcmp(instr, "cpd") == 0)
+  {
+    info->cycles = 16;
+    return 0;
+  }
+
+  if (strcmp(instr, "ldir") == 0 || strcmp(instr, "lddr") == 0 ||
+      strcmp(instr, "cpir") == 0 || strcmp(instr, "cpdr") == 0)
+  {
+    info->cycles = 21;
+    return 0;
+  }
+
+  if (strcmp(instr, "rst") == 0)
+  {
+    info->cycles = 11;
+    return 0;
+  }
+
+  return -1;
+}
+
+int CyclesZ80::get_load(int dst, int src)
+{
+  if (is_reg8(dst))
+  {
+    if (is_reg8(src)) { return 4; }
+    if (src == OP_NUMBER || src == OP_IND_HL) { return 7; }
+    if (src == OP_IND_INDEX) { return 19; }
+    if (dst == OP_A && src == OP_IND_BCDE) { return 7; }
+    if (dst == OP_A && src == OP_MEMORY) { return 13; }
+    if (dst == OP_A && src == OP_IR) { return 9; }
+    return 0;
+  }
+
+  if (dst == OP_IR && src == OP_A) { return 9; }
+
+  if (dst == OP_IND_HL)
+  {
+    if (is_reg8(src)) { return 7; }
+    if (src == OP_NUMBER) { return 10; }
+    return 0;
+  }
+
+  if (dst == OP_IND_INDEX)
+  {
+    if (is_reg8(src) || src == OP_NUMBER) { return 19; }
+    return 0;
+  }
+
+  if (dst == OP_IND_BCDE) { return src == OP_A ? 7 : 0; }
+
+  if (dst == OP_MEMORY)
+  {
+    if (src == OP_A || src == OP_HL) { return src == OP_A ? 13 : 16; }
+    if (src == OP_REG16 || src == OP_INDEX) { return 20; }
+    return 0;
+  }
+
+  if (is_reg16(dst) || dst == OP_INDEX)
+  {
+    bool index = dst == OP_INDEX;
+
+    // ld sp,hl  ld sp,ix
+    if (src == OP_HL || src == OP_INDEX) { return src == OP_INDEX ? 10 : 6; }
+    if (src == OP_NUMBER) { return index ? 14 : 10; }
+    if (src == OP_MEMORY) { return dst == OP_HL ? 16 : 20; }
+    return 0;
+  }
+
+  return 0;
+}
+
+int CyclesZ80::get_jump(const char *instr, int count, char *args[], cycles_instr_t *info)
+{
+  const char *target = count == 0 ? "" : args[count - 1];
+  bool conditional = count == 2;
+
+  if (strcmp(instr, "ret") == 0)
+  {
+    // ret cc goes somewhere unknown or keeps going.
+    info->cycles = count == 0 ? 10 : 11;
+    info->type = count == 0 ? CYCLES_RETURN : CYCLES_BRANCH;
+    return count > 1 ? -1 : 0;
+  }
+
+  if (strcmp(instr, "reti") == 0 || strcmp(instr, "retn") == 0)
+  {
+    info->cycles = 14;
+    info->type = CYCLES_RETURN;
+    return 0;
+  }
+
+  if (strcmp(instr, "djnz") == 0)
+  {
+    if (count != 1) { return -1; }
+    info->cycles = 13;
+    conditional = true;
+  }
+    else
+  if (strcmp(instr, "jr") == 0)
+  {
+    info->cycles = 12;
+  }
+    else
+  if (target[0] == '(')
+  {
+    // jp (hl)  jp (ix)
+    info->cycles = target[2] == 'x' || target[2] == 'y' ||
+                   target[2] == 'X' || target[2] == 'Y' ? 8 : 4;
+    info->type = CYCLES_JUMP;
+    return count == 1 ? 0 : -1;
+  }
+    else
+  {
+    info->cycles = 10;
+  }
+
+  if (count == 0) { return -1; }
+
+  info->type = conditional ? CYCLES_BRANCH : CYCLES_JUMP;
+  get_target(target, info->target, sizeof(info->target));
+
+  return 0;
+}
+
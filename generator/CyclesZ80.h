@@ -0,0 +1,32 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _CYCLES_Z80_H
+#define _CYCLES_Z80_H
+
+#include "Cycles.h"
+
+class CyclesZ80 : public Cycles
+{
+public:
+  CyclesZ80();
+  virtual ~CyclesZ80();
+
+protected:
+  virtual int get_instruction(const char *instr, const char *operands, cycles_instr_t *info);
+
+private:
+  int get_load(int dst, int src);
+  int get_jump(const char *instr, int count, char *args[], cycles_instr_t *info);
+};
+
+#endif
+
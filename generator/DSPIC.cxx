@@ -1668,6 +1668,43 @@ char dst[16];
   return 0;
 }
 
+int DSPIC::fixed_mul8_II()
+{
+  char dst[16];
+
+  pop_reg(dst);
+  fprintf(out, "  mov %s, w7\n", dst);
+  pop_reg(dst);
+
+  // mul.ss leaves the 32 bit product in w1:w0, keep the middle 16 bits.
+  fprintf(out, "  mul.ss %s, w7, w0\n", dst);
+  fprintf(out, "  lsr w0, #8, w0\n");
+  fprintf(out, "  sl w1, #8, w1\n");
+  fprintf(out, "  ior w0, w1, w0\n");
+  push_w0();
+
+  return 0;
+}
+
+int DSPIC::fixed_div8_II()
+{
+  char dst[16];
+
+  pop_reg(dst);
+  fprintf(out, "  mov %s, w7\n", dst);
+  pop_reg(dst);
+
+  // div.sd divides w1:w0 = a << 8 by w7, the quotient ends up in w0.
+  if (strcmp(dst, "w0") != 0) { fprintf(out, "  mov %s, w0\n", dst); }
+  fprintf(out, "  asr w0, #8, w1\n");
+  fprintf(out, "  sl w0, #8, w0\n");
+  fprintf(out, "  repeat #17\n");
+  fprintf(out, "  div.sd w0, w7\n");
+  push_w0();
+
+  return 0;
+}
+
 int DSPIC::dsp_mul(const char *instr, const char *accum)
 {
 char dst[16];
@@ -1756,21 +1793,19 @@ void DSPIC::pop_reg(char *dst)
   }
 }
 
-#if 0
 void DSPIC::push_w0()
 {
-  if (stack > 0)
+  if (reg < reg_max)
   {
-    fprintf(out, "  push w0\n");
-    stack++;
+    fprintf(out, "  mov w0, w%d\n", REG_STACK(reg));
+    reg++;
   }
     else
   {
-    sprintf(dst, "  mov w0, w%d", REG_STACK(reg));
-    reg++;
+    fprintf(out, "  push w0\n");
+    stack++;
   }
 }
-#endif
 
 int DSPIC::set_periph(const char *instr, const char *periph, bool reverse)
 {
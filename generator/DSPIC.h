@@ -27,6 +27,7 @@ public:
   virtual ~DSPIC();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 3; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -41,6 +42,7 @@ public:
   virtual int push_local_var_ref(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
+  virtual int get_spilled() { return stack; }
   virtual int push_int(int32_t n);
   //virtual int push_long(int64_t n);
   //virtual int push_float(float f);
@@ -186,12 +188,16 @@ public:
   virtual int dsp_shiftA();
   virtual int dsp_shiftB();
 
+  // Fixed point functions
+  virtual int fixed_mul8_II();
+  virtual int fixed_div8_II();
+
 private:
   int dsp_mul(const char *instr, const char *accum);
   int dsp_square(const char *instr, const char *accum);
   int dsp_store(const char *instr, const char *accum, int shift);
   void pop_reg(char *dst);
-  //void push_w0();
+  void push_w0();
   int set_periph(const char *instr, const char *periph, bool reverse=false);
   int stack_alu(const char *instr);
   int stack_alu_div();
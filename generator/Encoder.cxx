@@ -0,0 +1,771 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "Encoder.h"
+
+#define MAX_LINE 1024
+
+// Longest instruction (or pseudo instruction) any encoder emits.
+#define MAX_INSTR_LEN 16
+
+// Raw binary output runs from the lowest to the highest address written.
+#define MAX_BIN_SIZE (16 * 1024 * 1024)
+
+static bool is_symbol_char(char c)
+{
+  return isalnum(c) || c == '_' || c == '.';
+}
+
+static const char *skip_spaces(const char *s)
+{
+  while (*s == ' ' || *s == '\t') { s++; }
+  return s;
+}
+
+Encoder::Encoder() :
+  address(0),
+  pass(0),
+  unresolved(false),
+  line_bytes(NULL),
+  bytes_written(0),
+  line_number(0)
+{
+}
+
+Encoder::~Encoder()
+{
+}
+
+int Encoder::assemble(const char *text, int length)
+{
+  char line[MAX_LINE];
+  const char *end = text + length;
+
+  // An encoder can assemble more than one text.
+  memory.clear();
+  symbols.clear();
+  symbol_pass.clear();
+
+  for (pass = 1; pass <= 2; pass++)
+  {
+    const char *s = text;
+
+    address = 0;
+    line_number = 0;
+    bytes_written = 0;
+
+    while (s < end)
+    {
+      int n = 0;
+
+      if (pass == 2 && line_bytes != NULL)
+      {
+        (*line_bytes)[s - text] = bytes_written;
+      }
+
+      while (s < end && *s != '\n')
+      {
+        if (n == MAX_LINE - 1) { return error("Line too long"); }
+        line[n++] = *s++;
+      }
+
+      line[n] = 0;
+      s++;
+      line_number++;
+
+      if (assemble_line(line) != 0) { return -1; }
+    }
+  }
+
+  return 0;
+}
+
+int Encoder::write_hex(const char *filename)
+{
+  std::map<uint32_t,uint8_t>::iterator iter;
+  uint32_t segment = 0;
+  FILE *out;
+
+  out = fopen(filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Couldn't open file %s for writing.\n", filename);
+    return -1;
+  }
+
+  iter = memory.begin();
+
+  while (iter != memory.end())
+  {
+    uint32_t start = iter->first;
+    uint8_t data[16];
+    int count = 0;
+    int n;
+
+    // Extended linear address record for anything past 64k.
+    if ((start >> 16) != segment)
+    {
+      segment = start >> 16;
+      fprintf(out, ":02000004%04X%02X\n", segment,
+        (uint8_t)(-(2 + 4 + (segment >> 8) + (segment & 0xff))));
+    }
+
+    while (iter != memory.end() && count < 16 &&
+           iter->first == start + count &&
+           (iter->first >> 16) == segment)
+    {
+      data[count++] = iter->second;
+      iter++;
+    }
+
+    int checksum = count + ((start >> 8) & 0xff) + (start & 0xff);
+
+    fprintf(out, ":%02X%04X00", count, start & 0xffff);
+
+    for (n = 0; n < count; n++)
+    {
+      fprintf(out, "%02X", data[n]);
+      checksum += data[n];
+    }
+
+    fprintf(out, "%02X\n", (uint8_t)(-checksum));
+  }
+
+  fprintf(out, ":00000001FF\n");
+  fclose(out);
+
+  return 0;
+}
+
+int Encoder::write_bin(const char *filename)
+{
+  std::map<uint32_t,uint8_t>::iterator iter;
+  uint32_t start = 0;
+  uint32_t size = 0;
+  FILE *out;
+
+  if (memory.size() != 0)
+  {
+    start = memory.begin()->first;
+    size = memory.rbegin()->first - start + 1;
+  }
+
+  if (size > MAX_BIN_SIZE)
+  {
+    printf("Error: Code spans 0x%x to 0x%x, too big for a binary file.\n",
+      start, start + size - 1);
+    return -1;
+  }
+
+  out = fopen(filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Couldn't open file %s for writing.\n", filename);
+    return -1;
+  }
+
+  // Gaps are left as erased flash.
+  uint8_t *buffer = (uint8_t *)malloc(size + 1);
+  memset(buffer, 0xff, size);
+
+  for (iter = memory.begin(); iter != memory.end(); iter++)
+  {
+    buffer[iter->first - start] = iter->second;
+  }
+
+  fwrite(buffer, 1, size, out);
+  fclose(out);
+  free(buffer);
+
+  return 0;
+}
+
+int Encoder::include(const char *filename)
+{
+  char line[MAX_LINE];
+  FILE *in;
+  int ret = 0;
+
+  in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    return error("Couldn't open include file ", filename);
+  }
+
+  int saved_line_number = line_number;
+  line_number = 0;
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    line_number++;
+    line[strcspn(line, "\r\n")] = 0;
+
+    ret = assemble_line(line);
+    if (ret != 0) { break; }
+  }
+
+  fclose(in);
+  line_number = saved_line_number;
+
+  return ret;
+}
+
+int Encoder::eval(const char *expr, int *value)
+{
+  const char *s = expr;
+
+  unresolved = false;
+
+  if (eval_or(&s, value) != 0) { return -1; }
+
+  s = skip_spaces(s);
+
+  if (*s != 0)
+  {
+    return error("Syntax error in expression: ", expr);
+  }
+
+  return 0;
+}
+
+void Encoder::set_symbol(const char *name, int value)
+{
+  symbols[name] = value;
+  symbol_pass[name] = pass;
+}
+
+int Encoder::error(const char *message, const char *text)
+{
+  printf("Error: %s%s at line %d\n", message, text, line_number);
+  return -1;
+}
+
+int Encoder::split_operands(char *operands, char **args, int max)
+{
+  int count = 0;
+  int depth = 0;
+  char quote = 0;
+  char *s = operands;
+
+  operands = (char *)skip_spaces(operands);
+  if (*operands == 0) { return 0; }
+
+  args[count++] = operands;
+
+  for (s = operands; *s != 0; s++)
+  {
+    if (quote != 0)
+    {
+      if (*s == '\\' && s[1] != 0) { s++; }
+      else if (*s == quote) { quote = 0; }
+      continue;
+    }
+
+    if (*s == '"' || *s == '\'') { quote = *s; }
+    else if (*s == '(') { depth++; }
+    else if (*s == ')') { depth--; }
+    else if (*s == ',' && depth == 0)
+    {
+      if (count == max) { return -1; }
+
+      *s = 0;
+      args[count++] = (char *)skip_spaces(s + 1);
+    }
+  }
+
+  // Trailing spaces on each argument.
+  for (int n = 0; n < count; n++)
+  {
+    int len = strlen(args[n]);
+    while (len > 0 && (args[n][len - 1] == ' ' || args[n][len - 1] == '\t'))
+    {
+      args[n][--len] = 0;
+    }
+  }
+
+  return count;
+}
+
+int Encoder::assemble_line(char *line)
+{
+  char token[MAX_LINE];
+  uint8_t b[MAX_INSTR_LEN];
+  char quote = 0;
+  char *s;
+  int value;
+  int n;
+
+  // Comments start with ; outside of a string.
+  for (s = line; *s != 0; s++)
+  {
+    if (quote != 0)
+    {
+      if (*s == '\\' && s[1] != 0) { s++; }
+      else if (*s == quote) { quote = 0; }
+      continue;
+    }
+
+    if (*s == '"' || *s == '\'') { quote = *s; }
+    else if (*s == ';') { *s = 0; break; }
+  }
+
+  n = strlen(line);
+  while (n > 0 && isspace(line[n - 1])) { line[--n] = 0; }
+
+  s = (char *)skip_spaces(line);
+  if (*s == 0) { return 0; }
+
+  // label:
+  for (n = 0; is_symbol_char(s[n]); n++);
+
+  if (n != 0 && s[n] == ':')
+  {
+    memcpy(token, s, n);
+    token[n] = 0;
+
+    if (pass == 2 && symbols[token] != (int)address)
+    {
+      return error("Phase error on label ", token);
+    }
+
+    if (pass == 1 && symbol_pass.find(token) != symbol_pass.end())
+    {
+      return error("Duplicate label ", token);
+    }
+
+    set_symbol(token, address);
+
+    s = (char *)skip_spaces(s + n + 1);
+    if (*s == 0) { return 0; }
+  }
+
+  for (n = 0; s[n] != 0 && s[n] != ' ' && s[n] != '\t'; n++)
+  {
+    token[n] = tolower(s[n]);
+  }
+
+  token[n] = 0;
+  s = (char *)skip_spaces(s + n);
+
+  // name equ value
+  if (strncasecmp(s, "equ", 3) == 0 && (s[3] == ' ' || s[3] == '\t'))
+  {
+    // Symbol names keep their case.
+    char *name = (char *)skip_spaces(line);
+    name[strcspn(name, " \t")] = 0;
+
+    if (eval(s + 3, &value) != 0) { return -1; }
+
+    // A value that depends on something further down is only known in
+    // pass 2, so uses of it are treated as unresolved in both passes.
+    bool late = unresolved ||
+      (pass == 2 && symbol_pass.find(name) != symbol_pass.end() && symbol_pass[name] == 0);
+
+    symbols[name] = value;
+    symbol_pass[name] = late ? 0 : pass;
+
+    return 0;
+  }
+
+  if (strcmp(token, ".org") == 0)
+  {
+    if (eval(s, &value) != 0) { return -1; }
+    if (unresolved) { return error(".org needs a known address"); }
+
+    address = value;
+    return 0;
+  }
+    else
+  if (strcmp(token, ".align") == 0)
+  {
+    // naken_asm alignment is in bits.
+    if (eval(s, &value) != 0) { return -1; }
+
+    int bytes = value / 8;
+
+    if (unresolved || bytes <= 0) { return error("Bad alignment ", s); }
+
+    while ((address % bytes) != 0) { write_byte(address++, 0); }
+
+    return 0;
+  }
+    else
+  if (strcmp(token, ".include") == 0)
+  {
+    if (*s != '"') { return error("Bad include ", s); }
+
+    s++;
+    s[strcspn(s, "\"")] = 0;
+
+    return include(s);
+  }
+    else
+  if (strcmp(token, "db") == 0 || strcmp(token, ".db") == 0 ||
+      strcmp(token, "dc8") == 0 || strcmp(token, "dc.b") == 0)
+  {
+    return data(s, 1);
+  }
+    else
+  if (strcmp(token, "dw") == 0 || strcmp(token, ".dw") == 0 ||
+      strcmp(token, "dc16") == 0 || strcmp(token, "dc.w") == 0)
+  {
+    return data(s, 2);
+  }
+    else
+  if (strcmp(token, "dc32") == 0 || strcmp(token, "dc.l") == 0 ||
+      strcmp(token, "dd") == 0)
+  {
+    return data(s, 4);
+  }
+    else
+  if (token[0] == '.')
+  {
+    if (is_cpu_directive(token + 1)) { return 0; }
+
+    return error("Unknown directive ", token);
+  }
+
+  n = encode(token, s, b);
+
+  if (n < 0) { return -1; }
+
+  for (int i = 0; i < n; i++) { write_byte(address + i, b[i]); }
+
+  address += n;
+
+  return 0;
+}
+
+int Encoder::data(char *operands, int size)
+{
+  char *args[256];
+  int count, value, n, i;
+
+  count = split_operands(operands, args, 256);
+
+  if (count <= 0) { return error("Missing data"); }
+
+  for (n = 0; n < count; n++)
+  {
+    char *s = args[n];
+
+    if (*s == '"')
+    {
+      for (s++; *s != '"' && *s != 0; s++)
+      {
+        value = *s;
+
+        if (*s == '\\' && s[1] != 0)
+        {
+          s++;
+
+          switch (*s)
+          {
+            case 'n': value = '\n'; break;
+            case 'r': value = '\r'; break;
+            case 't': value = '\t'; break;
+            case '0': value = 0; break;
+            default: value = *s; break;
+          }
+        }
+
+        for (i = 0; i < size; i++)
+        {
+          write_byte(address++, (value >> (i * 8)) & 0xff);
+        }
+      }
+
+      continue;
+    }
+
+    // dc32 of a float is stored as its IEEE-754 bits.
+    if (size == 4 && strchr(s, '.') != NULL && strncasecmp(s, "0x", 2) != 0)
+    {
+      char *end;
+      union { float f; uint32_t i; } number;
+
+      number.f = strtof(s, &end);
+
+      if (*skip_spaces(end) != 0) { return error("Bad float ", s); }
+
+      value = number.i;
+    }
+      else
+    if (eval(s, &value) != 0)
+    {
+      return -1;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+      write_byte(address++, (value >> (i * 8)) & 0xff);
+    }
+  }
+
+  return 0;
+}
+
+void Encoder::write_byte(uint32_t address, uint8_t value)
+{
+  if (pass == 2)
+  {
+    memory[address] = value;
+    bytes_written++;
+  }
+}
+
+int Encoder::eval_or(const char **s, int *value)
+{
+  int right;
+
+  if (eval_xor(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+    if (**s != '|') { return 0; }
+
+    (*s)++;
+    if (eval_xor(s, &right) != 0) { return -1; }
+    *value |= right;
+  }
+}
+
+int Encoder::eval_xor(const char **s, int *value)
+{
+  int right;
+
+  if (eval_and(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+    if (**s != '^') { return 0; }
+
+    (*s)++;
+    if (eval_and(s, &right) != 0) { return -1; }
+    *value ^= right;
+  }
+}
+
+int Encoder::eval_and(const char **s, int *value)
+{
+  int right;
+
+  if (eval_shift(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+    if (**s != '&') { return 0; }
+
+    (*s)++;
+    if (eval_shift(s, &right) != 0) { return -1; }
+    *value &= right;
+  }
+}
+
+int Encoder::eval_shift(const char **s, int *value)
+{
+  int right;
+
+  if (eval_add(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+
+    if ((*s)[0] == '<' && (*s)[1] == '<')
+    {
+      *s += 2;
+      if (eval_add(s, &right) != 0) { return -1; }
+      *value = (uint32_t)*value << right;
+    }
+      else
+    if ((*s)[0] == '>' && (*s)[1] == '>')
+    {
+      *s += 2;
+      if (eval_add(s, &right) != 0) { return -1; }
+      *value = *value >> right;
+    }
+      else
+    {
+      return 0;
+    }
+  }
+}
+
+int Encoder::eval_add(const char **s, int *value)
+{
+  int right;
+
+  if (eval_mul(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+
+    char op = **s;
+
+    if (op != '+' && op != '-') { return 0; }
+
+    (*s)++;
+    if (eval_mul(s, &right) != 0) { return -1; }
+
+    if (op == '+') { *value = (uint32_t)*value + right; }
+    else { *value = (uint32_t)*value - right; }
+  }
+}
+
+int Encoder::eval_mul(const char **s, int *value)
+{
+  int right;
+
+  if (eval_unary(s, value) != 0) { return -1; }
+
+  while (true)
+  {
+    *s = skip_spaces(*s);
+
+    char op = **s;
+
+    if (op != '*' && op != '/' && op != '%') { return 0; }
+
+    (*s)++;
+    if (eval_unary(s, &right) != 0) { return -1; }
+
+    if (op == '*')
+    {
+      *value = (uint32_t)*value * right;
+      continue;
+    }
+
+    if (right == 0)
+    {
+      // Only a problem if it's still 0 once everything is known.
+      if (pass == 1) { *value = 0; continue; }
+      return error("Division by 0");
+    }
+
+    if (op == '/') { *value = *value / right; }
+    else { *value = *value % right; }
+  }
+}
+
+int Encoder::eval_unary(const char **s, int *value)
+{
+  char name[MAX_LINE];
+  int n;
+
+  *s = skip_spaces(*s);
+
+  switch (**s)
+  {
+    case '-':
+      (*s)++;
+      if (eval_unary(s, value) != 0) { return -1; }
+      *value = -(uint32_t)*value;
+      return 0;
+    case '+':
+      (*s)++;
+      return eval_unary(s, value);
+    case '~':
+      (*s)++;
+      if (eval_unary(s, value) != 0) { return -1; }
+      *value = ~*value;
+      return 0;
+    case '(':
+      (*s)++;
+      if (eval_or(s, value) != 0) { return -1; }
+      *s = skip_spaces(*s);
+      if (**s != ')') { return error("Missing )"); }
+      (*s)++;
+      return 0;
+    case '\'':
+      if ((*s)[1] == 0 || (*s)[2] != '\'') { return error("Bad character constant"); }
+      *value = (uint8_t)(*s)[1];
+      *s += 3;
+      return 0;
+    default:
+      break;
+  }
+
+  for (n = 0; is_symbol_char((*s)[n]); n++) { name[n] = (*s)[n]; }
+  name[n] = 0;
+
+  if (n == 0) { return error("Syntax error in expression"); }
+
+  *s += n;
+
+  if (isdigit(name[0]))
+  {
+    char *end;
+    uint32_t number;
+
+    if (name[0] == '0' && (name[1] == 'x' || name[1] == 'X'))
+    {
+      number = strtoul(name + 2, &end, 16);
+    }
+      else
+    if (name[0] == '0' && (name[1] == 'b' || name[1] == 'B'))
+    {
+      number = strtoul(name + 2, &end, 2);
+    }
+      else
+    if (name[n - 1] == 'h' || name[n - 1] == 'H')
+    {
+      // 0FFFFh
+      name[n - 1] = 0;
+      number = strtoul(name, &end, 16);
+    }
+      else
+    {
+      number = strtoul(name, &end, 10);
+    }
+
+    if (*end != 0) { return error("Bad number ", name); }
+
+    *value = number;
+    return 0;
+  }
+
+  std::map<std::string,int>::iterator iter = symbols.find(name);
+
+  if (iter == symbols.end())
+  {
+    // Labels further down get defined at the end of pass 1.
+    if (pass == 1)
+    {
+      unresolved = true;
+      *value = 0;
+      return 0;
+    }
+
+    return error("Undefined symbol ", name);
+  }
+
+  if (symbol_pass[name] != pass) { unresolved = true; }
+
+  *value = iter->second;
+
+  return 0;
+}
+
@@ -0,0 +1,80 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _ENCODER_H
+#define _ENCODER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+// Turns the assembly a Generator wrote into machine code without running
+// an external assembler.  This is a 2 pass assembler for the subset of
+// naken_asm syntax the generators emit: labels, equ, .org, .align,
+// .include, db / dw / dc32 and the instructions of one CPU, which a
+// subclass encodes.
+
+class Encoder
+{
+public:
+  Encoder();
+  virtual ~Encoder();
+
+  int assemble(const char *text, int length);
+  int write_hex(const char *filename);
+  int write_bin(const char *filename);
+  // If set, assemble() records how many bytes were written before each
+  // line, keyed by where the line starts in the text.
+  void set_line_bytes(std::map<int,int> *line_bytes) { this->line_bytes = line_bytes; }
+
+protected:
+  // Returns the number of bytes written to b or -1 on error.  In pass 1
+  // the operands may use symbols that aren't defined yet, but the length
+  // returned has to be the same in both passes.
+  virtual int encode(const char *instr, char *operands, uint8_t *b) = 0;
+  virtual bool is_cpu_directive(const char *name) = 0;
+  virtual int include(const char *filename);
+
+  int eval(const char *expr, int *value);
+  void set_symbol(const char *name, int value);
+  int error(const char *message, const char *text = "");
+  static int split_operands(char *operands, char **args, int max);
+
+  uint32_t address;
+  int pass;
+  // Set by eval() when an expression used a symbol defined further down
+  // the file.  Encoders must pick the same (long) form in both passes.
+  bool unresolved;
+
+private:
+  int assemble_line(char *line);
+  int data(char *operands, int size);
+  void write_byte(uint32_t address, uint8_t value);
+  int eval_or(const char **s, int *value);
+  int eval_xor(const char **s, int *value);
+  int eval_and(const char **s, int *value);
+  int eval_shift(const char **s, int *value);
+  int eval_add(const char **s, int *value);
+  int eval_mul(const char **s, int *value);
+  int eval_unary(const char **s, int *value);
+
+  std::map<std::string,int> symbols;
+  std::map<std::string,int> symbol_pass;
+  std::map<uint32_t,uint8_t> memory;
+  std::map<int,int> *line_bytes;
+  int bytes_written;
+  int line_number;
+};
+
+#endif
+
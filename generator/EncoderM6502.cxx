@@ -0,0 +1,291 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "EncoderM6502.h"
+
+enum
+{
+  MODE_IMMEDIATE,
+  MODE_ZP,
+  MODE_ZP_X,
+  MODE_ZP_Y,
+  MODE_ABSOLUTE,
+  MODE_ABSOLUTE_X,
+  MODE_ABSOLUTE_Y,
+  MODE_INDIRECT,
+  MODE_INDIRECT_X,
+  MODE_INDIRECT_Y,
+  MODE_IMPLIED,
+  MODE_RELATIVE,
+  MODE_COUNT
+};
+
+#define NA -1
+
+struct m6502_instr_t
+{
+  const char *name;
+  int16_t opcode[MODE_COUNT];
+};
+
+// imm, zp, zp_x, zp_y, abs, abs_x, abs_y, ind, ind_x, ind_y, implied, rel
+static m6502_instr_t m6502_instr[] =
+{
+  { "adc", { 0x69, 0x65, 0x75, NA, 0x6d, 0x7d, 0x79, NA, 0x61, 0x71, NA, NA } },
+  { "and", { 0x29, 0x25, 0x35, NA, 0x2d, 0x3d, 0x39, NA, 0x21, 0x31, NA, NA } },
+  { "asl", { NA, 0x06, 0x16, NA, 0x0e, 0x1e, NA, NA, NA, NA, 0x0a, NA } },
+  { "bcc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x90 } },
+  { "bcs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xb0 } },
+  { "beq", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xf0 } },
+  { "bit", { NA, 0x24, NA, NA, 0x2c, NA, NA, NA, NA, NA, NA, NA } },
+  { "bmi", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x30 } },
+  { "bne", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xd0 } },
+  { "bpl", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x10 } },
+  { "brk", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x00, NA } },
+  { "bvc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x50 } },
+  { "bvs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x70 } },
+  { "clc", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x18, NA } },
+  { "cld", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xd8, NA } },
+  { "cli", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x58, NA } },
+  { "clv", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xb8, NA } },
+  { "cmp", { 0xc9, 0xc5, 0xd5, NA, 0xcd, 0xdd, 0xd9, NA, 0xc1, 0xd1, NA, NA } },
+  { "cpx", { 0xe0, 0xe4, NA, NA, 0xec, NA, NA, NA, NA, NA, NA, NA } },
+  { "cpy", { 0xc0, 0xc4, NA, NA, 0xcc, NA, NA, NA, NA, NA, NA, NA } },
+  { "dec", { NA, 0xc6, 0xd6, NA, 0xce, 0xde, NA, NA, NA, NA, NA, NA } },
+  { "dex", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xca, NA } },
+  { "dey", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x88, NA } },
+  { "eor", { 0x49, 0x45, 0x55, NA, 0x4d, 0x5d, 0x59, NA, 0x41, 0x51, NA, NA } },
+  { "inc", { NA, 0xe6, 0xf6, NA, 0xee, 0xfe, NA, NA, NA, NA, NA, NA } },
+  { "inx", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xe8, NA } },
+  { "iny", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xc8, NA } },
+  { "jmp", { NA, NA, NA, NA, 0x4c, NA, NA, 0x6c, NA, NA, NA, NA } },
+  { "jsr", { NA, NA, NA, NA, 0x20, NA, NA, NA, NA, NA, NA, NA } },
+  { "lda", { 0xa9, 0xa5, 0xb5, NA, 0xad, 0xbd, 0xb9, NA, 0xa1, 0xb1, NA, NA } },
+  { "ldx", { 0xa2, 0xa6, NA, 0xb6, 0xae, NA, 0xbe, NA, NA, NA, NA, NA } },
+  { "ldy", { 0xa0, 0xa4, 0xb4, NA, 0xac, 0xbc, NA, NA, NA, NA, NA, NA } },
+  { "lsr", { NA, 0x46, 0x56, NA, 0x4e, 0x5e, NA, NA, NA, NA, 0x4a, NA } },
+  { "nop", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xea, NA } },
+  { "ora", { 0x09, 0x05, 0x15, NA, 0x0d, 0x1d, 0x19, NA, 0x01, 0x11, NA, NA } },
+  { "pha", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x48, NA } },
+  { "php", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x08, NA } },
+  { "pla", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x68, NA } },
+  { "plp", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x28, NA } },
+  { "rol", { NA, 0x26, 0x36, NA, 0x2e, 0x3e, NA, NA, NA, NA, 0x2a, NA } },
+  { "ror", { NA, 0x66, 0x76, NA, 0x6e, 0x7e, NA, NA, NA, NA, 0x6a, NA } },
+  { "rti", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x40, NA } },
+  { "rts", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x60, NA } },
+  { "sbc", { 0xe9, 0xe5, 0xf5, NA, 0xed, 0xfd, 0xf9, NA, 0xe1, 0xf1, NA, NA } },
+  { "sec", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x38, NA } },
+  { "sed", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xf8, NA } },
+  { "sei", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x78, NA } },
+  { "sta", { NA, 0x85, 0x95, NA, 0x8d, 0x9d, 0x99, NA, 0x81, 0x91, NA, NA } },
+  { "stx", { NA, 0x86, NA, 0x96, 0x8e, NA, NA, NA, NA, NA, NA, NA } },
+  { "sty", { NA, 0x84, 0x94, NA, 0x8c, NA, NA, NA, NA, NA, NA, NA } },
+  { "tax", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xaa, NA } },
+  { "tay", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xa8, NA } },
+  { "tsx", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0xba, NA } },
+  { "txa", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x8a, NA } },
+  { "txs", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x9a, NA } },
+  { "tya", { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 0x98, NA } },
+  { NULL, { NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA } }
+};
+
+// Cuts ",x" / ",y" off the end of an operand and returns which it was.
+static char get_index(char *s)
+{
+  int len = strlen(s);
+
+  if (len < 2 || s[len - 2] != ',') { return 0; }
+
+  char index = s[len - 1] | 0x20;
+
+  if (index != 'x' && index != 'y') { return 0; }
+
+  s[len - 2] = 0;
+
+  for (len -= 3; len >= 0 && (s[len] == ' ' || s[len] == '\t'); len--)
+  {
+    s[len] = 0;
+  }
+
+  return index;
+}
+
+EncoderM6502::EncoderM6502()
+{
+}
+
+EncoderM6502::~EncoderM6502()
+{
+}
+
+int EncoderM6502::encode(const char *instr, char *operands, uint8_t *b)
+{
+  m6502_instr_t *table = NULL;
+  char *s = operands;
+  int value, mode, n;
+
+  for (n = 0; m6502_instr[n].name != NULL; n++)
+  {
+    if (strcmp(instr, m6502_instr[n].name) == 0)
+    {
+      table = &m6502_instr[n];
+      break;
+    }
+  }
+
+  if (table == NULL) { return error("Unknown instruction ", instr); }
+
+  if (s[0] == 0 || strcasecmp(s, "a") == 0)
+  {
+    if (table->opcode[MODE_IMPLIED] == NA)
+    {
+      return error("Missing operand for ", instr);
+    }
+
+    b[0] = table->opcode[MODE_IMPLIED];
+    return 1;
+  }
+
+  if (table->opcode[MODE_RELATIVE] != NA)
+  {
+    // bne #-5 is an offset, bne label is an address.
+    if (s[0] == '#')
+    {
+      if (eval(s + 1, &value) != 0) { return -1; }
+    }
+      else
+    {
+      if (eval(s, &value) != 0) { return -1; }
+      value -= address + 2;
+    }
+
+    if (pass == 2 && (value < -128 || value > 127))
+    {
+      return error("Branch out of range ", s);
+    }
+
+    b[0] = table->opcode[MODE_RELATIVE];
+    b[1] = value & 0xff;
+    return 2;
+  }
+
+  if (s[0] == '#')
+  {
+    if (table->opcode[MODE_IMMEDIATE] == NA)
+    {
+      return error("Immediate not allowed for ", instr);
+    }
+
+    if (eval(s + 1, &value) != 0) { return -1; }
+
+    if (pass == 2 && (value < -128 || value > 255))
+    {
+      return error("Immediate out of range ", s);
+    }
+
+    b[0] = table->opcode[MODE_IMMEDIATE];
+    b[1] = value & 0xff;
+    return 2;
+  }
+
+  int len = strlen(s);
+
+  if (s[0] == '(')
+  {
+    // (zp),y  (zp,x)  (abs)
+    if (len > 4 && strcasecmp(s + len - 3, "),y") == 0)
+    {
+      mode = MODE_INDIRECT_Y;
+      s[len - 3] = 0;
+    }
+      else
+    if (len > 4 && strcasecmp(s + len - 3, ",x)") == 0)
+    {
+      mode = MODE_INDIRECT_X;
+      s[len - 3] = 0;
+    }
+      else
+    if (table->opcode[MODE_INDIRECT] != NA && s[len - 1] == ')')
+    {
+      mode = MODE_INDIRECT;
+      s[len - 1] = 0;
+    }
+      else
+    {
+      mode = MODE_COUNT;
+    }
+
+    if (mode != MODE_COUNT)
+    {
+      if (table->opcode[mode] == NA) { return error("Bad addressing mode for ", instr); }
+      if (eval(s + 1, &value) != 0) { return -1; }
+
+      b[0] = table->opcode[mode];
+      b[1] = value & 0xff;
+
+      if (mode == MODE_INDIRECT)
+      {
+        b[2] = (value >> 8) & 0xff;
+        return 3;
+      }
+
+      if (pass == 2 && (value < 0 || value > 255))
+      {
+        return error("Address isn't in zero page ", s);
+      }
+
+      return 2;
+    }
+  }
+
+  char index = get_index(s);
+
+  if (eval(s, &value) != 0) { return -1; }
+
+  int zp = MODE_ZP;
+  int absolute = MODE_ABSOLUTE;
+
+  if (index == 'x') { zp = MODE_ZP_X; absolute = MODE_ABSOLUTE_X; }
+  else if (index == 'y') { zp = MODE_ZP_Y; absolute = MODE_ABSOLUTE_Y; }
+
+  // Zero page only when the address is already known, otherwise the
+  // length could change between passes.
+  if (table->opcode[zp] != NA && !unresolved && value >= 0 && value <= 255)
+  {
+    b[0] = table->opcode[zp];
+    b[1] = value;
+    return 2;
+  }
+
+  if (table->opcode[absolute] == NA)
+  {
+    return error("Bad addressing mode for ", instr);
+  }
+
+  b[0] = table->opcode[absolute];
+  b[1] = value & 0xff;
+  b[2] = (value >> 8) & 0xff;
+
+  return 3;
+}
+
+bool EncoderM6502::is_cpu_directive(const char *name)
+{
+  return strcmp(name, "6502") == 0;
+}
+
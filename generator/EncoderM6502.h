@@ -0,0 +1,29 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _ENCODER_M6502_H
+#define _ENCODER_M6502_H
+
+#include "Encoder.h"
+
+class EncoderM6502 : public Encoder
+{
+public:
+  EncoderM6502();
+  virtual ~EncoderM6502();
+
+protected:
+  virtual int encode(const char *instr, char *operands, uint8_t *b);
+  virtual bool is_cpu_directive(const char *name);
+};
+
+#endif
+
@@ -0,0 +1,451 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "EncoderMIPS32.h"
+
+enum
+{
+  TYPE_RD_RS_RT,    // addu rd, rs, rt
+  TYPE_RD_RT_RS,    // sllv rd, rt, rs
+  TYPE_RD_RT_SA,    // sll rd, rt, sa
+  TYPE_RS_RT,       // div rs, rt
+  TYPE_RD,          // mflo rd
+  TYPE_RS,          // jr rs
+  TYPE_RD_RT,       // seb rd, rt
+  TYPE_RT_RS_IMM,   // addiu rt, rs, imm
+  TYPE_RT_UIMM,     // lui rt, imm
+  TYPE_BRANCH_2,    // beq rs, rt, label
+  TYPE_BRANCH_1,    // bltz rs, label
+  TYPE_JUMP,        // jal label
+  TYPE_LOAD_STORE,  // lw rt, offset(base)
+  TYPE_NONE,        // break
+};
+
+struct mips32_instr_t
+{
+  const char *name;
+  uint32_t opcode;
+  int type;
+};
+
+static mips32_instr_t mips32_instr[] =
+{
+  { "add", 0x00000020, TYPE_RD_RS_RT },
+  { "addu", 0x00000021, TYPE_RD_RS_RT },
+  { "sub", 0x00000022, TYPE_RD_RS_RT },
+  { "subu", 0x00000023, TYPE_RD_RS_RT },
+  { "and", 0x00000024, TYPE_RD_RS_RT },
+  { "or", 0x00000025, TYPE_RD_RS_RT },
+  { "xor", 0x00000026, TYPE_RD_RS_RT },
+  { "nor", 0x00000027, TYPE_RD_RS_RT },
+  { "slt", 0x0000002a, TYPE_RD_RS_RT },
+  { "sltu", 0x0000002b, TYPE_RD_RS_RT },
+  { "mul", 0x70000002, TYPE_RD_RS_RT },
+  { "sllv", 0x00000004, TYPE_RD_RT_RS },
+  { "srlv", 0x00000006, TYPE_RD_RT_RS },
+  { "srav", 0x00000007, TYPE_RD_RT_RS },
+  { "sll", 0x00000000, TYPE_RD_RT_SA },
+  { "srl", 0x00000002, TYPE_RD_RT_SA },
+  { "sra", 0x00000003, TYPE_RD_RT_SA },
+  { "mult", 0x00000018, TYPE_RS_RT },
+  { "multu", 0x00000019, TYPE_RS_RT },
+  { "div", 0x0000001a, TYPE_RS_RT },
+  { "divu", 0x0000001b, TYPE_RS_RT },
+  { "mfhi", 0x00000010, TYPE_RD },
+  { "mflo", 0x00000012, TYPE_RD },
+  { "jr", 0x00000008, TYPE_RS },
+  { "jalr", 0x0000f809, TYPE_RS },
+  { "seb", 0x7c000420, TYPE_RD_RT },
+  { "seh", 0x7c000620, TYPE_RD_RT },
+  { "addi", 0x20000000, TYPE_RT_RS_IMM },
+  { "addiu", 0x24000000, TYPE_RT_RS_IMM },
+  { "slti", 0x28000000, TYPE_RT_RS_IMM },
+  { "sltiu", 0x2c000000, TYPE_RT_RS_IMM },
+  { "andi", 0x30000000, TYPE_RT_RS_IMM },
+  { "ori", 0x34000000, TYPE_RT_RS_IMM },
+  { "xori", 0x38000000, TYPE_RT_RS_IMM },
+  { "lui", 0x3c000000, TYPE_RT_UIMM },
+  { "beq", 0x10000000, TYPE_BRANCH_2 },
+  { "bne", 0x14000000, TYPE_BRANCH_2 },
+  { "blez", 0x18000000, TYPE_BRANCH_1 },
+  { "bgtz", 0x1c000000, TYPE_BRANCH_1 },
+  { "bltz", 0x04000000, TYPE_BRANCH_1 },
+  { "bgez", 0x04010000, TYPE_BRANCH_1 },
+  { "beqz", 0x10000000, TYPE_BRANCH_1 },
+  { "bnez", 0x14000000, TYPE_BRANCH_1 },
+  { "j", 0x08000000, TYPE_JUMP },
+  { "jal", 0x0c000000, TYPE_JUMP },
+  { "lb", 0x80000000, TYPE_LOAD_STORE },
+  { "lh", 0x84000000, TYPE_LOAD_STORE },
+  { "lw", 0x8c000000, TYPE_LOAD_STORE },
+  { "lbu", 0x90000000, TYPE_LOAD_STORE },
+  { "lhu", 0x94000000, TYPE_LOAD_STORE },
+  { "sb", 0xa0000000, TYPE_LOAD_STORE },
+  { "sh", 0xa4000000, TYPE_LOAD_STORE },
+  { "sw", 0xac000000, TYPE_LOAD_STORE },
+  { "nop", 0x00000000, TYPE_NONE },
+  { "syscall", 0x0000000c, TYPE_NONE },
+  { "break", 0x0000000d, TYPE_NONE },
+  { NULL, 0, 0 }
+};
+
+static const char *reg_names[] =
+{
+  "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+  "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+  "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+  "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+static int get_register(const char *s)
+{
+  int n;
+
+  if (s[0] != '$') { return -1; }
+
+  s++;
+
+  if (s[0] >= '0' && s[0] <= '9')
+  {
+    char *end;
+    n = strtol(s, &end, 10);
+    if (*end != 0 || n > 31) { return -1; }
+    return n;
+  }
+
+  for (n = 0; n < 32; n++)
+  {
+    if (strcasecmp(s, reg_names[n]) == 0) { return n; }
+  }
+
+  if (strcasecmp(s, "s8") == 0) { return 30; }
+
+  return -1;
+}
+
+static void put_int32(uint8_t *b, uint32_t value)
+{
+  b[0] = value & 0xff;
+  b[1] = (value >> 8) & 0xff;
+  b[2] = (value >> 16) & 0xff;
+  b[3] = (value >> 24) & 0xff;
+}
+
+EncoderMIPS32::EncoderMIPS32()
+{
+}
+
+EncoderMIPS32::~EncoderMIPS32()
+{
+}
+
+int EncoderMIPS32::encode(const char *instr, char *operands, uint8_t *b)
+{
+  mips32_instr_t *table = NULL;
+  char *args[3];
+  int regs[3];
+  int count, value, offset, n;
+
+  count = split_operands(operands, args, 3);
+
+  if (count < 0) { return error("Too many operands"); }
+
+  // Pseudo instructions first.
+  if (strcmp(instr, "li") == 0 || strcmp(instr, "la") == 0)
+  {
+    return encode_li(args, count, b);
+  }
+    else
+  if (strcmp(instr, "move") == 0)
+  {
+    // addu rd, rs, $0
+    if (count != 2 || get_registers(args, 2, regs) != 0) { return error("Bad operands"); }
+    put_int32(b, 0x00000021 | (regs[1] << 21) | (regs[0] << 11));
+    return 4;
+  }
+    else
+  if (strcmp(instr, "negu") == 0 || strcmp(instr, "neg") == 0)
+  {
+    // subu rd, $0, rt
+    if (count != 2 || get_registers(args, 2, regs) != 0) { return error("Bad operands"); }
+    put_int32(b, (instr[3] == 'u' ? 0x00000023 : 0x00000022) | (regs[1] << 16) | (regs[0] << 11));
+    return 4;
+  }
+    else
+  if (strcmp(instr, "not") == 0)
+  {
+    // nor rd, rs, $0
+    if (count != 2 || get_registers(args, 2, regs) != 0) { return error("Bad operands"); }
+    put_int32(b, 0x00000027 | (regs[1] << 21) | (regs[0] << 11));
+    return 4;
+  }
+    else
+  if (strcmp(instr, "b") == 0)
+  {
+    // beq $0, $0, label
+    if (count != 1 || get_branch_offset(args[0], &offset) != 0) { return -1; }
+    put_int32(b, 0x10000000 | (offset & 0xffff));
+    return 4;
+  }
+
+  for (n = 0; mips32_instr[n].name != NULL; n++)
+  {
+    if (strcmp(instr, mips32_instr[n].name) == 0)
+    {
+      table = &mips32_instr[n];
+      break;
+    }
+  }
+
+  if (table == NULL) { return error("Unknown instruction ", instr); }
+
+  uint32_t opcode = table->opcode;
+
+  switch (table->type)
+  {
+    case TYPE_RD_RS_RT:
+      if (count != 3 || get_registers(args, 3, regs) != 0) { break; }
+      opcode |= (regs[1] << 21) | (regs[2] << 16) | (regs[0] << 11);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RD_RT_RS:
+      if (count != 3 || get_registers(args, 3, regs) != 0) { break; }
+      opcode |= (regs[2] << 21) | (regs[1] << 16) | (regs[0] << 11);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RD_RT_SA:
+      if (count != 3 || get_registers(args, 2, regs) != 0) { break; }
+      if (eval(args[2], &value) != 0) { return -1; }
+      if (pass == 2 && (value < 0 || value > 31)) { return error("Bad shift ", args[2]); }
+      opcode |= (regs[1] << 16) | (regs[0] << 11) | ((value & 31) << 6);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RS_RT:
+      if (count != 2 || get_registers(args, 2, regs) != 0) { break; }
+      opcode |= (regs[0] << 21) | (regs[1] << 16);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RD:
+      if (count != 1 || get_registers(args, 1, regs) != 0) { break; }
+      opcode |= regs[0] << 11;
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RS:
+      if (count != 1 || get_registers(args, 1, regs) != 0) { break; }
+      opcode |= regs[0] << 21;
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RD_RT:
+      if (count != 2 || get_registers(args, 2, regs) != 0) { break; }
+      opcode |= (regs[1] << 16) | (regs[0] << 11);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RT_RS_IMM:
+      if (count != 3 || get_registers(args, 2, regs) != 0) { break; }
+      if (eval(args[2], &value) != 0) { return -1; }
+
+      if (pass == 2)
+      {
+        // andi, ori, xori zero extend.
+        bool is_logical = opcode >= 0x30000000;
+
+        if (( is_logical && (value < 0 || value > 0xffff)) ||
+            (!is_logical && (value < -32768 || value > 32767)))
+        {
+          return error("Immediate out of range ", args[2]);
+        }
+      }
+
+      opcode |= (regs[1] << 21) | (regs[0] << 16) | (value & 0xffff);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_RT_UIMM:
+      if (count != 2 || get_registers(args, 1, regs) != 0) { break; }
+      if (eval(args[1], &value) != 0) { return -1; }
+      opcode |= (regs[0] << 16) | (value & 0xffff);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_BRANCH_2:
+      // bne rs, label is bnez.
+      if (count == 2)
+      {
+        if (get_registers(args, 1, regs) != 0) { break; }
+        regs[1] = 0;
+      }
+        else
+      if (count != 3 || get_registers(args, 2, regs) != 0)
+      {
+        break;
+      }
+
+      if (get_branch_offset(args[count - 1], &offset) != 0) { return -1; }
+      opcode |= (regs[0] << 21) | (regs[1] << 16) | (offset & 0xffff);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_BRANCH_1:
+      if (count != 2 || get_registers(args, 1, regs) != 0) { break; }
+      if (get_branch_offset(args[1], &offset) != 0) { return -1; }
+      opcode |= (regs[0] << 21) | (offset & 0xffff);
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_JUMP:
+      if (count != 1) { break; }
+      if (eval(args[0], &value) != 0) { return -1; }
+
+      // Only the low 28 bits, the rest come from the PC.
+      if (pass == 2 && (value & 3) != 0) { return error("Jump to unaligned address ", args[0]); }
+
+      opcode |= (value >> 2) & 0x03ffffff;
+      put_int32(b, opcode);
+      return 4;
+    case TYPE_LOAD_STORE:
+      return encode_load_store(opcode, args, count, b);
+    case TYPE_NONE:
+      if (count != 0) { break; }
+      put_int32(b, opcode);
+      return 4;
+    default:
+      break;
+  }
+
+  return error("Bad operands for ", instr);
+}
+
+bool EncoderMIPS32::is_cpu_directive(const char *name)
+{
+  return strcmp(name, "mips32") == 0 || strcmp(name, "mips") == 0;
+}
+
+int EncoderMIPS32::get_registers(char **args, int count, int *regs)
+{
+  int n;
+
+  for (n = 0; n < count; n++)
+  {
+    regs[n] = get_register(args[n]);
+
+    if (regs[n] == -1) { return error("Bad register ", args[n]); }
+  }
+
+  return 0;
+}
+
+int EncoderMIPS32::get_branch_offset(const char *s, int *offset)
+{
+  int value;
+
+  if (eval(s, &value) != 0) { return -1; }
+
+  // Relative to the delay slot, in instructions.
+  *offset = (value - (int)(address + 4)) >> 2;
+
+  if (pass == 2)
+  {
+    if ((value & 3) != 0) { return error("Branch to unaligned address ", s); }
+
+    if (*offset < -32768 || *offset > 32767)
+    {
+      return error("Branch out of range ", s);
+    }
+  }
+
+  return 0;
+}
+
+int EncoderMIPS32::encode_load_store(int opcode, char **args, int count, uint8_t *b)
+{
+  int rt, base, value;
+
+  if (count != 2) { return error("Bad operands"); }
+
+  rt = get_register(args[0]);
+
+  if (rt == -1) { return error("Bad register ", args[0]); }
+
+  // offset($base) where offset can be left off.
+  char *s = args[1];
+  int len = strlen(s);
+  char *paren = strrchr(s, '(');
+
+  if (len == 0 || s[len - 1] != ')' || paren == NULL)
+  {
+    return error("Expected offset(base) ", s);
+  }
+
+  s[len - 1] = 0;
+  base = get_register(paren + 1);
+
+  if (base == -1) { return error("Bad register ", paren + 1); }
+
+  *paren = 0;
+
+  if (s[0] == 0) { value = 0; }
+  else if (eval(s, &value) != 0) { return -1; }
+
+  if (pass == 2 && (value < -32768 || value > 32767))
+  {
+    return error("Offset out of range ", s);
+  }
+
+  put_int32(b, opcode | (base << 21) | (rt << 16) | (value & 0xffff));
+
+  return 4;
+}
+
+int EncoderMIPS32::encode_li(char **args, int count, uint8_t *b)
+{
+  int rt, value;
+
+  if (count != 2) { return error("Bad operands"); }
+
+  rt = get_register(args[0]);
+
+  if (rt == -1) { return error("Bad register ", args[0]); }
+  if (eval(args[1], &value) != 0) { return -1; }
+
+  // A value that isn't known in pass 1 always takes the 2 instruction
+  // lui / ori so the length doesn't change.
+  if (!unresolved)
+  {
+    if (value >= -32768 && value <= 32767)
+    {
+      // addiu rt, $0, value
+      put_int32(b, 0x24000000 | (rt << 16) | (value & 0xffff));
+      return 4;
+    }
+
+    if (value >= 0 && value <= 0xffff)
+    {
+      // ori rt, $0, value
+      put_int32(b, 0x34000000 | (rt << 16) | value);
+      return 4;
+    }
+
+    if ((value & 0xffff) == 0)
+    {
+      // lui rt, value >> 16
+      put_int32(b, 0x3c000000 | (rt << 16) | ((value >> 16) & 0xffff));
+      return 4;
+    }
+  }
+
+  put_int32(b + 0, 0x3c000000 | (rt << 16) | ((value >> 16) & 0xffff));
+  put_int32(b + 4, 0x34000000 | (rt << 21) | (rt << 16) | (value & 0xffff));
+
+  return 8;
+}
+
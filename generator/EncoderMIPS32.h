@@ -0,0 +1,35 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _ENCODER_MIPS32_H
+#define _ENCODER_MIPS32_H
+
+#include "Encoder.h"
+
+class EncoderMIPS32 : public Encoder
+{
+public:
+  EncoderMIPS32();
+  virtual ~EncoderMIPS32();
+
+protected:
+  virtual int encode(const char *instr, char *operands, uint8_t *b);
+  virtual bool is_cpu_directive(const char *name);
+
+private:
+  int get_registers(char **args, int count, int *regs);
+  int get_branch_offset(const char *s, int *offset);
+  int encode_load_store(int opcode, char **args, int count, uint8_t *b);
+  int encode_li(char **args, int count, uint8_t *b);
+};
+
+#endif
+
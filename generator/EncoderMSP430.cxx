@@ -0,0 +1,682 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "EncoderMSP430.h"
+
+#define MODE_REGISTER 0
+#define MODE_INDEXED 1
+#define MODE_INDIRECT 2
+#define MODE_AUTOINC 3
+
+#define REG_PC 0
+#define REG_SP 1
+#define REG_SR 2
+#define REG_CG 3
+
+struct msp430_instr_t
+{
+  const char *name;
+  int opcode;
+};
+
+static msp430_instr_t double_ops[] =
+{
+  { "mov", 0x4000 },
+  { "add", 0x5000 },
+  { "addc", 0x6000 },
+  { "subc", 0x7000 },
+  { "sub", 0x8000 },
+  { "cmp", 0x9000 },
+  { "dadd", 0xa000 },
+  { "bit", 0xb000 },
+  { "bic", 0xc000 },
+  { "bis", 0xd000 },
+  { "xor", 0xe000 },
+  { "and", 0xf000 },
+  { NULL, 0 }
+};
+
+static msp430_instr_t single_ops[] =
+{
+  { "rrc", 0x1000 },
+  { "swpb", 0x1080 },
+  { "rra", 0x1100 },
+  { "sxt", 0x1180 },
+  { "push", 0x1200 },
+  { "call", 0x1280 },
+  { NULL, 0 }
+};
+
+static msp430_instr_t jumps[] =
+{
+  { "jne", 0x2000 },
+  { "jnz", 0x2000 },
+  { "jeq", 0x2400 },
+  { "jz", 0x2400 },
+  { "jnc", 0x2800 },
+  { "jlo", 0x2800 },
+  { "jc", 0x2c00 },
+  { "jhs", 0x2c00 },
+  { "jn", 0x3000 },
+  { "jge", 0x3400 },
+  { "jl", 0x3800 },
+  { "jmp", 0x3c00 },
+  { NULL, 0 }
+};
+
+// Instructions without operands.
+static msp430_instr_t implied[] =
+{
+  { "nop", 0x4303 },
+  { "ret", 0x4130 },
+  { "reti", 0x1300 },
+  { "clrc", 0xc312 },
+  { "setc", 0xd312 },
+  { "clrz", 0xc322 },
+  { "setz", 0xd322 },
+  { "clrn", 0xc222 },
+  { "setn", 0xd222 },
+  { "dint", 0xc232 },
+  { "eint", 0xd232 },
+  { NULL, 0 }
+};
+
+// Emulated instructions that are a double operand instruction with a
+// constant source.
+struct msp430_emulated_t
+{
+  const char *name;
+  int opcode;
+  int value;
+};
+
+static msp430_emulated_t emulated[] =
+{
+  { "clr", 0x4000, 0 },
+  { "inc", 0x5000, 1 },
+  { "incd", 0x5000, 2 },
+  { "dec", 0x8000, 1 },
+  { "decd", 0x8000, 2 },
+  { "tst", 0x9000, 0 },
+  { "inv", 0xe000, -1 },
+  { "adc", 0x6000, 0 },
+  { "sbc", 0x7000, 0 },
+  { NULL, 0, 0 }
+};
+
+// What the generators use out of naken_asm's msp430x2xx.inc so the
+// include file doesn't have to be installed.
+struct msp430_symbol_t
+{
+  const char *name;
+  int value;
+};
+
+static msp430_symbol_t msp430x2xx_symbols[] =
+{
+  { "IE1", 0x0000 },
+  { "IFG1", 0x0002 },
+  { "WDTCTL", 0x0120 },
+  { "WDTPW", 0x5a00 },
+  { "WDTHOLD", 0x0080 },
+  { "WDTNMIES", 0x0040 },
+  { "WDTNMI", 0x0020 },
+  { "WDTTMSEL", 0x0010 },
+  { "WDTCNTCL", 0x0008 },
+  { "WDTSSEL", 0x0004 },
+  { "WDTIS1", 0x0002 },
+  { "WDTIS0", 0x0001 },
+  { "DCOCTL", 0x0056 },
+  { "BCSCTL1", 0x0057 },
+  { "BCSCTL2", 0x0058 },
+  { "BCSCTL3", 0x0053 },
+  { "CALDCO_1MHZ", 0x10fe },
+  { "CALBC1_1MHZ", 0x10ff },
+  { "CALDCO_8MHZ", 0x10fc },
+  { "CALBC1_8MHZ", 0x10fd },
+  { "CALDCO_12MHZ", 0x10fa },
+  { "CALBC1_12MHZ", 0x10fb },
+  { "CALDCO_16MHZ", 0x10f8 },
+  { "CALBC1_16MHZ", 0x10f9 },
+  { "P1IN", 0x0020 },
+  { "P1OUT", 0x0021 },
+  { "P1DIR", 0x0022 },
+  { "P1IFG", 0x0023 },
+  { "P1IES", 0x0024 },
+  { "P1IE", 0x0025 },
+  { "P1SEL", 0x0026 },
+  { "P1REN", 0x0027 },
+  { "P1SEL2", 0x0041 },
+  { "P2IN", 0x0028 },
+  { "P2OUT", 0x0029 },
+  { "P2DIR", 0x002a },
+  { "P2IFG", 0x002b },
+  { "P2IES", 0x002c },
+  { "P2IE", 0x002d },
+  { "P2SEL", 0x002e },
+  { "P2REN", 0x002f },
+  { "P2SEL2", 0x0042 },
+  { "P3IN", 0x0018 },
+  { "P3OUT", 0x0019 },
+  { "P3DIR", 0x001a },
+  { "P3SEL", 0x001b },
+  { "P3REN", 0x0010 },
+  { "P3SEL2", 0x0043 },
+  { "TAIV", 0x012e },
+  { "TACTL", 0x0160 },
+  { "TACCTL0", 0x0162 },
+  { "TACCTL1", 0x0164 },
+  { "TACCTL2", 0x0166 },
+  { "TAR", 0x0170 },
+  { "TACCR0", 0x0172 },
+  { "TACCR1", 0x0174 },
+  { "TACCR2", 0x0176 },
+  { "TACLR", 0x0004 },
+  { "TAIE", 0x0002 },
+  { "TAIFG", 0x0001 },
+  { "CCIE", 0x0010 },
+  { "CCIFG", 0x0001 },
+  { "ADC10DTC0", 0x0048 },
+  { "ADC10DTC1", 0x0049 },
+  { "ADC10AE0", 0x004a },
+  { "ADC10CTL0", 0x01b0 },
+  { "ADC10CTL1", 0x01b2 },
+  { "ADC10MEM", 0x01b4 },
+  { "ADC10SA", 0x01bc },
+  { "ADC10SC", 0x0001 },
+  { "ENC", 0x0002 },
+  { "ADC10IFG", 0x0004 },
+  { "ADC10IE", 0x0008 },
+  { "ADC10ON", 0x0010 },
+  { "REFON", 0x0020 },
+  { "REF2_5V", 0x0040 },
+  { "MSC", 0x0080 },
+  { "ADC10BUSY", 0x0001 },
+  { "USICTL0", 0x0078 },
+  { "USICTL1", 0x0079 },
+  { "USICKCTL", 0x007a },
+  { "USICNT", 0x007b },
+  { "USISRL", 0x007c },
+  { "USISRH", 0x007d },
+  { "USIPE7", 0x0080 },
+  { "USIPE6", 0x0040 },
+  { "USIPE5", 0x0020 },
+  { "USILSB", 0x0010 },
+  { "USIMST", 0x0008 },
+  { "USIGE", 0x0004 },
+  { "USIOE", 0x0002 },
+  { "USISWRST", 0x0001 },
+  { "USICKPH", 0x0080 },
+  { "USII2C", 0x0040 },
+  { "USISTTIE", 0x0020 },
+  { "USIIE", 0x0010 },
+  { "USIAL", 0x0008 },
+  { "USISTP", 0x0004 },
+  { "USISTTIFG", 0x0002 },
+  { "USIIFG", 0x0001 },
+  { "USICKPL", 0x0002 },
+  { "USISWCLK", 0x0001 },
+  { "USI16B", 0x0040 },
+  { NULL, 0 }
+};
+
+// Bit fields defined as NAME_0 .. NAME_n = n << shift.
+struct msp430_field_t
+{
+  const char *name;
+  int count;
+  int shift;
+};
+
+static msp430_field_t msp430x2xx_fields[] =
+{
+  { "DCO", 8, 5 },
+  { "RSEL", 16, 0 },
+  { "DIVA", 4, 4 },
+  { "DIVM", 4, 4 },
+  { "DIVS", 4, 1 },
+  { "TASSEL", 4, 8 },
+  { "ID", 4, 6 },
+  { "MC", 4, 4 },
+  { "OUTMOD", 8, 5 },
+  { "CM", 4, 14 },
+  { "ADC10SHT", 4, 11 },
+  { "SREF", 8, 13 },
+  { "CONSEQ", 4, 1 },
+  { "ADC10SSEL", 4, 3 },
+  { "ADC10DIV", 8, 5 },
+  { "SHS", 4, 10 },
+  { "INCH", 16, 12 },
+  { "USIDIV", 8, 5 },
+  { "USISSEL", 8, 2 },
+  { NULL, 0, 0 }
+};
+
+static int get_register(const char *s)
+{
+  if (strcasecmp(s, "pc") == 0) { return REG_PC; }
+  if (strcasecmp(s, "sp") == 0) { return REG_SP; }
+  if (strcasecmp(s, "sr") == 0) { return REG_SR; }
+  if (strcasecmp(s, "cg") == 0) { return REG_CG; }
+
+  if (s[0] != 'r' && s[0] != 'R') { return -1; }
+
+  char *end;
+  int reg = strtol(s + 1, &end, 10);
+
+  if (s[1] == 0 || *end != 0 || reg < 0 || reg > 15) { return -1; }
+
+  return reg;
+}
+
+static void put_word(uint8_t *b, int value)
+{
+  b[0] = value & 0xff;
+  b[1] = (value >> 8) & 0xff;
+}
+
+// #0, #1, #2, #4, #8 and #-1 come out of the constant generators and
+// don't need an extension word.
+static bool set_constant(msp430_operand_t *operand, int value)
+{
+  operand->has_word = false;
+  operand->pc_relative = false;
+
+  switch (value & 0xffff)
+  {
+    case 0: operand->reg = REG_CG; operand->mode = 0; return true;
+    case 1: operand->reg = REG_CG; operand->mode = 1; return true;
+    case 2: operand->reg = REG_CG; operand->mode = 2; return true;
+    case 0xffff: operand->reg = REG_CG; operand->mode = 3; return true;
+    case 4: operand->reg = REG_SR; operand->mode = 2; return true;
+    case 8: operand->reg = REG_SR; operand->mode = 3; return true;
+    default: break;
+  }
+
+  operand->reg = REG_PC;
+  operand->mode = MODE_AUTOINC;
+  operand->value = value;
+  operand->has_word = true;
+
+  return false;
+}
+
+EncoderMSP430::EncoderMSP430()
+{
+}
+
+EncoderMSP430::~EncoderMSP430()
+{
+}
+
+int EncoderMSP430::encode(const char *instr, char *operands, uint8_t *b)
+{
+  msp430_operand_t src, dst;
+  char name[32];
+  char *args[2];
+  int bw = 0;
+  int count, n;
+
+  if (strlen(instr) >= sizeof(name)) { return error("Unknown instruction ", instr); }
+
+  strcpy(name, instr);
+
+  char *suffix = strchr(name, '.');
+
+  if (suffix != NULL)
+  {
+    *suffix = 0;
+    suffix++;
+
+    if (strcmp(suffix, "b") == 0) { bw = 1; }
+    else if (strcmp(suffix, "w") != 0) { return error("Unknown instruction ", instr); }
+  }
+
+  count = split_operands(operands, args, 2);
+
+  if (count < 0) { return error("Too many operands"); }
+
+  for (n = 0; implied[n].name != NULL; n++)
+  {
+    if (strcmp(name, implied[n].name) != 0) { continue; }
+    if (count != 0) { return error("Unexpected operands for ", instr); }
+
+    put_word(b, implied[n].opcode);
+    return 2;
+  }
+
+  for (n = 0; jumps[n].name != NULL; n++)
+  {
+    if (strcmp(name, jumps[n].name) != 0) { continue; }
+    if (count != 1) { return error("Missing jump address"); }
+
+    return encode_jump(jumps[n].opcode, args[0], b);
+  }
+
+  for (n = 0; double_ops[n].name != NULL; n++)
+  {
+    if (strcmp(name, double_ops[n].name) != 0) { continue; }
+    if (count != 2) { return error("Expected 2 operands for ", instr); }
+
+    if (parse_operand(args[0], &src) != 0) { return -1; }
+    if (parse_operand(args[1], &dst) != 0) { return -1; }
+
+    return encode_double(double_ops[n].opcode, &src, &dst, bw, b);
+  }
+
+  for (n = 0; single_ops[n].name != NULL; n++)
+  {
+    if (strcmp(name, single_ops[n].name) != 0) { continue; }
+    if (count != 1) { return error("Expected 1 operand for ", instr); }
+
+    if (parse_operand(args[0], &src) != 0) { return -1; }
+
+    // push #4 / #8 from the constant generator in SR is broken on some
+    // chips, so those always get an extension word.
+    if (single_ops[n].opcode == 0x1200 && src.reg == REG_SR && src.mode >= MODE_INDIRECT)
+    {
+      src.value = src.mode == MODE_INDIRECT ? 4 : 8;
+      src.reg = REG_PC;
+      src.mode = MODE_AUTOINC;
+      src.has_word = true;
+    }
+
+    return encode_single(single_ops[n].opcode, &src, bw, b);
+  }
+
+  if (count != 1) { return error("Unknown instruction ", instr); }
+
+  if (parse_operand(args[0], &dst) != 0) { return -1; }
+
+  for (n = 0; emulated[n].name != NULL; n++)
+  {
+    if (strcmp(name, emulated[n].name) != 0) { continue; }
+
+    set_constant(&src, emulated[n].value);
+
+    return encode_double(emulated[n].opcode, &src, &dst, bw, b);
+  }
+
+  if (strcmp(name, "pop") == 0)
+  {
+    // mov @SP+, dst
+    src.reg = REG_SP;
+    src.mode = MODE_AUTOINC;
+    src.has_word = false;
+
+    return encode_double(0x4000, &src, &dst, bw, b);
+  }
+    else
+  if (strcmp(name, "rla") == 0 || strcmp(name, "rlc") == 0)
+  {
+    // add dst, dst / addc dst, dst
+    src = dst;
+
+    return encode_double(name[2] == 'a' ? 0x5000 : 0x6000, &src, &dst, bw, b);
+  }
+    else
+  if (strcmp(name, "br") == 0)
+  {
+    // mov src, pc
+    src = dst;
+    dst.reg = REG_PC;
+    dst.mode = MODE_REGISTER;
+    dst.has_word = false;
+
+    return encode_double(0x4000, &src, &dst, 0, b);
+  }
+    else
+  if (strcmp(name, "neg") == 0)
+  {
+    // inv dst; inc dst
+    set_constant(&src, -1);
+    n = encode_double(0xe000, &src, &dst, bw, b);
+    if (n < 0) { return -1; }
+
+    set_constant(&src, 1);
+    int len = encode_double(0x5000, &src, &dst, bw, b + n);
+    if (len < 0) { return -1; }
+
+    return n + len;
+  }
+
+  return error("Unknown instruction ", instr);
+}
+
+bool EncoderMSP430::is_cpu_directive(const char *name)
+{
+  return strcmp(name, "msp430") == 0;
+}
+
+int EncoderMSP430::include(const char *filename)
+{
+  FILE *in = fopen(filename, "rb");
+  int n, i;
+
+  if (in != NULL)
+  {
+    fclose(in);
+    return Encoder::include(filename);
+  }
+
+  if (strcmp(filename, "msp430x2xx.inc") != 0)
+  {
+    return Encoder::include(filename);
+  }
+
+  for (n = 0; msp430x2xx_symbols[n].name != NULL; n++)
+  {
+    set_symbol(msp430x2xx_symbols[n].name, msp430x2xx_symbols[n].value);
+  }
+
+  for (n = 0; msp430x2xx_fields[n].name != NULL; n++)
+  {
+    char name[32];
+
+    for (i = 0; i < msp430x2xx_fields[n].count; i++)
+    {
+      sprintf(name, "%s_%d", msp430x2xx_fields[n].name, i);
+      set_symbol(name, i << msp430x2xx_fields[n].shift);
+    }
+  }
+
+  return 0;
+}
+
+int EncoderMSP430::parse_operand(char *s, msp430_operand_t *operand)
+{
+  int value;
+  int reg;
+
+  operand->has_word = false;
+  operand->pc_relative = false;
+  operand->value = 0;
+
+  if (*s == '#')
+  {
+    if (eval(s + 1, &value) != 0) { return -1; }
+
+    // The length can't depend on a value that isn't known yet.
+    if (unresolved)
+    {
+      operand->reg = REG_PC;
+      operand->mode = MODE_AUTOINC;
+      operand->value = value;
+      operand->has_word = true;
+      return 0;
+    }
+
+    set_constant(operand, value);
+    return 0;
+  }
+    else
+  if (*s == '&')
+  {
+    if (eval(s + 1, &value) != 0) { return -1; }
+
+    operand->reg = REG_SR;
+    operand->mode = MODE_INDEXED;
+    operand->value = value;
+    operand->has_word = true;
+    return 0;
+  }
+    else
+  if (*s == '@')
+  {
+    char name[16];
+    int len = strlen(s + 1);
+    bool autoinc = len > 0 && s[len] == '+';
+
+    if (autoinc) { len--; }
+    if (len <= 0 || len >= (int)sizeof(name)) { return error("Bad operand ", s); }
+
+    memcpy(name, s + 1, len);
+    name[len] = 0;
+
+    operand->reg = get_register(name);
+    operand->mode = autoinc ? MODE_AUTOINC : MODE_INDIRECT;
+
+    if (operand->reg == -1) { return error("Bad register ", s); }
+
+    return 0;
+  }
+
+  reg = get_register(s);
+
+  if (reg != -1)
+  {
+    operand->reg = reg;
+    operand->mode = MODE_REGISTER;
+    return 0;
+  }
+
+  // x(Rn)
+  int len = strlen(s);
+  char *paren = strrchr(s, '(');
+
+  if (len > 0 && s[len - 1] == ')' && paren != NULL)
+  {
+    s[len - 1] = 0;
+    reg = get_register(paren + 1);
+
+    if (reg != -1)
+    {
+      *paren = 0;
+
+      if (s[0] == 0) { value = 0; }
+      else if (eval(s, &value) != 0) { return -1; }
+
+      operand->reg = reg;
+      operand->mode = MODE_INDEXED;
+      operand->value = value;
+      operand->has_word = true;
+      return 0;
+    }
+
+    s[len - 1] = ')';
+  }
+
+  // Symbolic: x(PC) with x relative to the extension word.
+  if (eval(s, &value) != 0) { return -1; }
+
+  operand->reg = REG_PC;
+  operand->mode = MODE_INDEXED;
+  operand->value = value;
+  operand->has_word = true;
+  operand->pc_relative = true;
+
+  return 0;
+}
+
+void EncoderMSP430::add_word(uint8_t *b, int *ptr, msp430_operand_t *operand)
+{
+  if (!operand->has_word) { return; }
+
+  int value = operand->value;
+
+  if (operand->pc_relative) { value -= address + *ptr; }
+
+  put_word(b + *ptr, value);
+  *ptr += 2;
+}
+
+int EncoderMSP430::encode_double(int opcode, msp430_operand_t *src, msp430_operand_t *dst, int bw, uint8_t *b)
+{
+  int ptr = 2;
+  int ad;
+
+  // @Rn isn't a destination mode, 0(Rn) is the same thing.
+  if (dst->mode == MODE_INDIRECT)
+  {
+    dst->mode = MODE_INDEXED;
+    dst->value = 0;
+    dst->has_word = true;
+  }
+
+  if (dst->mode == MODE_REGISTER) { ad = 0; }
+  else if (dst->mode == MODE_INDEXED) { ad = 1; }
+  else { return error("Bad destination operand"); }
+
+  put_word(b, opcode | (src->reg << 8) | (ad << 7) | (bw << 6) |
+              (src->mode << 4) | dst->reg);
+
+  add_word(b, &ptr, src);
+  add_word(b, &ptr, dst);
+
+  return ptr;
+}
+
+int EncoderMSP430::encode_single(int opcode, msp430_operand_t *src, int bw, uint8_t *b)
+{
+  int ptr = 2;
+
+  // swpb, sxt and call are word only.
+  if (bw == 1 && (opcode == 0x1080 || opcode == 0x1180 || opcode == 0x1280))
+  {
+    return error("Instruction can't be .b");
+  }
+
+  put_word(b, opcode | (bw << 6) | (src->mode << 4) | src->reg);
+
+  add_word(b, &ptr, src);
+
+  return ptr;
+}
+
+int EncoderMSP430::encode_jump(int opcode, char *s, uint8_t *b)
+{
+  int value;
+
+  if (eval(s, &value) != 0) { return -1; }
+
+  int offset = value - (address + 2);
+
+  if (pass == 2)
+  {
+    if ((offset & 1) != 0) { return error("Jump to odd address ", s); }
+
+    if (offset < -1024 || offset > 1022)
+    {
+      return error("Jump out of range ", s);
+    }
+  }
+
+  put_word(b, opcode | ((offset >> 1) & 0x3ff));
+
+  return 2;
+}
+
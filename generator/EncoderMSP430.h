@@ -0,0 +1,46 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _ENCODER_MSP430_H
+#define _ENCODER_MSP430_H
+
+#include "Encoder.h"
+
+struct msp430_operand_t
+{
+  int reg;
+  int mode;          // As / Ad addressing mode
+  int value;         // extension word
+  bool has_word;
+  bool pc_relative;  // symbolic mode, word is relative to itself
+};
+
+class EncoderMSP430 : public Encoder
+{
+public:
+  EncoderMSP430();
+  virtual ~EncoderMSP430();
+
+protected:
+  virtual int encode(const char *instr, char *operands, uint8_t *b);
+  virtual bool is_cpu_directive(const char *name);
+  virtual int include(const char *filename);
+
+private:
+  int parse_operand(char *s, msp430_operand_t *operand);
+  int encode_double(int opcode, msp430_operand_t *src, msp430_operand_t *dst, int bw, uint8_t *b);
+  int encode_single(int opcode, msp430_operand_t *src, int bw, uint8_t *b);
+  int encode_jump(int opcode, char *s, uint8_t *b);
+  void add_word(uint8_t *b, int *ptr, msp430_operand_t *operand);
+};
+
+#endif
+
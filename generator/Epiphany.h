@@ -21,6 +21,7 @@ public:
   virtual ~Epiphany();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -17,25 +17,44 @@
 #include "MSP430.h"
 #include "Generator.h"
 
-Generator::Generator() : label_count(0)
+Generator::Generator() : out(NULL), text(NULL), text_length(NULL), label_count(0)
 {
 }
 
 Generator::~Generator()
 {
+  if (out == NULL) { return; }
+
   fprintf(out, "\n");
-  fclose(out);
+  delete out;
 }
 
 int Generator::open(const char *filename)
 {
-  out = fopen(filename, "wb");
+  FILE *file;
 
-  if (out == NULL)
+  if (filename == NULL)
   {
-    printf("Couldn't open file %s for writing.\n", filename);
-    return -1;
+    file = text == NULL ? NULL : open_memstream(text, text_length);
+
+    if (file == NULL)
+    {
+      printf("Couldn't allocate output buffer.\n");
+      return -1;
+    }
   }
+    else
+  {
+    file = fopen(filename, "wb");
+
+    if (file == NULL)
+    {
+      printf("Couldn't open file %s for writing.\n", filename);
+      return -1;
+    }
+  }
+
+  out = new OutputBuffer(file);
 
   return 0;
 }
@@ -118,6 +137,132 @@ int Generator::compare_floats(int cond)
   return -1;
 }
 
+int Generator::return_float(int local_count)
+{
+  printf("Error: Floats are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::push_local_var_long(int index)
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::pop_local_var_long(int index)
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::add_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::sub_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::mul_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::div_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::mod_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::neg_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::shift_left_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::shift_right_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::shift_right_ulong()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::and_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::or_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::xor_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::integer_to_long()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::long_to_integer()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::compare_longs()
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::return_long(int local_count)
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::invoke_static_method_long(const char *name, int params)
+{
+  printf("Error: Longs are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::invoke_static_method_float(const char *name, int params)
+{
+  // A float comes back the same way an int does.
+  return invoke_static_method(name, params, 0);
+}
+
 int Generator::array_read_float()
 {
   printf("Error: Floats are not supported on this platform.\n");
@@ -142,12 +287,54 @@ int Generator::array_write_float(const char *name, int field_id)
   return -1;
 }
 
-int Generator::new_object(const char *object_name, int field_count)
+int Generator::new_object(const char *object_name, int object_size)
 {
   printf("Error: Object instantiation is not supported on this platform.\n");
   return -1;
 }
 
+int Generator::get_field_byte(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::get_field_short(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::get_field_char(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::get_field_int(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::put_field_byte(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::put_field_short(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
+int Generator::put_field_int(int offset)
+{
+  printf("Error: Object fields are not supported on this platform.\n");
+  return -1;
+}
+
 void Generator::label(char *name)
 {
   fprintf(out, "%s:\n", name);
@@ -371,12 +558,8 @@ int Generator::insert_utf8(const char *name, uint8_t *bytes, int len)
 
 int Generator::cpu_asm_X(const char *code, int len)
 {
-  int n;
+  out->append(code, len);
 
-  for (n = 0; n < len; n++)
-  {
-    putc(code[n], out);
-  }
   return 0;
 }
 
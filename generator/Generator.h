@@ -23,6 +23,7 @@
 #include "API_CPC.h"
 #include "API_DSP.h"
 #include "API_Draw3D.h"
+#include "API_Fixed.h"
 #include "API_Math.h"
 #include "API_Microcontroller.h"
 #include "API_MSX.h"
@@ -36,6 +37,10 @@
 #include "API_TI84.h"
 #include "API_TI99.h"
 #include "API_TRS80_Coco.h"
+#include "OutputBuffer.h"
+
+class Cycles;
+class Encoder;
 
 class Generator :
   public API_AppleIIgs,
@@ -44,6 +49,7 @@ class Generator :
   public API_CPC,
   public API_DSP,
   public API_Draw3D,
+  public API_Fixed,
   public API_Math,
   public API_Microcontroller,
   public API_MSX,
@@ -62,7 +68,18 @@ public:
   Generator();
   virtual ~Generator();
 
+  // A NULL filename writes the assembly into the caller's set_buffer()
+  // buffer instead, which is complete once the generator is deleted.
   virtual int open(const char *filename);
+  void set_buffer(char **text, size_t *length) { this->text = text; text_length = length; }
+  // Assembler for this CPU's output so a .hex / .bin can be written
+  // without running naken_asm, or NULL if there isn't one.
+  virtual Encoder *new_encoder() { return NULL; }
+  // Instruction timings for -cycles, or NULL if there aren't any.
+  virtual Cycles *new_cycles() { return NULL; }
+  // Average bytes per instruction so -stats can estimate code size
+  // without an assembler, or 0 if there's no sensible number.
+  virtual int get_instruction_size() { return 0; }
   virtual int add_functions() { return 0; }
   virtual int get_cpu_byte_alignment() { return 2; }
   void label(char *name);
@@ -79,8 +96,19 @@ public:
   virtual int push_local_var_int(int index) = 0;
   virtual int push_local_var_ref(int index) = 0;
   virtual int push_local_var_float(int index);
+  virtual int push_local_var_long(int index);
   virtual int push_ref_static(const char *name, int index) = 0;
   virtual int push_fake() { return -1; } // move stack ptr without push
+  virtual int get_local_register_count() { return 0; }
+  // Values of the operand stack that didn't fit in registers and went
+  // onto the CPU stack (backends that keep the top of stack in registers).
+  virtual int get_spilled() { return 0; }
+  virtual void set_local_registers(const int *local_regs, int local_count) { }
+  // JAVA_TYPE_* of each local (IR_TYPE_MIXED if it's used as more than
+  // one) so a CPU that needs 2 words for a float can lay out the frame.
+  virtual void set_local_types(const uint8_t *local_types, int local_count) { }
+  // Operand stack entries (and words in the frame) a float takes.
+  virtual int get_float_size() { return 1; }
   virtual int set_integer_local(int index, int value) { return -1; }
   virtual int set_float_local(int index, float value);
   virtual int set_ref_local(int index, char *name) { return -1; }
@@ -92,6 +120,7 @@ public:
   virtual int pop_local_var_int(int index) = 0;
   virtual int pop_local_var_ref(int index) = 0;
   virtual int pop_local_var_float(int index) { return -1; }
+  virtual int pop_local_var_long(int index);
   virtual int pop() = 0;
   virtual int dup() = 0;
   virtual int dup2() = 0;
@@ -126,23 +155,64 @@ public:
   virtual int neg_float();
   virtual int float_to_integer();
   virtual int integer_to_float();
+  // Longs take 2 slots of the operand stack (and 2 locals), the low 32 bits
+  // first so the high 32 bits are on top.
+  virtual int add_long();
+  virtual int sub_long();
+  virtual int mul_long();
+  virtual int div_long();
+  virtual int mod_long();
+  virtual int neg_long();
+  virtual int shift_left_long();
+  virtual int shift_left_long(int count) { return -1; }
+  virtual int shift_right_long();
+  virtual int shift_right_long(int count) { return -1; }
+  virtual int shift_right_ulong();
+  virtual int shift_right_ulong(int count) { return -1; }
+  virtual int and_long();
+  virtual int or_long();
+  virtual int xor_long();
+  virtual int integer_to_long();
+  virtual int long_to_integer();
   virtual int jump_cond(const char *label, int cond, int distance) = 0;
   virtual int jump_cond_zero(const char *label, int cond, int distance) { return -1; }
   virtual int jump_cond_integer(const char *label, int cond, int distance) = 0;
   virtual int jump_cond_integer(const char *label, int cond, int const_val, int distance) { return -1; } 
   virtual int compare_floats(int cond);
+  virtual int compare_longs();
   virtual int ternary(int cond, int value_true, int value_false) = 0;
   virtual int ternary(int cond, int compare, int value_true, int value_false) = 0;
   virtual int return_local(int index, int local_count) = 0;
   virtual int return_integer(int local_count) = 0;
   virtual int return_void(int local_count) = 0;
+  virtual int return_long(int local_count);
+  virtual int return_float(int local_count);
   virtual int jump(const char *name, int distance) = 0;
+  // Pops an index and goes to labels[index - low], or to default_label if
+  // it's not in the table.  Returns -1 without writing anything if this
+  // CPU can't (or the table is too big), so a compare tree is used.
+  // has_jump_table() says ahead of time which one it will be.
+  virtual bool has_jump_table(int low, int count) { return false; }
+  virtual int jump_table(const char *default_label, int low, char **labels, int count) { return -1; }
   virtual int call(const char *name) = 0;
   virtual int invoke_static_method(const char *name, int params, int is_void) = 0;
+  virtual int invoke_static_method_long(const char *name, int params);
+  virtual int invoke_static_method_float(const char *name, int params);
   virtual int put_static(const char *name, int index) = 0;
   virtual int get_static(const char *name, int index) = 0;
   virtual int brk() = 0;
-  virtual int new_object(const char *object_name, int field_count);
+  // object_size is how many bytes the fields of a user class take, or 0
+  // for an API class.
+  virtual int new_object(const char *object_name, int object_size);
+  // Pop an object reference (and for put_field_* the value under it) and
+  // load / store the field offset bytes into the object.
+  virtual int get_field_byte(int offset);
+  virtual int get_field_short(int offset);
+  virtual int get_field_char(int offset);
+  virtual int get_field_int(int offset);
+  virtual int put_field_byte(int offset);
+  virtual int put_field_short(int offset);
+  virtual int put_field_int(int offset);
   virtual int new_array(uint8_t type) = 0;
   virtual int insert_array(const char *name, int32_t *data, int len, uint8_t type) = 0;
   virtual int insert_string(const char *name, uint8_t *bytes, int len) = 0;
@@ -172,6 +242,7 @@ public:
   void add_newline();
   void instruction_count_clear() { instruction_count = 0; }
   void instruction_count_inc() { instruction_count++; }
+  long get_output_offset() { return out->tell(); }
 
 protected:
   int insert_db(const char *name, int32_t *data, int len, uint8_t len_type);
@@ -182,7 +253,9 @@ protected:
   void insert_constants_pool();
   int insert_utf8(const char *name, uint8_t *bytes, int len);
 
-  FILE *out;
+  OutputBuffer *out;
+  char **text;
+  size_t *text_length;
   int label_count;
   int instruction_count;
   std::map<uint32_t,int> constants_pool;
@@ -16,14 +16,20 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "CyclesM6502.h"
+#include "EncoderM6502.h"
 #include "M6502.h"
+#include "MethodIR.h"
 
 // ABI is:
 // A - accumulator
 // X - java stack index register
 // Y - general-purpose index register
+//
+// A float is 2 stack entries (high word on top) and the soft float
+// routines work on float_a, float_b and float_m in zero page.
 
-#define LOCALS(a) (a)
+#define LOCALS(a) (local_offsets[a])
 
 M6502::M6502() :
   stack(0),
@@ -32,6 +38,8 @@ M6502::M6502() :
   java_stack_hi(0x300),
   ram_start(0xa000),
   label_count(0),
+  local_offsets(NULL),
+  locals_size(0),
   is_main(0),
 
   need_swap(0),
@@ -54,6 +62,14 @@ M6502::M6502() :
   need_array_byte_support(0),
   need_array_int_support(0),
   need_get_values_from_stack(0),
+  need_float_support(0),
+  need_add_float(0),
+  need_mul_float(0),
+  need_div_float(0),
+  need_float_to_integer(0),
+  need_integer_to_float(0),
+  need_compare_floats(0),
+  need_array_float_support(0),
   need_memory_read8(0),
   need_memory_write8(0),
   need_memory_read16(0),
@@ -64,6 +80,7 @@ M6502::M6502() :
 
 M6502::~M6502()
 {
+  free(local_offsets);
 }
 
 int M6502::open(const char *filename)
@@ -94,6 +111,14 @@ int M6502::open(const char *filename)
   fprintf(out, "value2 equ 0xcc\n");
   fprintf(out, "value3 equ 0xce\n");
 
+  // soft float
+  fprintf(out, "float_a equ 0xb0\n");
+  fprintf(out, "float_b equ 0xb4\n");
+  fprintf(out, "float_m equ 0xb8\n");
+  fprintf(out, "float_e equ 0xbc\n");
+  fprintf(out, "float_s equ 0xbe\n");
+  fprintf(out, "float_x equ 0xbf\n");
+
   // start at 0x0400 when using simulator
   fprintf(out, ".org 0x%04x\n", start_org);
   fprintf(out, "reset:\n");
@@ -106,6 +131,16 @@ int M6502::open(const char *filename)
   return 0;
 }
 
+Encoder *M6502::new_encoder()
+{
+  return new EncoderM6502();
+}
+
+Cycles *M6502::new_cycles()
+{
+  return new CyclesM6502();
+}
+
 int M6502::add_functions()
 {
   if(need_swap) { insert_swap(); }
@@ -128,6 +163,14 @@ int M6502::add_functions()
   if(need_array_byte_support) { insert_array_byte_support(); }
   if(need_array_int_support) { insert_array_int_support(); }
   if(need_get_values_from_stack) { insert_get_values_from_stack(); }
+  if(need_float_support) { insert_float_support(); }
+  if(need_add_float) { insert_add_float(); }
+  if(need_mul_float) { insert_mul_float(); }
+  if(need_div_float) { insert_div_float(); }
+  if(need_float_to_integer) { insert_float_to_integer(); }
+  if(need_integer_to_float) { insert_integer_to_float(); }
+  if(need_compare_floats) { insert_compare_floats(); }
+  if(need_array_float_support) { insert_array_float_support(); }
   if(need_memory_read8) { insert_memory_read8(); }
   if(need_memory_write8) { insert_memory_write8(); }
   if(need_memory_read16) { insert_memory_read16(); }
@@ -246,10 +289,34 @@ void M6502::method_start(int local_count, int max_stack, int param_count, const
   fprintf(out, "  stx locals\n");
   fprintf(out, "  txa\n");
   fprintf(out, "  sec\n");
-  fprintf(out, "  sbc #0x%02x\n", local_count);
+  fprintf(out, "  sbc #0x%02x\n", locals_size);
   fprintf(out, "  tax\n");
 }
 
+void M6502::set_local_types(const uint8_t *local_types, int local_count)
+{
+  int n;
+
+  // A local that is ever a float takes 2 stack entries so each one gets
+  // its own offset from locals.  The caller copies params the same way.
+  local_offsets = (int *)realloc(local_offsets, (local_count + 1) * sizeof(int));
+  locals_size = 0;
+
+  for (n = 0; n < local_count; n++)
+  {
+    local_offsets[n] = locals_size;
+
+    if (local_types[n] == JAVA_TYPE_FLOAT || local_types[n] == IR_TYPE_MIXED)
+    {
+      locals_size += 2;
+    }
+      else
+    {
+      locals_size++;
+    }
+  }
+}
+
 void M6502::method_end(int local_count)
 {
   fprintf(out, "\n");
@@ -273,6 +340,23 @@ int M6502::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int M6502::push_local_var_float(int index)
+{
+  fprintf(out, "; push_local_var_float\n");
+  fprintf(out, "  ldy locals\n");
+  fprintf(out, "  lda stack_lo - %d,y\n", LOCALS(index));
+  PUSH_LO();
+  fprintf(out, "  lda stack_hi - %d,y\n", LOCALS(index));
+  PUSH_HI();
+  fprintf(out, "  lda stack_lo - %d,y\n", LOCALS(index) + 1);
+  PUSH_LO();
+  fprintf(out, "  lda stack_hi - %d,y\n", LOCALS(index) + 1);
+  PUSH_HI();
+  stack += 2;
+
+  return 0;
+}
+
 int M6502::push_ref_static(const char *name, int index)
 {
   return -1;
@@ -309,12 +393,18 @@ int M6502::push_long(int64_t n)
   return push_int((int32_t)n);
 }
 
-#if 0
 int M6502::push_float(float f)
 {
-  return -1;
+  uint32_t *data = (uint32_t *)&f;
+
+  fprintf(out, "; push_float(%f)\n", f);
+  push_int(*data & 0xffff);
+  push_int(*data >> 16);
+
+  return 0;
 }
 
+#if 0
 int M6502::push_double(double f)
 {
   return -1;
@@ -383,6 +473,23 @@ int M6502::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int M6502::pop_local_var_float(int index)
+{
+  fprintf(out, "; pop_local_var_float\n");
+  fprintf(out, "  ldy locals\n");
+  POP_HI();
+  fprintf(out, "  sta stack_hi - %d,y\n", LOCALS(index) + 1);
+  POP_LO();
+  fprintf(out, "  sta stack_lo - %d,y\n", LOCALS(index) + 1);
+  POP_HI();
+  fprintf(out, "  sta stack_hi - %d,y\n", LOCALS(index));
+  POP_LO();
+  fprintf(out, "  sta stack_lo - %d,y\n", LOCALS(index));
+  stack -= 2;
+
+  return 0;
+}
+
 int M6502::pop()
 {
   fprintf(out, "; pop\n");
@@ -406,9 +513,19 @@ int M6502::dup()
 
 int M6502::dup2()
 {
-  printf("Need to implement dup2()\n");
+  // Each push moves the entry to copy down by one.
+  fprintf(out, "; dup2\n");
+  fprintf(out, "  lda stack_lo + 2,x\n");
+  PUSH_LO();
+  fprintf(out, "  lda stack_hi + 2,x\n");
+  PUSH_HI();
+  fprintf(out, "  lda stack_lo + 2,x\n");
+  PUSH_LO();
+  fprintf(out, "  lda stack_hi + 2,x\n");
+  PUSH_HI();
+  stack += 2;
 
-  return -1;
+  return 0;
 }
 
 int M6502::swap()
@@ -616,6 +733,86 @@ int M6502::integer_to_short()
   return 0;
 }
 
+int M6502::add_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  fprintf(out, "  jsr add_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int M6502::sub_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  fprintf(out, "  jsr sub_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int M6502::mul_float()
+{
+  need_float_support = 1;
+  need_mul_float = 1;
+  fprintf(out, "  jsr mul_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int M6502::div_float()
+{
+  need_float_support = 1;
+  need_div_float = 1;
+  fprintf(out, "  jsr div_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int M6502::neg_float()
+{
+  // sign is the top bit of the high word
+  fprintf(out, "; neg_float\n");
+  fprintf(out, "  lda stack_hi + 1,x\n");
+  fprintf(out, "  eor #0x80\n");
+  fprintf(out, "  sta stack_hi + 1,x\n");
+
+  return 0;
+}
+
+int M6502::float_to_integer()
+{
+  need_float_to_integer = 1;
+  fprintf(out, "  jsr float_to_integer\n");
+  stack--;
+
+  return 0;
+}
+
+int M6502::integer_to_float()
+{
+  need_float_support = 1;
+  need_integer_to_float = 1;
+  fprintf(out, "  jsr integer_to_float\n");
+  stack++;
+
+  return 0;
+}
+
+int M6502::compare_floats(int cond)
+{
+  need_float_support = 1;
+  need_compare_floats = 1;
+  fprintf(out, "  jsr compare_floats_%c\n", cond == 0 ? 'l' : 'g');
+  stack -= 3;
+
+  return 0;
+}
+
 int M6502::jump_cond(const char *label, int cond, int distance)
 {
   bool reverse = false;
@@ -867,6 +1064,34 @@ int M6502::return_integer(int local_count)
   return 0;
 }
 
+int M6502::return_float(int local_count)
+{
+  // A float comes back in float_a since result is only 16 bits.
+  fprintf(out, "; return_float\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 3\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 2\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 1\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 0\n");
+  stack -= 2;
+
+  fprintf(out, "  ldx locals\n");
+
+  if (!is_main)
+  {
+    POP_HI();
+    POP_LO();
+    fprintf(out, "  sta locals\n");
+  }
+
+  fprintf(out, "  rts\n");
+
+  return 0;
+}
+
 int M6502::return_void(int local_count)
 {
   fprintf(out, "; return_void\n");
@@ -891,6 +1116,52 @@ int M6502::jump(const char *name, int distance)
   return 0;
 }
 
+bool M6502::has_jump_table(int low, int count)
+{
+  // The index is doubled to read the table so it has to fit in Y.
+  return count <= 128 && low >= -32768 && low + count - 1 <= 32767;
+}
+
+int M6502::jump_table(const char *default_label, int low, char **labels, int count)
+{
+  int n;
+
+  if (!has_jump_table(low, count)) { return -1; }
+
+  fprintf(out, "; jump_table(low=%d, count=%d)\n", low, count);
+  fprintf(out, "  inx\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda stack_lo,x\n");
+  fprintf(out, "  sbc #0x%02x\n", low & 0xff);
+  fprintf(out, "  tay\n");
+  fprintf(out, "  lda stack_hi,x\n");
+  fprintf(out, "  sbc #0x%02x\n", (low >> 8) & 0xff);
+  fprintf(out, "  beq #3\n");
+  fprintf(out, "  jmp %s\n", default_label);
+  fprintf(out, "  cpy #%d\n", count);
+  fprintf(out, "  bcc #3\n");
+  fprintf(out, "  jmp %s\n", default_label);
+  fprintf(out, "  tya\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  tay\n");
+  fprintf(out, "  lda jump_table_%d + 0,y\n", label_count);
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda jump_table_%d + 1,y\n", label_count);
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "  jmp (address)\n");
+  fprintf(out, "jump_table_%d:\n", label_count);
+
+  for (n = 0; n < count; n++)
+  {
+    fprintf(out, "  dw %s\n", labels[n]);
+  }
+
+  label_count++;
+  stack--;
+
+  return 0;
+}
+
 int M6502::call(const char *name)
 {
   fprintf(out, "  jsr %s\n", name);
@@ -946,6 +1217,23 @@ int stack_vars = stack;
   return 0;
 }
 
+int M6502::invoke_static_method_float(const char *name, int params)
+{
+  invoke_static_method(name, params, 1);
+
+  fprintf(out, "  lda float_a + 0\n");
+  PUSH_LO();
+  fprintf(out, "  lda float_a + 1\n");
+  PUSH_HI();
+  fprintf(out, "  lda float_a + 2\n");
+  PUSH_LO();
+  fprintf(out, "  lda float_a + 3\n");
+  PUSH_HI();
+  stack += 2;
+
+  return 0;
+}
+
 int M6502::put_static(const char *name, int index)
 {
   if (stack > 0)
@@ -986,6 +1274,12 @@ int M6502::new_array(uint8_t type)
       fprintf(out, "jsr new_array_int\n");
     }
       else
+    if (type == TYPE_FLOAT)
+    {
+      need_array_float_support = 1;
+      fprintf(out, "jsr new_array_float\n");
+    }
+      else
     {
       need_array_byte_support = 1;
       fprintf(out, "jsr new_array_byte\n");
@@ -1108,6 +1402,29 @@ int M6502::array_read_int(const char *name, int field_id)
   return 0;
 }
 
+int M6502::array_read_float()
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+  fprintf(out, "jsr array_read_float\n");
+
+  return 0;
+}
+
+int M6502::array_read_float(const char *name, int field_id)
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+  fprintf(out, "  lda %s + 0\n", name);
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda %s + 1\n", name);
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "jsr array_read_float2\n");
+  stack++;
+
+  return 0;
+}
+
 int M6502::array_write_byte()
 {
   need_array_byte_support = 1;
@@ -1207,6 +1524,30 @@ int M6502::get_values_from_stack(int num)
   return 0;
 }
 
+int M6502::array_write_float()
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+  fprintf(out, "jsr array_write_float\n");
+  stack -= 4;
+
+  return 0;
+}
+
+int M6502::array_write_float(const char *name, int field_id)
+{
+  need_float_support = 1;
+  need_array_float_support = 1;
+  fprintf(out, "  lda %s + 0\n", name);
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda %s + 1\n", name);
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "jsr array_write_float2\n");
+  stack -= 3;
+
+  return 0;
+}
+
 // subroutines
 void M6502::insert_swap()
 {
@@ -1978,6 +2319,958 @@ int M6502::memory_write16_IS()
   return 0;
 }
 
+void M6502::insert_float_support()
+{
+  // Helpers shared by the soft float routines.  A float is 2 stack entries
+  // with the high word on top.  Denormals are treated as 0.
+  fprintf(out, "float_pop_ab:\n");
+  POP_HI();
+  fprintf(out, "  sta float_b + 3\n");
+  POP_LO();
+  fprintf(out, "  sta float_b + 2\n");
+  POP_HI();
+  fprintf(out, "  sta float_b + 1\n");
+  POP_LO();
+  fprintf(out, "  sta float_b + 0\n");
+  fprintf(out, "float_pop_a:\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 3\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 2\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 1\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  rts\n");
+  fprintf(out, "float_push_a:\n");
+  fprintf(out, "  lda float_a + 0\n");
+  PUSH_LO();
+  fprintf(out, "  lda float_a + 1\n");
+  PUSH_HI();
+  fprintf(out, "  lda float_a + 2\n");
+  PUSH_LO();
+  fprintf(out, "  lda float_a + 3\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  // Sets carry if a or b is NaN.
+  fprintf(out, "float_is_nan:\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  rol\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne float_is_nan_b\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  ora float_a + 1\n");
+  fprintf(out, "  ora float_a + 0\n");
+  fprintf(out, "  bne float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_b:\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  rol\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne float_is_nan_no\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  ora float_b + 1\n");
+  fprintf(out, "  ora float_b + 0\n");
+  fprintf(out, "  bne float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_no:\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  rts\n");
+  fprintf(out, "float_is_nan_yes:\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  rts\n");
+  // Exponents of a and b in float_e + 0 and float_e + 1.
+  fprintf(out, "float_exponents:\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  rol\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  rol\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  rts\n");
+  // float_m is the mantissa with the hidden bit at bit 31, float_e the
+  // exponent (16 bit signed) and float_s the sign.  Rounds to nearest even
+  // and pushes the float.  Anything too small for a normal float becomes 0.
+  fprintf(out, "float_pack:\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bmi float_pack_zero\n");
+  fprintf(out, "  bne float_pack_round\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  beq float_pack_zero\n");
+  fprintf(out, "float_pack_round:\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  cmp #0x80\n");
+  fprintf(out, "  bcc float_pack_exponent\n");
+  fprintf(out, "  bne float_pack_round_up\n");
+  fprintf(out, "  lda float_m + 1\n");
+  fprintf(out, "  and #1\n");
+  fprintf(out, "  beq float_pack_exponent\n");
+  fprintf(out, "float_pack_round_up:\n");
+  fprintf(out, "  inc float_m + 1\n");
+  fprintf(out, "  bne float_pack_exponent\n");
+  fprintf(out, "  inc float_m + 2\n");
+  fprintf(out, "  bne float_pack_exponent\n");
+  fprintf(out, "  inc float_m + 3\n");
+  fprintf(out, "  bne float_pack_exponent\n");
+  fprintf(out, "  lda #0x80\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "  inc float_e + 0\n");
+  fprintf(out, "  bne float_pack_exponent\n");
+  fprintf(out, "  inc float_e + 1\n");
+  fprintf(out, "float_pack_exponent:\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bne float_pack_inf\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq float_pack_inf\n");
+  // The low bit of the exponent goes where the hidden bit was.
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  lsr\n");
+  fprintf(out, "  ror float_a + 2\n");
+  fprintf(out, "  ora float_s\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda float_m + 2\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  lda float_m + 1\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  jmp float_push_a\n");
+  fprintf(out, "float_pack_inf:\n");
+  fprintf(out, "  lda float_s\n");
+  fprintf(out, "  ora #0x7f\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda #0x80\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  jmp float_push_a\n");
+  fprintf(out, "float_pack_zero:\n");
+  fprintf(out, "  lda float_s\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  jmp float_push_a\n");
+  fprintf(out, "float_nan:\n");
+  fprintf(out, "  lda #0x7f\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda #0xc0\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  jmp float_push_a\n");
+}
+
+void M6502::insert_add_float()
+{
+  fprintf(out, "sub_float:\n");
+  fprintf(out, "  jsr float_pop_ab\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  eor #0x80\n");
+  fprintf(out, "  sta float_b + 3\n");
+  fprintf(out, "  jmp add_float_start\n");
+  fprintf(out, "add_float:\n");
+  fprintf(out, "  jsr float_pop_ab\n");
+  fprintf(out, "add_float_start:\n");
+  // Make a the one with the bigger magnitude.
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  cmp float_x\n");
+  fprintf(out, "  bcc add_float_ordered\n");
+  fprintf(out, "  bne add_float_swap\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  cmp float_a + 2\n");
+  fprintf(out, "  bcc add_float_ordered\n");
+  fprintf(out, "  bne add_float_swap\n");
+  fprintf(out, "  lda float_b + 1\n");
+  fprintf(out, "  cmp float_a + 1\n");
+  fprintf(out, "  bcc add_float_ordered\n");
+  fprintf(out, "  bne add_float_swap\n");
+  fprintf(out, "  lda float_b + 0\n");
+  fprintf(out, "  cmp float_a + 0\n");
+  fprintf(out, "  bcc add_float_ordered\n");
+  fprintf(out, "  beq add_float_ordered\n");
+  fprintf(out, "add_float_swap:\n");
+  fprintf(out, "  ldy #3\n");
+  fprintf(out, "add_float_swap_loop:\n");
+  fprintf(out, "  lda float_a,y\n");
+  fprintf(out, "  sta float_m,y\n");
+  fprintf(out, "  lda float_b,y\n");
+  fprintf(out, "  sta float_a,y\n");
+  fprintf(out, "  lda float_m,y\n");
+  fprintf(out, "  sta float_b,y\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bpl add_float_swap_loop\n");
+  fprintf(out, "add_float_ordered:\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  and #0x80\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  jsr float_exponents\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne add_float_finite\n");
+  // a is inf or NaN.  inf - inf is NaN.
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  ora float_a + 1\n");
+  fprintf(out, "  ora float_a + 0\n");
+  fprintf(out, "  bne add_float_return_a\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne add_float_return_a\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  eor float_b + 3\n");
+  fprintf(out, "  bpl add_float_return_a\n");
+  fprintf(out, "  jmp float_nan\n");
+  fprintf(out, "add_float_finite:\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  bne add_float_a_normal\n");
+  // Both are 0 and the answer is only -0 if both are.
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  and float_b + 3\n");
+  fprintf(out, "  and #0x80\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  jmp float_pack_zero\n");
+  fprintf(out, "add_float_a_normal:\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bne add_float_b_normal\n");
+  fprintf(out, "add_float_return_a:\n");
+  fprintf(out, "  jmp float_push_a\n");
+  fprintf(out, "add_float_b_normal:\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  sbc float_e + 1\n");
+  fprintf(out, "  tay\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  eor float_b + 3\n");
+  fprintf(out, "  sta float_e + 1\n");
+  // Mantissas with the hidden bit at bit 31 and a byte for rounding.
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_b + 3\n");
+  fprintf(out, "  lda float_b + 1\n");
+  fprintf(out, "  sta float_b + 2\n");
+  fprintf(out, "  lda float_b + 0\n");
+  fprintf(out, "  sta float_b + 1\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  sta float_b + 0\n");
+  fprintf(out, "  sta float_x\n");
+  // Line up b with a.  Bits shifted out of b are kept as a sticky bit.
+  fprintf(out, "  cpy #32\n");
+  fprintf(out, "  bcc add_float_shift\n");
+  fprintf(out, "  sta float_b + 3\n");
+  fprintf(out, "  sta float_b + 2\n");
+  fprintf(out, "  sta float_b + 1\n");
+  fprintf(out, "  lda #1\n");
+  fprintf(out, "  sta float_b + 0\n");
+  fprintf(out, "  bne add_float_aligned\n");
+  fprintf(out, "add_float_shift:\n");
+  fprintf(out, "  cpy #0\n");
+  fprintf(out, "  beq add_float_aligned\n");
+  fprintf(out, "add_float_shift_loop:\n");
+  fprintf(out, "  lsr float_b + 3\n");
+  fprintf(out, "  ror float_b + 2\n");
+  fprintf(out, "  ror float_b + 1\n");
+  fprintf(out, "  ror float_b + 0\n");
+  fprintf(out, "  bcc add_float_shift_next\n");
+  fprintf(out, "  lda #1\n");
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "add_float_shift_next:\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bne add_float_shift_loop\n");
+  fprintf(out, "  lda float_b + 0\n");
+  fprintf(out, "  ora float_x\n");
+  fprintf(out, "  sta float_b + 0\n");
+  fprintf(out, "add_float_aligned:\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bmi add_float_subtract\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  adc float_b + 0\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  lda float_m + 1\n");
+  fprintf(out, "  adc float_b + 1\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  lda float_m + 2\n");
+  fprintf(out, "  adc float_b + 2\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  adc float_b + 3\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "  bcc add_float_pack\n");
+  // Carry out of bit 31 so shift right one keeping the sticky bit.
+  fprintf(out, "  ror float_m + 3\n");
+  fprintf(out, "  ror float_m + 2\n");
+  fprintf(out, "  ror float_m + 1\n");
+  fprintf(out, "  ror float_m + 0\n");
+  fprintf(out, "  bcc add_float_carry\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  ora #1\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "add_float_carry:\n");
+  fprintf(out, "  inc float_e + 0\n");
+  fprintf(out, "add_float_pack:\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  jmp float_pack\n");
+  fprintf(out, "add_float_subtract:\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  sbc float_b + 0\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  lda float_m + 1\n");
+  fprintf(out, "  sbc float_b + 1\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  lda float_m + 2\n");
+  fprintf(out, "  sbc float_b + 2\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  sbc float_b + 3\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "  ora float_m + 2\n");
+  fprintf(out, "  ora float_m + 1\n");
+  fprintf(out, "  ora float_m + 0\n");
+  fprintf(out, "  bne add_float_normalize_start\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  jmp float_pack_zero\n");
+  fprintf(out, "add_float_normalize_start:\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "add_float_normalize:\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  bmi add_float_pack_subtract\n");
+  fprintf(out, "  asl float_m + 0\n");
+  fprintf(out, "  rol float_m + 1\n");
+  fprintf(out, "  rol float_m + 2\n");
+  fprintf(out, "  rol float_m + 3\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  bne add_float_normalize_dec\n");
+  fprintf(out, "  dec float_e + 1\n");
+  fprintf(out, "add_float_normalize_dec:\n");
+  fprintf(out, "  dec float_e + 0\n");
+  fprintf(out, "  jmp add_float_normalize\n");
+  fprintf(out, "add_float_pack_subtract:\n");
+  fprintf(out, "  jmp float_pack\n");
+}
+
+void M6502::insert_mul_float()
+{
+  fprintf(out, "mul_float:\n");
+  fprintf(out, "  jsr float_pop_ab\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  eor float_b + 3\n");
+  fprintf(out, "  and #0x80\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  jsr float_exponents\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq mul_float_special\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq mul_float_special\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  beq mul_float_zero\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bne mul_float_normal\n");
+  fprintf(out, "mul_float_zero:\n");
+  fprintf(out, "  jmp float_pack_zero\n");
+  fprintf(out, "mul_float_special:\n");
+  // NaN if either is NaN or it's inf * 0 (a denormal counts as 0),
+  // otherwise inf.
+  fprintf(out, "  jsr float_is_nan\n");
+  fprintf(out, "  bcs mul_float_nan\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  beq mul_float_nan\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  beq mul_float_nan\n");
+  fprintf(out, "  jmp float_pack_inf\n");
+  fprintf(out, "mul_float_nan:\n");
+  fprintf(out, "  jmp float_nan\n");
+  fprintf(out, "mul_float_normal:\n");
+  // float_e = ea + eb - 127
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  adc float_e + 1\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  adc #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  sbc #127\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  sbc #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_b + 2\n");
+  // Shift and add from the low bit of b.  The top 32 bits of the 48 bit
+  // product end up in float_m and anything below that is sticky.
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "  ldy #24\n");
+  fprintf(out, "mul_float_loop:\n");
+  fprintf(out, "  lsr float_b + 2\n");
+  fprintf(out, "  ror float_b + 1\n");
+  fprintf(out, "  ror float_b + 0\n");
+  fprintf(out, "  bcc mul_float_shift\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda float_m + 1\n");
+  fprintf(out, "  adc float_a + 0\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  lda float_m + 2\n");
+  fprintf(out, "  adc float_a + 1\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  adc float_a + 2\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "mul_float_shift:\n");
+  fprintf(out, "  ror float_m + 3\n");
+  fprintf(out, "  ror float_m + 2\n");
+  fprintf(out, "  ror float_m + 1\n");
+  fprintf(out, "  ror float_m + 0\n");
+  fprintf(out, "  bcc mul_float_next\n");
+  fprintf(out, "  lda #1\n");
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "mul_float_next:\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bne mul_float_loop\n");
+  // The product's top bit is bit 31 or 30.
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  bmi mul_float_47\n");
+  fprintf(out, "  asl float_m + 0\n");
+  fprintf(out, "  rol float_m + 1\n");
+  fprintf(out, "  rol float_m + 2\n");
+  fprintf(out, "  rol float_m + 3\n");
+  fprintf(out, "  jmp mul_float_sticky\n");
+  fprintf(out, "mul_float_47:\n");
+  fprintf(out, "  inc float_e + 0\n");
+  fprintf(out, "  bne mul_float_sticky\n");
+  fprintf(out, "  inc float_e + 1\n");
+  fprintf(out, "mul_float_sticky:\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  ora float_x\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  jmp float_pack\n");
+}
+
+void M6502::insert_div_float()
+{
+  fprintf(out, "div_float:\n");
+  fprintf(out, "  jsr float_pop_ab\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  eor float_b + 3\n");
+  fprintf(out, "  and #0x80\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  jsr float_exponents\n");
+  fprintf(out, "  jsr float_is_nan\n");
+  fprintf(out, "  bcs div_float_nan\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne div_float_a_finite\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq div_float_nan\n");
+  fprintf(out, "  jmp float_pack_inf\n");
+  fprintf(out, "div_float_a_finite:\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq div_float_zero\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  bne div_float_b_normal\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  beq div_float_nan\n");
+  fprintf(out, "  jmp float_pack_inf\n");
+  fprintf(out, "div_float_nan:\n");
+  fprintf(out, "  jmp float_nan\n");
+  fprintf(out, "div_float_zero:\n");
+  fprintf(out, "  jmp float_pack_zero\n");
+  fprintf(out, "div_float_b_normal:\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  beq div_float_zero\n");
+  // float_e = ea - eb + 127
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  sbc float_e + 1\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sbc #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  adc #127\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "  lda float_e + 1\n");
+  fprintf(out, "  adc #0\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_b + 2\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  sta float_b + 3\n");
+  // If a < b shift it so the first bit of the quotient is 1.
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  cmp float_b + 2\n");
+  fprintf(out, "  bcc div_float_shift\n");
+  fprintf(out, "  bne div_float_start\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  cmp float_b + 1\n");
+  fprintf(out, "  bcc div_float_shift\n");
+  fprintf(out, "  bne div_float_start\n");
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  cmp float_b + 0\n");
+  fprintf(out, "  bcs div_float_start\n");
+  fprintf(out, "div_float_shift:\n");
+  fprintf(out, "  asl float_a + 0\n");
+  fprintf(out, "  rol float_a + 1\n");
+  fprintf(out, "  rol float_a + 2\n");
+  fprintf(out, "  rol float_a + 3\n");
+  fprintf(out, "  lda float_e + 0\n");
+  fprintf(out, "  bne div_float_dec\n");
+  fprintf(out, "  dec float_e + 1\n");
+  fprintf(out, "div_float_dec:\n");
+  fprintf(out, "  dec float_e + 0\n");
+  fprintf(out, "div_float_start:\n");
+  fprintf(out, "  ldy #32\n");
+  fprintf(out, "div_float_loop:\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  cmp float_b + 3\n");
+  fprintf(out, "  bcc div_float_next\n");
+  fprintf(out, "  bne div_float_subtract\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  cmp float_b + 2\n");
+  fprintf(out, "  bcc div_float_next\n");
+  fprintf(out, "  bne div_float_subtract\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  cmp float_b + 1\n");
+  fprintf(out, "  bcc div_float_next\n");
+  fprintf(out, "  bne div_float_subtract\n");
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  cmp float_b + 0\n");
+  fprintf(out, "  bcc div_float_next\n");
+  fprintf(out, "div_float_subtract:\n");
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  sbc float_b + 0\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  sbc float_b + 1\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  sbc float_b + 2\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  sbc float_b + 3\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "div_float_next:\n");
+  fprintf(out, "  rol float_m + 0\n");
+  fprintf(out, "  rol float_m + 1\n");
+  fprintf(out, "  rol float_m + 2\n");
+  fprintf(out, "  rol float_m + 3\n");
+  fprintf(out, "  asl float_a + 0\n");
+  fprintf(out, "  rol float_a + 1\n");
+  fprintf(out, "  rol float_a + 2\n");
+  fprintf(out, "  rol float_a + 3\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bne div_float_loop\n");
+  // Anything left over is the sticky bit.
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  ora float_a + 1\n");
+  fprintf(out, "  ora float_a + 2\n");
+  fprintf(out, "  ora float_a + 3\n");
+  fprintf(out, "  beq div_float_pack\n");
+  fprintf(out, "  lda float_m + 0\n");
+  fprintf(out, "  ora #1\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "div_float_pack:\n");
+  fprintf(out, "  jmp float_pack\n");
+}
+
+void M6502::insert_integer_to_float()
+{
+  fprintf(out, "integer_to_float:\n");
+  POP_HI();
+  fprintf(out, "  sta float_m + 3\n");
+  POP_LO();
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  sta float_e + 1\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  bpl integer_to_float_positive\n");
+  fprintf(out, "  lda #0x80\n");
+  fprintf(out, "  sta float_s\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sbc float_m + 2\n");
+  fprintf(out, "  sta float_m + 2\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sbc float_m + 3\n");
+  fprintf(out, "  sta float_m + 3\n");
+  fprintf(out, "integer_to_float_positive:\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  ora float_m + 2\n");
+  fprintf(out, "  bne integer_to_float_start\n");
+  fprintf(out, "  jmp float_pack_zero\n");
+  fprintf(out, "integer_to_float_start:\n");
+  fprintf(out, "  lda #142\n");
+  fprintf(out, "  sta float_e + 0\n");
+  fprintf(out, "integer_to_float_normalize:\n");
+  fprintf(out, "  lda float_m + 3\n");
+  fprintf(out, "  bmi integer_to_float_pack\n");
+  fprintf(out, "  asl float_m + 2\n");
+  fprintf(out, "  rol float_m + 3\n");
+  fprintf(out, "  dec float_e + 0\n");
+  fprintf(out, "  jmp integer_to_float_normalize\n");
+  fprintf(out, "integer_to_float_pack:\n");
+  fprintf(out, "  jmp float_pack\n");
+}
+
+void M6502::insert_float_to_integer()
+{
+  // Rounds toward 0.  NaN is 0 and anything that doesn't fit in 16 bits
+  // is clamped.
+  fprintf(out, "float_to_integer:\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 3\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 2\n");
+  POP_HI();
+  fprintf(out, "  sta float_a + 1\n");
+  POP_LO();
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  asl\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  rol\n");
+  fprintf(out, "  cmp #127\n");
+  fprintf(out, "  bcc float_to_integer_zero\n");
+  fprintf(out, "  cmp #142\n");
+  fprintf(out, "  bcc float_to_integer_shift\n");
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  bne float_to_integer_clamp\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  ora float_a + 1\n");
+  fprintf(out, "  ora float_a + 0\n");
+  fprintf(out, "  bne float_to_integer_zero\n");
+  fprintf(out, "float_to_integer_clamp:\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  bmi float_to_integer_min\n");
+  fprintf(out, "  lda #0xff\n");
+  PUSH_LO();
+  fprintf(out, "  lda #0x7f\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  fprintf(out, "float_to_integer_min:\n");
+  fprintf(out, "  lda #0x00\n");
+  PUSH_LO();
+  fprintf(out, "  lda #0x80\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  fprintf(out, "float_to_integer_zero:\n");
+  fprintf(out, "  lda #0\n");
+  PUSH_LO();
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  fprintf(out, "float_to_integer_shift:\n");
+  // Top 16 bits of the mantissa shifted right 142 - exponent times.
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "  lda #142\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  sbc float_x\n");
+  fprintf(out, "  tay\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  ora #0x80\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "float_to_integer_loop:\n");
+  fprintf(out, "  lsr float_m + 1\n");
+  fprintf(out, "  ror float_m + 0\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bne float_to_integer_loop\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  bpl float_to_integer_push\n");
+  fprintf(out, "  sec\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sbc float_m + 0\n");
+  fprintf(out, "  sta float_m + 0\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  sbc float_m + 1\n");
+  fprintf(out, "  sta float_m + 1\n");
+  fprintf(out, "float_to_integer_push:\n");
+  fprintf(out, "  lda float_m + 0\n");
+  PUSH_LO();
+  fprintf(out, "  lda float_m + 1\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+}
+
+void M6502::insert_compare_floats()
+{
+  // fcmpl / fcmpg: -1, 0 or 1 comparing a to b.  They only differ in what
+  // NaN gives.
+  fprintf(out, "compare_floats_g:\n");
+  fprintf(out, "  lda #1\n");
+  fprintf(out, "  bne compare_floats_start\n");
+  fprintf(out, "compare_floats_l:\n");
+  fprintf(out, "  lda #0xff\n");
+  fprintf(out, "compare_floats_start:\n");
+  fprintf(out, "  sta float_x\n");
+  fprintf(out, "  jsr float_pop_ab\n");
+  fprintf(out, "  jsr float_is_nan\n");
+  fprintf(out, "  bcc compare_floats_numbers\n");
+  fprintf(out, "  lda float_x\n");
+  fprintf(out, "  jmp compare_floats_push\n");
+  fprintf(out, "compare_floats_numbers:\n");
+  // -0 and 0 are equal.
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  ora float_b + 3\n");
+  fprintf(out, "  and #0x7f\n");
+  fprintf(out, "  ora float_a + 2\n");
+  fprintf(out, "  ora float_b + 2\n");
+  fprintf(out, "  ora float_a + 1\n");
+  fprintf(out, "  ora float_b + 1\n");
+  fprintf(out, "  ora float_a + 0\n");
+  fprintf(out, "  ora float_b + 0\n");
+  fprintf(out, "  beq compare_floats_push\n");
+  // Flip the magnitude of negative numbers and then the sign bits so it's
+  // an unsigned compare.
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  bpl compare_floats_a_positive\n");
+  fprintf(out, "  eor #0x7f\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda float_a + 2\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_a + 2\n");
+  fprintf(out, "  lda float_a + 1\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_a + 1\n");
+  fprintf(out, "  lda float_a + 0\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_a + 0\n");
+  fprintf(out, "compare_floats_a_positive:\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  bpl compare_floats_b_positive\n");
+  fprintf(out, "  eor #0x7f\n");
+  fprintf(out, "  sta float_b + 3\n");
+  fprintf(out, "  lda float_b + 2\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_b + 2\n");
+  fprintf(out, "  lda float_b + 1\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_b + 1\n");
+  fprintf(out, "  lda float_b + 0\n");
+  fprintf(out, "  eor #0xff\n");
+  fprintf(out, "  sta float_b + 0\n");
+  fprintf(out, "compare_floats_b_positive:\n");
+  fprintf(out, "  lda float_a + 3\n");
+  fprintf(out, "  eor #0x80\n");
+  fprintf(out, "  sta float_a + 3\n");
+  fprintf(out, "  lda float_b + 3\n");
+  fprintf(out, "  eor #0x80\n");
+  fprintf(out, "  sta float_b + 3\n");
+  fprintf(out, "  ldy #3\n");
+  fprintf(out, "compare_floats_loop:\n");
+  fprintf(out, "  lda float_a,y\n");
+  fprintf(out, "  cmp float_b,y\n");
+  fprintf(out, "  bcc compare_floats_less\n");
+  fprintf(out, "  bne compare_floats_greater\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bpl compare_floats_loop\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "  beq compare_floats_push\n");
+  fprintf(out, "compare_floats_less:\n");
+  fprintf(out, "  lda #0xff\n");
+  fprintf(out, "  bne compare_floats_push\n");
+  fprintf(out, "compare_floats_greater:\n");
+  fprintf(out, "  lda #1\n");
+  fprintf(out, "compare_floats_push:\n");
+  PUSH_LO();
+  fprintf(out, "  cmp #0xff\n");
+  fprintf(out, "  beq compare_floats_negative\n");
+  fprintf(out, "  lda #0\n");
+  fprintf(out, "compare_floats_negative:\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+}
+
+void M6502::insert_array_float_support()
+{
+  // new_array float, 4 bytes for each element
+  fprintf(out, "new_array_float:\n");
+  POP_HI();
+  fprintf(out, "  sta length + 1\n");
+  POP_LO();
+  fprintf(out, "  sta length + 0\n");
+  fprintf(out, "  lda heap_ptr + 0\n");
+  fprintf(out, "  sta result + 0\n");
+  fprintf(out, "  lda heap_ptr + 1\n");
+  fprintf(out, "  sta result + 1\n");
+  fprintf(out, "  lda result + 0\n");
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda result + 1\n");
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "  ldy #0\n");
+  fprintf(out, "  lda length + 0\n");
+  fprintf(out, "  sta (address),y\n");
+  fprintf(out, "  ldy #1\n");
+  fprintf(out, "  lda length + 1\n");
+  fprintf(out, "  sta (address),y\n");
+  fprintf(out, "  asl length + 0\n");
+  fprintf(out, "  rol length + 1\n");
+  fprintf(out, "  asl length + 0\n");
+  fprintf(out, "  rol length + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda length + 0\n");
+  fprintf(out, "  adc #2\n");
+  fprintf(out, "  sta length + 0\n");
+  fprintf(out, "  lda length + 1\n");
+  fprintf(out, "  adc #0\n");
+  fprintf(out, "  sta length + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda heap_ptr + 0\n");
+  fprintf(out, "  adc length + 0\n");
+  fprintf(out, "  sta heap_ptr + 0\n");
+  fprintf(out, "  lda heap_ptr + 1\n");
+  fprintf(out, "  adc length + 1\n");
+  fprintf(out, "  sta heap_ptr + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda result + 0\n");
+  fprintf(out, "  adc #3\n");
+  fprintf(out, "  sta result + 0\n");
+  fprintf(out, "  lda result + 1\n");
+  fprintf(out, "  adc #0\n");
+  fprintf(out, "  sta result + 1\n");
+  fprintf(out, "  lda result + 0\n");
+  fprintf(out, "  and #254\n");
+  fprintf(out, "  sta result + 0\n");
+  fprintf(out, "  lda result + 0\n");
+  PUSH_LO();
+  fprintf(out, "  lda result + 1\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  // array_read_float
+  fprintf(out, "array_read_float:\n");
+  POP_HI();
+  fprintf(out, "  sta result + 1\n");
+  POP_LO();
+  fprintf(out, "  sta result + 0\n");
+  POP_HI();
+  fprintf(out, "  sta address + 1\n");
+  POP_LO();
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  jmp array_read_float_index\n");
+  // array_read_float2 (address already has the array)
+  fprintf(out, "array_read_float2:\n");
+  POP_HI();
+  fprintf(out, "  sta result + 1\n");
+  POP_LO();
+  fprintf(out, "  sta result + 0\n");
+  fprintf(out, "array_read_float_index:\n");
+  fprintf(out, "  asl result + 0\n");
+  fprintf(out, "  rol result + 1\n");
+  fprintf(out, "  asl result + 0\n");
+  fprintf(out, "  rol result + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda address + 0\n");
+  fprintf(out, "  adc result + 0\n");
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda address + 1\n");
+  fprintf(out, "  adc result + 1\n");
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "  ldy #0\n");
+  fprintf(out, "  lda (address),y\n");
+  PUSH_LO();
+  fprintf(out, "  iny\n");
+  fprintf(out, "  lda (address),y\n");
+  PUSH_HI();
+  fprintf(out, "  iny\n");
+  fprintf(out, "  lda (address),y\n");
+  PUSH_LO();
+  fprintf(out, "  iny\n");
+  fprintf(out, "  lda (address),y\n");
+  PUSH_HI();
+  fprintf(out, "  rts\n");
+  // array_write_float
+  fprintf(out, "array_write_float:\n");
+  fprintf(out, "  jsr float_pop_a\n");
+  POP_HI();
+  fprintf(out, "  sta result + 1\n");
+  POP_LO();
+  fprintf(out, "  sta result + 0\n");
+  POP_HI();
+  fprintf(out, "  sta address + 1\n");
+  POP_LO();
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  jmp array_write_float_index\n");
+  // array_write_float2 (address already has the array)
+  fprintf(out, "array_write_float2:\n");
+  fprintf(out, "  jsr float_pop_a\n");
+  POP_HI();
+  fprintf(out, "  sta result + 1\n");
+  POP_LO();
+  fprintf(out, "  sta result + 0\n");
+  fprintf(out, "array_write_float_index:\n");
+  fprintf(out, "  asl result + 0\n");
+  fprintf(out, "  rol result + 1\n");
+  fprintf(out, "  asl result + 0\n");
+  fprintf(out, "  rol result + 1\n");
+  fprintf(out, "  clc\n");
+  fprintf(out, "  lda address + 0\n");
+  fprintf(out, "  adc result + 0\n");
+  fprintf(out, "  sta address + 0\n");
+  fprintf(out, "  lda address + 1\n");
+  fprintf(out, "  adc result + 1\n");
+  fprintf(out, "  sta address + 1\n");
+  fprintf(out, "  ldy #3\n");
+  fprintf(out, "array_write_float_loop:\n");
+  fprintf(out, "  lda float_a,y\n");
+  fprintf(out, "  sta (address),y\n");
+  fprintf(out, "  dey\n");
+  fprintf(out, "  bpl array_write_float_loop\n");
+  fprintf(out, "  rts\n");
+}
+
 void M6502::insert_memory_read8()
 {
   fprintf(out, "memory_read8:\n");
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "CyclesM6502.h"
 #include "M6502_8.h"
 
 // ABI is:
@@ -54,6 +55,11 @@ M6502_8::~M6502_8()
 {
 }
 
+Cycles *M6502_8::new_cycles()
+{
+  return new CyclesM6502();
+}
+
 int M6502_8::open(const char *filename)
 {
   if (Generator::open(filename) != 0) { return -1; }
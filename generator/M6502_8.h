@@ -49,6 +49,8 @@ public:
   virtual ~M6502_8();
 
   virtual int open(const char *filename);
+  virtual Cycles *new_cycles();
+  virtual int get_instruction_size() { return 2; }
   virtual int add_functions();
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
@@ -45,14 +45,17 @@ MC68000::MC68000() :
   reg(0),
   reg_max(5),
   stack(0),
-  is_main(0)
+  is_main(0),
+  need_mul_longs(0),
+  need_div_longs(0)
 {
 
 }
 
 MC68000::~MC68000()
 {
-
+  if (need_mul_longs) { insert_mul_longs(); }
+  if (need_div_longs) { insert_div_longs(); }
 }
 
 int MC68000::open(const char *filename)
@@ -150,6 +153,14 @@ int MC68000::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int MC68000::push_local_var_long(int index)
+{
+  // The low word is in index and the high word in index + 1.
+  fprintf(out, "  move.l (-%d,a6), %s\n", LOCALS(index), push_reg());
+  fprintf(out, "  move.l (-%d,a6), %s\n", LOCALS(index + 1), push_reg());
+  return 0;
+}
+
 int MC68000::push_ref_static(const char *name, int index)
 {
   fprintf(out, "  move.l #_%s, %s\n", name, push_reg());
@@ -186,12 +197,14 @@ int MC68000::push_int(int32_t n)
   return 0;
 }
 
-#if 0
 int MC68000::push_long(int64_t n)
 {
-  return -1;
+  push_int((int32_t)(n & 0xffffffff));
+  push_int((int32_t)(n >> 32));
+  return 0;
 }
 
+#if 0
 int MC68000::push_float(float f)
 {
   return -1;
@@ -221,6 +234,13 @@ int MC68000::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int MC68000::pop_local_var_long(int index)
+{
+  fprintf(out, "  move.l %s, (-%d,a6)\n", pop_reg(), LOCALS(index + 1));
+  fprintf(out, "  move.l %s, (-%d,a6)\n", pop_reg(), LOCALS(index));
+  return 0;
+}
+
 int MC68000::pop()
 {
   if (stack == 0)
@@ -260,8 +280,8 @@ int MC68000::dup()
 
 int MC68000::dup2()
 {
-  char reg1[8];
-  char reg2[8];
+  char reg1[16];
+  char reg2[16];
 
   fprintf(out, "  ;; dup2\n");
 
@@ -526,6 +546,149 @@ int MC68000::inc_integer(int index, int num)
   return 0;
 }
 
+int MC68000::add_long()
+{
+  return stack_alu_long("add", "addx");
+}
+
+int MC68000::sub_long()
+{
+  return stack_alu_long("sub", "subx");
+}
+
+int MC68000::mul_long()
+{
+  // There is only a 16x16 multiply so this is a subroutine.
+  need_mul_longs = 1;
+  return call_runtime_long("_mul_longs", false);
+}
+
+int MC68000::div_long()
+{
+  need_div_longs = 1;
+  return call_runtime_long("_div_longs", false);
+}
+
+int MC68000::mod_long()
+{
+  need_div_longs = 1;
+  return call_runtime_long("_div_longs", true);
+}
+
+int MC68000::neg_long()
+{
+  int r[2];
+  int borrowed;
+
+  borrowed = load_stack_entries(r, 2);
+
+  fprintf(out, "  neg.l d%d\n", r[0]);
+  fprintf(out, "  negx.l d%d\n", r[1]);
+
+  replace_stack_entries(2, borrowed, r[0], r[1]);
+
+  return 0;
+}
+
+int MC68000::shift_left_long()
+{
+  return stack_shift_long("lsl");
+}
+
+int MC68000::shift_left_long(int count)
+{
+  return stack_shift_long("lsl", count & 63);
+}
+
+int MC68000::shift_right_long()
+{
+  return stack_shift_long("asr");
+}
+
+int MC68000::shift_right_long(int count)
+{
+  return stack_shift_long("asr", count & 63);
+}
+
+int MC68000::shift_right_ulong()
+{
+  return stack_shift_long("lsr");
+}
+
+int MC68000::shift_right_ulong(int count)
+{
+  return stack_shift_long("lsr", count & 63);
+}
+
+int MC68000::and_long()
+{
+  return stack_alu_long("and", "and");
+}
+
+int MC68000::or_long()
+{
+  return stack_alu_long("or", "or");
+}
+
+int MC68000::xor_long()
+{
+  return stack_alu_long("eor", "eor");
+}
+
+int MC68000::integer_to_long()
+{
+  int r[1];
+  int borrowed;
+
+  borrowed = load_stack_entries(r, 1);
+
+  // Doubling puts the sign bit in X and subx of a register from itself
+  // leaves 0 - X.
+  fprintf(out, "  move.l d%d, d6\n", r[0]);
+  fprintf(out, "  add.l d6, d6\n");
+  fprintf(out, "  subx.l d6, d6\n");
+
+  replace_stack_entries(1, borrowed, r[0], 6);
+
+  return 0;
+}
+
+int MC68000::long_to_integer()
+{
+  // The low word is already where the int goes.
+  drop_stack_entries(1);
+  return 0;
+}
+
+int MC68000::compare_longs()
+{
+  int r[4];
+  int borrowed;
+
+  borrowed = load_stack_entries(r, 4);
+
+  // The high words are compared signed and only if they are equal are
+  // the low words compared, unsigned.
+  fprintf(out, "  cmp.l d%d, d%d\n", r[3], r[1]);
+  fprintf(out, "  blt.s compare_longs_%d_less\n", label_count);
+  fprintf(out, "  bgt.s compare_longs_%d_greater\n", label_count);
+  fprintf(out, "  cmp.l d%d, d%d\n", r[2], r[0]);
+  fprintf(out, "  bcs.s compare_longs_%d_less\n", label_count);
+  fprintf(out, "  bhi.s compare_longs_%d_greater\n", label_count);
+  fprintf(out, "  moveq #0, d7\n");
+  fprintf(out, "  bra.s compare_longs_%d_done\n", label_count);
+  fprintf(out, "compare_longs_%d_less:\n", label_count);
+  fprintf(out, "  moveq #-1, d7\n");
+  fprintf(out, "  bra.s compare_longs_%d_done\n", label_count);
+  fprintf(out, "compare_longs_%d_greater:\n", label_count);
+  fprintf(out, "  moveq #1, d7\n");
+  fprintf(out, "compare_longs_%d_done:\n", label_count++);
+
+  replace_stack_entries(4, borrowed, 7, -1);
+
+  return 0;
+}
+
 int MC68000::integer_to_byte()
 {
   fprintf(out, "  ext.w %s\n", top_reg());
@@ -611,6 +774,17 @@ int MC68000::return_void(int local_count)
   return 0;
 }
 
+int MC68000::return_long(int local_count)
+{
+  // Longs come back with the high word in d6 and the low word in d7.
+  fprintf(out, "  move.l %s, d6\n", pop_reg());
+  fprintf(out, "  move.l %s, d7\n", pop_reg());
+
+  if (local_count != 0) { fprintf(out, "  unlk a6\n"); }
+  fprintf(out, "  rts\n");
+  return 0;
+}
+
 int MC68000::jump(const char *name, int distance)
 {
   char size = get_jump_size(distance);
@@ -639,7 +813,7 @@ int MC68000::invoke_static_method(const char *name, int params, int is_void)
 
   // Push all used registers on the stack except the ones that are pulled
   // out for parameters.
-  saved_registers = reg - (params - stack);
+  saved_registers = params > stack ? reg - (params - stack) : reg;
   for (n = 0; n < saved_registers; n++)
   {
     fprintf(out, "  move.l d%d, -(SP)\n", REG_STACK(n));
@@ -657,7 +831,7 @@ int MC68000::invoke_static_method(const char *name, int params, int is_void)
   {
     if (stack_vars > 0)
     {
-      fprintf(out, "  move.l (%d,SP), (%d,SP)\n", (stack-stack_vars) * 4, local-8);
+      fprintf(out, "  move.l (%d,SP), (%d,SP)\n", (stack - stack_vars + saved_registers) * 4, local-8);
       stack_vars--;
     }
       else
@@ -684,8 +858,9 @@ int MC68000::invoke_static_method(const char *name, int params, int is_void)
   // Pop all params off the Java stack
   if ((stack - stack_vars) > 0)
   {
-    fprintf(out, "  sub.l #%d, SP\n", (stack - stack_vars) * 4);
+    fprintf(out, "  lea (%d,SP), SP\n", (stack - stack_vars) * 4);
     params -= (stack - stack_vars);
+    stack = stack_vars;
   }
 
   if (params != 0)
@@ -702,6 +877,16 @@ int MC68000::invoke_static_method(const char *name, int params, int is_void)
   return 0;
 }
 
+int MC68000::invoke_static_method_long(const char *name, int params)
+{
+  if (invoke_static_method(name, params, 1) != 0) { return -1; }
+
+  push_value(7);
+  push_value(6);
+
+  return 0;
+}
+
 int MC68000::put_static(const char *name, int index)
 {
   fprintf(out, "  move.l %s, %s\n", pop_reg(), name);
@@ -1126,6 +1311,34 @@ const char *MC68000::pop_reg()
   return reg_string;
 }
 
+int MC68000::fixed_mul8_II()
+{
+  int value1, value2;
+
+  get_values_from_stack(&value1, &value2);
+
+  // Q8.8 numbers are 16 bit so muls.w gives the whole product.
+  fprintf(out, "  muls.w d%d, d%d\n", value1, value2);
+  fprintf(out, "  asr.l #8, d%d\n", value2);
+  push_value(value2);
+
+  return 0;
+}
+
+int MC68000::fixed_div8_II()
+{
+  int value1, value2;
+
+  get_values_from_stack(&value1, &value2);
+
+  fprintf(out, "  asl.l #8, d%d\n", value2);
+  fprintf(out, "  divs.w d%d, d%d\n", value1, value2);
+  fprintf(out, "  ext.l d%d\n", value2);
+  push_value(value2);
+
+  return 0;
+}
+
 const char *MC68000::push_reg()
 {
   if (reg < reg_max)
@@ -1142,6 +1355,20 @@ const char *MC68000::push_reg()
   return reg_string;
 }
 
+void MC68000::push_value(int value)
+{
+  char value_reg[16];
+  const char *dst;
+
+  sprintf(value_reg, "d%d", value);
+  dst = push_reg();
+
+  if (strcmp(value_reg, dst) != 0)
+  {
+    fprintf(out, "  move.l %s, %s\n", value_reg, dst);
+  }
+}
+
 const char *MC68000::top_reg()
 {
   if (stack > 0)
@@ -1291,4 +1518,350 @@ int MC68000::get_jump_size(int distance)
   return 'l';
 }
 
+int MC68000::stack_alu_long(const char *instr_lo, const char *instr_hi)
+{
+  int r[4];
+  int borrowed;
+
+  borrowed = load_stack_entries(r, 4);
+
+  fprintf(out, "  %s.l d%d, d%d\n", instr_lo, r[2], r[0]);
+  fprintf(out, "  %s.l d%d, d%d\n", instr_hi, r[3], r[1]);
+
+  replace_stack_entries(4, borrowed, r[0], r[1]);
+
+  return 0;
+}
+
+int MC68000::stack_shift_long(const char *instr)
+{
+  int r[3];
+  int borrowed;
+  bool is_left = strcmp(instr, "lsl") == 0;
+
+  borrowed = load_stack_entries(r, 3);
+
+  // One bit at a time through X.  dbra stops at -1 so it starts at the
+  // bottom of the loop to shift count times.
+  fprintf(out, "  and.w #63, d%d\n", r[2]);
+  fprintf(out, "  bra.s shift_long_%d_next\n", label_count);
+  fprintf(out, "shift_long_%d:\n", label_count);
+
+  if (is_left)
+  {
+    fprintf(out, "  lsl.l #1, d%d\n", r[0]);
+    fprintf(out, "  roxl.l #1, d%d\n", r[1]);
+  }
+    else
+  {
+    fprintf(out, "  %s.l #1, d%d\n", instr, r[1]);
+    fprintf(out, "  roxr.l #1, d%d\n", r[0]);
+  }
+
+  fprintf(out, "shift_long_%d_next:\n", label_count);
+  fprintf(out, "  dbra d%d, shift_long_%d\n", r[2], label_count++);
+
+  replace_stack_entries(3, borrowed, r[0], r[1]);
+
+  return 0;
+}
+
+int MC68000::stack_shift_long(const char *instr, int count)
+{
+  int r[2];
+  int borrowed;
+  bool is_left = strcmp(instr, "lsl") == 0;
+  int from, to;
+
+  if (count == 0) { return 0; }
+
+  borrowed = load_stack_entries(r, 2);
+
+  // Bits move from the low word to the high word on a left shift and
+  // the other way on a right shift.
+  from = is_left ? r[0] : r[1];
+  to = is_left ? r[1] : r[0];
+
+  if (count < 32)
+  {
+    fprintf(out, "  moveq #%d, d5\n", count);
+    fprintf(out, "  %s.l d5, d%d\n", is_left ? "lsl" : "lsr", to);
+    fprintf(out, "  move.l d%d, d7\n", from);
+    fprintf(out, "  moveq #%d, d5\n", 32 - count);
+    fprintf(out, "  %s.l d5, d7\n", is_left ? "lsr" : "lsl");
+    fprintf(out, "  or.l d7, d%d\n", to);
+    fprintf(out, "  moveq #%d, d5\n", count);
+    fprintf(out, "  %s.l d5, d%d\n", instr, from);
+  }
+    else
+  {
+    fprintf(out, "  move.l d%d, d%d\n", from, to);
+
+    if (count != 32)
+    {
+      fprintf(out, "  moveq #%d, d5\n", count - 32);
+      fprintf(out, "  %s.l d5, d%d\n", instr, to);
+    }
+
+    if (strcmp(instr, "asr") == 0)
+    {
+      fprintf(out, "  add.l d%d, d%d\n", from, from);
+      fprintf(out, "  subx.l d%d, d%d\n", from, from);
+    }
+      else
+    {
+      fprintf(out, "  moveq #0, d%d\n", from);
+    }
+  }
+
+  replace_stack_entries(2, borrowed, r[0], r[1]);
+
+  return 0;
+}
+
+int MC68000::call_runtime_long(const char *name, bool is_second_operand)
+{
+  int depth;
+  int pushed = 0;
 
+  // The runtime works on a copy of the two longs on the stack, first
+  // operand low word deepest.  It leaves its result in the slots of the
+  // first operand (and the remainder in the second for _div_longs).
+  for (depth = 3; depth >= 0; depth--)
+  {
+    if (depth < stack)
+    {
+      fprintf(out, "  move.l (%d,SP), -(SP)\n", (depth + pushed) * 4);
+    }
+      else
+    {
+      fprintf(out, "  move.l d%d, -(SP)\n", REG_STACK(reg - 1 - (depth - stack)));
+    }
+
+    pushed++;
+  }
+
+  fprintf(out, "  jsr %s\n", name);
+  fprintf(out, "  move.l (%d,SP), d5\n", is_second_operand ? 4 : 12);
+  fprintf(out, "  move.l (%d,SP), d6\n", is_second_operand ? 0 : 8);
+  fprintf(out, "  lea (16,SP), SP\n");
+
+  drop_stack_entries(4);
+  push_value(5);
+  push_value(6);
+
+  return 0;
+}
+
+int MC68000::load_stack_entries(int *r, int count)
+{
+  int borrowed = stack < count ? stack : count;
+  int n;
+
+  // Puts the top count entries of the stack in registers, deepest first.
+  // Anything spilled means d0 to d4 are all in use, so the entries that
+  // are in registers are at the top end and d0 up can be saved and used
+  // for the spilled ones.
+  if (borrowed == 1)
+  {
+    fprintf(out, "  move.l d0, -(SP)\n");
+  }
+    else
+  if (borrowed > 1)
+  {
+    fprintf(out, "  movem.l d0-d%d, -(SP)\n", borrowed - 1);
+  }
+
+  for (n = 0; n < count; n++)
+  {
+    int depth = count - 1 - n;
+
+    if (depth < stack)
+    {
+      fprintf(out, "  move.l (%d,SP), d%d\n", (depth + borrowed) * 4, depth);
+      r[n] = depth;
+    }
+      else
+    {
+      r[n] = REG_STACK(reg - 1 - (depth - stack));
+    }
+  }
+
+  return borrowed;
+}
+
+void MC68000::replace_stack_entries(int count, int borrowed, int lo, int hi)
+{
+  // Replaces the count entries from load_stack_entries() with the
+  // result in lo (and hi for a long).  A result in borrowed registers
+  // goes through d5 / d6 while they are restored.
+  if (borrowed != 0)
+  {
+    if (lo != -1 && lo != 5) { fprintf(out, "  move.l d%d, d5\n", lo); }
+    if (hi != -1 && hi != 6) { fprintf(out, "  move.l d%d, d6\n", hi); }
+
+    if (borrowed == 1)
+    {
+      fprintf(out, "  move.l (SP)+, d0\n");
+    }
+      else
+    {
+      fprintf(out, "  movem.l (SP)+, d0-d%d\n", borrowed - 1);
+    }
+
+    if (lo != -1) { lo = 5; }
+    if (hi != -1) { hi = 6; }
+  }
+
+  drop_stack_entries(count);
+
+  if (lo != -1) { push_value(lo); }
+  if (hi != -1) { push_value(hi); }
+}
+
+void MC68000::drop_stack_entries(int count)
+{
+  // Spilled entries are always the top of the stack.
+  int spilled = count < stack ? count : stack;
+
+  if (spilled != 0)
+  {
+    fprintf(out, "  lea (%d,SP), SP\n", spilled * 4);
+    stack -= spilled;
+  }
+
+  reg -= count - spilled;
+}
+
+void MC68000::insert_mul_longs()
+{
+  // 64 bit multiply out of 16x16 mulu.w.  On entry the second operand is
+  // at (4,SP) (high word first) and the first at (12,SP).  The low 64
+  // bits of the product replace the first operand.
+  fprintf(out, "_mul_longs:\n");
+  fprintf(out, "  movem.l d0-d7, -(SP)\n");
+  fprintf(out, "  move.l (48,SP), d0\n");
+  fprintf(out, "  move.l (44,SP), d1\n");
+  fprintf(out, "  move.l (40,SP), d2\n");
+  fprintf(out, "  move.l (36,SP), d3\n");
+  // d4 = low 32 bits of a_lo * b_hi + a_hi * b_lo.  Those only add to
+  // the high word.
+  fprintf(out, "  move.l d0, d4\n");
+  fprintf(out, "  mulu.w d3, d4\n");
+  fprintf(out, "  move.l d0, d5\n");
+  fprintf(out, "  swap d5\n");
+  fprintf(out, "  mulu.w d3, d5\n");
+  fprintf(out, "  move.l d3, d6\n");
+  fprintf(out, "  swap d6\n");
+  fprintf(out, "  mulu.w d0, d6\n");
+  fprintf(out, "  add.w d6, d5\n");
+  fprintf(out, "  swap d5\n");
+  fprintf(out, "  clr.w d5\n");
+  fprintf(out, "  add.l d5, d4\n");
+  fprintf(out, "  move.l d1, d5\n");
+  fprintf(out, "  mulu.w d2, d5\n");
+  fprintf(out, "  move.l d1, d6\n");
+  fprintf(out, "  swap d6\n");
+  fprintf(out, "  mulu.w d2, d6\n");
+  fprintf(out, "  move.l d2, d7\n");
+  fprintf(out, "  swap d7\n");
+  fprintf(out, "  mulu.w d1, d7\n");
+  fprintf(out, "  add.w d7, d6\n");
+  fprintf(out, "  swap d6\n");
+  fprintf(out, "  clr.w d6\n");
+  fprintf(out, "  add.l d6, d5\n");
+  fprintf(out, "  add.l d5, d4\n");
+  // d1:d5 = a_lo * b_lo from the four 16 bit partial products.
+  fprintf(out, "  move.l d0, d5\n");
+  fprintf(out, "  mulu.w d2, d5\n");
+  fprintf(out, "  move.l d0, d6\n");
+  fprintf(out, "  swap d6\n");
+  fprintf(out, "  mulu.w d2, d6\n");
+  fprintf(out, "  move.l d2, d7\n");
+  fprintf(out, "  swap d7\n");
+  fprintf(out, "  mulu.w d0, d7\n");
+  fprintf(out, "  move.l d0, d1\n");
+  fprintf(out, "  swap d1\n");
+  fprintf(out, "  move.l d2, d3\n");
+  fprintf(out, "  swap d3\n");
+  fprintf(out, "  mulu.w d3, d1\n");
+  fprintf(out, "  add.l d7, d6\n");
+  fprintf(out, "  bcc.s _mul_longs_no_carry\n");
+  fprintf(out, "  add.l #0x10000, d1\n");
+  fprintf(out, "_mul_longs_no_carry:\n");
+  fprintf(out, "  move.l d6, d7\n");
+  fprintf(out, "  swap d7\n");
+  fprintf(out, "  clr.w d7\n");
+  fprintf(out, "  clr.w d6\n");
+  fprintf(out, "  swap d6\n");
+  fprintf(out, "  add.l d7, d5\n");
+  fprintf(out, "  addx.l d6, d1\n");
+  fprintf(out, "  add.l d4, d1\n");
+  fprintf(out, "  move.l d5, (48,SP)\n");
+  fprintf(out, "  move.l d1, (44,SP)\n");
+  fprintf(out, "  movem.l (SP)+, d0-d7\n");
+  fprintf(out, "  rts\n\n");
+}
+
+void MC68000::insert_div_longs()
+{
+  // Signed 64 bit divide.  On entry the divisor is at (4,SP) (high word
+  // first) and the dividend at (12,SP).  They're replaced with the
+  // remainder and the quotient.  d6 bit 0 is set if the quotient is
+  // negative, bit 1 if the remainder is.
+  fprintf(out, "_div_longs:\n");
+  fprintf(out, "  movem.l d0-d7, -(SP)\n");
+  fprintf(out, "  move.l (48,SP), d0\n");
+  fprintf(out, "  move.l (44,SP), d1\n");
+  fprintf(out, "  move.l (40,SP), d2\n");
+  fprintf(out, "  move.l (36,SP), d3\n");
+  fprintf(out, "  moveq #0, d6\n");
+  fprintf(out, "  tst.l d1\n");
+  fprintf(out, "  bpl.s _div_longs_dividend_pos\n");
+  fprintf(out, "  neg.l d0\n");
+  fprintf(out, "  negx.l d1\n");
+  fprintf(out, "  eori.w #3, d6\n");
+  fprintf(out, "_div_longs_dividend_pos:\n");
+  fprintf(out, "  tst.l d3\n");
+  fprintf(out, "  bpl.s _div_longs_divisor_pos\n");
+  fprintf(out, "  neg.l d2\n");
+  fprintf(out, "  negx.l d3\n");
+  fprintf(out, "  eori.w #1, d6\n");
+  fprintf(out, "_div_longs_divisor_pos:\n");
+  // Shift and subtract, putting the subtraction back if it borrowed.
+  // d1:d0 becomes the quotient and d5:d4 the remainder.
+  fprintf(out, "  moveq #0, d4\n");
+  fprintf(out, "  moveq #0, d5\n");
+  fprintf(out, "  moveq #63, d7\n");
+  fprintf(out, "_div_longs_loop:\n");
+  fprintf(out, "  add.l d0, d0\n");
+  fprintf(out, "  addx.l d1, d1\n");
+  fprintf(out, "  addx.l d4, d4\n");
+  fprintf(out, "  addx.l d5, d5\n");
+  fprintf(out, "  sub.l d2, d4\n");
+  fprintf(out, "  subx.l d3, d5\n");
+  fprintf(out, "  bcs.s _div_longs_restore\n");
+  fprintf(out, "  addq.l #1, d0\n");
+  fprintf(out, "  bra.s _div_longs_next\n");
+  fprintf(out, "_div_longs_restore:\n");
+  fprintf(out, "  add.l d2, d4\n");
+  fprintf(out, "  addx.l d3, d5\n");
+  fprintf(out, "_div_longs_next:\n");
+  fprintf(out, "  dbra d7, _div_longs_loop\n");
+  fprintf(out, "  btst #0, d6\n");
+  fprintf(out, "  beq.s _div_longs_quotient_pos\n");
+  fprintf(out, "  neg.l d0\n");
+  fprintf(out, "  negx.l d1\n");
+  fprintf(out, "_div_longs_quotient_pos:\n");
+  fprintf(out, "  btst #1, d6\n");
+  fprintf(out, "  beq.s _div_longs_remainder_pos\n");
+  fprintf(out, "  neg.l d4\n");
+  fprintf(out, "  negx.l d5\n");
+  fprintf(out, "_div_longs_remainder_pos:\n");
+  fprintf(out, "  move.l d0, (48,SP)\n");
+  fprintf(out, "  move.l d1, (44,SP)\n");
+  fprintf(out, "  move.l d4, (40,SP)\n");
+  fprintf(out, "  move.l d5, (36,SP)\n");
+  fprintf(out, "  movem.l (SP)+, d0-d7\n");
+  fprintf(out, "  rts\n\n");
+}
@@ -21,6 +21,7 @@ public:
   virtual ~MC68000();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -30,14 +31,17 @@ public:
   virtual void method_end(int local_count);
   virtual int push_local_var_int(int index);
   virtual int push_local_var_ref(int index);
+  virtual int push_local_var_long(int index);
   virtual int push_ref_static(const char *name, int index);
+  virtual int get_spilled() { return stack; }
   virtual int push_int(int32_t n);
-  //virtual int push_long(int64_t n);
+  virtual int push_long(int64_t n);
   //virtual int push_float(float f);
   //virtual int push_double(double f);
   virtual int push_ref(char *name);
   virtual int pop_local_var_int(int index);
   virtual int pop_local_var_ref(int index);
+  virtual int pop_local_var_long(int index);
   virtual int push_fake();
   virtual int pop();
   virtual int dup();
@@ -67,6 +71,24 @@ public:
   virtual int xor_integer();
   virtual int xor_integer(int num);
   virtual int inc_integer(int index, int num);
+  virtual int add_long();
+  virtual int sub_long();
+  virtual int mul_long();
+  virtual int div_long();
+  virtual int mod_long();
+  virtual int neg_long();
+  virtual int shift_left_long();
+  virtual int shift_left_long(int count);
+  virtual int shift_right_long();
+  virtual int shift_right_long(int count);
+  virtual int shift_right_ulong();
+  virtual int shift_right_ulong(int count);
+  virtual int and_long();
+  virtual int or_long();
+  virtual int xor_long();
+  virtual int integer_to_long();
+  virtual int long_to_integer();
+  virtual int compare_longs();
   virtual int integer_to_byte();
   virtual int integer_to_short();
   virtual int jump_cond(const char *label, int cond, int distance);
@@ -76,9 +98,11 @@ public:
   virtual int return_local(int index, int local_count);
   virtual int return_integer(int local_count);
   virtual int return_void(int local_count);
+  virtual int return_long(int local_count);
   virtual int jump(const char *name, int distance);
   virtual int call(const char *name);
   virtual int invoke_static_method(const char *name, int params, int is_void);
+  virtual int invoke_static_method_long(const char *name, int params);
   virtual int put_static(const char *name, int index);
   virtual int get_static(const char *name, int index);
   virtual int brk();
@@ -106,24 +130,40 @@ public:
   virtual int memory_allocStackShorts_I();
   virtual int memory_allocStackInts_I();
 
+  // Fixed point functions
+  virtual int fixed_mul8_II();
+  virtual int fixed_div8_II();
+
 protected:
   const char *pop_reg();
   const char *push_reg();
   const char *top_reg();
+  void push_value(int value);
   int stack_alu(const char *instr, const char *size = "l");
   int get_values_from_stack(int *value1, int *value2, int *value3);
   int get_values_from_stack(int *value1, int *value2);
   int get_values_from_stack(int *value1);
   int get_ref_from_stack();
   int get_jump_size(int distance);
+  int stack_alu_long(const char *instr_lo, const char *instr_hi);
+  int stack_shift_long(const char *instr);
+  int stack_shift_long(const char *instr, int count);
+  int call_runtime_long(const char *name, bool is_second_operand);
+  int load_stack_entries(int *r, int count);
+  void replace_stack_entries(int count, int borrowed, int lo, int hi);
+  void drop_stack_entries(int count);
+  void insert_mul_longs();
+  void insert_div_longs();
 
   uint32_t ram_start;
   uint32_t stack_start;
-  char reg_string[8];
+  char reg_string[16];
   int reg;            // count number of registers are are using as stack
   int reg_max;        // size of register stack 
   int stack;          // count how many things we put on the stack
   bool is_main : 1;
+  bool need_mul_longs : 1;
+  bool need_div_longs : 1;
 };
 
 #endif
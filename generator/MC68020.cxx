@@ -129,5 +129,37 @@ int MC68020::mod_integer(int num)
   return 0;
 }
 
+int MC68020::fixed_mul16_II()
+{
+  int value1, value2;
+
+  get_values_from_stack(&value1, &value2);
+
+  // 64 bit product in d5:dn, the answer is the middle 32 bits.
+  fprintf(out, "  muls.l d%d, d5:d%d\n", value1, value2);
+  fprintf(out, "  swap d%d\n", value2);
+  fprintf(out, "  swap d5\n");
+  fprintf(out, "  move.w d%d, d5\n", value2);
+  push_value(5);
+
+  return 0;
+}
 
+int MC68020::fixed_div16_II()
+{
+  int value1, value2;
+
+  get_values_from_stack(&value1, &value2);
+
+  // Divide the 64 bit d5:dn = a << 16.
+  fprintf(out, "  move.l d%d, d5\n", value2);
+  fprintf(out, "  swap d5\n");
+  fprintf(out, "  ext.l d5\n");
+  fprintf(out, "  swap d%d\n", value2);
+  fprintf(out, "  clr.w d%d\n", value2);
+  fprintf(out, "  divs.l d%d, d5:d%d\n", value1, value2);
+  push_value(value2);
+
+  return 0;
+}
 
@@ -29,6 +29,10 @@ public:
   virtual int div_integer(int num);
   virtual int mod_integer();
   virtual int mod_integer(int num);
+
+  // Fixed point functions
+  virtual int fixed_mul16_II();
+  virtual int fixed_div16_II();
 };
 
 #endif
@@ -23,6 +23,7 @@ public:
   virtual ~MCS51();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 2; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
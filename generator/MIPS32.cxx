@@ -14,11 +14,18 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "CyclesMIPS32.h"
+#include "EncoderMIPS32.h"
 #include "MIPS32.h"
 
 #define REG_STACK(a) (a)
 #define LOCALS(i) (-(i * 4))
 
+static const char *stack_regs[] =
+{
+  "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7"
+};
+
 // ABI is:
 // r0  $zero Always 0
 // r1  $at Reserved for pseudo instructions?
@@ -38,7 +45,7 @@
 // r15 $t7 Top Of Stack
 // r16 $s0 Saved registers 0  (point to constant pool)
 // r17 $s1 Saved registers 1  (point to statics)
-// r18 $s2 Saved registers 2
+// r18 $s2 Saved registers 2  (locals picked by the register allocator)
 // r19 $s3 Saved registers 3
 // r20 $s4 Saved registers 4
 // r21 $s5 Saved registers 5
@@ -72,13 +79,34 @@ MIPS32::MIPS32() :
   ram_end(0),
   virtual_address(0),
   physical_address(0),
-  is_main(0)
+  saved_regs(0),
+  is_main(0),
+  need_div_longs(0),
+  need_float_add(0),
+  need_float_mul(0),
+  need_float_div(0),
+  need_int_to_float(0),
+  need_float_to_int(0),
+  need_float_compare(0)
 {
-
+  memset(local_reg, -1, sizeof(local_reg));
 }
 
 MIPS32::~MIPS32()
 {
+  if (need_div_longs) { insert_div_longs(); }
+  if (need_float_add) { insert_float_add(); }
+  if (need_float_mul) { insert_float_mul(); }
+  if (need_float_div) { insert_float_div(); }
+  if (need_int_to_float) { insert_int_to_float(); }
+  if (need_float_to_int) { insert_float_to_int(); }
+  if (need_float_compare) { insert_float_compare(); }
+
+  if (need_float_add || need_float_mul || need_float_div || need_int_to_float)
+  {
+    insert_float_pack();
+  }
+
   fprintf(out, ".align 32\n");
   insert_constants_pool();
 }
@@ -99,6 +127,16 @@ int MIPS32::open(const char *filename)
   return 0;
 }
 
+Encoder *MIPS32::new_encoder()
+{
+  return new EncoderMIPS32();
+}
+
+Cycles *MIPS32::new_cycles()
+{
+  return new CyclesMIPS32();
+}
+
 int MIPS32::start_init()
 {
   // Add any set up items (stack, registers, etc).
@@ -181,14 +219,51 @@ int MIPS32::field_init_ref(char *name, int index)
   return 0;
 }
 
+void MIPS32::set_local_registers(const int *local_regs, int local_count)
+{
+  int n;
+
+  memset(local_reg, -1, sizeof(local_reg));
+  saved_regs = 0;
+
+  for (n = 0; n < local_count && n < (int)sizeof(local_reg); n++)
+  {
+    if (local_regs[n] < 0 || local_regs[n] >= get_local_register_count())
+    {
+      continue;
+    }
+
+    local_reg[n] = local_regs[n];
+
+    if (local_regs[n] + 1 > saved_regs) { saved_regs = local_regs[n] + 1; }
+  }
+}
+
 void MIPS32::method_start(int local_count, int max_stack, int param_count, const char *name)
 {
+  int n;
+
   is_main = (strcmp(name, "main") == 0) ? 1 : 0;
 
   fprintf(out, "%s:\n", name);
   fprintf(out, "  ; %s(local_count=%d, max_stack=%d, param_count=%d)\n", name, local_count, max_stack, param_count);
   fprintf(out, "  addiu $fp, $sp, -4\n");
-  fprintf(out, "  addiu $sp, $sp, -%d\n", (local_count * 4) + 4);
+  fprintf(out, "  addiu $sp, $sp, -%d\n", ((local_count + saved_regs) * 4) + 4);
+
+  // $s registers are callee saved, they go in the frame after the locals.
+  for (n = 0; n < saved_regs; n++)
+  {
+    int index = local_count + n;
+    fprintf(out, "  sw $s%d, %d($fp)\n", n + 2, LOCALS(index));
+  }
+
+  // Parameters are passed in the frame.
+  for (n = 0; n < param_count && n < local_count; n++)
+  {
+    if (get_local_reg(n) == -1) { continue; }
+
+    fprintf(out, "  lw $s%d, %d($fp) ; local_%d\n", get_local_reg(n), LOCALS(n), n);
+  }
 }
 
 void MIPS32::method_end(int local_count)
@@ -204,6 +279,25 @@ void MIPS32::method_end(int local_count)
 
 int MIPS32::push_local_var_int(int index)
 {
+  int local = get_local_reg(index);
+
+  if (local != -1)
+  {
+    if (reg < reg_max)
+    {
+      fprintf(out, "  move $t%d, $s%d ; local_%d\n", reg, local, index);
+      reg++;
+    }
+      else
+    {
+      fprintf(out, "  addi $sp, $sp, -4\n");
+      fprintf(out, "  sw $s%d, 0($sp) ; local_%d\n", local, index);
+      stack++;
+    }
+
+    return 0;
+  }
+
   if (reg < 8)
   {
     fprintf(out, "  lw $t%d, %d($fp) ; local_%d\n", reg, LOCALS(index), index);
@@ -223,6 +317,22 @@ int MIPS32::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int MIPS32::push_local_var_long(int index)
+{
+  fprintf(out, "  ; push_local_var_long(%d)\n", index);
+
+  // Low word first so the high word ends up on top.
+  push_local_var_int(index);
+  push_local_var_int(index + 1);
+
+  return 0;
+}
+
+int MIPS32::push_local_var_float(int index)
+{
+  return push_local_var_int(index);
+}
+
 int MIPS32::push_ref_static(const char *name, int index)
 {
   if (reg < reg_max)
@@ -315,17 +425,26 @@ int MIPS32::push_int(int32_t n)
   return 0;
 }
 
-#if 0
 int MIPS32::push_long(int64_t n)
 {
-  return -1;
+  fprintf(out, "  ; push_long(%lld)\n", (long long)n);
+
+  push_int((int32_t)(n & 0xffffffff));
+  push_int((int32_t)(n >> 32));
+
+  return 0;
 }
 
 int MIPS32::push_float(float f)
 {
-  return -1;
+  uint32_t *data = (uint32_t *)&f;
+
+  fprintf(out, "  ; push_float(%f)\n", f);
+
+  return push_int((int32_t)*data);
 }
 
+#if 0
 int MIPS32::push_double(double f)
 {
   return -1;
@@ -353,6 +472,25 @@ int MIPS32::push_ref(char *name)
 
 int MIPS32::pop_local_var_int(int index)
 {
+  int local = get_local_reg(index);
+
+  if (local != -1)
+  {
+    if (stack > 0)
+    {
+      fprintf(out, "  lw $s%d, 0($sp) ; local_%d\n", local, index);
+      fprintf(out, "  addi $sp, $sp, 4\n");
+      stack--;
+    }
+      else
+    {
+      fprintf(out, "  move $s%d, $t%d ; local_%d\n", local, reg - 1, index);
+      reg--;
+    }
+
+    return 0;
+  }
+
   if (stack > 0)
   {
     STACK_POP(8); 
@@ -372,6 +510,21 @@ int MIPS32::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int MIPS32::pop_local_var_long(int index)
+{
+  fprintf(out, "  ; pop_local_var_long(%d)\n", index);
+
+  pop_local_var_int(index + 1);
+  pop_local_var_int(index);
+
+  return 0;
+}
+
+int MIPS32::pop_local_var_float(int index)
+{
+  return pop_local_var_int(index);
+}
+
 int MIPS32::pop()
 {
   fprintf(out, "  ; pop()\n");
@@ -566,7 +719,7 @@ int MIPS32::neg_integer()
 
 int MIPS32::shift_left_integer()
 {
-  return stack_alu("sll");
+  return stack_alu("sllv");
   return 0;
 }
 
@@ -590,7 +743,7 @@ int MIPS32::shift_left_integer(int num)
 
 int MIPS32::shift_right_integer()
 {
-  return stack_alu("sra");
+  return stack_alu("srav");
   return 0;
 }
 
@@ -614,7 +767,7 @@ int MIPS32::shift_right_integer(int num)
 
 int MIPS32::shift_right_uinteger()
 {
-  return stack_alu("srl");
+  return stack_alu("srlv");
   return 0;
 }
 
@@ -677,7 +830,16 @@ int MIPS32::xor_integer(int num)
 
 int MIPS32::inc_integer(int index, int num)
 {
+  int local = get_local_reg(index);
+
   fprintf(out, "  ; inc_integer(local_%d,%d)\n", index, num);
+
+  if (local != -1)
+  {
+    fprintf(out, "  addiu $s%d, $s%d, %d\n", local, local, num);
+    return 0;
+  }
+
   fprintf(out, "  lw $t8, %d($fp)\n", LOCALS(index));
   fprintf(out, "  addiu $t8, $t8, %d\n", num);
   fprintf(out, "  sw $t8, %d($fp)\n", LOCALS(index));
@@ -717,516 +879,1030 @@ int MIPS32::integer_to_short()
   return 0;
 }
 
-int MIPS32::jump_cond(const char *label, int cond, int distance)
+int MIPS32::add_long()
 {
-  fprintf(out, "  ; jump_cond(%s, %d, %d)\n", label, cond, distance);
+  const char *lo1, *hi1, *lo2, *hi2;
 
-  switch(cond)
-  {
-    case COND_EQUAL:
-      fprintf(out, "  beq $t%d, $0, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    case COND_NOT_EQUAL:
-      fprintf(out, "  bne $t%d, $0, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    case COND_LESS:
-      fprintf(out, "  bltz $t%d, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    case COND_LESS_EQUAL:
-      fprintf(out, "  blez $t%d, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    case COND_GREATER:
-      fprintf(out, "  bgtz $t%d, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    case COND_GREATER_EQUAL:
-      fprintf(out, "  bgez $t%d, %s\n", --reg, label);
-      fprintf(out, "  nop\n");
-      return 0;
-    default:
-      break;
-  }
+  fprintf(out, "  ; add_long()\n");
 
-  return -1;
+  hi2 = pop_word("$a3");
+  lo2 = pop_word("$a2");
+  hi1 = pop_word("$a1");
+  lo1 = pop_word("$a0");
+
+  // Carry out of the low word is set if the sum is less than an operand.
+  fprintf(out, "  addu %s, %s, %s\n", lo1, lo1, lo2);
+  fprintf(out, "  sltu $t8, %s, %s\n", lo1, lo2);
+  fprintf(out, "  addu %s, %s, %s\n", hi1, hi1, hi2);
+  fprintf(out, "  addu %s, %s, $t8\n", hi1, hi1);
+
+  push_word(lo1);
+  push_word(hi1);
+
+  return 0;
 }
 
-int MIPS32::jump_cond_integer(const char *label, int cond, int distance)
+int MIPS32::sub_long()
 {
-  fprintf(out, "  ; jump_cond_integer(%s, %d, %d)\n", label, cond, distance);
+  const char *lo1, *hi1, *lo2, *hi2;
 
-  // I think this should never happen
-  if (stack != 0)
-  {
-    printf("Internal Error: Stack not empty\n");
-    return -1;
-  }
+  fprintf(out, "  ; sub_long()\n");
 
-  switch(cond)
-  {
-    case COND_EQUAL:
-      fprintf(out, "  beq $t%d, $t%d, %s\n", reg - 2, reg - 1, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    case COND_NOT_EQUAL:
-      fprintf(out, "  bne $t%d, $t%d, %s\n", reg - 2, reg - 1, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    case COND_LESS:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bltz $t%d, %s\n", reg - 2, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    case COND_LESS_EQUAL:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  blez $t%d, %s\n", reg - 2, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    case COND_GREATER:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bgtz $t%d, %s\n", reg - 2, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    case COND_GREATER_EQUAL:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bgez $t%d, %s\n", reg - 2, label);
-      fprintf(out, "  nop\n");
-      reg -= 2;
-      return 0;
-    default:
-      break;
-  }
+  hi2 = pop_word("$a3");
+  lo2 = pop_word("$a2");
+  hi1 = pop_word("$a1");
+  lo1 = pop_word("$a0");
 
-  return -1;
+  fprintf(out, "  sltu $t8, %s, %s\n", lo1, lo2);
+  fprintf(out, "  subu %s, %s, %s\n", lo1, lo1, lo2);
+  fprintf(out, "  subu %s, %s, %s\n", hi1, hi1, hi2);
+  fprintf(out, "  subu %s, %s, $t8\n", hi1, hi1);
+
+  push_word(lo1);
+  push_word(hi1);
+
+  return 0;
 }
 
-int MIPS32::ternary(int cond, int value_true, int value_false)
+int MIPS32::mul_long()
 {
-  fprintf(out, "  ; ternary %d ? %d : %d\n", cond, value_true, value_false);
-  fprintf(out, "  ; true condition is in delay slot\n");
+  const char *lo1, *hi1, *lo2, *hi2;
 
-  switch(cond)
-  {
-    case COND_EQUAL:
-      fprintf(out, "  beq $t%d, $t%d, ternary_%d\n", reg - 2, reg - 1, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    case COND_NOT_EQUAL:
-      fprintf(out, "  bne $t%d, $t%d, ternary_%d\n", reg - 2, reg - 1, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    case COND_LESS:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bltz $t%d, ternary_%d\n", reg - 2, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    case COND_LESS_EQUAL:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  blez $t%d, ternary_%d\n", reg - 2, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    case COND_GREATER:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bgtz $t%d, ternary_%d\n", reg - 2, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    case COND_GREATER_EQUAL:
-      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
-      fprintf(out, "  bgez $t%d, ternary_%d\n", reg - 2, label_count);
-      if (set_constant(reg - 2, value_true) != 0) { return -1; }
-      if (set_constant(reg - 2, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      reg -= 1;
-      return 0;
-    default:
-      break;
-  }
+  fprintf(out, "  ; mul_long()\n");
 
-  return -1;
+  hi2 = pop_word("$a3");
+  lo2 = pop_word("$a2");
+  hi1 = pop_word("$a1");
+  lo1 = pop_word("$a0");
+
+  // The cross products only matter for the high word.  mul trashes
+  // hi / lo so they have to be done before the multu.
+  fprintf(out, "  mul $t8, %s, %s\n", lo1, hi2);
+  fprintf(out, "  mul $t9, %s, %s\n", hi1, lo2);
+  fprintf(out, "  addu $t8, $t8, $t9\n");
+  fprintf(out, "  multu %s, %s\n", lo1, lo2);
+  fprintf(out, "  mflo %s\n", lo1);
+  fprintf(out, "  mfhi $t9\n");
+  fprintf(out, "  addu %s, $t8, $t9\n", hi1);
+
+  push_word(lo1);
+  push_word(hi1);
+
+  return 0;
 }
 
-int MIPS32::ternary(int cond, int compare, int value_true, int value_false)
+int MIPS32::div_long()
 {
-  fprintf(out, "  ; ternary %d (%d) ? %d : %d\n", cond, compare, value_true, value_false);
-  fprintf(out, "  ; true condition is in delay slot\n");
+  fprintf(out, "  ; div_long()\n");
 
-  if (set_constant(8, compare) != 0) { return -1; }
+  // _div_longs returns the quotient in $a1:$a0 and the remainder in
+  // $v1:$v0.
+  call_runtime("_div_longs", 4);
+  need_div_longs = 1;
 
-  switch(cond)
-  {
-    case COND_EQUAL:
-      fprintf(out, "  beq $t%d, $t8, ternary_%d\n", reg - 1, label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    case COND_NOT_EQUAL:
-      fprintf(out, "  bne $t%d, $t8, ternary_%d\n", reg - 1, label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    case COND_LESS:
-      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
-      fprintf(out, "  bltz $t8, ternary_%d\n", label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    case COND_LESS_EQUAL:
-      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
-      fprintf(out, "  blez $t8, ternary_%d\n", label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    case COND_GREATER:
-      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
-      fprintf(out, "  bgtz $t8, ternary_%d\n", label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    case COND_GREATER_EQUAL:
-      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
-      fprintf(out, "  bgez $t8, ternary_%d\n", label_count);
-      if (set_constant(reg - 1, value_true) != 0) { return -1; }
-      if (set_constant(reg - 1, value_false) != 0) { return -1; }
-      fprintf(out, "ternary_%d:\n", label_count++);
-      return 0;
-    default:
-      break;
-  }
+  push_word("$a0");
+  push_word("$a1");
 
-  return -1;
+  return 0;
 }
 
-int MIPS32::return_local(int index, int local_count)
+int MIPS32::mod_long()
 {
-  if (reg != 0)
-  {
-    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
-  }
+  fprintf(out, "  ; mod_long()\n");
 
-  fprintf(out, "  lw $v0, %d($fp) ; local_%d\n", LOCALS(index), index);
-  fprintf(out, "  addiu $sp, $sp, %d\n", (local_count * 4) + 4);
-  fprintf(out, "  jr $ra\n");
-  fprintf(out, "  nop\n");
+  call_runtime("_div_longs", 4);
+  need_div_longs = 1;
+
+  push_word("$v0");
+  push_word("$v1");
 
   return 0;
 }
 
-int MIPS32::return_integer(int local_count)
+int MIPS32::neg_long()
 {
-  if (reg != 1)
-  {
-    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
-  }
+  const char *lo, *hi;
 
-  fprintf(out, "  move $v0, $t0\n");
-  fprintf(out, "  addiu $sp, $sp, %d\n", (local_count * 4) + 4);
-  fprintf(out, "  jr $ra\n");
-  fprintf(out, "  nop ; Delay slot\n");
-  reg--;
+  fprintf(out, "  ; neg_long()\n");
 
-  return 0;
-}
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
 
-int MIPS32::return_void(int local_count)
-{
-  if (reg != 0)
-  {
-    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
-  }
+  fprintf(out, "  sltu $t8, $0, %s\n", lo);
+  fprintf(out, "  subu %s, $0, %s\n", lo, lo);
+  fprintf(out, "  subu %s, $0, %s\n", hi, hi);
+  fprintf(out, "  subu %s, %s, $t8\n", hi, hi);
+
+  push_word(lo);
+  push_word(hi);
 
-  fprintf(out, "  addiu $sp, $sp, %d\n", (local_count * 4) + 4);
-  fprintf(out, "  jr $ra\n");
-  fprintf(out, "  nop ; Delay slot\n");
   return 0;
 }
 
-int MIPS32::jump(const char *name, int distance)
+int MIPS32::shift_left_long()
 {
-  fprintf(out, "  b %s\n", name);
-  fprintf(out, "  nop ; Delay slot\n");
+  const char *lo, *hi, *count;
 
-  return 0;
-}
+  fprintf(out, "  ; shift_left_long()\n");
 
-int MIPS32::call(const char *name)
-{
-  return -1;
+  count = pop_word("$a2");
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
+
+  // Bits moving from lo to hi are (lo >> 1) >> (31 - count) so a count
+  // of 0 moves none of them.  sllv only uses 5 bits of the count, so if
+  // bit 5 is set the words shift over one more time.
+  fprintf(out, "  srl $t8, %s, 1\n", lo);
+  fprintf(out, "  nor $t9, %s, $0\n", count);
+  fprintf(out, "  srlv $t8, $t8, $t9\n");
+  fprintf(out, "  sllv %s, %s, %s\n", hi, hi, count);
+  fprintf(out, "  or %s, %s, $t8\n", hi, hi);
+  fprintf(out, "  sllv %s, %s, %s\n", lo, lo, count);
+  fprintf(out, "  andi $t8, %s, 32\n", count);
+  fprintf(out, "  beq $t8, $0, shift_long_%d\n", label_count);
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move %s, %s\n", hi, lo);
+  fprintf(out, "  move %s, $0\n", lo);
+  fprintf(out, "shift_long_%d:\n", label_count++);
+
+  push_word(lo);
+  push_word(hi);
+
+  return 0;
 }
 
-int MIPS32::invoke_static_method(const char *name, int params, int is_void)
+int MIPS32::shift_left_long(int count)
 {
-  int save_space;
-  int save_regs;
-  //int local_index = 0;
-  int n;
-  int param_sp = 0;
+  const char *lo, *hi;
 
-  fprintf(out, "  ; invoke_static_method() name=%s params=%d is_void=%d\n", name, params, is_void);
+  count &= 63;
 
-  save_regs = reg - params;
-  save_space = ((save_regs) * 4) + 8;
+  fprintf(out, "  ; shift_left_long(%d)\n", count);
 
-  // Save ra and fp
-  fprintf(out, "  addiu $sp, $sp, -%d\n", save_space);
-  fprintf(out, "  sw $ra, %d($sp)\n", save_space - 4);
-  fprintf(out, "  sw $fp, %d($sp)\n", save_space - 8);
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
 
-  // Save temp registers and parameter registers.
-  for (n = 0; n < save_regs; n++)
+  if (count == 0)
   {
-    fprintf(out, "  sw $t%d, %d($sp)\n", n, save_space - ((n + 3) * 4));
   }
-
-  param_sp = -4;
-
-  // Push registers that are parameters.
-  // Parameters are pushed left to right.
-  for (n = save_regs; n < reg; n++)
+    else
+  if (count < 32)
   {
-    fprintf(out, "  sw $t%d, %d($sp)\n", n, param_sp);
-    param_sp -= 4;
+    fprintf(out, "  srl $t8, %s, %d\n", lo, 32 - count);
+    fprintf(out, "  sll %s, %s, %d\n", hi, hi, count);
+    fprintf(out, "  or %s, %s, $t8\n", hi, hi);
+    fprintf(out, "  sll %s, %s, %d\n", lo, lo, count);
   }
-
-  // Setup parameters that are on the stack.
-  for (n = 0; n < stack; n++)
+    else
   {
-    fprintf(out, "  lw $at, %d($sp)\n", save_space + (n * 4) + 4);
-    fprintf(out, "  sw $at, %d($sp)\n", param_sp);
-    param_sp -= 4;
+    fprintf(out, "  sll %s, %s, %d\n", hi, lo, count - 32);
+    fprintf(out, "  move %s, $0\n", lo);
   }
 
-  fprintf(out, "  jal %s\n", name);
-  fprintf(out, "  nop ; Delay slot\n");
+  push_word(lo);
+  push_word(hi);
 
-  // Restore temp registers
-  for (n = 0; n < save_regs; n++)
-  {
-    fprintf(out, "  lw $t%d, %d($sp)\n", n, save_space - (n * 4) + 8);
-  }
+  return 0;
+}
 
-  // Restore ra and fp
-  fprintf(out, "  lw $ra, %d($sp)\n", save_space - 4);
-  fprintf(out, "  lw $fp, %d($sp)\n", save_space - 8);
-  fprintf(out, "  addiu $sp, $sp, %d\n", save_space);
+int MIPS32::shift_right_long()
+{
+  const char *lo, *hi, *count;
 
-  // Decrease count on reg stack.
-  if (stack > 0)
-  {
-    // Pick the min between stack and params.
-    n = (stack > params) ? params : stack;
-    fprintf(out, "  addiu $sp, $sp, %d\n", n * 4);
-    params -= n;
-  }
+  fprintf(out, "  ; shift_right_long()\n");
 
-  reg -= params;
+  count = pop_word("$a2");
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
 
-  // If this isn't a void, push return value onto register stack.
-  if (!is_void)
-  {
-    if (reg < reg_max)
-    {
-      fprintf(out, "  move $t%d, $v0\n", REG_STACK(reg));
-      reg++;
-    }
-      else
-    {
-      fprintf(out, "  addiu $sp, $sp, -%d\n", 4);
-      fprintf(out, "  sw $v0, 0($sp)\n");
-      stack++;
-    }
-  }
+  fprintf(out, "  sll $t8, %s, 1\n", hi);
+  fprintf(out, "  nor $t9, %s, $0\n", count);
+  fprintf(out, "  sllv $t8, $t8, $t9\n");
+  fprintf(out, "  srlv %s, %s, %s\n", lo, lo, count);
+  fprintf(out, "  or %s, %s, $t8\n", lo, lo);
+  fprintf(out, "  srav %s, %s, %s\n", hi, hi, count);
+  fprintf(out, "  andi $t8, %s, 32\n", count);
+  fprintf(out, "  beq $t8, $0, shift_long_%d\n", label_count);
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move %s, %s\n", lo, hi);
+  fprintf(out, "  sra %s, %s, 31\n", hi, hi);
+  fprintf(out, "shift_long_%d:\n", label_count++);
+
+  push_word(lo);
+  push_word(hi);
 
   return 0;
 }
 
-int MIPS32::put_static(const char *name, int index)
+int MIPS32::shift_right_long(int count)
 {
-  fprintf(out, "  ; put_static(%s, %d)\n", name, index);
+  const char *lo, *hi;
 
-  if (stack > 0)
-  {
-    STACK_POP(8);
-    fprintf(out, "  sw $t8, %d($s1)\n", index * 4);
-  }
-    else
-  {
-    fprintf(out, "  sw $t%d, %d($s1)\n", reg - 1, index * 4);
-    reg--;
-  }
+  count &= 63;
 
-  return 0;
-}
+  fprintf(out, "  ; shift_right_long(%d)\n", count);
 
-int MIPS32::get_static(const char *name, int index)
-{
-  fprintf(out, "  ; get_static(%s, %d)\n", name, index);
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
 
-  if (reg < reg_max)
+  if (count == 0)
   {
-    fprintf(out, "  lw $t%d, %d($s1)\n", reg++, index * 4);
   }
     else
+  if (count < 32)
   {
-    fprintf(out, "  lw $t8, %d($s1)\n", index * 4);
-    STACK_PUSH(8);
+    fprintf(out, "  sll $t8, %s, %d\n", hi, 32 - count);
+    fprintf(out, "  srl %s, %s, %d\n", lo, lo, count);
+    fprintf(out, "  or %s, %s, $t8\n", lo, lo);
+    fprintf(out, "  sra %s, %s, %d\n", hi, hi, count);
+  }
+    else
+  {
+    fprintf(out, "  sra %s, %s, %d\n", lo, hi, count - 32);
+    fprintf(out, "  sra %s, %s, 31\n", hi, hi);
   }
 
+  push_word(lo);
+  push_word(hi);
+
   return 0;
 }
 
-int MIPS32::brk()
+int MIPS32::shift_right_ulong()
 {
-  fprintf(out, "  break\n");
+  const char *lo, *hi, *count;
+
+  fprintf(out, "  ; shift_right_ulong()\n");
+
+  count = pop_word("$a2");
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
+
+  fprintf(out, "  sll $t8, %s, 1\n", hi);
+  fprintf(out, "  nor $t9, %s, $0\n", count);
+  fprintf(out, "  sllv $t8, $t8, $t9\n");
+  fprintf(out, "  srlv %s, %s, %s\n", lo, lo, count);
+  fprintf(out, "  or %s, %s, $t8\n", lo, lo);
+  fprintf(out, "  srlv %s, %s, %s\n", hi, hi, count);
+  fprintf(out, "  andi $t8, %s, 32\n", count);
+  fprintf(out, "  beq $t8, $0, shift_long_%d\n", label_count);
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move %s, %s\n", lo, hi);
+  fprintf(out, "  move %s, $0\n", hi);
+  fprintf(out, "shift_long_%d:\n", label_count++);
+
+  push_word(lo);
+  push_word(hi);
+
   return 0;
 }
 
-int MIPS32::new_array(uint8_t type)
+int MIPS32::shift_right_ulong(int count)
 {
-  int t;
+  const char *lo, *hi;
 
-  fprintf(out, "  ; new_array(%d)\n", type);
+  count &= 63;
 
-  if (stack > 0)
-  {
-    STACK_POP(8);
-    t = 8;
-  }
-    else
-  {
-    t = reg - 1;
-  }
+  fprintf(out, "  ; shift_right_ulong(%d)\n", count);
 
-  fprintf(out, "  sw $t%d, 0($gp)\n", t);
+  hi = pop_word("$a1");
+  lo = pop_word("$a0");
 
-  if (type == TYPE_INT)
+  if (count == 0)
   {
-    fprintf(out, "  sll $t%d, $t%d, 2\n", t, t);
   }
     else
-  if (type == TYPE_SHORT || type == TYPE_CHAR)
-  {
-    fprintf(out, "  sll $t%d, $t%d, 1\n", t, t);
-  }
-
-  fprintf(out, "  addiu $t%d, $t%d, 4\n", t, t);
-  fprintf(out, "  move $t9, $gp\n");
-  fprintf(out, "  addu $gp, $gp, $t%d\n", t);
-  fprintf(out, "  addiu $t9, $t9, 4\n");
-
-  if (t == 8)
+  if (count < 32)
   {
-    STACK_PUSH(9);
+    fprintf(out, "  sll $t8, %s, %d\n", hi, 32 - count);
+    fprintf(out, "  srl %s, %s, %d\n", lo, lo, count);
+    fprintf(out, "  or %s, %s, $t8\n", lo, lo);
+    fprintf(out, "  srl %s, %s, %d\n", hi, hi, count);
   }
     else
   {
-    fprintf(out, "  move $t%d, $t9\n", t);
+    fprintf(out, "  srl %s, %s, %d\n", lo, hi, count - 32);
+    fprintf(out, "  move %s, $0\n", hi);
   }
 
+  push_word(lo);
+  push_word(hi);
+
   return 0;
 }
 
-int MIPS32::insert_array(const char *name, int32_t *data, int len, uint8_t type)
+int MIPS32::and_long()
 {
-  fprintf(out, ".align 32\n");
-  if (type == TYPE_BYTE)
-  { return insert_db(name, data, len, TYPE_INT); }
-    else
-  if (type == TYPE_SHORT)
-  { return insert_dw(name, data, len, TYPE_INT); } 
-    else
-  if (type == TYPE_INT)
-  { return insert_dc32(name, data, len, TYPE_INT); } 
+  return stack_alu_long("and");
+}
 
-  return -1;
+int MIPS32::or_long()
+{
+  return stack_alu_long("or");
 }
 
-int MIPS32::insert_string(const char *name, uint8_t *bytes, int len)
+int MIPS32::xor_long()
 {
-  fprintf(out, ".align 32\n");
-  fprintf(out, "  dc32 %d\n", len);
-  return insert_utf8(name, bytes, len);
+  return stack_alu_long("xor");
 }
 
-int MIPS32::push_array_length()
+int MIPS32::integer_to_long()
 {
-  if (stack > 0)
+  const char *lo;
+
+  fprintf(out, "  ; integer_to_long()\n");
+
+  lo = pop_word("$a0");
+  push_word(lo);
+
+  if (stack == 0 && reg < reg_max)
   {
-    fprintf(out, "  lw $t8, 0($sp)\n"); \
-    fprintf(out, "  lw $t8, -4($t8)\n");
-    fprintf(out, "  sw $t8, 0($sp)\n"); \
-    STACK_PUSH(8); 
+    fprintf(out, "  sra $t%d, %s, 31\n", reg, lo);
+    reg++;
   }
     else
   {
-    fprintf(out, "  lw $t%d, -4($t%d)\n", REG_STACK(reg-1), REG_STACK(reg-1));
+    fprintf(out, "  sra $t8, %s, 31\n", lo);
+    push_word("$t8");
   }
 
   return 0;
 }
 
-int MIPS32::push_array_length(const char *name, int field_id)
+int MIPS32::long_to_integer()
 {
-  fprintf(out, "  lw $t8, 0x%04x($s1) ; static %s\n", field_id * 4, name);
+  fprintf(out, "  ; long_to_integer()\n");
 
-  if (reg >= reg_max)
-  {
-    STACK_PUSH(8); 
-  }
-    else
-  {
-    fprintf(out, "  lw $t%d, -4($t8)\n", REG_STACK(reg));
-    reg++;
-  }
+  // Drop the high word.
+  pop_word("$a0");
 
   return 0;
 }
 
-int MIPS32::array_read_byte()
+int MIPS32::compare_longs()
 {
-  int index_reg;
-  int ref_reg;
+  const char *lo1, *hi1, *lo2, *hi2;
 
-  get_values_from_stack(&index_reg, &ref_reg);
+  fprintf(out, "  ; compare_longs()\n");
 
-  fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
+  hi2 = pop_word("$a3");
+  lo2 = pop_word("$a2");
+  hi1 = pop_word("$a1");
+  lo1 = pop_word("$a0");
 
-  if (reg < reg_max)
-  {
-    fprintf(out, "  lb $t%d, 0($t%d)\n", REG_STACK(reg), ref_reg);
-    reg++;
-  }
-    else
-  {
-    fprintf(out, "  lb $t8, 0($t%d)\n", ref_reg);
-    STACK_PUSH(8);
+  // $t9 = -1, 0, 1 comparing the signed high words, $t8 the same for
+  // the unsigned low words.  The low words only count if the high
+  // words are equal.
+  fprintf(out, "  slt $t8, %s, %s\n", hi1, hi2);
+  fprintf(out, "  slt $t9, %s, %s\n", hi2, hi1);
+  fprintf(out, "  subu $t9, $t9, $t8\n");
+  fprintf(out, "  sltu $t8, %s, %s\n", lo1, lo2);
+  fprintf(out, "  sltu %s, %s, %s\n", hi1, lo2, lo1);
+  fprintf(out, "  subu $t8, %s, $t8\n", hi1);
+  fprintf(out, "  sltiu %s, $t9, 1\n", hi1);
+  fprintf(out, "  subu %s, $0, %s\n", hi1, hi1);
+  fprintf(out, "  and $t8, $t8, %s\n", hi1);
+  fprintf(out, "  or %s, $t9, $t8\n", lo1);
+
+  push_word(lo1);
+
+  return 0;
+}
+
+int MIPS32::add_float()
+{
+  fprintf(out, "  ; add_float()\n");
+
+  call_runtime("_float_add", 2);
+  push_word("$v0");
+  need_float_add = 1;
+
+  return 0;
+}
+
+int MIPS32::sub_float()
+{
+  fprintf(out, "  ; sub_float()\n");
+
+  call_runtime("_float_sub", 2);
+  push_word("$v0");
+  need_float_add = 1;
+
+  return 0;
+}
+
+int MIPS32::mul_float()
+{
+  fprintf(out, "  ; mul_float()\n");
+
+  call_runtime("_float_mul", 2);
+  push_word("$v0");
+  need_float_mul = 1;
+
+  return 0;
+}
+
+int MIPS32::div_float()
+{
+  fprintf(out, "  ; div_float()\n");
+
+  call_runtime("_float_div", 2);
+  push_word("$v0");
+  need_float_div = 1;
+
+  return 0;
+}
+
+int MIPS32::neg_float()
+{
+  const char *r;
+
+  fprintf(out, "  ; neg_float()\n");
+
+  r = pop_word("$a0");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  xor %s, %s, $t8\n", r, r);
+  push_word(r);
+
+  return 0;
+}
+
+int MIPS32::float_to_integer()
+{
+  fprintf(out, "  ; float_to_integer()\n");
+
+  call_runtime("_float_to_int", 1);
+  push_word("$v0");
+  need_float_to_int = 1;
+
+  return 0;
+}
+
+int MIPS32::integer_to_float()
+{
+  fprintf(out, "  ; integer_to_float()\n");
+
+  call_runtime("_int_to_float", 1);
+  push_word("$v0");
+  need_int_to_float = 1;
+
+  return 0;
+}
+
+int MIPS32::compare_floats(int cond)
+{
+  fprintf(out, "  ; compare_floats(%d)\n", cond);
+
+  // cond is 0 for fcmpl (NaN gives -1) and 1 for fcmpg (NaN gives 1).
+  call_runtime(cond == 0 ? "_float_cmpl" : "_float_cmpg", 2);
+  push_word("$v0");
+  need_float_compare = 1;
+
+  return 0;
+}
+
+int MIPS32::jump_cond(const char *label, int cond, int distance)
+{
+  fprintf(out, "  ; jump_cond(%s, %d, %d)\n", label, cond, distance);
+
+  switch(cond)
+  {
+    case COND_EQUAL:
+      fprintf(out, "  beq $t%d, $0, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    case COND_NOT_EQUAL:
+      fprintf(out, "  bne $t%d, $0, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    case COND_LESS:
+      fprintf(out, "  bltz $t%d, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    case COND_LESS_EQUAL:
+      fprintf(out, "  blez $t%d, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    case COND_GREATER:
+      fprintf(out, "  bgtz $t%d, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    case COND_GREATER_EQUAL:
+      fprintf(out, "  bgez $t%d, %s\n", --reg, label);
+      fprintf(out, "  nop\n");
+      return 0;
+    default:
+      break;
+  }
+
+  return -1;
+}
+
+int MIPS32::jump_cond_integer(const char *label, int cond, int distance)
+{
+  fprintf(out, "  ; jump_cond_integer(%s, %d, %d)\n", label, cond, distance);
+
+  // I think this should never happen
+  if (stack != 0)
+  {
+    printf("Internal Error: Stack not empty\n");
+    return -1;
+  }
+
+  switch(cond)
+  {
+    case COND_EQUAL:
+      fprintf(out, "  beq $t%d, $t%d, %s\n", reg - 2, reg - 1, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    case COND_NOT_EQUAL:
+      fprintf(out, "  bne $t%d, $t%d, %s\n", reg - 2, reg - 1, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    case COND_LESS:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bltz $t%d, %s\n", reg - 2, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    case COND_LESS_EQUAL:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  blez $t%d, %s\n", reg - 2, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    case COND_GREATER:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bgtz $t%d, %s\n", reg - 2, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    case COND_GREATER_EQUAL:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bgez $t%d, %s\n", reg - 2, label);
+      fprintf(out, "  nop\n");
+      reg -= 2;
+      return 0;
+    default:
+      break;
+  }
+
+  return -1;
+}
+
+int MIPS32::ternary(int cond, int value_true, int value_false)
+{
+  fprintf(out, "  ; ternary %d ? %d : %d\n", cond, value_true, value_false);
+  fprintf(out, "  ; true condition is in delay slot\n");
+
+  switch(cond)
+  {
+    case COND_EQUAL:
+      fprintf(out, "  beq $t%d, $t%d, ternary_%d\n", reg - 2, reg - 1, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    case COND_NOT_EQUAL:
+      fprintf(out, "  bne $t%d, $t%d, ternary_%d\n", reg - 2, reg - 1, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    case COND_LESS:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bltz $t%d, ternary_%d\n", reg - 2, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    case COND_LESS_EQUAL:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  blez $t%d, ternary_%d\n", reg - 2, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    case COND_GREATER:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bgtz $t%d, ternary_%d\n", reg - 2, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    case COND_GREATER_EQUAL:
+      fprintf(out, "  subu $t%d, $t%d, $t%d\n", reg - 2, reg - 2, reg - 1);
+      fprintf(out, "  bgez $t%d, ternary_%d\n", reg - 2, label_count);
+      if (set_constant(reg - 2, value_true) != 0) { return -1; }
+      if (set_constant(reg - 2, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      reg -= 1;
+      return 0;
+    default:
+      break;
+  }
+
+  return -1;
+}
+
+int MIPS32::ternary(int cond, int compare, int value_true, int value_false)
+{
+  fprintf(out, "  ; ternary %d (%d) ? %d : %d\n", cond, compare, value_true, value_false);
+  fprintf(out, "  ; true condition is in delay slot\n");
+
+  if (set_constant(8, compare) != 0) { return -1; }
+
+  switch(cond)
+  {
+    case COND_EQUAL:
+      fprintf(out, "  beq $t%d, $t8, ternary_%d\n", reg - 1, label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    case COND_NOT_EQUAL:
+      fprintf(out, "  bne $t%d, $t8, ternary_%d\n", reg - 1, label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    case COND_LESS:
+      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
+      fprintf(out, "  bltz $t8, ternary_%d\n", label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    case COND_LESS_EQUAL:
+      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
+      fprintf(out, "  blez $t8, ternary_%d\n", label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    case COND_GREATER:
+      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
+      fprintf(out, "  bgtz $t8, ternary_%d\n", label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    case COND_GREATER_EQUAL:
+      fprintf(out, "  subu $t8, $t%d, $t8\n", reg - 1);
+      fprintf(out, "  bgez $t8, ternary_%d\n", label_count);
+      if (set_constant(reg - 1, value_true) != 0) { return -1; }
+      if (set_constant(reg - 1, value_false) != 0) { return -1; }
+      fprintf(out, "ternary_%d:\n", label_count++);
+      return 0;
+    default:
+      break;
+  }
+
+  return -1;
+}
+
+int MIPS32::return_local(int index, int local_count)
+{
+  if (reg != 0)
+  {
+    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
+  }
+
+  if (get_local_reg(index) != -1)
+  {
+    fprintf(out, "  move $v0, $s%d ; local_%d\n", get_local_reg(index), index);
+  }
+    else
+  {
+    fprintf(out, "  lw $v0, %d($fp) ; local_%d\n", LOCALS(index), index);
+  }
+
+  restore_local_regs(local_count);
+  fprintf(out, "  addiu $sp, $sp, %d\n", ((local_count + saved_regs) * 4) + 4);
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+
+  return 0;
+}
+
+int MIPS32::return_integer(int local_count)
+{
+  if (reg != 1)
+  {
+    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
+  }
+
+  fprintf(out, "  move $v0, $t0\n");
+  restore_local_regs(local_count);
+  fprintf(out, "  addiu $sp, $sp, %d\n", ((local_count + saved_regs) * 4) + 4);
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop ; Delay slot\n");
+  reg--;
+
+  return 0;
+}
+
+int MIPS32::return_long(int local_count)
+{
+  if (reg != 2)
+  {
+    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
+  }
+
+  fprintf(out, "  move $v0, $t0\n");
+  fprintf(out, "  move $v1, $t1\n");
+  restore_local_regs(local_count);
+  fprintf(out, "  addiu $sp, $sp, %d\n", ((local_count + saved_regs) * 4) + 4);
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop ; Delay slot\n");
+  reg -= 2;
+
+  return 0;
+}
+
+int MIPS32::return_float(int local_count)
+{
+  return return_integer(local_count);
+}
+
+int MIPS32::return_void(int local_count)
+{
+  if (reg != 0)
+  {
+    printf("Internal Error: Reg stack not empty %s:%d\n", __FILE__, __LINE__);
+  }
+
+  restore_local_regs(local_count);
+  fprintf(out, "  addiu $sp, $sp, %d\n", ((local_count + saved_regs) * 4) + 4);
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop ; Delay slot\n");
+  return 0;
+}
+
+int MIPS32::jump(const char *name, int distance)
+{
+  fprintf(out, "  b %s\n", name);
+  fprintf(out, "  nop ; Delay slot\n");
+
+  return 0;
+}
+
+int MIPS32::call(const char *name)
+{
+  return -1;
+}
+
+int MIPS32::invoke_static_method(const char *name, int params, int is_void)
+{
+  fprintf(out, "  ; invoke_static_method() name=%s params=%d is_void=%d\n", name, params, is_void);
+
+  return invoke_static(name, params, is_void ? 0 : 1);
+}
+
+int MIPS32::invoke_static_method_long(const char *name, int params)
+{
+  fprintf(out, "  ; invoke_static_method_long() name=%s params=%d\n", name, params);
+
+  return invoke_static(name, params, 2);
+}
+
+int MIPS32::put_static(const char *name, int index)
+{
+  fprintf(out, "  ; put_static(%s, %d)\n", name, index);
+
+  if (stack > 0)
+  {
+    STACK_POP(8);
+    fprintf(out, "  sw $t8, %d($s1)\n", index * 4);
+  }
+    else
+  {
+    fprintf(out, "  sw $t%d, %d($s1)\n", reg - 1, index * 4);
+    reg--;
+  }
+
+  return 0;
+}
+
+int MIPS32::get_static(const char *name, int index)
+{
+  fprintf(out, "  ; get_static(%s, %d)\n", name, index);
+
+  if (reg < reg_max)
+  {
+    fprintf(out, "  lw $t%d, %d($s1)\n", reg++, index * 4);
+  }
+    else
+  {
+    fprintf(out, "  lw $t8, %d($s1)\n", index * 4);
+    STACK_PUSH(8);
+  }
+
+  return 0;
+}
+
+int MIPS32::brk()
+{
+  fprintf(out, "  break\n");
+  return 0;
+}
+
+int MIPS32::new_object(const char *object_name, int object_size)
+{
+  int n;
+
+  fprintf(out, "  ; new_object(%s, %d)\n", object_name, object_size);
+
+  if (object_size == 0)
+  {
+    printf("Error: Unsupported class %s\n", object_name);
+    return -1;
+  }
+
+  // Objects come off the same heap as arrays, but without a length.
+  for (n = 0; n < object_size; n += 4)
+  {
+    fprintf(out, "  sw $0, %d($gp)\n", n);
+  }
+
+  push_word("$gp");
+  fprintf(out, "  addiu $gp, $gp, %d\n", object_size);
+
+  return 0;
+}
+
+int MIPS32::get_field_byte(int offset)
+{
+  return get_field("lb", offset);
+}
+
+int MIPS32::get_field_short(int offset)
+{
+  return get_field("lh", offset);
+}
+
+int MIPS32::get_field_char(int offset)
+{
+  return get_field("lhu", offset);
+}
+
+int MIPS32::get_field_int(int offset)
+{
+  return get_field("lw", offset);
+}
+
+int MIPS32::put_field_byte(int offset)
+{
+  return put_field("sb", offset);
+}
+
+int MIPS32::put_field_short(int offset)
+{
+  return put_field("sh", offset);
+}
+
+int MIPS32::put_field_int(int offset)
+{
+  return put_field("sw", offset);
+}
+
+int MIPS32::new_array(uint8_t type)
+{
+  int t;
+
+  fprintf(out, "  ; new_array(%d)\n", type);
+
+  if (stack > 0)
+  {
+    STACK_POP(8);
+    t = 8;
+  }
+    else
+  {
+    t = reg - 1;
+  }
+
+  fprintf(out, "  sw $t%d, 0($gp)\n", t);
+
+  if (type == TYPE_INT || type == TYPE_FLOAT)
+  {
+    fprintf(out, "  sll $t%d, $t%d, 2\n", t, t);
+  }
+    else
+  if (type == TYPE_SHORT || type == TYPE_CHAR)
+  {
+    fprintf(out, "  sll $t%d, $t%d, 1\n", t, t);
+  }
+
+  if (type == TYPE_INT || type == TYPE_FLOAT)
+  {
+    fprintf(out, "  addiu $t%d, $t%d, 4\n", t, t);
+  }
+    else
+  {
+    // Round up so $gp stays word aligned for whatever comes next.
+    fprintf(out, "  addiu $t%d, $t%d, 7\n", t, t);
+    fprintf(out, "  srl $t%d, $t%d, 2\n", t, t);
+    fprintf(out, "  sll $t%d, $t%d, 2\n", t, t);
+  }
+
+  fprintf(out, "  move $t9, $gp\n");
+  fprintf(out, "  addu $gp, $gp, $t%d\n", t);
+  fprintf(out, "  addiu $t9, $t9, 4\n");
+
+  if (t == 8)
+  {
+    STACK_PUSH(9);
+  }
+    else
+  {
+    fprintf(out, "  move $t%d, $t9\n", t);
+  }
+
+  return 0;
+}
+
+int MIPS32::insert_array(const char *name, int32_t *data, int len, uint8_t type)
+{
+  fprintf(out, ".align 32\n");
+  if (type == TYPE_BYTE)
+  { return insert_db(name, data, len, TYPE_INT); }
+    else
+  if (type == TYPE_SHORT)
+  { return insert_dw(name, data, len, TYPE_INT); } 
+    else
+  if (type == TYPE_INT)
+  { return insert_dc32(name, data, len, TYPE_INT); } 
+
+  return -1;
+}
+
+int MIPS32::insert_string(const char *name, uint8_t *bytes, int len)
+{
+  fprintf(out, ".align 32\n");
+  fprintf(out, "  dc32 %d\n", len);
+  return insert_utf8(name, bytes, len);
+}
+
+int MIPS32::push_array_length()
+{
+  if (stack > 0)
+  {
+    fprintf(out, "  lw $t8, 0($sp)\n"); \
+    fprintf(out, "  lw $t8, -4($t8)\n");
+    fprintf(out, "  sw $t8, 0($sp)\n"); \
+    STACK_PUSH(8); 
+  }
+    else
+  {
+    fprintf(out, "  lw $t%d, -4($t%d)\n", REG_STACK(reg-1), REG_STACK(reg-1));
+  }
+
+  return 0;
+}
+
+int MIPS32::push_array_length(const char *name, int field_id)
+{
+  fprintf(out, "  lw $t8, 0x%04x($s1) ; static %s\n", field_id * 4, name);
+
+  if (reg >= reg_max)
+  {
+    STACK_PUSH(8); 
+  }
+    else
+  {
+    fprintf(out, "  lw $t%d, -4($t8)\n", REG_STACK(reg));
+    reg++;
+  }
+
+  return 0;
+}
+
+int MIPS32::array_read_byte()
+{
+  int index_reg;
+  int ref_reg;
+
+  get_values_from_stack(&index_reg, &ref_reg);
+
+  fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
+
+  if (reg < reg_max)
+  {
+    fprintf(out, "  lb $t%d, 0($t%d)\n", REG_STACK(reg), ref_reg);
+    reg++;
+  }
+    else
+  {
+    fprintf(out, "  lb $t8, 0($t%d)\n", ref_reg);
+    STACK_PUSH(8);
   }
 
   return 0;
@@ -1280,6 +1956,11 @@ int MIPS32::array_read_int()
   return 0;
 }
 
+int MIPS32::array_read_float()
+{
+  return array_read_int();
+}
+
 int MIPS32::array_read_byte(const char *name, int field_id)
 {
   int index_reg;
@@ -1351,185 +2032,979 @@ int MIPS32::array_read_int(const char *name, int field_id)
   return 0;
 }
 
-int MIPS32::array_write_byte()
+int MIPS32::array_read_float(const char *name, int field_id)
+{
+  return array_read_int(name, field_id);
+}
+
+int MIPS32::array_write_byte()
+{
+  int value_reg;
+  int index_reg;
+  int ref_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  if (get_ref_from_stack(&ref_reg) == -1)
+  {
+    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+    fprintf(out, "  sb $t%d, 0($at)\n", value_reg);
+  }
+    else
+  {
+    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
+    fprintf(out, "  sb $t%d, 0($t%d)\n", value_reg, ref_reg);
+  }
+
+  return 0;
+}
+
+int MIPS32::array_write_short()
+{
+  int value_reg;
+  int index_reg;
+  int ref_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  if (get_ref_from_stack(&ref_reg) == -1)
+  {
+    fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
+    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+    fprintf(out, "  sh $t%d, 0($at)\n", value_reg);
+  }
+    else
+  {
+    fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
+    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
+    fprintf(out, "  sh $t%d, 0($t%d)\n", value_reg, ref_reg);
+  }
+
+  return 0;
+}
+
+int MIPS32::array_write_int()
+{
+  int value_reg;
+  int index_reg;
+  int ref_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  if (get_ref_from_stack(&ref_reg) == -1)
+  {
+    fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
+    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+    fprintf(out, "  sw $t%d, 0($at)\n", value_reg);
+  }
+    else
+  {
+    fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
+    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
+    fprintf(out, "  sw $t%d, 0($t%d)\n", value_reg, ref_reg);
+  }
+
+  return 0;
+}
+
+int MIPS32::array_write_float()
+{
+  return array_write_int();
+}
+
+int MIPS32::array_write_byte(const char *name, int field_id)
+{
+  int value_reg;
+  int index_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
+  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+  fprintf(out, "  sb $t%d, 0($at)\n", value_reg);
+
+  return 0;
+}
+
+int MIPS32::array_write_short(const char *name, int field_id)
+{
+  int value_reg;
+  int index_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
+  fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
+  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+  fprintf(out, "  sh $t%d, 0($at)\n", value_reg);
+
+  return 0;
+}
+
+int MIPS32::array_write_int(const char *name, int field_id)
+{
+  int value_reg;
+  int index_reg;
+
+  get_values_from_stack(&value_reg, &index_reg);
+
+  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
+  fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
+  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
+  fprintf(out, "  sw $t%d, 0($at)\n", value_reg);
+
+  return 0;
+}
+
+int MIPS32::array_write_float(const char *name, int field_id)
+{
+  return array_write_int(name, field_id);
+}
+
+int MIPS32::cpu_nop()
+{
+  fprintf(out, "  nop\n");
+  return 0;
+}
+
+int MIPS32::fixed_mul8_II()
+{
+  return multiply_fixed(8);
+}
+
+int MIPS32::fixed_div8_II()
+{
+  const char *rt = pop_word("$t8");
+  const char *rs = pop_word("$t9");
+
+  fprintf(out, "  ; fixed_div8_II()\n");
+  fprintf(out, "  sll $t9, %s, 8\n", rs);
+  fprintf(out, "  div $t9, %s\n", rt);
+  fprintf(out, "  nop\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  mflo $t8\n");
+  push_word("$t8");
+
+  return 0;
+}
+
+int MIPS32::fixed_mul16_II()
+{
+  return multiply_fixed(16);
+}
+
+int MIPS32::fixed_div16_II()
+{
+  const char *r;
+
+  fprintf(out, "  ; fixed_div16_II()\n");
+
+  // a << 16 doesn't fit in 32 bits so this is a 64 bit divide.
+  r = pop_word("$a2");
+  if (strcmp(r, "$a2") != 0) { fprintf(out, "  move $a2, %s\n", r); }
+  r = pop_word("$a0");
+  fprintf(out, "  sra $a1, %s, 16\n", r);
+  fprintf(out, "  sll $a0, %s, 16\n", r);
+  fprintf(out, "  sra $a3, $a2, 31\n");
+
+  call_runtime("_div_longs", 0);
+  need_div_longs = 1;
+
+  push_word("$a0");
+
+  return 0;
+}
+
+int MIPS32::stack_alu(const char *instr)
+{
+  if (stack == 0)
+  {
+    fprintf(out, "  %s $t%d, $t%d, $t%d\n", instr, REG_STACK(reg-2), REG_STACK(reg-2), REG_STACK(reg-1));
+    reg--;
+  }
+    else
+  if (stack == 1)
+  {
+    STACK_POP(8);
+    fprintf(out, "  %s $t%d, $t%d, $t8\n", instr, REG_STACK(reg-1), REG_STACK(reg-1));
+  }
+    else
+  {
+    STACK_POP(8);
+    STACK_POP(9);
+    fprintf(out, "  %s $t9, $t9, $t8\n", instr);
+    STACK_PUSH(9);
+  }
+
+  return 0;
+}
+
+int MIPS32::invoke_static(const char *name, int params, int words)
+{
+  int save_space;
+  int save_regs;
+  //int local_index = 0;
+  int n;
+  int param_sp = 0;
+
+  save_regs = reg - params;
+  save_space = ((save_regs) * 4) + 8;
+
+  // Save ra and fp
+  fprintf(out, "  addiu $sp, $sp, -%d\n", save_space);
+  fprintf(out, "  sw $ra, %d($sp)\n", save_space - 4);
+  fprintf(out, "  sw $fp, %d($sp)\n", save_space - 8);
+
+  // Save temp registers and parameter registers.
+  for (n = 0; n < save_regs; n++)
+  {
+    fprintf(out, "  sw $t%d, %d($sp)\n", n, save_space - ((n + 3) * 4));
+  }
+
+  param_sp = -4;
+
+  // Push registers that are parameters.
+  // Parameters are pushed left to right.
+  for (n = save_regs; n < reg; n++)
+  {
+    fprintf(out, "  sw $t%d, %d($sp)\n", n, param_sp);
+    param_sp -= 4;
+  }
+
+  // Setup parameters that are on the stack.
+  for (n = 0; n < stack; n++)
+  {
+    fprintf(out, "  lw $at, %d($sp)\n", save_space + (n * 4) + 4);
+    fprintf(out, "  sw $at, %d($sp)\n", param_sp);
+    param_sp -= 4;
+  }
+
+  fprintf(out, "  jal %s\n", name);
+  fprintf(out, "  nop ; Delay slot\n");
+
+  // Restore temp registers
+  for (n = 0; n < save_regs; n++)
+  {
+    fprintf(out, "  lw $t%d, %d($sp)\n", n, save_space - ((n + 3) * 4));
+  }
+
+  // Restore ra and fp
+  fprintf(out, "  lw $ra, %d($sp)\n", save_space - 4);
+  fprintf(out, "  lw $fp, %d($sp)\n", save_space - 8);
+  fprintf(out, "  addiu $sp, $sp, %d\n", save_space);
+
+  // Decrease count on reg stack.
+  if (stack > 0)
+  {
+    // Pick the min between stack and params.
+    n = (stack > params) ? params : stack;
+    fprintf(out, "  addiu $sp, $sp, %d\n", n * 4);
+    params -= n;
+  }
+
+  reg -= params;
+
+  // Push what was returned onto the register stack ($v1 is the high
+  // word of a long).
+  if (words >= 1) { push_word("$v0"); }
+  if (words == 2) { push_word("$v1"); }
+
+  return 0;
+}
+
+int MIPS32::stack_alu_long(const char *instr)
+{
+  const char *lo1, *hi1, *lo2, *hi2;
+
+  fprintf(out, "  ; %s_long()\n", instr);
+
+  hi2 = pop_word("$a3");
+  lo2 = pop_word("$a2");
+  hi1 = pop_word("$a1");
+  lo1 = pop_word("$a0");
+
+  fprintf(out, "  %s %s, %s, %s\n", instr, lo1, lo1, lo2);
+  fprintf(out, "  %s %s, %s, %s\n", instr, hi1, hi1, hi2);
+
+  push_word(lo1);
+  push_word(hi1);
+
+  return 0;
+}
+
+int MIPS32::divide()
 {
-  int value_reg;
-  int index_reg;
-  int ref_reg;
+  int rs, rt;
 
-  get_values_from_stack(&value_reg, &index_reg);
+  if (stack > 0)
+  {
+    STACK_POP(8);
+    rt = 8;
+  }
+    else
+  {
+    rt = reg - 1;
+    reg--;
+  }
 
-  if (get_ref_from_stack(&ref_reg) == -1)
+  if (stack > 0)
   {
-    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-    fprintf(out, "  sb $t%d, 0($at)\n", value_reg);
+    STACK_POP(9);
+    rs = 9;
   }
     else
   {
-    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
-    fprintf(out, "  sb $t%d, 0($t%d)\n", value_reg, ref_reg);
+    rs = reg - 1;
+    reg--;
   }
 
+  // MIPS manual says DIV needs a couple instructions before the mfhi / mflo.
+  fprintf(out, "  div $t%d, $t%d\n", rs, rt);
+  fprintf(out, "  nop\n");
+  fprintf(out, "  nop\n");
+
   return 0;
 }
 
-int MIPS32::array_write_short()
+
+int MIPS32::multiply_fixed(int shift)
 {
-  int value_reg;
-  int index_reg;
-  int ref_reg;
+  const char *rt = pop_word("$t8");
+  const char *rs = pop_word("$t9");
 
-  get_values_from_stack(&value_reg, &index_reg);
+  fprintf(out, "  ; fixed_mul%d_II()\n", shift);
 
-  if (get_ref_from_stack(&ref_reg) == -1)
-  {
-    fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
-    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-    fprintf(out, "  sh $t%d, 0($at)\n", value_reg);
-  }
-    else
-  {
-    fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
-    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
-    fprintf(out, "  sh $t%d, 0($t%d)\n", value_reg, ref_reg);
-  }
+  // Keep the middle 32 bits of the 64 bit product in hi:lo.
+  fprintf(out, "  mult %s, %s\n", rs, rt);
+  fprintf(out, "  mflo $t8\n");
+  fprintf(out, "  mfhi $t9\n");
+  fprintf(out, "  srl $t8, $t8, %d\n", shift);
+  fprintf(out, "  sll $t9, $t9, %d\n", 32 - shift);
+  fprintf(out, "  or $t8, $t8, $t9\n");
+  push_word("$t8");
 
   return 0;
 }
 
-int MIPS32::array_write_int()
+int MIPS32::call_runtime(const char *name, int words)
 {
-  int value_reg;
-  int index_reg;
-  int ref_reg;
-
-  get_values_from_stack(&value_reg, &index_reg);
+  const char *args[] = { "$a0", "$a1", "$a2", "$a3" };
+  const char *r;
+  int n;
 
-  if (get_ref_from_stack(&ref_reg) == -1)
-  {
-    fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
-    fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-    fprintf(out, "  sw $t%d, 0($at)\n", value_reg);
-  }
-    else
+  // Runtime routines take their operands in $a0 to $a3 and only use
+  // $at, $t8, $t9, $v0, $v1 so the register stack is left alone.
+  for (n = words - 1; n >= 0; n--)
   {
-    fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
-    fprintf(out, "  addu $t%d, $t%d, $t%d\n", ref_reg, ref_reg, index_reg);
-    fprintf(out, "  sw $t%d, 0($t%d)\n", value_reg, ref_reg);
+    r = pop_word(args[n]);
+    if (strcmp(r, args[n]) != 0) { fprintf(out, "  move %s, %s\n", args[n], r); }
   }
 
+  fprintf(out, "  addiu $sp, $sp, -4\n");
+  fprintf(out, "  sw $ra, 0($sp)\n");
+  fprintf(out, "  jal %s\n", name);
+  fprintf(out, "  nop ; Delay slot\n");
+  fprintf(out, "  lw $ra, 0($sp)\n");
+  fprintf(out, "  addiu $sp, $sp, 4\n");
+
   return 0;
 }
 
-int MIPS32::array_write_byte(const char *name, int field_id)
+int MIPS32::get_local_reg(int index)
 {
-  int value_reg;
-  int index_reg;
+  if (index < 0 || index >= (int)sizeof(local_reg)) { return -1; }
+  if (local_reg[index] == -1) { return -1; }
 
-  get_values_from_stack(&value_reg, &index_reg);
+  return local_reg[index] + 2;
+}
 
-  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
-  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-  fprintf(out, "  sb $t%d, 0($at)\n", value_reg);
+void MIPS32::restore_local_regs(int local_count)
+{
+  int n;
 
-  return 0;
+  for (n = 0; n < saved_regs; n++)
+  {
+    int index = local_count + n;
+    fprintf(out, "  lw $s%d, %d($fp)\n", n + 2, LOCALS(index));
+  }
 }
 
-int MIPS32::array_write_short(const char *name, int field_id)
+void MIPS32::insert_div_longs()
 {
-  int value_reg;
-  int index_reg;
+  // Signed 64 bit divide: $a1:$a0 / $a3:$a2.  Quotient is returned in
+  // $a1:$a0 and remainder in $v1:$v0.  Only $at, $t8, $t9 are used as
+  // temps so the register stack is left alone.
+  fprintf(out, "_div_longs:\n");
+  fprintf(out, "  addiu $sp, $sp, -8\n");
+  fprintf(out, "  sra $t8, $a1, 31\n");
+  fprintf(out, "  sw $t8, 0($sp)\n");
+  fprintf(out, "  sra $t9, $a3, 31\n");
+  fprintf(out, "  xor $t9, $t9, $t8\n");
+  fprintf(out, "  sw $t9, 4($sp)\n");
+  fprintf(out, "  bgez $a1, _div_longs_dividend_pos\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $at, $0, $a0\n");
+  fprintf(out, "  subu $a0, $0, $a0\n");
+  fprintf(out, "  subu $a1, $0, $a1\n");
+  fprintf(out, "  subu $a1, $a1, $at\n");
+  fprintf(out, "_div_longs_dividend_pos:\n");
+  fprintf(out, "  bgez $a3, _div_longs_divisor_pos\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $at, $0, $a2\n");
+  fprintf(out, "  subu $a2, $0, $a2\n");
+  fprintf(out, "  subu $a3, $0, $a3\n");
+  fprintf(out, "  subu $a3, $a3, $at\n");
+  fprintf(out, "_div_longs_divisor_pos:\n");
+  fprintf(out, "  move $v0, $0\n");
+  fprintf(out, "  move $v1, $0\n");
+  fprintf(out, "  li $t9, 64\n");
+  fprintf(out, "_div_longs_loop:\n");
+  // Shift remainder:dividend left 1 bit.
+  fprintf(out, "  srl $t8, $v0, 31\n");
+  fprintf(out, "  sll $v1, $v1, 1\n");
+  fprintf(out, "  or $v1, $v1, $t8\n");
+  fprintf(out, "  srl $t8, $a1, 31\n");
+  fprintf(out, "  sll $v0, $v0, 1\n");
+  fprintf(out, "  or $v0, $v0, $t8\n");
+  fprintf(out, "  srl $t8, $a0, 31\n");
+  fprintf(out, "  sll $a1, $a1, 1\n");
+  fprintf(out, "  or $a1, $a1, $t8\n");
+  fprintf(out, "  sll $a0, $a0, 1\n");
+  // If remainder >= divisor, subtract it and set a bit in the quotient.
+  fprintf(out, "  sltu $t8, $v1, $a3\n");
+  fprintf(out, "  bne $t8, $0, _div_longs_next\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  bne $v1, $a3, _div_longs_sub\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $t8, $v0, $a2\n");
+  fprintf(out, "  bne $t8, $0, _div_longs_next\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_div_longs_sub:\n");
+  fprintf(out, "  sltu $t8, $v0, $a2\n");
+  fprintf(out, "  subu $v0, $v0, $a2\n");
+  fprintf(out, "  subu $v1, $v1, $a3\n");
+  fprintf(out, "  subu $v1, $v1, $t8\n");
+  fprintf(out, "  ori $a0, $a0, 1\n");
+  fprintf(out, "_div_longs_next:\n");
+  fprintf(out, "  addiu $t9, $t9, -1\n");
+  fprintf(out, "  bne $t9, $0, _div_longs_loop\n");
+  fprintf(out, "  nop\n");
+  // Quotient is negative if the signs were different, remainder takes
+  // the sign of the dividend.
+  fprintf(out, "  lw $t8, 4($sp)\n");
+  fprintf(out, "  beq $t8, $0, _div_longs_quotient_pos\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $at, $0, $a0\n");
+  fprintf(out, "  subu $a0, $0, $a0\n");
+  fprintf(out, "  subu $a1, $0, $a1\n");
+  fprintf(out, "  subu $a1, $a1, $at\n");
+  fprintf(out, "_div_longs_quotient_pos:\n");
+  fprintf(out, "  lw $t8, 0($sp)\n");
+  fprintf(out, "  beq $t8, $0, _div_longs_remainder_pos\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $at, $0, $v0\n");
+  fprintf(out, "  subu $v0, $0, $v0\n");
+  fprintf(out, "  subu $v1, $0, $v1\n");
+  fprintf(out, "  subu $v1, $v1, $at\n");
+  fprintf(out, "_div_longs_remainder_pos:\n");
+  fprintf(out, "  addiu $sp, $sp, 8\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop ; Delay slot\n\n");
+}
+
+void MIPS32::insert_float_add()
+{
+  // IEEE-754 single precision $a0 + $a1 (or $a0 - $a1) to $v0.  Like the
+  // rest of the soft float, denormals are treated as 0.
+  fprintf(out, "_float_sub:\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  xor $a1, $a1, $t8\n");
+  fprintf(out, "_float_add:\n");
+  // Make $a0 the one with the bigger magnitude.
+  fprintf(out, "  sll $t8, $a0, 1\n");
+  fprintf(out, "  sll $t9, $a1, 1\n");
+  fprintf(out, "  sltu $at, $t8, $t9\n");
+  fprintf(out, "  beq $at, $0, _float_add_ordered\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move $t8, $a0\n");
+  fprintf(out, "  move $a0, $a1\n");
+  fprintf(out, "  move $a1, $t8\n");
+  fprintf(out, "_float_add_ordered:\n");
+  fprintf(out, "  lui $v0, 0x8000\n");
+  fprintf(out, "  and $v0, $v0, $a0\n");
+  fprintf(out, "  srl $v1, $a0, 23\n");
+  fprintf(out, "  andi $v1, $v1, 0xff\n");
+  fprintf(out, "  srl $a2, $a1, 23\n");
+  fprintf(out, "  andi $a2, $a2, 0xff\n");
+  fprintf(out, "  addiu $t8, $v1, -255\n");
+  fprintf(out, "  bne $t8, $0, _float_add_finite\n");
+  fprintf(out, "  nop\n");
+  // $a0 is inf or NaN.  inf - inf is NaN.
+  fprintf(out, "  sll $t8, $a0, 9\n");
+  fprintf(out, "  bne $t8, $0, _float_add_return_a\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addiu $t8, $a2, -255\n");
+  fprintf(out, "  bne $t8, $0, _float_add_return_a\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  xor $t8, $a0, $a1\n");
+  fprintf(out, "  beq $t8, $0, _float_add_return_a\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  b _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_finite:\n");
+  fprintf(out, "  bne $v1, $0, _float_add_a_normal\n");
+  fprintf(out, "  nop\n");
+  // Both are 0 and the answer is only -0 if both are.
+  fprintf(out, "  and $v0, $a0, $a1\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  and $v0, $v0, $t8\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_a_normal:\n");
+  fprintf(out, "  bne $a2, $0, _float_add_b_normal\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_return_a:\n");
+  fprintf(out, "  move $v0, $a0\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_b_normal:\n");
+  // Mantissas with the hidden bit at bit 30 leaving 7 bits for rounding.
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  sll $a3, $a0, 8\n");
+  fprintf(out, "  or $a3, $a3, $t8\n");
+  fprintf(out, "  srl $a3, $a3, 1\n");
+  fprintf(out, "  sll $t9, $a1, 8\n");
+  fprintf(out, "  or $t9, $t9, $t8\n");
+  fprintf(out, "  srl $t9, $t9, 1\n");
+  fprintf(out, "  subu $a2, $v1, $a2\n");
+  fprintf(out, "  sltiu $t8, $a2, 31\n");
+  fprintf(out, "  bne $t8, $0, _float_add_shift\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  li $t9, 1\n");
+  fprintf(out, "  b _float_add_aligned\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_shift:\n");
+  fprintf(out, "  beq $a2, $0, _float_add_aligned\n");
+  fprintf(out, "  nop\n");
+  // Bits shifted out of the smaller one are kept as a sticky bit.
+  fprintf(out, "  subu $t8, $0, $a2\n");
+  fprintf(out, "  sllv $t8, $t9, $t8\n");
+  fprintf(out, "  srlv $t9, $t9, $a2\n");
+  fprintf(out, "  sltu $t8, $0, $t8\n");
+  fprintf(out, "  or $t9, $t9, $t8\n");
+  fprintf(out, "_float_add_aligned:\n");
+  fprintf(out, "  xor $t8, $a0, $a1\n");
+  fprintf(out, "  bltz $t8, _float_add_subtract\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addu $a0, $a3, $t9\n");
+  fprintf(out, "  bgez $a0, _float_add_pack\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  andi $t8, $a0, 1\n");
+  fprintf(out, "  srl $a0, $a0, 1\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  addiu $v1, $v1, 1\n");
+  fprintf(out, "_float_add_pack:\n");
+  fprintf(out, "  b _float_pack\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_subtract:\n");
+  fprintf(out, "  subu $a0, $a3, $t9\n");
+  fprintf(out, "  bne $a0, $0, _float_add_normalize\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move $v0, $0\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_add_normalize:\n");
+  fprintf(out, "  lui $t8, 0x4000\n");
+  fprintf(out, "  and $t8, $a0, $t8\n");
+  fprintf(out, "  bne $t8, $0, _float_pack\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $a0, $a0, 1\n");
+  fprintf(out, "  addiu $v1, $v1, -1\n");
+  fprintf(out, "  b _float_add_normalize\n");
+  fprintf(out, "  nop\n\n");
+}
+
+void MIPS32::insert_float_mul()
+{
+  // $a0 * $a1 to $v0.
+  fprintf(out, "_float_mul:\n");
+  fprintf(out, "  xor $v0, $a0, $a1\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  and $v0, $v0, $t8\n");
+  fprintf(out, "  srl $v1, $a0, 23\n");
+  fprintf(out, "  andi $v1, $v1, 0xff\n");
+  fprintf(out, "  srl $a2, $a1, 23\n");
+  fprintf(out, "  andi $a2, $a2, 0xff\n");
+  fprintf(out, "  addiu $t8, $v1, -255\n");
+  fprintf(out, "  beq $t8, $0, _float_mul_special\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addiu $t8, $a2, -255\n");
+  fprintf(out, "  beq $t8, $0, _float_mul_special\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $v1, $0, _float_mul_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $a2, $0, _float_mul_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addu $v1, $v1, $a2\n");
+  fprintf(out, "  addiu $v1, $v1, -127\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  sll $a0, $a0, 8\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  li $t8, 0x7fffff\n");
+  fprintf(out, "  and $a1, $a1, $t8\n");
+  fprintf(out, "  lui $t8, 0x80\n");
+  fprintf(out, "  or $a1, $a1, $t8\n");
+  fprintf(out, "  multu $a0, $a1\n");
+  fprintf(out, "  mfhi $a0\n");
+  fprintf(out, "  mflo $a1\n");
+  // The product's top bit is bit 55 or 54.  Move it to bit 30.
+  fprintf(out, "  lui $t8, 0x80\n");
+  fprintf(out, "  and $t8, $a0, $t8\n");
+  fprintf(out, "  beq $t8, $0, _float_mul_54\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addiu $v1, $v1, 1\n");
+  fprintf(out, "  srl $t8, $a1, 25\n");
+  fprintf(out, "  sll $a0, $a0, 7\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  sll $a1, $a1, 7\n");
+  fprintf(out, "  b _float_mul_sticky\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_mul_54:\n");
+  fprintf(out, "  srl $t8, $a1, 24\n");
+  fprintf(out, "  sll $a0, $a0, 8\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  sll $a1, $a1, 8\n");
+  fprintf(out, "_float_mul_sticky:\n");
+  fprintf(out, "  sltu $a1, $0, $a1\n");
+  fprintf(out, "  or $a0, $a0, $a1\n");
+  fprintf(out, "  b _float_pack\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_mul_special:\n");
+  // NaN if either is NaN or it's inf * 0, otherwise inf.
+  fprintf(out, "  li $t9, 0xff000000\n");
+  fprintf(out, "  sll $t8, $a0, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $t8, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $t8, $a1, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $t8, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  lui $t8, 0x7f80\n");
+  fprintf(out, "  or $v0, $v0, $t8\n");
+  fprintf(out, "_float_mul_zero:\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n\n");
+}
+
+void MIPS32::insert_float_div()
+{
+  // $a0 / $a1 to $v0.
+  fprintf(out, "_float_div:\n");
+  fprintf(out, "  xor $v0, $a0, $a1\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  and $v0, $v0, $t8\n");
+  fprintf(out, "  srl $v1, $a0, 23\n");
+  fprintf(out, "  andi $v1, $v1, 0xff\n");
+  fprintf(out, "  srl $a2, $a1, 23\n");
+  fprintf(out, "  andi $a2, $a2, 0xff\n");
+  fprintf(out, "  li $t9, 0xff000000\n");
+  fprintf(out, "  sll $t8, $a0, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $t8, $a1, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addiu $t8, $v1, -255\n");
+  fprintf(out, "  bne $t8, $0, _float_div_a_finite\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  addiu $t8, $a2, -255\n");
+  fprintf(out, "  beq $t8, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  b _float_div_inf\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_div_a_finite:\n");
+  fprintf(out, "  addiu $t8, $a2, -255\n");
+  fprintf(out, "  beq $t8, $0, _float_div_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $a2, $0, _float_div_by_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  beq $v1, $0, _float_div_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  subu $v1, $v1, $a2\n");
+  fprintf(out, "  addiu $v1, $v1, 127\n");
+  fprintf(out, "  li $t8, 0x7fffff\n");
+  fprintf(out, "  and $a0, $a0, $t8\n");
+  fprintf(out, "  and $a1, $a1, $t8\n");
+  fprintf(out, "  lui $t8, 0x80\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  or $a1, $a1, $t8\n");
+  fprintf(out, "  sltu $t8, $a0, $a1\n");
+  fprintf(out, "  beq $t8, $0, _float_div_start\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $a0, $a0, 1\n");
+  fprintf(out, "  addiu $v1, $v1, -1\n");
+  fprintf(out, "_float_div_start:\n");
+  // 31 quotient bits so the first (always 1) ends up at bit 30.
+  fprintf(out, "  move $a2, $0\n");
+  fprintf(out, "  li $t9, 31\n");
+  fprintf(out, "_float_div_loop:\n");
+  fprintf(out, "  sll $a2, $a2, 1\n");
+  fprintf(out, "  sltu $t8, $a0, $a1\n");
+  fprintf(out, "  bne $t8, $0, _float_div_next\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  subu $a0, $a0, $a1\n");
+  fprintf(out, "  ori $a2, $a2, 1\n");
+  fprintf(out, "_float_div_next:\n");
+  fprintf(out, "  sll $a0, $a0, 1\n");
+  fprintf(out, "  addiu $t9, $t9, -1\n");
+  fprintf(out, "  bne $t9, $0, _float_div_loop\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltu $a0, $0, $a0\n");
+  fprintf(out, "  or $a0, $a2, $a0\n");
+  fprintf(out, "  b _float_pack\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_div_by_zero:\n");
+  fprintf(out, "  beq $v1, $0, _float_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_div_inf:\n");
+  fprintf(out, "  lui $t8, 0x7f80\n");
+  fprintf(out, "  or $v0, $v0, $t8\n");
+  fprintf(out, "_float_div_zero:\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n\n");
+}
 
-  get_values_from_stack(&value_reg, &index_reg);
+void MIPS32::insert_int_to_float()
+{
+  // (float)$a0 to $v0.
+  fprintf(out, "_int_to_float:\n");
+  fprintf(out, "  move $v0, $0\n");
+  fprintf(out, "  bne $a0, $0, _int_to_float_not_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_int_to_float_not_zero:\n");
+  fprintf(out, "  bgez $a0, _int_to_float_positive\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  lui $v0, 0x8000\n");
+  fprintf(out, "  subu $a0, $0, $a0\n");
+  fprintf(out, "_int_to_float_positive:\n");
+  fprintf(out, "  li $v1, 158\n");
+  fprintf(out, "_int_to_float_normalize:\n");
+  fprintf(out, "  bltz $a0, _int_to_float_round\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $a0, $a0, 1\n");
+  fprintf(out, "  addiu $v1, $v1, -1\n");
+  fprintf(out, "  b _int_to_float_normalize\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_int_to_float_round:\n");
+  fprintf(out, "  andi $t8, $a0, 1\n");
+  fprintf(out, "  srl $a0, $a0, 1\n");
+  fprintf(out, "  or $a0, $a0, $t8\n");
+  fprintf(out, "  b _float_pack\n");
+  fprintf(out, "  nop\n\n");
+}
+
+void MIPS32::insert_float_to_int()
+{
+  // (int)$a0 to $v0 rounding toward 0.  NaN is 0 and anything too big
+  // is clamped like Java does.
+  fprintf(out, "_float_to_int:\n");
+  fprintf(out, "  srl $v1, $a0, 23\n");
+  fprintf(out, "  andi $v1, $v1, 0xff\n");
+  fprintf(out, "  sltiu $t8, $v1, 127\n");
+  fprintf(out, "  bne $t8, $0, _float_to_int_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sltiu $t8, $v1, 158\n");
+  fprintf(out, "  bne $t8, $0, _float_to_int_shift\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  li $t9, 0xff000000\n");
+  fprintf(out, "  sll $t8, $a0, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_to_int_zero\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  lui $v0, 0x8000\n");
+  fprintf(out, "  bltz $a0, _float_to_int_return\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  li $v0, 0x7fffffff\n");
+  fprintf(out, "_float_to_int_return:\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_to_int_shift:\n");
+  fprintf(out, "  lui $t8, 0x8000\n");
+  fprintf(out, "  sll $v0, $a0, 8\n");
+  fprintf(out, "  or $v0, $v0, $t8\n");
+  fprintf(out, "  li $t8, 158\n");
+  fprintf(out, "  subu $t8, $t8, $v1\n");
+  fprintf(out, "  srlv $v0, $v0, $t8\n");
+  fprintf(out, "  bgez $a0, _float_to_int_return\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  subu $v0, $0, $v0\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_to_int_zero:\n");
+  fprintf(out, "  move $v0, $0\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n\n");
+}
 
-  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
-  fprintf(out, "  sll $t%d, $t%d, 1\n", index_reg, index_reg);
-  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-  fprintf(out, "  sh $t%d, 0($at)\n", value_reg);
+void MIPS32::insert_float_compare()
+{
+  // fcmpl / fcmpg: -1, 0 or 1 in $v0 comparing $a0 to $a1.  They only
+  // differ in what NaN gives.
+  fprintf(out, "_float_cmpg:\n");
+  fprintf(out, "  li $v1, 1\n");
+  fprintf(out, "  b _float_compare\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_cmpl:\n");
+  fprintf(out, "  li $v1, -1\n");
+  fprintf(out, "_float_compare:\n");
+  fprintf(out, "  li $t9, 0xff000000\n");
+  fprintf(out, "  sll $t8, $a0, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_compare_nan\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  sll $t8, $a1, 1\n");
+  fprintf(out, "  sltu $at, $t9, $t8\n");
+  fprintf(out, "  bne $at, $0, _float_compare_nan\n");
+  fprintf(out, "  nop\n");
+  // -0 and 0 are equal.
+  fprintf(out, "  or $t8, $a0, $a1\n");
+  fprintf(out, "  sll $t8, $t8, 1\n");
+  fprintf(out, "  bne $t8, $0, _float_compare_numbers\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move $v0, $0\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_compare_numbers:\n");
+  // Flip the magnitude of negative numbers so a signed compare works.
+  fprintf(out, "  sra $t8, $a0, 31\n");
+  fprintf(out, "  srl $t8, $t8, 1\n");
+  fprintf(out, "  xor $a0, $a0, $t8\n");
+  fprintf(out, "  sra $t8, $a1, 31\n");
+  fprintf(out, "  srl $t8, $t8, 1\n");
+  fprintf(out, "  xor $a1, $a1, $t8\n");
+  fprintf(out, "  slt $t8, $a0, $a1\n");
+  fprintf(out, "  slt $v0, $a1, $a0\n");
+  fprintf(out, "  subu $v0, $v0, $t8\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_compare_nan:\n");
+  fprintf(out, "  move $v0, $v1\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n\n");
+}
 
-  return 0;
+void MIPS32::insert_float_pack()
+{
+  // Shared end of the soft float routines.  $a0 is the mantissa with the
+  // hidden bit at bit 30 and 7 more bits (the lowest one sticky) below it,
+  // $v1 the exponent and $v0 the sign.  Rounds to nearest even and puts
+  // the float together in $v0.  Anything too small for a normal float
+  // becomes 0.
+  fprintf(out, "_float_pack:\n");
+  fprintf(out, "  andi $t8, $a0, 0x7f\n");
+  fprintf(out, "  srl $a0, $a0, 7\n");
+  fprintf(out, "  sltiu $t9, $t8, 0x41\n");
+  fprintf(out, "  beq $t9, $0, _float_pack_round_up\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  xori $t8, $t8, 0x40\n");
+  fprintf(out, "  bne $t8, $0, _float_pack_exponent\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  andi $t8, $a0, 1\n");
+  fprintf(out, "  beq $t8, $0, _float_pack_exponent\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_pack_round_up:\n");
+  fprintf(out, "  addiu $a0, $a0, 1\n");
+  fprintf(out, "_float_pack_exponent:\n");
+  fprintf(out, "  blez $v1, _float_pack_done\n");
+  fprintf(out, "  nop\n");
+  // The hidden bit (and a carry out of rounding) adds 1 to the exponent.
+  fprintf(out, "  addiu $v1, $v1, -1\n");
+  fprintf(out, "  sll $v1, $v1, 23\n");
+  fprintf(out, "  addu $a0, $a0, $v1\n");
+  fprintf(out, "  lui $t8, 0x7f80\n");
+  fprintf(out, "  sltu $t9, $a0, $t8\n");
+  fprintf(out, "  bne $t9, $0, _float_pack_in_range\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "  move $a0, $t8\n");
+  fprintf(out, "_float_pack_in_range:\n");
+  fprintf(out, "  or $v0, $v0, $a0\n");
+  fprintf(out, "_float_pack_done:\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n");
+  fprintf(out, "_float_nan:\n");
+  fprintf(out, "  li $v0, 0x7fc00000\n");
+  fprintf(out, "  jr $ra\n");
+  fprintf(out, "  nop\n\n");
 }
 
-int MIPS32::array_write_int(const char *name, int field_id)
+int MIPS32::get_field(const char *instr, int offset)
 {
-  int value_reg;
-  int index_reg;
+  const char *ref = pop_word("$t8");
 
-  get_values_from_stack(&value_reg, &index_reg);
+  // The field goes where the reference was when it's in a register.
+  const char *value = stack == 0 && reg < reg_max ? stack_regs[reg] : "$t8";
 
-  fprintf(out, "  lw $at, %d($s1)\n", field_id * 4);
-  fprintf(out, "  sll $t%d, $t%d, 2\n", index_reg, index_reg);
-  fprintf(out, "  addu $at, $at, $t%d\n", index_reg);
-  fprintf(out, "  sw $t%d, 0($at)\n", value_reg);
+  fprintf(out, "  %s %s, %d(%s)\n", instr, value, offset, ref);
+  push_word(value);
 
   return 0;
 }
 
-int MIPS32::cpu_nop()
+int MIPS32::put_field(const char *instr, int offset)
 {
-  fprintf(out, "  nop\n");
+  const char *value = pop_word("$t8");
+  const char *ref = pop_word("$t9");
+
+  fprintf(out, "  %s %s, %d(%s)\n", instr, value, offset, ref);
+
   return 0;
 }
 
-int MIPS32::stack_alu(const char *instr)
+const char *MIPS32::pop_word(const char *scratch)
 {
-  if (stack == 0)
-  {
-    fprintf(out, "  %s $t%d, $t%d, $t%d\n", instr, REG_STACK(reg-2), REG_STACK(reg-2), REG_STACK(reg-1));
-    reg--;
-  }
-    else
-  if (stack == 1)
-  {
-    STACK_POP(8);
-    fprintf(out, "  %s $t%d, $t%d, $t8\n", instr, REG_STACK(reg-1), REG_STACK(reg-1));
-  }
-    else
+  // Returns the register the top of the stack is in.  Spilled values
+  // are loaded into scratch.
+  if (stack > 0)
   {
-    STACK_POP(8);
-    STACK_POP(9);
-    fprintf(out, "  %s $t9, $t9, $t8\n", instr);
-    STACK_PUSH(9);
+    fprintf(out, "  lw %s, 0($sp)\n", scratch);
+    fprintf(out, "  addiu $sp, $sp, 4\n");
+    stack--;
+    return scratch;
   }
 
-  return 0;
+  reg--;
+
+  return stack_regs[reg];
 }
 
-int MIPS32::divide()
+void MIPS32::push_word(const char *r)
 {
-  int rs, rt;
-
-  if (stack > 0)
-  {
-    STACK_POP(8);
-    rt = 8;
-  }
-    else
+  if (stack == 0 && reg < reg_max)
   {
-    rt = reg - 1;
-    reg--;
-  }
+    if (strcmp(r, stack_regs[reg]) != 0)
+    {
+      fprintf(out, "  move %s, %s\n", stack_regs[reg], r);
+    }
 
-  if (stack > 0)
-  {
-    STACK_POP(9);
-    rs = 9;
+    reg++;
   }
     else
   {
-    rs = reg - 1;
-    reg--;
+    fprintf(out, "  addiu $sp, $sp, -4\n");
+    fprintf(out, "  sw %s, 0($sp)\n", r);
+    stack++;
   }
-
-  // MIPS manual says DIV needs a couple instructions before the mfhi / mflo.
-  fprintf(out, "  div $t%d, $t%d\n", rs, rt);
-  fprintf(out, "  nop\n");
-  fprintf(out, "  nop\n");
-
-  return 0;
 }
 
-
 int MIPS32::get_values_from_stack(int *value)
 {
   if (stack > 0)
@@ -1562,7 +3037,7 @@ int MIPS32::get_values_from_stack(int *value1, int *value2)
   if (stack > 0)
   {
     STACK_POP(9);
-    *value2 = 8;
+    *value2 = 9;
   }
     else
   {
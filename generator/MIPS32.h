@@ -23,7 +23,7 @@
 
 // pop = read value, then subtract 4
 #define STACK_POP(t) \
-  fprintf(out, "  lw $%d, 0($sp)\n", t); \
+  fprintf(out, "  lw $t%d, 0($sp)\n", t); \
   fprintf(out, "  addi $sp, $sp, 4\n"); \
   stack--;
 
@@ -34,6 +34,10 @@ public:
   virtual ~MIPS32();
 
   virtual int open(const char *filename);
+  virtual Encoder *new_encoder();
+  virtual Cycles *new_cycles();
+  virtual int get_instruction_size() { return 4; }
+  virtual int get_cpu_byte_alignment() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -43,16 +47,23 @@ public:
   virtual void method_end(int local_count);
   virtual int push_local_var_int(int index);
   virtual int push_local_var_ref(int index);
+  virtual int push_local_var_long(int index);
+  virtual int push_local_var_float(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
+  virtual int get_local_register_count() { return 6; }
+  virtual int get_spilled() { return stack; }
+  virtual void set_local_registers(const int *local_regs, int local_count);
   //virtual int set_integer_local(int index, int value);
   virtual int push_int(int32_t n);
-  //virtual int push_long(int64_t n);
-  //virtual int push_float(float f);
+  virtual int push_long(int64_t n);
+  virtual int push_float(float f);
   //virtual int push_double(double f);
   virtual int push_ref(char *name);
   virtual int pop_local_var_int(int index);
   virtual int pop_local_var_ref(int index);
+  virtual int pop_local_var_long(int index);
+  virtual int pop_local_var_float(int index);
   virtual int pop();
   virtual int dup();
   virtual int dup2();
@@ -80,19 +91,56 @@ public:
   virtual int inc_integer(int index, int num);
   virtual int integer_to_byte();
   virtual int integer_to_short();
+  virtual int add_long();
+  virtual int sub_long();
+  virtual int mul_long();
+  virtual int div_long();
+  virtual int mod_long();
+  virtual int neg_long();
+  virtual int shift_left_long();
+  virtual int shift_left_long(int count);
+  virtual int shift_right_long();
+  virtual int shift_right_long(int count);
+  virtual int shift_right_ulong();
+  virtual int shift_right_ulong(int count);
+  virtual int and_long();
+  virtual int or_long();
+  virtual int xor_long();
+  virtual int integer_to_long();
+  virtual int long_to_integer();
+  virtual int compare_longs();
+  virtual int add_float();
+  virtual int sub_float();
+  virtual int mul_float();
+  virtual int div_float();
+  virtual int neg_float();
+  virtual int float_to_integer();
+  virtual int integer_to_float();
+  virtual int compare_floats(int cond);
   virtual int jump_cond(const char *label, int cond, int distance);
   virtual int jump_cond_integer(const char *label, int cond, int distance);
   virtual int ternary(int cond, int value_true, int value_false);
   virtual int ternary(int cond, int compare, int value_true, int value_false);
   virtual int return_local(int index, int local_count);
   virtual int return_integer(int local_count);
+  virtual int return_long(int local_count);
+  virtual int return_float(int local_count);
   virtual int return_void(int local_count);
   virtual int jump(const char *name, int distance);
   virtual int call(const char *name);
   virtual int invoke_static_method(const char *name, int params, int is_void);
+  virtual int invoke_static_method_long(const char *name, int params);
   virtual int put_static(const char *name, int index);
   virtual int get_static(const char *name, int index);
   virtual int brk();
+  virtual int new_object(const char *object_name, int object_size);
+  virtual int get_field_byte(int offset);
+  virtual int get_field_short(int offset);
+  virtual int get_field_char(int offset);
+  virtual int get_field_int(int offset);
+  virtual int put_field_byte(int offset);
+  virtual int put_field_short(int offset);
+  virtual int put_field_int(int offset);
   virtual int new_array(uint8_t type);
   virtual int insert_array(const char *name, int32_t *data, int len, uint8_t type);
   virtual int insert_string(const char *name, uint8_t *bytes, int len);
@@ -101,17 +149,27 @@ public:
   virtual int array_read_byte();
   virtual int array_read_short();
   virtual int array_read_int();
+  virtual int array_read_float();
   virtual int array_read_byte(const char *name, int field_id);
   virtual int array_read_short(const char *name, int field_id);
   virtual int array_read_int(const char *name, int field_id);
+  virtual int array_read_float(const char *name, int field_id);
   virtual int array_write_byte();
   virtual int array_write_short();
   virtual int array_write_int();
+  virtual int array_write_float();
   virtual int array_write_byte(const char *name, int field_id);
   virtual int array_write_short(const char *name, int field_id);
   virtual int array_write_int(const char *name, int field_id);
+  virtual int array_write_float(const char *name, int field_id);
   virtual int cpu_nop();
 
+  // Fixed point functions
+  virtual int fixed_mul8_II();
+  virtual int fixed_div8_II();
+  virtual int fixed_mul16_II();
+  virtual int fixed_div16_II();
+
 protected:
   int reg;            // count number of registers are are using as stack
   int reg_max;        // size of register stack 
@@ -124,13 +182,41 @@ protected:
 
 private:
   int stack_alu(const char *instr);
+  int stack_alu_long(const char *instr);
   int divide();
+  int multiply_fixed(int shift);
+  int call_runtime(const char *name, int words);
+  int get_field(const char *instr, int offset);
+  int put_field(const char *instr, int offset);
+  int invoke_static(const char *name, int params, int words);
+  const char *pop_word(const char *scratch);
+  void push_word(const char *r);
   int get_values_from_stack(int *value1);
   int get_values_from_stack(int *value1, int *value2);
   int get_ref_from_stack(int *value1);
   int set_constant(int reg, int value);
+  int get_local_reg(int index);
+  void restore_local_regs(int local_count);
+  void insert_div_longs();
+  void insert_float_add();
+  void insert_float_mul();
+  void insert_float_div();
+  void insert_int_to_float();
+  void insert_float_to_int();
+  void insert_float_compare();
+  void insert_float_pack();
+
+  int8_t local_reg[256]; // $s2 to $s7 holding a local, or -1
+  int saved_regs;         // how many $s registers this method saves
 
   bool is_main : 1;
+  bool need_div_longs : 1;
+  bool need_float_add : 1;
+  bool need_float_mul : 1;
+  bool need_float_div : 1;
+  bool need_int_to_float : 1;
+  bool need_float_to_int : 1;
+  bool need_float_compare : 1;
 };
 
 #endif
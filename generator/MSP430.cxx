@@ -14,6 +14,9 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "CyclesMSP430.h"
+#include "EncoderMSP430.h"
+#include "MethodIR.h"
 #include "MSP430.h"
 #include "MSP430X.h"
 
@@ -40,7 +43,10 @@
 // [ b ]
 // [ a ]
 //
-// ret value is r15
+// ret value is r15 (a float is r15:r14, high word in r15)
+//
+// A float is 2 words on the Java stack (low word pushed first) and 2
+// words in the locals.
 
 // RAM organization:
 // RAM[0] = top of heap ptr
@@ -49,7 +55,7 @@
 // RAM[N] = static field N
 
 #define REG_STACK(a) (a + 4)
-#define LOCALS(a) ((a * 2) + 2)
+#define LOCALS(a) (local_offsets[a])
 
 //                                EQ    NE     LESS  LESS EQ GR   GR E
 static const char *cond_str[] = { "jz", "jnz", "jl", "jle", "jg", "jge" };
@@ -62,10 +68,20 @@ MSP430::MSP430(uint8_t chip_type) :
   label_count(0),
   need_read_spi(0),
   need_mul_integers(0),
+  need_mul_fixed(0),
   need_div_integers(0),
+  need_div_fixed(0),
+  need_float_add(0),
+  need_float_mul(0),
+  need_float_div(0),
+  need_int_to_float(0),
+  need_float_to_int(0),
+  need_float_compare(0),
   need_timer_interrupt(0),
   is_main(0),
-  is_interrupt(0)
+  is_interrupt(0),
+  local_offsets(NULL),
+  locals_size(0)
 {
   ram_start = 0x0200;
   vector_timer = 0xfff2;
@@ -95,7 +111,20 @@ MSP430::~MSP430()
 {
   if (need_read_spi) { insert_read_spi(); }
   if (need_mul_integers) { insert_mul_integers(); }
+  if (need_mul_fixed) { insert_mul_fixed(); }
   if (need_div_integers) { insert_div_integers(); }
+  if (need_div_fixed) { insert_div_fixed(); }
+  if (need_float_add) { insert_float_add(); }
+  if (need_float_mul) { insert_float_mul(); }
+  if (need_float_div) { insert_float_div(); }
+  if (need_int_to_float) { insert_int_to_float(); }
+  if (need_float_to_int) { insert_float_to_int(); }
+  if (need_float_compare) { insert_float_compare(); }
+
+  if (need_float_add || need_float_mul || need_float_div || need_int_to_float)
+  {
+    insert_float_pack();
+  }
 
   if (need_timer_interrupt)
   {
@@ -105,6 +134,8 @@ MSP430::~MSP430()
 
   fprintf(out, ".org 0xfffe\n");
   fprintf(out, "  dw start\n\n");
+
+  free(local_offsets);
 }
 
 int MSP430::open(const char *filename)
@@ -124,6 +155,16 @@ int MSP430::open(const char *filename)
   return 0;
 }
 
+Encoder *MSP430::new_encoder()
+{
+  return new EncoderMSP430();
+}
+
+Cycles *MSP430::new_cycles()
+{
+  return new CyclesMSP430();
+}
+
 int MSP430::start_init()
 {
   // Add any set up items (stack, registers, etc)
@@ -198,7 +239,31 @@ void MSP430::method_start(int local_count, int max_stack, int param_count, const
 
   if (!is_main) { fprintf(out, "  push r12\n"); }
   fprintf(out, "  mov.w SP, r12\n");
-  fprintf(out, "  sub.w #0x%x, SP\n", local_count * 2);
+  fprintf(out, "  sub.w #0x%x, SP\n", locals_size * 2);
+}
+
+void MSP430::set_local_types(const uint8_t *local_types, int local_count)
+{
+  int n;
+
+  // A local that is ever a float takes 2 words so each one gets its own
+  // offset from r12.  Params are laid out the same way by the caller.
+  local_offsets = (int *)realloc(local_offsets, (local_count + 1) * sizeof(int));
+  locals_size = 0;
+
+  for (n = 0; n < local_count; n++)
+  {
+    local_offsets[n] = (locals_size * 2) + 2;
+
+    if (local_types[n] == JAVA_TYPE_FLOAT || local_types[n] == IR_TYPE_MIXED)
+    {
+      locals_size += 2;
+    }
+      else
+    {
+      locals_size++;
+    }
+  }
 }
 
 void MSP430::method_end(int local_count)
@@ -232,6 +297,18 @@ int MSP430::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int MSP430::push_local_var_float(int index)
+{
+  char local[32];
+
+  sprintf(local, "-%d(r12)", LOCALS(index));
+  push_reg(local);
+  sprintf(local, "-%d(r12)", LOCALS(index) + 2);
+  push_reg(local);
+
+  return 0;
+}
+
 int MSP430::push_ref_static(const char *name, int index)
 {
   if (reg < reg_max)
@@ -279,13 +356,19 @@ int MSP430::push_int(int32_t n)
   return 0;
 }
 
-# if 0
-int MSP430::push_long(int64_t n)
+int MSP430::push_float(float f)
 {
-  return -1;
+  uint32_t *data = (uint32_t *)&f;
+
+  fprintf(out, "  ;; push_float(%f)\n", f);
+
+  if (push_int(*data & 0xffff) != 0) { return -1; }
+
+  return push_int(*data >> 16);
 }
 
-int MSP430::push_float(float f)
+# if 0
+int MSP430::push_long(int64_t n)
 {
   return -1;
 }
@@ -339,6 +422,14 @@ int MSP430::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int MSP430::pop_local_var_float(int index)
+{
+  fprintf(out, "  mov.w %s, -%d(r12)\n", pop_reg(), LOCALS(index) + 2);
+  fprintf(out, "  mov.w %s, -%d(r12)\n", pop_reg(), LOCALS(index));
+
+  return 0;
+}
+
 int MSP430::set_integer_local(int index, int value)
 {
   // Optimization to remove Java stack operations
@@ -394,8 +485,30 @@ int MSP430::dup()
 
 int MSP430::dup2()
 {
-  printf("Need to implement dup2()\n");
-  return -1;
+  char source[16];
+  int n;
+
+  // Pushing the second entry twice copies both in order.
+  for (n = 0; n < 2; n++)
+  {
+    if (stack >= 2)
+    {
+      strcpy(source, "2(SP)");
+    }
+      else
+    if (stack == 1)
+    {
+      sprintf(source, "r%d", REG_STACK(reg-1));
+    }
+      else
+    {
+      sprintf(source, "r%d", REG_STACK(reg-2));
+    }
+
+    push_reg(source);
+  }
+
+  return 0;
 }
 
 int MSP430::swap()
@@ -765,6 +878,61 @@ int MSP430::integer_to_short()
   return 0;
 }
 
+int MSP430::add_float()
+{
+  fprintf(out, "  ;; add_float()\n");
+  need_float_add = 1;
+  return call_float("_float_add");
+}
+
+int MSP430::sub_float()
+{
+  fprintf(out, "  ;; sub_float()\n");
+  need_float_add = 1;
+  return call_float("_float_sub");
+}
+
+int MSP430::mul_float()
+{
+  fprintf(out, "  ;; mul_float()\n");
+  need_float_mul = 1;
+  return call_float("_float_mul");
+}
+
+int MSP430::div_float()
+{
+  fprintf(out, "  ;; div_float()\n");
+  need_float_div = 1;
+  return call_float("_float_div");
+}
+
+int MSP430::neg_float()
+{
+  fprintf(out, "  ;; neg_float()\n");
+  fprintf(out, "  xor.w #0x8000, %s\n", top_reg());
+  return 0;
+}
+
+int MSP430::float_to_integer()
+{
+  fprintf(out, "  ;; float_to_integer()\n");
+  pop_float_regs("r15", "r14");
+  fprintf(out, "  call #_float_to_int\n");
+  push_reg("r15");
+  need_float_to_int = 1;
+  return 0;
+}
+
+int MSP430::integer_to_float()
+{
+  fprintf(out, "  ;; integer_to_float()\n");
+  fprintf(out, "  mov.w %s, r15\n", pop_reg());
+  fprintf(out, "  call #_int_to_float\n");
+  push_float_regs();
+  need_int_to_float = 1;
+  return 0;
+}
+
 int MSP430::jump_cond(const char *label, int cond, int distance)
 {
   bool reverse = false;
@@ -939,6 +1107,20 @@ int MSP430::jump_cond_integer(const char *label, int cond, int const_val, int di
   return 0;
 }
 
+int MSP430::compare_floats(int cond)
+{
+  fprintf(out, "  ;; compare_floats(%d)\n", cond);
+
+  // cond is 0 for fcmpl (NaN gives -1) and 1 for fcmpg (NaN gives 1).
+  pop_float_regs("r11", "r10");
+  pop_float_regs("r15", "r14");
+  fprintf(out, "  call #%s\n", cond == 0 ? "_float_cmpl" : "_float_cmpg");
+  push_reg("r15");
+  need_float_compare = 1;
+
+  return 0;
+}
+
 int MSP430::ternary(int cond, int value_true, int value_false)
 {
   bool reverse = false;
@@ -1080,6 +1262,16 @@ int MSP430::return_integer(int local_count)
   return 0;
 }
 
+int MSP430::return_float(int local_count)
+{
+  pop_float_regs("r15", "r14");
+  fprintf(out, "  mov.w r12, SP\n");
+  if (!is_main) { fprintf(out, "  pop r12\n"); }
+  fprintf(out, "  ret\n");
+
+  return 0;
+}
+
 int MSP430::return_void(int local_count)
 {
   fprintf(out, "  mov.w r12, SP\n");
@@ -1209,6 +1401,15 @@ int MSP430::invoke_static_method(const char *name, int params, int is_void)
   return 0;
 }
 
+int MSP430::invoke_static_method_float(const char *name, int params)
+{
+  if (invoke_static_method(name, params, 1) != 0) { return -1; }
+
+  push_float_regs();
+
+  return 0;
+}
+
 int MSP430::put_static(const char *name, int index)
 {
   if (stack > 0)
@@ -1249,6 +1450,67 @@ int MSP430::brk()
   return -1;
 }
 
+int MSP430::new_object(const char *object_name, int object_size)
+{
+  int n;
+
+  if (object_size == 0)
+  {
+    printf("Error: Unsupported class %s\n", object_name);
+    return -1;
+  }
+
+  // Objects come off the same heap as arrays, but without a length.
+  // Fields are laid out 32 bit so an int only uses the low word.
+  fprintf(out, "  mov.w &heap_ptr, r15\n");
+
+  for (n = 0; n < object_size; n += 2)
+  {
+    fprintf(out, "  mov.w #0, %d(r15)\n", n);
+  }
+
+  fprintf(out, "  add.w #%d, &heap_ptr\n", object_size);
+
+  push_reg("r15");
+
+  return 0;
+}
+
+int MSP430::get_field_byte(int offset)
+{
+  return get_field("b", offset, true);
+}
+
+int MSP430::get_field_short(int offset)
+{
+  return get_field("w", offset, false);
+}
+
+int MSP430::get_field_char(int offset)
+{
+  return get_field("w", offset, false);
+}
+
+int MSP430::get_field_int(int offset)
+{
+  return get_field("w", offset, false);
+}
+
+int MSP430::put_field_byte(int offset)
+{
+  return put_field("b", offset);
+}
+
+int MSP430::put_field_short(int offset)
+{
+  return put_field("w", offset);
+}
+
+int MSP430::put_field_int(int offset)
+{
+  return put_field("w", offset);
+}
+
 int MSP430::new_array(uint8_t type)
 {
   // ref = heap + 2
@@ -1267,7 +1529,10 @@ int MSP430::new_array(uint8_t type)
 
     // Maybe this can be optimized by detecting a new array and a constant
     // so the compile module can double / pad it and pass it here.
-    if (type == TYPE_SHORT || type == TYPE_CHAR || type == TYPE_INT)
+    if (type == TYPE_FLOAT) { fprintf(out, "  rla r14\n"); }
+
+    if (type == TYPE_SHORT || type == TYPE_CHAR || type == TYPE_INT ||
+        type == TYPE_FLOAT)
     {
       // if int or short double the len of array for space (16 bit)
       fprintf(out, "  rla r14\n");
@@ -1298,7 +1563,11 @@ int MSP430::new_array(uint8_t type)
     fprintf(out, "  mov.w &heap_ptr, r15\n");
     fprintf(out, "  mov.w r%d, 0(r15)\n", REG_STACK(reg-1));
 
-    if (type == TYPE_SHORT || type == TYPE_CHAR || type == TYPE_INT)
+    // Floats take 2 words.
+    if (type == TYPE_FLOAT) { fprintf(out, "  rla r%d\n", REG_STACK(reg-1)); }
+
+    if (type == TYPE_SHORT || type == TYPE_CHAR || type == TYPE_INT ||
+        type == TYPE_FLOAT)
     {
       // if int or short double the len of array for space (16 bit)
       fprintf(out, "  rla r%d\n", REG_STACK(reg-1));
@@ -1445,6 +1714,22 @@ int MSP430::array_read_int()
   return array_read_short();
 }
 
+int MSP430::array_read_float()
+{
+  int index_reg;
+  int ref_reg;
+
+  get_values_from_stack(&index_reg, &ref_reg);
+  fprintf(out, "  rla.w r%d\n", index_reg);
+  fprintf(out, "  rla.w r%d\n", index_reg);
+  fprintf(out, "  add.w r%d, r%d\n", index_reg, ref_reg);
+  fprintf(out, "  mov.w 2(r%d), r15\n", ref_reg);
+  fprintf(out, "  mov.w @r%d, r14\n", ref_reg);
+  push_float_regs();
+
+  return 0;
+}
+
 int MSP430::array_read_byte(const char *name, int field_id)
 {
   fprintf(out, "  mov.w &%s, r13\n", name);
@@ -1493,6 +1778,20 @@ int MSP430::array_read_int(const char *name, int field_id)
   return array_read_short(name, field_id);
 }
 
+int MSP430::array_read_float(const char *name, int field_id)
+{
+  fprintf(out, "  mov.w &%s, r13\n", name);
+  fprintf(out, "  mov.w %s, r15\n", pop_reg());
+  fprintf(out, "  rla.w r15\n");
+  fprintf(out, "  rla.w r15\n");
+  fprintf(out, "  add.w r15, r13\n");
+  fprintf(out, "  mov.w 2(r13), r15\n");
+  fprintf(out, "  mov.w @r13, r14\n");
+  push_float_regs();
+
+  return 0;
+}
+
 int MSP430::array_write_byte()
 {
   int value_reg;
@@ -1525,6 +1824,22 @@ int MSP430::array_write_int()
   return array_write_short();
 }
 
+int MSP430::array_write_float()
+{
+  int index_reg;
+  int ref_reg;
+
+  pop_float_regs("r11", "r10");
+  get_values_from_stack(&index_reg, &ref_reg);
+  fprintf(out, "  rla.w r%d\n", index_reg);
+  fprintf(out, "  rla.w r%d\n", index_reg);
+  fprintf(out, "  add.w r%d, r%d\n", index_reg, ref_reg);
+  fprintf(out, "  mov.w r10, 0(r%d)\n", ref_reg);
+  fprintf(out, "  mov.w r11, 2(r%d)\n", ref_reg);
+
+  return 0;
+}
+
 int MSP430::array_write_byte(const char *name, int field_id)
 {
   int value_reg;
@@ -1557,6 +1872,19 @@ int MSP430::array_write_int(const char *name, int field_id)
   return array_write_short(name, field_id);
 }
 
+int MSP430::array_write_float(const char *name, int field_id)
+{
+  pop_float_regs("r11", "r10");
+  fprintf(out, "  mov.w %s, r15\n", pop_reg());
+  fprintf(out, "  rla.w r15\n");
+  fprintf(out, "  rla.w r15\n");
+  fprintf(out, "  add.w &%s, r15\n", name);
+  fprintf(out, "  mov.w r10, 0(r15)\n");
+  fprintf(out, "  mov.w r11, 2(r15)\n");
+
+  return 0;
+}
+
 #if 0
 void MSP430::close()
 {
@@ -2182,6 +2510,48 @@ int MSP430::memory_write16_IS()
 }
 
 // Protected functions
+int MSP430::fixed_mul8_II()
+{
+  // b goes in r15 and a in r14 so the multiply is free to use r4 to r7.
+  fprintf(out, "  mov.w %s, r15\n", pop_reg());
+  fprintf(out, "  mov.w %s, r14\n", pop_reg());
+
+  multiply_fixed();
+
+  // Keep the middle 16 bits of the 32 bit product in r14:r15.
+  fprintf(out, "  swpb r15\n");
+  fprintf(out, "  and.w #0x00ff, r15\n");
+  fprintf(out, "  swpb r14\n");
+  fprintf(out, "  and.w #0xff00, r14\n");
+  fprintf(out, "  bis.w r14, r15\n");
+
+  push_reg("r15");
+
+  return 0;
+}
+
+int MSP430::fixed_div8_II()
+{
+  // b goes in r15 and a in r14, _div_fixed saves what it uses.
+  fprintf(out, "  mov.w %s, r15\n", pop_reg());
+  fprintf(out, "  mov.w %s, r14\n", pop_reg());
+  fprintf(out, "  call #_div_fixed\n");
+
+  push_reg("r15");
+
+  need_div_fixed = 1;
+
+  return 0;
+}
+
+void MSP430::multiply_fixed()
+{
+  fprintf(out, "  call #_mul_fixed\n");
+
+  need_mul_fixed = 1;
+  need_mul_integers = 1;
+}
+
 void MSP430::push_reg(const char *dst)
 {
   if (reg < reg_max)
@@ -2196,6 +2566,30 @@ void MSP430::push_reg(const char *dst)
   }
 }
 
+void MSP430::pop_float_regs(const char *hi, const char *lo)
+{
+  fprintf(out, "  mov.w %s, %s\n", pop_reg(), hi);
+  fprintf(out, "  mov.w %s, %s\n", pop_reg(), lo);
+}
+
+void MSP430::push_float_regs()
+{
+  push_reg("r14");
+  push_reg("r15");
+}
+
+int MSP430::call_float(const char *function)
+{
+  // b goes in r11:r10 and a in r15:r14 (high word first).  The result
+  // comes back in r15:r14 and the routine saves the registers it uses.
+  pop_float_regs("r11", "r10");
+  pop_float_regs("r15", "r14");
+  fprintf(out, "  call #%s\n", function);
+  push_float_regs();
+
+  return 0;
+}
+
 void MSP430::pop_reg(char *dst)
 {
   if (stack > 0)
@@ -2331,6 +2725,26 @@ void MSP430::insert_mul_integers()
   fprintf(out, "  ret\n\n");
 }
 
+void MSP430::insert_mul_fixed()
+{
+  // _mul_integers leaves the 32 bit product in r7:r15.
+  fprintf(out, "; _mul_fixed r14 * r15 (32 bit product in r14:r15)\n");
+  fprintf(out, "_mul_fixed:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  call #_mul_integers\n");
+  fprintf(out, "  mov r7, r14\n");
+  fprintf(out, "  pop r7\n");
+  fprintf(out, "  pop r6\n");
+  fprintf(out, "  pop r5\n");
+  fprintf(out, "  pop r4\n");
+  fprintf(out, "  ret\n\n");
+}
+
 void MSP430::insert_div_integers()
 {
   fprintf(out, "; _div a / b (remainder in r7)\n");
@@ -2351,6 +2765,677 @@ void MSP430::insert_div_integers()
   fprintf(out, "  ret\n");
 }
 
+void MSP430::insert_div_fixed()
+{
+  // (a << 8) / b as a 32 / 16 divide on the magnitudes so the shifted
+  // dividend can't overflow, then the sign of a ^ b is put back.
+  fprintf(out, "; _div_fixed (r14 << 8) / r15 (quotient in r15)\n");
+  fprintf(out, "_div_fixed:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  mov r14, r7\n");
+  fprintf(out, "  xor r15, r7\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  tst r14\n");
+  fprintf(out, "  jge _div_fixed1\n");
+  fprintf(out, "  inv r14\n");
+  fprintf(out, "  inc r14\n");
+  fprintf(out, "_div_fixed1:\n");
+  fprintf(out, "  tst r15\n");
+  fprintf(out, "  jge _div_fixed2\n");
+  fprintf(out, "  inv r15\n");
+  fprintf(out, "  inc r15\n");
+  fprintf(out, "_div_fixed2:\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  swpb r4\n");
+  fprintf(out, "  mov r4, r5\n");
+  fprintf(out, "  and #0xff00, r4\n");
+  fprintf(out, "  and #0x00ff, r5\n");
+  fprintf(out, "  mov #32, r6\n");
+  fprintf(out, "  clr r7\n");
+  fprintf(out, "_div_fixed3:\n");
+  fprintf(out, "  rla r4\n");
+  fprintf(out, "  rlc r5\n");
+  fprintf(out, "  rlc r7\n");
+  fprintf(out, "  cmp r15, r7\n");
+  fprintf(out, "  jlo _div_fixed4\n");
+  fprintf(out, "  sub r15, r7\n");
+  fprintf(out, "  bis #1, r4\n");
+  fprintf(out, "_div_fixed4:\n");
+  fprintf(out, "  dec r6\n");
+  fprintf(out, "  jnz _div_fixed3\n");
+  fprintf(out, "  mov r4, r15\n");
+  fprintf(out, "  pop r7\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jge _div_fixed5\n");
+  fprintf(out, "  inv r15\n");
+  fprintf(out, "  inc r15\n");
+  fprintf(out, "_div_fixed5:\n");
+  fprintf(out, "  pop r7\n");
+  fprintf(out, "  pop r6\n");
+  fprintf(out, "  pop r5\n");
+  fprintf(out, "  pop r4\n");
+  fprintf(out, "  ret\n\n");
+}
+
+void MSP430::insert_float_add()
+{
+  // IEEE-754 single precision r15:r14 + r11:r10 (or r15:r14 - r11:r10)
+  // to r15:r14.  Like the rest of the soft float, denormals are treated
+  // as 0.
+  fprintf(out, "; _float_add r15:r14 + r11:r10 (result in r15:r14)\n");
+  fprintf(out, "_float_sub:\n");
+  fprintf(out, "  xor #0x8000, r11\n");
+  fprintf(out, "_float_add:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  push r8\n");
+  fprintf(out, "  push r9\n");
+  // Make r15:r14 the one with the bigger magnitude.
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  and #0x7fff, r13\n");
+  fprintf(out, "  mov r11, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp r9, r13\n");
+  fprintf(out, "  jlo _float_add_swap\n");
+  fprintf(out, "  jne _float_add_ordered\n");
+  fprintf(out, "  cmp r10, r14\n");
+  fprintf(out, "  jhs _float_add_ordered\n");
+  fprintf(out, "_float_add_swap:\n");
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  mov r11, r15\n");
+  fprintf(out, "  mov r13, r11\n");
+  fprintf(out, "  mov r14, r13\n");
+  fprintf(out, "  mov r10, r14\n");
+  fprintf(out, "  mov r13, r10\n");
+  fprintf(out, "_float_add_ordered:\n");
+  fprintf(out, "  mov r15, r6\n");
+  fprintf(out, "  and #0x8000, r6\n");
+  fprintf(out, "  mov r15, r8\n");
+  fprintf(out, "  xor r11, r8\n");
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  swpb r13\n");
+  fprintf(out, "  and #0xff, r13\n");
+  fprintf(out, "  mov r11, r7\n");
+  fprintf(out, "  rla r7\n");
+  fprintf(out, "  swpb r7\n");
+  fprintf(out, "  and #0xff, r7\n");
+  fprintf(out, "  cmp #0xff, r13\n");
+  fprintf(out, "  jne _float_add_finite\n");
+  // a is inf or NaN.  inf - inf is NaN.
+  fprintf(out, "  bit #0x7f, r15\n");
+  fprintf(out, "  jnz _float_add_return_a\n");
+  fprintf(out, "  tst r14\n");
+  fprintf(out, "  jnz _float_add_return_a\n");
+  fprintf(out, "  cmp #0xff, r7\n");
+  fprintf(out, "  jne _float_add_return_a\n");
+  fprintf(out, "  bit #0x8000, r8\n");
+  fprintf(out, "  jz _float_add_return_a\n");
+  fprintf(out, "  jmp _float_nan\n");
+  fprintf(out, "_float_add_finite:\n");
+  fprintf(out, "  tst r13\n");
+  fprintf(out, "  jnz _float_add_a_normal\n");
+  // Both are 0 and the answer is only -0 if both are.
+  fprintf(out, "  and r11, r15\n");
+  fprintf(out, "  and #0x8000, r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  jmp _float_done\n");
+  fprintf(out, "_float_add_a_normal:\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jnz _float_add_b_normal\n");
+  fprintf(out, "_float_add_return_a:\n");
+  fprintf(out, "  jmp _float_done\n");
+  fprintf(out, "_float_add_b_normal:\n");
+  // Mantissas with the hidden bit at bit 30 leaving 7 bits for rounding.
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  and #0x7f, r5\n");
+  fprintf(out, "  bis #0x80, r5\n");
+  fprintf(out, "  swpb r5\n");
+  fprintf(out, "  swpb r4\n");
+  fprintf(out, "  mov.b r4, r9\n");
+  fprintf(out, "  bis r9, r5\n");
+  fprintf(out, "  and #0xff00, r4\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r5\n");
+  fprintf(out, "  rrc r4\n");
+  fprintf(out, "  and #0x7f, r11\n");
+  fprintf(out, "  bis #0x80, r11\n");
+  fprintf(out, "  swpb r11\n");
+  fprintf(out, "  swpb r10\n");
+  fprintf(out, "  mov.b r10, r9\n");
+  fprintf(out, "  bis r9, r11\n");
+  fprintf(out, "  and #0xff00, r10\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r11\n");
+  fprintf(out, "  rrc r10\n");
+  fprintf(out, "  mov r13, r9\n");
+  fprintf(out, "  sub r7, r9\n");
+  fprintf(out, "  cmp #31, r9\n");
+  fprintf(out, "  jlo _float_add_shift\n");
+  fprintf(out, "  clr r11\n");
+  fprintf(out, "  mov #1, r10\n");
+  fprintf(out, "  jmp _float_add_aligned\n");
+  fprintf(out, "_float_add_shift:\n");
+  fprintf(out, "  tst r9\n");
+  fprintf(out, "  jz _float_add_aligned\n");
+  // Bits shifted out of the smaller one are kept as a sticky bit.
+  fprintf(out, "  clr r7\n");
+  fprintf(out, "_float_add_shift_loop:\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r11\n");
+  fprintf(out, "  rrc r10\n");
+  fprintf(out, "  adc r7\n");
+  fprintf(out, "  dec r9\n");
+  fprintf(out, "  jnz _float_add_shift_loop\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jz _float_add_aligned\n");
+  fprintf(out, "  bis #1, r10\n");
+  fprintf(out, "_float_add_aligned:\n");
+  fprintf(out, "  bit #0x8000, r8\n");
+  fprintf(out, "  jnz _float_add_subtract\n");
+  fprintf(out, "  add r10, r4\n");
+  fprintf(out, "  addc r11, r5\n");
+  fprintf(out, "  bit #0x8000, r5\n");
+  fprintf(out, "  jz _float_pack\n");
+  fprintf(out, "  mov r4, r9\n");
+  fprintf(out, "  and #1, r9\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r5\n");
+  fprintf(out, "  rrc r4\n");
+  fprintf(out, "  bis r9, r4\n");
+  fprintf(out, "  inc r13\n");
+  fprintf(out, "  jmp _float_pack\n");
+  fprintf(out, "_float_add_subtract:\n");
+  fprintf(out, "  sub r10, r4\n");
+  fprintf(out, "  subc r11, r5\n");
+  fprintf(out, "  mov r4, r9\n");
+  fprintf(out, "  bis r5, r9\n");
+  fprintf(out, "  tst r9\n");
+  fprintf(out, "  jnz _float_add_normalize\n");
+  fprintf(out, "  clr r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  jmp _float_done\n");
+  fprintf(out, "_float_add_normalize:\n");
+  fprintf(out, "  bit #0x4000, r5\n");
+  fprintf(out, "  jnz _float_pack\n");
+  fprintf(out, "  rla r4\n");
+  fprintf(out, "  rlc r5\n");
+  fprintf(out, "  dec r13\n");
+  fprintf(out, "  jmp _float_add_normalize\n\n");
+}
+
+void MSP430::insert_float_mul()
+{
+  // r15:r14 * r11:r10 to r15:r14.  Shift and add since the smaller chips
+  // don't have a hardware multiplier.
+  fprintf(out, "; _float_mul r15:r14 * r11:r10 (result in r15:r14)\n");
+  fprintf(out, "_float_mul:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  push r8\n");
+  fprintf(out, "  push r9\n");
+  fprintf(out, "  mov r15, r6\n");
+  fprintf(out, "  xor r11, r6\n");
+  fprintf(out, "  and #0x8000, r6\n");
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  swpb r13\n");
+  fprintf(out, "  and #0xff, r13\n");
+  fprintf(out, "  mov r11, r7\n");
+  fprintf(out, "  rla r7\n");
+  fprintf(out, "  swpb r7\n");
+  fprintf(out, "  and #0xff, r7\n");
+  fprintf(out, "  cmp #0xff, r13\n");
+  fprintf(out, "  jeq _float_mul_special\n");
+  fprintf(out, "  cmp #0xff, r7\n");
+  fprintf(out, "  jeq _float_mul_special\n");
+  fprintf(out, "  tst r13\n");
+  fprintf(out, "  jz _float_mul_zero\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jz _float_mul_zero\n");
+  fprintf(out, "  add r7, r13\n");
+  fprintf(out, "  sub #127, r13\n");
+  // a's 24 bit mantissa in r5:r4, b's shifted up 8 in r11:r10 so its bits
+  // come out of the top one at a time.
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  and #0x7f, r5\n");
+  fprintf(out, "  bis #0x80, r5\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  and #0x7f, r11\n");
+  fprintf(out, "  bis #0x80, r11\n");
+  fprintf(out, "  swpb r11\n");
+  fprintf(out, "  swpb r10\n");
+  fprintf(out, "  mov.b r10, r9\n");
+  fprintf(out, "  bis r9, r11\n");
+  fprintf(out, "  and #0xff00, r10\n");
+  // 48 bit product in r9:r8:r7.
+  fprintf(out, "  clr r7\n");
+  fprintf(out, "  clr r8\n");
+  fprintf(out, "  clr r9\n");
+  fprintf(out, "  mov #24, r15\n");
+  fprintf(out, "_float_mul_loop:\n");
+  fprintf(out, "  rla r7\n");
+  fprintf(out, "  rlc r8\n");
+  fprintf(out, "  rlc r9\n");
+  fprintf(out, "  rla r10\n");
+  fprintf(out, "  rlc r11\n");
+  fprintf(out, "  jnc _float_mul_next\n");
+  fprintf(out, "  add r4, r7\n");
+  fprintf(out, "  addc r5, r8\n");
+  fprintf(out, "  adc r9\n");
+  fprintf(out, "_float_mul_next:\n");
+  fprintf(out, "  dec r15\n");
+  fprintf(out, "  jnz _float_mul_loop\n");
+  // The product's top bit is bit 47 or 46.  Move it to bit 30.
+  fprintf(out, "  bit #0x8000, r9\n");
+  fprintf(out, "  jz _float_mul_46\n");
+  fprintf(out, "  inc r13\n");
+  fprintf(out, "  bit #1, r8\n");
+  fprintf(out, "  jz _float_mul_47\n");
+  fprintf(out, "  bis #1, r7\n");
+  fprintf(out, "_float_mul_47:\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r9\n");
+  fprintf(out, "  rrc r8\n");
+  fprintf(out, "_float_mul_46:\n");
+  fprintf(out, "  mov r8, r4\n");
+  fprintf(out, "  mov r9, r5\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jz _float_pack\n");
+  fprintf(out, "  bis #1, r4\n");
+  fprintf(out, "  jmp _float_pack\n");
+  fprintf(out, "_float_mul_special:\n");
+  // NaN if either is NaN or it's inf * 0 (denormals count as 0),
+  // otherwise inf.
+  fprintf(out, "  mov r15, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r14\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_nan\n");
+  fprintf(out, "  bit #0x7f80, r15\n");
+  fprintf(out, "  jz _float_nan\n");
+  fprintf(out, "  mov r11, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r10\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_nan\n");
+  fprintf(out, "  bit #0x7f80, r11\n");
+  fprintf(out, "  jz _float_nan\n");
+  fprintf(out, "  bis #0x7f80, r6\n");
+  fprintf(out, "_float_mul_zero:\n");
+  fprintf(out, "  mov r6, r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  jmp _float_done\n\n");
+}
+
+void MSP430::insert_float_div()
+{
+  // r15:r14 / r11:r10 to r15:r14.
+  fprintf(out, "; _float_div r15:r14 / r11:r10 (result in r15:r14)\n");
+  fprintf(out, "_float_div:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  push r8\n");
+  fprintf(out, "  push r9\n");
+  fprintf(out, "  mov r15, r6\n");
+  fprintf(out, "  xor r11, r6\n");
+  fprintf(out, "  and #0x8000, r6\n");
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  swpb r13\n");
+  fprintf(out, "  and #0xff, r13\n");
+  fprintf(out, "  mov r11, r7\n");
+  fprintf(out, "  rla r7\n");
+  fprintf(out, "  swpb r7\n");
+  fprintf(out, "  and #0xff, r7\n");
+  fprintf(out, "  mov r15, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r14\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_nan\n");
+  fprintf(out, "  mov r11, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r10\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_nan\n");
+  fprintf(out, "  cmp #0xff, r13\n");
+  fprintf(out, "  jne _float_div_a_finite\n");
+  fprintf(out, "  cmp #0xff, r7\n");
+  fprintf(out, "  jeq _float_nan\n");
+  fprintf(out, "  jmp _float_div_inf\n");
+  fprintf(out, "_float_div_a_finite:\n");
+  fprintf(out, "  cmp #0xff, r7\n");
+  fprintf(out, "  jeq _float_div_zero\n");
+  fprintf(out, "  tst r7\n");
+  fprintf(out, "  jz _float_div_by_zero\n");
+  fprintf(out, "  tst r13\n");
+  fprintf(out, "  jz _float_div_zero\n");
+  fprintf(out, "  sub r7, r13\n");
+  fprintf(out, "  add #127, r13\n");
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  and #0x7f, r5\n");
+  fprintf(out, "  bis #0x80, r5\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  and #0x7f, r11\n");
+  fprintf(out, "  bis #0x80, r11\n");
+  fprintf(out, "  cmp r11, r5\n");
+  fprintf(out, "  jlo _float_div_shift\n");
+  fprintf(out, "  jne _float_div_start\n");
+  fprintf(out, "  cmp r10, r4\n");
+  fprintf(out, "  jhs _float_div_start\n");
+  fprintf(out, "_float_div_shift:\n");
+  fprintf(out, "  rla r4\n");
+  fprintf(out, "  rlc r5\n");
+  fprintf(out, "  dec r13\n");
+  fprintf(out, "_float_div_start:\n");
+  // 31 quotient bits so the first (always 1) ends up at bit 30.
+  fprintf(out, "  clr r8\n");
+  fprintf(out, "  clr r9\n");
+  fprintf(out, "  mov #31, r7\n");
+  fprintf(out, "_float_div_loop:\n");
+  fprintf(out, "  rla r8\n");
+  fprintf(out, "  rlc r9\n");
+  fprintf(out, "  mov r4, r14\n");
+  fprintf(out, "  mov r5, r15\n");
+  fprintf(out, "  sub r10, r14\n");
+  fprintf(out, "  subc r11, r15\n");
+  fprintf(out, "  jlo _float_div_next\n");
+  fprintf(out, "  mov r14, r4\n");
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  bis #1, r8\n");
+  fprintf(out, "_float_div_next:\n");
+  fprintf(out, "  rla r4\n");
+  fprintf(out, "  rlc r5\n");
+  fprintf(out, "  dec r7\n");
+  fprintf(out, "  jnz _float_div_loop\n");
+  // Anything left over is the sticky bit.
+  fprintf(out, "  tst r4\n");
+  fprintf(out, "  jnz _float_div_sticky\n");
+  fprintf(out, "  tst r5\n");
+  fprintf(out, "  jz _float_div_pack\n");
+  fprintf(out, "_float_div_sticky:\n");
+  fprintf(out, "  bis #1, r8\n");
+  fprintf(out, "_float_div_pack:\n");
+  fprintf(out, "  mov r8, r4\n");
+  fprintf(out, "  mov r9, r5\n");
+  fprintf(out, "  jmp _float_pack\n");
+  fprintf(out, "_float_div_by_zero:\n");
+  fprintf(out, "  tst r13\n");
+  fprintf(out, "  jz _float_nan\n");
+  fprintf(out, "_float_div_inf:\n");
+  fprintf(out, "  bis #0x7f80, r6\n");
+  fprintf(out, "_float_div_zero:\n");
+  fprintf(out, "  mov r6, r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  jmp _float_done\n\n");
+}
+
+void MSP430::insert_int_to_float()
+{
+  // (float)r15 to r15:r14.
+  fprintf(out, "; _int_to_float r15 (result in r15:r14)\n");
+  fprintf(out, "_int_to_float:\n");
+  fprintf(out, "  push r4\n");
+  fprintf(out, "  push r5\n");
+  fprintf(out, "  push r6\n");
+  fprintf(out, "  push r7\n");
+  fprintf(out, "  push r8\n");
+  fprintf(out, "  push r9\n");
+  fprintf(out, "  clr r6\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  tst r15\n");
+  fprintf(out, "  jz _float_done\n");
+  fprintf(out, "  jge _int_to_float_positive\n");
+  fprintf(out, "  mov #0x8000, r6\n");
+  fprintf(out, "  inv r15\n");
+  fprintf(out, "  inc r15\n");
+  fprintf(out, "_int_to_float_positive:\n");
+  fprintf(out, "  mov r15, r5\n");
+  fprintf(out, "  clr r4\n");
+  fprintf(out, "  mov #142, r13\n");
+  fprintf(out, "_int_to_float_normalize:\n");
+  fprintf(out, "  tst r5\n");
+  fprintf(out, "  jn _int_to_float_round\n");
+  fprintf(out, "  rla r5\n");
+  fprintf(out, "  dec r13\n");
+  fprintf(out, "  jmp _int_to_float_normalize\n");
+  fprintf(out, "_int_to_float_round:\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r5\n");
+  fprintf(out, "  rrc r4\n");
+  fprintf(out, "  jmp _float_pack\n\n");
+}
+
+void MSP430::insert_float_to_int()
+{
+  // (int)r15:r14 to r15 rounding toward 0.  NaN is 0 and anything that
+  // doesn't fit in 16 bits is clamped.
+  fprintf(out, "; _float_to_int r15:r14 (result in r15)\n");
+  fprintf(out, "_float_to_int:\n");
+  fprintf(out, "  mov r15, r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  swpb r13\n");
+  fprintf(out, "  and #0xff, r13\n");
+  fprintf(out, "  cmp #127, r13\n");
+  fprintf(out, "  jlo _float_to_int_zero\n");
+  fprintf(out, "  cmp #142, r13\n");
+  fprintf(out, "  jlo _float_to_int_shift\n");
+  fprintf(out, "  mov r15, r11\n");
+  fprintf(out, "  and #0x7fff, r11\n");
+  fprintf(out, "  cmp #1, r14\n");
+  fprintf(out, "  subc #0x7f80, r11\n");
+  fprintf(out, "  jhs _float_to_int_zero\n");
+  fprintf(out, "  tst r15\n");
+  fprintf(out, "  mov #0x7fff, r15\n");
+  fprintf(out, "  jge _float_to_int_return\n");
+  fprintf(out, "  mov #0x8000, r15\n");
+  fprintf(out, "  ret\n");
+  fprintf(out, "_float_to_int_shift:\n");
+  // Top 16 bits of the mantissa, hidden bit at bit 15.
+  fprintf(out, "  mov r15, r11\n");
+  fprintf(out, "  and #0x7f, r11\n");
+  fprintf(out, "  bis #0x80, r11\n");
+  fprintf(out, "  swpb r11\n");
+  fprintf(out, "  swpb r14\n");
+  fprintf(out, "  and #0xff, r14\n");
+  fprintf(out, "  bis r14, r11\n");
+  fprintf(out, "  mov #142, r10\n");
+  fprintf(out, "  sub r13, r10\n");
+  fprintf(out, "_float_to_int_loop:\n");
+  fprintf(out, "  clrc\n");
+  fprintf(out, "  rrc r11\n");
+  fprintf(out, "  dec r10\n");
+  fprintf(out, "  jnz _float_to_int_loop\n");
+  fprintf(out, "  tst r15\n");
+  fprintf(out, "  jge _float_to_int_positive\n");
+  fprintf(out, "  inv r11\n");
+  fprintf(out, "  inc r11\n");
+  fprintf(out, "_float_to_int_positive:\n");
+  fprintf(out, "  mov r11, r15\n");
+  fprintf(out, "_float_to_int_return:\n");
+  fprintf(out, "  ret\n");
+  fprintf(out, "_float_to_int_zero:\n");
+  fprintf(out, "  clr r15\n");
+  fprintf(out, "  ret\n\n");
+}
+
+void MSP430::insert_float_compare()
+{
+  // fcmpl / fcmpg: -1, 0 or 1 in r15 comparing r15:r14 to r11:r10.  They
+  // only differ in what NaN gives.
+  fprintf(out, "; _float_cmpl / _float_cmpg r15:r14 to r11:r10 (result in r15)\n");
+  fprintf(out, "_float_cmpg:\n");
+  fprintf(out, "  mov #1, r13\n");
+  fprintf(out, "  jmp _float_compare\n");
+  fprintf(out, "_float_cmpl:\n");
+  fprintf(out, "  mov #-1, r13\n");
+  fprintf(out, "_float_compare:\n");
+  fprintf(out, "  push r9\n");
+  fprintf(out, "  mov r15, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r14\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_compare_nan\n");
+  fprintf(out, "  mov r11, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  cmp #1, r10\n");
+  fprintf(out, "  subc #0x7f80, r9\n");
+  fprintf(out, "  jhs _float_compare_nan\n");
+  // -0 and 0 are equal.
+  fprintf(out, "  mov r15, r9\n");
+  fprintf(out, "  bis r11, r9\n");
+  fprintf(out, "  and #0x7fff, r9\n");
+  fprintf(out, "  bis r14, r9\n");
+  fprintf(out, "  bis r10, r9\n");
+  fprintf(out, "  tst r9\n");
+  fprintf(out, "  jnz _float_compare_numbers\n");
+  fprintf(out, "  clr r15\n");
+  fprintf(out, "  jmp _float_compare_return\n");
+  fprintf(out, "_float_compare_numbers:\n");
+  // Flip the magnitude of negative numbers so a signed compare works.
+  fprintf(out, "  tst r15\n");
+  fprintf(out, "  jge _float_compare_a_positive\n");
+  fprintf(out, "  xor #0x7fff, r15\n");
+  fprintf(out, "  inv r14\n");
+  fprintf(out, "_float_compare_a_positive:\n");
+  fprintf(out, "  tst r11\n");
+  fprintf(out, "  jge _float_compare_b_positive\n");
+  fprintf(out, "  xor #0x7fff, r11\n");
+  fprintf(out, "  inv r10\n");
+  fprintf(out, "_float_compare_b_positive:\n");
+  fprintf(out, "  cmp r11, r15\n");
+  fprintf(out, "  jl _float_compare_less\n");
+  fprintf(out, "  jne _float_compare_greater\n");
+  fprintf(out, "  cmp r10, r14\n");
+  fprintf(out, "  jlo _float_compare_less\n");
+  fprintf(out, "  jne _float_compare_greater\n");
+  fprintf(out, "  clr r15\n");
+  fprintf(out, "  jmp _float_compare_return\n");
+  fprintf(out, "_float_compare_less:\n");
+  fprintf(out, "  mov #-1, r15\n");
+  fprintf(out, "  jmp _float_compare_return\n");
+  fprintf(out, "_float_compare_greater:\n");
+  fprintf(out, "  mov #1, r15\n");
+  fprintf(out, "  jmp _float_compare_return\n");
+  fprintf(out, "_float_compare_nan:\n");
+  fprintf(out, "  mov r13, r15\n");
+  fprintf(out, "_float_compare_return:\n");
+  fprintf(out, "  pop r9\n");
+  fprintf(out, "  ret\n\n");
+}
+
+void MSP430::insert_float_pack()
+{
+  // Shared end of the soft float routines.  r5:r4 is the mantissa with the
+  // hidden bit at bit 30 and 7 more bits (the lowest one sticky) below it,
+  // r13 the exponent and r6 the sign.  Rounds to nearest even, puts the
+  // float together in r15:r14 and restores what the routine pushed.
+  // Anything too small for a normal float becomes 0.
+  fprintf(out, "; _float_pack r5:r4 exponent r13 sign r6 (result in r15:r14)\n");
+  fprintf(out, "_float_pack:\n");
+  fprintf(out, "  mov r4, r7\n");
+  fprintf(out, "  and #0x7f, r7\n");
+  fprintf(out, "  rla r4\n");
+  fprintf(out, "  rlc r5\n");
+  fprintf(out, "  swpb r4\n");
+  fprintf(out, "  swpb r5\n");
+  fprintf(out, "  mov.b r4, r4\n");
+  fprintf(out, "  mov r5, r9\n");
+  fprintf(out, "  and #0xff00, r9\n");
+  fprintf(out, "  bis r9, r4\n");
+  fprintf(out, "  mov.b r5, r5\n");
+  fprintf(out, "  cmp #0x41, r7\n");
+  fprintf(out, "  jhs _float_pack_round_up\n");
+  fprintf(out, "  cmp #0x40, r7\n");
+  fprintf(out, "  jne _float_pack_exponent\n");
+  fprintf(out, "  bit #1, r4\n");
+  fprintf(out, "  jz _float_pack_exponent\n");
+  fprintf(out, "_float_pack_round_up:\n");
+  fprintf(out, "  inc r4\n");
+  fprintf(out, "  adc r5\n");
+  fprintf(out, "_float_pack_exponent:\n");
+  fprintf(out, "  mov r6, r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "  cmp #1, r13\n");
+  fprintf(out, "  jl _float_done\n");
+  // The hidden bit (and a carry out of rounding) adds 1 to the exponent.
+  fprintf(out, "  dec r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  rla r13\n");
+  fprintf(out, "  add r13, r5\n");
+  fprintf(out, "  cmp #0x7f80, r5\n");
+  fprintf(out, "  jlo _float_pack_in_range\n");
+  fprintf(out, "  mov #0x7f80, r5\n");
+  fprintf(out, "  clr r4\n");
+  fprintf(out, "_float_pack_in_range:\n");
+  fprintf(out, "  bis r5, r15\n");
+  fprintf(out, "  mov r4, r14\n");
+  fprintf(out, "  jmp _float_done\n");
+  fprintf(out, "_float_nan:\n");
+  fprintf(out, "  mov #0x7fc0, r15\n");
+  fprintf(out, "  clr r14\n");
+  fprintf(out, "_float_done:\n");
+  fprintf(out, "  pop r9\n");
+  fprintf(out, "  pop r8\n");
+  fprintf(out, "  pop r7\n");
+  fprintf(out, "  pop r6\n");
+  fprintf(out, "  pop r5\n");
+  fprintf(out, "  pop r4\n");
+  fprintf(out, "  ret\n\n");
+}
+
+int MSP430::get_field(const char *size, int offset, bool sign_extend)
+{
+  int r;
+
+  if (stack > 0)
+  {
+    fprintf(out, "  pop r15\n");
+    r = 15;
+  }
+    else
+  {
+    r = REG_STACK(reg-1);
+  }
+
+  fprintf(out, "  mov.%s %d(r%d), r%d\n", size, offset, r, r);
+
+  if (sign_extend) { fprintf(out, "  sxt r%d\n", r); }
+
+  if (stack > 0)
+  {
+    fprintf(out, "  push r15\n");
+  }
+
+  return 0;
+}
+
+int MSP430::put_field(const char *size, int offset)
+{
+  int value, ref;
+
+  get_values_from_stack(&value, &ref);
+
+  fprintf(out, "  mov.%s r%d, %d(r%d)\n", size, value, offset, ref);
+
+  return 0;
+}
+
 int MSP430::get_values_from_stack(int *value1, int *value2, int *value3)
 {
   if (stack > 0)
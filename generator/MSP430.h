@@ -29,6 +29,9 @@ public:
   virtual ~MSP430();
 
   virtual int open(const char *filename);
+  virtual Encoder *new_encoder();
+  virtual Cycles *new_cycles();
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -38,17 +41,22 @@ public:
   virtual void method_end(int local_count);
   virtual int push_local_var_int(int index);
   virtual int push_local_var_ref(int index);
+  virtual int push_local_var_float(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
   virtual int set_integer_local(int index, int value);
   virtual int set_ref_local(int index, char *name);
+  virtual int get_spilled() { return stack; }
+  virtual void set_local_types(const uint8_t *local_types, int local_count);
+  virtual int get_float_size() { return 2; }
   virtual int push_int(int32_t n);
   //virtual int push_long(int64_t n);
-  //virtual int push_float(float f);
+  virtual int push_float(float f);
   //virtual int push_double(double f);
   virtual int push_ref(char *name);
   virtual int pop_local_var_int(int index);
   virtual int pop_local_var_ref(int index);
+  virtual int pop_local_var_float(int index);
   virtual int pop();
   virtual int dup();
   virtual int dup2();
@@ -76,21 +84,39 @@ public:
   virtual int inc_integer(int index, int num);
   virtual int integer_to_byte();
   virtual int integer_to_short();
+  virtual int add_float();
+  virtual int sub_float();
+  virtual int mul_float();
+  virtual int div_float();
+  virtual int neg_float();
+  virtual int float_to_integer();
+  virtual int integer_to_float();
   virtual int jump_cond(const char *label, int cond, int distance);
   virtual int jump_cond_zero(const char *label, int cond, int distance);
   virtual int jump_cond_integer(const char *label, int cond, int distance);
   virtual int jump_cond_integer(const char *label, int cond, int const_val, int distance);
+  virtual int compare_floats(int cond);
   virtual int ternary(int cond, int value_true, int value_false);
   virtual int ternary(int cond, int compare, int value_true, int value_false);
   virtual int return_local(int index, int local_count);
   virtual int return_integer(int local_count);
   virtual int return_void(int local_count);
+  virtual int return_float(int local_count);
   virtual int jump(const char *name, int distance);
   virtual int call(const char *name);
   virtual int invoke_static_method(const char *name, int params, int is_void);
+  virtual int invoke_static_method_float(const char *name, int params);
   virtual int put_static(const char *name, int index);
   virtual int get_static(const char *name, int index);
   virtual int brk();
+  virtual int new_object(const char *object_name, int object_size);
+  virtual int get_field_byte(int offset);
+  virtual int get_field_short(int offset);
+  virtual int get_field_char(int offset);
+  virtual int get_field_int(int offset);
+  virtual int put_field_byte(int offset);
+  virtual int put_field_short(int offset);
+  virtual int put_field_int(int offset);
   virtual int new_array(uint8_t type);
   virtual int insert_array(const char *name, int32_t *data, int len, uint8_t type);
   virtual int insert_string(const char *name, uint8_t *bytes, int len);
@@ -99,15 +125,19 @@ public:
   virtual int array_read_byte();
   virtual int array_read_short();
   virtual int array_read_int();
+  virtual int array_read_float();
   virtual int array_read_byte(const char *name, int field_id);
   virtual int array_read_short(const char *name, int field_id);
   virtual int array_read_int(const char *name, int field_id);
+  virtual int array_read_float(const char *name, int field_id);
   virtual int array_write_byte();
   virtual int array_write_short();
   virtual int array_write_int();
+  virtual int array_write_float();
   virtual int array_write_byte(const char *name, int field_id);
   virtual int array_write_short(const char *name, int field_id);
   virtual int array_write_int(const char *name, int field_id);
+  virtual int array_write_float(const char *name, int field_id);
   //virtual void close();
 
   // GPIO functions
@@ -186,16 +216,35 @@ public:
   virtual int memory_read16_I();
   virtual int memory_write16_IS();
 
+  // Fixed point functions
+  virtual int fixed_mul8_II();
+  virtual int fixed_div8_II();
+
 protected:
   int set_periph(const char *instr, const char *periph);
   char *pop_reg();
   char *top_reg();
   int stack_alu(const char *instr);
+  int get_field(const char *size, int offset, bool sign_extend);
+  int put_field(const char *size, int offset);
   void push_reg(const char *reg);
   void pop_reg(char *reg);
+  void pop_float_regs(const char *hi, const char *lo);
+  void push_float_regs();
+  int call_float(const char *function);
   void insert_read_spi();
   void insert_mul_integers();
+  void insert_mul_fixed();
+  virtual void multiply_fixed();
   void insert_div_integers();
+  void insert_div_fixed();
+  void insert_float_add();
+  void insert_float_mul();
+  void insert_float_div();
+  void insert_int_to_float();
+  void insert_float_to_int();
+  void insert_float_compare();
+  void insert_float_pack();
   int get_values_from_stack(int *value1, int *value2, int *value3);
   int get_values_from_stack(int *value1, int *value2);
   int get_values_from_stack(int *value1);
@@ -204,10 +253,18 @@ protected:
   int reg_max;
   int stack;
   int label_count;
-  char reg_string[8];
+  char reg_string[16];
   bool need_read_spi:1;
   bool need_mul_integers:1;
+  bool need_mul_fixed:1;
   bool need_div_integers:1;
+  bool need_div_fixed:1;
+  bool need_float_add:1;
+  bool need_float_mul:1;
+  bool need_float_div:1;
+  bool need_int_to_float:1;
+  bool need_float_to_int:1;
+  bool need_float_compare:1;
   bool need_timer_interrupt:1;
   bool is_main:1;
   bool is_interrupt:1;
@@ -215,6 +272,8 @@ protected:
   uint32_t stack_start;
   uint32_t flash_start;
   int max_stack;
+  int *local_offsets;
+  int locals_size;
   const char *include_file;
   uint16_t vector_timer;
 };
@@ -341,6 +341,16 @@ int MSP430X::timer_setValue_I(int const_value)
   return 0;
 }
 
+void MSP430X::multiply_fixed()
+{
+  // The MSP430F5529 has the MPY32 hardware multiplier so there is no
+  // need for _mul_fixed.  Writing OP2 starts the signed multiply.
+  fprintf(out, "  mov.w r14, &MPYS\n");
+  fprintf(out, "  mov.w r15, &OP2\n");
+  fprintf(out, "  mov.w &RESLO, r15\n");
+  fprintf(out, "  mov.w &RESHI, r14\n");
+}
+
 void MSP430X::insert_set_vcore_up()
 {
   // Translated from C to Assmembly from TI's msp430x5xx family PDF
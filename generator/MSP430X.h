@@ -21,6 +21,11 @@ public:
   MSP430X(uint8_t chip_type);
   virtual ~MSP430X();
 
+  // The MSP430X extended instructions aren't in the built-in encoder.
+  virtual Encoder *new_encoder() { return NULL; }
+  // MSP430X (CPUX) timings differ from the MSP430's.
+  virtual Cycles *new_cycles() { return NULL; }
+
   virtual int shift_left_integer();
   virtual int shift_left_integer(int count);
   virtual int shift_right_integer();
@@ -39,6 +44,9 @@ public:
   virtual int cpu_setClock25();
   virtual int cpu_setClockExternal2();
 
+protected:
+  virtual void multiply_fixed();
+
 private:
   void insert_set_vcore_up();
 
@@ -12,11 +12,13 @@
 #ifndef _MATH_H
 #define _MATH_H
 
+#include "OutputBuffer.h"
+
 class Math
 {
 public:
-  static void add_sin_table(FILE *out);
-  static void add_cos_table(FILE *out);
+  static void add_sin_table(OutputBuffer *out);
+  static void add_cos_table(OutputBuffer *out);
 
 private:
   Math() { }
@@ -0,0 +1,282 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "OutputBuffer.h"
+
+OutputBuffer::OutputBuffer(FILE *file) :
+  file(file),
+  written(0),
+  length(0),
+  size(FLUSH_SIZE * 2)
+{
+  buffer = (char *)malloc(size);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+  flush();
+  fclose(file);
+  free(buffer);
+}
+
+void OutputBuffer::reserve(int len)
+{
+  if (length + len <= size) { return; }
+
+  while (length + len > size) { size *= 2; }
+
+  buffer = (char *)realloc(buffer, size);
+}
+
+void OutputBuffer::append(const char *s, int len)
+{
+  reserve(len);
+  memcpy(buffer + length, s, len);
+  length += len;
+
+  if (length >= FLUSH_SIZE) { flush(); }
+}
+
+void OutputBuffer::append(const char *s)
+{
+  append(s, strlen(s));
+}
+
+void OutputBuffer::append(char c)
+{
+  reserve(1);
+  buffer[length++] = c;
+
+  if (length >= FLUSH_SIZE) { flush(); }
+}
+
+void OutputBuffer::append_padded(const char *s, int len, int width, char pad, bool left)
+{
+  int n;
+
+  if (len >= width) { append(s, len); return; }
+
+  reserve(width);
+
+  if (left)
+  {
+    memcpy(buffer + length, s, len);
+    memset(buffer + length + len, ' ', width - len);
+  }
+    else
+  {
+    n = 0;
+
+    // Zero padding goes between the sign and the digits like printf().
+    if (pad == '0' && s[0] == '-') { buffer[length] = '-'; n = 1; }
+
+    memset(buffer + length + n, pad, width - len);
+    memcpy(buffer + length + n + width - len, s + n, len - n);
+  }
+
+  length += width;
+
+  if (length >= FLUSH_SIZE) { flush(); }
+}
+
+void OutputBuffer::append_decimal(uint32_t value, bool negative, int width, char pad, bool left)
+{
+  char digits[16];
+  int ptr = sizeof(digits);
+
+  do
+  {
+    digits[--ptr] = '0' + (value % 10);
+    value = value / 10;
+  } while (value != 0);
+
+  if (negative) { digits[--ptr] = '-'; }
+
+  append_padded(digits + ptr, sizeof(digits) - ptr, width, pad, left);
+}
+
+void OutputBuffer::append_int(int value, int width, char pad, bool left)
+{
+  if (value < 0)
+  {
+    append_decimal(-(uint32_t)value, true, width, pad, left);
+  }
+    else
+  {
+    append_decimal(value, false, width, pad, left);
+  }
+}
+
+void OutputBuffer::append_hex(uint32_t value, int width, char pad, bool upper, bool left)
+{
+  const char *hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char digits[8];
+  int ptr = sizeof(digits);
+
+  do
+  {
+    digits[--ptr] = hex[value & 0xf];
+    value = value >> 4;
+  } while (value != 0);
+
+  append_padded(digits + ptr, sizeof(digits) - ptr, width, pad, left);
+}
+
+bool OutputBuffer::is_simple_format(const char *format)
+{
+  // Only flags '-' and '0', a width and d, u, x, X, s, c are formatted
+  // here.  Anything else (floats, precision, long) goes to vsnprintf().
+  while (*format != 0)
+  {
+    if (*format++ != '%') { continue; }
+
+    while (*format == '-' || *format == '0') { format++; }
+    while (*format >= '0' && *format <= '9') { format++; }
+
+    switch (*format)
+    {
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+      case 'X':
+      case 's':
+      case 'c':
+      case '%':
+        format++;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+int OutputBuffer::vprintf(const char *format, va_list args)
+{
+  const char *start;
+  long old_written = written + length;
+
+  if (!is_simple_format(format))
+  {
+    va_list copy;
+
+    va_copy(copy, args);
+    int len = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    if (len < 0) { return len; }
+
+    reserve(len + 1);
+    vsnprintf(buffer + length, len + 1, format, args);
+    length += len;
+
+    if (length >= FLUSH_SIZE) { flush(); }
+
+    return len;
+  }
+
+  while (*format != 0)
+  {
+    start = format;
+
+    while (*format != 0 && *format != '%') { format++; }
+
+    if (format != start) { append(start, format - start); }
+
+    if (*format == 0) { break; }
+
+    format++;
+
+    bool left = false;
+    char pad = ' ';
+    int width = 0;
+
+    while (*format == '-' || *format == '0')
+    {
+      if (*format == '-') { left = true; } else { pad = '0'; }
+      format++;
+    }
+
+    while (*format >= '0' && *format <= '9')
+    {
+      width = (width * 10) + (*format - '0');
+      format++;
+    }
+
+    // printf() ignores 0 when left justifying.
+    if (left) { pad = ' '; }
+
+    switch (*format++)
+    {
+      case 'd':
+      case 'i':
+        append_int(va_arg(args, int), width, pad, left);
+        break;
+      case 'u':
+        append_decimal(va_arg(args, unsigned int), false, width, pad, left);
+        break;
+      case 'x':
+        append_hex(va_arg(args, unsigned int), width, pad, false, left);
+        break;
+      case 'X':
+        append_hex(va_arg(args, unsigned int), width, pad, true, left);
+        break;
+      case 's':
+      {
+        const char *s = va_arg(args, const char *);
+        if (s == NULL) { s = "(null)"; }
+        append_padded(s, strlen(s), width, ' ', left);
+        break;
+      }
+      case 'c':
+      {
+        char c = va_arg(args, int);
+        append_padded(&c, 1, width, ' ', left);
+        break;
+      }
+      default:
+        append('%');
+        break;
+    }
+  }
+
+  return (written + length) - old_written;
+}
+
+void OutputBuffer::flush()
+{
+  if (length == 0) { return; }
+
+  fwrite(buffer, 1, length, file);
+  written += length;
+  length = 0;
+}
+
+int fprintf(OutputBuffer *out, const char *format, ...)
+{
+  va_list args;
+  int len;
+
+  va_start(args, format);
+  len = out->vprintf(format, args);
+  va_end(args);
+
+  return len;
+}
+
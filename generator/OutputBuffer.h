@@ -0,0 +1,57 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+#ifndef _OUTPUT_BUFFER_H
+#define _OUTPUT_BUFFER_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// Assembly text is appended here and only written to the FILE in large
+// blocks (and once more when the buffer is deleted) instead of going
+// through stdio on every generated instruction.
+class OutputBuffer
+{
+public:
+  OutputBuffer(FILE *file);
+  ~OutputBuffer();
+
+  void append(const char *s, int len);
+  void append(const char *s);
+  void append(char c);
+  void append_int(int value, int width = 0, char pad = ' ', bool left = false);
+  void append_hex(uint32_t value, int width = 0, char pad = ' ', bool upper = false, bool left = false);
+  int vprintf(const char *format, va_list args);
+  void flush();
+  long tell() { return written + length; }
+
+private:
+  void reserve(int len);
+  static bool is_simple_format(const char *format);
+  void append_decimal(uint32_t value, bool negative, int width, char pad, bool left);
+  void append_padded(const char *s, int len, int width, char pad, bool left);
+
+  FILE *file;
+  long written;
+  char *buffer;
+  int length;
+  int size;
+  static const int FLUSH_SIZE = 64 * 1024;
+};
+
+// All the generators write with fprintf(out, ...) so this overload picks
+// up every call site once out is an OutputBuffer.
+int fprintf(OutputBuffer *out, const char *format, ...)
+  __attribute__((format(printf, 2, 3)));
+
+#endif
+
@@ -153,9 +153,9 @@ int Playstation2::start_init()
   return 0;
 }
 
-int Playstation2::new_object(const char *object_name, int field_count)
+int Playstation2::new_object(const char *object_name, int object_size)
 {
-  fprintf(out, "  ;; new_object(%s, field_count=%d)\n", object_name, field_count);
+  fprintf(out, "  ;; new_object(%s, object_size=%d)\n", object_name, object_size);
 
   if (strncmp(object_name, DRAW3D, DRAW3D_LEN) != 0)
   {
@@ -24,6 +24,7 @@ public:
   virtual ~Propeller();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -624,7 +624,7 @@ int R5900::neg_integer()
 
 int R5900::shift_left_integer()
 {
-  return stack_alu("sll");
+  return stack_alu("sllv");
   return 0;
 }
 
@@ -648,7 +648,7 @@ int R5900::shift_left_integer(int num)
 
 int R5900::shift_right_integer()
 {
-  return stack_alu("sra");
+  return stack_alu("srav");
   return 0;
 }
 
@@ -672,7 +672,7 @@ int R5900::shift_right_integer(int num)
 
 int R5900::shift_right_uinteger()
 {
-  return stack_alu("srl");
+  return stack_alu("srlv");
   return 0;
 }
 
@@ -1765,7 +1765,7 @@ int R5900::get_values_from_stack(int *value1, int *value2)
   if (stack > 0)
   {
     STACK_POP(9);
-    *value2 = 8;
+    *value2 = 9;
   }
     else
   {
@@ -23,7 +23,7 @@
 
 // pop = read value, then subtract 4
 #define STACK_POP(t) \
-  fprintf(out, "  lw $%d, 0($sp)\n", t); \
+  fprintf(out, "  lw $t%d, 0($sp)\n", t); \
   fprintf(out, "  addi $sp, $sp, 4\n"); \
   stack--;
 
@@ -34,6 +34,7 @@ public:
   virtual ~R5900();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 4; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -46,6 +47,7 @@ public:
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
   //virtual int set_integer_local(int index, int value);
+  virtual int get_spilled() { return stack; }
   virtual int push_int(int32_t n);
   //virtual int push_long(int64_t n);
   virtual int push_float(float f);
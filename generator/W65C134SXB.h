@@ -23,6 +23,8 @@ public:
   virtual ~W65C134SXB();
 
   virtual int open(const char *filename);
+  // The monitor calls use 65C02 / 65816 instructions.
+  virtual Encoder *new_encoder() { return NULL; }
 
   // terminal interface API
   virtual int sxb_getChar();
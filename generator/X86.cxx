@@ -34,14 +34,15 @@ static const char *cond_str[] = { "je", "jne", "jl", "jle", "jg", "jge" };
 X86::X86() :
   reg(0),
   stack(0),
-  is_main(0)
+  is_main(0),
+  need_div_longs(0)
 {
 
 }
 
 X86::~X86()
 {
-
+  if (need_div_longs) { insert_div_longs(); }
 }
 
 int X86::open(const char *filename)
@@ -168,6 +169,17 @@ int X86::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int X86::push_local_var_long(int index)
+{
+  fprintf(out, "  ; push_local_var_long(%d)\n", index);
+
+  // Low word first so the high word ends up on top.
+  push_local_var_int(index);
+  push_local_var_int(index + 1);
+
+  return 0;
+}
+
 int X86::push_ref_static(const char *name, int index)
 {
   fprintf(out, "  ; push_ref_static(%s, %d)\n", name, index);
@@ -225,12 +237,17 @@ int X86::push_int(int32_t n)
   return 0;
 }
 
-#if 0
 int X86::push_long(int64_t n)
 {
-  return -1;
+  fprintf(out, "  ; push_long(%lld)\n", (long long)n);
+
+  push_int((int32_t)(n & 0xffffffff));
+  push_int((int32_t)(n >> 32));
+
+  return 0;
 }
 
+#if 0
 int X86::push_float(float f)
 {
   return -1;
@@ -280,6 +297,21 @@ int X86::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int X86::pop_local_var_long(int index)
+{
+  const char *lo, *hi;
+
+  fprintf(out, "  ; pop_local_var_long(%d)\n", index);
+
+  lo = load_stack_entry(1, "ebx");
+  hi = load_stack_entry(0, "edi");
+  fprintf(out, "  mov [ebp-%d], %s\n", LOCALS(index), lo);
+  fprintf(out, "  mov [ebp-%d], %s\n", LOCALS(index + 1), hi);
+  drop_stack_entries(2);
+
+  return 0;
+}
+
 int X86::pop()
 {
   if (stack > 0)
@@ -321,34 +353,18 @@ int X86::dup()
 
 int X86::dup2()
 {
+  const char *lo, *hi;
+
   fprintf(out, "  ; dup2()\n");
 
-  if (reg == 2)
-  {
-    fprintf(out, "  mov %s, %s\n",  REG_STACK(reg), REG_STACK(reg-2));
-    fprintf(out, "  push %s\n", REG_STACK(reg-1));
-    reg++;
-    stack++;
-  }
-    else
-  if (reg == 3)
-  {
-    fprintf(out, "  mov ebx, %s\n",  REG_STACK(reg-1));
-    fprintf(out, "  mov edi, [esp]\n");
-    fprintf(out, "  push ebx\n");
-    fprintf(out, "  push edi\n");
+  // Both are read before pushing since the first push can spill and move
+  // the top of the stack.
+  lo = load_stack_entry(1, "ebx");
+  hi = load_stack_entry(0, "edi");
 
-    stack += 2;
-  }
-    else
-  {
-    fprintf(out, "  mov ebx, [esp+4]\n");
-    fprintf(out, "  mov edi, [esp]\n");
-    fprintf(out, "  push ebx\n");
-    fprintf(out, "  push edi\n");
+  push_word(lo);
+  push_word(hi);
 
-    stack += 2;
-  }
   return 0;
 }
 
@@ -571,6 +587,184 @@ int X86::integer_to_short()
   return 0;
 }
 
+int X86::add_long()
+{
+  fprintf(out, "  ; add_long()\n");
+
+  return stack_alu_long("add", "adc");
+}
+
+int X86::sub_long()
+{
+  fprintf(out, "  ; sub_long()\n");
+
+  return stack_alu_long("sub", "sbb");
+}
+
+int X86::mul_long()
+{
+  char lo1[32], hi1[32], lo2[32], hi2[32];
+
+  fprintf(out, "  ; mul_long()\n");
+
+  stack_entry(hi2, 0);
+  stack_entry(lo2, 1);
+  stack_entry(hi1, 2);
+  stack_entry(lo1, 3);
+
+  // The cross products only matter for the high word.  mul needs eax and
+  // edx so they're saved around it.
+  fprintf(out, "  mov ebx, %s\n", lo1);
+  fprintf(out, "  imul ebx, %s\n", hi2);
+  fprintf(out, "  mov edi, %s\n", hi1);
+  fprintf(out, "  imul edi, %s\n", lo2);
+  fprintf(out, "  add ebx, edi\n");
+  fprintf(out, "  mov esi, %s\n", lo1);
+  fprintf(out, "  mov edi, %s\n", lo2);
+  fprintf(out, "  push eax\n");
+  fprintf(out, "  push edx\n");
+  fprintf(out, "  mov eax, esi\n");
+  fprintf(out, "  mul edi\n");
+  fprintf(out, "  add ebx, edx\n");
+  fprintf(out, "  mov esi, eax\n");
+  fprintf(out, "  pop edx\n");
+  fprintf(out, "  pop eax\n");
+  fprintf(out, "  mov %s, esi\n", lo1);
+  fprintf(out, "  mov %s, ebx\n", hi1);
+
+  drop_stack_entries(2);
+
+  return 0;
+}
+
+int X86::div_long()
+{
+  fprintf(out, "  ; div_long()\n");
+
+  return stack_div_long(true);
+}
+
+int X86::mod_long()
+{
+  fprintf(out, "  ; mod_long()\n");
+
+  return stack_div_long(false);
+}
+
+int X86::neg_long()
+{
+  char lo[32], hi[32];
+
+  fprintf(out, "  ; neg_long()\n");
+
+  stack_entry(hi, 0);
+  stack_entry(lo, 1);
+
+  // neg sets the carry if lo wasn't 0, which is the borrow into hi.
+  fprintf(out, "  neg %s\n", lo);
+  fprintf(out, "  adc %s, 0\n", hi);
+  fprintf(out, "  neg %s\n", hi);
+
+  return 0;
+}
+
+int X86::shift_left_long()
+{
+  fprintf(out, "  ; shift_left_long()\n");
+
+  return stack_shift_long("shl");
+}
+
+int X86::shift_left_long(int count)
+{
+  fprintf(out, "  ; shift_left_long(%d)\n", count & 63);
+
+  return stack_shift_long("shl", count & 63);
+}
+
+int X86::shift_right_long()
+{
+  fprintf(out, "  ; shift_right_long()\n");
+
+  return stack_shift_long("sar");
+}
+
+int X86::shift_right_long(int count)
+{
+  fprintf(out, "  ; shift_right_long(%d)\n", count & 63);
+
+  return stack_shift_long("sar", count & 63);
+}
+
+int X86::shift_right_ulong()
+{
+  fprintf(out, "  ; shift_right_ulong()\n");
+
+  return stack_shift_long("shr");
+}
+
+int X86::shift_right_ulong(int count)
+{
+  fprintf(out, "  ; shift_right_ulong(%d)\n", count & 63);
+
+  return stack_shift_long("shr", count & 63);
+}
+
+int X86::and_long()
+{
+  fprintf(out, "  ; and_long()\n");
+
+  return stack_alu_long("and", "and");
+}
+
+int X86::or_long()
+{
+  fprintf(out, "  ; or_long()\n");
+
+  return stack_alu_long("or", "or");
+}
+
+int X86::xor_long()
+{
+  fprintf(out, "  ; xor_long()\n");
+
+  return stack_alu_long("xor", "xor");
+}
+
+int X86::integer_to_long()
+{
+  const char *lo;
+
+  fprintf(out, "  ; integer_to_long()\n");
+
+  lo = load_stack_entry(0, "ebx");
+
+  if (reg < REG_MAX)
+  {
+    fprintf(out, "  mov %s, %s\n", REG_STACK(reg), lo);
+    fprintf(out, "  sar %s, 31\n", REG_STACK(reg));
+    reg++;
+  }
+    else
+  {
+    fprintf(out, "  mov ebx, %s\n", lo);
+    fprintf(out, "  sar ebx, 31\n");
+    push_word("ebx");
+  }
+
+  return 0;
+}
+
+int X86::long_to_integer()
+{
+  fprintf(out, "  ; long_to_integer()\n");
+
+  // Drop the high word.
+  drop_stack_entries(1);
+
+  return 0;
+}
+
 int X86::jump_cond(const char *label, int cond, int distance)
 {
   fprintf(out, "  ; jump_cond(%s, %d, %d)\n", label, cond, distance);
@@ -620,6 +814,41 @@ int X86::jump_cond_integer(const char *label, int cond, int distance)
   return 0;
 }
 
+int X86::compare_longs()
+{
+  char lo2[32], hi2[32];
+  const char *lo1, *hi1;
+
+  fprintf(out, "  ; compare_longs()\n");
+
+  stack_entry(hi2, 0);
+  stack_entry(lo2, 1);
+  hi1 = load_stack_entry(2, "ebx");
+  lo1 = load_stack_entry(3, "edi");
+
+  // The high words compare signed and only if they're equal do the low
+  // words count, unsigned.
+  fprintf(out, "  cmp %s, %s\n", hi1, hi2);
+  fprintf(out, "  jl compare_longs_%d_less\n", label_count);
+  fprintf(out, "  jg compare_longs_%d_greater\n", label_count);
+  fprintf(out, "  cmp %s, %s\n", lo1, lo2);
+  fprintf(out, "  jb compare_longs_%d_less\n", label_count);
+  fprintf(out, "  ja compare_longs_%d_greater\n", label_count);
+  fprintf(out, "  xor ebx, ebx\n");
+  fprintf(out, "  jmp compare_longs_%d_done\n", label_count);
+  fprintf(out, "compare_longs_%d_less:\n", label_count);
+  fprintf(out, "  mov ebx, -1\n");
+  fprintf(out, "  jmp compare_longs_%d_done\n", label_count);
+  fprintf(out, "compare_longs_%d_greater:\n", label_count);
+  fprintf(out, "  mov ebx, 1\n");
+  fprintf(out, "compare_longs_%d_done:\n", label_count++);
+
+  drop_stack_entries(4);
+  push_word("ebx");
+
+  return 0;
+}
+
 int X86::ternary(int cond, int value_true, int value_false)
 {
   return -1;
@@ -689,6 +918,34 @@ int X86::return_void(int local_count)
   return 0;
 }
 
+int X86::return_long(int local_count)
+{
+  if (reg != 2 || stack != 0)
+  {
+    printf("Error: register stack not empty? (%d,%d)\n", reg, stack);
+    return -1;
+  }
+
+  if (local_count != 0)
+  {
+    fprintf(out, "  ; Free stack space for %d local variables\n", local_count);
+    fprintf(out, "  add esp, %d\n", local_count * 4);
+  }
+
+  fprintf(out, "  pop ebp\n");
+  fprintf(out, "  pop edi\n");
+  fprintf(out, "  pop esi\n");
+  fprintf(out, "  pop ebx\n");
+
+  // A long is returned in edx:eax.
+  fprintf(out, "  mov edx, ecx\n");
+  reg -= 2;
+
+  fprintf(out, "  ret\n");
+
+  return 0;
+}
+
 int X86::jump(const char *name, int distance)
 {
   fprintf(out, "  jmp %s\n", name);
@@ -703,89 +960,12 @@ int X86::call(const char *name)
 
 int X86::invoke_static_method(const char *name, int params, int is_void)
 {
-  bool push_ebx = false;
-  int saved_register_count;
-  int stack_params = 0;
-  int n;
-
-  fprintf(out, "  ; invoke_static_method() name=%s params=%d is_void=%d reg=%d stack=%d\n", name, params, is_void, reg, stack);
-
-  // Save all registers except parameters
-  //saved_register_count = reg - (params - stack) < 0 ? 0 : reg - params;
-  saved_register_count = reg - (params - stack);
-  if (saved_register_count != 0)
-  {
-    fprintf(out, "  ; save %d registers\n", saved_register_count);
-    for (n = 0; n < saved_register_count; n++)
-    {
-      fprintf(out, "  push %s\n", REG_STACK(n));
-    }
-  }
-
-  if (params != 0)
-  {
-    fprintf(out, "  ; push %d params on the stack\n", params);
-    stack_params = params - (reg - saved_register_count);
-    int distance = (stack_params * 4) - 4;
-
-    fprintf(out, "  ; %d params are already on the stack\n", stack_params);
-    for (n = 0; n < stack_params; n++)
-    {
-      fprintf(out, "  mov ebx, [esp+%d]\n", distance);
-      fprintf(out, "  push ebx\n");
-    }
-
-    fprintf(out, "  ; %d params are in registers\n", reg - saved_register_count);
-    for (n = reg; n > saved_register_count; n--)
-    {
-      fprintf(out, "  push %s\n", REG_STACK(n - 1));
-    }
-  }
-
-  fprintf(out, "  call %s\n", name);
-
-  if (params != 0)
-  {
-    fprintf(out, "  ; pop %d params off the stack\n", params);
-    fprintf(out, "  add esp, %d\n", (params * 4) + (stack_params * 4));
-
-    stack -= stack_params;
-  }
-
-  // FIXME - is this right?
-  reg = saved_register_count;
-
-  if (is_void == false)
-  {
-    if (reg == 0)
-    {
-      fprintf(out, "  ; mov eax, eax\n");
-      reg++;
-    }
-      else
-    if (reg < REG_MAX)
-    {
-      fprintf(out, "  mov %s, eax\n", REG_STACK(reg++));
-    }
-      else
-    {
-      fprintf(out, "  mov ebx, eax\n");
-    }
-  }
-
-  // Restore all registers
-  for (n = saved_register_count - 1; n >= 0; n--)
-  {
-    fprintf(out, "  pop %s\n", REG_STACK(n));
-  }
-
-  if (push_ebx)
-  {
-    fprintf(out, "  push ebx\n");
-    stack++;
-  }
+  return invoke_static(name, params, is_void ? 0 : 1);
+}
 
-  return 0;
+int X86::invoke_static_method_long(const char *name, int params)
+{
+  return invoke_static(name, params, 2);
 }
 
 int X86::put_static(const char *name, int index)
@@ -1431,4 +1611,416 @@ int X86::stack_div(bool is_quotient)
   return 0;
 }
 
+int X86::stack_alu_long(const char *instr_lo, const char *instr_hi)
+{
+  char lo1[32], hi1[32];
+  const char *lo2, *hi2;
+
+  stack_entry(hi1, 2);
+  stack_entry(lo1, 3);
+  hi2 = load_stack_entry(0, "edi");
+  lo2 = load_stack_entry(1, "ebx");
+
+  fprintf(out, "  %s %s, %s\n", instr_lo, lo1, lo2);
+  fprintf(out, "  %s %s, %s\n", instr_hi, hi1, hi2);
+
+  drop_stack_entries(2);
+
+  return 0;
+}
+
+int X86::stack_shift_long(const char *instr)
+{
+  char lo[32], hi[32];
+
+  fprintf(out, "  mov ebx, %s\n", load_stack_entry(2, "ebx"));
+  fprintf(out, "  mov edi, %s\n", load_stack_entry(1, "edi"));
+  fprintf(out, "  mov esi, %s\n", load_stack_entry(0, "esi"));
+
+  // The count has to be in cl.  shld / shrd only use 5 bits of it so if
+  // bit 5 is set the words shift over one more time.
+  fprintf(out, "  xchg ecx, esi\n");
+
+  if (strcmp(instr, "shl") == 0)
+  {
+    fprintf(out, "  shld edi, ebx, cl\n");
+    fprintf(out, "  shl ebx, cl\n");
+  }
+    else
+  {
+    fprintf(out, "  shrd ebx, edi, cl\n");
+    fprintf(out, "  %s edi, cl\n", instr);
+  }
+
+  fprintf(out, "  test cl, 32\n");
+  fprintf(out, "  jz shift_long_%d\n", label_count);
+
+  if (strcmp(instr, "shl") == 0)
+  {
+    fprintf(out, "  mov edi, ebx\n");
+    fprintf(out, "  xor ebx, ebx\n");
+  }
+    else
+  if (strcmp(instr, "sar") == 0)
+  {
+    fprintf(out, "  mov ebx, edi\n");
+    fprintf(out, "  sar edi, 31\n");
+  }
+    else
+  {
+    fprintf(out, "  mov ebx, edi\n");
+    fprintf(out, "  xor edi, edi\n");
+  }
+
+  fprintf(out, "shift_long_%d:\n", label_count++);
+  fprintf(out, "  mov ecx, esi\n");
+
+  drop_stack_entries(1);
+
+  stack_entry(hi, 0);
+  stack_entry(lo, 1);
+  fprintf(out, "  mov %s, ebx\n", lo);
+  fprintf(out, "  mov %s, edi\n", hi);
+
+  return 0;
+}
+
+int X86::stack_shift_long(const char *instr, int count)
+{
+  char lo[32], hi[32];
+
+  if (count == 0) { return 0; }
+
+  stack_entry(hi, 0);
+  stack_entry(lo, 1);
+
+  fprintf(out, "  mov ebx, %s\n", lo);
+  fprintf(out, "  mov edi, %s\n", hi);
+
+  if (count < 32)
+  {
+    if (strcmp(instr, "shl") == 0)
+    {
+      fprintf(out, "  shld edi, ebx, %d\n", count);
+      fprintf(out, "  shl ebx, %d\n", count);
+    }
+      else
+    {
+      fprintf(out, "  shrd ebx, edi, %d\n", count);
+      fprintf(out, "  %s edi, %d\n", instr, count);
+    }
+  }
+    else
+  if (strcmp(instr, "shl") == 0)
+  {
+    fprintf(out, "  mov edi, ebx\n");
+    if (count != 32) { fprintf(out, "  shl edi, %d\n", count - 32); }
+    fprintf(out, "  xor ebx, ebx\n");
+  }
+    else
+  {
+    fprintf(out, "  mov ebx, edi\n");
+    if (count != 32) { fprintf(out, "  %s ebx, %d\n", instr, count - 32); }
+
+    if (strcmp(instr, "sar") == 0)
+    {
+      fprintf(out, "  sar edi, 31\n");
+    }
+      else
+    {
+      fprintf(out, "  xor edi, edi\n");
+    }
+  }
+
+  fprintf(out, "  mov %s, ebx\n", lo);
+  fprintf(out, "  mov %s, edi\n", hi);
+
+  return 0;
+}
+
+int X86::stack_div_long(bool is_quotient)
+{
+  // Order the 4 entries are pushed in so _div_longs finds them as
+  // divisor lo, divisor hi, dividend lo, dividend hi from [esp+4] up.
+  const int order[] = { 2, 3, 0, 1 };
+  int n;
+
+  // _div_longs uses every register so the register stack is saved around
+  // it.  It leaves the quotient where the dividend was and the remainder
+  // where the divisor was.
+  for (n = 0; n < reg; n++)
+  {
+    fprintf(out, "  push %s\n", REG_STACK(n));
+  }
+
+  for (n = 0; n < 4; n++)
+  {
+    int depth = order[n];
+
+    if (depth < stack)
+    {
+      fprintf(out, "  push dword [esp+%d]\n", (depth + reg + n) * 4);
+    }
+      else
+    {
+      fprintf(out, "  push %s\n", REG_STACK(reg - 1 - (depth - stack)));
+    }
+  }
+
+  fprintf(out, "  call _div_longs\n");
+  fprintf(out, "  mov ebx, [esp+%d]\n", is_quotient ? 8 : 0);
+  fprintf(out, "  mov edi, [esp+%d]\n", is_quotient ? 12 : 4);
+  fprintf(out, "  add esp, 16\n");
+
+  for (n = reg - 1; n >= 0; n--)
+  {
+    fprintf(out, "  pop %s\n", REG_STACK(n));
+  }
+
+  drop_stack_entries(4);
+  push_word("ebx");
+  push_word("edi");
+
+  need_div_longs = 1;
+
+  return 0;
+}
+
+int X86::invoke_static(const char *name, int params, int return_words)
+{
+  int saved_register_count;
+  int stack_params;
+  int n;
+
+  fprintf(out, "  ; invoke_static_method() name=%s params=%d return_words=%d reg=%d stack=%d\n", name, params, return_words, reg, stack);
+
+  // The params are the top of the stack so the spilled ones are all
+  // params unless there are more spilled than params.
+  stack_params = params < stack ? params : stack;
+
+  // Save all registers except parameters
+  saved_register_count = reg - (params - stack_params);
+  if (saved_register_count != 0)
+  {
+    fprintf(out, "  ; save %d registers\n", saved_register_count);
+    for (n = 0; n < saved_register_count; n++)
+    {
+      fprintf(out, "  push %s\n", REG_STACK(n));
+    }
+  }
+
+  if (params != 0)
+  {
+    fprintf(out, "  ; push %d params on the stack\n", params);
+
+    // The last param is pushed first.  Each push moves the next spilled
+    // param 8 bytes further from esp.
+    fprintf(out, "  ; %d params are already on the stack\n", stack_params);
+    for (n = 0; n < stack_params; n++)
+    {
+      fprintf(out, "  push dword [esp+%d]\n", (saved_register_count * 4) + (n * 8));
+    }
+
+    fprintf(out, "  ; %d params are in registers\n", reg - saved_register_count);
+    for (n = reg; n > saved_register_count; n--)
+    {
+      fprintf(out, "  push %s\n", REG_STACK(n - 1));
+    }
+  }
+
+  fprintf(out, "  call %s\n", name);
+
+  if (params != 0)
+  {
+    fprintf(out, "  ; pop %d params off the stack\n", params);
+    fprintf(out, "  add esp, %d\n", params * 4);
+  }
+
+  reg = saved_register_count;
+
+  // The result is in eax (or edx:eax for a long).  Restoring registers
+  // can overwrite those so they're moved out of the way if needed.
+  if (return_words == 1 && stack == stack_params && reg < REG_MAX)
+  {
+    if (reg == 0)
+    {
+      fprintf(out, "  ; mov eax, eax\n");
+      reg++;
+    }
+      else
+    {
+      fprintf(out, "  mov %s, eax\n", REG_STACK(reg++));
+    }
+
+    return_words = 0;
+  }
+    else
+  if (return_words != 0)
+  {
+    fprintf(out, "  mov ebx, eax\n");
+    fprintf(out, "  mov edi, edx\n");
+  }
+
+  // Restore all registers
+  for (n = saved_register_count - 1; n >= 0; n--)
+  {
+    fprintf(out, "  pop %s\n", REG_STACK(n));
+  }
+
+  if (stack_params != 0)
+  {
+    fprintf(out, "  ; pop %d spilled params\n", stack_params);
+    fprintf(out, "  add esp, %d\n", stack_params * 4);
+    stack -= stack_params;
+  }
+
+  if (return_words > 0) { push_word("ebx"); }
+  if (return_words > 1) { push_word("edi"); }
+
+  return 0;
+}
+
+void X86::stack_entry(char *operand, int depth)
+{
+  // The operand for the entry depth down from the top of the stack, so
+  // it can be changed in place.
+  if (depth < stack)
+  {
+    sprintf(operand, "dword [esp+%d]", depth * 4);
+  }
+    else
+  {
+    strcpy(operand, REG_STACK(reg - 1 - (depth - stack)));
+  }
+}
+
+const char *X86::load_stack_entry(int depth, const char *scratch)
+{
+  // Returns the register the entry depth down from the top of the stack
+  // is in.  Spilled entries are loaded into scratch.
+  if (depth < stack)
+  {
+    fprintf(out, "  mov %s, [esp+%d]\n", scratch, depth * 4);
+    return scratch;
+  }
 
+  return REG_STACK(reg - 1 - (depth - stack));
+}
+
+void X86::drop_stack_entries(int count)
+{
+  // Spilled entries are always the top of the stack.
+  int spilled = count < stack ? count : stack;
+
+  if (spilled != 0)
+  {
+    fprintf(out, "  add esp, %d\n", spilled * 4);
+    stack -= spilled;
+  }
+
+  reg -= count - spilled;
+}
+
+void X86::push_word(const char *src)
+{
+  if (reg < REG_MAX)
+  {
+    if (strcmp(src, REG_STACK(reg)) != 0)
+    {
+      fprintf(out, "  mov %s, %s\n", REG_STACK(reg), src);
+    }
+
+    reg++;
+  }
+    else
+  {
+    fprintf(out, "  push %s\n", src);
+    stack++;
+  }
+}
+
+void X86::insert_div_longs()
+{
+  // Signed 64 bit divide.  The divisor is at [esp+4] and the dividend at
+  // [esp+12].  They're replaced with the remainder and the quotient.
+  fprintf(out, "_div_longs:\n");
+  fprintf(out, "  push ebp\n");
+  fprintf(out, "  mov eax, [esp+16]\n");
+  fprintf(out, "  mov edx, [esp+20]\n");
+  fprintf(out, "  mov ebx, [esp+8]\n");
+  fprintf(out, "  mov ecx, [esp+12]\n");
+  // Bit 0 of ebp is set if the quotient is negative, bit 1 if the
+  // remainder is (it takes the sign of the dividend).
+  fprintf(out, "  xor ebp, ebp\n");
+  fprintf(out, "  test edx, edx\n");
+  fprintf(out, "  jns _div_longs_dividend_pos\n");
+  fprintf(out, "  neg eax\n");
+  fprintf(out, "  adc edx, 0\n");
+  fprintf(out, "  neg edx\n");
+  fprintf(out, "  xor ebp, 3\n");
+  fprintf(out, "_div_longs_dividend_pos:\n");
+  fprintf(out, "  test ecx, ecx\n");
+  fprintf(out, "  jns _div_longs_divisor_pos\n");
+  fprintf(out, "  neg ebx\n");
+  fprintf(out, "  adc ecx, 0\n");
+  fprintf(out, "  neg ecx\n");
+  fprintf(out, "  xor ebp, 1\n");
+  fprintf(out, "_div_longs_divisor_pos:\n");
+  // A divisor that fits in 32 bits takes 2 divs, high word first.
+  fprintf(out, "  test ecx, ecx\n");
+  fprintf(out, "  jnz _div_longs_wide\n");
+  fprintf(out, "  mov esi, eax\n");
+  fprintf(out, "  mov eax, edx\n");
+  fprintf(out, "  xor edx, edx\n");
+  fprintf(out, "  div ebx\n");
+  fprintf(out, "  xchg eax, esi\n");
+  fprintf(out, "  div ebx\n");
+  fprintf(out, "  mov ecx, edx\n");
+  fprintf(out, "  mov edx, esi\n");
+  fprintf(out, "  mov esi, ecx\n");
+  fprintf(out, "  xor edi, edi\n");
+  fprintf(out, "  jmp _div_longs_signs\n");
+  // Otherwise shift and subtract.  edx:eax becomes the quotient and
+  // edi:esi the remainder.
+  fprintf(out, "_div_longs_wide:\n");
+  fprintf(out, "  xor esi, esi\n");
+  fprintf(out, "  xor edi, edi\n");
+  fprintf(out, "  push 64\n");
+  fprintf(out, "_div_longs_loop:\n");
+  fprintf(out, "  shl eax, 1\n");
+  fprintf(out, "  rcl edx, 1\n");
+  fprintf(out, "  rcl esi, 1\n");
+  fprintf(out, "  rcl edi, 1\n");
+  fprintf(out, "  cmp edi, ecx\n");
+  fprintf(out, "  jb _div_longs_next\n");
+  fprintf(out, "  ja _div_longs_sub\n");
+  fprintf(out, "  cmp esi, ebx\n");
+  fprintf(out, "  jb _div_longs_next\n");
+  fprintf(out, "_div_longs_sub:\n");
+  fprintf(out, "  sub esi, ebx\n");
+  fprintf(out, "  sbb edi, ecx\n");
+  fprintf(out, "  inc eax\n");
+  fprintf(out, "_div_longs_next:\n");
+  fprintf(out, "  dec dword [esp]\n");
+  fprintf(out, "  jnz _div_longs_loop\n");
+  fprintf(out, "  add esp, 4\n");
+  fprintf(out, "_div_longs_signs:\n");
+  fprintf(out, "  test ebp, 1\n");
+  fprintf(out, "  jz _div_longs_quotient_pos\n");
+  fprintf(out, "  neg eax\n");
+  fprintf(out, "  adc edx, 0\n");
+  fprintf(out, "  neg edx\n");
+  fprintf(out, "_div_longs_quotient_pos:\n");
+  fprintf(out, "  test ebp, 2\n");
+  fprintf(out, "  jz _div_longs_remainder_pos\n");
+  fprintf(out, "  neg esi\n");
+  fprintf(out, "  adc edi, 0\n");
+  fprintf(out, "  neg edi\n");
+  fprintf(out, "_div_longs_remainder_pos:\n");
+  fprintf(out, "  mov [esp+16], eax\n");
+  fprintf(out, "  mov [esp+20], edx\n");
+  fprintf(out, "  mov [esp+8], esi\n");
+  fprintf(out, "  mov [esp+12], edi\n");
+  fprintf(out, "  pop ebp\n");
+  fprintf(out, "  ret\n\n");
+}
@@ -21,6 +21,7 @@ public:
   virtual ~X86();
 
   virtual int open(const char *filename);
+  virtual int get_instruction_size() { return 3; }
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
   virtual int init_heap(int field_count);
@@ -30,15 +31,17 @@ public:
   virtual void method_end(int local_count);
   virtual int push_local_var_int(int index);
   virtual int push_local_var_ref(int index);
+  virtual int push_local_var_long(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
   virtual int push_int(int32_t n);
-  //virtual int push_long(int64_t n);
+  virtual int push_long(int64_t n);
   //virtual int push_float(float f);
   //virtual int push_double(double f);
   virtual int push_ref(char *name);
   virtual int pop_local_var_int(int index);
   virtual int pop_local_var_ref(int index);
+  virtual int pop_local_var_long(int index);
   virtual int pop();
   virtual int dup();
   virtual int dup2();
@@ -66,16 +69,36 @@ public:
   virtual int inc_integer(int index, int num);
   virtual int integer_to_byte();
   virtual int integer_to_short();
+  virtual int add_long();
+  virtual int sub_long();
+  virtual int mul_long();
+  virtual int div_long();
+  virtual int mod_long();
+  virtual int neg_long();
+  virtual int shift_left_long();
+  virtual int shift_left_long(int count);
+  virtual int shift_right_long();
+  virtual int shift_right_long(int count);
+  virtual int shift_right_ulong();
+  virtual int shift_right_ulong(int count);
+  virtual int and_long();
+  virtual int or_long();
+  virtual int xor_long();
+  virtual int integer_to_long();
+  virtual int long_to_integer();
   virtual int jump_cond(const char *label, int cond, int distance);
   virtual int jump_cond_integer(const char *label, int cond, int distance);
+  virtual int compare_longs();
   virtual int ternary(int cond, int value_true, int value_false);
   virtual int ternary(int cond, int compare, int value_true, int value_false);
   virtual int return_local(int index, int local_count);
   virtual int return_integer(int local_count);
   virtual int return_void(int local_count);
+  virtual int return_long(int local_count);
   virtual int jump(const char *name, int distance);
   virtual int call(const char *name);
   virtual int invoke_static_method(const char *name, int params, int is_void);
+  virtual int invoke_static_method_long(const char *name, int params);
   virtual int put_static(const char *name, int index);
   virtual int get_static(const char *name, int index);
   virtual int brk();
@@ -103,11 +126,22 @@ protected:
   int stack;          // count how many things we put on the stack
   int method_count;   // count the number of methods being outputted
   bool is_main : 1;
+  bool need_div_longs : 1;
 
   int stack_alu(const char *instr);
   int stack_alu(const char *instr, int num);
   int stack_shift(const char *instr);
   int stack_div(bool is_quotient);
+  int stack_alu_long(const char *instr_lo, const char *instr_hi);
+  int stack_shift_long(const char *instr);
+  int stack_shift_long(const char *instr, int count);
+  int stack_div_long(bool is_quotient);
+  int invoke_static(const char *name, int params, int return_words);
+  void stack_entry(char *operand, int depth);
+  const char *load_stack_entry(int depth, const char *scratch);
+  void drop_stack_entries(int count);
+  void push_word(const char *src);
+  void insert_div_longs();
 };
 
 #endif
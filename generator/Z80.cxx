@@ -14,16 +14,22 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "CyclesZ80.h"
+#include "MethodIR.h"
 #include "Z80.h"
 
 #define REG_STACK(a) (stack_regs[a])
-#define LOCALS(i) (i * 4)
+#define LOCALS(a) (-2 - (local_offsets[a] * 2))
 
 // ABI is:
 // Using the real stack for now.  This could be slow.
 //
 // ix = temp?
 // iy = point to locals
+//
+// The locals are below iy, which points at the saved iy with the return
+// address above it.  The caller copies the params there before the call.
+// A float takes 2 stack entries and 2 locals with the high word on top.
 
 //                                 Z    NZ    LT    LE    GT    GE
 static const char *cond_str[] = { "eq", "ne", "lt", "le", "gt", "ge" };
@@ -40,9 +46,19 @@ enum
 
 Z80::Z80() :
   stack(0),
+  local_offsets(NULL),
+  locals_size(0),
   is_main(0),
   need_mul16_integer(0),
-  need_div16_integer(0)
+  need_div16_integer(0),
+  need_float_support(0),
+  need_add_float(0),
+  need_mul_float(0),
+  need_div_float(0),
+  need_float_to_integer(0),
+  need_integer_to_float(0),
+  need_compare_floats(0),
+  need_array_float_support(0)
 
   //,need_memory_read8(0),
   //need_memory_write8(0),
@@ -54,7 +70,12 @@ Z80::Z80() :
 
 Z80::~Z80()
 {
+  free(local_offsets);
+}
 
+Cycles *Z80::new_cycles()
+{
+  return new CyclesZ80();
 }
 
 int Z80::open(const char *filename)
@@ -76,6 +97,16 @@ int Z80::add_functions()
   // Math
   if(need_mul16_integer) { insert_mul16_integer(); }
   if(need_div16_integer) { insert_div16_integer(); }
+
+  // Floats
+  if(need_float_support) { insert_float_support(); }
+  if(need_add_float) { insert_add_float(); }
+  if(need_mul_float) { insert_mul_float(); }
+  if(need_div_float) { insert_div_float(); }
+  if(need_float_to_integer) { insert_float_to_integer(); }
+  if(need_integer_to_float) { insert_integer_to_float(); }
+  if(need_compare_floats) { insert_compare_floats(); }
+  if(need_array_float_support) { insert_array_float_support(); }
   
 /*  //Memory API 
   if(need_memory_read8) { insert_memory_read8(); }
@@ -141,9 +172,39 @@ void Z80::method_start(int local_count, int max_stack, int param_count, const ch
   // FIXME - this might be extra since there's a save_iy
   fprintf(out, "  push iy\n");
 
-  fprintf(out, "  ld iy, -%d\n", local_count * 2);
+  fprintf(out, "  ld iy, 0\n");
   fprintf(out, "  add iy, SP\n");
-  fprintf(out, "  ld SP, iy\n");
+
+  if (locals_size != 0)
+  {
+    fprintf(out, "  ld hl, -%d\n", locals_size * 2);
+    fprintf(out, "  add hl, SP\n");
+    fprintf(out, "  ld SP, hl\n");
+  }
+}
+
+void Z80::set_local_types(const uint8_t *local_types, int local_count)
+{
+  int n;
+
+  // A local that is ever a float takes 2 stack entries so each one gets
+  // its own offset from iy.  The caller copies params the same way.
+  local_offsets = (int *)realloc(local_offsets, (local_count + 1) * sizeof(int));
+  locals_size = 0;
+
+  for (n = 0; n < local_count; n++)
+  {
+    local_offsets[n] = locals_size;
+
+    if (local_types[n] == JAVA_TYPE_FLOAT || local_types[n] == IR_TYPE_MIXED)
+    {
+      locals_size += 2;
+    }
+      else
+    {
+      locals_size++;
+    }
+  }
 }
 
 void Z80::method_end(int local_count)
@@ -154,8 +215,8 @@ void Z80::method_end(int local_count)
 int Z80::push_local_var_int(int index)
 {
   fprintf(out, "  ;; push_local_var_int(%d)\n", index);
-  fprintf(out, "  ld e, (iy+%d)\n", (index * 2));
-  fprintf(out, "  ld d, (iy+%d)\n", (index * 2) + 1);
+  fprintf(out, "  ld e, (iy%+d)\n", LOCALS(index));
+  fprintf(out, "  ld d, (iy%+d)\n", LOCALS(index) + 1);
   fprintf(out, "  push de\n");
   stack++;
   return 0;
@@ -166,6 +227,19 @@ int Z80::push_local_var_ref(int index)
   return push_local_var_int(index);
 }
 
+int Z80::push_local_var_float(int index)
+{
+  fprintf(out, "  ;; push_local_var_float(%d)\n", index);
+  fprintf(out, "  ld e, (iy%+d)\n", LOCALS(index));
+  fprintf(out, "  ld d, (iy%+d)\n", LOCALS(index) + 1);
+  fprintf(out, "  push de\n");
+  fprintf(out, "  ld e, (iy%+d)\n", LOCALS(index) - 2);
+  fprintf(out, "  ld d, (iy%+d)\n", LOCALS(index) - 1);
+  fprintf(out, "  push de\n");
+  stack += 2;
+  return 0;
+}
+
 int Z80::push_ref_static(const char *name, int index)
 {
   fprintf(out, "  ;; push_ref_static(%d)\n", index);
@@ -188,8 +262,8 @@ int Z80::set_integer_local(int index, int value)
   //fprintf(out, "  ld de, 0x%04x\n", value);
   //fprintf(out, "  ld (iy+%d), e\n", (index * 2));
   //fprintf(out, "  ld (iy+%d), d\n", (index * 2) + 1);
-  fprintf(out, "  ld (iy+%d), 0x%02x\n", (index * 2), value & 0xff);
-  fprintf(out, "  ld (iy+%d), 0x%02x\n", (index * 2) + 1, (value >> 8) & 0xff);
+  fprintf(out, "  ld (iy%+d), 0x%02x\n", LOCALS(index), value & 0xff);
+  fprintf(out, "  ld (iy%+d), 0x%02x\n", LOCALS(index) + 1, (value >> 8) & 0xff);
   return 0;
 }
 
@@ -211,13 +285,19 @@ int Z80::push_int(int32_t n)
   return 0;
 }
 
-#if 0
-int Z80::push_long(int64_t n)
+int Z80::push_float(float f)
 {
-  return -1;
+  uint32_t *data = (uint32_t *)&f;
+
+  fprintf(out, "  ;; push_float(%f)\n", f);
+  push_int(*data & 0xffff);
+  push_int(*data >> 16);
+
+  return 0;
 }
 
-int Z80::push_float(float f)
+#if 0
+int Z80::push_long(int64_t n)
 {
   return -1;
 }
@@ -242,8 +322,8 @@ int Z80::pop_local_var_int(int index)
 {
   fprintf(out, "  ;; pop_local_var_int(%d)\n", index);
   fprintf(out, "  pop hl\n");
-  fprintf(out, "  ld (iy+%d), l\n", (index * 2));
-  fprintf(out, "  ld (iy+%d), h\n", (index * 2) + 1);
+  fprintf(out, "  ld (iy%+d), l\n", LOCALS(index));
+  fprintf(out, "  ld (iy%+d), h\n", LOCALS(index) + 1);
   stack--;
 
   return 0;
@@ -254,6 +334,20 @@ int Z80::pop_local_var_ref(int index)
   return pop_local_var_int(index);
 }
 
+int Z80::pop_local_var_float(int index)
+{
+  fprintf(out, "  ;; pop_local_var_float(%d)\n", index);
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  ld (iy%+d), l\n", LOCALS(index) - 2);
+  fprintf(out, "  ld (iy%+d), h\n", LOCALS(index) - 1);
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  ld (iy%+d), l\n", LOCALS(index));
+  fprintf(out, "  ld (iy%+d), h\n", LOCALS(index) + 1);
+  stack -= 2;
+
+  return 0;
+}
+
 int Z80::pop()
 {
   fprintf(out, "  ; pop()\n");
@@ -279,10 +373,10 @@ int Z80::dup2()
   fprintf(out, "  ; dup2()\n");
   fprintf(out, "  pop bc\n");
   fprintf(out, "  pop de\n");
-  fprintf(out, "  push bc\n");
   fprintf(out, "  push de\n");
   fprintf(out, "  push bc\n");
   fprintf(out, "  push de\n");
+  fprintf(out, "  push bc\n");
   stack += 2;
 
   return 0;
@@ -496,12 +590,12 @@ int Z80::xor_integer(int num)
 int Z80::inc_integer(int index, int num)
 {
   fprintf(out, "  ;; inc_integer(%d,%d)\n", index, num);
-  fprintf(out, "  ld h, (iy+%d)\n", (index * 2) + 1);
-  fprintf(out, "  ld l, (iy+%d)\n", (index * 2));
+  fprintf(out, "  ld h, (iy%+d)\n", LOCALS(index) + 1);
+  fprintf(out, "  ld l, (iy%+d)\n", LOCALS(index));
   fprintf(out, "  ld bc, %d\n", num);
   fprintf(out, "  add hl, bc\n");
-  fprintf(out, "  ld (iy+%d), h\n", (index * 2) + 1);
-  fprintf(out, "  ld (iy+%d), l\n", (index * 2));
+  fprintf(out, "  ld (iy%+d), h\n", LOCALS(index) + 1);
+  fprintf(out, "  ld (iy%+d), l\n", LOCALS(index));
   return 0;
 }
 
@@ -524,6 +618,88 @@ int Z80::integer_to_short()
   return 0;
 }
 
+int Z80::add_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  fprintf(out, "  call add_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int Z80::sub_float()
+{
+  need_float_support = 1;
+  need_add_float = 1;
+  fprintf(out, "  call sub_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int Z80::mul_float()
+{
+  need_float_support = 1;
+  need_mul_float = 1;
+  fprintf(out, "  call mul_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int Z80::div_float()
+{
+  need_float_support = 1;
+  need_div_float = 1;
+  fprintf(out, "  call div_float\n");
+  stack -= 2;
+
+  return 0;
+}
+
+int Z80::neg_float()
+{
+  // sign is the top bit of the high word
+  fprintf(out, "  ;; neg_float()\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor 0x80\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  push hl\n");
+
+  return 0;
+}
+
+int Z80::float_to_integer()
+{
+  need_float_to_integer = 1;
+  fprintf(out, "  call float_to_integer\n");
+  stack--;
+
+  return 0;
+}
+
+int Z80::integer_to_float()
+{
+  need_float_support = 1;
+  need_integer_to_float = 1;
+  fprintf(out, "  call integer_to_float\n");
+  stack++;
+
+  return 0;
+}
+
+int Z80::compare_floats(int cond)
+{
+  need_float_support = 1;
+  need_compare_floats = 1;
+  fprintf(out, "  call %s\n", cond == 0 ? "compare_floats_l" : "compare_floats_g");
+  stack -= 3;
+
+  return 0;
+}
+
 int Z80::jump_cond(const char *label, int cond, int distance)
 {
   fprintf(out, "  ;; jump_cond(%s, %s)\n", label, cond_str[cond]);
@@ -689,11 +865,9 @@ int Z80::ternary(int cond, int compare, int value_true, int value_false)
 int Z80::return_local(int index, int local_count)
 {
   fprintf(out, "  ;; return_local(%d,%d)\n", index, local_count);
-  fprintf(out, "  ld e, (iy+%d)\n", (index * 2));
-  fprintf(out, "  ld d, (iy+%d)\n", (index * 2) + 1);
-  restore_stack(local_count);
-  while (stack > 0) { fprintf(out, "  pop bc\n"); stack--; }
-  if (!is_main) { fprintf(out, "  pop iy\n"); }
+  fprintf(out, "  ld e, (iy%+d)\n", LOCALS(index));
+  fprintf(out, "  ld d, (iy%+d)\n", LOCALS(index) + 1);
+  restore_stack();
   fprintf(out, "  ret\n");
   return 0;
 }
@@ -703,9 +877,19 @@ int Z80::return_integer(int local_count)
   fprintf(out, "  ;; return_integer(%d)\n", local_count);
   fprintf(out, "  pop de\n");
   stack--;
-  restore_stack(local_count);
-  while (stack > 0) { fprintf(out, "  pop bc\n"); stack--; }
-  if (!is_main) { fprintf(out, "  pop iy\n"); }
+  restore_stack();
+  fprintf(out, "  ret\n");
+  return 0;
+}
+
+int Z80::return_float(int local_count)
+{
+  // The high word comes back in de and the low word in bc.
+  fprintf(out, "  ;; return_float(%d)\n", local_count);
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  pop bc\n");
+  stack -= 2;
+  restore_stack();
   fprintf(out, "  ret\n");
   return 0;
 }
@@ -713,9 +897,7 @@ int Z80::return_integer(int local_count)
 int Z80::return_void(int local_count)
 {
   fprintf(out, "  ;; return_void(%d)\n", local_count);
-  restore_stack(local_count);
-  while (stack > 0) { fprintf(out, "  pop bc\n"); stack--; }
-  if (!is_main) { fprintf(out, "  pop iy\n"); }
+  restore_stack();
   fprintf(out, "  ret\n");
   return 0;
 }
@@ -726,6 +908,58 @@ int Z80::jump(const char *name, int distance)
   return 0;
 }
 
+bool Z80::has_jump_table(int low, int count)
+{
+  return count <= 256 && low >= -32768 && low + count - 1 <= 32767;
+}
+
+int Z80::jump_table(const char *default_label, int low, char **labels, int count)
+{
+  int n;
+
+  if (!has_jump_table(low, count)) { return -1; }
+
+  fprintf(out, "  ;; jump_table(low=%d, count=%d)\n", low, count);
+  fprintf(out, "  pop hl\n");
+
+  if (low != 0)
+  {
+    fprintf(out, "  ld bc, %d\n", -low);
+    fprintf(out, "  add hl, bc\n");
+  }
+
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp nz, %s\n", default_label);
+
+  if (count < 256)
+  {
+    fprintf(out, "  ld a, l\n");
+    fprintf(out, "  cp %d\n", count);
+    fprintf(out, "  jp nc, %s\n", default_label);
+  }
+
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  ld bc, jump_table_%d\n", label_count);
+  fprintf(out, "  add hl, bc\n");
+  fprintf(out, "  ld a, (hl)\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld h, (hl)\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  jp (hl)\n");
+  fprintf(out, "jump_table_%d:\n", label_count);
+
+  for (n = 0; n < count; n++)
+  {
+    fprintf(out, "  dw %s\n", labels[n]);
+  }
+
+  label_count++;
+  stack--;
+
+  return 0;
+}
+
 int Z80::call(const char *name)
 {
   return -1;
@@ -733,25 +967,21 @@ int Z80::call(const char *name)
 
 int Z80::invoke_static_method(const char *name, int params, int is_void)
 {
-int n;
-
   printf("invoke_static_method() name=%s params=%d is_void=%d\n", name, params, is_void);
   fprintf(out, "  ;; invoke_static_method(%s,%d,%d)\n", name, params, is_void);
 
-  // Pop all params off stack
-  fprintf(out, "  ld hl, -%d\n", params * 2);
-  fprintf(out, "  add hl, SP\n");
-  fprintf(out, "  ld SP, hl\n");
-
-  // Copy all params to local area of new method (SP - 4 - (params * 2))
-  // since we will push iy and the return address.
-  fprintf(out, "  ld ix, -%d\n", (params * 2) + 4);
-  fprintf(out, "  add ix, SP\n");
-
-  for (n = 0; n < params; n++)
+  if (params != 0)
   {
-    fprintf(out, "  ld e, (ix+%d)\n", (params * 2) + (n * 2));
-    fprintf(out, "  ld (ix+%d), e\n", (n * 2));
+    // Copy all params to local area of new method (4 bytes down since
+    // it will push the return address and iy) and pop them off stack.
+    fprintf(out, "  ld hl, -4\n");
+    fprintf(out, "  add hl, SP\n");
+    fprintf(out, "  ex de, hl\n");
+    fprintf(out, "  ld hl, 0\n");
+    fprintf(out, "  add hl, SP\n");
+    fprintf(out, "  ld bc, %d\n", params * 2);
+    fprintf(out, "  ldir\n");
+    fprintf(out, "  ld SP, hl\n");
   }
 
   // Params are removed from the stack
@@ -768,6 +998,17 @@ int n;
   return 0;
 }
 
+int Z80::invoke_static_method_float(const char *name, int params)
+{
+  if (invoke_static_method(name, params, 1) != 0) { return -1; }
+
+  fprintf(out, "  push bc\n");
+  fprintf(out, "  push de\n");
+  stack += 2;
+
+  return 0;
+}
+
 int Z80::put_static(const char *name, int index)
 {
   fprintf(out, "  pop hl\n");
@@ -795,12 +1036,25 @@ int Z80::new_array(uint8_t type)
   fprintf(out, "  ld (hl), c\n");
   fprintf(out, "  inc hl\n");
   fprintf(out, "  ld (hl), b\n");
+  fprintf(out, "  inc hl\n");
+
+  // The array reference points past the length.
+  fprintf(out, "  push hl\n");
 
   if (type == TYPE_SHORT || type == TYPE_CHAR || type == TYPE_INT)
   {
     // If 2 byte size, then multiply array.length by 2 to compute new heap
     fprintf(out, "  sla c\n");
-    fprintf(out, "  rlc b\n");
+    fprintf(out, "  rl b\n");
+  }
+    else
+  if (type == TYPE_FLOAT)
+  {
+    // 4 bytes for each float
+    fprintf(out, "  sla c\n");
+    fprintf(out, "  rl b\n");
+    fprintf(out, "  sla c\n");
+    fprintf(out, "  rl b\n");
   }
     else
   {
@@ -901,6 +1155,14 @@ int Z80::array_read_int()
   return array_read_short();
 }
 
+int Z80::array_read_float()
+{
+  need_array_float_support = 1;
+  fprintf(out, "  call array_read_float\n");
+
+  return 0;
+}
+
 int Z80::array_read_byte(const char *name, int field_id)
 {
   fprintf(out, "  ;; array_read_byte(name,field_id);\n");
@@ -940,6 +1202,16 @@ int Z80::array_read_int(const char *name, int field_id)
   return array_read_short(name, field_id);
 }
 
+int Z80::array_read_float(const char *name, int field_id)
+{
+  need_array_float_support = 1;
+  fprintf(out, "  ld de, (%s)\n", name);
+  fprintf(out, "  call array_read_float2\n");
+  stack++;
+
+  return 0;
+}
+
 int Z80::array_write_byte()
 {
   fprintf(out, "  ;; array_write_byte()\n");
@@ -973,6 +1245,15 @@ int Z80::array_write_int()
   return array_write_short();
 }
 
+int Z80::array_write_float()
+{
+  need_array_float_support = 1;
+  fprintf(out, "  call array_write_float\n");
+  stack -= 4;
+
+  return 0;
+}
+
 int Z80::array_write_byte(const char *name, int field_id)
 {
   fprintf(out, "  ;; array_write_byte(name,field_id)\n");
@@ -1004,6 +1285,16 @@ int Z80::array_write_int(const char *name, int field_id)
   return array_write_short(name, field_id);
 }
 
+int Z80::array_write_float(const char *name, int field_id)
+{
+  need_array_float_support = 1;
+  fprintf(out, "  ld de, (%s)\n", name);
+  fprintf(out, "  call array_write_float2\n");
+  stack -= 3;
+
+  return 0;
+}
+
 int Z80::stack_alu(int alu_op)
 {
   fprintf(out, "  ;; stack_alu(%s)\n", alu_str[alu_op]);
@@ -1123,10 +1414,10 @@ int Z80::stack_alu_const(int alu_op, int num)
   return 0;
 }
 
-void Z80::restore_stack(int count)
+void Z80::restore_stack()
 {
-  fprintf(out, "  ld iy, %d\n", count * 2);
-  fprintf(out, "  add iy, SP\n");
+  // iy points at the saved iy so this drops the locals and anything left
+  // on the stack.
   fprintf(out, "  ld SP, iy\n");
   fprintf(out, "  pop iy\n");
 }
@@ -1331,3 +1622,823 @@ void Z80::insert_div16_integer()
   fprintf(out, "  ret\n");
 }
 
+
+void Z80::insert_float_support()
+{
+  // Helpers shared by the soft float routines.  A float is 2 stack entries
+  // with the high word on top.  a is hl:hl' and b is de:de' (high word in
+  // the main registers).  The routines pop their return address into ix
+  // and end with jp (ix).  Denormals are treated as 0.
+  fprintf(out, "float_pop_ab:\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  push bc\n");
+  fprintf(out, "  ret\n");
+  // Sets carry if a or b is NaN.
+  fprintf(out, "float_is_nan:\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr nz, float_is_nan_b\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nz, float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_b:\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr nz, float_is_nan_no\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or d\n");
+  fprintf(out, "  or e\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nz, float_is_nan_yes\n");
+  fprintf(out, "float_is_nan_no:\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  ret\n");
+  fprintf(out, "float_is_nan_yes:\n");
+  fprintf(out, "  scf\n");
+  fprintf(out, "  ret\n");
+  // Exponent of a in c and b in b.
+  fprintf(out, "float_exponents:\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ret\n");
+  // hl:hl' is the mantissa with the hidden bit at bit 31, bc the exponent
+  // (16 bit signed) and b' the sign.  Rounds to nearest even and pushes
+  // the float.  Anything too small for a normal float becomes 0.
+  fprintf(out, "float_pack:\n");
+  fprintf(out, "  bit 7, b\n");
+  fprintf(out, "  jr nz, float_pack_zero\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or c\n");
+  fprintf(out, "  jr z, float_pack_zero\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  cp 0x80\n");
+  fprintf(out, "  jr c, float_pack_no_round\n");
+  fprintf(out, "  jr nz, float_pack_round_up\n");
+  fprintf(out, "  bit 0, h\n");
+  fprintf(out, "  jr z, float_pack_no_round\n");
+  fprintf(out, "float_pack_round_up:\n");
+  fprintf(out, "  inc h\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nz, float_pack_exponent\n");
+  fprintf(out, "  inc l\n");
+  fprintf(out, "  jr nz, float_pack_exponent\n");
+  fprintf(out, "  inc h\n");
+  fprintf(out, "  jr nz, float_pack_exponent\n");
+  fprintf(out, "  ld h, 0x80\n");
+  fprintf(out, "  inc bc\n");
+  fprintf(out, "  jr float_pack_exponent\n");
+  fprintf(out, "float_pack_no_round:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "float_pack_exponent:\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jr nz, float_pack_inf\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr z, float_pack_inf\n");
+  // The low bit of the exponent goes where the hidden bit was.
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld l, h\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  add a, a\n");
+  fprintf(out, "  srl c\n");
+  fprintf(out, "  rra\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or d\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  jr float_push_a\n");
+  fprintf(out, "float_pack_inf:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or 0x7f\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld l, 0x80\n");
+  fprintf(out, "  jr float_push_a\n");
+  fprintf(out, "float_pack_zero:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld l, 0\n");
+  fprintf(out, "  jr float_push_a\n");
+  fprintf(out, "float_nan:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld hl, 0x7fc0\n");
+  fprintf(out, "float_push_a:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  push hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  push hl\n");
+  fprintf(out, "  jp (ix)\n");
+}
+
+void Z80::insert_add_float()
+{
+  fprintf(out, "sub_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  call float_pop_ab\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  xor 0x80\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  jr add_float_start\n");
+  fprintf(out, "add_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  call float_pop_ab\n");
+  fprintf(out, "add_float_start:\n");
+  // Make a the one with the bigger magnitude.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  sub e\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  sbc a, d\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  sbc a, e\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  sbc a, c\n");
+  fprintf(out, "  jr nc, add_float_ordered\n");
+  fprintf(out, "  ex de, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ex de, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "add_float_ordered:\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  and 0x80\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  call float_exponents\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr nz, add_float_finite\n");
+  // a is inf or NaN.  inf - inf is NaN.
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jp nz, float_push_a\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jp nz, float_push_a\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor d\n");
+  fprintf(out, "  jp p, float_push_a\n");
+  fprintf(out, "  jp float_nan\n");
+  fprintf(out, "add_float_finite:\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jr nz, add_float_a_normal\n");
+  // Both are 0 and the answer is only -0 if both are.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  and d\n");
+  fprintf(out, "  and 0x80\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jp float_pack_zero\n");
+  fprintf(out, "add_float_a_normal:\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_push_a\n");
+  // c' is set when the signs are different so it's a subtract.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor d\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  sub b\n");
+  fprintf(out, "  ld b, a\n");
+  // Mantissas with the hidden bit at bit 31 and a byte for rounding.
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  or 0x80\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  or 0x80\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  ld h, l\n");
+  fprintf(out, "  ld l, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  ld d, e\n");
+  fprintf(out, "  ld e, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld e, a\n");
+  // Line up b with a.  Bits shifted out of b are kept as a sticky bit.
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  cp 32\n");
+  fprintf(out, "  jr c, add_float_shift\n");
+  fprintf(out, "  ld b, 0\n");
+  fprintf(out, "  ld de, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld de, 1\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr add_float_aligned\n");
+  fprintf(out, "add_float_shift:\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jr z, add_float_aligned\n");
+  fprintf(out, "  xor a\n");
+  fprintf(out, "add_float_shift_loop:\n");
+  fprintf(out, "  srl d\n");
+  fprintf(out, "  rr e\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rr d\n");
+  fprintf(out, "  rr e\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nc, add_float_shift_next\n");
+  fprintf(out, "  ld a, 1\n");
+  fprintf(out, "add_float_shift_next:\n");
+  fprintf(out, "  djnz add_float_shift_loop\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or e\n");
+  fprintf(out, "  ld e, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "add_float_aligned:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  bit 7, c\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nz, add_float_subtract\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, de\n");
+  fprintf(out, "  jp nc, float_pack\n");
+  // Carry out of bit 31 so shift right one keeping the sticky bit.
+  fprintf(out, "  rr h\n");
+  fprintf(out, "  rr l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rr h\n");
+  fprintf(out, "  rr l\n");
+  fprintf(out, "  jr nc, add_float_carry\n");
+  fprintf(out, "  set 0, l\n");
+  fprintf(out, "add_float_carry:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  inc bc\n");
+  fprintf(out, "  jp float_pack\n");
+  fprintf(out, "add_float_subtract:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr nz, add_float_normalize\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jp float_pack_zero\n");
+  fprintf(out, "add_float_normalize:\n");
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  jp nz, float_pack\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, hl\n");
+  fprintf(out, "  dec bc\n");
+  fprintf(out, "  jr add_float_normalize\n");
+}
+
+void Z80::insert_mul_float()
+{
+  fprintf(out, "mul_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  call float_pop_ab\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor d\n");
+  fprintf(out, "  and 0x80\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  call float_exponents\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr z, mul_float_special\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr z, mul_float_special\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_pack_zero\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jr nz, mul_float_normal\n");
+  fprintf(out, "  jp float_pack_zero\n");
+  fprintf(out, "mul_float_special:\n");
+  // NaN if either is NaN or it's inf * 0 (a denormal counts as 0),
+  // otherwise inf.
+  fprintf(out, "  call float_is_nan\n");
+  fprintf(out, "  jp c, float_nan\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_nan\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_nan\n");
+  fprintf(out, "  jp float_pack_inf\n");
+  fprintf(out, "mul_float_normal:\n");
+  // bc = ea + eb - 127, kept on the stack with the sign during the loop.
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  add a, b\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  ld a, 0\n");
+  fprintf(out, "  adc a, 0\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  sub 127\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  sbc a, 0\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  push bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  push bc\n");
+  // The mantissa of a goes in d e d' and of b in c b e'.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  ld b, d\n");
+  fprintf(out, "  ld d, l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld c, e\n");
+  fprintf(out, "  set 7, c\n");
+  fprintf(out, "  ld d, l\n");
+  fprintf(out, "  set 7, d\n");
+  fprintf(out, "  ld e, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  ld bc, 0x1800\n");
+  // Shift and add from the low bit of b.  The top 32 bits of the 48 bit
+  // product end up in hl:hl' and anything below that is sticky in c'.
+  fprintf(out, "mul_float_loop:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  srl c\n");
+  fprintf(out, "  rr b\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rr e\n");
+  fprintf(out, "  jr nc, mul_float_shift\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  add a, d\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "mul_float_shift:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rr h\n");
+  fprintf(out, "  rr l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rr h\n");
+  fprintf(out, "  rr l\n");
+  fprintf(out, "  jr nc, mul_float_next\n");
+  fprintf(out, "  ld c, 1\n");
+  fprintf(out, "mul_float_next:\n");
+  fprintf(out, "  djnz mul_float_loop\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop bc\n");
+  // The product's top bit is bit 31 or 30.
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  jr nz, mul_float_47\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, hl\n");
+  fprintf(out, "  jr mul_float_sticky\n");
+  fprintf(out, "mul_float_47:\n");
+  fprintf(out, "  inc bc\n");
+  fprintf(out, "mul_float_sticky:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jp float_pack\n");
+}
+
+void Z80::insert_div_float()
+{
+  fprintf(out, "div_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  call float_pop_ab\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor d\n");
+  fprintf(out, "  and 0x80\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  call float_exponents\n");
+  fprintf(out, "  call float_is_nan\n");
+  fprintf(out, "  jp c, float_nan\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr nz, div_float_a_finite\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jp z, float_nan\n");
+  fprintf(out, "  jp float_pack_inf\n");
+  fprintf(out, "div_float_a_finite:\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jp z, float_pack_zero\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jr nz, div_float_b_normal\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_nan\n");
+  fprintf(out, "  jp float_pack_inf\n");
+  fprintf(out, "div_float_b_normal:\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  jp z, float_pack_zero\n");
+  // bc = ea - eb + 127
+  fprintf(out, "  sub b\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  sbc a, a\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  add a, 127\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  ld a, b\n");
+  fprintf(out, "  adc a, 0\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld h, 0\n");
+  fprintf(out, "  set 7, l\n");
+  fprintf(out, "  ld d, 0\n");
+  fprintf(out, "  set 7, e\n");
+  // If a < b shift it so the first bit of the quotient is 1.
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  sub e\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  sbc a, d\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  sbc a, e\n");
+  fprintf(out, "  jr nc, div_float_start\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, hl\n");
+  fprintf(out, "  dec bc\n");
+  fprintf(out, "div_float_start:\n");
+  fprintf(out, "  push bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  push bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, 32\n");
+  // After the subtract (and add back if it went negative) carry is the
+  // inverse of the quotient bit.  The quotient goes in bc:bc'.
+  fprintf(out, "div_float_loop:\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  jr nc, div_float_bit\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, de\n");
+  fprintf(out, "div_float_bit:\n");
+  fprintf(out, "  ccf\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rl c\n");
+  fprintf(out, "  rl b\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  rl c\n");
+  fprintf(out, "  rl b\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  adc hl, hl\n");
+  fprintf(out, "  dec a\n");
+  fprintf(out, "  jr nz, div_float_loop\n");
+  // Anything left over is the sticky bit.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  ld h, b\n");
+  fprintf(out, "  ld l, c\n");
+  fprintf(out, "  jr z, div_float_exact\n");
+  fprintf(out, "  set 0, l\n");
+  fprintf(out, "div_float_exact:\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld h, b\n");
+  fprintf(out, "  ld l, c\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  jp float_pack\n");
+}
+
+void Z80::insert_integer_to_float()
+{
+  fprintf(out, "integer_to_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, 0\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld bc, 142\n");
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  jr z, integer_to_float_positive\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld b, 0x80\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  xor a\n");
+  fprintf(out, "  sub l\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  sbc a, a\n");
+  fprintf(out, "  sub h\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "integer_to_float_positive:\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  jp z, float_pack_zero\n");
+  fprintf(out, "integer_to_float_normalize:\n");
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  jp nz, float_pack\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  dec bc\n");
+  fprintf(out, "  jr integer_to_float_normalize\n");
+}
+
+void Z80::insert_float_to_integer()
+{
+  // Rounds toward 0.  NaN is 0 and anything that doesn't fit in 16 bits
+  // is clamped.
+  fprintf(out, "float_to_integer:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  cp 127\n");
+  fprintf(out, "  jr c, float_to_integer_zero\n");
+  fprintf(out, "  cp 142\n");
+  fprintf(out, "  jr c, float_to_integer_shift\n");
+  fprintf(out, "  inc a\n");
+  fprintf(out, "  jr nz, float_to_integer_clamp\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  or d\n");
+  fprintf(out, "  or e\n");
+  fprintf(out, "  jr nz, float_to_integer_zero\n");
+  fprintf(out, "float_to_integer_clamp:\n");
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  ld hl, 0x7fff\n");
+  fprintf(out, "  jr z, float_to_integer_push\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  jr float_to_integer_push\n");
+  fprintf(out, "float_to_integer_zero:\n");
+  fprintf(out, "  ld hl, 0\n");
+  fprintf(out, "  jr float_to_integer_push\n");
+  fprintf(out, "float_to_integer_shift:\n");
+  // Top 16 bits of the mantissa shifted right 142 - exponent times.
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld a, 142\n");
+  fprintf(out, "  sub b\n");
+  fprintf(out, "  ld b, a\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  ld h, l\n");
+  fprintf(out, "  set 7, h\n");
+  fprintf(out, "  ld l, d\n");
+  fprintf(out, "float_to_integer_loop:\n");
+  fprintf(out, "  srl h\n");
+  fprintf(out, "  rr l\n");
+  fprintf(out, "  djnz float_to_integer_loop\n");
+  fprintf(out, "  rla\n");
+  fprintf(out, "  jr nc, float_to_integer_push\n");
+  fprintf(out, "  xor a\n");
+  fprintf(out, "  sub l\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  sbc a, a\n");
+  fprintf(out, "  sub h\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "float_to_integer_push:\n");
+  fprintf(out, "  push hl\n");
+  fprintf(out, "  jp (ix)\n");
+}
+
+void Z80::insert_compare_floats()
+{
+  // fcmpl / fcmpg: -1, 0 or 1 comparing a to b.  They only differ in what
+  // NaN gives.
+  fprintf(out, "compare_floats_g:\n");
+  fprintf(out, "  ld a, 1\n");
+  fprintf(out, "  jr compare_floats_start\n");
+  fprintf(out, "compare_floats_l:\n");
+  fprintf(out, "  ld a, 0xff\n");
+  fprintf(out, "compare_floats_start:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  call float_pop_ab\n");
+  fprintf(out, "  ld c, a\n");
+  fprintf(out, "  call float_is_nan\n");
+  fprintf(out, "  ld a, c\n");
+  fprintf(out, "  jr c, compare_floats_push\n");
+  // -0 and 0 are equal.
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or d\n");
+  fprintf(out, "  and 0x7f\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  or e\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  or d\n");
+  fprintf(out, "  or e\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr z, compare_floats_push\n");
+  // Flip the magnitude of negative numbers and then the sign bits so it's
+  // an unsigned compare.
+  fprintf(out, "  bit 7, h\n");
+  fprintf(out, "  jr z, compare_floats_a_positive\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor 0x7f\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld a, l\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "compare_floats_a_positive:\n");
+  fprintf(out, "  bit 7, d\n");
+  fprintf(out, "  jr z, compare_floats_b_positive\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  xor 0x7f\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld e, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  ld a, e\n");
+  fprintf(out, "  cpl\n");
+  fprintf(out, "  ld e, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "compare_floats_b_positive:\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  xor 0x80\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  ld a, d\n");
+  fprintf(out, "  xor 0x80\n");
+  fprintf(out, "  ld d, a\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or a\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  sbc hl, de\n");
+  fprintf(out, "  ld a, 0xff\n");
+  fprintf(out, "  jr c, compare_floats_push\n");
+  fprintf(out, "  ld a, h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  or h\n");
+  fprintf(out, "  or l\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jr z, compare_floats_push\n");
+  fprintf(out, "  ld a, 1\n");
+  fprintf(out, "compare_floats_push:\n");
+  fprintf(out, "  ld l, a\n");
+  fprintf(out, "  add a, a\n");
+  fprintf(out, "  sbc a, a\n");
+  fprintf(out, "  ld h, a\n");
+  fprintf(out, "  push hl\n");
+  fprintf(out, "  jp (ix)\n");
+}
+
+void Z80::insert_array_float_support()
+{
+  // array_read_float
+  fprintf(out, "array_read_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  jr array_read_float_index\n");
+  // array_read_float2 (de already has the array)
+  fprintf(out, "array_read_float2:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "array_read_float_index:\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  add hl, de\n");
+  fprintf(out, "  ld e, (hl)\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld d, (hl)\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  push de\n");
+  fprintf(out, "  ld e, (hl)\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld d, (hl)\n");
+  fprintf(out, "  push de\n");
+  fprintf(out, "  jp (ix)\n");
+  // array_write_float
+  fprintf(out, "array_write_float:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  jr array_write_float_index\n");
+  // array_write_float2 (de already has the array)
+  fprintf(out, "array_write_float2:\n");
+  fprintf(out, "  pop ix\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop de\n");
+  fprintf(out, "  pop bc\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "array_write_float_index:\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  add hl, hl\n");
+  fprintf(out, "  add hl, de\n");
+  fprintf(out, "  push hl\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  pop hl\n");
+  fprintf(out, "  ld (hl), c\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld (hl), b\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld (hl), e\n");
+  fprintf(out, "  inc hl\n");
+  fprintf(out, "  ld (hl), d\n");
+  fprintf(out, "  exx\n");
+  fprintf(out, "  jp (ix)\n");
+}
+
@@ -21,6 +21,8 @@ public:
   virtual ~Z80();
 
   virtual int open(const char *filename);
+  virtual Cycles *new_cycles();
+  virtual int get_instruction_size() { return 2; }
   virtual int add_functions();
   virtual int start_init();
   virtual int insert_static_field_define(const char *name, const char *type, int index);
@@ -28,19 +30,23 @@ public:
   virtual int field_init_int(char *name, int index, int value);
   virtual int field_init_ref(char *name, int index);
   virtual void method_start(int local_count, int max_stack, int param_count, const char *name);
+  virtual void set_local_types(const uint8_t *local_types, int local_count);
+  virtual int get_float_size() { return 2; }
   virtual void method_end(int local_count);
   virtual int push_local_var_int(int index);
   virtual int push_local_var_ref(int index);
+  virtual int push_local_var_float(int index);
   virtual int push_ref_static(const char *name, int index);
   virtual int push_fake();
   virtual int set_integer_local(int index, int value);
   virtual int push_int(int32_t n);
   //virtual int push_long(int64_t n);
-  //virtual int push_float(float f);
+  virtual int push_float(float f);
   //virtual int push_double(double f);
   virtual int push_ref(char *name);
   virtual int pop_local_var_int(int index);
   virtual int pop_local_var_ref(int index);
+  virtual int pop_local_var_float(int index);
   virtual int pop();
   virtual int dup();
   virtual int dup2();
@@ -68,16 +74,28 @@ public:
   virtual int inc_integer(int index, int num);
   virtual int integer_to_byte();
   virtual int integer_to_short();
+  virtual int add_float();
+  virtual int sub_float();
+  virtual int mul_float();
+  virtual int div_float();
+  virtual int neg_float();
+  virtual int float_to_integer();
+  virtual int integer_to_float();
+  virtual int compare_floats(int cond);
   virtual int jump_cond(const char *label, int cond, int distance);
   virtual int jump_cond_integer(const char *label, int cond, int distance);
   virtual int ternary(int cond, int value_true, int value_false);
   virtual int ternary(int cond, int compare, int value_true, int value_false);
   virtual int return_local(int index, int local_count);
   virtual int return_integer(int local_count);
+  virtual int return_float(int local_count);
   virtual int return_void(int local_count);
   virtual int jump(const char *name, int distance);
+  virtual bool has_jump_table(int low, int count);
+  virtual int jump_table(const char *default_label, int low, char **labels, int count);
   virtual int call(const char *name);
   virtual int invoke_static_method(const char *name, int params, int is_void);
+  virtual int invoke_static_method_float(const char *name, int params);
   virtual int put_static(const char *name, int index);
   virtual int get_static(const char *name, int index);
   virtual int brk();
@@ -89,15 +107,19 @@ public:
   virtual int array_read_byte();
   virtual int array_read_short();
   virtual int array_read_int();
+  virtual int array_read_float();
   virtual int array_read_byte(const char *name, int field_id);
   virtual int array_read_short(const char *name, int field_id);
   virtual int array_read_int(const char *name, int field_id);
+  virtual int array_read_float(const char *name, int field_id);
   virtual int array_write_byte();
   virtual int array_write_short();
   virtual int array_write_int();
+  virtual int array_write_float();
   virtual int array_write_byte(const char *name, int field_id);
   virtual int array_write_short(const char *name, int field_id);
   virtual int array_write_int(const char *name, int field_id);
+  virtual int array_write_float(const char *name, int field_id);
   //virtual void close();
   
 
@@ -121,10 +143,20 @@ protected:
   //int reg;            // count number of registers are are using as stack
   //int reg_max;        // size of register stack 
   int stack;          // count how many things we put on the stack
+  int *local_offsets;
+  int locals_size;
   bool is_main : 1;
   
   bool need_mul16_integer:1;
   bool need_div16_integer:1;
+  bool need_float_support:1;
+  bool need_add_float:1;
+  bool need_mul_float:1;
+  bool need_div_float:1;
+  bool need_float_to_integer:1;
+  bool need_integer_to_float:1;
+  bool need_compare_floats:1;
+  bool need_array_float_support:1;
   
   //// Memory API
   //bool need_memory_read8:1;
@@ -133,11 +165,19 @@ protected:
   //bool need_memory_write16:1;
 
 private:
-  void restore_stack(int count);
+  void restore_stack();
   
   void insert_mul16_integer();
   void insert_div16_integer();
   // void insert_mod16_integer(); now integrated into div16
+  void insert_float_support();
+  void insert_add_float();
+  void insert_mul_float();
+  void insert_div_float();
+  void insert_float_to_integer();
+  void insert_integer_to_float();
+  void insert_compare_floats();
+  void insert_array_float_support();
 
 
    //Memory API
@@ -0,0 +1,45 @@
+/**
+ *  Java Grinder
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: http://www.naken.cc/
+ * License: GPL
+ *
+ * Copyright 2014-2018 by Michael Kohn
+ *
+ */
+
+package net.mikekohn.java_grinder;
+
+/** Fixed point math on plain ints.  Q8.8 numbers have 8 bits of fraction
+    (1.0 is 256) and Q16.16 numbers have 16 bits of fraction (1.0 is
+    65536).  Add, subtract and compare them like any other int. */
+abstract public class Fixed
+{
+  protected Fixed() { }
+
+  /** Q8.8 multiply. */
+  public static int mul8(int a, int b)
+  {
+    return (int)(((long)a * b) >> 8);
+  }
+
+  /** Q8.8 divide.  On 32 bit platforms a << 8 has to fit in an int. */
+  public static int div8(int a, int b)
+  {
+    return (int)(((long)a << 8) / b);
+  }
+
+  /** Q16.16 multiply (32 bit platforms only). */
+  public static int mul16(int a, int b)
+  {
+    return (int)(((long)a * b) >> 16);
+  }
+
+  /** Q16.16 divide (32 bit platforms only). */
+  public static int div16(int a, int b)
+  {
+    return (int)(((long)a << 16) / b);
+  }
+}
+
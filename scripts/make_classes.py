@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+
+# Writes made up .class files for timing how long java_grinder takes to
+# compile big inputs (javac isn't needed).
+#
+#   make_classes.py [ -methods <n> ] [ -array <n> ] [ -classes <n> ] <dir>
+#
+#   -methods <n>  methods in the main class, all called from main()
+#   -array <n>    elements in each of the int and byte arrays <clinit> sets up
+#   -classes <n>  chain of external classes, each one calling the next
+#
+# The main class is <dir>/Synthetic.class and the external classes are
+# <dir>/Synthetic1.class .. <dir>/Synthetic<n>.class.
+
+import struct
+import sys
+
+class ClassFile:
+  def __init__(self, name):
+    self.name = name
+    self.constants = []
+    self.lookup = {}
+    self.fields = []
+    self.methods = []
+    self.this_class = self.add_class(name)
+    self.super_class = self.add_class("java/lang/Object")
+
+  def add(self, key, data):
+    if key not in self.lookup:
+      self.constants.append(data)
+      self.lookup[key] = len(self.constants)
+    return self.lookup[key]
+
+  def add_utf8(self, s):
+    data = s.encode("utf-8")
+    return self.add(("utf8", s), struct.pack(">BH", 1, len(data)) + data)
+
+  def add_class(self, name):
+    return self.add(("class", name), struct.pack(">BH", 7, self.add_utf8(name)))
+
+  def add_int(self, value):
+    return self.add(("int", value), struct.pack(">Bi", 3, value))
+
+  def add_name_type(self, name, descriptor):
+    return self.add(("nat", name, descriptor),
+      struct.pack(">BHH", 12, self.add_utf8(name), self.add_utf8(descriptor)))
+
+  def add_ref(self, tag, class_name, name, descriptor):
+    return self.add((tag, class_name, name, descriptor),
+      struct.pack(">BHH", tag, self.add_class(class_name),
+        self.add_name_type(name, descriptor)))
+
+  def field_ref(self, class_name, name, descriptor):
+    return self.add_ref(9, class_name, name, descriptor)
+
+  def method_ref(self, class_name, name, descriptor):
+    return self.add_ref(10, class_name, name, descriptor)
+
+  def add_field(self, name, descriptor):
+    self.fields.append(struct.pack(">HHHH", 0x0008,
+      self.add_utf8(name), self.add_utf8(descriptor), 0))
+
+  def add_method(self, name, descriptor, code, max_stack, max_locals):
+    body = struct.pack(">HHI", max_stack, max_locals, len(code)) + code
+    body += struct.pack(">HH", 0, 0)
+    attribute = struct.pack(">HI", self.add_utf8("Code"), len(body)) + body
+    self.methods.append(struct.pack(">HHHH", 0x0009,
+      self.add_utf8(name), self.add_utf8(descriptor), 1) + attribute)
+
+  def write(self, filename):
+    # Version 49 (Java 5) class files don't need a StackMapTable.
+    data = struct.pack(">IHH", 0xcafebabe, 0, 49)
+    data += struct.pack(">H", len(self.constants) + 1) + b"".join(self.constants)
+    data += struct.pack(">HHHH", 0x0021, self.this_class, self.super_class, 0)
+    data += struct.pack(">H", len(self.fields)) + b"".join(self.fields)
+    data += struct.pack(">H", len(self.methods)) + b"".join(self.methods)
+    data += struct.pack(">H", 0)
+
+    out = open(filename, "wb")
+    out.write(data)
+    out.close()
+
+class Code:
+  def __init__(self):
+    self.code = b""
+    self.labels = {}
+    self.fixups = []
+
+  def op(self, opcode, operands=b""):
+    self.code += bytes([opcode]) + operands
+
+  def push_int(self, value):
+    if -1 <= value <= 5:
+      self.op(0x03 + value)
+    elif -128 <= value <= 127:
+      self.op(0x10, struct.pack(">b", value))
+    else:
+      self.op(0x11, struct.pack(">h", value))
+
+  def label(self, name):
+    self.labels[name] = len(self.code)
+
+  def branch(self, opcode, name):
+    self.fixups.append((len(self.code), name))
+    self.op(opcode, b"\0\0")
+
+  def get(self):
+    code = bytearray(self.code)
+    for address, name in self.fixups:
+      code[address + 1:address + 3] = struct.pack(">h", self.labels[name] - address)
+    return bytes(code)
+
+def add_array(java_class, code, name, length, array_type, store):
+  code.push_int(length)
+  code.op(0xbc, bytes([array_type]))          # newarray
+
+  for n in range(length):
+    code.op(0x59)                             # dup
+    code.push_int(n)
+    code.push_int(((n * 37) + 11) % 100)
+    code.op(store)
+
+  code.op(0xb3, struct.pack(">H", java_class.field_ref(java_class.name, name, "[" + ("I" if array_type == 10 else "B"))))
+
+def make_main_class(methods, array, classes):
+  java_class = ClassFile("Synthetic")
+
+  java_class.add_field("table", "[I")
+  java_class.add_field("bytes", "[B")
+
+  code = Code()
+  add_array(java_class, code, "table", array, 10, 0x4f)
+  add_array(java_class, code, "bytes", array, 8, 0x54)
+  code.op(0xb1)
+
+  if len(code.code) > 65535:
+    print("Error: -array %d makes <clinit> bigger than 64k" % array)
+    sys.exit(1)
+
+  java_class.add_method("<clinit>", "()V", code.get(), 4, 0)
+
+  table = java_class.field_ref("Synthetic", "table", "[I")
+  bytes_ref = java_class.field_ref("Synthetic", "bytes", "[B")
+  loop_count = min(8, array)
+
+  for n in range(methods):
+    code = Code()
+
+    # total = n; for (i = 0; i < 8; i++) { total += table[i] + bytes[i] + i * k; }
+    code.push_int(n % 30000)
+    code.op(0x3b)                             # istore_0
+    code.op(0x03)                             # iconst_0
+    code.op(0x3c)                             # istore_1
+    code.branch(0xa7, "cond")                 # goto
+
+    code.label("loop")
+    code.op(0x1a)                             # iload_0
+
+    if loop_count > 0:
+      code.op(0xb2, struct.pack(">H", table))
+      code.op(0x1b)
+      code.op(0x2e)                           # iaload
+      code.op(0x60)
+      code.op(0xb2, struct.pack(">H", bytes_ref))
+      code.op(0x1b)
+      code.op(0x33)                           # baload
+      code.op(0x60)
+
+    code.op(0x1b)
+    code.push_int((n % 100) + 2)
+    code.op(0x68)                             # imul
+    code.op(0x60)
+    code.op(0x3b)
+    code.op(0x84, bytes([1, 1]))              # iinc 1, 1
+
+    code.label("cond")
+    code.op(0x1b)
+    code.push_int(max(loop_count, 1))
+    code.branch(0xa1, "loop")                 # if_icmplt
+
+    # if (total > 100) { total = total >> 1; } else { total = total ^ n; }
+    code.op(0x1a)
+    code.push_int(100)
+    code.branch(0xa4, "else")                 # if_icmple
+    code.op(0x1a)
+    code.op(0x04)
+    code.op(0x7a)                             # ishr
+    code.op(0x3b)
+    code.branch(0xa7, "end")
+    code.label("else")
+    code.op(0x1a)
+    code.push_int(n % 30000)
+    code.op(0x82)                             # ixor
+    code.op(0x3b)
+    code.label("end")
+
+    if n == 0 and classes > 0:
+      code.op(0x1a)
+      code.op(0xb8, struct.pack(">H", java_class.method_ref("Synthetic1", "get", "()I")))
+      code.op(0x60)
+      code.op(0x3b)
+
+    code.op(0x1a)
+    code.op(0xac)                             # ireturn
+
+    java_class.add_method("method_%d" % n, "()I", code.get(), 4, 2)
+
+  code = Code()
+
+  for n in range(methods):
+    code.op(0xb8, struct.pack(">H", java_class.method_ref("Synthetic", "method_%d" % n, "()I")))
+    code.op(0x57)                             # pop
+
+  code.op(0xb1)
+
+  if len(code.code) > 65535:
+    print("Error: -methods %d makes main() bigger than 64k" % methods)
+    sys.exit(1)
+
+  java_class.add_method("main", "([Ljava/lang/String;)V", code.get(), 1, 1)
+
+  return java_class
+
+def make_external_class(index, classes):
+  name = "Synthetic%d" % index
+  java_class = ClassFile(name)
+  field = "value_%d" % index
+
+  java_class.add_field(field, "I")
+
+  code = Code()
+  code.push_int(index)
+  code.op(0xb3, struct.pack(">H", java_class.field_ref(name, field, "I")))
+  code.op(0xb1)
+  java_class.add_method("<clinit>", "()V", code.get(), 1, 0)
+
+  code = Code()
+  code.op(0xb2, struct.pack(">H", java_class.field_ref(name, field, "I")))
+
+  if index < classes:
+    code.op(0xb8, struct.pack(">H", java_class.method_ref("Synthetic%d" % (index + 1), "get", "()I")))
+    code.op(0x60)
+
+  code.op(0xac)
+  java_class.add_method("get", "()I", code.get(), 2, 0)
+
+  return java_class
+
+def main():
+  methods = 100
+  array = 100
+  classes = 0
+  directory = None
+  n = 1
+
+  while n < len(sys.argv):
+    if sys.argv[n] == "-methods" and n + 1 < len(sys.argv):
+      methods = int(sys.argv[n + 1])
+      n += 2
+    elif sys.argv[n] == "-array" and n + 1 < len(sys.argv):
+      array = int(sys.argv[n + 1])
+      n += 2
+    elif sys.argv[n] == "-classes" and n + 1 < len(sys.argv):
+      classes = int(sys.argv[n + 1])
+      n += 2
+    else:
+      directory = sys.argv[n]
+      n += 1
+
+  if directory == None:
+    print("Usage: %s [ -methods <n> ] [ -array <n> ] [ -classes <n> ] <dir>" % sys.argv[0])
+    sys.exit(1)
+
+  make_main_class(methods, array, classes).write(directory + "/Synthetic.class")
+
+  for index in range(1, classes + 1):
+    make_external_class(index, classes).write(directory + "/Synthetic%d.class" % index)
+
+main()
+
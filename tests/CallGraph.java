@@ -0,0 +1,42 @@
+
+// result=15
+
+public class CallGraph
+{
+  // The loops keep these methods from being inlined, so the call
+  // graph still has to keep twice() / addFive() and strip neverCalled().
+  static public int twice(int a)
+  {
+    int total = 0;
+    int n;
+
+    for (n = 0; n < 2; n++) { total += a; }
+
+    return total;
+  }
+
+  static public int addFive(int a)
+  {
+    int total = twice(a);
+    int n;
+
+    for (n = 0; n < 5; n++) { total++; }
+
+    return total;
+  }
+
+  static public int neverCalled(int a)
+  {
+    int total = 0;
+    int n;
+
+    for (n = 0; n < 7; n++) { total += twice(a); }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    addFive(5);
+  }
+}
@@ -0,0 +1,31 @@
+
+// result=64
+
+public class ConstantFold
+{
+  static final int SCALE;
+  static final boolean DEBUG;
+
+  static
+  {
+    SCALE = 12;
+    DEBUG = false;
+  }
+
+  static public int scaled(int a)
+  {
+    int b = 3;
+    int c = 4;
+
+    if (DEBUG) { a = 1000; }
+    if (b > c) { a = 2000; }
+
+    return a + (SCALE << 2) + (b * c);
+  }
+
+  static public void main(String args[])
+  {
+    scaled(4);
+  }
+}
+
@@ -0,0 +1,33 @@
+
+// result=21
+
+public class DeadCode
+{
+  static final int LEVEL;
+
+  static
+  {
+    LEVEL = 3;
+  }
+
+  static public int pick(int a)
+  {
+    if (LEVEL > 2)
+    {
+      a = a + 1;
+    }
+      else
+    {
+      a = a + 100;
+    }
+
+    if (LEVEL == 0) { return 0; }
+
+    return a * 3;
+  }
+
+  static public void main(String args[])
+  {
+    pick(6);
+  }
+}
@@ -0,0 +1,51 @@
+// result=-393122
+// skip=msp430
+
+import net.mikekohn.java_grinder.Fixed;
+
+public class FixedMath
+{
+  // Q16.16 square root with Newton's method.
+  static public int sqrt16(int x)
+  {
+    int guess = x / 2;
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+      guess = (guess + Fixed.div16(x, guess)) / 2;
+    }
+
+    return guess;
+  }
+
+  // Q8.8 0.5x^2 - 1.25x + 3.
+  static public int poly8(int x)
+  {
+    return Fixed.mul8(Fixed.mul8(128, x) - 320, x) + 768;
+  }
+
+  static public int run()
+  {
+    int total = 0;
+    int i;
+
+    for (i = -4; i <= 4; i++)
+    {
+      total += poly8(i << 8);
+    }
+
+    total += sqrt16(2 << 16);
+    total += Fixed.div8(1 << 8, 3 << 8);
+    total += Fixed.mul16(-3 << 15, 5 << 16);
+    total += Fixed.div8(-7 << 8, 2 << 8) * 10;
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
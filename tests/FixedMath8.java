@@ -0,0 +1,53 @@
+// result=15189
+
+import net.mikekohn.java_grinder.Fixed;
+
+public class FixedMath8
+{
+  // Q8.8 square root with Newton's method.
+  static public int sqrt8(int x)
+  {
+    int guess = x / 2;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+      guess = (guess + Fixed.div8(x, guess)) / 2;
+    }
+
+    return guess;
+  }
+
+  // Q8.8 0.5x^2 - 1.25x + 3.
+  static public int poly8(int x)
+  {
+    return Fixed.mul8(Fixed.mul8(128, x) - 320, x) + 768;
+  }
+
+  // Only Q8.8 so everything fits in the 16 bit ints of the MSP430.
+  static public int run()
+  {
+    int total = 0;
+    int i;
+
+    for (i = -4; i <= 4; i++)
+    {
+      total += poly8(i << 8);
+    }
+
+    total += sqrt8(2 << 8);
+    total += Fixed.mul8(-640, -384);
+    total += Fixed.div8(1 << 8, 3 << 8);
+    total += Fixed.div8(100 << 8, 50 << 8);
+    total += Fixed.div8(-5000, 3000);
+    total += Fixed.div8(-7 << 8, 2 << 8);
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
@@ -0,0 +1,91 @@
+// result=16932
+// msp430=msp430g2553
+
+public class FloatMath
+{
+  static public float poly(float x)
+  {
+    return ((0.5f * x - 1.25f) * x + 3.0f) * x - 7.5f;
+  }
+
+  static public float average(float[] values)
+  {
+    float sum = 0;
+    int i;
+
+    for (i = 0; i < values.length; i++)
+    {
+      sum += values[i];
+    }
+
+    return sum / values.length;
+  }
+
+  // Newton's method, so there is a float divide in a loop.
+  static public float sqrt(float x)
+  {
+    float guess = x / 2;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+      guess = (guess + x / guess) / 2;
+    }
+
+    return guess;
+  }
+
+  // a < b compiles to fcmpg and a > b to fcmpl.
+  static public int compare(float a, float b)
+  {
+    if (a < b) { return -1; }
+    if (a > b) { return 1; }
+
+    return 0;
+  }
+
+  static public int toInt(float f)
+  {
+    return (int)f;
+  }
+
+  static public int run()
+  {
+    float[] values = new float[4];
+    float a, b;
+    int total = 0;
+    int i;
+
+    for (i = 0; i < values.length; i++)
+    {
+      values[i] = poly(i);
+    }
+
+    total += (int)(average(values) * 100);
+    total += (int)(sqrt(2) * 10000);
+    total += (int)(-poly(-3.5f));
+
+    total += compare(1.5f, 2.5f);
+    total += compare(2.5f, 1.5f) << 4;
+    total += compare(-0.0f, 0.0f) << 8;
+    total += compare(0.0f / 0.0f, 1) << 12;
+
+    // Out of range conversions saturate and NaN goes to 0.  Only the
+    // sign is checked since an int isn't 32 bits everywhere.
+    if (toInt(1.0e20f) > 0) { total += 1000; }
+    if (toInt(-1.0e20f) < 0) { total += 2000; }
+    total += toInt(0.0f / 0.0f);
+
+    // A float is 2 stack entries on some CPUs so the dup copies both.
+    a = b = sqrt(16);
+    total += (int)(a + b);
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
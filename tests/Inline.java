@@ -0,0 +1,36 @@
+
+// result=33
+
+public class Inline
+{
+  static int count;
+
+  static public int getCount()
+  {
+    return count;
+  }
+
+  static public int add(int a, int b)
+  {
+    return a + b;
+  }
+
+  static public int test(int n)
+  {
+    int total = 0;
+
+    while (n > 0)
+    {
+      total = add(total, n);
+      count = add(count, 2);
+      n--;
+    }
+
+    return total + getCount() + add(3, 18);
+  }
+
+  static public void main(String args[])
+  {
+    test(3);
+  }
+}
@@ -0,0 +1,87 @@
+// result=83272
+// skip=msp430
+
+public class LongMath
+{
+  static public long fib(int n)
+  {
+    long a = 0;
+    long b = 1;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+      long t = a + b;
+      a = b;
+      b = t;
+    }
+
+    return a;
+  }
+
+  static public long mix(long a, long b)
+  {
+    long c = a * b - (a ^ b);
+
+    c = c + (c << 7) + (c >>> 13) + (c >> 3);
+
+    return c | (a & 0xff);
+  }
+
+  static public long shifts(long v, int n)
+  {
+    return (v << n) ^ (v >> n) ^ (v >>> (n + 1));
+  }
+
+  static public int compare(long a, long b)
+  {
+    if (a < b) { return 1; }
+    if (a == b) { return 2; }
+    return 3;
+  }
+
+  static public int pick(int a, long v, int b)
+  {
+    b = a * 3 + a + (int)v;
+
+    return b + b * 2;
+  }
+
+  static public int run()
+  {
+    int total = 0;
+    long f = fib(80);
+    long m;
+    int s;
+    long x;
+
+    total += (int)(f % 1000);
+    total += (int)(f / 1000000000000L);
+
+    m = mix(123456789012L, -98765L);
+    total += (int)(m >>> 40) & 1023;
+    total += (int)m & 15;
+
+    total += (int)(shifts(f, 5) >>> 50);
+    total += (int)(shifts(-f, 37) >>> 48);
+
+    total += compare(-5L, 3L);
+    total += compare(1L << 40, 1L << 40) * 10;
+    total += compare(0x100000000L, 0xffffffffL) * 100;
+
+    s = -7;
+    x = s;
+    x = x / 2 + x % 3;
+    total += (int)x * 10;
+
+    total += pick(10, 0x500000007L, 9);
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
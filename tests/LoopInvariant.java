@@ -0,0 +1,35 @@
+// result=16
+
+public class LoopInvariant
+{
+  static int[] table = { 1, 2, 3, 4 };
+
+  static public int test()
+  {
+    int[] data = new int[6];
+    int total = 0;
+    int i;
+
+    for (i = 0; i < data.length; i++)
+    {
+      data[i] = i;
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+      total += data[i * 2];
+    }
+
+    for (i = 0; i < table.length; i++)
+    {
+      total += table[i];
+    }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    test();
+  }
+}
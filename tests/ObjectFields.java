@@ -0,0 +1,63 @@
+// result=22355
+
+public class ObjectFields
+{
+  byte small;
+  boolean flag;
+  char letter;
+  short delta;
+  int count;
+  int[] values;
+
+  static public int sum(ObjectFields o)
+  {
+    int total = o.count + o.delta + o.letter + o.small;
+    int i;
+
+    if (o.flag) { total += 100; }
+
+    for (i = 0; i < o.values.length; i++)
+    {
+      total += o.values[i];
+    }
+
+    return total;
+  }
+
+  // Everything fits in 16 bits so the MSP430 gets the same answer.
+  static public int run()
+  {
+    byte[] pad = new byte[3];
+    ObjectFields a = new ObjectFields();
+    ObjectFields b = new ObjectFields();
+    int i;
+
+    a.count = 1000;
+    a.delta = -300;
+    a.letter = 'A';
+    a.small = (byte)200;
+    a.flag = true;
+    a.values = new int[4];
+
+    for (i = 0; i < 4; i++)
+    {
+      a.values[i] = a.delta - i;
+      a.count += a.small;
+    }
+
+    b.count = a.count + a.count;
+    b.delta = (short)40000;
+    b.letter = 'z';
+    b.small = (byte)(a.small + pad.length);
+    b.values = new int[2];
+    b.values[1] = a.values[3];
+
+    return sum(a) * 3 - sum(b);
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
@@ -0,0 +1,52 @@
+// result=97
+
+public class Overload
+{
+  static public int sumTo(int n)
+  {
+    int total = 0;
+    int i;
+
+    for (i = 1; i <= n; i++)
+    {
+      total += i;
+    }
+
+    return total;
+  }
+
+  static public int countDown(int n)
+  {
+    int count = 0;
+
+    while (n > 0)
+    {
+      n -= 3;
+      count++;
+    }
+
+    return count;
+  }
+
+  // Each overload is the only caller of its helper.
+  static public int add(int a)
+  {
+    return sumTo(a) + a * 2;
+  }
+
+  static public int add(int a, int b)
+  {
+    return countDown(a) + b * 5;
+  }
+
+  static public int run()
+  {
+    return add(10) + add(20, 3);
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
@@ -26,8 +26,9 @@ public class StaticArrayPointer
       total += array[i];
     }
 
-    // force r15 to hold the value of total
-    total = reflection(total);
+    // force r15 to hold the value of total (a call that's stored
+    // somewhere gets inlined, one that's dropped doesn't)
+    reflection(total);
   }
 }
 
@@ -0,0 +1,101 @@
+// result=2352
+
+public class Switch
+{
+  // tableswitch with a hole in it.
+  static public int state(int n)
+  {
+    switch (n)
+    {
+      case 0: return 5;
+      case 1: return 7;
+      case 2: return 11;
+      case 3: return 13;
+      case 5: return 17;
+      default: return 1;
+    }
+  }
+
+  // lookupswitch with keys too far apart for a table.
+  static public int command(int c)
+  {
+    switch (c)
+    {
+      case 'A': return 3;
+      case 'Z': return 4;
+      case 1000: return 6;
+      case -20: return 8;
+      default: return 0;
+    }
+  }
+
+  // lookupswitch with ranges of keys going to the same case.
+  static public int classify(int c)
+  {
+    switch (c)
+    {
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        return 1;
+      case 'a': case 'b': case 'c':
+        return 2;
+      case ' ':
+        return 3;
+      default:
+        return 0;
+    }
+  }
+
+  static public int sum(int n)
+  {
+    int total = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+      switch (i & 3)
+      {
+        case 0: total += 1; break;
+        case 1: total += 10; break;
+        case 2: total += 100; break;
+        default: total += 1000; break;
+      }
+    }
+
+    return total;
+  }
+
+  static public int run()
+  {
+    int total = 0;
+    int i;
+
+    for (i = -1; i < 7; i++)
+    {
+      total += state(i);
+    }
+
+    total += command('A');
+    total += command(-20);
+    total += command(1000);
+    total += command('Z') * 10;
+    total += command(9);
+
+    total += classify('5');
+    total += classify('b');
+    total += classify(' ');
+    total += classify('x');
+    total += classify('/');
+    total += classify(':');
+
+    total += sum(10);
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    run();
+  }
+}
+
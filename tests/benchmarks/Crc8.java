@@ -0,0 +1,38 @@
+// result=244
+
+public class Crc8
+{
+  // The usual CRC check string "123456789".
+  static byte[] data = { 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39 };
+
+  static public int crc8()
+  {
+    int crc = 0;
+    int i, bit;
+
+    for (i = 0; i < data.length; i++)
+    {
+      crc ^= data[i];
+
+      for (bit = 0; bit < 8; bit++)
+      {
+        if ((crc & 0x80) != 0)
+        {
+          crc = ((crc << 1) ^ 0x07) & 0xff;
+        }
+          else
+        {
+          crc = (crc << 1) & 0xff;
+        }
+      }
+    }
+
+    return crc;
+  }
+
+  static public void main(String args[])
+  {
+    crc8();
+  }
+}
+
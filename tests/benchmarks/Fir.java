@@ -0,0 +1,42 @@
+// result=470
+
+public class Fir
+{
+  static int[] coeffs = { 1, 3, 6, 8, 8, 6, 3, 1 };
+  static int[] samples =
+  {
+    10, 40, 80, 95, 60, 20, 0, 5, 30, 70, 100, 90, 50, 15, 5, 25
+  };
+
+  static public int filter()
+  {
+    int[] output = new int[samples.length - coeffs.length + 1];
+    int total = 0;
+    int n, k, sum;
+
+    for (n = 0; n < output.length; n++)
+    {
+      sum = 0;
+
+      for (k = 0; k < coeffs.length; k++)
+      {
+        sum += coeffs[k] * samples[n + k];
+      }
+
+      output[n] = sum >> 5;
+    }
+
+    for (n = 0; n < output.length; n++)
+    {
+      total += output[n];
+    }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    filter();
+  }
+}
+
@@ -0,0 +1,57 @@
+// result=4055
+
+public class Plot
+{
+  // Bresenham lines on an 8x8 bitmap, one int per row.
+  static public void line(int[] bitmap, int x0, int y0, int x1, int y1)
+  {
+    int dx = x1 - x0;
+    int dy = y1 - y0;
+    int sx = 1;
+    int sy = 1;
+    int err, e2;
+
+    if (dx < 0) { dx = -dx; sx = -1; }
+    if (dy < 0) { dy = -dy; sy = -1; }
+
+    err = dx - dy;
+
+    while (true)
+    {
+      // Not |= since javac makes that a dup2.
+      bitmap[y0] = bitmap[y0] | (1 << x0);
+
+      if (x0 == x1 && y0 == y1) { break; }
+
+      e2 = err << 1;
+
+      if (e2 > -dy) { err -= dy; x0 += sx; }
+      if (e2 < dx) { err += dx; y0 += sy; }
+    }
+  }
+
+  static public int draw()
+  {
+    int[] bitmap = new int[8];
+    int total = 0;
+    int y;
+
+    line(bitmap, 0, 0, 7, 7);
+    line(bitmap, 0, 7, 7, 0);
+    line(bitmap, 0, 3, 7, 4);
+    line(bitmap, 2, 0, 5, 7);
+
+    for (y = 0; y < bitmap.length; y++)
+    {
+      total += bitmap[y] * (y + 1);
+    }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    draw();
+  }
+}
+
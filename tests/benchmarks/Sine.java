@@ -0,0 +1,65 @@
+// result=2223
+
+public class Sine
+{
+  // A quarter of a sine wave in steps of 4 out of a 512 step circle,
+  // scaled to 127.
+  static int[] table =
+  {
+      0,   6,  12,  19,  25,  31,  37,  43,  49,  54,  60,  65,  71,
+     76,  81,  85,  90,  94,  98, 102, 106, 109, 112, 115, 117, 120,
+    122, 123, 125, 126, 126, 127, 127
+  };
+
+  // Same circle as Math.sin512() but with a table so every platform
+  // can run it.
+  static public int sin512(int angle)
+  {
+    int index, fraction, value;
+
+    angle = angle & 511;
+
+    if (angle >= 256) { return -sin512(angle - 256); }
+    if (angle > 128) { angle = 256 - angle; }
+
+    index = angle >> 2;
+    fraction = angle & 3;
+    value = table[index];
+
+    if (fraction != 0)
+    {
+      value += ((table[index + 1] - value) * fraction) >> 2;
+    }
+
+    return value;
+  }
+
+  static public int cos512(int angle)
+  {
+    return sin512(angle + 128);
+  }
+
+  static public int rotate()
+  {
+    int total = 0;
+    int x = 50;
+    int y = 20;
+    int angle, s, c;
+
+    for (angle = 0; angle < 512; angle += 24)
+    {
+      s = sin512(angle);
+      c = cos512(angle);
+
+      total += ((x * c - y * s) >> 7) + ((x * s + y * c) >> 7) + 100;
+    }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    rotate();
+  }
+}
+
@@ -0,0 +1,46 @@
+// result=8067
+
+public class Sort
+{
+  static int[] values =
+  {
+    58, 12, 97, 3, 41, 76, 25, 64, 8, 89, 33, 50, 19, 71, 44, 6
+  };
+
+  static public int sort()
+  {
+    int[] array = new int[values.length];
+    int total = 0;
+    int i, j, value;
+
+    for (i = 0; i < array.length; i++) { array[i] = values[i]; }
+
+    // Insertion sort.
+    for (i = 1; i < array.length; i++)
+    {
+      value = array[i];
+      j = i - 1;
+
+      while (j >= 0 && array[j] > value)
+      {
+        array[j + 1] = array[j];
+        j--;
+      }
+
+      array[j + 1] = value;
+    }
+
+    for (i = 0; i < array.length; i++)
+    {
+      total += array[i] * (i + 1);
+    }
+
+    return total;
+  }
+
+  static public void main(String args[])
+  {
+    sort();
+  }
+}
+
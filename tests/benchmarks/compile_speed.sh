@@ -0,0 +1,122 @@
+#!/usr/bin/env bash
+
+# Times java_grinder itself on made up classes (scripts/make_classes.py)
+# that keep doubling in size: more methods, bigger <clinit> arrays and
+# longer chains of external classes.  Fails if the biggest of a series
+# takes much more than its share of time compared to the smallest,
+# which is usually something quadratic.
+#
+#   ./compile_speed.sh                  compile for msp430g2553
+#   ./compile_speed.sh -p <platform>    compile for something else
+
+platform=msp430g2553
+java_grinder=../../java_grinder
+make_classes=../../scripts/make_classes.py
+dir=`mktemp -d`
+failed=0
+
+while [ $# -gt 0 ]
+do
+  case $1 in
+    -p) platform=$2; shift ;;
+    *) echo "Usage: $0 [ -p <platform> ]"; exit 1 ;;
+  esac
+  shift
+done
+
+# get_phase <output of java_grinder -time> <phase>
+get_phase()
+{
+  echo "$1" | grep "^  $2 " | awk '{ print $2 }'
+}
+
+# run <size> <make_classes.py options>
+run()
+{
+  size=$1
+  shift
+
+  rm -f ${dir}/*.class
+  python3 ${make_classes} "$@" ${dir} || exit 1
+
+  # Best of 3 so one slow run doesn't look like a regression.
+  best=""
+
+  for n in 1 2 3
+  do
+    a=`${java_grinder} -time ${dir}/Synthetic.class ${dir}/Synthetic.asm ${platform}`
+
+    if [ $? -ne 0 ]
+    then
+      echo "${size} : GRIND FAILED ***"
+      failed=1
+      return
+    fi
+
+    t=`get_phase "${a}" total`
+
+    if [ -z "${best}" ] || awk "BEGIN { exit !(${t} < ${best}) }"
+    then
+      best=${t}
+      output=${a}
+    fi
+  done
+
+  printf "%8d %10s %10s %10s %10s %10s %10s %10s\n" ${size} \
+    `get_phase "${output}" load_class` \
+    `get_phase "${output}" insert_static_field_defines` \
+    `get_phase "${output}" add_static_initializers` \
+    `get_phase "${output}" compile_methods` \
+    `get_phase "${output}" add_constants` \
+    `get_phase "${output}" output` \
+    ${best}
+
+  if [ -z "${first_size}" ]
+  then
+    first_size=${size}
+    first_time=${best}
+  fi
+
+  last_size=${size}
+  last_time=${best}
+}
+
+# series <name> <make_classes.py option> <other options> <sizes>
+series()
+{
+  name=$1
+  option=$2
+  others=$3
+  shift 3
+
+  first_size=""
+
+  echo
+  printf "%8s %10s %10s %10s %10s %10s %10s %10s\n" ${name} load defines statics methods constants output "total ms"
+
+  for size in $@
+  do
+    run ${size} ${option} ${size} ${others}
+  done
+
+  if [ -z "${first_size}" ]; then return; fi
+
+  # Time per unit of size shouldn't go up more than 2x from the smallest
+  # to the biggest.
+  if awk "BEGIN { exit !((${last_time} / ${first_time}) > 2 * (${last_size} / ${first_size})) }"
+  then
+    echo "${name}: ${first_size} took ${first_time} ms but ${last_size} took ${last_time} ms, worse than linear ***"
+    failed=1
+  fi
+}
+
+echo "Compiling for ${platform}"
+
+series methods -methods "-array 100" 500 1000 2000 4000
+series array -array "-methods 10" 500 1000 2000 4000
+series classes -classes "-methods 10" 50 100 200 400
+
+rm -rf ${dir}
+
+exit ${failed}
+
@@ -0,0 +1,142 @@
+#!/usr/bin/env bash
+
+# Grinds each benchmark with -cycles and compares its worst case cycle
+# count (the sum of each method's static estimate) and code size against
+# baselines.txt.  Both numbers come from java_grinder itself so a slower
+# or bigger build fails without a simulator.  If naken_util is there the
+# hex file is also run to check the benchmark still gets its answer.
+#
+#   ./run_benchmarks.sh            fail if anything got slower or bigger
+#   ./run_benchmarks.sh -t 10      allow 10% instead of 5%
+#   ./run_benchmarks.sh -update    record the current numbers
+
+threshold=5
+update=0
+naken_util=${NAKEN_UTIL:-../../../naken_asm/naken_util}
+baselines=baselines.txt
+results=baselines.new
+failed=0
+
+while [ $# -gt 0 ]
+do
+  case $1 in
+    -t) threshold=$2; shift ;;
+    -update) update=1 ;;
+    *) echo "Usage: $0 [ -t <percent> ] [ -update ]"; exit 1 ;;
+  esac
+  shift
+done
+
+if [ ! -x ${naken_util} ]
+then
+  echo "Can't find naken_util (set NAKEN_UTIL), answers won't be checked"
+  naken_util=
+fi
+
+make || exit 1
+
+rm -f ${results}
+
+# check <name> <what> <now> <baseline>
+check()
+{
+  if [ -z "$4" -o "$4" = "-" ]
+  then
+    echo -n " ($2 no baseline, run with -update) FAIL"
+    failed=1
+    return
+  fi
+
+  if [ $(( $3 * 100 )) -gt $(( $4 * (100 + threshold) )) ]
+  then
+    echo -n " ($2 was $4) REGRESSION"
+    failed=1
+  elif [ $(( $3 * 100 )) -lt $(( $4 * (100 - threshold) )) ]
+  then
+    echo -n " ($2 was $4) better, run with -update"
+  fi
+}
+
+# run_benchmark <name> <platform> <chip> <naken_util options> <result register>
+run_benchmark()
+{
+  file=$1
+  platform=$2
+
+  ../../java_grinder -cycles -stats ${file}_${platform}.json -hex ${file}.hex \
+    ${file}.class ${file}.asm $3 > /dev/null
+
+  if [ $? -ne 0 ]
+  then
+    echo "${file} ${platform} : GRIND FAILED ***"
+    failed=1
+    return
+  fi
+
+  baseline=`grep "^${file} ${platform} " ${baselines} 2> /dev/null`
+
+  total=`grep '"total"' ${file}_${platform}.json`
+  cycles=`echo ${total} | sed 's/^.*"cycles": //' | sed 's/[, ].*$//'`
+  bytes=`echo ${total} | sed 's/^.*"bytes": //' | sed 's/,.*$//'`
+
+  # A platform without cycle timings (or code -cycles doesn't know)
+  # can't be compared.
+  if ! echo ${total} | grep -q '"cycles_complete": true'
+  then
+    cycles=-
+  fi
+
+  echo -n "${file} ${platform} : ${cycles} cycles, ${bytes} bytes"
+
+  if [ -n "${naken_util}" -a -n "$5" ]
+  then
+    a=`${naken_util} $4 -run ${file}.hex`
+    answer=`echo ${a} | sed "s/^.* $5: //" | sed 's/[, ].*$//'`
+    answer=`printf "%d" ${answer}`
+    result=`cat ${file}.java | grep '^// result=' | sed 's/\/\/ result=//'`
+
+    if [ ${answer} -ne ${result} ]
+    then
+      echo " FAIL got ${answer} but expected ${result}"
+      failed=1
+      return
+    fi
+  fi
+
+  echo "${file} ${platform} ${cycles} ${bytes}" >> ${results}
+
+  if [ ${update} -eq 0 ]
+  then
+    check ${file} cycles ${cycles} `echo ${baseline} | cut -d ' ' -f 3`
+    check ${file} bytes ${bytes} `echo ${baseline} | cut -d ' ' -f 4`
+  fi
+
+  echo
+}
+
+for file in *.class
+do
+  file=${file%.class}
+  run_benchmark ${file} msp430 msp430g2553 "" r15
+  run_benchmark ${file} mips32 pic32 -mips32 '$v0'
+  # The result isn't in a register on the 6502.
+  run_benchmark ${file} 6502 c64 -6502
+done
+
+if [ ${update} -eq 1 ]
+then
+  if [ ${failed} -eq 0 ]
+  then
+    grep "^#" ${baselines} > ${baselines}.tmp 2> /dev/null || \
+      echo "# benchmark platform cycles bytes" > ${baselines}.tmp
+    cat ${results} >> ${baselines}.tmp
+    mv ${baselines}.tmp ${baselines}
+    echo "Updated ${baselines}"
+  fi
+fi
+
+rm -f ${results}
+make clean
+
+exit ${failed}
+
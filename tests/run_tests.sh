@@ -2,10 +2,38 @@
 
 make
 
+run_interpreter_test()
+{
+  file=$1
+  a=`../java_grinder $2 -interpret ${file}.class`
+  if [ $? -ne 0 ]
+  then
+    echo "${a}" | grep '^Error'
+    echo "${file} : INTERPRET FAILED ***"
+    exit 1
+  fi
+  answer=`echo "${a}" | grep '^result=' | sed 's/^result=//'`
+  result=`cat ${file}.java | grep '^// result=' | sed 's/\/\/ result=//'`
+  echo -n ${file} ": " ${answer}
+  if [ ${answer} -ne ${result} ]
+  then
+    echo " FAIL got ${answer} but expected ${result}"
+    exit 1
+  fi
+  echo " PASS"
+}
+
 run_msp430_test()
 {
   file=$1
-  ../java_grinder $2 ${file}.class ${file}.asm msp430g2231 > /dev/null
+  if grep -q '^// skip=msp430' ${file}.java
+  then
+    echo "${file} : SKIPPED (not supported on MSP430)"
+    return
+  fi
+  # A test too big for the 2K of flash in the g2231 names a bigger chip.
+  chip=`grep '^// msp430=' ${file}.java | sed 's/^\/\/ msp430=//'`
+  ../java_grinder $2 ${file}.class ${file}.asm ${chip:-msp430g2231} > /dev/null
   if [ $? -ne 0 ]
   then
     echo "${file} : GRIND FAILED ***"
@@ -72,6 +100,22 @@ run_mips_test()
   echo " PASS"
 }
 
+echo " ---- Testing Interpreter ----"
+
+for file in *.class
+do
+  file=${file%.class}
+  run_interpreter_test ${file}
+done
+
+echo " ---- Testing Interpreter (Unoptimized) ----"
+
+for file in *.class
+do
+  file=${file%.class}
+  run_interpreter_test ${file} -O0
+done
+
 echo " ---- Testing MSP430 ----"
 
 for file in *.class